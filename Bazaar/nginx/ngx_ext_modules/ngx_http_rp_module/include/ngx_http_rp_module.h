@@ -38,6 +38,7 @@ typedef struct ngx_http_rp_loc_conf_s {
     ngx_str_t       bazaar_dir;
     ngx_str_t       bazaar_server;
     ngx_str_t       tmp_dir;
+    size_t          fpga_cache_size;
     /* Internal structures */
     /* Be careful to use this only in local modules (it must be NULL all other
      * time.
@@ -93,6 +94,13 @@ int rp_module_cmd_again(cJSON **json_root, ngx_pool_t *pool);
 
 ngx_int_t rp_module_redirect(ngx_http_request_t *r, const char *location);
 ngx_int_t rp_module_send_response(ngx_http_request_t *r, cJSON **json_root);
+/* Sends an already serialized response body (must live in r->pool) */
+ngx_int_t rp_module_send_buffer(ngx_http_request_t *r, const char *content_type,
+                                u_char *buffer, size_t len);
+/* Sends a response body built in a chain of r->pool buffers, e.g. by
+ * rp_json_writer (len is the total length of the chain) */
+ngx_int_t rp_module_send_chain(ngx_http_request_t *r, const char *content_type,
+                               ngx_chain_t *out, size_t len);
 
 extern ngx_module_t ngx_http_rp_module;
 
@@ -17,6 +17,7 @@
 
 #include <stdio.h>
 #include "cJSON.h"
+#include "rp_bazaar_fpga.h"
 
 /** Structure which describes parameters supported by the application.
  * Each application includes an parameters table which includes the following
@@ -53,6 +54,8 @@ typedef const char  *(*rp_app_desc_func)(void);
 typedef int          (*rp_set_params_func)(rp_app_params_t *p, int len);
 typedef int          (*rp_get_params_func)(rp_app_params_t **p);
 typedef int          (*rp_get_signals_func)(float ***s, int *sig_num, int *sig_len);
+/* Optional function: */
+typedef int          (*rp_get_signals_fd_func)(void);
 
 /*WebSocket Server part*/
 typedef void		(*rp_ws_set_params_interval_func)(int);
@@ -83,6 +86,11 @@ typedef struct rp_bazaar_app_s {
     rp_get_params_func       get_params_func;
     /* Retrieves last good signals from the application */
     rp_get_signals_func      get_signals_func;
+    /* Returns a non-blocking fd (eventfd or pipe) which becomes readable
+     * when new signals are set, the server drains it (optional, owned and
+     * closed by the application, -1 if not available)
+     */
+    rp_get_signals_fd_func   get_signals_fd_func;
 
 	/*WebSocket Server part*/
 
@@ -120,14 +128,6 @@ typedef struct hk_fpga_reg_mem_s {
     uint32_t dna_hi;
 } hk_fpga_reg_mem_t;
 
-typedef enum fpga_stat{
-    FPGA_OK,
-    FPGA_FIND_ERR,
-    FPGA_READ_ERR,
-    FPGA_WRITE_ERR,
-    FPGA_NOT_REQ,
-}fpga_stat_t;
-
 
 int rp_bazaar_app_get_local_list(const char *dir, cJSON **json_root,
                                  ngx_pool_t *pool, int verbose);
@@ -0,0 +1,65 @@
+/**
+ * $Id$
+ *
+ * @brief Red Pitaya Nginx module - FPGA bitstream manager.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __RP_BAZAAR_FPGA_H
+#define __RP_BAZAAR_FPGA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum fpga_stat{
+    FPGA_OK,
+    FPGA_FIND_ERR,
+    FPGA_READ_ERR,
+    FPGA_WRITE_ERR,
+    FPGA_NOT_REQ,
+}fpga_stat_t;
+
+/* Statistics of the last rp_bazaar_fpga_load() call */
+typedef struct rp_fpga_load_stat_s {
+    uint64_t hash;       /* content hash of the bitstream */
+    size_t   size;       /* bitstream size in bytes */
+    int      skipped;    /* image was already loaded, device not written */
+    int      from_ram;   /* image was written from the RAM cache */
+    uint64_t hash_us;    /* reading & hashing the file (0 if hash was known) */
+    uint64_t load_us;    /* writing the image to the device */
+    uint64_t total_us;
+} rp_fpga_load_stat_t;
+
+/** Loads the bitstream into the FPGA configuration device.
+ *
+ * The currently loaded image is tracked by content hash (also across
+ * restarts, through the state file), and loading an identical image is
+ * skipped. Files are streamed to the device in chunks; recently used images
+ * are kept in RAM if the cache is enabled with rp_bazaar_fpga_set_cache().
+ *
+ * @param fpga_file  bitstream file
+ * @param dev        configuration device (normally /dev/xdevcfg)
+ * @param force      write the image even if it is already loaded
+ */
+fpga_stat_t rp_bazaar_fpga_load(const char *fpga_file, const char *dev,
+                                int force);
+
+/* Limit for bitstreams kept in RAM, 0 (default) disables the cache */
+void rp_bazaar_fpga_set_cache(size_t max_bytes);
+/* Overrides the state file and the PL 'prog_done' sysfs attribute paths,
+ * NULL keeps the current one */
+void rp_bazaar_fpga_set_paths(const char *state_file, const char *prog_done);
+/* Forgets the loaded image, next load always writes the device. Must be
+ * called by anyone loading the FPGA behind the manager's back. */
+void rp_bazaar_fpga_invalidate(void);
+/* Releases the RAM cache and all in-memory state (state file is kept) */
+void rp_bazaar_fpga_cleanup(void);
+
+const rp_fpga_load_stat_t *rp_bazaar_fpga_get_last_stat(void);
+
+#endif /*__RP_BAZAAR_FPGA_H*/
@@ -22,6 +22,38 @@
 #include "ngx_http_rp_module.h"
 #include "cJSON.h"
 
+/* Binary signal response, requested with GET /data?format=f32 or
+ * GET /data?format=i16 (add &gzip=1 to allow gzip content encoding).
+ * All fields are little endian. The response is laid out as:
+ *   - rp_data_bin_hdr_t
+ *   - float scale[sig_num], float offset[sig_num]
+ *   - JSON text of length json_len ({"datasets":{"params":{...}}}), padded
+ *     with spaces to a multiple of 4 bytes
+ *   - sig_num columns of sig_len samples each (float or int16_t), starting
+ *     at data_offset
+ * Sample value is sample * scale[i] + offset[i] (scale 1, offset 0 for f32).
+ */
+#define RP_DATA_BIN_MAGIC   0x42445052 /* "RPDB" */
+#define RP_DATA_BIN_VERSION 1
+
+typedef enum rp_data_format_e {
+    RP_DATA_FORMAT_JSON = 0,
+    RP_DATA_FORMAT_F32,
+    RP_DATA_FORMAT_I16,
+    RP_DATA_FORMAT_NUM
+} rp_data_format_t;
+
+typedef struct rp_data_bin_hdr_s {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t format;      /* rp_data_format_t */
+    uint32_t status;      /* 0 - OK, 1 - AGAIN (old signals) */
+    uint32_t sig_num;
+    uint32_t sig_len;
+    uint32_t json_len;
+    uint32_t data_offset;
+} rp_data_bin_hdr_t;
+
 /* Main handler */
 ngx_int_t rp_data_cmd_handler(ngx_http_request_t *r);
 
@@ -36,11 +68,11 @@ int rp_data_get_params_list(ngx_http_request_t *r,
 int rp_data_get_signals_list(ngx_http_request_t *r, 
                              cJSON **json_root, int argc, char **argv);
 /* Called from callback rp_data_post_read() */
-int rp_data_get_params(ngx_http_request_t *r, cJSON **json_root);
 int rp_data_set_signals(ngx_http_request_t *r, cJSON **json_root);
-int rp_data_get_signals(ngx_http_request_t *r, cJSON **json_root);
 /* Clear dirty flag in case of re-send */
 void rp_data_clear_signals_dirty();
+/* Answers waiting requests, called before the application is unloaded */
+void rp_data_app_unload(void);
 
 /* Helper functions */
 int rp_data_parse_and_set_params(cJSON *params_root);
@@ -0,0 +1,84 @@
+/**
+ * $Id$
+ *
+ * @brief Red Pitaya Nginx module - streaming JSON writer.
+ *
+ * Writes JSON text straight into a chain of pool buffers which can be
+ * passed to the output filters as is, no node tree and no intermediate
+ * strings. Output is the same as cJSON_PrintUnformatted() of the matching
+ * tree.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __RP_JSON_WRITER_H
+#define __RP_JSON_WRITER_H
+
+#include <ngx_config.h>
+#include <ngx_core.h>
+
+/* Default size of the chain buffers */
+#define RP_JSON_CHUNK       (32 * 1024)
+/* Longest text rp_json_print_sample() produces: sign, 39 integral digits of
+ * FLT_MAX, decimal point, 4 decimals and NUL */
+#define RP_JSON_SAMPLE_MAX  48
+/* Max. nesting of objects & arrays */
+#define RP_JSON_DEPTH_MAX   32
+
+typedef struct rp_json_writer_s {
+    ngx_pool_t   *pool;
+    size_t        chunk;
+    /* output chain, current buffer is the last one */
+    ngx_chain_t  *out;
+    ngx_chain_t **last;
+    ngx_buf_t    *buf;
+    /* length of the buffers before the current one */
+    size_t        len;
+    /* bit per nesting level, set once the level has a member */
+    uint32_t      members;
+    int           depth;
+    /* allocation failed or bad nesting, everything else is ignored */
+    int           failed;
+} rp_json_writer_t;
+
+/* Prepares an empty writer, chunk 0 means RP_JSON_CHUNK */
+void rp_json_init(rp_json_writer_t *w, ngx_pool_t *pool, size_t chunk);
+
+/* Object & array members take a key, array elements and the top level
+ * value NULL.
+ */
+void rp_json_object_begin(rp_json_writer_t *w, const char *key);
+void rp_json_object_end(rp_json_writer_t *w);
+void rp_json_array_begin(rp_json_writer_t *w, const char *key);
+void rp_json_array_end(rp_json_writer_t *w);
+/* Number as cJSON_CreateNumber() prints it */
+void rp_json_number(rp_json_writer_t *w, const char *key, double d);
+void rp_json_string(rp_json_writer_t *w, const char *key, const char *s);
+/* [[x0,y0],[x1,y1],...] as cJSON_Create2dFloatArray() prints it, either
+ * x or y can be NULL.
+ */
+void rp_json_float_pairs(rp_json_writer_t *w, const char *key,
+                         const float *x, const float *y, int len);
+
+/* Reserves n contiguous bytes in the output for the caller to fill, used to
+ * put binary data around the JSON text. NULL on failure.
+ */
+u_char *rp_json_alloc(rp_json_writer_t *w, size_t n);
+/* Bytes written so far */
+size_t rp_json_length(rp_json_writer_t *w);
+
+/* Returns the output chain (last buffer marked) and its length, NULL if any
+ * step failed.
+ */
+ngx_chain_t *rp_json_finish(rp_json_writer_t *w, size_t *len);
+
+/* Formats one 2d array sample into p (at least RP_JSON_SAMPLE_MAX bytes),
+ * returns pointer past the last character.
+ */
+u_char *rp_json_print_sample(u_char *p, double d);
+
+#endif /* __RP_JSON_WRITER_H */
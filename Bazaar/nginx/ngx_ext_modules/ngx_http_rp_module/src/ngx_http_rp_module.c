@@ -81,6 +81,12 @@ ngx_command_t ngx_http_rp_commands[] = {
       NGX_HTTP_LOC_CONF_OFFSET,
       offsetof(ngx_http_rp_loc_conf_t, tmp_dir),
       NULL },
+    { ngx_string("rp_fpga_cache_size"),
+      NGX_HTTP_LOC_CONF|NGX_HTTP_SRV_CONF|NGX_HTTP_MAIN_CONF|NGX_CONF_TAKE1,
+      ngx_conf_set_size_slot,
+      NGX_HTTP_LOC_CONF_OFFSET,
+      offsetof(ngx_http_rp_loc_conf_t, fpga_cache_size),
+      NULL },
     { ngx_string("rp_module_cmd"),
       NGX_HTTP_LOC_CONF|NGX_HTTP_SRV_CONF|NGX_HTTP_MAIN_CONF|NGX_CONF_NOARGS,
       ngx_http_rp_bazaar_cmd,
@@ -145,6 +151,7 @@ void *ngx_http_rp_create_loc_conf(ngx_conf_t *cf)
     }
 
     ngx_memset(conf, 0, sizeof(ngx_http_rp_loc_conf_t));
+    conf->fpga_cache_size = NGX_CONF_UNSET_SIZE;
 
     return conf;
 }
@@ -189,6 +196,8 @@ char *ngx_http_rp_merge_loc_conf(ngx_conf_t *cf, void *parent, void *child)
 
     ngx_conf_merge_str_value(conf->tmp_dir, prev->tmp_dir,
                              c_tmp_dir);
+    /* FPGA bitstreams are not kept in RAM by default */
+    ngx_conf_merge_size_value(conf->fpga_cache_size, prev->fpga_cache_size, 0);
 
     if(stat((const char *)conf->bazaar_dir.data, &stat_buf) < 0) {
         rp_error(cf->log, "Can not open local Bazaar directory (%s): %s",
@@ -354,72 +363,48 @@ ngx_int_t rp_module_redirect(ngx_http_request_t *r, const char *loc)
 
 
 /*----------------------------------------------------------------------------*/
-ngx_int_t rp_module_send_response(ngx_http_request_t *r, cJSON **json_root)
+ngx_int_t rp_module_send_buffer(ngx_http_request_t *r, const char *content_type,
+                                u_char *buffer, size_t len)
 {
     ngx_buf_t   *b;
-    ngx_chain_t  out;
-    ngx_int_t    rc;
-    char *out_buffer;
-    int   out_buffer_len;
-    cJSON *j_params;
-    cJSON *j_status;
+    ngx_chain_t *out;
 
     b = ngx_pcalloc(r->pool, sizeof(ngx_buf_t));
-    if(b == NULL) {
+    out = ngx_alloc_chain_link(r->pool);
+    if((b == NULL) || (out == NULL)) {
         rp_error(r->connection->log, "Can not allocate memory");
         return NGX_HTTP_INTERNAL_SERVER_ERROR;
     }
-    out.buf = b;
-    out.next = NULL;
-    r->headers_out.content_type_len = strlen(json_content_str);
-    r->headers_out.content_type.len = strlen(json_content_str);
-    r->headers_out.content_type.data = (u_char *)json_content_str;
-
-    out_buffer = cJSON_PrintUnformatted(*json_root, r->pool);
-    if(out_buffer == NULL) {
-        rp_error(r->connection->log, "Creating output buffer failed");
-        return NGX_HTTP_INTERNAL_SERVER_ERROR;
-    }
-
-    out_buffer_len = strlen(out_buffer);
+    out->buf = b;
+    out->next = NULL;
 
-    b->pos = (u_char *)out_buffer;
-    b->last =
-        (u_char *)out_buffer + out_buffer_len;
+    b->pos = buffer;
+    b->last = buffer + len;
     b->memory   = 1;
     b->last_buf = b->last_in_chain = 1;
-    b->sync     = b->flush = 1;
 
-    r->headers_out.status = NGX_HTTP_OK;
-    r->headers_out.content_length_n = out_buffer_len;
+    return rp_module_send_chain(r, content_type, out, len);
+}
 
-    /* Debug purpopses - output params & status */
-    j_params = cJSON_GetObjectItem(*json_root, "params");
-    if(j_params != NULL) {
-        int params_cnt = -1;
-        int i;
-        params_cnt = cJSON_GetArraySize(j_params);
-        rp_debug(r->connection->log, "Output parameters: ");
-        for(i = 0; i < params_cnt; i++) {
-            rp_debug(r->connection->log, "\t%d - %f", i,
-                     (float)cJSON_GetArrayItem(j_params, i)->valuedouble);
-        }
-    }
-    j_status = cJSON_GetObjectItem(*json_root, "status");
-    //if(j_status != NULL) {
-    //    rp_debug(r->connection->log, "Output status (req :%d): %s", r->method,
-    //             j_status->valuestring);
-    //}
 
-    cJSON_Delete(*json_root, r->pool);
+/*----------------------------------------------------------------------------*/
+ngx_int_t rp_module_send_chain(ngx_http_request_t *r, const char *content_type,
+                               ngx_chain_t *out, size_t len)
+{
+    ngx_chain_t *cl;
+    ngx_int_t    rc;
 
-    rc = ngx_http_send_header(r);
+    r->headers_out.content_type_len = strlen(content_type);
+    r->headers_out.content_type.len = strlen(content_type);
+    r->headers_out.content_type.data = (u_char *)content_type;
 
-    /* If error while sending OK output we re-send it */
-    if((rc == NGX_ERROR) && (r->method == NGX_HTTP_GET) && j_status &&
-       (j_status->valuestring[0] = 'O') && (j_status->valuestring[1] == 'K')) {
-        rp_data_clear_signals_dirty();
-    }
+    for(cl = out; cl->next; cl = cl->next);
+    cl->buf->sync = cl->buf->flush = 1;
+
+    r->headers_out.status = NGX_HTTP_OK;
+    r->headers_out.content_length_n = len;
+
+    rc = ngx_http_send_header(r);
     if (rc == NGX_ERROR || rc > NGX_OK || r->header_only) {
         return rc;
     }
@@ -431,10 +416,11 @@ ngx_int_t rp_module_send_response(ngx_http_request_t *r, cJSON **json_root)
     /* send the buffer chain of your response */
     /* Temp, got from ruby-forum.com - put socket to blocking */
     ngx_blocking(r->connection->fd);
-    rc = ngx_http_output_filter(r, &out);
+    rc = ngx_http_output_filter(r, out);
     while(rc == NGX_AGAIN) {
+        /* the unsent rest of the chain is queued already */
         r->connection->write->ready = 1;
-        rc = ngx_http_output_filter(r, &out);
+        rc = ngx_http_output_filter(r, NULL);
         if(rc == NGX_ERROR)
             break;
     }
@@ -444,3 +430,46 @@ ngx_int_t rp_module_send_response(ngx_http_request_t *r, cJSON **json_root)
     return NGX_DONE;
 }
 
+
+/*----------------------------------------------------------------------------*/
+ngx_int_t rp_module_send_response(ngx_http_request_t *r, cJSON **json_root)
+{
+    ngx_int_t    rc;
+    char *out_buffer;
+    cJSON *j_params;
+    cJSON *j_status;
+    int status_ok;
+
+    out_buffer = cJSON_PrintUnformatted(*json_root, r->pool);
+    if(out_buffer == NULL) {
+        rp_error(r->connection->log, "Creating output buffer failed");
+        return NGX_HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    /* Debug purpopses - output params & status */
+    j_params = cJSON_GetObjectItem(*json_root, "params");
+    if(j_params != NULL) {
+        int params_cnt = -1;
+        int i;
+        params_cnt = cJSON_GetArraySize(j_params);
+        rp_debug(r->connection->log, "Output parameters: ");
+        for(i = 0; i < params_cnt; i++) {
+            rp_debug(r->connection->log, "\t%d - %f", i,
+                     (float)cJSON_GetArrayItem(j_params, i)->valuedouble);
+        }
+    }
+    j_status = cJSON_GetObjectItem(*json_root, "status");
+    status_ok = j_status && (j_status->valuestring[0] == 'O') &&
+        (j_status->valuestring[1] == 'K');
+
+    cJSON_Delete(*json_root, r->pool);
+
+    rc = rp_module_send_buffer(r, json_content_str, (u_char *)out_buffer,
+                               strlen(out_buffer));
+
+    /* If error while sending OK output we re-send it */
+    if((rc == NGX_ERROR) && (r->method == NGX_HTTP_GET) && status_ok) {
+        rp_data_clear_signals_dirty();
+    }
+    return rc;
+}
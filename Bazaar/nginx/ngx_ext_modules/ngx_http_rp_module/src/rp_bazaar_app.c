@@ -24,6 +24,7 @@
 
 #include "rp_bazaar_cmd.h"
 #include "rp_bazaar_app.h"
+#include "rp_data_cmd.h"
 
 #include <ws_server.h>
 
@@ -36,6 +37,7 @@ const char *c_rp_set_params_str   = "rp_set_params";
 const char *c_rp_get_params_str   = "rp_get_params";
 const char *c_rp_set_signals_str  = "rp_set_signals";
 const char *c_rp_get_signals_str  = "rp_get_signals";
+const char *c_rp_get_signals_fd_str = "rp_get_signals_fd";
 
 //start web socket function str
 
@@ -52,6 +54,8 @@ const char *c_verify_app_license_str  = "verify_app_license";
 const char* c_ws_gzip_str = "ws_gzip";
 // end web socket function str
 
+const char *c_fpga_dev = "/dev/xdevcfg";
+
 /** Get MAC address of a specific NIC via sysfs */
 int rp_bazaar_get_mac(const char* nic, char *mac)
 {
@@ -508,6 +512,9 @@ int rp_bazaar_app_load_module(const char *app_file, rp_bazaar_app_t *app)
     if(!app->get_signals_func)
         return -7;
 
+    /* Optional - without it /data falls back to polling rp_get_signals() */
+    app->get_signals_fd_func = dlsym(app->handle, c_rp_get_signals_fd_str);
+
     // start web socket functionality
     app->ws_api_supported = 1;
     app->ws_set_params_interval_func = dlsym(app->handle, c_ws_set_params_interval_str);
@@ -603,6 +610,10 @@ int rp_bazaar_app_unload_module(rp_bazaar_app_t *app)
 {
     stop_ws_server();
     if(app->handle) {
+        if(app == &rp_module_ctx.app) {
+            /* /data requests must not wait on an unloaded application */
+            rp_data_app_unload();
+        }
         if(app->initialized && app->exit_func) {
             app->exit_func();
         }
@@ -620,49 +631,8 @@ int rp_bazaar_app_unload_module(rp_bazaar_app_t *app)
     return 0;
 }
 
-/* Use xdevcfg to load the data - using 32k buffers */
+/* Use xdevcfg to load the data, skipped if the same image is loaded already */
 fpga_stat_t rp_bazaar_app_load_fpga(const char *fpga_file)
 {
-    int fo, fi;
-    int fpga_size;
-    struct stat st;
-
-
-    /* Get FPGA size */
-    stat(fpga_file, &st);
-    fpga_size = st.st_size;
-    char fi_buff[fpga_size];
-
-    fo = open("/dev/xdevcfg", O_WRONLY);
-    if(fo < 0) {
-        fprintf(stderr, "rp_bazaar_app_load_fpga() failed to open xdevcfg: %s\n",
-                strerror(errno));
-        return FPGA_READ_ERR;
-    }
-
-    fi = open(fpga_file, O_RDONLY);
-    if(fi < 0) {
-        fprintf(stderr, "rp_bazaar_app_load_fpga() failed to open FPGA file: %s\n",
-                strerror(errno));
-        return FPGA_FIND_ERR;
-    }
-
-    /* Read FPGA file into fi_buff */
-    if(read(fi, &fi_buff, fpga_size) < 0){
-        fprintf(stderr, "Unable to read FPGA file: %s\n",
-            strerror(errno));
-        return FPGA_READ_ERR;
-    }
-
-    /* Write fi_buff into fo */
-    if(write(fo, &fi_buff, fpga_size) < 0){
-        fprintf(stderr, "Unable to write to /dev/xdevcfg: %s\n",
-            strerror(errno));
-        return FPGA_WRITE_ERR;
-    }
-
-    close(fo);
-    close(fi);
-
-    return FPGA_OK;
+    return rp_bazaar_fpga_load(fpga_file, c_fpga_dev, 0);
 }
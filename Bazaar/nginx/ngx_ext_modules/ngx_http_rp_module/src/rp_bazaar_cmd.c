@@ -458,6 +458,7 @@ int rp_bazaar_start(ngx_http_request_t *r,
 
     /* Get FPGA config file in <app_dir>/<app_id>/fpga.conf */
     char *fpga_name = NULL;
+    rp_bazaar_fpga_set_cache(lc->fpga_cache_size);
     if (system("/opt/redpitaya/rmamba_pl.sh"))
         fprintf(stderr, "Problem running /opt/redpitaya/rmamba_pl.sh\n");
     if(get_fpga_path((const char *)argv[0], (const char *)lc->bazaar_dir.data, &fpga_name) == 0) { // FIXME !!!
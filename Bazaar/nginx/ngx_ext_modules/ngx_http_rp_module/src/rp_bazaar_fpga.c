@@ -0,0 +1,481 @@
+/**
+ * $Id$
+ *
+ * @brief Red Pitaya Nginx module - FPGA bitstream manager.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "rp_bazaar_fpga.h"
+
+/* Size of read/write chunks when streaming a bitstream */
+#define FPGA_CHUNK_SIZE   (64 * 1024)
+/* Number of bitstream files whose hash is remembered */
+#define FPGA_IMAGES_NUM   8
+
+#define FNV_OFFSET        0xcbf29ce484222325ULL
+#define FNV_PRIME         0x100000001b3ULL
+
+/* Known bitstream file - hash is valid as long as the file is unchanged */
+typedef struct fpga_image_s {
+    char     path[PATH_MAX];
+    dev_t    dev;
+    ino_t    ino;
+    off_t    size;
+    time_t   mtime;
+    long     mtime_nsec;
+    uint64_t hash;
+    uint8_t *data;     /* RAM copy, NULL if not cached */
+    uint64_t used;     /* LRU stamp */
+} fpga_image_t;
+
+static fpga_image_t images[FPGA_IMAGES_NUM];
+static uint64_t     images_stamp = 0;
+static size_t       cache_max = 0;
+static size_t       cache_used = 0;
+
+/* Currently loaded image */
+static int          loaded_valid = 0;
+static uint64_t     loaded_hash;
+static off_t        loaded_size;
+
+static char         state_file[PATH_MAX] = "/tmp/rp_fpga_loaded";
+static char         prog_done[PATH_MAX] =
+    "/sys/devices/soc0/amba/f8007000.devcfg/prog_done";
+
+static rp_fpga_load_stat_t last_stat;
+
+
+static uint64_t fpga_time_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t fpga_hash(uint64_t hash, const uint8_t *data, size_t len)
+{
+    size_t i;
+
+    for(i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static void fpga_drop_data(fpga_image_t *img)
+{
+    if(img->data) {
+        free(img->data);
+        img->data = NULL;
+        cache_used -= img->size;
+    }
+}
+
+/* Returns the remembered entry for an unchanged file, NULL otherwise */
+static fpga_image_t *fpga_find_image(const char *path, const struct stat *st)
+{
+    int i;
+
+    for(i = 0; i < FPGA_IMAGES_NUM; i++) {
+        fpga_image_t *img = &images[i];
+        if(img->path[0] == '\0' || strcmp(img->path, path))
+            continue;
+        if(img->dev == st->st_dev && img->ino == st->st_ino &&
+           img->size == st->st_size && img->mtime == st->st_mtim.tv_sec &&
+           img->mtime_nsec == st->st_mtim.tv_nsec) {
+            return img;
+        }
+        /* file was replaced - forget it */
+        fpga_drop_data(img);
+        img->path[0] = '\0';
+    }
+    return NULL;
+}
+
+/* Returns an empty (or least recently used) entry */
+static fpga_image_t *fpga_new_image(void)
+{
+    fpga_image_t *lru = &images[0];
+    int i;
+
+    for(i = 0; i < FPGA_IMAGES_NUM; i++) {
+        if(images[i].path[0] == '\0') {
+            return &images[i];
+        }
+        if(images[i].used < lru->used) {
+            lru = &images[i];
+        }
+    }
+    fpga_drop_data(lru);
+    lru->path[0] = '\0';
+    return lru;
+}
+
+/* Frees least recently used RAM copies until 'size' more bytes fit */
+static int fpga_cache_reserve(size_t size)
+{
+    if(size > cache_max)
+        return -1;
+
+    while(cache_used + size > cache_max) {
+        fpga_image_t *lru = NULL;
+        int i;
+        for(i = 0; i < FPGA_IMAGES_NUM; i++) {
+            if(images[i].data && (!lru || images[i].used < lru->used)) {
+                lru = &images[i];
+            }
+        }
+        if(!lru)
+            return -1;
+        fpga_drop_data(lru);
+    }
+    return 0;
+}
+
+/* Reads the whole file in chunks, computing its hash and, if the cache
+ * has room, keeping a RAM copy */
+static fpga_stat_t fpga_read_image(const char *path, fpga_image_t *img)
+{
+    uint8_t *chunk = NULL;
+    off_t done = 0;
+    int fi;
+
+    fi = open(path, O_RDONLY);
+    if(fi < 0) {
+        fprintf(stderr, "rp_bazaar_fpga_load() failed to open FPGA file: %s\n",
+                strerror(errno));
+        return FPGA_FIND_ERR;
+    }
+
+    if(fpga_cache_reserve(img->size) == 0) {
+        img->data = (uint8_t *)malloc(img->size);
+        if(img->data) {
+            cache_used += img->size;
+        }
+    }
+    if(!img->data) {
+        chunk = (uint8_t *)malloc(FPGA_CHUNK_SIZE);
+        if(!chunk) {
+            close(fi);
+            return FPGA_READ_ERR;
+        }
+    }
+
+    img->hash = FNV_OFFSET;
+    while(done < img->size) {
+        uint8_t *buf = img->data ? img->data + done : chunk;
+        size_t len = img->size - done;
+        ssize_t ret;
+
+        if(len > FPGA_CHUNK_SIZE)
+            len = FPGA_CHUNK_SIZE;
+        ret = read(fi, buf, len);
+        if(ret < 0 && errno == EINTR)
+            continue;
+        if(ret <= 0) {
+            fprintf(stderr, "Unable to read FPGA file: %s\n",
+                    ret < 0 ? strerror(errno) : "unexpected end of file");
+            fpga_drop_data(img);
+            free(chunk);
+            close(fi);
+            return FPGA_READ_ERR;
+        }
+        img->hash = fpga_hash(img->hash, buf, ret);
+        done += ret;
+    }
+
+    free(chunk);
+    close(fi);
+    return FPGA_OK;
+}
+
+static int fpga_write_all(int fd, const uint8_t *buf, size_t len)
+{
+    while(len) {
+        ssize_t ret = write(fd, buf, len);
+        if(ret < 0) {
+            if(errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += ret;
+        len -= ret;
+    }
+    return 0;
+}
+
+/* Writes the image to the device, from RAM or streamed from the file. A
+ * streamed image is kept in RAM afterwards if the cache has room for it. */
+static fpga_stat_t fpga_write_image(const char *path, const char *dev,
+                                    fpga_image_t *img)
+{
+    uint8_t *chunk = NULL, *keep = NULL;
+    fpga_stat_t ret = FPGA_OK;
+    int fo, fi = -1;
+    off_t done = 0;
+
+    fo = open(dev, O_WRONLY);
+    if(fo < 0) {
+        fprintf(stderr, "rp_bazaar_fpga_load() failed to open %s: %s\n",
+                dev, strerror(errno));
+        return FPGA_WRITE_ERR;
+    }
+
+    if(img->data) {
+        if(fpga_write_all(fo, img->data, img->size) < 0) {
+            fprintf(stderr, "Unable to write to %s: %s\n", dev,
+                    strerror(errno));
+            ret = FPGA_WRITE_ERR;
+        }
+        close(fo);
+        return ret;
+    }
+
+    if(fpga_cache_reserve(img->size) == 0) {
+        keep = (uint8_t *)malloc(img->size);
+    }
+    if(!keep) {
+        chunk = (uint8_t *)malloc(FPGA_CHUNK_SIZE);
+        if(!chunk) {
+            close(fo);
+            return FPGA_READ_ERR;
+        }
+    }
+
+    fi = open(path, O_RDONLY);
+    if(fi < 0) {
+        fprintf(stderr, "rp_bazaar_fpga_load() failed to open FPGA file: %s\n",
+                strerror(errno));
+        ret = FPGA_FIND_ERR;
+        goto out;
+    }
+
+    while(done < img->size) {
+        uint8_t *buf = keep ? keep + done : chunk;
+        size_t len = img->size - done;
+        ssize_t ret_len;
+
+        if(len > FPGA_CHUNK_SIZE)
+            len = FPGA_CHUNK_SIZE;
+        ret_len = read(fi, buf, len);
+        if(ret_len < 0 && errno == EINTR)
+            continue;
+        if(ret_len <= 0) {
+            fprintf(stderr, "Unable to read FPGA file: %s\n",
+                    ret_len < 0 ? strerror(errno) : "unexpected end of file");
+            ret = FPGA_READ_ERR;
+            goto out;
+        }
+        if(fpga_write_all(fo, buf, ret_len) < 0) {
+            fprintf(stderr, "Unable to write to %s: %s\n", dev,
+                    strerror(errno));
+            ret = FPGA_WRITE_ERR;
+            goto out;
+        }
+        done += ret_len;
+    }
+
+    if(keep) {
+        img->data = keep;
+        cache_used += img->size;
+        keep = NULL;
+    }
+
+out:
+    if(fi >= 0)
+        close(fi);
+    free(keep);
+    free(chunk);
+    close(fo);
+    return ret;
+}
+
+/* Returns 0 if the PL reports it is not configured */
+static int fpga_prog_done(void)
+{
+    char c = '1';
+    FILE *f = fopen(prog_done, "r");
+
+    /* not available (older kernel, test) - trust our own state */
+    if(f == NULL)
+        return 1;
+    if(fread(&c, 1, 1, f) != 1)
+        c = '1';
+    fclose(f);
+    return c != '0';
+}
+
+static void fpga_read_state(void)
+{
+    unsigned long long hash, size;
+    FILE *f;
+
+    if(loaded_valid)
+        return;
+
+    f = fopen(state_file, "r");
+    if(f == NULL)
+        return;
+    if(fscanf(f, "%llx %llu", &hash, &size) == 2) {
+        loaded_hash  = hash;
+        loaded_size  = size;
+        loaded_valid = 1;
+    }
+    fclose(f);
+}
+
+static void fpga_write_state(void)
+{
+    FILE *f = fopen(state_file, "w");
+
+    if(f == NULL) {
+        fprintf(stderr, "Unable to write %s: %s\n", state_file,
+                strerror(errno));
+        return;
+    }
+    fprintf(f, "%016llx %llu\n", (unsigned long long)loaded_hash,
+            (unsigned long long)loaded_size);
+    fclose(f);
+}
+
+
+fpga_stat_t rp_bazaar_fpga_load(const char *fpga_file, const char *dev,
+                                int force)
+{
+    fpga_image_t *img;
+    struct stat st;
+    fpga_stat_t ret;
+    uint64_t start = fpga_time_us(), t;
+
+    memset(&last_stat, 0, sizeof(last_stat));
+
+    if(stat(fpga_file, &st) < 0) {
+        fprintf(stderr, "rp_bazaar_fpga_load() failed to open FPGA file: %s\n",
+                strerror(errno));
+        return FPGA_FIND_ERR;
+    }
+    if(strlen(fpga_file) >= PATH_MAX)
+        return FPGA_FIND_ERR;
+
+    img = fpga_find_image(fpga_file, &st);
+    if(img == NULL) {
+        img = fpga_new_image();
+        strcpy(img->path, fpga_file);
+        img->dev        = st.st_dev;
+        img->ino        = st.st_ino;
+        img->size       = st.st_size;
+        img->mtime      = st.st_mtim.tv_sec;
+        img->mtime_nsec = st.st_mtim.tv_nsec;
+        img->data       = NULL;
+
+        ret = fpga_read_image(fpga_file, img);
+        if(ret != FPGA_OK) {
+            img->path[0] = '\0';
+            return ret;
+        }
+        last_stat.hash_us = fpga_time_us() - start;
+    }
+    img->used = ++images_stamp;
+
+    last_stat.hash = img->hash;
+    last_stat.size = img->size;
+
+    fpga_read_state();
+    if(!force && loaded_valid && loaded_hash == img->hash &&
+       loaded_size == img->size && fpga_prog_done()) {
+        last_stat.skipped  = 1;
+        last_stat.total_us = fpga_time_us() - start;
+        fprintf(stderr, "FPGA %s (%016llx) already loaded, skipped in %llu us\n",
+                fpga_file, (unsigned long long)img->hash,
+                (unsigned long long)last_stat.total_us);
+        return FPGA_OK;
+    }
+
+    /* the PL content is undefined until the write succeeds */
+    rp_bazaar_fpga_invalidate();
+
+    t = fpga_time_us();
+    last_stat.from_ram = (img->data != NULL);
+    ret = fpga_write_image(fpga_file, dev, img);
+    last_stat.load_us  = fpga_time_us() - t;
+    last_stat.total_us = fpga_time_us() - start;
+    if(ret != FPGA_OK)
+        return ret;
+
+    loaded_hash  = img->hash;
+    loaded_size  = img->size;
+    loaded_valid = 1;
+    fpga_write_state();
+
+    fprintf(stderr, "FPGA %s (%016llx, %llu bytes) loaded%s: hash %llu us, "
+            "load %llu us, total %llu us\n", fpga_file,
+            (unsigned long long)img->hash, (unsigned long long)img->size,
+            last_stat.from_ram ? " from RAM" : "",
+            (unsigned long long)last_stat.hash_us,
+            (unsigned long long)last_stat.load_us,
+            (unsigned long long)last_stat.total_us);
+
+    return FPGA_OK;
+}
+
+
+void rp_bazaar_fpga_set_cache(size_t max_bytes)
+{
+    cache_max = max_bytes;
+    /* evict whatever no longer fits under the new limit */
+    fpga_cache_reserve(0);
+}
+
+
+void rp_bazaar_fpga_set_paths(const char *state, const char *done)
+{
+    if(state) {
+        strncpy(state_file, state, PATH_MAX - 1);
+        loaded_valid = 0;
+    }
+    if(done) {
+        strncpy(prog_done, done, PATH_MAX - 1);
+    }
+}
+
+
+void rp_bazaar_fpga_invalidate(void)
+{
+    loaded_valid = 0;
+    unlink(state_file);
+}
+
+
+void rp_bazaar_fpga_cleanup(void)
+{
+    int i;
+
+    for(i = 0; i < FPGA_IMAGES_NUM; i++) {
+        fpga_drop_data(&images[i]);
+        images[i].path[0] = '\0';
+    }
+    loaded_valid = 0;
+}
+
+
+const rp_fpga_load_stat_t *rp_bazaar_fpga_get_last_stat(void)
+{
+    return &last_stat;
+}
@@ -20,13 +20,46 @@
 #include "ngx_http_rp_module.h"
 #include "rp_data_cmd.h"
 #include "cJSON.h"
+#include "rp_json_writer.h"
+
+#include <time.h>
+#include <math.h>
 
 /* last good result container */
 static float **rp_signals = NULL;
-static int     rp_signals_dirty = 0;
+static int     rp_signals_num = 0;
+static int     rp_signals_len = 0;
+/* cleared when sending the signals failed, nothing to re-send at start */
+static int     rp_signals_dirty = 1;
 
 #define TRACE(args...) fprintf(stderr, args)
 
+/* size of the last good result container */
+#define RP_DATA_SIG_NUM       3
+#define RP_DATA_SIG_LEN       2048
+/* TODO: Make it configurable */
+#define RP_DATA_WAIT_MS       200
+/* rp_get_signals() polling period for applications without a signals fd */
+#define RP_DATA_POLL_MS       1
+/* number of GET requests between two statistics log entries */
+#define RP_DATA_STATS_PERIOD  256
+
+static const char *c_bin_content_str = "application/octet-stream";
+static const char *c_data_format_str[RP_DATA_FORMAT_NUM] = {
+    "json", "f32", "i16"
+};
+
+/* GET /data request latency & response size statistics, per format */
+typedef struct rp_data_stats_s {
+    ngx_uint_t requests;
+    uint64_t   bytes;
+    uint64_t   wait_us;
+    uint64_t   time_us;
+    uint64_t   max_us;
+} rp_data_stats_t;
+
+static rp_data_stats_t rp_data_stats[RP_DATA_FORMAT_NUM];
+
 
 /*----------------------------------------------------------------------------*/
 /* request private context, used to shared data between different callback functions
@@ -35,8 +68,119 @@ static int     rp_signals_dirty = 0;
 typedef struct rp_data_ctx_s {
     cJSON *json_root;
     int    finalize_on_post_handler;
+
+    /* GET: response format and statistics */
+    ngx_http_request_t *r;
+    rp_data_format_t    format;
+    uint64_t            start_us;
+    uint64_t            wait_us;
+    off_t               sent;
+    /* GET: parked in rp_data_waiting until new signals or timeout */
+    ngx_event_t         timeout;
+    ngx_queue_t         queue;
+    unsigned            waiting:1;
 } rp_data_ctx_t;
 
+/* GET requests waiting for new signals */
+static ngx_queue_t       rp_data_waiting;
+static int               rp_data_waiting_init = 0;
+/* application's signals fd on the event loop, NULL if it has none */
+static ngx_connection_t *rp_data_notify = NULL;
+/* polls rp_get_signals() for applications without a signals fd */
+static ngx_event_t       rp_data_poll_ev;
+
+static int rp_data_fetch_signals(void);
+static ngx_int_t rp_data_send_signals(ngx_http_request_t *r,
+                                      rp_data_ctx_t *ctx, int ret_val);
+static ngx_int_t rp_data_send_binary(ngx_http_request_t *r,
+                                     rp_data_format_t format, int ret_val);
+static ngx_int_t rp_data_send_json(ngx_http_request_t *r, int signals,
+                                   int ret_val);
+static ngx_int_t rp_data_wait(ngx_http_request_t *r, rp_data_ctx_t *ctx);
+
+
+/*----------------------------------------------------------------------------*/
+static uint64_t rp_data_time_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/*----------------------------------------------------------------------------*/
+static int rp_data_arg_equals(ngx_http_request_t *r, const char *name,
+                              const char *value)
+{
+    ngx_str_t arg;
+
+    if(ngx_http_arg(r, (u_char *)name, strlen(name), &arg) != NGX_OK) {
+        return 0;
+    }
+    return (arg.len == strlen(value)) &&
+        (ngx_strncmp(arg.data, value, arg.len) == 0);
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Returns the response format requested with 'format' GET argument.
+ *
+ * Unknown or missing format falls back to the (legacy) JSON response.
+ */
+static rp_data_format_t rp_data_get_format(ngx_http_request_t *r)
+{
+    int i;
+
+    for(i = RP_DATA_FORMAT_JSON + 1; i < RP_DATA_FORMAT_NUM; i++) {
+        if(rp_data_arg_equals(r, "format", c_data_format_str[i])) {
+            return (rp_data_format_t)i;
+        }
+    }
+    return RP_DATA_FORMAT_JSON;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Accounts one GET request in the per-format statistics.
+ *
+ * Bytes are taken from the connection counter, so they include the HTTP
+ * header and reflect the compressed size when gzip was used. Averages are
+ * logged (notice level) every RP_DATA_STATS_PERIOD requests.
+ */
+static void rp_data_update_stats(ngx_http_request_t *r,
+                                 rp_data_format_t format,
+                                 uint64_t start_us, off_t sent,
+                                 uint64_t wait_us)
+{
+    rp_data_stats_t *s = &rp_data_stats[format];
+    uint64_t time_us = rp_data_time_us() - start_us;
+    uint64_t bytes = r->connection->sent - sent;
+
+    rp_debug(r->connection->log, "/data %s: %uL bytes in %uL us "
+             "(waited %uL us)", c_data_format_str[format], bytes, time_us,
+             wait_us);
+
+    s->requests++;
+    s->bytes   += bytes;
+    s->wait_us += wait_us;
+    s->time_us += time_us;
+    if(time_us > s->max_us) {
+        s->max_us = time_us;
+    }
+
+    if(s->requests == RP_DATA_STATS_PERIOD) {
+        rp_notice(r->connection->log, "/data %s: %ui requests, avg %uL us "
+                  "(max %uL us, avg wait %uL us), avg %uL bytes",
+                  c_data_format_str[format], s->requests,
+                  s->time_us / s->requests, s->max_us,
+                  s->wait_us / s->requests, s->bytes / s->requests);
+        ngx_memzero(s, sizeof(rp_data_stats_t));
+    }
+}
+
 
 /*----------------------------------------------------------------------------*/
 /**
@@ -47,13 +191,14 @@ typedef struct rp_data_ctx_s {
  *
  * @retval NGX_HTTP_NOT_ALLOWED            The required operation is not allowed
  * @retval NGX_HTTP_INTERNAL_SERVER_ERROR  Failure while allocating JSON package
- * @retval other                           GET: returned value from rp_module_send_response() function
+ * @retval other                           GET: returned value from rp_data_send_json() function,
+ *                                         NGX_DONE if the request waits for new signals (rp_data_wait())
  *                                         POST: returned value from ngx_http_read_client_request_body() or NGX_DONE
  */
 
 ngx_int_t rp_data_cmd_handler(ngx_http_request_t *r)
 {
-    cJSON *json_root, *data_root, *app_root;
+    rp_data_ctx_t *ctx;
     int ret_val = 0;
 
     if(!(r->method & (NGX_HTTP_GET|NGX_HTTP_POST))) {
@@ -63,53 +208,27 @@ ngx_int_t rp_data_cmd_handler(ngx_http_request_t *r)
     rp_debug(r->connection->log, "%s: %s", __FUNCTION__,
              (r->method & NGX_HTTP_GET) ? "GET" : "POST");
 
-    json_root = cJSON_CreateObject(r->pool);
-    if(json_root == NULL) {
-        rp_error(r->connection->log, "Can not allocate cJSON object");
-        return NGX_HTTP_INTERNAL_SERVER_ERROR;
-    }
-
-    cJSON_AddItemToObject(json_root, "app",
-                          app_root=cJSON_CreateObject(r->pool), r->pool);
-    if(app_root == NULL) {
-        rp_error(r->connection->log, "Can not allocate cJSON object");
-        return NGX_HTTP_INTERNAL_SERVER_ERROR;
-    }
-
-    cJSON_AddItemToObject(json_root, "datasets",
-                          data_root=cJSON_CreateObject(r->pool), r->pool);
-    if(data_root == NULL) {
-        rp_error(r->connection->log, "Can not allocate cJSON object");
-        return NGX_HTTP_INTERNAL_SERVER_ERROR;
-    }
-
     if(!rp_module_ctx.app.handle) {
         rp_error(r->connection->log, "Application not loaded");
-        rp_module_cmd_error(&json_root, "Application not loaded", NULL, 
-                            r->pool);
-        return rp_module_send_response(r, &json_root);
+        return rp_data_send_json(r, 0, 0);
     }
 
-    char *app_id = rp_module_ctx.app.id;
-    if (!app_id) {
-        app_id = "unknown";
-    }
-    cJSON_AddItemToObject(app_root, "id",
-                          cJSON_CreateString(app_id, r->pool), r->pool);
-    
     if(r->method & NGX_HTTP_POST) {
         /* we continue with the answer in rp_data_post_read. the
-         * json package into which the answer is stored is passed
+         * json package into which errors are stored is passed
          * through request private buffer.
          */
         ngx_int_t rc;
-        rp_data_ctx_t *ctx;
 
         ctx = ngx_pcalloc(r->pool, sizeof(rp_data_ctx_t));
         if (ctx == NULL) {
               return NGX_ERROR;
         }
-        ctx->json_root = json_root;
+        ctx->json_root = cJSON_CreateObject(r->pool);
+        if(ctx->json_root == NULL) {
+            rp_error(r->connection->log, "Can not allocate cJSON object");
+            return NGX_HTTP_INTERNAL_SERVER_ERROR;
+        }
         ctx->finalize_on_post_handler = 0;
         ngx_http_set_ctx(r, ctx, ngx_http_rp_module);
 
@@ -121,15 +240,33 @@ ngx_int_t rp_data_cmd_handler(ngx_http_request_t *r)
         return rc;
     }
 
-    ret_val = rp_data_get_signals(r, &json_root);
-    rp_data_get_params(r, &json_root);
+    ctx = ngx_pcalloc(r->pool, sizeof(rp_data_ctx_t));
+    if(ctx == NULL) {
+        return NGX_HTTP_INTERNAL_SERVER_ERROR;
+    }
+    ctx->r         = r;
+    ctx->start_us  = rp_data_time_us();
+    ctx->sent      = r->connection->sent;
+    ngx_http_set_ctx(r, ctx, ngx_http_rp_module);
+
+#if (NGX_HTTP_GZIP)
+    /* gzip costs CPU time on the board, only clients asking for it get it */
+    if(!rp_data_arg_equals(r, "gzip", "1")) {
+        r->gzip_tested = 1;
+        r->gzip_ok = 0;
+    }
+#endif
 
-    if(ret_val == 0) {
-        rp_module_cmd_ok(&json_root, r->pool);
-    } else {
-        rp_module_cmd_again(&json_root, r->pool);
+    ctx->format = rp_data_get_format(r);
+
+    ret_val = rp_data_fetch_signals();
+    if((ret_val == -1) && (rp_data_wait(r, ctx) == NGX_OK)) {
+        /* answered from the event loop, the handler keeps the request */
+        r->main->count++;
+        return NGX_DONE;
     }
-    return rp_module_send_response(r,  &json_root);
+
+    return rp_data_send_signals(r, ctx, ret_val);
 }
 
 
@@ -280,14 +417,8 @@ void rp_data_post_read(ngx_http_request_t *r)
         goto done;
     }
 
-    /* modify json package to return all actual parameters to the client */
-    rp_data_get_params(r, &ctx->json_root);
-
-    /* append succesful flag to the json package */
-    rp_module_cmd_ok(&ctx->json_root, r->pool);
-
-    /* and send the response to the client */
-    rp_module_send_response(r, &ctx->json_root);
+    /* return all actual parameters to the client */
+    rp_data_send_json(r, 0, 0);
 done:
     if (ctx->finalize_on_post_handler) {
         ngx_http_finalize_request(r, NGX_DONE);
@@ -368,111 +499,567 @@ int rp_data_parse_and_set_params(cJSON *params_root)
 
 
 /*----------------------------------------------------------------------------*/
-int rp_data_get_params(ngx_http_request_t *r, cJSON **json_root)
+/**
+ * @brief Copies the latest signals from the application into rp_signals.
+ *
+ * Never blocks, the number and length of the signals are kept in
+ * rp_signals_num & rp_signals_len. When there are no new signals the GET
+ * request is parked with rp_data_wait().
+ *
+ * @retval     0        new signals (or old ones, re-sent after a failed send)
+ * @retval    -1        old signals
+ * @retval    -2        signals not finished yet
+ * @retval    -3        out of memory
+ */
+static int rp_data_fetch_signals(void)
 {
-    rp_app_params_t *rp_params = NULL;
-    int rp_params_cnt;
-    cJSON *j_params, *data_root;
-    int i;
-    
-    data_root = cJSON_GetObjectItem(*json_root, "datasets");
-    if(data_root == NULL) {
-        return rp_module_cmd_error(json_root, 
-                                   "Can not find 'data'", NULL, 
-                                   r->pool);
+    int ret_val;
+
+    if(rp_signals == NULL) {
+        int i;
+        rp_signals = (float **)calloc(RP_DATA_SIG_NUM, sizeof(float *));
+        if(rp_signals == NULL) {
+            return -3;
+        }
+        for(i = 0; i < RP_DATA_SIG_NUM; i++) {
+            rp_signals[i] = (float *)malloc(RP_DATA_SIG_LEN * sizeof(float));
+            if(rp_signals[i] == NULL) {
+                for(; i >= 0; i--) {
+                    free(rp_signals[i]);
+                }
+                free(rp_signals);
+                rp_signals = NULL;
+                return -3;
+            }
+        }
+    }
+
+    rp_signals_num = 0;
+    rp_signals_len = 0;
+    ret_val =
+        rp_module_ctx.app.get_signals_func((float ***)&rp_signals,
+                                           &rp_signals_num, &rp_signals_len);
+
+    /* In case we are repeating the transmission */
+    if((rp_signals_dirty == 0) && (ret_val == -1))
+        ret_val = 0;
+    rp_signals_dirty = 1;
+
+    if(rp_signals_num > RP_DATA_SIG_NUM)
+        rp_signals_num = RP_DATA_SIG_NUM;
+    if(rp_signals_len > RP_DATA_SIG_LEN)
+        rp_signals_len = RP_DATA_SIG_LEN;
+
+    return ret_val;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Sends the fetched signals & parameters in the requested format.
+ *
+ * @param[in]  r        HTTP request as defined by NGINX framework
+ * @param[in]  ctx      request context
+ * @param[in]  ret_val  result of rp_data_fetch_signals()
+ * @retval     other    returned value from rp_data_send_json() or
+ *                      rp_data_send_binary() function
+ */
+static ngx_int_t rp_data_send_signals(ngx_http_request_t *r,
+                                      rp_data_ctx_t *ctx, int ret_val)
+{
+    ngx_int_t rc;
+
+    if(ctx->format != RP_DATA_FORMAT_JSON) {
+        rc = rp_data_send_binary(r, ctx->format, ret_val);
+    } else {
+        rc = rp_data_send_json(r, 1, ret_val);
+    }
+
+    rp_data_update_stats(r, ctx->format, ctx->start_us, ctx->sent,
+                         ctx->wait_us);
+    return rc;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Answers a parked GET request and releases it.
+ */
+static void rp_data_wait_done(rp_data_ctx_t *ctx, int ret_val)
+{
+    ngx_http_request_t *r = ctx->r;
+
+    ngx_queue_remove(&ctx->queue);
+    ctx->waiting = 0;
+    if(ctx->timeout.timer_set) {
+        ngx_del_timer(&ctx->timeout);
+    }
+    ctx->wait_us = rp_data_time_us() - ctx->start_us;
+
+    ngx_http_finalize_request(r, rp_data_send_signals(r, ctx, ret_val));
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Answers all parked GET requests with the same (just fetched) signals.
+ */
+static void rp_data_wait_done_all(int ret_val)
+{
+    while(!ngx_queue_empty(&rp_data_waiting)) {
+        rp_data_wait_done(ngx_queue_data(ngx_queue_head(&rp_data_waiting),
+                                         rp_data_ctx_t, queue), ret_val);
     }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Fetches the signals when the application may have new ones.
+ *
+ * Spurious wake-ups (nothing new yet) leave the requests parked.
+ */
+static void rp_data_signals_ready(void)
+{
+    int ret_val;
+
+    if(ngx_queue_empty(&rp_data_waiting)) {
+        return;
+    }
+    ret_val = rp_data_fetch_signals();
+    if(ret_val != -1) {
+        rp_data_wait_done_all(ret_val);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/* Read handler of the application's signals fd */
+static void rp_data_notify_handler(ngx_event_t *ev)
+{
+    ngx_connection_t *c = ev->data;
+    u_char buf[64];
+
+    /* eventfd counter or pipe bytes, only the notification itself matters */
+    while(read(c->fd, buf, sizeof(buf)) > 0);
+
+    if(ngx_handle_read_event(ev, 0) != NGX_OK) {
+        rp_error(ev->log, "Can not re-arm application signals event");
+    }
+    rp_data_signals_ready();
+}
+
+
+/*----------------------------------------------------------------------------*/
+/* Poll timer for applications without a signals fd */
+static void rp_data_poll_handler(ngx_event_t *ev)
+{
+    rp_data_signals_ready();
+    if(!ngx_queue_empty(&rp_data_waiting)) {
+        ngx_add_timer(ev, RP_DATA_POLL_MS);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/* Request waited RP_DATA_WAIT_MS, it gets the old signals */
+static void rp_data_timeout_handler(ngx_event_t *ev)
+{
+    rp_data_ctx_t *ctx = ev->data;
+    int ret_val;
+
+    ret_val = rp_data_fetch_signals();
+    if(ret_val != -1) {
+        /* new ones just arrived, they are for everybody waiting */
+        rp_data_wait_done_all(ret_val);
+    } else {
+        rp_data_wait_done(ctx, ret_val);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/* Request pool cleanup, a request terminated while parked leaves the queue */
+static void rp_data_wait_cleanup(void *data)
+{
+    rp_data_ctx_t *ctx = data;
+
+    if(ctx->waiting) {
+        ngx_queue_remove(&ctx->queue);
+        ctx->waiting = 0;
+    }
+    if(ctx->timeout.timer_set) {
+        ngx_del_timer(&ctx->timeout);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Adds the application's signals fd to the event loop.
+ *
+ * The fd is owned by the application, it only has to become readable when
+ * new signals are set. Without it (or on failure) parked requests are polled.
+ */
+static void rp_data_notify_attach(void)
+{
+    ngx_connection_t *c;
+    int fd;
+
+    fd = rp_module_ctx.app.get_signals_fd_func();
+    if(fd < 0) {
+        return;
+    }
+    if(ngx_nonblocking(fd) == -1) {
+        rp_error(rp_module_ctx.log, "Can not set signals fd non-blocking");
+        return;
+    }
+
+    c = ngx_get_connection(fd, rp_module_ctx.log);
+    if(c == NULL) {
+        return;
+    }
+    c->read->handler = rp_data_notify_handler;
+    c->read->log = rp_module_ctx.log;
+
+    if(ngx_handle_read_event(c->read, 0) != NGX_OK) {
+        rp_error(rp_module_ctx.log, "Can not add signals fd to event loop");
+        ngx_free_connection(c);
+        return;
+    }
+    rp_data_notify = c;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Parks a GET request until new signals or RP_DATA_WAIT_MS.
+ *
+ * The worker keeps serving other requests meanwhile. Requests are woken by
+ * the application's rp_get_signals_fd() becoming readable, applications
+ * without it are polled every RP_DATA_POLL_MS from a timer.
+ *
+ * @param[in]  r    HTTP request as defined by NGINX framework
+ * @param[in]  ctx  request context
+ * @retval     NGX_OK     request is parked, the caller must return NGX_DONE
+ * @retval     NGX_ERROR  request can not wait, answer it right away
+ */
+static ngx_int_t rp_data_wait(ngx_http_request_t *r, rp_data_ctx_t *ctx)
+{
+    ngx_pool_cleanup_t *cln;
+
+    if(!rp_data_waiting_init) {
+        ngx_queue_init(&rp_data_waiting);
+        rp_data_waiting_init = 1;
+    }
+    if((rp_data_notify == NULL) && rp_module_ctx.app.get_signals_fd_func) {
+        rp_data_notify_attach();
+    }
+
+    cln = ngx_pool_cleanup_add(r->pool, 0);
+    if(cln == NULL) {
+        return NGX_ERROR;
+    }
+    cln->handler = rp_data_wait_cleanup;
+    cln->data    = ctx;
+
+    ctx->timeout.handler = rp_data_timeout_handler;
+    ctx->timeout.data    = ctx;
+    ctx->timeout.log     = r->connection->log;
+    ngx_add_timer(&ctx->timeout, RP_DATA_WAIT_MS);
+
+    ngx_queue_insert_tail(&rp_data_waiting, &ctx->queue);
+    ctx->waiting = 1;
+
+    if((rp_data_notify == NULL) && !rp_data_poll_ev.timer_set) {
+        rp_data_poll_ev.handler = rp_data_poll_handler;
+        rp_data_poll_ev.log     = rp_module_ctx.log;
+        ngx_add_timer(&rp_data_poll_ev, RP_DATA_POLL_MS);
+    }
+    return NGX_OK;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Answers parked requests and detaches from the application.
+ *
+ * Must be called before the application is unloaded, its signals fd is
+ * closed by rp_app_exit().
+ */
+void rp_data_app_unload(void)
+{
+    if(rp_data_waiting_init && !ngx_queue_empty(&rp_data_waiting)) {
+        rp_data_wait_done_all(rp_data_fetch_signals());
+    }
+    if(rp_data_poll_ev.timer_set) {
+        ngx_del_timer(&rp_data_poll_ev);
+    }
+    if(rp_data_notify) {
+        if(rp_data_notify->read->active) {
+            ngx_del_event(rp_data_notify->read, NGX_READ_EVENT, 0);
+        }
+        if(rp_data_notify->read->posted) {
+            ngx_delete_posted_event(rp_data_notify->read);
+        }
+        ngx_free_connection(rp_data_notify);
+        rp_data_notify->fd = (ngx_socket_t) -1;
+        rp_data_notify = NULL;
+    }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/* "status":"ERROR" & "reason" members, as rp_module_cmd_error() adds them */
+static void rp_data_write_error(rp_json_writer_t *w, const char *reason)
+{
+    rp_json_string(w, "status", "ERROR");
+    rp_json_string(w, "reason", reason);
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Writes the application parameters as "params" object.
+ *
+ * @retval     0        success
+ * @retval    -1        application did not return its parameters
+ */
+static int rp_data_write_params(rp_json_writer_t *w)
+{
+    rp_app_params_t *rp_params = NULL;
+    int rp_params_cnt, i;
 
-    /* Now prepare the answer with set parameters */
     rp_params_cnt = rp_module_ctx.app.get_params_func(&rp_params);
     if(rp_params == NULL) {
-        return rp_module_cmd_error(json_root, "Can not retrieve parameters.",
-                                   NULL, r->pool);
+        return -1;
     }
 
-    cJSON_AddItemToObject(data_root, "params",
-                          j_params=cJSON_CreateObject(r->pool), r->pool);
-
+    rp_json_object_begin(w, "params");
     for(i = 0; i < rp_params_cnt; i++) {
-        cJSON_AddItemToObject(j_params, rp_params[i].name,
-                              cJSON_CreateNumber(rp_params[i].value, r->pool), 
-                              r->pool);
+        rp_json_number(w, rp_params[i].name, rp_params[i].value);
     }
+    rp_json_object_end(w);
 
     for(i = 0; i < rp_params_cnt; i++) {
         if(rp_params[i].name)
             free((char *)rp_params[i].name);
     }
-    if(rp_params)
-        free(rp_params);
+    free(rp_params);
 
     return 0;
 }
 
 
 /*----------------------------------------------------------------------------*/
-int rp_data_get_signals(ngx_http_request_t *r, cJSON **json_root)
+/**
+ * @brief Sends the JSON response of GET & POST /data.
+ *
+ * The response is written in one pass straight into the pool buffers which
+ * are sent, there is no cJSON tree:
+ * {"app":{"id":..},"datasets":{"g1":[{"data":[[x,y],..]},{"data":..}],
+ *  "params":{..}},"status":..}
+ *
+ * @param[in]  r        HTTP request as defined by NGINX framework
+ * @param[in]  signals  1 to include the last fetched signals (GET)
+ * @param[in]  ret_val  result of rp_data_fetch_signals(), 0 for POST
+ * @retval     other    returned value from rp_module_send_chain() function
+ */
+static ngx_int_t rp_data_send_json(ngx_http_request_t *r, int signals,
+                                   int ret_val)
 {
-    int rp_sig_num, rp_sig_len, ret_val;
-    cJSON *data_root, *sig_root, *d1, *d2, *g1;
-    /* TODO: Make it configurable */
-    int retries = 200; /* Approx in [ms] */
+    rp_json_writer_t w;
+    ngx_chain_t *out;
+    size_t len;
+    int loaded = (rp_module_ctx.app.handle != NULL), params = -1, i;
+    ngx_int_t rc;
+
+    rp_json_init(&w, r->pool, 0);
+    rp_json_object_begin(&w, NULL);
+
+    rp_json_object_begin(&w, "app");
+    if(loaded) {
+        rp_json_string(&w, "id", rp_module_ctx.app.id ? rp_module_ctx.app.id :
+                                                        "unknown");
+    }
+    rp_json_object_end(&w);
+
+    rp_json_object_begin(&w, "datasets");
+    if(loaded && signals && (ret_val != -3)) {
+        /* time base against each of the other two signals */
+        rp_json_array_begin(&w, "g1");
+        for(i = 1; i < RP_DATA_SIG_NUM; i++) {
+            rp_json_object_begin(&w, NULL);
+            rp_json_float_pairs(&w, "data", rp_signals[0], rp_signals[i],
+                                rp_signals_len);
+            rp_json_object_end(&w);
+        }
+        rp_json_array_end(&w);
+    }
+    if(loaded) {
+        params = rp_data_write_params(&w);
+    }
+    rp_json_object_end(&w);
 
-    if(rp_signals == NULL) {
-        int i;
-        rp_signals = (float **)malloc(3 * sizeof(float *));
-        for(i = 0; i < 3; i++) {
-            rp_signals[i] = (float *)malloc(2048 * sizeof(float));
+    if(!loaded) {
+        rp_data_write_error(&w, "Application not loaded");
+    } else {
+        if(ret_val == -3) {
+            rp_data_write_error(&w, "Can not allocate signals");
+        }
+        if(params < 0) {
+            rp_data_write_error(&w, "Can not retrieve parameters.");
+        }
+        if(ret_val == 0) {
+            rp_json_string(&w, "status", "OK");
+        } else if(ret_val != -3) {
+            rp_json_string(&w, "status", "AGAIN");
         }
     }
+    rp_json_object_end(&w);
 
-    data_root = cJSON_GetObjectItem(*json_root, "datasets");
-    if(data_root == NULL) {
-        return rp_module_cmd_error(json_root, 
-                                   "Can not find 'data'", NULL, 
-                                   r->pool);
+    out = rp_json_finish(&w, &len);
+    if(out == NULL) {
+        rp_error(r->connection->log, "Creating output buffer failed");
+        return NGX_HTTP_INTERNAL_SERVER_ERROR;
     }
-    
-    ret_val =
-        rp_module_ctx.app.get_signals_func((float ***)&rp_signals, &rp_sig_num, 
-                                           &rp_sig_len);
-
-    while(ret_val == -1) {
-        ret_val =
-            rp_module_ctx.app.get_signals_func((float ***)&rp_signals, 
-                                               &rp_sig_num, &rp_sig_len);
-
-        if(ret_val == -2) 
-            break;
-        if(retries-- <= 0) {
-            /* Use old signals */
-            break;
+
+    rc = rp_module_send_chain(r, json_content_str, out, len);
+
+    /* If error while sending OK output we re-send it */
+    if((rc == NGX_ERROR) && signals && loaded && (ret_val == 0)) {
+        rp_data_clear_signals_dirty();
+    }
+    return rc;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Quantizes one signal to 16 bits over its own min/max range.
+ *
+ * @param[in]  src     signal samples
+ * @param[in]  len     number of samples
+ * @param[out] dst     quantized samples, src ~= dst * scale + offset
+ * @param[out] scale   column scale
+ * @param[out] offset  column offset
+ */
+static void rp_data_quantize(const float *src, int len, int16_t *dst,
+                             float *scale, float *offset)
+{
+    float min = src[0], max = src[0], inv;
+    int i;
+
+    for(i = 1; i < len; i++) {
+        if(src[i] < min)
+            min = src[i];
+        if(src[i] > max)
+            max = src[i];
+    }
+
+    *offset = (max + min) / 2;
+    *scale  = (max - min) / 65534.0f;
+    inv     = (*scale > 0) ? 1.0f / *scale : 0.0f;
+
+    for(i = 0; i < len; i++) {
+        dst[i] = (int16_t)lrintf((src[i] - *offset) * inv);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Sends signals and parameters as a binary response.
+ *
+ * The layout is described next to rp_data_bin_hdr_t in rp_data_cmd.h. The
+ * header, the parameters JSON and the samples are written one after another
+ * into the pool buffers of a JSON writer, nothing is copied afterwards.
+ *
+ * @param[in]  r        HTTP request as defined by NGINX framework
+ * @param[in]  format   RP_DATA_FORMAT_F32 or RP_DATA_FORMAT_I16
+ * @param[in]  ret_val  result of rp_data_fetch_signals()
+ * @retval     other    returned value from rp_module_send_chain() function
+ */
+static ngx_int_t rp_data_send_binary(ngx_http_request_t *r,
+                                     rp_data_format_t format, int ret_val)
+{
+    rp_data_bin_hdr_t *hdr;
+    rp_json_writer_t w;
+    ngx_chain_t *out;
+    float *scale, *offset;
+    u_char *pad, *data;
+    size_t json_start, json_len, json_pad, elem_size, data_offset, len;
+    int sig_num = rp_signals_num, sig_len = rp_signals_len, i;
+    ngx_int_t rc;
+
+    if(ret_val == -3) {
+        rp_error(r->connection->log, "Can not allocate signals");
+        return NGX_HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    rp_json_init(&w, r->pool, 0);
+    hdr = (rp_data_bin_hdr_t *)rp_json_alloc(&w, sizeof(rp_data_bin_hdr_t) +
+                                             2 * sig_num * sizeof(float));
+    if(hdr == NULL) {
+        rp_error(r->connection->log, "Can not allocate memory");
+        return NGX_HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+    json_start = rp_json_length(&w);
+    rp_json_object_begin(&w, NULL);
+    rp_json_object_begin(&w, "datasets");
+    if(rp_data_write_params(&w) < 0) {
+        rp_json_object_end(&w);
+        rp_data_write_error(&w, "Can not retrieve parameters.");
+    } else {
+        rp_json_object_end(&w);
+    }
+    rp_json_object_end(&w);
+    json_len = rp_json_length(&w) - json_start;
+    json_pad = (json_len + 3) & ~3;
+
+    pad         = rp_json_alloc(&w, json_pad - json_len);
+    data_offset = rp_json_length(&w);
+    elem_size   = (format == RP_DATA_FORMAT_I16) ? sizeof(int16_t) :
+                                                   sizeof(float);
+    data        = rp_json_alloc(&w, (size_t)sig_num * sig_len * elem_size);
+    out         = rp_json_finish(&w, &len);
+    if((pad == NULL) || (data == NULL) || (out == NULL)) {
+        rp_error(r->connection->log, "Can not allocate memory");
+        return NGX_HTTP_INTERNAL_SERVER_ERROR;
+    }
+    ngx_memset(pad, ' ', json_pad - json_len);
+
+    hdr->magic       = RP_DATA_BIN_MAGIC;
+    hdr->version     = RP_DATA_BIN_VERSION;
+    hdr->format      = format;
+    hdr->status      = (ret_val == 0) ? 0 : 1;
+    hdr->sig_num     = sig_num;
+    hdr->sig_len     = sig_len;
+    hdr->json_len    = json_len;
+    hdr->data_offset = data_offset;
+
+    scale  = (float *)(hdr + 1);
+    offset = scale + sig_num;
+    for(i = 0; i < sig_num; i++) {
+        if(format == RP_DATA_FORMAT_I16) {
+            rp_data_quantize(rp_signals[i], sig_len, (int16_t *)data,
+                             &scale[i], &offset[i]);
         } else {
-            usleep(1000);
+            ngx_memcpy(data, rp_signals[i], sig_len * sizeof(float));
+            scale[i]  = 1.0f;
+            offset[i] = 0.0f;
         }
+        data += sig_len * elem_size;
     }
-    ret_val = ret_val;
-    /* In case we are repeating the transmission */
-    if((rp_signals_dirty == 0) && (ret_val == -1))
-        ret_val = 0;
-    rp_signals_dirty = 1;
 
-    cJSON_AddItemToObject(data_root, "g1",
-                          g1=cJSON_CreateArray(r->pool), r->pool);
-
-    cJSON_AddItemToObject(g1, "g1", 
-                          sig_root=cJSON_CreateObject(r->pool), r->pool);
-    cJSON_AddItemToObject(sig_root, "data",
-                   d1=cJSON_Create2dFloatArray(&rp_signals[0][0], &rp_signals[1][0],
-                                               rp_sig_len, r->pool),
-                          r->pool);
-    cJSON_AddItemToObject(g1, "g1", 
-                          sig_root=cJSON_CreateObject(r->pool), r->pool);
-    cJSON_AddItemToObject(sig_root, "data",
-                   d2=cJSON_Create2dFloatArray(&rp_signals[0][0], &rp_signals[2][0],
-                                               rp_sig_len, r->pool),
-                          r->pool);
+    rc = rp_module_send_chain(r, c_bin_content_str, out, len);
 
-    return ret_val;
+    /* If error while sending OK output we re-send it */
+    if((rc == NGX_ERROR) && (hdr->status == 0)) {
+        rp_data_clear_signals_dirty();
+    }
+    return rc;
 }
 
 /*----------------------------------------------------------------------------*/
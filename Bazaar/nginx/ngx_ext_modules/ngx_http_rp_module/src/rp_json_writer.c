@@ -0,0 +1,400 @@
+/**
+ * $Id$
+ *
+ * @brief Red Pitaya Nginx module - streaming JSON writer.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <ngx_config.h>
+#include <ngx_core.h>
+
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+
+#include "rp_json_writer.h"
+
+static const char rp_json_digits[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233"
+    "34353637383940414243444546474849505152535455565758596061626364656667"
+    "6869707172737475767778798081828384858687888990919293949596979899";
+
+/* 10^k, k = 0..12, exact in a double */
+static const double rp_json_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12
+};
+
+
+/*----------------------------------------------------------------------------*/
+/* Writes n (< 10000) as 4 digits */
+static u_char *rp_json_print_4(u_char *p, uint32_t n)
+{
+    ngx_memcpy(p, &rp_json_digits[2 * (n / 100)], 2);
+    ngx_memcpy(p + 2, &rp_json_digits[2 * (n % 100)], 2);
+    return p + 4;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Renders |d| < 1e9 as "%.04f".
+ *
+ * A float scaled by 1e4 is exact in a double, so rint() rounds the same way
+ * as the C library does. The integral and the fractional part are split in
+ * double, so there is no 64-bit division (a library call on ARM).
+ */
+static u_char *rp_json_print_fixed(u_char *p, double d)
+{
+    double   v = rint(fabs(d) * 10000.0), rest;
+    uint32_t ip = (uint32_t)(v * 1e-4);
+    u_char   tmp[10], *t = tmp + sizeof(tmp);
+
+    rest = v - (double)ip * 10000.0;
+    if(rest < 0) {
+        ip--;
+        rest += 10000.0;
+    } else if(rest >= 10000.0) {
+        ip++;
+        rest -= 10000.0;
+    }
+
+    if(signbit(d)) {
+        *p++ = '-';
+    }
+    do {
+        *--t = '0' + ip % 10;
+        ip /= 10;
+    } while(ip);
+    p = ngx_cpymem(p, t, tmp + sizeof(tmp) - t);
+    *p++ = '.';
+    return rp_json_print_4(p, (uint32_t)rest);
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Renders a float 1e-8 <= |d| < 1e-2 as "%.04e".
+ *
+ * The mantissa is |d| * 10^k, k <= 12, which is exact for a float, rounded
+ * with rint() like the C library rounds the exact decimal value.
+ */
+static u_char *rp_json_print_exp(u_char *p, double d)
+{
+    double a = fabs(d), m;
+    int    e = -3;   /* decimal exponent of the first digit */
+
+    while((e > -8) && (a * rp_json_pow10[-e] < 1.0)) {
+        e--;
+    }
+    m = rint(a * rp_json_pow10[4 - e]);
+    if(m >= 100000.0) {
+        e++;
+        m = rint(a * rp_json_pow10[4 - e]);
+    } else if(m < 10000.0) {
+        e--;
+        m = rint(a * rp_json_pow10[4 - e]);
+    }
+
+    if(signbit(d)) {
+        *p++ = '-';
+    }
+    *p++ = '0' + (uint32_t)m / 10000;
+    *p++ = '.';
+    p = rp_json_print_4(p, (uint32_t)m % 10000);
+    *p++ = 'e';
+    *p++ = (e < 0) ? '-' : '+';
+    ngx_memcpy(p, &rp_json_digits[2 * (e < 0 ? -e : e)], 2);
+    return p + 2;
+}
+
+
+/*----------------------------------------------------------------------------*/
+u_char *rp_json_print_sample(u_char *p, double d)
+{
+    if(fabs(floor(d) - d) <= DBL_EPSILON && fabs(d) < 1.0e60) {
+        if(fabs(d) < 1.0e9)
+            return rp_json_print_fixed(p, d);
+        return p + snprintf((char *)p, RP_JSON_SAMPLE_MAX, "%.04f", d);
+    }
+    if(fabs(d) < 1.0e-2 || fabs(d) > 1.0e9) {
+        /* exact scaling holds for float samples only */
+        if(fabs(d) >= 1.0e-8 && fabs(d) < 1.0e-2 && (double)(float)d == d)
+            return rp_json_print_exp(p, d);
+        return p + snprintf((char *)p, RP_JSON_SAMPLE_MAX, "%.04e", d);
+    }
+    if(isnan(d))
+        return p + snprintf((char *)p, RP_JSON_SAMPLE_MAX, "%.04f", d);
+    return rp_json_print_fixed(p, d);
+}
+
+
+/*----------------------------------------------------------------------------*/
+void rp_json_init(rp_json_writer_t *w, ngx_pool_t *pool, size_t chunk)
+{
+    ngx_memzero(w, sizeof(rp_json_writer_t));
+    w->pool  = pool;
+    w->chunk = chunk ? chunk : RP_JSON_CHUNK;
+    w->last  = &w->out;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Returns room for n contiguous bytes at the end of the output.
+ *
+ * A new chunk (or a bigger buffer for large n) is linked to the chain when
+ * the current one is too short. The caller advances w->buf->last.
+ */
+static u_char *rp_json_reserve(rp_json_writer_t *w, size_t n)
+{
+    ngx_chain_t *cl;
+
+    if(w->failed) {
+        return NULL;
+    }
+    if(w->buf && ((size_t)(w->buf->end - w->buf->last) >= n)) {
+        return w->buf->last;
+    }
+
+    cl = ngx_alloc_chain_link(w->pool);
+    if(cl == NULL) {
+        w->failed = 1;
+        return NULL;
+    }
+    cl->buf = ngx_create_temp_buf(w->pool, (n > w->chunk) ? n : w->chunk);
+    if(cl->buf == NULL) {
+        w->failed = 1;
+        return NULL;
+    }
+    cl->next = NULL;
+
+    if(w->buf) {
+        w->len += w->buf->last - w->buf->pos;
+    }
+    *w->last = cl;
+    w->last  = &cl->next;
+    w->buf   = cl->buf;
+    return w->buf->last;
+}
+
+
+/*----------------------------------------------------------------------------*/
+static void rp_json_write(rp_json_writer_t *w, const char *s, size_t n)
+{
+    u_char *p = rp_json_reserve(w, n);
+
+    if(p) {
+        w->buf->last = ngx_cpymem(p, s, n);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/* Escaped string, the same escapes as cJSON print_string_ptr() */
+static void rp_json_write_string(rp_json_writer_t *w, const char *s)
+{
+    const u_char *c;
+    u_char *p;
+
+    rp_json_write(w, "\"", 1);
+    for(c = (const u_char *)s; c && *c; c++) {
+        p = rp_json_reserve(w, 6);
+        if(p == NULL) {
+            return;
+        }
+        if((*c > 31) && (*c != '\"') && (*c != '\\')) {
+            *p++ = *c;
+        } else {
+            *p++ = '\\';
+            switch(*c) {
+            case '\\': *p++ = '\\'; break;
+            case '\"': *p++ = '\"'; break;
+            case '\b': *p++ = 'b';  break;
+            case '\f': *p++ = 'f';  break;
+            case '\n': *p++ = 'n';  break;
+            case '\r': *p++ = 'r';  break;
+            case '\t': *p++ = 't';  break;
+            default:   p += sprintf((char *)p, "u%04x", *c); break;
+            }
+        }
+        w->buf->last = p;
+    }
+    rp_json_write(w, "\"", 1);
+}
+
+
+/*----------------------------------------------------------------------------*/
+/* Separator and key of the next member */
+static void rp_json_member(rp_json_writer_t *w, const char *key)
+{
+    uint32_t bit = 1u << w->depth;
+
+    if(w->members & bit) {
+        rp_json_write(w, ",", 1);
+    }
+    w->members |= bit;
+    if(key) {
+        rp_json_write_string(w, key);
+        rp_json_write(w, ":", 1);
+    }
+}
+
+
+/*----------------------------------------------------------------------------*/
+static void rp_json_begin(rp_json_writer_t *w, const char *key, char c)
+{
+    rp_json_member(w, key);
+    rp_json_write(w, &c, 1);
+    if(++w->depth >= RP_JSON_DEPTH_MAX) {
+        w->failed = 1;
+        return;
+    }
+    w->members &= ~(1u << w->depth);
+}
+
+
+/*----------------------------------------------------------------------------*/
+static void rp_json_end(rp_json_writer_t *w, char c)
+{
+    if(w->depth-- <= 0) {
+        w->failed = 1;
+        return;
+    }
+    rp_json_write(w, &c, 1);
+}
+
+
+/*----------------------------------------------------------------------------*/
+void rp_json_object_begin(rp_json_writer_t *w, const char *key)
+{
+    rp_json_begin(w, key, '{');
+}
+
+void rp_json_object_end(rp_json_writer_t *w)
+{
+    rp_json_end(w, '}');
+}
+
+void rp_json_array_begin(rp_json_writer_t *w, const char *key)
+{
+    rp_json_begin(w, key, '[');
+}
+
+void rp_json_array_end(rp_json_writer_t *w)
+{
+    rp_json_end(w, ']');
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Writes a number the way cJSON prints a cJSON_CreateNumber() item.
+ *
+ * The item keeps the value as float and as int, integers are printed with
+ * "%d", everything else through the C library (parameters only, not worth a
+ * faster path).
+ */
+void rp_json_number(rp_json_writer_t *w, const char *key, double num)
+{
+    double d = (float)num;
+    int    i = (int)num;
+    u_char *p;
+
+    rp_json_member(w, key);
+    p = rp_json_reserve(w, 64);
+    if(p == NULL) {
+        return;
+    }
+
+    if((fabs((double)i - d) <= DBL_EPSILON) && (d <= INT_MAX) &&
+       (d >= INT_MIN)) {
+        p += sprintf((char *)p, "%d", i);
+    } else if((fabs(floor(d) - d) <= DBL_EPSILON) && (fabs(d) < 1.0e60)) {
+        p += snprintf((char *)p, 64, "%.0f", d);
+    } else if((fabs(d) < 1.0e-3) || (fabs(d) > 1.0e9)) {
+        p += snprintf((char *)p, 64, "%e", d);
+    } else {
+        p += snprintf((char *)p, 64, "%f", d);
+    }
+    w->buf->last = p;
+}
+
+
+/*----------------------------------------------------------------------------*/
+void rp_json_string(rp_json_writer_t *w, const char *key, const char *s)
+{
+    rp_json_member(w, key);
+    rp_json_write_string(w, s);
+}
+
+
+/*----------------------------------------------------------------------------*/
+void rp_json_float_pairs(rp_json_writer_t *w, const char *key,
+                         const float *x, const float *y, int len)
+{
+    u_char *p;
+    int i;
+
+    rp_json_member(w, key);
+    rp_json_write(w, "[", 1);
+    for(i = 0; i < len; i++) {
+        p = rp_json_reserve(w, 2 * RP_JSON_SAMPLE_MAX + 4);
+        if(p == NULL) {
+            return;
+        }
+        if(i) {
+            *p++ = ',';
+        }
+        *p++ = '[';
+        if(x) {
+            p = rp_json_print_sample(p, x[i]);
+        }
+        if(x && y) {
+            *p++ = ',';
+        }
+        if(y) {
+            p = rp_json_print_sample(p, y[i]);
+        }
+        *p++ = ']';
+        w->buf->last = p;
+    }
+    rp_json_write(w, "]", 1);
+}
+
+
+/*----------------------------------------------------------------------------*/
+u_char *rp_json_alloc(rp_json_writer_t *w, size_t n)
+{
+    u_char *p = rp_json_reserve(w, n);
+
+    if(p) {
+        w->buf->last = p + n;
+    }
+    return p;
+}
+
+
+/*----------------------------------------------------------------------------*/
+size_t rp_json_length(rp_json_writer_t *w)
+{
+    return w->len + (w->buf ? (size_t)(w->buf->last - w->buf->pos) : 0);
+}
+
+
+/*----------------------------------------------------------------------------*/
+ngx_chain_t *rp_json_finish(rp_json_writer_t *w, size_t *len)
+{
+    if(w->failed || (w->depth != 0) || (w->buf == NULL)) {
+        return NULL;
+    }
+    w->buf->last_buf      = 1;
+    w->buf->last_in_chain = 1;
+    *len = rp_json_length(w);
+    return w->out;
+}
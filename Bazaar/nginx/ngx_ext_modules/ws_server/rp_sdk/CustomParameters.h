@@ -326,3 +326,4 @@ public:
 extern CBooleanParameter IsDemoParam;		// special default parameter to check mode (demo or not)
 extern CStringParameter InCommandParam;		// special default parameter to receive a string command from WEB UI
 extern CStringParameter OutCommandParam;	// special default parameter to send a string command to WEB UI
+extern CStringParameter PerfParam;		// special default parameter with latency statistics, sent on "perf_stat" command
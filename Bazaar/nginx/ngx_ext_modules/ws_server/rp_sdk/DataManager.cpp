@@ -9,10 +9,12 @@
 #endif
 
 #include "gziping.h"
+#include "perf.h"
 
 CBooleanParameter IsDemoParam("is_demo", CBaseParameter::RO, false, 1);
 CStringParameter InCommandParam("in_command", CBaseParameter::WO, "", 1);
 CStringParameter OutCommandParam("out_command", CBaseParameter::RO, "", 1);
+CStringParameter PerfParam("rp_perf", CBaseParameter::RO, "", 1);
 
 int dbg_printf(const char * format, ...)
 {
@@ -175,11 +177,43 @@ void CDataManager::OnNewParams(std::string _params)
 	}
 
 	if(InCommandParam.IsNewValue())
+	{
 		m_send_all_params |= InCommandParam.NewValue() == "send_all_params";
+		OnPerfCommand(InCommandParam.NewValue());
+	}
 
 	::OnNewParams();
 }
 
+// latency tracing commands: perf_on, perf_off, perf_reset & perf_stat,
+// the last one sends the statistics in PerfParam as JSON, times in us;
+// they act on the tracer shared by all processes, librp & SCPI included
+void CDataManager::OnPerfCommand(const std::string& _command)
+{
+	if(_command == "perf_on")
+		perf_Enable(true);
+	else if(_command == "perf_off")
+		perf_Enable(false);
+	else if(_command == "perf_reset")
+		perf_Reset();
+	else if(_command == "perf_stat")
+	{
+		std::string stats = "{";
+		for(int i = 0; i < RP_PERF_STAGES; i++)
+		{
+			rp_perf_stat_t stat = {};
+			char buf[256];
+			perf_GetStat((rp_perf_stage_t)i, &stat);
+			snprintf(buf, sizeof(buf), "%s\"%s\":{\"count\":%llu,\"mean\":%.3f,\"p50\":%.3f,\"p99\":%.3f,\"max\":%.3f}",
+				i ? "," : "", perf_StageName((rp_perf_stage_t)i), (unsigned long long)stat.count,
+				stat.mean / 1e3, stat.p50 / 1e3, stat.p99 / 1e3, stat.max / 1e3);
+			stats += buf;
+		}
+		PerfParam.Set(stats + "}");
+		m_send_all_params = true;
+	}
+}
+
 void CDataManager::OnNewSignals(std::string _signals)
 {
 	dbg_printf("OnNewSignals\n");
@@ -277,7 +311,9 @@ extern "C" const char* ws_get_signals(void)
 	static std::string res = "";
 	if(man)
 	{
+		PERF_BEGIN(t);
 		res = man->GetSignalsJson();
+		PERF_END(RP_PERF_WS_SIGNALS, t);
 		return res.c_str();
 	}
 	return res.c_str();
@@ -344,8 +380,10 @@ extern "C" int verify_app_license(const char* app_id)
 
 extern "C" void ws_gzip(const char* _in, void* _out, size_t* _size)
 {
+	PERF_BEGIN(t);
 	std::string out;
 	Gziping(_in, out);
 	memcpy(_out, out.data(), out.size());
 	*_size = out.size();
+	PERF_END(RP_PERF_WS_GZIP, t);
 }
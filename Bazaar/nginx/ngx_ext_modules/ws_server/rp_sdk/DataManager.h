@@ -16,6 +16,7 @@ private:
 	CDataManager& operator=( CDataManager& );
 
 	inline bool NeedSend(const CBaseParameter& param) const;
+	void OnPerfCommand(const std::string& _command); // latency tracing commands of in_command
 
 	std::vector<CBaseParameter*> m_params;
 	std::vector<CBaseParameter*> m_signals;
@@ -10,6 +10,7 @@
 #include "math.h"
 #include "complex.h"
 #include "linAlg.h"
+#include "sineFit.h"
 
 double dBfun(double x){
   x=fabs(x) ;
@@ -120,59 +121,34 @@ void impedanceAnalyse(double fMeasure, complex uXX, complex uYY, options_t theOp
   }
 
 
+// basis of the last fit, a sweep point is measured with one plan
+static sineFitPlan_t thePlan ;
+
 void analyseSignal(int size , float **s, double fSample, double fMeasure, FILE *outfp, options_t theOptions){
   int i ;
-  double sigX[SIGNAL_LENGTH] ;
-  double sigY[SIGNAL_LENGTH] ;
-  for(i = 0; i < size ; i++) {
-    sigX[i]=(int)s[1][i] ;
-    sigY[i]=(int)s[2][i] ;
-    }
-  rmatrix matAX ;
-  rmatrix matAY ;
-  clearRmat(matAX,3) ;
-  clearRmat(matAY,3) ;
-  rvector rhsX ;
-  rvector rhsY ;
-  rvector f ;
-  clearRvec(rhsX,3) ;
-  clearRvec(rhsY,3) ;
-
-  for(i = 0; i < size ; i++) {
-    double t=i*2*M_PI*fMeasure/fSample ;
-    f[0]=cos(t) ;
-    f[1]=sin(t) ;
-    f[2]=1 ;
-
-    //sigX[i]=1000.0*co+55.0*si ;
-    //sigY[i]=100.0*co+255.0*si ;
-    for (int j=0 ; j<3 ; j++){ 
-      for(int k=0 ; k<3 ; k++ ){
-        matAX[j][k] += f[j]*f[k] ;
-        matAY[j][k] += f[j]*f[k] ; }
-      rhsX[j] += f[j]*sigX[i] ;
-      rhsY[j] += f[j]*sigY[i] ; }
+  const float *sig[2]={ s[1], s[2] } ;
+  sineFitResult_t fit[2] ;
+  if( sineFitPlanUpdate(&thePlan,size,2*M_PI*fMeasure/fSample)<0 ){
+    fprintf(stderr,"sine fit failed!\n") ;
+    return ;
     }
+  sineFit3(&thePlan,sig,2,fit) ;
   if( theOptions.v1 ){
-    fprintf(stderr,"\nleast squares matrix:") ;
-    rmdsp(matAX,3) ;
-    fprintf(stderr,"least squares vectors X,Y:\n") ;
-    for(int k=0 ; k<3 ; k++){
-      fprintf(stderr,"%15.5e  %15.5e\n",rhsX[k],rhsY[k]) ;
+    rmatrix matA ;
+    for (int j=0 ; j<3 ; j++){
+      for(int k=0 ; k<3 ; k++ ){ matA[j][k]=thePlan.g[j][k] ; }
       }
-    }
-  rsolv(matAX , rhsX , 3 ) ;
-  rsolv(matAY , rhsY , 3 ) ;
-  if( theOptions.v1 ){
+    fprintf(stderr,"\nleast squares matrix:") ;
+    rmdsp(matA,3) ;
     fprintf(stderr,"least squares solution vectors X,Y:\n") ;
-    for(int k=0 ; k<3 ; k++){
-      fprintf(stderr,"%15.5e  %15.5e\n",rhsX[k],rhsY[k]) ;
-      }
+    fprintf(stderr,"%15.5e  %15.5e\n",fit[0].a,fit[1].a) ;
+    fprintf(stderr,"%15.5e  %15.5e\n",fit[0].b,fit[1].b) ;
+    fprintf(stderr,"%15.5e  %15.5e\n",fit[0].c,fit[1].c) ;
     }
-  double uX=rhsX[0] ;
-  double vX=rhsX[1] ;
-  double uY=rhsY[0] ;
-  double vY=rhsY[1] ;
+  double uX=fit[0].a ;
+  double vX=fit[0].b ;
+  double uY=fit[1].a ;
+  double vY=fit[1].b ;
   double eEstiX=sqrt(sqr(uX)+sqr(vX)) ;
   double eEstiY=sqrt(sqr(uY)+sqr(vY)) ;
   double argX=atan2(uX,vX) ;
@@ -204,15 +180,16 @@ void analyseSignal(int size , float **s, double fSample, double fMeasure, FILE *
     double maxX=0.0 ;
     double maxY=0.0 ;
     for(i = 0; i < size ; i++) {
-      double t=i*2*M_PI*fMeasure/fSample ;
-      double co=cos(t) ;
-      double si=sin(t) ;
-      if (abs(sigX[i]) >maxX ){ maxX=abs(sigX[i]) ;  }
-      if (abs(sigY[i]) >maxY ){ maxY=abs(sigY[i]) ;  }
-      sqSumX +=  sqr (sigX[i]) ;
-      sqSumY +=  sqr (sigY[i]) ;
-      sqSumXres +=  sqr (sigX[i]-uX*co-vX*si-rhsX[2]) ;
-      sqSumYres +=  sqr (sigY[i]-uY*co-vY*si-rhsY[2]) ;
+      double co=thePlan.co[i] ;
+      double si=thePlan.si[i] ;
+      double sigX=s[1][i] ;
+      double sigY=s[2][i] ;
+      if (fabs(sigX) >maxX ){ maxX=fabs(sigX) ;  }
+      if (fabs(sigY) >maxY ){ maxY=fabs(sigY) ;  }
+      sqSumX +=  sqr (sigX) ;
+      sqSumY +=  sqr (sigY) ;
+      sqSumXres +=  sqr (sigX-uX*co-vX*si-fit[0].c) ;
+      sqSumYres +=  sqr (sigY-uY*co-vY*si-fit[1].c) ;
       }
     sqSumX=sqrt(sqSumX/size) ;
     sqSumY=sqrt(sqSumY/size) ;
@@ -490,6 +467,7 @@ int main(int argc, char *argv[]){
     fclose(outfp) ;
     }
 
+  sineFitPlanFree(&thePlan) ;
   if(rp_app_exit() < 0) {
     fprintf(stderr, "rp_app_exit() failed!\n");
     return -1;
@@ -62,7 +62,7 @@ void rsolv(rmatrix a , rvector b , int  n ) {
     max=0 ;
     maxpos=j ;
     for ( k=j ; k<n1 ; k++ ){
-      if ( abs(a[k][j]) > max ){ max=abs(a[k][j]) ; maxpos=k ; }
+      if ( fabs(a[k][j]) > max ){ max=fabs(a[k][j]) ; maxpos=k ; }
       }
     for ( k=j ; k<n1 ; k++ ){
       tmp=a[j][k] ; a[j][k]=a[maxpos][k] ; a[maxpos][k]=tmp ;
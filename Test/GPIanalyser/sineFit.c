@@ -0,0 +1,247 @@
+// least squares sine fitting with a cached basis, see sineFit.h
+//
+// The basis is kept in float so the dot products run on GCC vectors (NEON
+// on the Red Pitaya, SSE on a PC), four samples per operation. Partial sums
+// are kept in float over blocks of SF_BLOCK samples only and then added up
+// in double, the block of the basis stays in the cache while all channels
+// of a batch are run over it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/param.h>
+
+#include "linAlg.h"
+#include "sineFit.h"
+
+#define SF_BLOCK 256   // samples per float partial sum, multiple of 4
+#define SF_SUMS  5     // x*c, x*s, x, i*x*c, i*x*s
+
+typedef float sfVec __attribute__ ((vector_size (16))) ;
+
+static inline sfVec sfLoad(const float *p){
+  sfVec v ;
+  memcpy(&v,p,sizeof(v)) ;   // the sample buffers need not be aligned
+  return v ;
+  }
+
+static inline double sfHsum(sfVec v){
+  return (double)v[0]+v[1]+v[2]+v[3] ;
+  }
+
+void sineFitPlanFree(sineFitPlan_t *plan){
+  free(plan->co) ;
+  free(plan->si) ;
+  plan->co=NULL ;
+  plan->si=NULL ;
+  plan->size=0 ;
+  }
+
+// inverse of the 3x3 normal matrix, column by column with rsolv()
+static int sfInvert3(double g[3][3], double gInv[3][3]){
+  rmatrix a ;
+  rvector e ;
+  double det=g[0][0]*(g[1][1]*g[2][2]-g[1][2]*g[2][1])
+            -g[0][1]*(g[1][0]*g[2][2]-g[1][2]*g[2][0])
+            +g[0][2]*(g[1][0]*g[2][1]-g[1][1]*g[2][0]) ;
+  double scale=g[0][0]*g[1][1]*g[2][2] ;
+  // no sine at DC and at half the sampling frequency
+  if( !(fabs(det) > 1e-9*fabs(scale)) ) { return -1 ; }
+  for(int k=0 ; k<3 ; k++){
+    for(int i=0 ; i<3 ; i++){
+      for(int j=0 ; j<3 ; j++){ a[i][j]=g[i][j] ; }
+      e[i]=(i==k) ;
+      }
+    rsolv(a,e,3) ;
+    for(int i=0 ; i<3 ; i++){ gInv[i][k]=e[i] ; }
+    }
+  return 0 ;
+  }
+
+int sineFitPlanInit(sineFitPlan_t *plan, int size, double w){
+  void *co, *si ;
+  memset(plan,0,sizeof(*plan)) ;
+  if( size<4 ) { return -1 ; }
+  if( posix_memalign(&co,16,size*sizeof(float)) ) { return -1 ; }
+  if( posix_memalign(&si,16,size*sizeof(float)) ) { free(co) ; return -1 ; }
+  plan->co=co ;
+  plan->si=si ;
+  plan->size=size ;
+  plan->w=w ;
+
+  // basis by rotating a phasor, seeded exactly at every block
+  double dr=cos(w) ;
+  double di=sin(w) ;
+  for(int b=0 ; b<size ; b+=SF_BLOCK){
+    int e=MIN(b+SF_BLOCK,size) ;
+    double cr=cos(w*b) ;
+    double ci=sin(w*b) ;
+    for(int i=b ; i<e ; i++){
+      plan->co[i]=cr ;
+      plan->si[i]=ci ;
+      double t=cr*dr-ci*di ;
+      ci=cr*di+ci*dr ;
+      cr=t ;
+      }
+    }
+
+  // normal matrix and moments of the float basis the fits really use
+  double (*g)[3]=plan->g ;
+  for(int i=0 ; i<size ; i++){
+    double c=plan->co[i] ;
+    double s=plan->si[i] ;
+    g[0][0] += c*c ; g[0][1] += c*s ; g[0][2] += c ;
+    g[1][1] += s*s ; g[1][2] += s ;
+    plan->sIc2  += i*c*c ;   plan->sIcs  += i*c*s ;   plan->sIs2  += i*s*s ;
+    plan->sI2c2 += i*(i*c*c) ; plan->sI2cs += i*(i*c*s) ; plan->sI2s2 += i*(i*s*s) ;
+    plan->sIc   += i*c ;     plan->sIs   += i*s ;
+    }
+  g[2][2]=size ;
+  g[1][0]=g[0][1] ; g[2][0]=g[0][2] ; g[2][1]=g[1][2] ;
+  if( sfInvert3(g,plan->gInv)<0 ) {
+    fprintf(stderr,"sineFitPlanInit: no fit at w=%g rad/sample\n",w) ;
+    sineFitPlanFree(plan) ;
+    return -1 ;
+    }
+  return 0 ;
+  }
+
+// keeps the plan if it already is for this length and frequency
+int sineFitPlanUpdate(sineFitPlan_t *plan, int size, double w){
+  if( plan->co!=NULL && plan->size==size && plan->w==w ) { return 0 ; }
+  sineFitPlanFree(plan) ;
+  return sineFitPlanInit(plan,size,w) ;
+  }
+
+// one pass over the samples of all channels against the cached basis,
+// the index moments are only needed by the 4-parameter fit
+static void sfPass(const sineFitPlan_t *plan, const float **x, int nCh,
+                   double sum[][SF_SUMS], int moments){
+  const sfVec four={4,4,4,4} ;
+  int n=plan->size ;
+  memset(sum,0,nCh*sizeof(sum[0])) ;
+  for(int b=0 ; b<n ; b+=SF_BLOCK){
+    int e=MIN(b+SF_BLOCK,n) ;
+    int e4=b+((e-b)&~3) ;
+    const float *co=plan->co ;
+    const float *si=plan->si ;
+    for(int ch=0 ; ch<nCh ; ch++){
+      const float *xc=x[ch] ;
+      sfVec vc={0}, vs={0}, vx={0}, vic={0}, vis={0} ;
+      double tc=0, ts=0, tx=0, tic=0, tis=0 ;
+      int i ;
+      if( moments ){
+        sfVec vi={0,1,2,3} ;   // index within the block
+        for(i=b ; i<e4 ; i+=4){
+          sfVec xv=sfLoad(xc+i) ;
+          sfVec xcv=xv* *(const sfVec *)(co+i) ;
+          sfVec xsv=xv* *(const sfVec *)(si+i) ;
+          vc += xcv ; vs += xsv ; vx += xv ;
+          vic += vi*xcv ; vis += vi*xsv ;
+          vi += four ;
+          }
+        } else {
+        for(i=b ; i<e4 ; i+=4){
+          sfVec xv=sfLoad(xc+i) ;
+          vc += xv* *(const sfVec *)(co+i) ;
+          vs += xv* *(const sfVec *)(si+i) ;
+          vx += xv ;
+          }
+        }
+      for( ; i<e ; i++){
+        tc += (double)xc[i]*co[i] ;
+        ts += (double)xc[i]*si[i] ;
+        tx += xc[i] ;
+        tic += (i-b)*((double)xc[i]*co[i]) ;
+        tis += (i-b)*((double)xc[i]*si[i]) ;
+        }
+      tc += sfHsum(vc) ;
+      ts += sfHsum(vs) ;
+      sum[ch][0] += tc ;
+      sum[ch][1] += ts ;
+      sum[ch][2] += tx+sfHsum(vx) ;
+      sum[ch][3] += tic+sfHsum(vic)+(double)b*tc ;
+      sum[ch][4] += tis+sfHsum(vis)+(double)b*ts ;
+      }
+    }
+  }
+
+static void sfFinish(sineFitResult_t *r){
+  r->amp=sqrt(r->a*r->a+r->b*r->b) ;
+  r->phi=atan2(r->a,r->b) ;
+  }
+
+static void sfSolve3(const sineFitPlan_t *plan, const double *sum, sineFitResult_t *r){
+  const double (*g)[3]=plan->gInv ;
+  r->a=g[0][0]*sum[0]+g[0][1]*sum[1]+g[0][2]*sum[2] ;
+  r->b=g[1][0]*sum[0]+g[1][1]*sum[1]+g[1][2]*sum[2] ;
+  r->c=g[2][0]*sum[0]+g[2][1]*sum[1]+g[2][2]*sum[2] ;
+  r->w=plan->w ;
+  r->iterations=1 ;
+  sfFinish(r) ;
+  }
+
+// 3-parameter fit of nCh channels at the frequency of the plan
+void sineFit3(const sineFitPlan_t *plan, const float **x, int nCh, sineFitResult_t *res){
+  double sum[nCh][SF_SUMS] ;
+  sfPass(plan,x,nCh,sum,0) ;
+  for(int ch=0 ; ch<nCh ; ch++){
+    sfSolve3(plan,sum[ch],&res[ch]) ;
+    }
+  }
+
+// Gauss-Newton step of the 4-parameter fit linearized at the plan frequency
+// and a, b: the normal matrix from the cached moments, the right hand side
+// from the pass. Returns a, b, c and the frequency step in r.
+static void sfStep4(const sineFitPlan_t *plan, const double *sum, double a, double b, rvector r){
+  rmatrix g ;
+  for(int j=0 ; j<3 ; j++){
+    for(int k=0 ; k<3 ; k++){ g[j][k]=plan->g[j][k] ; }
+    }
+  g[0][3]=b*plan->sIc2-a*plan->sIcs ;
+  g[1][3]=b*plan->sIcs-a*plan->sIs2 ;
+  g[2][3]=b*plan->sIc-a*plan->sIs ;
+  g[3][3]=b*b*plan->sI2c2-2*a*b*plan->sI2cs+a*a*plan->sI2s2 ;
+  for(int k=0 ; k<3 ; k++){ g[3][k]=g[k][3] ; }
+  r[0]=sum[0] ;
+  r[1]=sum[1] ;
+  r[2]=sum[2] ;
+  r[3]=b*sum[3]-a*sum[4] ;
+  rsolv(g,r,4) ;
+  }
+
+// 4-parameter (IEEE 1057) fit of nCh channels starting at the frequency of
+// the plan. The first step comes from the batched pass over the cached
+// basis, every further one needs a plan at the updated frequency. Stops
+// when the frequency step is below tol [rad/sample] or after maxIter passes.
+void sineFit4(const sineFitPlan_t *plan, const float **x, int nCh, int maxIter, double tol,
+              sineFitResult_t *res){
+  double sum[nCh][SF_SUMS] ;
+  double sum1[1][SF_SUMS] ;
+  sineFitPlan_t step ;
+  memset(&step,0,sizeof(step)) ;
+  sfPass(plan,x,nCh,sum,1) ;
+  for(int ch=0 ; ch<nCh ; ch++){
+    sineFitResult_t *p=&res[ch] ;
+    rvector r ;
+
+    // initial a, b from the 3-parameter fit of the same pass
+    sfSolve3(plan,sum[ch],p) ;
+    sfStep4(plan,sum[ch],p->a,p->b,r) ;
+    double w=plan->w+r[3] ;
+    while( fabs(r[3])>tol && p->iterations<maxIter ){
+      if( sineFitPlanUpdate(&step,plan->size,w)<0 ) { break ; }
+      sfPass(&step,&x[ch],1,sum1,1) ;
+      sfStep4(&step,sum1[0],r[0],r[1],r) ;
+      w=step.w+r[3] ;
+      p->iterations++ ;
+      }
+    p->a=r[0] ;
+    p->b=r[1] ;
+    p->c=r[2] ;
+    p->w=w ;
+    sfFinish(p) ;
+    }
+  sineFitPlanFree(&step) ;
+  }
@@ -0,0 +1,43 @@
+// least squares sine fitting with a cached basis
+//
+// A plan holds cos(w*i), sin(w*i) for one length and one frequency w
+// [rad/sample] and everything of the normal equations which does not
+// depend on the samples. A 3-parameter fit (known frequency) then costs
+// two dot products and a sum per channel, the 4-parameter fit (IEEE 1057,
+// frequency estimated as well) starts from the same pass.
+//
+// model: x[i] = a*cos(w*i) + b*sin(w*i) + c
+
+#ifndef SINEFIT_H
+#define SINEFIT_H
+
+typedef struct sineFitPlan {
+  int size ;
+  double w ;           // angular frequency [rad/sample]
+  float *co ;          // cos(w*i), float for the SIMD dot products
+  float *si ;          // sin(w*i)
+  double g[3][3] ;     // 3-parameter normal matrix
+  double gInv[3][3] ;  // and its inverse
+  // moments of the basis for the 4-parameter normal matrix
+  double sIc2, sIcs, sIs2, sIc, sIs, sI2c2, sI2cs, sI2s2 ;
+  } sineFitPlan_t ;
+
+typedef struct sineFitResult {
+  double a ;           // cos coefficient
+  double b ;           // sin coefficient
+  double c ;           // offset
+  double w ;           // angular frequency [rad/sample]
+  double amp ;         // sqrt(a*a+b*b)
+  double phi ;         // atan2(a,b) [rad]
+  int iterations ;     // 4-parameter fit: passes over the samples
+  } sineFitResult_t ;
+
+int  sineFitPlanInit(sineFitPlan_t *plan, int size, double w) ;
+int  sineFitPlanUpdate(sineFitPlan_t *plan, int size, double w) ;
+void sineFitPlanFree(sineFitPlan_t *plan) ;
+
+void sineFit3(const sineFitPlan_t *plan, const float **x, int nCh, sineFitResult_t *res) ;
+void sineFit4(const sineFitPlan_t *plan, const float **x, int nCh, int maxIter, double tol,
+              sineFitResult_t *res) ;
+
+#endif
@@ -0,0 +1,171 @@
+/**
+ * $Id: $
+ *
+ * @brief FPGA bitstream manager test.
+ *
+ * Loads fake bitstreams into a regular file standing in for /dev/xdevcfg
+ * and checks which loads are skipped, served from RAM or streamed, and
+ * prints the load timings. Runs on the host as well as on the board.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "rp_bazaar_fpga.h"
+#include "bench.h"
+
+#define IMAGE_SIZE (4 * 1024 * 1024 + 123)
+
+static char dir[] = "/tmp/fpga_cache_testXXXXXX";
+static char file_a[256], file_b[256], sink[256], state[256], done[256];
+
+static void write_file(const char *path, int seed, size_t size)
+{
+    FILE *f = fopen(path, "w");
+    size_t i;
+
+    srand(seed);
+    for(i = 0; i < size; i++) {
+        fputc(rand() & 0xff, f);
+    }
+    fclose(f);
+}
+
+static void write_text(const char *path, const char *text)
+{
+    FILE *f = fopen(path, "w");
+    fputs(text, f);
+    fclose(f);
+}
+
+/* Compares the fake device content with the bitstream, clears the device */
+static int sink_equals(const char *path)
+{
+    FILE *a = fopen(path, "r"), *b = fopen(sink, "r");
+    int ca, cb, ret = 1;
+
+    do {
+        ca = fgetc(a);
+        cb = fgetc(b);
+        if(ca != cb) {
+            ret = 0;
+            break;
+        }
+    } while(ca != EOF);
+    fclose(a);
+    fclose(b);
+    truncate(sink, 0);
+    return ret;
+}
+
+static long sink_size(void)
+{
+    struct stat st;
+    stat(sink, &st);
+    return st.st_size;
+}
+
+static fpga_stat_t load(const char *name, const char *path, int force)
+{
+    fpga_stat_t ret = rp_bazaar_fpga_load(path, sink, force);
+    const rp_fpga_load_stat_t *s = rp_bazaar_fpga_get_last_stat();
+
+    printf("%-28s ret %d skipped %d ram %d hash %6llu us load %6llu us "
+           "total %6llu us\n", name, ret, s->skipped, s->from_ram,
+           (unsigned long long)s->hash_us, (unsigned long long)s->load_us,
+           (unsigned long long)s->total_us);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    const rp_fpga_load_stat_t *s = rp_bazaar_fpga_get_last_stat();
+
+    if(mkdtemp(dir) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    sprintf(file_a, "%s/a.bit", dir);
+    sprintf(file_b, "%s/b.bit", dir);
+    sprintf(sink,   "%s/xdevcfg", dir);
+    sprintf(state,  "%s/loaded", dir);
+    sprintf(done,   "%s/prog_done", dir);
+    write_file(file_a, 1, IMAGE_SIZE);
+    write_file(file_b, 2, IMAGE_SIZE);
+    write_text(sink, "");
+    write_text(done, "1\n");
+    rp_bazaar_fpga_set_paths(state, done);
+
+    /* streamed from file, then skipped */
+    CHECK(load("a (first load)", file_a, 0) == FPGA_OK, "a (first load)");
+    CHECK(!s->skipped && !s->from_ram && sink_equals(file_a), "a (first load)");
+    CHECK(load("a (again)", file_a, 0) == FPGA_OK, "a (again)");
+    CHECK(s->skipped && s->hash_us == 0 && sink_size() == 0, "a (again)");
+    CHECK(load("a (forced)", file_a, 1) == FPGA_OK, "a (forced)");
+    CHECK(!s->skipped && sink_equals(file_a), "a (forced)");
+    CHECK(load("b", file_b, 0) == FPGA_OK, "b");
+    CHECK(!s->skipped && sink_equals(file_b), "b");
+
+    /* RAM cache */
+    rp_bazaar_fpga_set_cache(2 * IMAGE_SIZE);
+    CHECK(load("a (cache enabled)", file_a, 0) == FPGA_OK, "a (cache enabled)");
+    CHECK(!s->skipped && !s->from_ram && sink_equals(file_a), "a (cache enabled)");
+    rp_bazaar_fpga_cleanup();
+    CHECK(load("a (after restart)", file_a, 0) == FPGA_OK, "a (after restart)");
+    CHECK(s->skipped && s->hash_us > 0 && sink_size() == 0, "a (after restart)");
+    CHECK(load("b (after restart)", file_b, 0) == FPGA_OK, "b (after restart)");
+    CHECK(!s->skipped && s->from_ram && sink_equals(file_b), "b (after restart)");
+    CHECK(load("a (from RAM)", file_a, 0) == FPGA_OK, "a (from RAM)");
+    CHECK(!s->skipped && s->from_ram && sink_equals(file_a), "a (from RAM)");
+    rp_bazaar_fpga_set_cache(IMAGE_SIZE);
+    CHECK(load("b (evicted)", file_b, 0) == FPGA_OK, "b (evicted)");
+    CHECK(!s->skipped && !s->from_ram && sink_equals(file_b), "b (evicted)");
+    CHECK(load("a (evicted by b)", file_a, 0) == FPGA_OK, "a (evicted by b)");
+    CHECK(!s->skipped && !s->from_ram && sink_equals(file_a), "a (evicted by b)");
+    rp_bazaar_fpga_set_cache(0);
+    CHECK(load("b (cache disabled)", file_b, 0) == FPGA_OK, "b (cache disabled)");
+    CHECK(!s->skipped && !s->from_ram && sink_equals(file_b), "b (cache disabled)");
+
+    /* same content under a different name is recognized by its hash */
+    rename(file_b, file_a);
+    CHECK(load("b renamed to a", file_a, 0) == FPGA_OK, "b renamed to a");
+    CHECK(s->skipped && s->hash_us > 0 && sink_size() == 0, "b renamed to a");
+
+    /* file changed on disk */
+    write_file(file_a, 3, IMAGE_SIZE);
+    CHECK(load("a (rewritten)", file_a, 0) == FPGA_OK, "a (rewritten)");
+    CHECK(!s->skipped && s->hash_us > 0 && sink_equals(file_a), "a (rewritten)");
+
+    /* PL reset by someone else */
+    write_text(done, "0\n");
+    CHECK(load("a (prog_done 0)", file_a, 0) == FPGA_OK, "a (prog_done 0)");
+    CHECK(!s->skipped && sink_equals(file_a), "a (prog_done 0)");
+    write_text(done, "1\n");
+    rp_bazaar_fpga_invalidate();
+    CHECK(load("a (invalidated)", file_a, 0) == FPGA_OK, "a (invalidated)");
+    CHECK(!s->skipped && sink_equals(file_a), "a (invalidated)");
+
+    /* errors */
+    CHECK(load("missing file", file_b, 0) == FPGA_FIND_ERR, "missing file");
+    rp_bazaar_fpga_invalidate();
+    CHECK(rp_bazaar_fpga_load(file_a, "/nonexistent/xdevcfg", 0) == FPGA_WRITE_ERR, "load to a missing device not refused");
+    CHECK(load("a (after failed load)", file_a, 0) == FPGA_OK, "a (after failed load)");
+    CHECK(!s->skipped && sink_equals(file_a), "a (after failed load)");
+
+    unlink(file_a);
+    unlink(sink);
+    unlink(state);
+    unlink(done);
+    rmdir(dir);
+
+    return benchResult();
+}
@@ -0,0 +1,273 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya Bode analyzer sweep library.
+ *
+ * The generator is first swept up to the start frequency and the results
+ * are dropped, this removes the transient effect which spoils the first
+ * measurements. Every point is the mean of the requested number of lock-in
+ * measurements, done on min_periodes periods of the signal with the
+ * decimation chosen by frequency.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <complex.h>
+
+#include "bode_sweep.h"
+
+#define BODE_SMPL_FREQ    125e6 // ADC & AWG sampling frequency [Hz]
+#define BODE_STEPS_TE     10    // Max. number of steps for transient effect (TE) elimination
+#define BODE_MIN_PERIODES 10    // Number of periods acquired
+
+const int bode_dec[BODE_DEC_NUM] = { 1, 8, 64, 1024, 8192, 65536 };
+
+/** Sweep state */
+typedef struct {
+    const bode_sweep_params_t *p;
+    const bode_backend_t      *be;
+    const bode_sweep_cb_t     *cb;
+    float    *ch1, *ch2;       // Acquired signals
+    int32_t  *data;            // AWG data buffer
+    int       done, total;     // Measurements made and in the whole sweep
+} bode_sweep_t;
+
+
+/** Decimation index for a signal frequency */
+static int bode_dec_idx(double freq)
+{
+    if      (freq >= 160000) return 0;
+    else if (freq >= 20000)  return 1;
+    else if (freq >= 2500)   return 2;
+    else if (freq >= 160)    return 3;
+    else if (freq >= 20)     return 4;
+    return 5;
+}
+
+/** Generator frequency of point idx */
+static double bode_point_freq(const bode_sweep_params_t *p, int idx)
+{
+    float a, b;
+
+    if (p->log_scale) {
+        a = log10f(p->start_freq);
+        b = log10f(p->end_freq);
+        return powf(10, ((b - a) / (p->steps - 1)) * (float)idx + a);
+    }
+    return p->start_freq + ((p->end_freq - p->start_freq) / (p->steps - 1)) * idx;
+}
+
+static int bode_set_freq(bode_sweep_t *s, double ampl, double freq)
+{
+    bode_awg_param_t awg;
+
+    bode_sweep_synth(ampl, freq, s->data, &awg);
+    return s->be->generate(s->be->ctx, s->p->ch, s->data, &awg);
+}
+
+/** Averaged gain & phase at freq, the generator already runs at it */
+static int bode_measure(bode_sweep_t *s, double freq, bode_point_t *pt)
+{
+    int dec_idx = bode_dec_idx(freq);
+    uint32_t size = round( ( BODE_MIN_PERIODES * BODE_SMPL_FREQ ) / ( freq * bode_dec[dec_idx] ) );
+    double amplitude = 0, phase = 0;
+    float a, ph;
+    unsigned int i;
+
+    if (size > BODE_MAX_SAMPLES) size = BODE_MAX_SAMPLES;
+    if (size < 2) size = 2;
+
+    for (i = 0; i < s->p->averaging; i++) {
+        if (s->be->acquire(s->be->ctx, dec_idx, size, s->ch1, s->ch2) < 0) {
+            return -1;
+        }
+        if (bode_sweep_analysis(s->ch1, s->ch2, size, s->p->dc_bias, freq * 2 * M_PI,
+                                dec_idx, &a, &ph) < 0) {
+            return -1;
+        }
+        amplitude += a;
+        phase += ph;
+    }
+    pt->freq = freq;
+    pt->amplitude = amplitude / s->p->averaging;
+    pt->phase = phase / s->p->averaging;
+
+    s->done++;
+    if (s->cb->progress) {
+        s->cb->progress(s->cb->ctx, 100 * s->done / s->total);
+    }
+    return 0;
+}
+
+static int bode_run(bode_sweep_t *s)
+{
+    const bode_sweep_params_t *p = s->p;
+    int steps_te = p->steps < BODE_STEPS_TE ? p->steps : BODE_STEPS_TE;
+    bode_point_t pt;
+    double freq;
+    int idx, c;
+
+    /* Transient effect elimination: frequencies below the start frequency,
+     * increasing to it */
+    for (c = steps_te; c >= 2; c--) {
+        freq = (int)(p->start_freq - (p->start_freq/2) + ((p->start_freq/2)*c/steps_te));
+        if (bode_set_freq(s, p->ampl, freq) < 0 || bode_measure(s, freq, &pt) < 0) {
+            return -1;
+        }
+    }
+
+    for (idx = 0; idx < p->steps; idx++) {
+        freq = bode_point_freq(p, idx);
+        if (bode_set_freq(s, p->ampl, freq) < 0 || bode_measure(s, freq, &pt) < 0) {
+            return -1;
+        }
+        if (s->cb->point(s->cb->ctx, idx, p->steps, &pt) < 0) {
+            return -1;
+        }
+    }
+    return p->steps;
+}
+
+/**
+ * Runs a sweep.
+ *
+ * Points are passed to cb->point as soon as they are measured. The
+ * generator output is turned off at the end, also when the sweep fails or
+ * is aborted.
+ *
+ * @param p   Sweep parameters.
+ * @param be  Hardware backend.
+ * @param cb  Point and progress callbacks.
+ * @return    Number of points, -1 on failure or abort.
+ */
+int bode_sweep_run(const bode_sweep_params_t *p, const bode_backend_t *be,
+                   const bode_sweep_cb_t *cb)
+{
+    bode_sweep_t s = { .p = p, .be = be, .cb = cb };
+    int ret = -1;
+
+    if (p->steps < 2 || p->averaging < 1 || p->ch > 1 || p->start_freq <= 0 ||
+        p->end_freq < p->start_freq) {
+        fprintf(stderr, "bode_sweep_run: invalid parameters\n");
+        return -1;
+    }
+
+    s.ch1  = malloc(BODE_MAX_SAMPLES * sizeof(float));
+    s.ch2  = malloc(BODE_MAX_SAMPLES * sizeof(float));
+    s.data = malloc(BODE_AWG_LEN * sizeof(int32_t));
+    if (!s.ch1 || !s.ch2 || !s.data) {
+        fprintf(stderr, "bode_sweep_run: out of memory\n");
+        goto out;
+    }
+    s.total = p->steps + (p->steps < BODE_STEPS_TE ? p->steps : BODE_STEPS_TE) - 1;
+
+    ret = bode_run(&s);
+
+    /* Setting amplitude to 0V - turning off the output. */
+    if (bode_set_freq(&s, 0, 1000) < 0) {
+        ret = -1;
+    }
+
+out:
+    free(s.data);
+    free(s.ch2);
+    free(s.ch1);
+    return ret;
+}
+
+/**
+ * Synthesize a sine for the AWG.
+ *
+ * The data[] vector of BODE_AWG_LEN samples at 125 MHz is generated to be
+ * re-played by the FPGA AWG module.
+ *
+ * @param ampl  Signal amplitude [V].
+ * @param freq  Signal frequency [Hz].
+ * @param data  Returned synthesized AWG data vector.
+ * @param awg   Returned AWG parameters.
+ */
+void bode_sweep_synth(double ampl, double freq,
+                      int32_t *data, bode_awg_param_t *awg)
+{
+    const int dcoffs = -155;
+    uint32_t amp = ampl * 4000.0;    /* 1 V ==> 4000 DAC counts */
+    uint32_t i;
+
+    awg->offsgain = (dcoffs << 16) + 0x1fff;
+    awg->step = round(65536 * freq/BODE_SMPL_FREQ * BODE_AWG_LEN);
+    awg->wrap = round(65536 * BODE_AWG_LEN - 1);
+
+    if (amp > 8191) {
+        /* Truncate to max value if needed */
+        amp = 8191;
+    }
+
+    for (i = 0; i < BODE_AWG_LEN; i++) {
+        data[i] = round(amp * cos(2*M_PI*(double)i/(double)BODE_AWG_LEN));
+        if (data[i] < 0)
+            data[i] += (1 << 14);
+    }
+}
+
+/**
+ * Acquired data analysis function for Bode analyzer.
+ *
+ * Amplitude and phase of both inputs are found with the lock-in method,
+ * the result is their ratio. Works on the caller's buffers only, nothing
+ * is allocated.
+ *
+ * @param ch1        Input 1 (reference) in ADC counts.
+ * @param ch2        Input 2 (response) in ADC counts.
+ * @param size       Size of data.
+ * @param dc_bias    DC component.
+ * @param w_out      Angular velocity (2*pi*freq).
+ * @param dec_idx    Decimation selector index.
+ * @param amplitude  Returned amplitude [dB].
+ * @param phase      Returned phase [deg].
+ * @return           0 on success, -1 on invalid arguments.
+ */
+int bode_sweep_analysis(const float *ch1, const float *ch2, uint32_t size,
+                        double dc_bias, double w_out, int dec_idx,
+                        float *amplitude, float *phase)
+{
+    /* Transform signals from AD - 14 bit to voltage */
+    const double scale = ( 2 - dc_bias ) / 16384;
+    double complex u1 = 0, u2 = 0, ref;
+    double T; // Sampling time in seconds
+    double phase_internal;
+    uint32_t i;
+
+    if (size < 2 || dec_idx < 0 || dec_idx >= BODE_DEC_NUM || !(w_out > 0)) {
+        return -1;
+    }
+    T = bode_dec[dec_idx] / BODE_SMPL_FREQ;
+
+    /* Signals multiplied by the reference signals (sin, cos) and integrated
+     * with the trapezoidal method */
+    for (i = 0; i < size; i++) {
+        float ang = i * T * w_out;
+        double k = (i == 0 || i == size - 1) ? 0.5 : 1.0;
+
+        ref = k * scale * (sin(ang) + cos(ang) * I);
+        u1 += ch1[i] * ref;
+        u2 += ch2[i] * ref;
+    }
+
+    phase_internal = carg(u2) - carg(u1);
+    if (phase_internal <= -M_PI) {
+        phase_internal += 2 * M_PI;
+    } else if (phase_internal >= M_PI) {
+        phase_internal -= 2 * M_PI;
+    }
+
+    *amplitude = 10 * log( cabs(u2) / cabs(u1) );
+    *phase = phase_internal * ( 180 / M_PI );
+    return 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya Bode analyzer sweep library.
+ *
+ * The measurement core of the bode utility: generator frequency plan,
+ * transient warm-up and lock-in gain & phase analysis. Hardware access
+ * goes through a small backend, so the same sweep runs in the bode command
+ * line tool, in-process in the Bode plotter web application and against a
+ * simulated front end. Points are handed to a callback as soon as they are
+ * measured.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __BODE_SWEEP_H
+#define __BODE_SWEEP_H
+
+#include <stdint.h>
+
+/** AWG buffer length [samples] */
+#define BODE_AWG_LEN       (16*1024)
+/** Max. number of samples acquired per measurement */
+#define BODE_MAX_SAMPLES   (16*1024)
+/** Number of decimation settings, index into bode_dec */
+#define BODE_DEC_NUM       6
+
+/** Decimation factor for every decimation index */
+extern const int bode_dec[BODE_DEC_NUM];
+
+/** AWG FPGA parameters */
+typedef struct {
+    int32_t  offsgain;   // AWG offset & gain
+    uint32_t wrap;       // AWG buffer wrap value
+    uint32_t step;       // AWG step interval
+} bode_awg_param_t;
+
+/** Sweep parameters, as given on the bode command line */
+typedef struct {
+    unsigned int ch;          // Generator channel [0, 1]
+    double       ampl;        // Signal amplitude [V]
+    double       dc_bias;     // DC bias [V]
+    unsigned int averaging;   // Measurements averaged per point
+    unsigned int steps;       // Number of points
+    double       start_freq;  // Start frequency [Hz]
+    double       end_freq;    // End frequency [Hz]
+    unsigned int log_scale;   // 0 - linear, 1 - logarithmic frequency steps
+} bode_sweep_params_t;
+
+/** One measured point */
+typedef struct {
+    float freq;        // Frequency [Hz]
+    float amplitude;   // Gain from input 1 to input 2 [dB]
+    float phase;       // Phase from input 1 to input 2 [deg]
+} bode_point_t;
+
+/**
+ * Hardware the sweep runs on. All functions return a negative value on
+ * failure, which aborts the sweep.
+ */
+typedef struct {
+    void *ctx;
+    /** Play data[BODE_AWG_LEN] continuously on generator channel ch */
+    int (*generate)(void *ctx, unsigned int ch, const int32_t *data,
+                    const bode_awg_param_t *awg);
+    /** Acquire size samples of both inputs at decimation bode_dec[dec_idx]
+     *  as signed ADC counts, starting at an immediate trigger */
+    int (*acquire)(void *ctx, int dec_idx, uint32_t size, float *ch1, float *ch2);
+} bode_backend_t;
+
+/** Where the sweep reports to */
+typedef struct {
+    void *ctx;
+    /** Point idx of count is measured, a negative return aborts the sweep */
+    int  (*point)(void *ctx, int idx, int count, const bode_point_t *pt);
+    /** Progress of the whole sweep [%], may be NULL */
+    void (*progress)(void *ctx, int percent);
+} bode_sweep_cb_t;
+
+int bode_sweep_run(const bode_sweep_params_t *p, const bode_backend_t *be,
+                   const bode_sweep_cb_t *cb);
+
+void bode_sweep_synth(double ampl, double freq,
+                      int32_t *data, bode_awg_param_t *awg);
+
+int bode_sweep_analysis(const float *ch1, const float *ch2, uint32_t size,
+                        double dc_bias, double w_out, int dec_idx,
+                        float *amplitude, float *phase);
+
+#endif /* __BODE_SWEEP_H */
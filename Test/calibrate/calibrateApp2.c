@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <termios.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "redpitaya/rp.h"
@@ -30,6 +31,24 @@ void waitForUser ( void )
         exit(1);
 }
 
+static double timeNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* time spent in calibration steps, user interaction excluded */
+static double calibTime = 0;
+
+void reportStep(const char* name, double start) {
+    rp_calib_stat_t stat;
+    double elapsed = timeNow() - start;
+    calibTime += elapsed;
+    rp_CalibrationGetLastStat(&stat);
+    printf("%s: %.3f s, last point %g +/- %g (%u/%u captures)\n",
+           name, elapsed, stat.mean, stat.std_err, stat.accepted, stat.captures);
+}
+
 void backupParams() {
     rp_calib_params_t calib = rp_GetCalibrationSettings();
     FILE* fout = fopen("calib_params.dat", "wb");
@@ -81,6 +100,7 @@ int restoreParams(const char* path) {
 
 int main(int argc, char **argv) {
     float value;
+    double start;
     int ret;
     printf("Library version: %s\n", rp_GetVersion());
 
@@ -101,11 +121,15 @@ int main(int argc, char **argv) {
 
     puts("Connect CH1 LV to ground.");
     waitForUser();
+    start = timeNow();
     ECHECK(rp_CalibrateFrontEndOffset(RP_CH_1, RP_LOW, NULL));
+    reportStep("CalibrateFrontEndOffset RP_CH_1", start);
 
     puts("Connect CH1 HV to ground.");
     waitForUser();
+    start = timeNow();
     ECHECK(rp_CalibrateFrontEndOffset(RP_CH_1, RP_HIGH, NULL));
+    reportStep("CalibrateFrontEndOffset RP_CH_1", start);
 
     do {
         puts("Connect CH1 to reference voltage source and set jumpers to HV.");
@@ -113,7 +137,9 @@ int main(int argc, char **argv) {
         ret = scanf("%f", &value);
     } while ((ret != 1) && (value <= 0.f) && (value > 20.f));
     printf("Calibrating to %f V\n", value);
+    start = timeNow();
     ECHECK(rp_CalibrateFrontEndScaleHV(RP_CH_1, value, NULL));
+    reportStep("CalibrateFrontEndScaleHV RP_CH_1", start);
 
     do {
         puts("Connect CH1 to reference voltage source and set jumpers to LV.");
@@ -121,19 +147,27 @@ int main(int argc, char **argv) {
         ret = scanf("%f", &value);
     } while ((ret != 1) && (value <= 0.f) && (value > 1.f));
     printf("Calibrating to %f V\n", value);
+    start = timeNow();
     ECHECK(rp_CalibrateFrontEndScaleLV(RP_CH_1, value, NULL));
+    reportStep("CalibrateFrontEndScaleLV RP_CH_1", start);
 
     puts("Connect CH1 Outout to CH1 Input. Press any key to continue.");
     waitForUser();
+    start = timeNow();
     ECHECK(rp_CalibrateBackEnd(RP_CH_1, NULL));
+    reportStep("CalibrateBackEnd RP_CH_1", start);
 
     puts("Connect CH2 LV to ground.");
     waitForUser();
+    start = timeNow();
     ECHECK(rp_CalibrateFrontEndOffset(RP_CH_2, RP_LOW, NULL));
+    reportStep("CalibrateFrontEndOffset RP_CH_2", start);
 
     puts("Connect CH2 HV to ground.");
     waitForUser();
+    start = timeNow();
     ECHECK(rp_CalibrateFrontEndOffset(RP_CH_2, RP_HIGH, NULL));
+    reportStep("CalibrateFrontEndOffset RP_CH_2", start);
 
     do {
         puts("Connect CH2 to reference voltage source and set jumpers to HV.");
@@ -141,7 +175,9 @@ int main(int argc, char **argv) {
         ret = scanf("%f", &value);
     } while ((ret != 1) && (value <= 0.f) && (value > 20.f));
     printf("Calibrating to %f V\n", value);
+    start = timeNow();
     ECHECK(rp_CalibrateFrontEndScaleHV(RP_CH_2, value, NULL));
+    reportStep("CalibrateFrontEndScaleHV RP_CH_2", start);
 
     do {
         puts("Connect CH2 to reference voltage source and set jumpers to LV.");
@@ -149,13 +185,18 @@ int main(int argc, char **argv) {
         ret = scanf("%f", &value);
     } while ((ret != 1) && (value <= 0.f) && (value > 1.f));
     printf("Calibrating to %f V\n", value);
+    start = timeNow();
     ECHECK(rp_CalibrateFrontEndScaleLV(RP_CH_2, value, NULL));
+    reportStep("CalibrateFrontEndScaleLV RP_CH_2", start);
 
     puts("Connect CH2 Outout to CH2 Input.");
     waitForUser();
+    start = timeNow();
     ECHECK(rp_CalibrateBackEnd(RP_CH_2, NULL));
+    reportStep("CalibrateBackEnd RP_CH_2", start);
 
     printParams(NULL);
+    printf("Total calibration time: %.3f s\n", calibTime);
     backupParams();
 
     ECHECK(rp_Release());
@@ -0,0 +1,66 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya test & benchmark fixture.
+ *
+ * Checks and timing of the Test benches, and the register simulator for
+ * those running librp or an application on the host: the FPGA address space
+ * is a temporary file given to the register map as RP_REGMAP_DEV, the
+ * calibration EEPROM is read from /dev/zero or bench_eeprom. Benches build
+ * bench.c, the simulator ones bench_sim.c too, see bench.mk.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __BENCH_H
+#define __BENCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/** FPGA address space of the simulator, from the register map base up to
+ * the last block */
+#define BENCH_FPGA_SIZE     0x00410000
+/** Oscilloscope block from the FPGA base */
+#define BENCH_OSC_OFFSET    0x00100000
+/** Generator block from the FPGA base */
+#define BENCH_GEN_OFFSET    0x00200000
+
+/** Checks failed so far */
+extern int failures;
+
+/** Counts a failed check and prints where it failed and the printf()
+ * message */
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        failures++; \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+/** CLOCK_MONOTONIC time in s */
+double timeNow(void);
+
+/** Prints OK or FAILED, returns the exit status of the bench */
+int benchResult(void);
+
+/** File read instead of the calibration EEPROM, /dev/zero by default */
+extern const char *bench_eeprom;
+
+/**
+ * Creates the simulator file, maps it and sets RP_REGMAP_DEV to it; call it
+ * before rp_Init() or the application init.
+ * @return FPGA address space, exits on a failure.
+ */
+uint8_t *benchSimOpen(void);
+
+/** Unmaps & removes the simulator file */
+void benchSimClose(void);
+
+#endif /* __BENCH_H */
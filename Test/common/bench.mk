@@ -0,0 +1,14 @@
+##
+# $Id: $
+#
+# (c) Red Pitaya  http://www.redpitaya.com
+#
+# Make fragment of the Test bench fixture. Set BENCH_DIR to this directory
+# before including it, add $(BENCH_CFLAGS) to the compiler flags and build
+# $(BENCH_SRC) into the bench; a bench on the register simulator builds
+# $(BENCH_SIM_SRC) as well and links -ldl.
+#
+
+BENCH_SRC     = $(BENCH_DIR)/bench.c
+BENCH_SIM_SRC = $(BENCH_DIR)/bench_sim.c
+BENCH_CFLAGS  = -I$(BENCH_DIR)
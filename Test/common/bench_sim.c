@@ -0,0 +1,62 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya test & benchmark fixture, register simulator.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <sys/mman.h>
+
+#include "bench.h"
+
+#define EEPROM_DEV  "/sys/bus/i2c/devices/0-0050/eeprom"
+
+const char *bench_eeprom = "/dev/zero";
+
+static char     sim_path[] = "/tmp/rp_bench_sim_XXXXXX";
+static uint8_t *sim_base;
+
+/* librp & the applications read their calibration with fopen(), there is
+ * no EEPROM here */
+FILE *fopen(const char *path, const char *mode) {
+    static FILE *(*libc_fopen)(const char *, const char *);
+
+    if (libc_fopen == NULL) {
+        libc_fopen = dlsym(RTLD_NEXT, "fopen");
+    }
+    return libc_fopen(strcmp(path, EEPROM_DEV) ? path : bench_eeprom, mode);
+}
+
+uint8_t *benchSimOpen(void) {
+    int fd = mkstemp(sim_path);
+
+    if (fd < 0 || ftruncate(fd, BENCH_FPGA_SIZE) < 0) {
+        perror("register simulator file");
+        exit(EXIT_FAILURE);
+    }
+    sim_base = mmap(NULL, BENCH_FPGA_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (sim_base == MAP_FAILED) {
+        perror("register simulator mmap");
+        exit(EXIT_FAILURE);
+    }
+    setenv("RP_REGMAP_DEV", sim_path, 1);
+    return sim_base;
+}
+
+void benchSimClose(void) {
+    munmap(sim_base, BENCH_FPGA_SIZE);
+    unlink(sim_path);
+    strcpy(sim_path + strlen(sim_path) - 6, "XXXXXX");
+}
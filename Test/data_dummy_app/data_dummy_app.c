@@ -0,0 +1,238 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya dummy application for the /data endpoint.
+ *
+ * Publishes synthetic signals at a configurable rate without any FPGA
+ * access, so the web server side of GET /data (waiting for new signals,
+ * request latency, concurrent clients) can be measured on its own.
+ *
+ * Signals (RP_DATA_SIG_LEN samples each):
+ *  - 0: sample index,
+ *  - 1: sine, shifted by one sample for every publication,
+ *  - 2: sequence number of the publication in all samples.
+ *
+ * Parameters:
+ *  - rate:   publications per second, 0 stops publishing (default 10),
+ *  - notify: 1 exports the signals eventfd, 0 hides it so the server polls
+ *            (read when the server first waits for signals, default 1),
+ *  - seq:    sequence number of the last publication (read only).
+ *
+ * Install as <bazaar dir>/data_dummy/controllerhf.so and start it with
+ * /bazaar?start=data_dummy, test/http/data_wait_test.py does the rest.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#define SIG_NUM   3
+#define SIG_LEN   2048
+#define RATE_MAX  10000.0f
+
+/* Same layout as rp_app_params_t of the web server module */
+typedef struct rp_app_params_s {
+    char  *name;
+    float  value;
+    int    fpga_update;
+    int    read_only;
+    float  min_val;
+    float  max_val;
+} rp_app_params_t;
+
+enum { PARAM_RATE = 0, PARAM_NOTIFY, PARAM_SEQ, PARAMS_NUM };
+
+static rp_app_params_t dummy_params[PARAMS_NUM + 1] = {
+    { "rate",   10, 0, 0, 0, RATE_MAX },
+    { "notify",  1, 0, 0, 0, 1 },
+    { "seq",     0, 0, 1, 0, 1e9 },
+    { NULL,      0, 0, 0, 0, 0 }
+};
+
+static pthread_mutex_t dummy_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  dummy_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t       dummy_thread;
+static int             dummy_running = 0;
+static float           dummy_signals[SIG_NUM][SIG_LEN];
+static int             dummy_dirty = 0;
+static uint32_t        dummy_seq = 0;
+static int             dummy_fd = -1;
+
+
+static void timespec_add_ns(struct timespec *ts, int64_t ns)
+{
+    ts->tv_sec  += ns / 1000000000;
+    ts->tv_nsec += ns % 1000000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+static void *dummy_worker(void *arg)
+{
+    struct timespec next;
+    uint64_t one = 1;
+    int i;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    pthread_mutex_lock(&dummy_mutex);
+    while (dummy_running) {
+        float rate = dummy_params[PARAM_RATE].value;
+
+        if (rate <= 0) {
+            /* stopped, wait for a new rate */
+            pthread_cond_wait(&dummy_cond, &dummy_mutex);
+            clock_gettime(CLOCK_MONOTONIC, &next);
+            continue;
+        }
+
+        timespec_add_ns(&next, (int64_t)(1e9 / rate));
+        if (pthread_cond_timedwait(&dummy_cond, &dummy_mutex, &next) != ETIMEDOUT) {
+            /* rate changed or exit, restart the period */
+            clock_gettime(CLOCK_MONOTONIC, &next);
+            continue;
+        }
+
+        dummy_seq++;
+        for (i = 0; i < SIG_LEN; i++) {
+            dummy_signals[0][i] = i;
+            dummy_signals[1][i] = sinf(2 * M_PI * (i + dummy_seq) / 256.0f);
+            dummy_signals[2][i] = dummy_seq;
+        }
+        dummy_params[PARAM_SEQ].value = dummy_seq;
+        dummy_dirty = 1;
+
+        if (dummy_fd >= 0) {
+            ssize_t ret = write(dummy_fd, &one, sizeof(one));
+            (void)ret;
+        }
+    }
+    pthread_mutex_unlock(&dummy_mutex);
+    return NULL;
+}
+
+
+const char *rp_app_desc(void)
+{
+    return (const char *)"Dummy /data signals publisher.\n";
+}
+
+int rp_app_init(void)
+{
+    pthread_condattr_t attr;
+
+    dummy_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (dummy_fd < 0) {
+        fprintf(stderr, "eventfd() failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&dummy_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    dummy_running = 1;
+    if (pthread_create(&dummy_thread, NULL, dummy_worker, NULL) != 0) {
+        fprintf(stderr, "pthread_create() failed: %s\n", strerror(errno));
+        dummy_running = 0;
+        close(dummy_fd);
+        dummy_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int rp_app_exit(void)
+{
+    pthread_mutex_lock(&dummy_mutex);
+    dummy_running = 0;
+    pthread_cond_signal(&dummy_cond);
+    pthread_mutex_unlock(&dummy_mutex);
+    pthread_join(dummy_thread, NULL);
+
+    close(dummy_fd);
+    dummy_fd = -1;
+    return 0;
+}
+
+int rp_set_params(rp_app_params_t *p, int len)
+{
+    int i, j;
+
+    pthread_mutex_lock(&dummy_mutex);
+    for (i = 0; i < len; i++) {
+        for (j = 0; j < PARAMS_NUM; j++) {
+            rp_app_params_t *d = &dummy_params[j];
+            if (strcmp(p[i].name, d->name) || d->read_only)
+                continue;
+            d->value = p[i].value;
+            if (d->value < d->min_val)
+                d->value = d->min_val;
+            if (d->value > d->max_val)
+                d->value = d->max_val;
+        }
+    }
+    pthread_cond_signal(&dummy_cond);
+    pthread_mutex_unlock(&dummy_mutex);
+    return 0;
+}
+
+/* The server frees the names and the table */
+int rp_get_params(rp_app_params_t **p)
+{
+    rp_app_params_t *c;
+    int i;
+
+    c = (rp_app_params_t *)malloc((PARAMS_NUM + 1) * sizeof(rp_app_params_t));
+    if (c == NULL)
+        return -1;
+
+    pthread_mutex_lock(&dummy_mutex);
+    for (i = 0; i < PARAMS_NUM; i++) {
+        c[i] = dummy_params[i];
+        c[i].name = strdup(dummy_params[i].name);
+    }
+    pthread_mutex_unlock(&dummy_mutex);
+    c[PARAMS_NUM].name = NULL;
+
+    *p = c;
+    return PARAMS_NUM;
+}
+
+int rp_get_signals(float ***s, int *sig_num, int *sig_len)
+{
+    int i;
+
+    if (*s == NULL)
+        return -1;
+
+    *sig_num = SIG_NUM;
+    *sig_len = SIG_LEN;
+
+    pthread_mutex_lock(&dummy_mutex);
+    if (!dummy_dirty) {
+        pthread_mutex_unlock(&dummy_mutex);
+        return -1;
+    }
+    for (i = 0; i < SIG_NUM; i++)
+        memcpy((*s)[i], dummy_signals[i], sizeof(dummy_signals[i]));
+    dummy_dirty = 0;
+    pthread_mutex_unlock(&dummy_mutex);
+    return 0;
+}
+
+int rp_get_signals_fd(void)
+{
+    return dummy_params[PARAM_NOTIFY].value ? dummy_fd : -1;
+}
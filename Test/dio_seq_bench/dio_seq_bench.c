@@ -0,0 +1,175 @@
+/**
+ * $Id: $
+ *
+ * @brief Digital I/O port and pattern sequencer benchmark.
+ *
+ * On the board compares the pin toggle rate of per-pin rp_DpinSetState()
+ * calls with whole port rp_DportSetState() writes, then plays square waves
+ * of decreasing period on DIO0_P with the pattern sequencer and reports the
+ * step rate reached and the step lateness (jitter).
+ *
+ * Where the FPGA cannot be mapped (host), the sequencer plays on a plain
+ * memory register instead and, given a spare CPU, a thread polling the
+ * register additionally measures the intervals between the edges it sees.
+ *
+ * Usage: dio_seq_bench [seconds per scenario]
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "redpitaya/rp.h"
+#include "dseq.h"
+#include "bench.h"
+
+static volatile uint32_t mem_reg;
+static volatile int watch_run;
+static int board, watch;
+
+/* Edge intervals seen by the watcher */
+static uint64_t edges;
+static double   edge_sum, edge_sum2, edge_max;
+
+static void *watcher(void *arg) {
+    uint32_t last = mem_reg;
+    double t_last = 0;
+
+    while (watch_run) {
+        uint32_t v = mem_reg;
+        if (v != last) {
+            double t = timeNow();
+            if (t_last > 0) {
+                double d = t - t_last;
+                edges++;
+                edge_sum += d;
+                edge_sum2 += d * d;
+                edge_max = fmax(edge_max, d);
+            }
+            t_last = t;
+            last = v;
+        }
+    }
+    return NULL;
+}
+
+static int seqStart(const rp_dseq_step_t *steps, uint32_t count, uint32_t repeat) {
+    if (board)
+        return rp_DseqStart(RP_DPORT_DIO_P, steps, count, repeat);
+    return dseq_Start(&mem_reg, steps, count, repeat);
+}
+
+static void seqStat(bool *running, rp_dseq_stat_t *stat) {
+    if (board) {
+        rp_DseqIsRunning(running);
+        rp_DseqGetStat(stat);
+    } else {
+        dseq_IsRunning(running);
+        dseq_GetStat(stat);
+    }
+}
+
+static void portBench(double secs) {
+    uint32_t n = 0;
+    double t;
+
+    rp_DportSetDirection(RP_DPORT_DIO_P, 0xff, 0xff);
+
+    t = timeNow();
+    while (timeNow() - t < secs) {
+        for (int pin = 0; pin < 8; pin++)
+            rp_DpinSetState(RP_DIO0_P + pin, (n + pin) & 1 ? RP_HIGH : RP_LOW);
+        n++;
+    }
+    t = timeNow() - t;
+    printf("%-32s %12.0f patterns/s %12.0f pin writes/s\n", "rp_DpinSetState() x 8 pins",
+           n / t, 8 * n / t);
+
+    n = 0;
+    t = timeNow();
+    while (timeNow() - t < secs) {
+        rp_DportSetState(RP_DPORT_DIO_P, 0xff, (n & 1) ? 0xaa : 0x55);
+        n++;
+    }
+    t = timeNow() - t;
+    printf("%-32s %12.0f patterns/s\n\n", "rp_DportSetState() 8 pins", n / t);
+}
+
+int main(int argc, char **argv) {
+    const uint32_t period_ns[] = { 0, 2000, 10000, 100000, 1000000 };
+    double secs = argc > 1 ? atof(argv[1]) : 1;
+    pthread_t watch_thread;
+
+    board = rp_Init() == RP_OK;
+    if (board)
+        portBench(secs);
+    else
+        printf("FPGA not available, sequencer plays on a memory register\n\n");
+    /* the watcher spins, it would take the CPU from the sequencer */
+    watch = !board && sysconf(_SC_NPROCESSORS_ONLN) > 1;
+
+    printf("%10s %10s %12s %7s %10s %10s", "period[us]", "steps", "steps/s", "breaks", "late avg", "late max");
+    if (watch)
+        printf(" %10s %10s %10s", "edge avg", "edge rms", "edge max");
+    printf("  [us]\n");
+
+    for (unsigned i = 0; i < sizeof(period_ns) / sizeof(period_ns[0]); i++) {
+        rp_dseq_step_t steps[2] = {
+            { .mask = 1, .state = 1, .delay = period_ns[i] / 2 },
+            { .mask = 1, .state = 0, .delay = period_ns[i] / 2 },
+        };
+        uint32_t repeat = period_ns[i] ? secs * 1e9 / period_ns[i] : secs * 1e6;
+        rp_dseq_stat_t stat;
+        bool running = true;
+        double t;
+
+        edges = 0;
+        edge_sum = edge_sum2 = edge_max = 0;
+        watch_run = 1;
+        if (watch)
+            pthread_create(&watch_thread, NULL, watcher, NULL);
+
+        t = timeNow();
+        if (seqStart(steps, 2, repeat) != RP_OK) {
+            fprintf(stderr, "sequencer start failed\n");
+            return EXIT_FAILURE;
+        }
+        while (running) {
+            usleep(10000);
+            seqStat(&running, &stat);
+        }
+        t = timeNow() - t;
+
+        watch_run = 0;
+        if (watch)
+            pthread_join(watch_thread, NULL);
+
+        printf("%10.1f %10llu %12.0f %7u", period_ns[i] * 1e-3,
+               (unsigned long long) stat.steps, stat.steps / t, stat.breaks);
+        /* without delays the steps are as fast as possible, not on time */
+        if (period_ns[i])
+            printf(" %10.2f %10.2f", stat.late_avg * 1e-3, stat.late_max * 1e-3);
+        else
+            printf(" %10s %10s", "-", "-");
+        if (watch && edges) {
+            double avg = edge_sum / edges;
+            printf(" %10.2f %10.2f %10.2f", avg * 1e6,
+                   sqrt(fmax(edge_sum2 / edges - avg * avg, 0)) * 1e6, edge_max * 1e6);
+        }
+        printf("\n");
+    }
+
+    if (board) {
+        rp_DseqStop();
+        rp_Release();
+    } else {
+        dseq_Stop();
+    }
+    return EXIT_SUCCESS;
+}
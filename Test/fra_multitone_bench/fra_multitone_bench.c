@@ -0,0 +1,147 @@
+/**
+ * $Id: $
+ *
+ * @brief Frequency response analyzer multitone stimulus benchmark.
+ *
+ * Compares the direct sum of cosines formerly used by the freqanalyzer with
+ * the inverse FFT synthesis for zero, Schroeder and optimized phases:
+ * synthesis time, crest factor, per-tone amplitude at the fixed DAC
+ * amplitude and the tone SNR reached after a number of acquisitions with
+ * white noise added to the quantized signal. Runs on the host as well as
+ * on the board.
+ *
+ * Usage: fra_multitone_bench [noise rms in counts]
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "multitone.h"
+#include "bench.h"
+
+#define NN     (16 * 1024)
+#define II     64
+#define KSTP   16
+#define DACAMP 8000
+
+static double sig[NN], acc[NN];
+static kiss_fft_cpx spec[NN / 2 + 1];
+
+static double gauss(void) {
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0), u2 = rand() / (RAND_MAX + 1.0);
+    return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+/* Former freqanalyzer synthesis: II * NN cos() calls */
+static double synthDirect(int kstart) {
+    double peak = 0;
+
+    for (int jx = 0; jx < II; jx++)
+        for (int ix = 0; ix < NN; ix++)
+            sig[ix] = (jx ? sig[ix] : 0) +
+                cos(2 * M_PI * (double) ix / (double) NN * (double) (kstart + KSTP * jx));
+    for (int ix = 0; ix < NN; ix++)
+        if (fabs(sig[ix]) > peak)
+            peak = fabs(sig[ix]);
+    return peak;
+}
+
+/* Mean tone SNR [dB] after averaging acq acquisitions of the quantized
+ * signal with white noise */
+static double snr(kiss_fftr_cfg cfg, int kstart, double peak, int acq, double noise) {
+    double tone = 0, floor = 0;
+    int n_floor = 0;
+
+    memset(acc, 0, sizeof(acc));
+    for (int a = 0; a < acq; a++)
+        for (int n = 0; n < NN; n++)
+            acc[n] += (round(sig[n] * DACAMP / peak) + noise * gauss()) / acq;
+    kiss_fftr(cfg, acc, spec);
+
+    for (int k = 1; k < NN / 2; k++) {
+        double p = spec[k].r * spec[k].r + spec[k].i * spec[k].i;
+        if (k >= kstart && k < kstart + II * KSTP && (k - kstart) % KSTP == 0) {
+            tone += p / II;
+        } else if (k > kstart + II * KSTP) {
+            floor += p;
+            n_floor++;
+        }
+    }
+    return 10 * log10(tone / (floor / n_floor));
+}
+
+int main(int argc, char **argv) {
+    const char *name[] = { "direct cos", "ifft zero", "ifft schroeder", "ifft optimized" };
+    const int acqs[] = { 1, 4, 16 };
+    double noise = argc > 1 ? atof(argv[1]) : 4;
+    double snr1[4];
+    kiss_fftr_cfg cfg = kiss_fftr_alloc(NN, 0, NULL, NULL);
+    fra_mt_t mt;
+
+    if (fra_mt_init(&mt, NN) < 0 || !cfg) {
+        fprintf(stderr, "FFT init failed\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("%d tones, step %d bins, %d samples, DAC amplitude %d, noise %.1f counts rms\n",
+           II, KSTP, NN, DACAMP, noise);
+    printf("%-16s %10s %8s %10s", "method", "synth [ms]", "crest", "tone amp");
+    for (int a = 0; a < 3; a++)
+        printf("  SNR@%-2d acq", acqs[a]);
+    printf("\n");
+
+    /* the inverse FFT must reproduce the direct sum */
+    {
+        static double ref[NN];
+        double err = 0;
+
+        synthDirect(II * KSTP);
+        memcpy(ref, sig, sizeof(ref));
+        fra_mt_synth(&mt, II * KSTP, KSTP, II, fra_mt_phase_zero, sig);
+        for (int n = 0; n < NN; n++)
+            if (fabs(sig[n] - ref[n]) > err)
+                err = fabs(sig[n] - ref[n]);
+        if (err > 1e-9) {
+            fprintf(stderr, "inverse FFT differs from direct sum by %g\n", err);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (int m = 0; m < 4; m++) {
+        double rms = 0, peak, t;
+        int kstart = 2 * II * KSTP;
+
+        srand(1);
+        t = timeNow();
+        if (m == 0)
+            peak = synthDirect(kstart);
+        else
+            peak = fra_mt_synth(&mt, kstart, KSTP, II, (fra_mt_phase_t) (m - 1), sig);
+        t = timeNow() - t;
+
+        for (int n = 0; n < NN; n++)
+            rms += sig[n] * sig[n] / NN;
+        rms = sqrt(rms);
+
+        printf("%-16s %10.2f %8.2f %10.1f", name[m], t * 1e3, peak / rms, DACAMP / peak);
+        for (int a = 0; a < 3; a++) {
+            double s = snr(cfg, kstart, peak, acqs[a], noise);
+            if (a == 0)
+                snr1[m] = s;
+            printf(" %9.1f dB", s);
+        }
+        printf("\n");
+    }
+    printf("\nOptimized phases gain %.1f dB SNR over zero phases, i.e. the same SNR "
+           "in %.1fx fewer acquisitions\n", snr1[3] - snr1[1],
+           pow(10, (snr1[3] - snr1[1]) / 10));
+
+    fra_mt_clean(&mt);
+    kiss_fftr_free(cfg);
+    return EXIT_SUCCESS;
+}
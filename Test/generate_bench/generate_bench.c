@@ -0,0 +1,369 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya generator API test & benchmark.
+ *
+ * Runs librp on a register simulator file (RP_REGMAP_DEV) and checks the
+ * DAC buffers sample by sample against the buffers the former
+ * synthesize_signal() wrote, synthesizing the whole waveform & converting
+ * every sample on each change:
+ *
+ *  - after every waveform, phase, duty cycle & square frequency change,
+ *  - after full and partial (float & raw) arbitrary uploads, also with the
+ *    arbitrary waveform not selected,
+ *  - after rp_GenOutEnable(), a waveform change & rp_GenReset() when the
+ *    buffer was overwritten behind librp's back.
+ *
+ * Then measures how many rp_Gen* parameter changes per second the library
+ * can apply, as done when sweeping frequency or phase from a script. The
+ * rates are the simulator's, given 'board' they are measured on /dev/mem.
+ *
+ * Usage: generate_bench [calls [board]]  (default 1000 calls)
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+
+#include "redpitaya/rp.h"
+#include "bench.h"
+
+#define ARB_LENGTH (16 * 1024)
+
+/** DAC buffers from the generator block */
+#define GEN_CHA_DATA    0x10000
+#define GEN_CHB_DATA    0x20000
+#define DAC_BITS        14
+
+static float arb[ARB_LENGTH];
+
+/** Generator state as the former synthesize_signal() saw it */
+typedef struct {
+    rp_waveform_t waveform;
+    float frequency;
+    float phase;
+    float duty;
+    float arb[ARB_LENGTH];
+    uint32_t arb_size;
+} model_t;
+
+static model_t model[2];
+static volatile uint32_t *dac[2];
+
+/* former synthesis_*() */
+static void synthesize(const model_t *m, float *data) {
+    int h = (int) (ARB_LENGTH / 2 * m->duty);
+    int trans = (int) (m->frequency / 1e6 * 300);
+
+    if (trans <= 10)
+        trans = 30;
+
+    for (int i = 0; i < ARB_LENGTH; i++) {
+        switch (m->waveform) {
+            case RP_WAVEFORM_SINE:
+                data[i] = (float) (sin(2 * M_PI * (float) i / (float) ARB_LENGTH));
+                break;
+            case RP_WAVEFORM_TRIANGLE:
+                data[i] = (float) ((asin(sin(2 * M_PI * (float) i / (float) ARB_LENGTH)) / M_PI * 2));
+                break;
+            case RP_WAVEFORM_RAMP_UP:
+                data[i] = i == ARB_LENGTH - 1 ? 0 :
+                    (float) (-1.0 * (acos(cos(M_PI * (float) (ARB_LENGTH - i - 2) / (float) ARB_LENGTH)) / M_PI - 1));
+                break;
+            case RP_WAVEFORM_RAMP_DOWN:
+                data[i] = (float) (-1.0 * (acos(cos(M_PI * (float) i / (float) ARB_LENGTH)) / M_PI - 1));
+                break;
+            case RP_WAVEFORM_DC:
+                data[i] = 1.0;
+                break;
+            case RP_WAVEFORM_PWM:
+                data[i] = (i < h || i >= ARB_LENGTH - h) ? 1.0 : -1.0;
+                break;
+            case RP_WAVEFORM_SQUARE:
+                if (i < ARB_LENGTH / 2 - trans)
+                    data[i] = 1.0f;
+                else if (i < ARB_LENGTH / 2)
+                    data[i] = 1.0f - (2.0f / trans) * (i - (ARB_LENGTH / 2 - trans));
+                else if (i < ARB_LENGTH - trans)
+                    data[i] = -1.0f;
+                else
+                    data[i] = -1.0f + (2.0f / trans) * (i - (ARB_LENGTH - trans));
+                break;
+            default:
+                data[i] = m->arb[i];
+                break;
+        }
+    }
+}
+
+/* former cmn_CnvVToCnt() without calibration */
+static uint32_t cnvVToCnt(float voltage) {
+    if (voltage > 1.0)
+        voltage = 1.0;
+    else if (voltage < -1.0)
+        voltage = -1.0;
+
+    int cnts = (int) round(voltage * (float) (1 << DAC_BITS) / 2.0f);
+    if (cnts > (1 << (DAC_BITS - 1)) - 1)
+        cnts = (1 << (DAC_BITS - 1)) - 1;
+    else if (cnts < -(1 << (DAC_BITS - 1)))
+        cnts = -1 << (DAC_BITS - 1);
+    return (uint32_t) cnts & ((1 << DAC_BITS) - 1);
+}
+
+/* former synthesize_signal() & generate_writeData() */
+static void reference(rp_channel_t channel, uint32_t *cnts) {
+    static float data[ARB_LENGTH];
+    const model_t *m = &model[channel];
+    uint32_t start = (uint32_t) (m->phase * ARB_LENGTH / 360.0);
+
+    synthesize(m, data);
+    for (uint32_t i = start; i < start + ARB_LENGTH; i++) {
+        cnts[i % ARB_LENGTH] = cnvVToCnt(data[i - start]);
+    }
+}
+
+static void compare(rp_channel_t channel, const char *what) {
+    static uint32_t cnts[ARB_LENGTH];
+    int bad = 0, first = -1;
+
+    reference(channel, cnts);
+    for (int i = 0; i < ARB_LENGTH; i++) {
+        if (dac[channel][i] != cnts[i]) {
+            bad++;
+            first = first < 0 ? i : first;
+        }
+    }
+    CHECK(bad == 0, "ch%d %s: %d samples differ, first [%d] %u instead of %u",
+          channel + 1, what, bad, first, first < 0 ? 0 : dac[channel][first], first < 0 ? 0 : cnts[first]);
+}
+
+/* writes behind librp's back, as another process would */
+static void overwrite(rp_channel_t channel) {
+    for (int i = 0; i < ARB_LENGTH; i++) {
+        dac[channel][i] = (i * 7) & ((1 << DAC_BITS) - 1);
+    }
+}
+
+static void reset() {
+    CHECK(rp_GenReset() == RP_OK, "rp_GenReset() failed");
+    for (int ch = 0; ch < 2; ch++) {
+        model[ch].waveform = RP_WAVEFORM_SINE;
+        model[ch].frequency = 1000;
+        model[ch].phase = 0;
+        model[ch].duty = 0.5;
+    }
+}
+
+static void setWaveform(rp_channel_t channel, rp_waveform_t waveform) {
+    CHECK(rp_GenWaveform(channel, waveform) == RP_OK, "rp_GenWaveform(%d) failed", waveform);
+    model[channel].waveform = waveform;
+}
+
+static void setPhase(rp_channel_t channel, float phase) {
+    CHECK(rp_GenPhase(channel, phase) == RP_OK, "rp_GenPhase(%f) failed", phase);
+    model[channel].phase = phase < 0 ? phase + 360 : phase;
+}
+
+static void setDuty(rp_channel_t channel, float duty) {
+    CHECK(rp_GenDutyCycle(channel, duty) == RP_OK, "rp_GenDutyCycle(%f) failed", duty);
+    model[channel].duty = duty;
+}
+
+static void setFreq(rp_channel_t channel, float frequency) {
+    CHECK(rp_GenFreq(channel, frequency) == RP_OK, "rp_GenFreq(%f) failed", frequency);
+    model[channel].frequency = frequency;
+}
+
+static void setArb(rp_channel_t channel, uint32_t length) {
+    model_t *m = &model[channel];
+
+    for (uint32_t i = 0; i < length; i++)
+        arb[i] = 2.0f * rand() / RAND_MAX - 1.0f;
+    CHECK(rp_GenArbWaveform(channel, arb, length) == RP_OK, "rp_GenArbWaveform(%u) failed", length);
+    memcpy(m->arb, arb, length * sizeof(float));
+    memset(m->arb + length, 0, (ARB_LENGTH - length) * sizeof(float));
+    m->arb_size = length;
+}
+
+static void setArbRange(rp_channel_t channel, uint32_t offset, uint32_t length) {
+    model_t *m = &model[channel];
+
+    for (uint32_t i = 0; i < length; i++)
+        arb[i] = 2.0f * rand() / RAND_MAX - 1.0f;
+    CHECK(rp_GenArbWaveformRange(channel, arb, offset, length) == RP_OK,
+          "rp_GenArbWaveformRange(%u, %u) failed", offset, length);
+    memcpy(m->arb + offset, arb, length * sizeof(float));
+    m->arb_size = offset + length > m->arb_size ? offset + length : m->arb_size;
+}
+
+static void setArbRaw(rp_channel_t channel, uint32_t offset, uint32_t length) {
+    static int16_t raw[ARB_LENGTH];
+    model_t *m = &model[channel];
+
+    for (uint32_t i = 0; i < length; i++)
+        raw[i] = rand() % (1 << DAC_BITS) - (1 << (DAC_BITS - 1));
+    CHECK(rp_GenArbWaveformRaw(channel, raw, offset, length) == RP_OK,
+          "rp_GenArbWaveformRaw(%u, %u) failed", offset, length);
+    for (uint32_t i = 0; i < length; i++)
+        m->arb[offset + i] = raw[i] / (float) (1 << (DAC_BITS - 1));
+    m->arb_size = offset + length > m->arb_size ? offset + length : m->arb_size;
+}
+
+static void check(rp_channel_t channel) {
+    static const rp_waveform_t waveforms[] = {
+        RP_WAVEFORM_SINE, RP_WAVEFORM_TRIANGLE, RP_WAVEFORM_SQUARE, RP_WAVEFORM_RAMP_UP,
+        RP_WAVEFORM_RAMP_DOWN, RP_WAVEFORM_DC, RP_WAVEFORM_PWM
+    };
+    static const float phases[] = { 90, -45, 359.5, 0.01, 0 };
+    char what[64];
+
+    reset();
+    CHECK(rp_GenOutEnable(channel) == RP_OK, "rp_GenOutEnable() failed");
+    compare(channel, "reset");
+
+    for (int w = 0; w < sizeof(waveforms) / sizeof(waveforms[0]); w++) {
+        setWaveform(channel, waveforms[w]);
+        snprintf(what, sizeof(what), "waveform %d", waveforms[w]);
+        compare(channel, what);
+        for (int p = 0; p < sizeof(phases) / sizeof(phases[0]); p++) {
+            setPhase(channel, phases[p]);
+            snprintf(what, sizeof(what), "waveform %d phase %g", waveforms[w], phases[p]);
+            compare(channel, what);
+        }
+    }
+
+    /* PWM still selected */
+    setDuty(channel, 0.1);
+    compare(channel, "duty 0.1");
+    setPhase(channel, 30);
+    setDuty(channel, 0.9);
+    compare(channel, "duty 0.9 phase 30");
+    setDuty(channel, 0.5);
+    setPhase(channel, 0);
+    compare(channel, "duty 0.5");
+
+    setWaveform(channel, RP_WAVEFORM_SQUARE);
+    setFreq(channel, 1e6);
+    compare(channel, "square 1 MHz");
+    setFreq(channel, 5e6);
+    compare(channel, "square 5 MHz");
+    setFreq(channel, 1000);
+    compare(channel, "square 1 kHz");
+
+    setArb(channel, ARB_LENGTH);
+    compare(channel, "arbitrary uploaded, square selected");
+    setWaveform(channel, RP_WAVEFORM_ARBITRARY);
+    compare(channel, "arbitrary");
+    setPhase(channel, 120);
+    compare(channel, "arbitrary phase 120");
+    setArbRange(channel, 5000, 300);
+    compare(channel, "arbitrary range");
+    setArbRaw(channel, ARB_LENGTH - 384, 384);
+    compare(channel, "arbitrary raw range at the end");
+    setPhase(channel, 0);
+    compare(channel, "arbitrary phase 0");
+
+    setArb(channel, 1000);
+    compare(channel, "arbitrary of 1000 samples");
+    setArbRange(channel, 3000, 10);
+    compare(channel, "arbitrary range past the end");
+    setArbRaw(channel, 0, 16);
+    compare(channel, "arbitrary raw range at the start");
+
+    setWaveform(channel, RP_WAVEFORM_SINE);
+    setArbRange(channel, 100, 50);
+    compare(channel, "arbitrary range, sine selected");
+    setWaveform(channel, RP_WAVEFORM_ARBITRARY);
+    compare(channel, "arbitrary after a range upload");
+
+    overwrite(channel);
+    CHECK(rp_GenOutEnable(channel) == RP_OK, "rp_GenOutEnable() failed");
+    compare(channel, "enable after another writer");
+    overwrite(channel);
+    setWaveform(channel, RP_WAVEFORM_TRIANGLE);
+    compare(channel, "waveform after another writer");
+    overwrite(channel);
+    reset();
+    compare(channel, "reset after another writer");
+}
+
+static int call(const char *name, int i) {
+    if (name[0] == 'f')
+        return rp_GenFreq(RP_CH_1, 1000.0 + (i % 1000));
+    if (name[0] == 'p')
+        return rp_GenPhase(RP_CH_1, (float) (i % 360));
+    if (name[0] == 'd')
+        return rp_GenDutyCycle(RP_CH_1, 0.1 + 0.8 * (i % 2));
+    if (name[0] == 'w')
+        return rp_GenWaveform(RP_CH_1, (i % 2) ? RP_WAVEFORM_SINE : RP_WAVEFORM_TRIANGLE);
+    arb[i % ARB_LENGTH] = (i % 2) ? 0.5 : -0.5;
+    return rp_GenArbWaveform(RP_CH_1, arb, ARB_LENGTH);
+}
+
+static void bench(const char *name, rp_waveform_t waveform, int n) {
+    rp_GenWaveform(RP_CH_1, waveform);
+    double start = timeNow();
+    for (int i = 0; i < n; i++) {
+        if (call(name, i) != RP_OK) {
+            fprintf(stderr, "%s failed\n", name);
+            return;
+        }
+    }
+    double elapsed = timeNow() - start;
+    printf("%-12s %8d calls %10.1f calls/s %10.1f us/call\n", name, n, n / elapsed, elapsed / n * 1e6);
+}
+
+int main(int argc, char **argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 1000;
+    bool board = argc > 2 && strcmp(argv[2], "board") == 0;
+
+    uint8_t *fpga = benchSimOpen();
+    dac[RP_CH_1] = (volatile uint32_t *)(fpga + BENCH_GEN_OFFSET + GEN_CHA_DATA);
+    dac[RP_CH_2] = (volatile uint32_t *)(fpga + BENCH_GEN_OFFSET + GEN_CHB_DATA);
+
+    int r = rp_Init();
+    if (r != RP_OK) {
+        printf("rp_Init() failed: %s\n", rp_GetError(r));
+        return EXIT_FAILURE;
+    }
+    srand(1);
+    check(RP_CH_1);
+    check(RP_CH_2);
+
+    if (board) {
+        rp_Release();
+        benchSimClose();
+        unsetenv("RP_REGMAP_DEV");
+        if (rp_Init() != RP_OK) {
+            fprintf(stderr, "Red Pitaya API init failed!\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (int i = 0; i < ARB_LENGTH; i++)
+        arb[i] = sin(2 * M_PI * i / ARB_LENGTH);
+
+    rp_GenReset();
+    rp_GenAmp(RP_CH_1, 0.5);
+    rp_GenOutEnable(RP_CH_1);
+
+    bench("frequency", RP_WAVEFORM_SINE, n);
+    bench("phase", RP_WAVEFORM_SINE, n);
+    bench("duty", RP_WAVEFORM_PWM, n);
+    bench("waveform", RP_WAVEFORM_SINE, n);
+    bench("arbitrary", RP_WAVEFORM_ARBITRARY, n);
+
+    rp_GenOutDisable(RP_CH_1);
+    rp_Release();
+    if (!board) {
+        benchSimClose();
+    }
+    return benchResult();
+}
@@ -0,0 +1,526 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya long memory history replay test & benchmark.
+ *
+ * Replays a long stream into a librp history (rp_history.h) and checks the
+ * queries against the stream itself. The stream is synthetic, noise on a
+ * slow triangle with rare spikes & dips at known samples, or a recorded one
+ * given as a file of int16 samples. Checks that:
+ *
+ *  - points aligned to the level used are the exact min, max & mean,
+ *  - other points are bounded by their stretch and by its aligned cover,
+ *  - the level used is the finest keeping the start with short enough entries,
+ *  - no spike or dip gets lost however far the view is zoomed out,
+ *  - stretches no longer kept are refused,
+ *  - rp_HistoryFeedAcq() takes the samples of a running acquisition in
+ *    order, from a register simulator file (RP_REGMAP_DEV) with a thread
+ *    playing the FPGA, and counts a lap it missed instead of taking it,
+ *  - the oscilloscope application serves a window of its history to a
+ *    client posting hist_start & hist_stop, as min, max pairs of both
+ *    channels on a time axis spanning the window, and serves it again only
+ *    when the window or the history changed.
+ *
+ * Push rate and query time per stretch length are reported, the latter
+ * should stay flat as a point costs O(log N).
+ *
+ * Usage: history_bench [samples | file.i16]  (default 100000000 synthetic)
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "redpitaya/rp.h"
+#include "bench.h"
+#include "scope_history.h"
+
+#define OSC_CHA      0x00010000   // channel A buffer from the block
+#define OSC_CHB      0x00020000   // channel B buffer from the block
+
+#define CAPACITY     65536
+#define LEVELS       12
+#define CHUNK        16384
+#define QUERIES      1000
+#define MAX_POINTS   1024
+#define MAX_BRUTE    4000000      // longest stretch checked sample by sample
+#define SIGNAL_LEN   1024         // signal length of the scope application
+
+#define SPIKE_PERIOD 9999991
+#define SPIKE_PHASE  4321
+#define DIP_PERIOD   7777777
+#define DIP_PHASE    1234
+
+static uint64_t rnd_state = 88172645463325252ull;
+
+static uint64_t rnd(uint64_t n) {
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 7;
+    rnd_state ^= rnd_state << 17;
+    return rnd_state % n;
+}
+
+/* Noise on a slow triangle, spikes & dips at known samples; fits 14 bits */
+static int16_t synth(uint64_t i) {
+    if (i % SPIKE_PERIOD == SPIKE_PHASE) {
+        return 8000;
+    }
+    if (i % DIP_PERIOD == DIP_PHASE) {
+        return -8000;
+    }
+    int noise = (int)(((uint32_t)(i * 2654435761u) >> 16) & 0xFF) - 128;
+    int tri = (i >> 12) % 1024;
+    return noise + (tri < 512 ? tri : 1023 - tri) - 256;
+}
+
+/* Stream replayed, a recording or the synthetic one */
+static const int16_t *recording;
+static uint64_t stream_len;
+
+static int16_t sample(uint64_t i) {
+    return recording ? recording[i] : synth(i);
+}
+
+typedef struct {
+    int16_t min;
+    int16_t max;
+    double  mean;
+} stretch_t;
+
+static stretch_t brute(uint64_t a, uint64_t b) {
+    stretch_t s = { INT16_MAX, INT16_MIN, 0 };
+
+    for (uint64_t i = a; i < b; i++) {
+        int16_t x = sample(i);
+        s.min = x < s.min ? x : s.min;
+        s.max = x > s.max ? x : s.max;
+        s.mean += x;
+    }
+    s.mean /= b - a;
+    return s;
+}
+
+/* Resolution the history should answer a query with */
+static uint64_t expectedStep(uint64_t total, uint32_t capacity, uint32_t levels,
+                             uint64_t start, uint64_t len, uint32_t size) {
+    uint32_t k = 0;
+    uint64_t span = 1;
+
+    for (; k + 1 < levels; k++, span *= RP_HISTORY_FANOUT) {
+        uint64_t count = total / span;
+        if ((count > capacity ? count - capacity : 0) * span <= start) {
+            break;
+        }
+    }
+    for (; k + 1 < levels && span * RP_HISTORY_FANOUT <= len / size; k++) {
+        span *= RP_HISTORY_FANOUT;
+    }
+    return span;
+}
+
+/* Checks point j of a query against the stream, false if too long to */
+static bool checkPoint(uint64_t start, uint64_t end, uint32_t size, uint64_t step,
+                       uint32_t j, const rp_history_point_t *p) {
+    uint64_t len = end - start;
+    uint64_t a = start + len / size * j + len % size * j / size;
+    uint64_t b = start + len / size * (j + 1) + len % size * (j + 1) / size;
+    uint64_t a0 = a / step * step;
+    uint64_t b0 = (b + step - 1) / step * step;
+
+    if (b0 - a0 > MAX_BRUTE) {
+        return false;
+    }
+    b0 = b0 < stream_len ? b0 : stream_len;
+    stretch_t in = brute(a, b), out = brute(a0, b0);
+
+    if (a == a0 && (b % step == 0 || b == stream_len)) {
+        CHECK(p->min == in.min && p->max == in.max && fabs(p->mean - in.mean) < 0.1 + 1e-5 * fabs(in.mean),
+              "[%lu, %lu) step %lu: %d %d %.3f, expected %d %d %.3f", a, b, step,
+              p->min, p->max, p->mean, in.min, in.max, in.mean);
+    } else {
+        CHECK(p->min >= out.min && p->min <= in.min && p->max <= out.max && p->max >= in.max &&
+              p->mean >= out.min && p->mean <= out.max,
+              "[%lu, %lu) step %lu: %d %d %.3f, bounds %d..%d %d..%d", a, b, step,
+              p->min, p->max, p->mean, out.min, in.min, in.max, out.max);
+    }
+    return true;
+}
+
+static void checkQueries(rp_history_t *h) {
+    static rp_history_point_t points[MAX_POINTS];
+    uint64_t first, end, step;
+    uint32_t checked = 0, brute_checked = 0;
+
+    CHECK(rp_HistoryGetRange(h, &first, &end) == RP_OK && first == 0 && end == stream_len,
+          "range %lu to %lu of %lu samples", first, end, stream_len);
+
+    for (int q = 0; q < QUERIES; q++) {
+        /* stretches of log-uniform length anywhere in the stream */
+        uint64_t len = 1 + (uint64_t) exp(log(stream_len) * rnd(1000001) / 1e6);
+        len = len < stream_len ? len : stream_len;
+        uint64_t start = rnd(stream_len - len + 1);
+        uint32_t size = 1 + rnd(MAX_POINTS);
+
+        uint32_t got = size;
+        int r = rp_HistoryQuery(h, start, start + len, points, &got, &step);
+        CHECK(r == RP_OK, "query [%lu, %lu) failed: %s", start, start + len, rp_GetError(r));
+        if (r != RP_OK) {
+            continue;
+        }
+        size = size < len ? size : len;
+        uint64_t expected = expectedStep(stream_len, CAPACITY, LEVELS, start, len, size);
+        CHECK(got == size && step == expected, "query [%lu, %lu): %u points step %lu, expected %u step %lu",
+              start, start + len, got, step, size, expected);
+        for (int n = 0; n < 3; n++) {
+            uint32_t j = rnd(got);
+            brute_checked += checkPoint(start, start + len, got, step, j, &points[j]);
+        }
+        checked++;
+    }
+    printf("%u queries checked, %u points sample by sample\n", checked, brute_checked);
+}
+
+/* Zoomed out all the way, every spike & dip is in the max & min of its point */
+static void checkExtremes(rp_history_t *h) {
+    static rp_history_point_t points[MAX_POINTS];
+    uint32_t size = 1000, lost = 0, seen = 0;
+    uint64_t step;
+
+    CHECK(rp_HistoryQuery(h, 0, stream_len, points, &size, &step) == RP_OK, "full view query failed");
+    uint64_t len = stream_len;
+    for (uint32_t j = 0; j < size; j++) {
+        uint64_t a = len / size * j + len % size * j / size;
+        uint64_t b = len / size * (j + 1) + len % size * (j + 1) / size;
+        uint64_t s = (a + SPIKE_PERIOD - 1 - SPIKE_PHASE) / SPIKE_PERIOD * SPIKE_PERIOD + SPIKE_PHASE;
+        uint64_t d = (a + DIP_PERIOD - 1 - DIP_PHASE) / DIP_PERIOD * DIP_PERIOD + DIP_PHASE;
+        if (s < b) {
+            seen++;
+            lost += points[j].max != 8000;
+        }
+        if (d < b) {
+            seen++;
+            lost += points[j].min != -8000;
+        }
+    }
+    printf("full view of %u points, step %lu: %u of %u spikes & dips lost\n", size, step, lost, seen);
+    CHECK(lost == 0, "%u spikes & dips lost", lost);
+}
+
+/* Query time per stretch length, newest and oldest stretches */
+static void benchQueries(rp_history_t *h) {
+    static rp_history_point_t points[MAX_POINTS];
+    double fastest = 1e9, slowest = 0;
+
+    printf("%12s %12s %12s %12s %12s\n", "length", "newest step", "oldest step", "newest us", "oldest us");
+    for (uint64_t len = 1000; len <= stream_len; len *= 10) {
+        double us[2];
+        uint64_t steps[2];
+        for (int old = 0; old < 2; old++) {
+            uint64_t start = old ? 0 : stream_len - len;
+            int reps = 0;
+            double t = timeNow();
+            do {
+                uint32_t size = 1000;
+                rp_HistoryQuery(h, start, start + len, points, &size, &steps[old]);
+                reps++;
+            } while (timeNow() - t < 0.05);
+            us[old] = (timeNow() - t) / reps * 1e6;
+            fastest = us[old] < fastest ? us[old] : fastest;
+            slowest = us[old] > slowest ? us[old] : slowest;
+        }
+        printf("%12lu %12lu %12lu %12.1f %12.1f\n", len, steps[0], steps[1], us[0], us[1]);
+    }
+    CHECK(slowest < 10 * fastest, "query time from %.1f to %.1f us", fastest, slowest);
+}
+
+/* Stretches no longer kept are refused */
+static void checkExpiry() {
+    rp_history_t *h;
+    rp_history_point_t points[16];
+    int16_t buf[1000];
+    uint64_t first, end, step;
+    uint32_t size;
+
+    /* 64 entries of 1, 4 & 16 samples keep the latest 1024 */
+    CHECK(rp_HistoryCreate(64, 3, &h) == RP_OK, "create failed");
+    for (int i = 0; i < 10; i++) {
+        for (int n = 0; n < 1000; n++) {
+            buf[n] = synth(i * 1000 + n);
+        }
+        rp_HistoryPush(h, buf, 1000);
+    }
+    rp_HistoryGetRange(h, &first, &end);
+    CHECK(first == 10000 - 1024 && end == 10000, "small history keeps %lu to %lu", first, end);
+    size = 16;
+    CHECK(rp_HistoryQuery(h, first - 1, end, points, &size, &step) == RP_EOOR, "expired stretch taken");
+    size = 16;
+    CHECK(rp_HistoryQuery(h, first, end, points, &size, &step) == RP_OK && step == 16,
+          "oldest stretch, step %lu", step);
+    size = 16;
+    CHECK(rp_HistoryQuery(h, end - 64, end, points, &size, &step) == RP_OK && step == 4,
+          "latest 64 samples, step %lu", step);
+    size = 16;
+    CHECK(rp_HistoryQuery(h, end, end + 100, points, &size, &step) == RP_EOOR, "future stretch taken");
+
+    rp_HistoryReset(h);
+    rp_HistoryGetRange(h, &first, &end);
+    CHECK(first == 0 && end == 0, "reset history keeps %lu to %lu", first, end);
+    rp_HistoryDestroy(h);
+}
+
+/* Oscilloscope registers & buffers of the simulator */
+static volatile uint32_t *osc_wp;
+static volatile uint32_t *osc_cha;
+static volatile uint32_t *osc_chb;
+
+static volatile int fpga_run;
+static volatile uint64_t written;
+static double fpga_rate;
+
+/* Writes the synthetic stream into the buffers at the sampling rate,
+ * channel 2 inverted */
+static void *fpga_thread(void *arg) {
+    double t0 = timeNow();
+
+    while (fpga_run) {
+        uint64_t target = (timeNow() - t0) * fpga_rate;
+        for (uint64_t n = written; n < target; n++) {
+            osc_cha[n % ADC_BUFFER_SIZE] = (uint16_t) synth(n) & 0x3FFF;
+            osc_chb[n % ADC_BUFFER_SIZE] = (uint16_t) -synth(n) & 0x3FFF;
+        }
+        if (target > written) {
+            *osc_wp = (target - 1) % ADC_BUFFER_SIZE;
+            written = target;
+        }
+        usleep(1000);
+    }
+    return NULL;
+}
+
+/* Checks samples from index from on of a history are the stream from some
+ * sample on, returns that sample */
+static int64_t checkFed(rp_history_t *h, uint64_t from, int sign, const char *name) {
+    uint64_t first, end, step;
+
+    rp_HistoryGetRange(h, &first, &end);
+    uint32_t size = end - from;
+    rp_history_point_t *p = malloc(size * sizeof(rp_history_point_t));
+    CHECK(size > 0 && rp_HistoryQuery(h, from, end, p, &size, &step) == RP_OK && step == 1,
+          "%s: query of %u fed samples failed", name, size);
+
+    int64_t offset = -1;
+    for (uint64_t o = 0; o + size <= written && offset < 0; o++) {
+        uint32_t i = 0;
+        while (i < size && p[i].min == sign * synth(o + i)) {
+            i++;
+        }
+        if (i == size) {
+            offset = o;
+        }
+    }
+    CHECK(offset >= 0, "%s: %u samples fed are not a stretch of the stream", name, size);
+    free(p);
+    return offset;
+}
+
+static void checkFeedAcq() {
+    rp_history_t *h[2];
+    uint64_t first, end, end2;
+    uint32_t overruns;
+    pthread_t fpga;
+
+    uint8_t *base = benchSimOpen();
+    osc_wp  = (volatile uint32_t *)(base + BENCH_OSC_OFFSET + 0x18);
+    osc_cha = (volatile uint32_t *)(base + BENCH_OSC_OFFSET + OSC_CHA);
+    osc_chb = (volatile uint32_t *)(base + BENCH_OSC_OFFSET + OSC_CHB);
+
+    int r = rp_Init();
+    if (r != RP_OK) {
+        printf("rp_Init() failed: %s\n", rp_GetError(r));
+        exit(EXIT_FAILURE);
+    }
+    float rate;
+    rp_AcqSetDecimation(RP_DEC_1024);
+    rp_AcqGetSamplingRateHz(&rate);
+    fpga_rate = rate;
+    rp_HistoryCreate(CAPACITY, LEVELS, &h[0]);
+    rp_HistoryCreate(CAPACITY, LEVELS, &h[1]);
+
+    fpga_run = 1;
+    pthread_create(&fpga, NULL, fpga_thread, NULL);
+
+    /* half a second fed every 5 ms */
+    CHECK(rp_HistoryFeedAcq(h[0], h[1]) == RP_OK, "first feed failed");
+    double t = timeNow();
+    while (timeNow() - t < 0.5) {
+        usleep(5000);
+        rp_HistoryFeedAcq(h[0], h[1]);
+    }
+    rp_HistoryGetRange(h[0], &first, &end);
+    rp_HistoryGetRange(h[1], &first, &end2);
+    CHECK(end > 0.4 * rate && end == end2, "fed %lu & %lu samples in 0.5 s at %.0f Hz", end, end2, rate);
+    int64_t o1 = checkFed(h[0], 0, 1, "ch1");
+    int64_t o2 = checkFed(h[1], 0, -1, "ch2");
+    CHECK(o1 == o2, "channels fed from samples %ld & %ld", o1, o2);
+
+    /* the ring, 134 ms long, laps while not fed */
+    usleep(300000);
+    rp_HistoryFeedAcq(h[0], h[1]);
+    rp_HistoryGetOverruns(h[0], &overruns);
+    rp_HistoryGetRange(h[0], &first, &end2);
+    CHECK(overruns == 1 && end2 == end, "lap: %u overruns, %lu samples fed", overruns, end2 - end);
+
+    t = timeNow();
+    while (timeNow() - t < 0.2) {
+        usleep(5000);
+        rp_HistoryFeedAcq(h[0], h[1]);
+    }
+    int64_t o3 = checkFed(h[0], end, 1, "ch1 after the lap");
+    rp_HistoryGetRange(h[0], &first, &end2);
+    CHECK(o3 > o1 + (int64_t) end + 0.25 * rate, "stretch after the lap from sample %ld, before it %ld to %ld",
+          o3, o1, o1 + end);
+    rp_HistoryGetOverruns(h[0], &overruns);
+    printf("fed at %.0f Hz: %lu samples from sample %ld, a lap missed, %lu from sample %ld, %u overruns\n",
+           rate, end, o1, end2 - end, o3, overruns);
+
+    fpga_run = 0;
+    pthread_join(fpga, NULL);
+    rp_HistoryDestroy(h[0]);
+    rp_HistoryDestroy(h[1]);
+    rp_Release();
+    benchSimClose();
+}
+
+static void checkScope() {
+    static float t[SIGNAL_LEN], ch1[SIGNAL_LEN], ch2[SIGNAL_LEN];
+    pthread_t fpga;
+    int len = SIGNAL_LEN;
+
+    uint8_t *base = benchSimOpen();
+    osc_wp  = (volatile uint32_t *)(base + BENCH_OSC_OFFSET + 0x18);
+    osc_cha = (volatile uint32_t *)(base + BENCH_OSC_OFFSET + OSC_CHA);
+    osc_chb = (volatile uint32_t *)(base + BENCH_OSC_OFFSET + OSC_CHB);
+    /* default calibration, the volts are not all 0 */
+    bench_eeprom = "/nonexistent";
+
+    fpga_rate = scopeStart();
+    if (fpga_rate < 0) {
+        printf("scope rp_app_init() failed\n");
+        exit(EXIT_FAILURE);
+    }
+    written = 0;
+    fpga_run = 1;
+    pthread_create(&fpga, NULL, fpga_thread, NULL);
+    usleep(500000);
+
+    int r = scopeHistory(0.3, 0.1, t, ch1, ch2, &len);
+    CHECK(r == 0 && len == SIGNAL_LEN, "scope history window: %d, %d samples", r, len);
+    CHECK(fabsf(t[0] + 0.3) < 1e-3 && fabsf(t[len - 1] + 0.1) < 1e-3,
+          "scope history from %f to %f s", t[0], t[len - 1]);
+    int ordered = 1, bounds = 1, inverted = 1;
+    float lo = ch1[0], hi = ch1[1];
+    for (int i = 0; i < len; i += 2) {
+        ordered &= (i == 0 || t[i] >= t[i - 1]) && t[i + 1] >= t[i];
+        bounds &= ch1[i] <= ch1[i + 1] && ch2[i] <= ch2[i + 1];
+        /* ch2 is ch1 inverted, so is the envelope but for the offsets */
+        inverted &= fabsf(ch1[i + 1] + ch2[i] - (ch1[1] + ch2[0])) < 1e-4 &&
+                    fabsf(ch1[i] + ch2[i + 1] - (ch1[0] + ch2[1])) < 1e-4;
+        lo = fminf(lo, ch1[i]);
+        hi = fmaxf(hi, ch1[i + 1]);
+    }
+    CHECK(ordered, "scope history time axis out of order");
+    CHECK(bounds, "scope history min above max");
+    CHECK(inverted, "scope history channels are not the inverted stream");
+    CHECK(hi > lo, "scope history flat at %f V", lo);
+    printf("scope history 0.3 to 0.1 s back: %d points, ch1 %.3f to %.3f V\n", len / 2, lo, hi);
+
+    len = SIGNAL_LEN;
+    r = scopeHistory(100, 0, t, ch1, ch2, &len);
+    CHECK(r == -1, "scope history window not kept: %d", r);
+
+    /* a window is served again only when it or the history changed */
+    fpga_run = 0;
+    pthread_join(fpga, NULL);
+    usleep(50000);
+    len = SIGNAL_LEN;
+    scopeHistory(0.3, 0.1, t, ch1, ch2, &len);
+    len = SIGNAL_LEN;
+    r = scopeHistory(0.3, 0.1, t, ch1, ch2, &len);
+    CHECK(r == -1, "unchanged scope history window served again: %d", r);
+    len = SIGNAL_LEN;
+    r = scopeHistory(0.2, 0.1, t, ch1, ch2, &len);
+    CHECK(r == 0, "other scope history window: %d", r);
+    len = SIGNAL_LEN;
+    r = scopeHistory(0.2, 0.1, t, ch1, ch2, &len);
+    CHECK(r == -1, "unchanged scope history window served again: %d", r);
+
+    scopeStop();
+    benchSimClose();
+}
+
+int main(int argc, char **argv) {
+    static int16_t buf[CHUNK];
+    rp_history_t *h;
+
+    stream_len = 100000000;
+    if (argc > 1 && isdigit((unsigned char) argv[1][0])) {
+        stream_len = strtoull(argv[1], NULL, 0);
+    } else if (argc > 1) {
+        struct stat st;
+        int fd = open(argv[1], O_RDONLY);
+        if (fd < 0 || fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(int16_t)) {
+            perror(argv[1]);
+            return EXIT_FAILURE;
+        }
+        recording = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (recording == MAP_FAILED) {
+            perror("mmap");
+            return EXIT_FAILURE;
+        }
+        stream_len = st.st_size / sizeof(int16_t);
+    }
+
+    CHECK(rp_HistoryCreate(CAPACITY, LEVELS, &h) == RP_OK, "create failed");
+    double t = timeNow();
+    for (uint64_t i = 0; i < stream_len; i += CHUNK) {
+        uint32_t n = stream_len - i < CHUNK ? stream_len - i : CHUNK;
+        if (recording) {
+            rp_HistoryPush(h, recording + i, n);
+        } else {
+            for (uint32_t j = 0; j < n; j++) {
+                buf[j] = synth(i + j);
+            }
+            rp_HistoryPush(h, buf, n);
+        }
+    }
+    t = timeNow() - t;
+    printf("%s stream of %lu samples pushed in %.2f s, %.1f M samples/s\n",
+           recording ? "recorded" : "synthetic", stream_len, t, stream_len / t / 1e6);
+
+    checkQueries(h);
+    if (!recording) {
+        checkExtremes(h);
+    }
+    benchQueries(h);
+    rp_HistoryDestroy(h);
+
+    checkExpiry();
+    checkFeedAcq();
+    checkScope();
+
+    return benchResult();
+}
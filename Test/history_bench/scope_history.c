@@ -0,0 +1,73 @@
+/**
+ * $Id: $
+ *
+ * @brief Oscilloscope application side of the history benchmark.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "main.h"
+#include "worker.h"
+#include "fpga.h"
+#include "scope_history.h"
+
+static float **signals;
+
+/* Posts the full parameter list as the web UI does */
+static void post(float xmin, float xmax) {
+    rp_app_params_t *p;
+
+    if (rp_get_params(&p) < 0)
+        return;
+    p[TRIG_MODE_PARAM].value = 1;
+    p[MIN_GUI_PARAM].value = xmin;
+    p[MAX_GUI_PARAM].value = xmax;
+    rp_set_params(p, PARAMS_NUM);
+    rp_clean_params(p);
+}
+
+double scopeStart(void) {
+    if (rp_app_init() < 0 || rp_create_signals(&signals) < 0)
+        return -1;
+    /* 10 ms time base, the server forces the time units on the first post */
+    for (int i = 0; i < 3; i++)
+        post(0, 10000);
+    return c_osc_fpga_smpl_freq / RP_OSC_HIST_MIN_DEC;
+}
+
+int scopeHistory(float t_start, float t_stop, float *t, float *ch1, float *ch2, int *len) {
+    rp_app_params_t hist[] = {
+        { "hist_start", t_start, 0, 0, 0, 0 },
+        { "hist_stop",  t_stop,  0, 0, 0, 0 },
+        { NULL,         0,       0, 0, 0, 0 }
+    };
+    rp_app_params_t *p;
+    int ret, num, sig_len, unit;
+
+    /* only the window, as a client zoomed out of the live view */
+    rp_set_params(hist, 2);
+    ret = rp_get_signals(&signals, &num, &sig_len);
+
+    if (rp_get_params(&p) < 0)
+        return -1;
+    unit = rp_osc_get_time_unit_factor(p[TIME_UNIT_PARAM].value);
+    rp_clean_params(p);
+
+    if (sig_len > *len)
+        sig_len = *len;
+    for (int i = 0; i < sig_len; i++) {
+        t[i] = signals[0][i] / unit;
+        ch1[i] = signals[1][i];
+        ch2[i] = signals[2][i];
+    }
+    *len = sig_len;
+    return ret;
+}
+
+void scopeStop(void) {
+    rp_cleanup_signals(&signals);
+    rp_app_exit();
+}
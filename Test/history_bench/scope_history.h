@@ -0,0 +1,27 @@
+/**
+ * $Id: $
+ *
+ * @brief Oscilloscope application side of the history benchmark.
+ *
+ * The oscilloscope's calibration types clash with those of rp.h, so the
+ * bench reaches the application through these calls only.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#ifndef __SCOPE_HISTORY_H
+#define __SCOPE_HISTORY_H
+
+/** Starts the application on the register simulator in normal trigger mode
+ *  at decimation 1024, where it keeps a history, returns its sampling rate
+ *  [Hz] or -1 */
+double scopeStart(void);
+
+/** Posts a history window from t_start to t_stop [s] back as a client does
+ *  and gets the signals, times in [s]; t, ch1 & ch2 take *len samples.
+ *  Returns that of rp_get_signals() */
+int scopeHistory(float t_start, float t_stop, float *t, float *ch1, float *ch2, int *len);
+
+void scopeStop(void);
+
+#endif /* __SCOPE_HISTORY_H */
@@ -0,0 +1,258 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya IST sensor control loop benchmark.
+ *
+ * Runs the IST controller of the scope+istsensor application against a
+ * file-backed fake XADC & slow DAC register page, selected with
+ * regmap_open_fd(), so no Red Pitaya is needed. A plant thread closes the
+ * loop: the IST sensor temperature follows the heater DAC output with a
+ * first order lag, the LM35 stays at ambient.
+ *
+ * Two loops are compared for the same run time:
+ *
+ *  - legacy: the old ISTctrl_time() scheme, the page is mapped and
+ *    unmapped around every step, the loop is paced by usleep(10) and the
+ *    log samples are written with fprintf() from the loop,
+ *  - timer: the control loop thread paced by a periodic timerfd, the log
+ *    samples go through the ring to the writer thread.
+ *
+ * The achieved loop rate and the period (legacy) or wake-up jitter (timer)
+ * statistics are reported, with the jitter histogram of the timer loop.
+ *
+ * Usage: ist_ctrl_bench [DIR] [RT priority] [run time ms]
+ *        (default /tmp, 0 - default scheduling, 2000)
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "regmap.h"
+#include "ISTctrl.h"
+#include "bench.h"
+
+#define T_AMB      25.0    // LM35 & IST sensor at rest [degC]
+#define PLANT_GAIN 10.0    // IST sensor rise per heater DAC volt [degC/V]
+#define PLANT_TAU  0.2     // IST sensor time constant [s]
+#define PLANT_US   1000    // Plant update period [us]
+
+/*
+ * Plant: works on its own mapping of the fake register page, the way the
+ * FPGA sees the same registers.
+ */
+static volatile amsReg_t *plant_ams;
+static volatile int       plant_run = 1;
+static double             plant_ist = T_AMB;
+
+/* XADC raw value of AI0/AI1 for a temperature, inverse of AmsConversion() */
+static uint32_t plant_raw(double temp, double scale)
+{
+    double raw = temp / scale / ((30.0 + 4.99) / 4.99) / 0.5 * 0x7ff;
+    return raw > 0x7ff ? 0x7ff : (uint32_t)round(raw);
+}
+
+static void *plant_thread(void *arg)
+{
+    const double dt = PLANT_US * 1e-6;
+
+    while (plant_run) {
+        double heat = AmsConversion(eAmsAO0, plant_ams->dac[0]);
+        plant_ist += (T_AMB + PLANT_GAIN * heat - plant_ist) * dt / PLANT_TAU;
+        plant_ams->aif[0] = plant_raw(plant_ist, 100);
+        usleep(PLANT_US);
+    }
+    return NULL;
+}
+
+/* The old loop: ISTctrl_time() with the mapping done in every step */
+static void legacy_run(int fd, FILE *log, double run_s, double *rate,
+                       double *per_mean, double *per_rms, double *per_max)
+{
+    double t0 = timeNow(), t = t0, last = t0, sum = 0, sum2 = 0, max = 0;
+    long n = 0, filecnt = 0;
+
+    while (t - t0 < run_s) {
+        void *map = mmap(0, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        float out;
+
+        if (map == MAP_FAILED) {
+            perror("mmap");
+            exit(1);
+        }
+        out = ISTctrl();
+        if (++filecnt > 10) {
+            filecnt = 0;
+            fprintf(log, "%f,%f,%f\n", T_AMB, T_AMB, out);
+        }
+        munmap(map, MAP_SIZE);
+        usleep(10);
+
+        t = timeNow();
+        if (n > 0) {
+            double p = t - last;
+            sum += p;
+            sum2 += p * p;
+            if (p > max)
+                max = p;
+        }
+        last = t;
+        n++;
+    }
+    *rate = n / (t - t0);
+    *per_mean = sum / (n - 1);
+    *per_rms = sqrt(sum2 / (n - 1) - *per_mean * *per_mean);
+    *per_max = max;
+}
+
+static long count_lines(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    long lines = 0;
+    int c;
+
+    if (f == NULL)
+        return -1;
+    while ((c = fgetc(f)) != EOF)
+        if (c == '\n')
+            lines++;
+    fclose(f);
+    return lines;
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = argc > 1 ? argv[1] : "/tmp";
+    int rt_prio = argc > 2 ? atoi(argv[2]) : 0;
+    double run_s = (argc > 3 ? atoi(argv[3]) : 2000) * 1e-3;
+    char regs[256], legacy_log[256], timer_log[256];
+    double rate, per_mean, per_rms, per_max, t0, t1;
+    double jit_mean, jit_rms;
+    uint64_t acc = 0, p99 = 0;
+    rp_app_params_t params[PARAMS_NUM];
+    pthread_t plant;
+    ist_stats_t st;
+    long lines;
+    FILE *log;
+    int fd, i;
+
+    snprintf(regs, sizeof(regs), "%s/ist_ctrl_bench.regs", dir);
+    snprintf(legacy_log, sizeof(legacy_log), "%s/ist_ctrl_bench_legacy.dat", dir);
+    snprintf(timer_log, sizeof(timer_log), "%s/ist_ctrl_bench_timer.dat", dir);
+
+    /* Fake register page, both sensors at ambient */
+    fd = open(regs, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, MAP_SIZE) < 0) {
+        perror(regs);
+        return 1;
+    }
+    plant_ams = mmap(0, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (plant_ams == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    plant_ams->aif[0] = plant_raw(T_AMB, 100);
+    plant_ams->aif[1] = plant_raw(T_AMB, 100);
+
+    pid_init();
+    if (regmap_open_fd(fd, IST_AMS_ADDR) < 0 || ISTctrl_Init(IST_AMS_ADDR) < 0)
+        return 1;
+    printf("IST sensor calibration: %f\n", ISTsnsAdj);
+    CHECK(fabs(ISTsnsAdj - 0.1) < 0.01, "calibration %f, expected 0.1", ISTsnsAdj);
+    IST_EN = 1;
+    IST2file = 1;
+    TimeWin = 1e6;
+    pthread_create(&plant, NULL, plant_thread, NULL);
+
+    /* legacy */
+    log = fopen(legacy_log, "w");
+    if (log == NULL) {
+        perror(legacy_log);
+        return 1;
+    }
+    legacy_run(fd, log, run_s, &rate, &per_mean, &per_rms, &per_max);
+    fclose(log);
+    printf("\nlegacy loop (map per step, usleep(10), fprintf):\n");
+    printf("  rate %8.0f Hz, period mean %7.1f us, rms %7.1f us, max %8.1f us\n",
+           rate, per_mean * 1e6, per_rms * 1e6, per_max * 1e6);
+
+    /* timer, the heater starts again from ambient */
+    plant_ams->dac[0] = 0;
+    plant_ist = T_AMB;
+    pid_reset();
+
+    file_ptr = fopen(timer_log, "w");
+    if (file_ptr == NULL) {
+        perror(timer_log);
+        return 1;
+    }
+    fileopen = 1;
+    t0 = timeNow();
+    if (ISTctrl_start(rt_prio) < 0)
+        return 1;
+    usleep(run_s * 1e6);
+    ISTctrl_stop();
+    t1 = timeNow();
+    IST_Closefile();
+    ISTctrl_get_stats(&st);
+
+    jit_mean = st.jit_sum_ns / st.iterations;
+    jit_rms = sqrt(st.jit_sum2_ns / st.iterations - jit_mean * jit_mean);
+    for (i = 0; i < IST_JIT_BINS; i++) {
+        acc += st.jit_hist[i];
+        if (acc * 100 >= st.iterations * 99) {
+            p99 = i + 1;
+            break;
+        }
+    }
+    printf("\ntimer loop (Dt %.0f us, %s scheduling):\n", Dt * 1e6,
+           rt_prio > 0 ? "SCHED_FIFO" : "default");
+    printf("  rate %8.0f Hz, %llu iterations, %llu overruns, %llu log samples dropped\n",
+           (st.iterations + st.overruns) / (t1 - t0),
+           (unsigned long long)st.iterations, (unsigned long long)st.overruns,
+           (unsigned long long)st.log_dropped);
+    printf("  jitter min %7.1f us, mean %7.1f us, rms %7.1f us, p99 < %llu us, max %8.1f us\n",
+           st.jit_min_ns * 1e-3, jit_mean * 1e-3, jit_rms * 1e-3,
+           (unsigned long long)p99, st.jit_max_ns * 1e-3);
+    printf("  histogram [us]:");
+    for (i = 0; i < IST_JIT_BINS; i++) {
+        if (st.jit_hist[i]) {
+            printf(" %s%d:%u", i == IST_JIT_BINS - 1 ? ">=" : "", i, st.jit_hist[i]);
+        }
+    }
+    printf("\n  IST sensor %.2f degC, heater %.3f V\n", plant_ist,
+           AmsConversion(eAmsAO0, plant_ams->dac[0]));
+
+    /* every 11th step is logged */
+    lines = count_lines(timer_log);
+    CHECK(st.iterations > 0, "timer loop did not run");
+    CHECK(lines > 0 && llabs(lines - (long)(st.iterations / 11) + (long)st.log_dropped) <= 2,
+          "%ld log lines for %llu iterations", lines, (unsigned long long)st.iterations);
+
+    plant_run = 0;
+    pthread_join(plant, NULL);
+
+    /* the heater is off once the controller is stopped */
+    params[PID_IST_ENABLE].value = 1;
+    Stop_ISTctrl(params);
+    CHECK(plant_ams->dac[0] == 0, "heater left on: 0x%x", plant_ams->dac[0]);
+
+    munmap((void *)plant_ams, MAP_SIZE);
+    regmap_close();
+    close(fd);
+    unlink(regs);
+    unlink(legacy_log);
+    unlink(timer_log);
+
+    printf("\n%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,423 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya web server JSON writer benchmark.
+ *
+ * Serializes a /data response with 3 signals of 16384 floats (time base,
+ * a sine and a small noise signal, each of the latter two paired with the
+ * time base) plus a set of parameters:
+ *
+ *  - cJSON:  the tree built and printed with cJSON_PrintUnformatted(), as
+ *            the module used to do; its 2d printer now shares
+ *            rp_json_print_sample() with the writer,
+ *  - before: the writer layout with every sample formatted as cJSON's 2d
+ *            printer did before rp_json_print_sample(), which the module
+ *            response time was dominated by,
+ *  - writer: rp_json_writer straight into pool chain buffers,
+ *  - printf: the writer layout with every sample formatted by snprintf(),
+ *            the per-sample cost of the C library.
+ *
+ * The writer must produce the same bytes as cJSON (also across small chain
+ * buffers) and rp_json_print_sample() the same text as snprintf() for the
+ * float samples; the time per response is reported.
+ *
+ * Usage: json_writer_bench [repetitions]  (default 50)
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+
+#include <ngx_config.h>
+#include <ngx_core.h>
+
+#include "cJSON.h"
+#include "rp_json_writer.h"
+#include "bench.h"
+
+#define SIG_NUM   3
+#define SIG_LEN   16384
+#define POOL_SIZE (16 * 1024 * 1024)
+
+static float signals[SIG_NUM][SIG_LEN];
+
+static const struct {
+    const char *name;
+    float       value;
+} params[] = {
+    { "xmin", -1e-3f }, { "xmax", 4.5e-3f }, { "trig_mode", 0 },
+    { "trig_level", 0.125f }, { "gen_freq", 1234.5f }, { "gain_ch1", 1 },
+    { "offset_ch2", -0.0427f }, { "period", 2e-9f }, { "scale", 3e10f },
+    { "min_y", -20000 }, { "\"quoted\"\tname", 7 },
+};
+#define PARAMS_NUM (int)(sizeof(params) / sizeof(params[0]))
+
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Sample formatting as printed before rp_json_print_sample() */
+static u_char *print_sample_ref(u_char *p, double d)
+{
+    const char *fmt = "%.04f";
+
+    if (!(fabs(floor(d) - d) <= DBL_EPSILON && fabs(d) < 1.0e60) &&
+        (fabs(d) < 1.0e-2 || fabs(d) > 1.0e9))
+        fmt = "%.04e";
+    return p + snprintf((char *)p, RP_JSON_SAMPLE_MAX, fmt, d);
+}
+
+/* Sample formatting of cJSON's 2d printer before rp_json_print_sample():
+ * "%.04f" of |d| < 1e9 by integer division, anything else by snprintf() */
+static u_char *print_fixed_before(u_char *p, double d)
+{
+    char digits[16];
+    long long v = (long long)rint(fabs(d) * 10000.0);
+    int n = 0;
+
+    if (signbit(d))
+        *p++ = '-';
+    while (n < 4 || v) {
+        digits[n++] = '0' + (char)(v % 10);
+        v /= 10;
+        if (n == 4)
+            digits[n++] = '.';
+    }
+    if (n == 5)
+        digits[n++] = '0';
+    while (n)
+        *p++ = digits[--n];
+    return p;
+}
+
+static u_char *print_sample_before(u_char *p, double d)
+{
+    if (fabs(floor(d) - d) <= DBL_EPSILON && fabs(d) < 1.0e60) {
+        if (fabs(d) < 1.0e9)
+            return print_fixed_before(p, d);
+        return p + snprintf((char *)p, RP_JSON_SAMPLE_MAX, "%.04f", d);
+    }
+    if (fabs(d) < 1.0e-2 || fabs(d) > 1.0e9)
+        return p + snprintf((char *)p, RP_JSON_SAMPLE_MAX, "%.04e", d);
+    if (isnan(d))
+        return p + snprintf((char *)p, RP_JSON_SAMPLE_MAX, "%.04f", d);
+    return print_fixed_before(p, d);
+}
+
+typedef u_char *(*print_sample_t)(u_char *p, double d);
+
+/* Samples formatted by print, otherwise rp_json_float_pairs() */
+static void float_pairs_ref(rp_json_writer_t *w, const char *key,
+                            const float *x, const float *y, int len,
+                            print_sample_t print)
+{
+    u_char *p;
+    int i;
+
+    rp_json_string(w, NULL, key);
+    p = rp_json_alloc(w, 2);
+    p[0] = ':';
+    p[1] = '[';
+    for (i = 0; i < len; i++) {
+        p = rp_json_alloc(w, 2 * RP_JSON_SAMPLE_MAX + 4);
+        if (p == NULL)
+            return;
+        if (i)
+            *p++ = ',';
+        *p++ = '[';
+        p = print(p, x[i]);
+        *p++ = ',';
+        p = print(p, y[i]);
+        *p++ = ']';
+        w->buf->last = p;
+    }
+    p = rp_json_alloc(w, 1);
+    *p = ']';
+}
+
+static char *print_cjson(ngx_pool_t *pool, size_t *len)
+{
+    cJSON *root, *app, *data, *g1, *sig, *j_params;
+    char *out;
+    int i;
+
+    root = cJSON_CreateObject(pool);
+    cJSON_AddItemToObject(root, "app", app = cJSON_CreateObject(pool), pool);
+    cJSON_AddItemToObject(app, "id", cJSON_CreateString("scope", pool), pool);
+    cJSON_AddItemToObject(root, "datasets", data = cJSON_CreateObject(pool),
+                          pool);
+    cJSON_AddItemToObject(data, "g1", g1 = cJSON_CreateArray(pool), pool);
+    for (i = 1; i < SIG_NUM; i++) {
+        cJSON_AddItemToObject(g1, "g1", sig = cJSON_CreateObject(pool), pool);
+        cJSON_AddItemToObject(sig, "data",
+                              cJSON_Create2dFloatArray(signals[0], signals[i],
+                                                       SIG_LEN, pool), pool);
+    }
+    cJSON_AddItemToObject(data, "params", j_params = cJSON_CreateObject(pool),
+                          pool);
+    for (i = 0; i < PARAMS_NUM; i++)
+        cJSON_AddItemToObject(j_params, params[i].name,
+                              cJSON_CreateNumber(params[i].value, pool), pool);
+    cJSON_AddItemToObject(root, "status", cJSON_CreateString("OK", pool),
+                          pool);
+
+    out = cJSON_PrintUnformatted(root, pool);
+    cJSON_Delete(root, pool);
+    *len = out ? strlen(out) : 0;
+    return out;
+}
+
+static ngx_chain_t *print_writer(ngx_pool_t *pool, size_t chunk,
+                                 print_sample_t ref, size_t *len)
+{
+    rp_json_writer_t w;
+    int i;
+
+    rp_json_init(&w, pool, chunk);
+    rp_json_object_begin(&w, NULL);
+    rp_json_object_begin(&w, "app");
+    rp_json_string(&w, "id", "scope");
+    rp_json_object_end(&w);
+    rp_json_object_begin(&w, "datasets");
+    rp_json_array_begin(&w, "g1");
+    for (i = 1; i < SIG_NUM; i++) {
+        rp_json_object_begin(&w, NULL);
+        if (ref)
+            float_pairs_ref(&w, "data", signals[0], signals[i], SIG_LEN, ref);
+        else
+            rp_json_float_pairs(&w, "data", signals[0], signals[i], SIG_LEN);
+        rp_json_object_end(&w);
+    }
+    rp_json_array_end(&w);
+    rp_json_object_begin(&w, "params");
+    for (i = 0; i < PARAMS_NUM; i++)
+        rp_json_number(&w, params[i].name, params[i].value);
+    rp_json_object_end(&w);
+    rp_json_object_end(&w);
+    rp_json_string(&w, "status", "OK");
+    rp_json_object_end(&w);
+
+    return rp_json_finish(&w, len);
+}
+
+/* Compares the chain with text, counts the buffers */
+static int chain_equals(ngx_chain_t *cl, const char *text, size_t len,
+                        int *bufs)
+{
+    size_t n;
+
+    for (*bufs = 0; cl; cl = cl->next, (*bufs)++) {
+        n = cl->buf->last - cl->buf->pos;
+        if (n > len || memcmp(cl->buf->pos, text, n))
+            return 0;
+        text += n;
+        len -= n;
+        if (!cl->next && !cl->buf->last_buf)
+            return 0;
+    }
+    return len == 0;
+}
+
+static void check_sample(double d)
+{
+    u_char a[RP_JSON_SAMPLE_MAX + 1], b[RP_JSON_SAMPLE_MAX + 1];
+    u_char *ea = rp_json_print_sample(a, d), *eb = print_sample_ref(b, d);
+
+    *ea = *eb = 0;
+    CHECK(ea - a == eb - b && !memcmp(a, b, ea - a),
+          "sample %.9g: \"%s\" instead of \"%s\"", d, a, b);
+}
+
+/* Formatting of the float samples against the C library */
+static void check_samples(void)
+{
+    static const double special[] = {
+        0, -0.0, 1, -1, 0.5, 0.03125, -0.03125, 0.00005, 0.99995, 9.99995,
+        0.00999995, 0.0099999, 1e-8, 1.5e-8, 9.9999e-9, 1e-3, 1e-2, 0.01,
+        999999999.5, 1e9, -1e9, 1e10, 3e38, FLT_MAX, -FLT_MAX, FLT_MIN,
+        1e-30, 4294967296.0, 123456.789, NAN, INFINITY, -INFINITY,
+    };
+    uint32_t bits;
+    float f;
+    int i, j;
+
+    for (i = 0; i < (int)(sizeof(special) / sizeof(special[0])); i++) {
+        check_sample(special[i]);
+        check_sample((float)special[i]);
+    }
+
+    /* ties of the 4th decimal: k / 2^j */
+    for (j = 1; j <= 24; j++)
+        for (i = 1; i < 4096; i += 3)
+            check_sample(ldexp(i, -j));
+
+    /* all float exponents, a few million bit patterns */
+    for (bits = 0; bits < 0xff000000u; bits += 997) {
+        memcpy(&f, &bits, sizeof(f));
+        check_sample(f);
+    }
+}
+
+/* Writer against cJSON for numbers, strings, nesting and empty containers */
+static void check_layout(ngx_pool_t *pool)
+{
+    static const double numbers[] = {
+        0, -0.0, 1, -7, 2147483647.0, -2147483648.0, 3e9, 0.5, 1e-4, -2.5e-7,
+        1e10, 123.456, 1e60, 1e70, NAN, INFINITY,
+    };
+    static const float xs[] = { 0, 1, 2 }, ys[] = { 0.5f, -1e-5f, 1e12f };
+    rp_json_writer_t w;
+    cJSON *root, *arr, *obj;
+    ngx_chain_t *out;
+    char *text, str[40];
+    size_t len;
+    int i, bufs;
+
+    ngx_reset_pool(pool);
+    for (i = 0; i < 31; i++)
+        str[i] = i + 1;
+    strcpy(str + 31, "\"\\/end");
+
+    root = cJSON_CreateObject(pool);
+    cJSON_AddItemToObject(root, "numbers", arr = cJSON_CreateArray(pool),
+                          pool);
+    for (i = 0; i < (int)(sizeof(numbers) / sizeof(numbers[0])); i++)
+        cJSON_AddItemToArray(arr, cJSON_CreateNumber(numbers[i], pool));
+    cJSON_AddItemToObject(root, str, cJSON_CreateString(str, pool), pool);
+    cJSON_AddItemToObject(root, "empty", cJSON_CreateObject(pool), pool);
+    cJSON_AddItemToObject(root, "none", cJSON_CreateArray(pool), pool);
+    cJSON_AddItemToObject(root, "x", cJSON_Create2dFloatArray(xs, NULL, 3,
+                                                              pool), pool);
+    cJSON_AddItemToObject(root, "y", cJSON_Create2dFloatArray(NULL, ys, 3,
+                                                              pool), pool);
+    cJSON_AddItemToObject(root, "xy", cJSON_Create2dFloatArray(xs, ys, 0,
+                                                               pool), pool);
+    cJSON_AddItemToObject(root, "o", obj = cJSON_CreateObject(pool), pool);
+    cJSON_AddItemToObject(obj, "s", cJSON_CreateString("", pool), pool);
+    text = cJSON_PrintUnformatted(root, pool);
+
+    rp_json_init(&w, pool, 7);
+    rp_json_object_begin(&w, NULL);
+    rp_json_array_begin(&w, "numbers");
+    for (i = 0; i < (int)(sizeof(numbers) / sizeof(numbers[0])); i++)
+        rp_json_number(&w, NULL, numbers[i]);
+    rp_json_array_end(&w);
+    rp_json_string(&w, str, str);
+    rp_json_object_begin(&w, "empty");
+    rp_json_object_end(&w);
+    rp_json_array_begin(&w, "none");
+    rp_json_array_end(&w);
+    rp_json_float_pairs(&w, "x", xs, NULL, 3);
+    rp_json_float_pairs(&w, "y", NULL, ys, 3);
+    rp_json_float_pairs(&w, "xy", xs, ys, 0);
+    rp_json_object_begin(&w, "o");
+    rp_json_string(&w, "s", "");
+    rp_json_object_end(&w);
+    rp_json_object_end(&w);
+    out = rp_json_finish(&w, &len);
+
+    CHECK(text && out && len == strlen(text) &&
+          chain_equals(out, text, len, &bufs),
+          "writer differs from cJSON: %s", text ? text : "(null)");
+
+    /* unbalanced nesting fails */
+    rp_json_init(&w, pool, 0);
+    rp_json_object_begin(&w, NULL);
+    CHECK(rp_json_finish(&w, &len) == NULL, "unbalanced writer finished");
+    rp_json_object_end(&w);
+    rp_json_object_end(&w);
+    CHECK(rp_json_finish(&w, &len) == NULL, "unbalanced writer finished");
+}
+
+int main(int argc, char *argv[])
+{
+    int reps = (argc > 1) ? atoi(argv[1]) : 50;
+    ngx_pool_t *pool = ngx_create_pool(POOL_SIZE);
+    ngx_chain_t *out;
+    char *text;
+    size_t text_len, len;
+    double t, t_cjson, t_before, t_writer, t_ref;
+    int i, bufs;
+
+    if (pool == NULL || reps < 1) {
+        fprintf(stderr, "Usage: %s [repetitions]\n", argv[0]);
+        return 1;
+    }
+
+    srand(1);
+    for (i = 0; i < SIG_LEN; i++) {
+        signals[0][i] = i;
+        signals[1][i] = 0.8f * sinf(2 * M_PI * i / 1000.0f) + 0.1f;
+        signals[2][i] = 2e-3f * (rand() / (float)RAND_MAX - 0.5f);
+    }
+
+    check_samples();
+    check_layout(pool);
+
+    /* same response from all four, also split in small buffers */
+    ngx_reset_pool(pool);
+    text = print_cjson(pool, &text_len);
+    out = print_writer(pool, 0, NULL, &len);
+    CHECK(text && out && chain_equals(out, text, text_len, &bufs),
+          "writer response differs from cJSON");
+    out = print_writer(pool, 1000, NULL, &len);
+    CHECK(out && chain_equals(out, text, text_len, &bufs),
+          "writer response in 1000 byte chunks differs from cJSON");
+    out = print_writer(pool, 0, print_sample_before, &len);
+    CHECK(out && chain_equals(out, text, text_len, &bufs),
+          "former cJSON response differs from cJSON");
+    out = print_writer(pool, 0, print_sample_ref, &len);
+    CHECK(out && chain_equals(out, text, text_len, &bufs),
+          "snprintf() response differs from cJSON");
+
+    t = now();
+    for (i = 0; i < reps; i++) {
+        ngx_reset_pool(pool);
+        text = print_cjson(pool, &len);
+    }
+    t_cjson = (now() - t) / reps;
+
+    t = now();
+    for (i = 0; i < reps; i++) {
+        ngx_reset_pool(pool);
+        out = print_writer(pool, 0, print_sample_before, &len);
+    }
+    t_before = (now() - t) / reps;
+
+    t = now();
+    for (i = 0; i < reps; i++) {
+        ngx_reset_pool(pool);
+        out = print_writer(pool, 0, NULL, &len);
+    }
+    t_writer = (now() - t) / reps;
+    chain_equals(out, text, text_len, &bufs);
+
+    t = now();
+    for (i = 0; i < reps; i++) {
+        ngx_reset_pool(pool);
+        out = print_writer(pool, 0, print_sample_ref, &len);
+    }
+    t_ref = (now() - t) / reps;
+
+    printf("%d x %d floats, %zu bytes of JSON, %d repetitions\n",
+           SIG_NUM, SIG_LEN, text_len, reps);
+    printf("  cJSON:  %8.3f ms\n", t_cjson * 1e3);
+    printf("  before: %8.3f ms\n", t_before * 1e3);
+    printf("  writer: %8.3f ms  (%d buffers, %.1fx cJSON, %.1fx before)\n",
+           t_writer * 1e3, bufs, t_cjson / t_writer, t_before / t_writer);
+    printf("  printf: %8.3f ms\n", t_ref * 1e3);
+
+    ngx_destroy_pool(pool);
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
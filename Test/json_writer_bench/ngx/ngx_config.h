@@ -0,0 +1,16 @@
+/**
+ * $Id: $
+ *
+ * @brief Minimal nginx configuration header for the JSON writer benchmark,
+ * see ngx_core.h.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#ifndef _NGX_CONFIG_H_INCLUDED_
+#define _NGX_CONFIG_H_INCLUDED_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#endif /* _NGX_CONFIG_H_INCLUDED_ */
@@ -0,0 +1,133 @@
+/**
+ * $Id: $
+ *
+ * @brief Minimal nginx core API for the JSON writer benchmark.
+ *
+ * Just enough of ngx_core.h to build cJSON.c and rp_json_writer.c of the
+ * web server module without nginx. The pool is a bump allocator over one
+ * malloc()-ed block, like an nginx pool without its large allocations;
+ * ngx_pfree() does nothing.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef _NGX_CORE_H_INCLUDED_
+#define _NGX_CORE_H_INCLUDED_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef unsigned char u_char;
+typedef intptr_t      ngx_int_t;
+typedef uintptr_t     ngx_uint_t;
+
+#define NGX_OK     0
+#define NGX_ERROR -1
+
+typedef struct ngx_pool_s {
+    u_char *start;
+    u_char *last;
+    u_char *end;
+} ngx_pool_t;
+
+typedef struct ngx_buf_s {
+    u_char   *pos;
+    u_char   *last;
+    u_char   *start;
+    u_char   *end;
+    unsigned  temporary:1;
+    unsigned  last_buf:1;
+    unsigned  last_in_chain:1;
+} ngx_buf_t;
+
+typedef struct ngx_chain_s {
+    ngx_buf_t          *buf;
+    struct ngx_chain_s *next;
+} ngx_chain_t;
+
+#define ngx_memcpy(d, s, n)  memcpy(d, s, n)
+#define ngx_cpymem(d, s, n)  (((u_char *)memcpy(d, s, n)) + (n))
+#define ngx_memset(p, c, n)  memset(p, c, n)
+#define ngx_memzero(p, n)    memset(p, 0, n)
+
+static inline ngx_pool_t *ngx_create_pool(size_t size)
+{
+    ngx_pool_t *p = malloc(sizeof(ngx_pool_t));
+
+    if(p == NULL) {
+        return NULL;
+    }
+    p->start = p->last = malloc(size);
+    if(p->start == NULL) {
+        free(p);
+        return NULL;
+    }
+    p->end = p->start + size;
+    return p;
+}
+
+static inline void ngx_reset_pool(ngx_pool_t *p)
+{
+    p->last = p->start;
+}
+
+static inline void ngx_destroy_pool(ngx_pool_t *p)
+{
+    free(p->start);
+    free(p);
+}
+
+static inline void *ngx_palloc(ngx_pool_t *p, size_t size)
+{
+    u_char *m = (u_char *)(((uintptr_t)p->last + 7) & ~(uintptr_t)7);
+
+    if((size_t)(p->end - m) < size) {
+        return NULL;
+    }
+    p->last = m + size;
+    return m;
+}
+
+static inline void *ngx_pcalloc(ngx_pool_t *p, size_t size)
+{
+    void *m = ngx_palloc(p, size);
+
+    if(m) {
+        memset(m, 0, size);
+    }
+    return m;
+}
+
+static inline ngx_int_t ngx_pfree(ngx_pool_t *p, void *m)
+{
+    return NGX_OK;
+}
+
+static inline ngx_buf_t *ngx_create_temp_buf(ngx_pool_t *p, size_t size)
+{
+    ngx_buf_t *b = ngx_pcalloc(p, sizeof(ngx_buf_t));
+
+    if(b == NULL) {
+        return NULL;
+    }
+    b->start = ngx_palloc(p, size);
+    if(b->start == NULL) {
+        return NULL;
+    }
+    b->pos = b->last = b->start;
+    b->end = b->start + size;
+    b->temporary = 1;
+    return b;
+}
+
+static inline ngx_chain_t *ngx_alloc_chain_link(ngx_pool_t *p)
+{
+    return ngx_palloc(p, sizeof(ngx_chain_t));
+}
+
+#endif /* _NGX_CORE_H_INCLUDED_ */
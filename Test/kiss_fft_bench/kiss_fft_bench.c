@@ -0,0 +1,248 @@
+/**
+ * $Id: $
+ *
+ * @brief Shared kiss_fft benchmark and accuracy test.
+ *
+ * For the real FFT lengths used by the applications (1k - 64k) measures the
+ * forward and inverse transform times, the accuracy of the forward spectrum
+ * against a direct DFT in long double on a subset of bins and, for floating
+ * point, the error of the inverse of the forward transform. Also compares
+ * getting a state from the plan cache with allocating it.
+ *
+ * The same executable is built for every precision of the library and for
+ * the former build of the per-application copies (ref). The ref spectra can
+ * be written to a file and read by the others to check them against it.
+ *
+ * Usage: kiss_fft_bench [-w file | -r file]
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#include "kiss_fftr.h"
+#include "kiss_fft_plan.h"
+#include "bench.h"
+
+#define N_MIN    1024
+#define N_MAX    (64 * 1024)
+#define BINS     64
+#define T_MEAS   0.2
+
+/* Least SNR [dB] of a spectrum of n points */
+#if defined(FIXED_POINT)
+#define VARIANT  "int16"
+/* Q15 input, every stage scales by 1/radix: the output rms falls to a few
+ * LSBs and the SNR with it, by 3 dB per doubling of n */
+#define MIN_SNR(n)  (75 - 10 * log10(n))
+#elif defined(KISS_FFT_FLOAT)
+#define VARIANT  "float"
+#define MIN_SNR(n)  120
+#elif defined(KISS_FFT_NO_VEC)
+#define VARIANT  "ref"
+#define MIN_SNR(n)  280
+#else
+#define VARIANT  "double"
+#define MIN_SNR(n)  280
+#endif
+
+static double x[N_MAX];
+static kiss_fft_scalar in[N_MAX], out[N_MAX];
+static kiss_fft_cpx spec[N_MAX / 2 + 1];
+static double ref[N_MAX + 2];
+static long double ctab[N_MAX], stab[N_MAX];
+
+/* The same signal in every variant, uniform in [-0.5, 0.5) */
+static void makeSignal(int n) {
+    uint32_t seed = 12345;
+
+    for (int i = 0; i < n; i++) {
+        seed = seed * 1664525 + 1013904223;
+        x[i] = (seed >> 8) / 16777216.0 - 0.5;
+#ifdef FIXED_POINT
+        in[i] = lrint(x[i] * 32767);
+#else
+        in[i] = x[i];
+#endif
+    }
+}
+
+/* Spectrum bin in the scale of a plain double transform */
+static void bin(int n, int k, double *re, double *im) {
+#ifdef FIXED_POINT
+    *re = spec[k].r * (double) n / 32767;
+    *im = spec[k].i * (double) n / 32767;
+#else
+    *re = spec[k].r;
+    *im = spec[k].i;
+#endif
+}
+
+static double snrDb(double sig2, double err2) {
+    return err2 > 0 ? 10 * log10(sig2 / err2) : INFINITY;
+}
+
+/* SNR of BINS bins of the spectrum against a direct DFT */
+static double checkDft(int n) {
+    double sig2 = 0, err2 = 0;
+
+    for (int i = 0; i < n; i++) {
+        ctab[i] = cosl(2 * M_PI * (long double) i / n);
+        stab[i] = -sinl(2 * M_PI * (long double) i / n);
+    }
+    for (int j = 0; j < BINS; j++) {
+        int k = j == BINS - 1 ? n / 2 : (int) ((long) j * 7919 % (n / 2));
+        long double re = 0, im = 0;
+        double r, i;
+
+        for (int t = 0, idx = 0; t < n; t++) {
+            re += x[t] * ctab[idx];
+            im += x[t] * stab[idx];
+            idx += k;
+            if (idx >= n)
+                idx -= n;
+        }
+        bin(n, k, &r, &i);
+        sig2 += (double) (re * re + im * im);
+        err2 += (r - re) * (r - re) + (i - im) * (i - im);
+    }
+    return snrDb(sig2, err2);
+}
+
+/* SNR of the whole spectrum against the reference spectrum */
+static double checkRef(int n) {
+    double sig2 = 0, err2 = 0;
+
+    for (int k = 0; k <= n / 2; k++) {
+        double r, i;
+        bin(n, k, &r, &i);
+        sig2 += ref[2 * k] * ref[2 * k] + ref[2 * k + 1] * ref[2 * k + 1];
+        err2 += (r - ref[2 * k]) * (r - ref[2 * k]) + (i - ref[2 * k + 1]) * (i - ref[2 * k + 1]);
+    }
+    return snrDb(sig2, err2);
+}
+
+/* SNR of the inverse of the forward transform */
+static double checkRoundTrip(int n, kiss_fftr_cfg inv) {
+#ifdef FIXED_POINT
+    return NAN;
+#else
+    double sig2 = 0, err2 = 0;
+
+    kiss_fftri(inv, spec, out);
+    for (int i = 0; i < n; i++) {
+        double e = out[i] / n - x[i];
+        sig2 += x[i] * x[i];
+        err2 += e * e;
+    }
+    return snrDb(sig2, err2);
+#endif
+}
+
+/* Time of one transform [us] */
+static double timeFwd(kiss_fftr_cfg cfg) {
+    double t = timeNow(), dt;
+    int n = 0;
+
+    do {
+        kiss_fftr(cfg, in, spec);
+        n++;
+    } while ((dt = timeNow() - t) < T_MEAS || n < 3);
+    return dt / n * 1e6;
+}
+
+static double timeInv(kiss_fftr_cfg cfg) {
+    double t = timeNow(), dt;
+    int n = 0;
+
+    do {
+        kiss_fftri(cfg, spec, out);
+        n++;
+    } while ((dt = timeNow() - t) < T_MEAS || n < 3);
+    return dt / n * 1e6;
+}
+
+int main(int argc, char **argv) {
+    FILE *fw = NULL, *fr = NULL;
+
+    if (argc == 3 && !strcmp(argv[1], "-w"))
+        fw = fopen(argv[2], "wb");
+    else if (argc == 3 && !strcmp(argv[1], "-r"))
+        fr = fopen(argv[2], "rb");
+    else if (argc != 1) {
+        fprintf(stderr, "Usage: %s [-w file | -r file]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (argc == 3 && !fw && !fr) {
+        perror(argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    printf("kiss_fft %s, sizeof(kiss_fft_scalar) = %d\n", VARIANT, (int) sizeof(kiss_fft_scalar));
+    printf("%8s %10s %10s %10s %10s %10s %10s %10s\n", "N", "fwd[us]", "inv[us]",
+           "alloc[us]", "plan[us]", "DFT[dB]", "ref[dB]", "inv[dB]");
+
+    for (int n = N_MIN; n <= N_MAX; n *= 2) {
+        kiss_fftr_cfg fwd = kiss_fftr_plan(n, 0), inv = kiss_fftr_plan(n, 1);
+        double t_alloc, t_plan, t;
+        int reps;
+
+        if (!fwd || !inv || kiss_fftr_plan(n, 0) != fwd || kiss_fftr_plan(n, 1) != inv) {
+            fprintf(stderr, "N = %d: plan cache failed\n", n);
+            return EXIT_FAILURE;
+        }
+
+        t = timeNow();
+        for (reps = 0; timeNow() - t < T_MEAS / 4; reps++)
+            kiss_fftr_free(kiss_fftr_alloc(n, 0, NULL, NULL));
+        t_alloc = (timeNow() - t) / reps * 1e6;
+        t = timeNow();
+        for (reps = 0; timeNow() - t < T_MEAS / 4; reps++)
+            kiss_fftr_plan(n, 0);
+        t_plan = (timeNow() - t) / reps * 1e6;
+
+        makeSignal(n);
+        double t_fwd = timeFwd(fwd);
+        double snr_dft = checkDft(n);
+        double snr_ref = NAN;
+
+        if (fw) {
+            for (int k = 0; k <= n / 2; k++)
+                bin(n, k, &ref[2 * k], &ref[2 * k + 1]);
+            fwrite(ref, sizeof(double), n + 2, fw);
+        }
+        if (fr) {
+            if (fread(ref, sizeof(double), n + 2, fr) != (size_t) n + 2) {
+                fprintf(stderr, "reference file too short\n");
+                return EXIT_FAILURE;
+            }
+            snr_ref = checkRef(n);
+        }
+        double snr_inv = checkRoundTrip(n, inv);
+        double t_inv = timeInv(inv);
+
+        printf("%8d %10.1f %10.1f %10.2f %10.3f %10.1f %10.1f %10.1f\n", n, t_fwd, t_inv,
+               t_alloc, t_plan, snr_dft, snr_ref, snr_inv);
+        if (snr_dft < MIN_SNR(n) || (fr && snr_ref < MIN_SNR(n)) || snr_inv < MIN_SNR(n)) {
+            printf("N = %d: accuracy below %.1f dB\n", n, (double) MIN_SNR(n));
+            failures++;
+        }
+    }
+    kiss_fft_plan_cleanup();
+
+    if (fw)
+        fclose(fw);
+    if (fr)
+        fclose(fr);
+    if (failures) {
+        printf("%s: %d lengths FAILED\n", VARIANT, failures);
+        return EXIT_FAILURE;
+    }
+    printf("%s: all lengths passed\n", VARIANT);
+    return EXIT_SUCCESS;
+}
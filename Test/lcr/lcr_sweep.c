@@ -0,0 +1,481 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya LCR meter sweep library.
+ *
+ * A sweep runs the calibration passes (open, short and load, if
+ * calibration is selected) and the measurement pass over the same points.
+ * The generator is first swept up to the start frequency (frequency sweep)
+ * or the start frequency is measured a few times (measurement sweep) and
+ * the results are dropped, this removes the transient effect which spoils
+ * the first measurements. Every point is the mean of the requested number
+ * of lock-in measurements, done on at least min_periodes periods of the
+ * signal with the decimation chosen by frequency.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <complex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "lcr_sweep.h"
+
+#define LCR_SMPL_FREQ 125e6 // ADC & AWG sampling frequency [Hz]
+#define LCR_STEPS_TE  10    // Max. number of steps for transient effect (TE) elimination
+
+const int    lcr_dec[LCR_DEC_NUM]     = { 1, 8, 64, 1024, 8192, 65536 };
+const double lcr_shunt[LCR_SHUNT_NUM] = { 10.0, 100.0, 1000.0, 10000.0, 100000.0, 1300000.0 };
+
+/** Sweep state */
+typedef struct {
+    const lcr_sweep_params_t *p;
+    const lcr_backend_t      *be;
+    const lcr_sweep_cb_t     *cb;
+    float    *ch1, *ch2;       // Acquired signals
+    int32_t  *data;            // AWG data buffer
+    uint32_t  min_periodes;    // Min. number of periods acquired
+    double    r_shunt;         // Shunt resistor in use [Ohm]
+    int       shunt_k;         // Shunt index, -1 for a fixed shunt
+    int       done, total;     // Measurements made and in the whole sweep
+} lcr_sweep_t;
+
+
+/** Decimation index for a signal frequency */
+static int lcr_dec_idx(double freq)
+{
+    if      (freq >= 65000) return 0;
+    else if (freq >= 8000)  return 1;
+    else if (freq >= 1000)  return 2;
+    else if (freq >= 60)    return 3;
+    else if (freq >= 8)     return 4;
+    return 5;
+}
+
+/** Generator frequency of point idx */
+static double lcr_point_freq(const lcr_sweep_params_t *p, int idx)
+{
+    double a, b;
+
+    if (!p->freq_sweep) {
+        return (int)p->start_freq;
+    }
+    if (p->log_scale) {
+        a = log10(p->start_freq);
+        b = log10(p->end_freq);
+        return (int)powf(10, (p->steps > 1 ? (b - a) / (p->steps - 1) : b - a) * idx + a);
+    }
+    return (int)(p->start_freq +
+                 (p->steps > 1 ? (p->end_freq - p->start_freq) / (p->steps - 1) :
+                                 p->end_freq - p->start_freq) * idx);
+}
+
+static int lcr_set_freq(lcr_sweep_t *s, double ampl, double offset, double freq)
+{
+    lcr_awg_param_t awg;
+
+    lcr_sweep_synth(ampl, offset, freq, s->data, &awg);
+    return s->be->generate(s->be->ctx, s->p->ch, s->data, &awg);
+}
+
+/** Switch the automatic shunt so that it matches the measured impedance */
+static int lcr_auto_shunt(lcr_sweep_t *s, double z_amp)
+{
+    int k = s->shunt_k;
+
+    if ( (z_amp >= (6.0*s->r_shunt)) || (z_amp <= (1.0/6.0*s->r_shunt)) ) {
+        if      (z_amp > 2e6)   k = 5; // 1M3
+        else if (z_amp > 50e3)  k = 4; // 100K
+        else if (z_amp > 5e3)   k = 3; // 10K
+        else if (z_amp > 0.5e3) k = 2; // 1K
+        else if (z_amp > 50)    k = 1; // 100E
+        else                    k = 0; // 10E
+    }
+    if (k == s->shunt_k) {
+        return 0;
+    }
+    s->shunt_k = k;
+    s->r_shunt = lcr_shunt[k];
+    return s->be->set_shunt(s->be->ctx, k);
+}
+
+/** Averaged impedance at freq, the generator already runs at it */
+static int lcr_measure(lcr_sweep_t *s, double freq, double complex *z)
+{
+    int dec_idx = lcr_dec_idx(freq);
+    uint32_t size = round( ( s->min_periodes * LCR_SMPL_FREQ ) / ( freq * lcr_dec[dec_idx] ) );
+    double complex sum = 0, zi = 0;
+    unsigned int i;
+
+    if (size > LCR_MAX_SAMPLES) size = LCR_MAX_SAMPLES;
+    if (size < 2) size = 2;
+
+    for (i = 0; i < s->p->averaging; i++) {
+        if (s->be->acquire(s->be->ctx, dec_idx, size, s->ch1, s->ch2) < 0) {
+            return -1;
+        }
+        if (lcr_sweep_analysis(s->ch1, s->ch2, size, s->r_shunt, 2 * M_PI * freq,
+                               dec_idx, &zi) < 0) {
+            return -1;
+        }
+        sum += zi;
+    }
+    *z = sum / s->p->averaging;
+
+    /* The new shunt is used from the next measurement on */
+    if (s->shunt_k >= 0 && lcr_auto_shunt(s, cabs(zi)) < 0) {
+        return -1;
+    }
+
+    s->done++;
+    if (s->cb->progress) {
+        s->cb->progress(s->cb->ctx, 100 * s->done / s->total);
+    }
+    return 0;
+}
+
+/** Point from the calibrated impedance */
+static void lcr_point(double freq, double complex z, lcr_point_t *pt)
+{
+    double w_out = 2 * M_PI * freq;
+    double complex y = 1 / z;
+    float *v = pt->v;
+
+    pt->freq = freq;
+    v[LCR_Z_ABS]   = cabs(z);
+    v[LCR_Z_PHASE] = ( 180 / M_PI ) * carg(z);
+    v[LCR_R_S]     = creal(z);
+    v[LCR_X_S]     = cimag(z);
+    v[LCR_Y_ABS]   = cabs(y);
+    v[LCR_Y_PHASE] = -v[LCR_Z_PHASE];
+    v[LCR_G_P]     = creal(y);
+    v[LCR_B_P]     = cimag(y);
+    v[LCR_C_S]     = -1 / (w_out * v[LCR_X_S]);
+    v[LCR_C_P]     = v[LCR_B_P] / w_out;
+    v[LCR_L_S]     = v[LCR_X_S] / w_out;
+    v[LCR_L_P]     = -1 / (w_out * v[LCR_B_P]);
+    v[LCR_R_P]     = 1 / v[LCR_G_P];
+    v[LCR_Q]       = v[LCR_X_S] / v[LCR_R_S];
+    v[LCR_D]       = -1 / v[LCR_Q];
+}
+
+static int lcr_run(lcr_sweep_t *s, double complex *z_cal)
+{
+    const lcr_sweep_params_t *p = s->p;
+    int steps_te = p->steps < LCR_STEPS_TE ? p->steps : LCR_STEPS_TE;
+    int count = p->steps;
+    double complex z, z_short, z_open, z_load;
+    lcr_point_t pt;
+    double freq;
+    int h, idx, c;
+
+    /*
+     * [h=0] calibration short circuited, [h=1] calibration open connections,
+     * [h=2] calibration load, [h=3] actual measurement
+     */
+    for (h = p->calib ? 0 : 3; h <= 3; h++) {
+
+        /* Transient effect elimination, on the first pass only */
+        if (h == (p->calib ? 0 : 3)) {
+            if (p->freq_sweep) {
+                for (c = steps_te; c >= 2; c--) {
+                    freq = (int)(p->start_freq - (p->start_freq/2) + ((p->start_freq/2)*c/steps_te));
+                    if (lcr_set_freq(s, p->ampl, p->dc_bias, freq) < 0 ||
+                        lcr_measure(s, freq, &z) < 0) {
+                        return -1;
+                    }
+                }
+            } else {
+                freq = lcr_point_freq(p, 0);
+                if (lcr_set_freq(s, p->ampl, p->dc_bias, freq) < 0) {
+                    return -1;
+                }
+                for (c = 0; c < steps_te; c++) {
+                    if (lcr_measure(s, freq, &z) < 0) {
+                        return -1;
+                    }
+                }
+            }
+        }
+
+        for (idx = 0; idx < count; idx++) {
+            freq = lcr_point_freq(p, idx);
+            if ((p->freq_sweep || idx == 0) &&
+                lcr_set_freq(s, p->ampl, p->dc_bias, freq) < 0) {
+                return -1;
+            }
+            if (lcr_measure(s, freq, &z) < 0) {
+                return -1;
+            }
+            if (h < 3) {
+                z_cal[h * count + idx] = z;
+                continue;
+            }
+
+            if (p->calib) {
+                z_short = z_cal[idx];
+                z_open  = z_cal[count + idx];
+                z_load  = z_cal[2 * count + idx];
+                if (p->calib == 1) { // calib. was made including Z_load
+                    z = ( ( ( z_short - z ) * ( z_load - z_open ) ) /
+                          ( ( z - z_open ) * ( z_short - z_load ) ) ) * p->z_ref;
+                } else {             // calibration without Z_load
+                    z = ( ( ( z_short - z ) * z_open ) /
+                          ( ( z - z_open ) * ( z_short - z_load ) ) );
+                }
+            }
+            lcr_point(freq, z, &pt);
+            if (s->cb->point(s->cb->ctx, idx, count, &pt) < 0) {
+                return -1;
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * Runs a sweep.
+ *
+ * Points are passed to cb->point as soon as they are measured, during the
+ * last pass. The generator output is turned off at the end, also when the
+ * sweep fails or is aborted.
+ *
+ * @param p   Sweep parameters.
+ * @param be  Hardware backend.
+ * @param cb  Point and progress callbacks.
+ * @return    Number of points, -1 on failure or abort.
+ */
+int lcr_sweep_run(const lcr_sweep_params_t *p, const lcr_backend_t *be,
+                  const lcr_sweep_cb_t *cb)
+{
+    lcr_sweep_t s = { .p = p, .be = be, .cb = cb, .shunt_k = -1 };
+    double complex *z_cal = NULL;
+    int ret = -1;
+
+    if (p->steps < 1 || p->averaging < 1 || p->ch > 1 || p->start_freq <= 0 ||
+        (p->freq_sweep && p->end_freq <= 0)) {
+        fprintf(stderr, "lcr_sweep_run: invalid parameters\n");
+        return -1;
+    }
+
+    s.ch1  = malloc(LCR_MAX_SAMPLES * sizeof(float));
+    s.ch2  = malloc(LCR_MAX_SAMPLES * sizeof(float));
+    s.data = malloc(LCR_AWG_LEN * sizeof(int32_t));
+    if (p->calib) {
+        z_cal = malloc(3 * p->steps * sizeof(double complex));
+    }
+    if (!s.ch1 || !s.ch2 || !s.data || (p->calib && !z_cal)) {
+        fprintf(stderr, "lcr_sweep_run: out of memory\n");
+        goto out;
+    }
+
+    /* When lying below 100 Hz the number of acquired periods is reduced,
+     * this reduces measurement time */
+    s.min_periodes = (p->start_freq < 100 && !p->freq_sweep) ? 5 : 8;
+    s.total = (p->calib ? 4 : 1) * p->steps +
+              (p->steps < LCR_STEPS_TE ? p->steps : LCR_STEPS_TE) - (p->freq_sweep ? 1 : 0);
+
+    s.r_shunt = p->r_shunt;
+    if (!(p->r_shunt > 0)) {
+        if (!be->set_shunt) {
+            fprintf(stderr, "lcr_sweep_run: automatic shunt needs the LCR module\n");
+            goto out;
+        }
+        s.shunt_k = 2;
+        s.r_shunt = lcr_shunt[s.shunt_k];
+        if (be->set_shunt(be->ctx, s.shunt_k) < 0) {
+            goto out;
+        }
+    }
+
+    ret = lcr_run(&s, z_cal);
+
+    /* Setting amplitude to 0V - turning off the output. */
+    if (lcr_set_freq(&s, 0, 0, 1000) < 0) {
+        ret = -1;
+    }
+
+out:
+    free(z_cal);
+    free(s.data);
+    free(s.ch2);
+    free(s.ch1);
+    return ret;
+}
+
+/**
+ * Synthesize a sine for the AWG.
+ *
+ * The data[] vector of LCR_AWG_LEN samples at 125 MHz is generated to be
+ * re-played by the FPGA AWG module.
+ *
+ * @param ampl    Signal amplitude [V].
+ * @param offset  Signal DC offset [V].
+ * @param freq    Signal frequency [Hz].
+ * @param data    Returned synthesized AWG data vector.
+ * @param awg     Returned AWG parameters.
+ */
+void lcr_sweep_synth(double ampl, double offset, double freq,
+                     int32_t *data, lcr_awg_param_t *awg)
+{
+    const int dcoffs = (int)(offset * (double)(1<<13));
+    uint32_t amp = ampl * 4000.0;    /* 1 V ==> 4000 DAC counts */
+    uint32_t i;
+
+    awg->offsgain = (dcoffs << 16) + 0x1fff;
+    awg->step = round(65536 * freq/LCR_SMPL_FREQ * LCR_AWG_LEN);
+    awg->wrap = round(65536 * LCR_AWG_LEN - 1);
+
+    if (amp > 8191) {
+        /* Truncate to max value if needed */
+        amp = 8191;
+    }
+
+    for (i = 0; i < LCR_AWG_LEN; i++) {
+        data[i] = round(amp * cos(2*M_PI*(double)i/(double)LCR_AWG_LEN));
+        if (data[i] < 0)
+            data[i] += (1 << 14);
+    }
+}
+
+/**
+ * Acquired data analysis function for LCR meter.
+ *
+ * Voltage on and current through the device under test are calculated
+ * from the two inputs, their amplitude and phase are found with the lock-in
+ * method and give the complex impedance. Works on the caller's buffers
+ * only, nothing is allocated.
+ *
+ * @param ch1      Input 1 (in front of the DUT) in ADC counts.
+ * @param ch2      Input 2 (on the shunt) in ADC counts.
+ * @param size     Size of data.
+ * @param r_shunt  Shunt resistor value in Ohms.
+ * @param w_out    Angular velocity (2*pi*freq).
+ * @param dec_idx  Decimation selector index.
+ * @param z        Returned impedance (in complex form).
+ * @return         0 on success, -1 on invalid arguments.
+ */
+int lcr_sweep_analysis(const float *ch1, const float *ch2, uint32_t size,
+                       double r_shunt, double w_out, int dec_idx,
+                       double complex *z)
+{
+    const double scale = 2.0 / 16384; // 14 bit ADC to voltage
+    double T;                         // Sampling time in seconds
+    double c_cable = 460E-12;
+    double p_correction, z_shunt;
+    double mean1 = 0, mean2 = 0, u1, u2, phase;
+    double complex u_dut = 0, i_dut = 0, ref;
+    uint32_t i;
+
+    if (size < 2 || dec_idx < 0 || dec_idx >= LCR_DEC_NUM || !(w_out > 0)) {
+        return -1;
+    }
+    T = lcr_dec[dec_idx] / LCR_SMPL_FREQ;
+
+    for (i = 0; i < size; i++) {
+        mean1 += ch1[i];
+        mean2 += ch2[i];
+    }
+    mean1 = mean1 * scale / size;
+    mean2 = mean2 * scale / size;
+
+    /* Manual correction for the cable capacitance */
+    p_correction = atan(-w_out * c_cable * r_shunt);
+    if      (r_shunt == 1300000.0) {  c_cable = 465E-12;  }
+    else if (r_shunt == 100000.0)  {  c_cable = 390E-12;  }
+    else if (r_shunt == 10000.0)   {  c_cable = 350E-12;  }
+    else if (r_shunt == 1000.0)    {  c_cable = 160E-12;  }
+    else if (r_shunt == 100.0)     {  c_cable = 100E-12;  }
+    else if (r_shunt == 10.0)      {  r_shunt = r_shunt * 1.15;  c_cable = 100E-12;  }
+    z_shunt = (r_shunt * (1.0 / (w_out * c_cable))) / (r_shunt + 1.0 / (w_out * c_cable));
+
+    /*
+     * Potential difference gives the voltage on the load, the current through
+     * it is the same as through the shunt. Both are multiplied by the
+     * reference signals (sin, cos) and integrated with the trapezoidal method.
+     */
+    for (i = 0; i < size; i++) {
+        float ang = i * T * w_out;
+        double k = (i == 0 || i == size - 1) ? 0.5 : 1.0;
+
+        u1 = ch1[i] * scale - mean1;
+        u2 = ch2[i] * scale - mean2;
+        ref = k * (sin(ang) + cos(ang) * I);
+        u_dut += (u1 - u2) * ref;
+        i_dut += (u2 / z_shunt) * ref;
+    }
+
+    /* Phase has to be limited between 180 and -180 deg. */
+    phase = carg(u_dut) - carg(i_dut);
+    if (phase <= -M_PI) {
+        phase += 2 * M_PI;
+    } else if (phase >= M_PI) {
+        phase -= 2 * M_PI;
+    }
+    phase += p_correction;
+
+    *z = ( cabs(u_dut) / cabs(i_dut) ) * ( cos(phase) + sin(phase) * I ); // R + jX
+    return 0;
+}
+
+
+#define I2C_SLAVE_FORCE 		   0x0706
+#define EXPANDER_ADDR            	   0x20
+
+/**
+ * Switches the shunt resistor on the LCR extension module.
+ *
+ * The module selects the shunt with the GPIO expander on the I2C bus, a
+ * backend set_shunt can simply call this.
+ *
+ * @param k  Shunt index into lcr_shunt.
+ * @return   0 on success, -1 on failure.
+ */
+int lcr_sweep_i2c_shunt(int k)
+{
+    int  dat = (1 << k);
+    int  fd;
+    int  status;
+    char str [1+2*11];
+
+    // Open the device.
+    fd = open("/dev/i2c-0", O_RDWR);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open the I2C device\n");
+        return -1;
+    }
+
+    // set slave address
+    status = ioctl(fd, I2C_SLAVE_FORCE, EXPANDER_ADDR);
+    if (status < 0) {
+        fprintf(stderr, "Unable to set the I2C address\n");
+        close(fd);
+        return -1;
+    }
+
+    // Write to expander: all pins outputs, no interrupts, GPIO = dat
+    str [0] = 0; // set address to 0
+    for (status = 1; status < 1+0x12; status++) {
+        str [status] = 0x00; // IODIRA .. INTCAPB
+    }
+    str [1+0x12] = (dat >> 0) & 0xff; // GPIOA
+    str [1+0x13] = (dat >> 8) & 0xff; // GPIOB
+    str [1+0x14] = (dat >> 0) & 0xff; // OLATA
+    str [1+0x15] = (dat >> 8) & 0xff; // OLATB
+    status = write(fd, str, 1+2*11);
+    close(fd);
+
+    if (status != 1+2*11) {
+        fprintf(stderr, "Error I2C write\n");
+        return -1;
+    }
+    return 0;
+}
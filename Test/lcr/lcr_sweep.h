@@ -0,0 +1,126 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya LCR meter sweep library.
+ *
+ * The measurement core of the lcr utility: generator frequency plan,
+ * transient warm-up, calibration passes, lock-in analysis and the derived
+ * impedance quantities. Hardware access goes through a small backend, so
+ * the same sweep runs in the lcr command line tool, in-process in the
+ * impedance analyzer web application and against a simulated front end.
+ * Points are handed to a callback as soon as they are measured.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __LCR_SWEEP_H
+#define __LCR_SWEEP_H
+
+#include <stdint.h>
+#include <complex.h>
+
+/** AWG buffer length [samples] */
+#define LCR_AWG_LEN        (16*1024)
+/** Max. number of samples acquired per measurement */
+#define LCR_MAX_SAMPLES    (16*1024)
+/** Number of decimation settings, index into lcr_dec */
+#define LCR_DEC_NUM        6
+/** Number of selectable shunt resistors, index into lcr_shunt */
+#define LCR_SHUNT_NUM      6
+
+/** Decimation factor for every decimation index */
+extern const int    lcr_dec[LCR_DEC_NUM];
+/** Shunt resistor [Ohm] for every shunt index (LCR extension module) */
+extern const double lcr_shunt[LCR_SHUNT_NUM];
+
+/** AWG FPGA parameters */
+typedef struct {
+    int32_t  offsgain;   // AWG offset & gain
+    uint32_t wrap;       // AWG buffer wrap value
+    uint32_t step;       // AWG step interval
+} lcr_awg_param_t;
+
+/** Sweep parameters, as given on the lcr command line */
+typedef struct {
+    unsigned int ch;          // Generator channel [0, 1]
+    double       ampl;        // Signal amplitude [V]
+    double       dc_bias;     // DC bias [V]
+    double       r_shunt;     // Shunt resistor [Ohm], 0 selects it automatically
+    unsigned int averaging;   // Measurements averaged per point
+    unsigned int calib;       // 0 - none, 1 - open, short & load, 2 - open & short
+    double complex z_ref;     // Load reference impedance for calib 1
+    unsigned int steps;       // Number of points
+    unsigned int freq_sweep;  // 0 - measurement sweep, 1 - frequency sweep
+    double       start_freq;  // Start (measurement sweep: the only) frequency [Hz]
+    double       end_freq;    // End frequency [Hz]
+    unsigned int log_scale;   // 0 - linear, 1 - logarithmic frequency steps
+} lcr_sweep_params_t;
+
+/** Quantities of a point, in the order of the web application plot selector */
+typedef enum {
+    LCR_Z_ABS = 0,   // |Z| [Ohm]
+    LCR_Z_PHASE,     // P [deg]
+    LCR_Y_ABS,       // |Y| [S]
+    LCR_Y_PHASE,     // -P [deg]
+    LCR_R_S,         // Rs [Ohm]
+    LCR_R_P,         // Rp [Ohm]
+    LCR_X_S,         // Xs [Ohm]
+    LCR_G_P,         // Gp [S]
+    LCR_B_P,         // Bp [S]
+    LCR_C_S,         // Cs [F]
+    LCR_C_P,         // Cp [F]
+    LCR_L_S,         // Ls [H]
+    LCR_L_P,         // Lp [H]
+    LCR_Q,           // Q
+    LCR_D,           // D
+    LCR_QUANTITIES
+} lcr_quantity_t;
+
+/** One measured point */
+typedef struct {
+    float freq;                 // Frequency [Hz]
+    float v[LCR_QUANTITIES];    // Quantities, indexed by lcr_quantity_t
+} lcr_point_t;
+
+/**
+ * Hardware the sweep runs on. All functions return a negative value on
+ * failure, which aborts the sweep.
+ */
+typedef struct {
+    void *ctx;
+    /** Play data[LCR_AWG_LEN] continuously on generator channel ch */
+    int (*generate)(void *ctx, unsigned int ch, const int32_t *data,
+                    const lcr_awg_param_t *awg);
+    /** Acquire size samples of both inputs at decimation lcr_dec[dec_idx]
+     *  as signed ADC counts, starting at an immediate trigger */
+    int (*acquire)(void *ctx, int dec_idx, uint32_t size, float *ch1, float *ch2);
+    /** Switch to shunt resistor lcr_shunt[k], NULL without the module */
+    int (*set_shunt)(void *ctx, int k);
+} lcr_backend_t;
+
+/** Where the sweep reports to */
+typedef struct {
+    void *ctx;
+    /** Point idx of count is measured, a negative return aborts the sweep */
+    int  (*point)(void *ctx, int idx, int count, const lcr_point_t *pt);
+    /** Progress of the whole sweep [%], may be NULL */
+    void (*progress)(void *ctx, int percent);
+} lcr_sweep_cb_t;
+
+int lcr_sweep_run(const lcr_sweep_params_t *p, const lcr_backend_t *be,
+                  const lcr_sweep_cb_t *cb);
+
+void lcr_sweep_synth(double ampl, double offset, double freq,
+                     int32_t *data, lcr_awg_param_t *awg);
+
+int lcr_sweep_analysis(const float *ch1, const float *ch2, uint32_t size,
+                       double r_shunt, double w_out, int dec_idx,
+                       double complex *z);
+
+int lcr_sweep_i2c_shunt(int k);
+
+#endif /* __LCR_SWEEP_H */
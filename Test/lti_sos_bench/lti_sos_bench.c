@@ -0,0 +1,242 @@
+/**
+ * $Id: $
+ *
+ * @brief LTI workbench online filter benchmark.
+ *
+ * Checks the second-order-section engine against a double precision direct
+ * form filter, measures its throughput versus filter order and finds the
+ * highest sample rate the online DSP loop sustains without overruns. The
+ * ADC is simulated by a 16k circular buffer whose write pointer advances
+ * with wall-clock time. Runs on the host as well as on the board.
+ *
+ * Usage: lti_sos_bench [latency budget us] [sleep us] [run time ms]
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <complex.h>
+#include <sched.h>
+
+#include "lti_sos.h"
+#include "bench.h"
+
+#define BUF_LEN   (16 * 1024)
+
+static uint32_t adc[BUF_LEN];
+static int      dac[BUF_LEN];
+
+/* Random stable filter as sections: poles inside radius 0.95, zeros on the
+ * unit circle, every section with unity peak gain. Returns number of
+ * sections. */
+static int makeSections(int order, double *coef) {
+    int s = 0;
+
+    for (int n = 0; n < order; n += 2, s++) {
+        double w = M_PI * rand() / RAND_MAX;
+        double r = 0.5 + 0.45 * rand() / RAND_MAX;
+        double *c = &coef[5 * s];
+
+        if (order - n == 1) {
+            c[0] = 1; c[1] = 1; c[2] = 0;
+            c[3] = -r; c[4] = 0;
+        } else {
+            c[0] = 1; c[1] = -2 * cos(M_PI * 0.3 + 0.7 * w); c[2] = 1;
+            c[3] = -2 * r * cos(w * 0.3); c[4] = r * r;
+        }
+        double peak = 0;
+        for (int k = 0; k < 512; k++) {
+            double complex z = cexp(-I * M_PI * k / 511);
+            double h = cabs((c[0] + z * (c[1] + z * c[2])) / (1 + z * (c[3] + z * c[4])));
+            if (h > peak)
+                peak = h;
+        }
+        for (int i = 0; i < 3; i++)
+            c[i] /= peak;
+    }
+    return s;
+}
+
+/* Multiplies the sections out into direct form */
+static void expand(const double *coef, int sect_num, double *b, double *a) {
+    int n = 0;
+
+    memset(b, 0, (2 * sect_num + 1) * sizeof(double));
+    memset(a, 0, (2 * sect_num + 1) * sizeof(double));
+    b[0] = a[0] = 1;
+    for (int s = 0; s < sect_num; s++, n += 2) {
+        const double *c = &coef[5 * s];
+        for (int i = n + 2; i >= 0; i--) {
+            b[i] = c[0] * b[i] + (i >= 1 ? c[1] * b[i - 1] : 0) + (i >= 2 ? c[2] * b[i - 2] : 0);
+            a[i] = a[i] + (i >= 1 ? c[3] * a[i - 1] : 0) + (i >= 2 ? c[4] * a[i - 2] : 0);
+        }
+    }
+}
+
+static void fillAdc(void) {
+    for (int i = 0; i < BUF_LEN; i++) {
+        int v = (int) (3000 * sin(2 * M_PI * i * 37 / BUF_LEN) + (rand() % 2001) - 1000);
+        adc[i] = v & 0x3fff;
+    }
+}
+
+static double s14(int v) {
+    return (v & 0x2000) ? v - 0x4000 : v;
+}
+
+/* Max. output error in ADC counts against direct form in double precision */
+static double accuracy(int order, lti_sos_fmt_t fmt) {
+    double coef[LTI_SOS_MAX_SECT * 5];
+    double b[LTI_SOS_MAX_ORDER + 2], a[LTI_SOS_MAX_ORDER + 2];
+    double x[LTI_SOS_MAX_ORDER + 2] = { 0 }, y[LTI_SOS_MAX_ORDER + 2] = { 0 };
+    double err = 0;
+    lti_sos_t sos;
+
+    /* factoring the polynomials back into sections is part of the check */
+    expand(coef, makeSections(order, coef), b, a);
+    if (lti_sos_design(&sos, b, order + 1, a, order + 1, fmt) < 0)
+        return -1;
+    lti_sos_run(&sos, adc, dac, BUF_LEN, 0, BUF_LEN, 0);
+
+    for (int n = 0; n < BUF_LEN; n++) {
+        double acc;
+        memmove(&x[1], &x[0], order * sizeof(double));
+        memmove(&y[1], &y[0], order * sizeof(double));
+        x[0] = s14(adc[n]);
+        acc = 0;
+        for (int i = 0; i <= order; i++)
+            acc += b[i] * x[i] - (i ? a[i] * y[i] : 0);
+        y[0] = acc;
+        /* saturated output can not be compared */
+        if (fabs(acc) < 8000 && fabs(s14(dac[n]) - acc) > err)
+            err = fabs(s14(dac[n]) - acc);
+    }
+    return err;
+}
+
+/* Samples per second of a single thread doing nothing else */
+static double throughput(lti_sos_t *sos) {
+    int n = 0;
+
+    double start = timeNow();
+    do {
+        lti_sos_run(sos, adc, dac, BUF_LEN, 0, 16 * BUF_LEN, 100);
+        n += 16 * BUF_LEN;
+    } while (timeNow() - start < 0.2);
+    return n / (timeNow() - start);
+}
+
+/* Runs the online DSP loop against the simulated ADC, returns overruns */
+static uint32_t realtime(lti_sos_t *sos, double rate, int delay, int sleep_us,
+                         double run_s, lti_sos_stats_t *st) {
+    double start = timeNow(), now;
+    int loc = 0;
+
+    lti_sos_reset(sos);
+    lti_sos_stats_reset(st);
+    while ((now = timeNow()) - start < run_s) {
+        double t0 = now;
+        int curr = (int) ((now - start) * rate) % BUF_LEN;
+        int backlog, overrun = 0;
+
+        /* same as lti_fpga_online_dsp() */
+        if (curr < loc)
+            curr += BUF_LEN;
+        backlog = curr - loc;
+        if (backlog >= delay) {
+            overrun = 1;
+            loc = curr - delay / 2;
+        }
+        lti_sos_run(sos, adc, dac, BUF_LEN, loc, curr - 1, delay);
+        lti_sos_stats_add(st, curr - 1 - loc, backlog,
+                          (uint32_t) ((timeNow() - t0) * 1e6), overrun);
+        loc = (curr - 1) % BUF_LEN;
+        if (sleep_us)
+            usleep(sleep_us);
+    }
+    return st->overruns;
+}
+
+int main(int argc, char **argv) {
+    const int orders[] = { 2, 4, 6, 8, 16, 32, 64 };
+    const int n_orders = sizeof(orders) / sizeof(orders[0]);
+    const char *fmt_name[] = { "float", "fixed" };
+    double budget_us = argc > 1 ? atof(argv[1]) : 2000;
+    int sleep_us = argc > 2 ? atoi(argv[2]) : 100;
+    double run_s = (argc > 3 ? atoi(argv[3]) : 200) * 1e-3;
+    int failed = 0;
+    lti_sos_stats_t st;
+
+    struct sched_param sched = { .sched_priority = 50 };
+    if (sched_setscheduler(0, SCHED_FIFO, &sched) < 0)
+        printf("Not running with real-time priority, expect jitter\n\n");
+
+    srand(1);
+    fillAdc();
+
+    printf("Accuracy (max. error [counts] vs. direct form double):\n");
+    for (int o = 0; o < 5; o++) {
+        for (int f = 0; f < 2; f++) {
+            double err = accuracy(orders[o], (lti_sos_fmt_t) f);
+            printf("  order %2d %-5s %8.3f\n", orders[o], fmt_name[f], err);
+            /* float: rounding to the s14 output, fixed: Q.8 signals */
+            if (err < 0 || err > (f ? 2.0 : 1.0))
+                failed++;
+        }
+    }
+
+    printf("\nThroughput, online loop with %.0f us latency budget, %d us sleep:\n",
+           budget_us, sleep_us);
+    printf("  %5s %-5s %12s %16s\n", "order", "fmt", "Msmp/s", "max rate [ksmp/s]");
+    for (int o = 0; o < n_orders; o++) {
+        for (int f = 0; f < 2; f++) {
+            double coef[LTI_SOS_MAX_SECT * 5], lo = 8 / (budget_us * 1e-6), hi;
+            lti_sos_t sos;
+
+            lti_sos_set(&sos, coef, makeSections(orders[o], coef), (lti_sos_fmt_t) f);
+            hi = throughput(&sos);
+            printf("  %5d %-5s %12.2f", orders[o], fmt_name[f], hi * 1e-6);
+            fflush(stdout);
+
+            /* bisection on the sample rate, log scale; a rate passes if one
+             * of three runs has no overrun (scheduling jitter of the host) */
+            while (hi / lo > 1.05) {
+                double rate = sqrt(lo * hi);
+                int delay = (int) (rate * budget_us * 1e-6);
+                int pass = 0;
+                if (delay > BUF_LEN * 3 / 4)
+                    delay = BUF_LEN * 3 / 4;
+                for (int r = 0; r < 3 && !pass; r++)
+                    pass = !realtime(&sos, rate, delay, sleep_us, run_s, &st);
+                if (pass)
+                    lo = rate;
+                else
+                    hi = rate;
+            }
+            printf(" %16.1f\n", lo * 1e-3);
+        }
+    }
+
+    /* Latency & timing histogram of the default (UI) filter order */
+    {
+        double coef[LTI_SOS_MAX_SECT * 5];
+        double rate = 125e6 / 1024;
+        lti_sos_t sos;
+
+        lti_sos_set(&sos, coef, makeSections(5, coef), lti_sos_float);
+        realtime(&sos, rate, (int) (rate * budget_us * 1e-6), sleep_us, run_s * 5, &st);
+        printf("\nOrder 5 float at %.1f ksmp/s:\n", rate * 1e-3);
+        lti_sos_stats_print(stdout, &st);
+    }
+
+    if (failed) {
+        printf("\n%d accuracy checks failed\n", failed);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
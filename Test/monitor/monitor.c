@@ -20,29 +20,25 @@
 #include <string.h>
 #include <errno.h>
 #include <signal.h>
-#include <fcntl.h>
 #include <ctype.h>
 //#include <termios.h>
 #include <sys/types.h>
-#include <sys/mman.h>
 #include <stdint.h>
 
 #include "version.h"
+#include "regmap.h"
 
 #define FATAL do { fprintf(stderr, "Error at line %d, file %s (%d) [%s]\n", \
   __LINE__, __FILE__, errno, strerror(errno)); exit(1); } while(0)
- 
-#define MAP_SIZE 4096UL
-#define MAP_MASK (MAP_SIZE - 1)
 
 int parse_from_argv(int a_argc, char **a_argv, unsigned long* a_addr, int* a_type, unsigned long** a_values, ssize_t* a_len);
 uint32_t read_value(uint32_t a_addr);
 void write_values(unsigned long a_addr, int a_type, unsigned long* a_values, ssize_t a_len);
 
-void* map_base = (void*)(-1);
+/* Mapped register, the device can be changed with RP_REGMAP_DEV */
+regmap_block_t map_blk;
 
 int main(int argc, char **argv) {
-	int fd = -1;
 	int retval = EXIT_SUCCESS;
 
 	if(argc < 2) {
@@ -56,8 +52,6 @@ int main(int argc, char **argv) {
 		return EXIT_FAILURE;
 	}
 
-	if((fd = open("/dev/mem", O_RDWR | O_SYNC)) == -1) FATAL;
-
 	/* Read from command line */
 	unsigned long addr;
 	unsigned long *val = NULL;
@@ -65,10 +59,9 @@ int main(int argc, char **argv) {
 	ssize_t val_count = 0;
 	parse_from_argv(argc, argv, &addr, &access_type, &val, &val_count);
 
-	/* Map one page */
-	map_base = mmap(0, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, addr & ~MAP_MASK);
-	if(map_base == (void *) -1) FATAL;
-		
+	/* Map the register */
+	if(regmap_get(addr, sizeof(uint32_t), &map_blk) < 0) return EXIT_FAILURE;
+
 	if (addr != 0) {
 		if (val_count == 0) {
 			read_value(addr);
@@ -77,43 +70,33 @@ int main(int argc, char **argv) {
 			write_values(addr, access_type, val, val_count);
 		}
 	}
-	if (map_base != (void*)(-1)) {
-		if(munmap(map_base, MAP_SIZE) == -1) FATAL;
-		map_base = (void*)(-1);
-	}
-
-	if (map_base != (void*)(-1)) {
-		if(munmap(map_base, MAP_SIZE) == -1) FATAL;
-	}
-	if (fd != -1) {
-		close(fd);
-	}
+	regmap_put(&map_blk);
 	
 	return retval;
 }
 
 uint32_t read_value(uint32_t a_addr) {
-	void* virt_addr = map_base + (a_addr & MAP_MASK);
+	volatile void* virt_addr = map_blk.regs;
 	uint32_t read_result = 0;
-	read_result = *((uint32_t *) virt_addr);
+	read_result = *((volatile uint32_t *) virt_addr);
 	printf("0x%08x\n", read_result);
 	fflush(stdout);
 	return read_result;
 }
 
 void write_values(unsigned long a_addr, int a_type, unsigned long* a_values, ssize_t a_len) {
-	void* virt_addr = map_base + (a_addr & MAP_MASK);
+	volatile void* virt_addr = map_blk.regs;
 
 	for (ssize_t i = 0; i < a_len; ++i) {
 		switch(a_type) {
 			case 'b':
-				*((unsigned char *) virt_addr) = a_values[i];
+				*((volatile unsigned char *) virt_addr) = a_values[i];
 				break;
 			case 'h':
-				*((unsigned short *) virt_addr) = a_values[i];
+				*((volatile unsigned short *) virt_addr) = a_values[i];
 				break;
 			case 'w':
-				*((unsigned long *) virt_addr) = a_values[i];
+				*((volatile unsigned long *) virt_addr) = a_values[i];
 				break;
 		}
 	}
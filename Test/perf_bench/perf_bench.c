@@ -0,0 +1,271 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya latency tracing benchmark.
+ *
+ * Runs librp against a register simulator file (RP_REGMAP_DEV), so no Red
+ * Pitaya is needed; the calibration EEPROM is read from /dev/zero. The
+ * tracer shares a temporary file (RP_PERF_SHM) rather than the one of the
+ * board. The benchmark plays the FPGA, setting the trigger status after
+ * each rp_AcqStart(), and the SCPI server, reading both channels and
+ * formatting an ACQ:SOUR<n>:DATA? reply per capture, while a second thread
+ * stamps web socket serializations. Checks that:
+ *
+ *  - every stage is counted once per pass, stamps of both threads summed,
+ *  - percentiles are ordered and bounded by the max,
+ *  - the trace holds the latest stamps of both threads by start time,
+ *  - nothing is stamped while tracing is disabled, reset clears all,
+ *  - stamps of other processes are counted and their enabling applies here,
+ *    more of them than slots one after the other, as the web socket server
+ *    and the application controllers come and go.
+ *
+ * Then the cost of a stamp is timed, enabled and disabled, and set against
+ * the reply it is taken in; enabled it must stay under 1 %.
+ *
+ * Usage: perf_bench [captures]  (default 200)
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "redpitaya/rp.h"
+#include "bench.h"
+
+#define TRIG_STATUS  (1 << 2)     // configuration register, trigger status
+#define STAMPS       1000000
+#define PROCESSES    100          // more than the slots of the tracer
+
+static volatile uint32_t *osc_conf;
+static float   data_v[ADC_BUFFER_SIZE];
+static int16_t data_raw[ADC_BUFFER_SIZE];
+static char    reply[ADC_BUFFER_SIZE * 16];
+
+/* One capture read out like ACQ:SOUR1:DATA? & ACQ:SOUR2:DATA? in volts and
+ * raw counts */
+static void capture() {
+    rp_acq_trig_state_t state = RP_TRIG_STATE_WAITING;
+    uint32_t size;
+
+    rp_AcqStart();
+    *osc_conf |= TRIG_STATUS;
+    while (state != RP_TRIG_STATE_TRIGGERED) {
+        rp_AcqGetTriggerState(&state);
+    }
+
+    RP_PERF_BEGIN(t1);
+    size = ADC_BUFFER_SIZE;
+    rp_AcqGetDataV(RP_CH_1, 0, &size, data_v);
+    char *p = reply;
+    for (uint32_t i = 0; i < size; i++) {
+        p += sprintf(p, "%.6g,", data_v[i]);
+    }
+    RP_PERF_END(RP_PERF_SCPI_DATA, t1);
+    RP_PERF_END(RP_PERF_SCPI_TRIG, rp_PerfGetTrigger());
+
+    RP_PERF_BEGIN(t2);
+    size = ADC_BUFFER_SIZE;
+    rp_AcqGetDataRaw(RP_CH_2, 0, &size, data_raw);
+    p = reply;
+    for (uint32_t i = 0; i < size; i++) {
+        p += sprintf(p, "%d,", data_raw[i]);
+    }
+    RP_PERF_END(RP_PERF_SCPI_DATA, t2);
+    RP_PERF_END(RP_PERF_SCPI_TRIG, rp_PerfGetTrigger());
+
+    *osc_conf &= ~TRIG_STATUS;
+}
+
+static volatile int ws_run;
+static volatile uint64_t ws_count;
+
+static void *ws_thread(void *arg) {
+    char buf[4096];
+
+    while (ws_run) {
+        RP_PERF_BEGIN(t);
+        for (int i = 0; i < 256; i++) {
+            sprintf(buf + (i % 256) * 16, "%.4f,", i * 0.1);
+        }
+        RP_PERF_END(RP_PERF_WS_SIGNALS, t);
+        ws_count++;
+        usleep(100);
+    }
+    return NULL;
+}
+
+static void printStat(rp_perf_stage_t stage) {
+    rp_perf_stat_t s;
+
+    rp_PerfGetStat(stage, &s);
+    printf("  %-12s %8llu %10.2f %10.2f %10.2f %10.2f\n", rp_PerfStageName(stage),
+           (unsigned long long)s.count, s.mean / 1e3, s.p50 / 1e3, s.p99 / 1e3, s.max / 1e3);
+}
+
+/* Stamps a worker pass in each of processes children, one at a time, the
+ * first also disables tracing; returns the children failed or whose
+ * disabling was not seen here */
+static int otherProcesses(int processes) {
+    bool enabled = false;
+    int failed = 0;
+
+    for (int i = 0; i < processes; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            RP_PERF_BEGIN(t);
+            RP_PERF_END(RP_PERF_OSC_PROCESS, t);
+            _exit(i == 0 && rp_PerfEnable(false) != RP_OK);
+        }
+        int status = 0;
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+            failed++;
+        }
+        if (i == 0 && (rp_PerfIsEnabled(&enabled) != RP_OK || enabled)) {
+            failed++;
+        }
+        rp_PerfEnable(true);
+    }
+    return failed;
+}
+
+/* ns per stamp, BEGIN & END of one stage */
+static double stampCost() {
+    double t = timeNow();
+    for (int i = 0; i < STAMPS; i++) {
+        RP_PERF_BEGIN(s);
+        RP_PERF_END(RP_PERF_WS_GZIP, s);
+    }
+    return (timeNow() - t) * 1e9 / STAMPS;
+}
+
+int main(int argc, char **argv) {
+    int captures = argc > 1 ? atoi(argv[1]) : 200;
+    char shm[] = "/tmp/perf_bench_shm_XXXXXX";
+    rp_perf_stat_t s, s2;
+    pthread_t ws;
+
+    uint8_t *fpga = benchSimOpen();
+    osc_conf = (volatile uint32_t *)(fpga + BENCH_OSC_OFFSET);
+
+    int shm_fd = mkstemp(shm);
+    if (shm_fd < 0) {
+        perror("tracer file");
+        return EXIT_FAILURE;
+    }
+    close(shm_fd);
+    setenv("RP_PERF_SHM", shm, 1);
+
+    int r = rp_Init();
+    if (r != RP_OK) {
+        printf("rp_Init() failed: %s\n", rp_GetError(r));
+        return EXIT_FAILURE;
+    }
+
+    /* tracing off by default */
+    bool enabled = true;
+    rp_PerfIsEnabled(&enabled);
+    CHECK(!enabled, "tracing enabled by default");
+    capture();
+    rp_PerfGetStat(RP_PERF_ACQ_READ, &s);
+    CHECK(s.count == 0, "%llu stamps while disabled", (unsigned long long)s.count);
+
+    /* the SCPI passes with web socket serializations in another thread */
+    rp_PerfEnable(true);
+    rp_PerfReset();
+    ws_run = 1;
+    pthread_create(&ws, NULL, ws_thread, NULL);
+    for (int i = 0; i < captures; i++) {
+        capture();
+    }
+    ws_run = 0;
+    pthread_join(ws, NULL);
+
+    printf("Stages after %d captures [us]:\n", captures);
+    printf("  %-12s %8s %10s %10s %10s %10s\n", "stage", "count", "mean", "p50", "p99", "max");
+    for (rp_perf_stage_t i = 0; i < RP_PERF_STAGES; i++) {
+        printStat(i);
+    }
+
+    rp_PerfGetStat(RP_PERF_ACQ_READ, &s);
+    CHECK(s.count == 2 * captures, "ACQ_READ count %llu", (unsigned long long)s.count);
+    CHECK(s.mean > 0 && s.p50 <= s.p99 && s.p99 <= s.max && s.mean <= s.max,
+          "ACQ_READ statistics disordered");
+    rp_PerfGetStat(RP_PERF_SCPI_DATA, &s2);
+    CHECK(s2.count == 2 * captures, "SCPI_DATA count %llu", (unsigned long long)s2.count);
+    CHECK(s2.mean > s.mean, "SCPI_DATA (%llu ns) not above its ACQ_READ (%llu ns)",
+          (unsigned long long)s2.mean, (unsigned long long)s.mean);
+    rp_PerfGetStat(RP_PERF_SCPI_TRIG, &s);
+    CHECK(s.count == 2 * captures, "SCPI_TRIG count %llu", (unsigned long long)s.count);
+    CHECK(s.max >= s2.max, "SCPI_TRIG max below SCPI_DATA max");
+    rp_PerfGetStat(RP_PERF_WS_SIGNALS, &s);
+    CHECK(s.count == ws_count, "WS_SIGNALS count %llu of %llu",
+          (unsigned long long)s.count, (unsigned long long)ws_count);
+    rp_PerfGetStat(RP_PERF_OSC_PROCESS, &s);
+    CHECK(s.count == 0, "OSC_PROCESS stamped");
+
+    /* trace, both threads by start time */
+    rp_perf_rec_t trace[256];
+    uint32_t n = 256;
+    uint32_t scpi = UINT32_MAX, web = UINT32_MAX;
+    rp_PerfGetTrace(trace, &n);
+    CHECK(n > 64, "%u stamps in the trace", n);
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t *thread = trace[i].stage == RP_PERF_WS_SIGNALS ? &web : &scpi;
+        CHECK(i == 0 || trace[i].start >= trace[i - 1].start, "trace out of order at %u", i);
+        CHECK(*thread == UINT32_MAX || *thread == trace[i].thread,
+              "stage %u stamped by threads %u & %u", trace[i].stage, *thread, trace[i].thread);
+        *thread = trace[i].thread;
+    }
+    CHECK(scpi != UINT32_MAX && web != UINT32_MAX && scpi != web,
+          "trace of threads %u & %u", scpi, web);
+    CHECK(trace[n - 1].stage == RP_PERF_SCPI_TRIG || trace[n - 1].stage == RP_PERF_WS_SIGNALS,
+          "last stamp of stage %u", trace[n - 1].stage);
+
+    rp_PerfReset();
+    rp_PerfGetStat(RP_PERF_SCPI_DATA, &s);
+    n = 256;
+    rp_PerfGetTrace(trace, &n);
+    CHECK(s.count == 0 && n == 0, "%llu stamps, %u traced after reset", (unsigned long long)s.count, n);
+
+    /* the scope's worker passes stamped by other processes */
+    int failed = otherProcesses(PROCESSES);
+    CHECK(failed == 0, "%d of %d processes failed", failed, PROCESSES);
+    rp_PerfGetStat(RP_PERF_OSC_PROCESS, &s);
+    CHECK(s.count == PROCESSES, "OSC_PROCESS count %llu of %d processes",
+          (unsigned long long)s.count, PROCESSES);
+    printf("Stamps of %d other processes:\n", PROCESSES);
+    printStat(RP_PERF_OSC_PROCESS);
+    rp_PerfReset();
+
+    /* cost of the stamps in an ACQ:SOUR<n>:DATA? reply: 2 begins, 3 ends */
+    double cost_on = stampCost();
+    rp_PerfEnable(false);
+    double cost_off = stampCost();
+    rp_PerfEnable(true);
+    rp_PerfReset();
+    for (int i = 0; i < captures / 4 + 1; i++) {
+        capture();
+    }
+    rp_PerfGetStat(RP_PERF_SCPI_DATA, &s);
+    double share = 2.5 * cost_on / s.mean * 100;
+    printf("Stamp (begin & end): %.1f ns enabled, %.1f ns disabled\n", cost_on, cost_off);
+    printf("Reply %.1f us, tracing %.3f %%\n", s.mean / 1e3, share);
+    CHECK(share < 1.0, "tracing takes %.3f %% of a reply", share);
+
+    rp_Release();
+    benchSimClose();
+    unlink(shm);
+
+    return benchResult();
+}
@@ -0,0 +1,558 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya waveform recorder file format, writer and reader.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "rec_file.h"
+
+_Static_assert(sizeof(rec_file_hdr_t) == 256, "file header layout");
+_Static_assert(sizeof(rec_hdr_t) == 96, "record header layout");
+
+/* Rice parameter of a block stored as raw 16 bit samples */
+#define RICE_RAW     31
+#define RICE_K_BITS  5
+/* Quotients from here on are escaped: RICE_ESC ones and the 16 bit value */
+#define RICE_ESC     16
+
+/** LSB first bit writer */
+typedef struct {
+    uint8_t *p;
+    uint64_t acc;
+    int      bits;
+} bit_wr_t;
+
+static inline void bitPut(bit_wr_t *w, uint32_t v, int n)
+{
+    w->acc |= (uint64_t) v << w->bits;
+    w->bits += n;
+    while (w->bits >= 8) {
+        *w->p++ = (uint8_t) w->acc;
+        w->acc >>= 8;
+        w->bits -= 8;
+    }
+}
+
+static inline void bitFlush(bit_wr_t *w)
+{
+    if (w->bits) {
+        *w->p++ = (uint8_t) w->acc;
+    }
+    w->acc = 0;
+    w->bits = 0;
+}
+
+/** LSB first bit reader, reads zeros past the end and counts them */
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    uint64_t acc;
+    int      bits;
+    int      over;
+} bit_rd_t;
+
+static inline void bitFill(bit_rd_t *r)
+{
+    while (r->bits <= 56) {
+        if (r->p < r->end) {
+            r->acc |= (uint64_t) *r->p++ << r->bits;
+        } else {
+            r->over++;
+        }
+        r->bits += 8;
+    }
+}
+
+static inline uint32_t bitGet(bit_rd_t *r, int n)
+{
+    uint32_t v = (uint32_t) (r->acc & ((1ull << n) - 1));
+    r->acc >>= n;
+    r->bits -= n;
+    return v;
+}
+
+static inline uint16_t zigzag(int16_t d)
+{
+    return (uint16_t) ((d << 1) ^ (d >> 15));
+}
+
+static inline int16_t unzigzag(uint16_t z)
+{
+    return (int16_t) ((z >> 1) ^ -(z & 1));
+}
+
+size_t rec_EncodeBound(uint32_t n)
+{
+    return (size_t) n * sizeof(int16_t) + (n / REC_BLOCK + 1) + 8;
+}
+
+size_t rec_Encode(const int16_t *in, uint32_t n, uint8_t *out)
+{
+    uint16_t z[REC_BLOCK];
+    int16_t prev = 0;
+    bit_wr_t w = { out, 0, 0 };
+
+    for (uint32_t pos = 0; pos < n; pos += REC_BLOCK) {
+        uint32_t len = n - pos < REC_BLOCK ? n - pos : REC_BLOCK;
+        uint64_t sum = 0, bits;
+        int k = 0;
+
+        for (uint32_t i = 0; i < len; i++) {
+            z[i] = zigzag((int16_t) (in[pos + i] - prev));
+            prev = in[pos + i];
+            sum += z[i];
+        }
+        // k about log2 of the mean of the block
+        while (k < 15 && ((uint64_t) len << (k + 1)) <= sum) {
+            k++;
+        }
+        bits = (uint64_t) len * (k + 1);
+        for (uint32_t i = 0; i < len; i++) {
+            uint32_t q = z[i] >> k;
+            bits += q < RICE_ESC ? q : 16;
+        }
+
+        if (bits >= (uint64_t) len * 16) {
+            bitPut(&w, RICE_RAW, RICE_K_BITS);
+            for (uint32_t i = 0; i < len; i++) {
+                bitPut(&w, z[i], 16);
+            }
+            continue;
+        }
+        bitPut(&w, k, RICE_K_BITS);
+        for (uint32_t i = 0; i < len; i++) {
+            uint32_t q = z[i] >> k;
+            if (q < RICE_ESC) {
+                // q ones, a zero and the k low bits
+                bitPut(&w, ((1u << q) - 1) | ((z[i] & ((1u << k) - 1)) << (q + 1)), q + 1 + k);
+            } else {
+                bitPut(&w, (1u << RICE_ESC) - 1, RICE_ESC);
+                bitPut(&w, z[i], 16);
+            }
+        }
+    }
+    bitFlush(&w);
+    return w.p - out;
+}
+
+int rec_Decode(const uint8_t *in, size_t len, int16_t *out, uint32_t n)
+{
+    bit_rd_t r = { in, in + len, 0, 0, 0 };
+    int16_t prev = 0;
+
+    for (uint32_t pos = 0; pos < n; pos += REC_BLOCK) {
+        uint32_t blen = n - pos < REC_BLOCK ? n - pos : REC_BLOCK;
+        int k;
+
+        bitFill(&r);
+        k = bitGet(&r, RICE_K_BITS);
+        if (k == RICE_RAW) {
+            for (uint32_t i = 0; i < blen; i++) {
+                bitFill(&r);
+                prev += unzigzag(bitGet(&r, 16));
+                out[pos + i] = prev;
+            }
+            continue;
+        }
+        if (k > 15) {
+            return -1;
+        }
+        for (uint32_t i = 0; i < blen; i++) {
+            uint32_t z;
+            int q;
+
+            bitFill(&r);
+            q = __builtin_ctzll(~r.acc);
+            if (q < RICE_ESC) {
+                bitGet(&r, q + 1);
+                z = (q << k) | bitGet(&r, k);
+            } else {
+                bitGet(&r, RICE_ESC);
+                z = bitGet(&r, 16);
+            }
+            if (z > 0xffff) {
+                return -1;
+            }
+            prev += unzigzag(z);
+            out[pos + i] = prev;
+        }
+    }
+    // bits taken, the zeros read past the end included
+    uint64_t used = ((uint64_t) (r.p - in) + r.over) * 8 - r.bits;
+    if ((used + 7) / 8 > len) {
+        return -1;
+    }
+    return (int) ((used + 7) / 8);
+}
+
+/** Writes the full part of the buffer, or all of it when flushing */
+static int writerFlush(rec_writer_t *w, bool all)
+{
+    size_t len = all ? w->buf_len : w->buf_len - w->buf_len % REC_IO_ALIGN;
+    size_t done = 0;
+
+    if (all && (w->flags & REC_DIRECT) && len % REC_IO_ALIGN) {
+        // the tail is not a whole block, O_DIRECT can not write it
+        fcntl(w->fd, F_SETFL, fcntl(w->fd, F_GETFL) & ~O_DIRECT);
+        w->flags &= ~REC_DIRECT;
+    }
+    while (done < len) {
+        ssize_t n = write(w->fd, w->buf + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "rec: write failed: %s\n", strerror(errno));
+            w->error = -1;
+            return -1;
+        }
+        done += n;
+    }
+    memmove(w->buf, w->buf + len, w->buf_len - len);
+    w->buf_len -= len;
+    pthread_mutex_lock(&w->lock);
+    w->stat.bytes_written += len;
+    pthread_mutex_unlock(&w->lock);
+    return 0;
+}
+
+static int writerAppend(rec_writer_t *w, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *) data;
+
+    while (len) {
+        size_t n = REC_IO_SIZE - w->buf_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(w->buf + w->buf_len, p, n);
+        w->buf_len += n;
+        p += n;
+        len -= n;
+        if (w->buf_len == REC_IO_SIZE && writerFlush(w, false) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int writerRecord(rec_writer_t *w, rec_record_t *rec)
+{
+    rec_hdr_t *hdr = &rec->hdr;
+    const void *payload[REC_CHANNELS];
+    uint64_t raw = 0;
+
+    hdr->magic = REC_RECORD_MAGIC;
+    hdr->codec = (w->flags & REC_COMPRESS) ? REC_CODEC_RICE : REC_CODEC_RAW;
+    hdr->size = sizeof(*hdr);
+    for (int ch = 0; ch < REC_CHANNELS; ch++) {
+        if (!(hdr->channels & (1 << ch))) {
+            hdr->payload[ch] = 0;
+            continue;
+        }
+        raw += hdr->samples * sizeof(int16_t);
+        if (hdr->codec == REC_CODEC_RICE) {
+            hdr->payload[ch] = rec_Encode(rec->data[ch], hdr->samples, w->enc[ch]);
+            payload[ch] = w->enc[ch];
+        } else {
+            hdr->payload[ch] = hdr->samples * sizeof(int16_t);
+            payload[ch] = rec->data[ch];
+        }
+        hdr->size += hdr->payload[ch];
+    }
+
+    if (writerAppend(w, hdr, sizeof(*hdr)) < 0) {
+        return -1;
+    }
+    for (int ch = 0; ch < REC_CHANNELS; ch++) {
+        if (hdr->payload[ch] && writerAppend(w, payload[ch], hdr->payload[ch]) < 0) {
+            return -1;
+        }
+    }
+    pthread_mutex_lock(&w->lock);
+    w->stat.records++;
+    w->stat.bytes_raw += raw;
+    pthread_mutex_unlock(&w->lock);
+    return 0;
+}
+
+static void *writerThread(void *arg)
+{
+    rec_writer_t *w = (rec_writer_t *) arg;
+    rec_record_t *rec;
+
+    for (;;) {
+        pthread_mutex_lock(&w->lock);
+        while (!w->count && !w->closing) {
+            pthread_cond_wait(&w->filled, &w->lock);
+        }
+        if (!w->count) {
+            pthread_mutex_unlock(&w->lock);
+            break;
+        }
+        rec = &w->slots[w->head];
+        pthread_mutex_unlock(&w->lock);
+
+        // after a failed write the records are still taken, not written
+        if (!w->error) {
+            writerRecord(w, rec);
+        }
+
+        pthread_mutex_lock(&w->lock);
+        w->head = (w->head + 1) % w->slot_cnt;
+        w->count--;
+        pthread_cond_signal(&w->freed);
+        pthread_mutex_unlock(&w->lock);
+    }
+    if (!w->error) {
+        writerFlush(w, true);
+    }
+    return NULL;
+}
+
+static void writerFree(rec_writer_t *w)
+{
+    if (w->slots) {
+        for (int i = 0; i < w->slot_cnt; i++) {
+            for (int ch = 0; ch < REC_CHANNELS; ch++) {
+                free(w->slots[i].data[ch]);
+            }
+        }
+    }
+    for (int ch = 0; ch < REC_CHANNELS; ch++) {
+        free(w->enc[ch]);
+    }
+    free(w->slots);
+    free(w->buf);
+}
+
+int rec_WriterOpen(rec_writer_t *w, const char *path, rec_file_hdr_t *hdr, int flags, int queue)
+{
+    int oflags = O_WRONLY | O_CREAT | O_TRUNC;
+
+    memset(w, 0, sizeof(*w));
+    w->fd = -1;
+    w->flags = flags;
+    if (queue < 1) {
+        queue = 1;
+    }
+
+    if (posix_memalign((void **) &w->buf, REC_IO_ALIGN, REC_IO_SIZE)) {
+        w->buf = NULL;
+        goto fail;
+    }
+    w->slots = (rec_record_t *) calloc(queue, sizeof(rec_record_t));
+    if (w->slots == NULL) {
+        goto fail;
+    }
+    w->slot_cnt = queue;
+    for (int i = 0; i < queue; i++) {
+        for (int ch = 0; ch < REC_CHANNELS; ch++) {
+            w->slots[i].data[ch] = (int16_t *) malloc(REC_MAX_SAMPLES * sizeof(int16_t));
+            if (w->slots[i].data[ch] == NULL) {
+                goto fail;
+            }
+        }
+    }
+    for (int ch = 0; ch < REC_CHANNELS; ch++) {
+        w->enc[ch] = (uint8_t *) malloc(rec_EncodeBound(REC_MAX_SAMPLES));
+        if (w->enc[ch] == NULL) {
+            goto fail;
+        }
+    }
+
+    if (flags & REC_DIRECT) {
+        w->fd = open(path, oflags | O_DIRECT, 0644);
+        // tmpfs and some others do not have it
+        if (w->fd < 0 && errno == EINVAL) {
+            w->flags &= ~REC_DIRECT;
+        }
+    }
+    if (w->fd < 0) {
+        w->fd = open(path, oflags, 0644);
+    }
+    if (w->fd < 0) {
+        fprintf(stderr, "rec: unable to create %s: %s\n", path, strerror(errno));
+        goto fail;
+    }
+
+    memcpy(hdr->magic, REC_FILE_MAGIC, sizeof(hdr->magic));
+    hdr->version = REC_VERSION;
+    hdr->hdr_size = sizeof(*hdr);
+    hdr->rec_hdr_size = sizeof(rec_hdr_t);
+    pthread_mutex_init(&w->lock, NULL);
+    writerAppend(w, hdr, sizeof(*hdr));
+
+    pthread_cond_init(&w->filled, NULL);
+    pthread_cond_init(&w->freed, NULL);
+    if (pthread_create(&w->thread, NULL, writerThread, w) != 0) {
+        fprintf(stderr, "rec: unable to start the writer\n");
+        close(w->fd);
+        goto fail;
+    }
+    return 0;
+
+fail:
+    writerFree(w);
+    return -1;
+}
+
+rec_record_t *rec_WriterGet(rec_writer_t *w, bool wait)
+{
+    rec_record_t *rec = NULL;
+
+    pthread_mutex_lock(&w->lock);
+    while (wait && w->count == w->slot_cnt) {
+        pthread_cond_wait(&w->freed, &w->lock);
+    }
+    if (w->count < w->slot_cnt) {
+        rec = &w->slots[(w->head + w->count) % w->slot_cnt];
+        memset(&rec->hdr, 0, sizeof(rec->hdr));
+        rec->hdr.lost = w->stat.dropped - w->reported;
+        w->reported = w->stat.dropped;
+    } else {
+        w->stat.dropped++;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return rec;
+}
+
+void rec_WriterPut(rec_writer_t *w, rec_record_t *rec)
+{
+    pthread_mutex_lock(&w->lock);
+    w->count++;
+    pthread_cond_signal(&w->filled);
+    pthread_mutex_unlock(&w->lock);
+}
+
+int rec_WriterClose(rec_writer_t *w, rec_stat_t *stat)
+{
+    int status;
+
+    pthread_mutex_lock(&w->lock);
+    w->closing = true;
+    pthread_cond_signal(&w->filled);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    status = w->error;
+    if (close(w->fd) < 0) {
+        status = -1;
+    }
+    if (stat) {
+        *stat = w->stat;
+    }
+    pthread_cond_destroy(&w->freed);
+    pthread_cond_destroy(&w->filled);
+    pthread_mutex_destroy(&w->lock);
+    writerFree(w);
+    return status;
+}
+
+void rec_WriterStat(rec_writer_t *w, rec_stat_t *stat)
+{
+    pthread_mutex_lock(&w->lock);
+    *stat = w->stat;
+    pthread_mutex_unlock(&w->lock);
+}
+
+int rec_ReaderOpen(rec_reader_t *r, const char *path)
+{
+    memset(r, 0, sizeof(*r));
+    r->f = fopen(path, "rb");
+    if (r->f == NULL) {
+        fprintf(stderr, "rec: unable to open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    setvbuf(r->f, NULL, _IOFBF, REC_IO_SIZE);
+
+    if (fread(&r->hdr, sizeof(r->hdr), 1, r->f) != 1
+        || memcmp(r->hdr.magic, REC_FILE_MAGIC, sizeof(r->hdr.magic))
+        || r->hdr.hdr_size < sizeof(r->hdr)
+        || r->hdr.rec_hdr_size < sizeof(rec_hdr_t)) {
+        fprintf(stderr, "rec: %s is not a recording\n", path);
+        fclose(r->f);
+        return -1;
+    }
+    fseeko(r->f, r->hdr.hdr_size, SEEK_SET);
+    return 0;
+}
+
+int rec_ReaderNext(rec_reader_t *r, rec_hdr_t *hdr, int16_t *data[REC_CHANNELS])
+{
+    size_t n = fread(hdr, 1, sizeof(*hdr), r->f);
+    size_t len, pos;
+
+    if (n == 0 && feof(r->f)) {
+        return 0;
+    }
+    if (n != sizeof(*hdr) || hdr->magic != REC_RECORD_MAGIC
+        || hdr->samples > REC_MAX_SAMPLES || hdr->size < r->hdr.rec_hdr_size) {
+        return -1;
+    }
+    if (r->hdr.rec_hdr_size > sizeof(*hdr)) {
+        fseeko(r->f, r->hdr.rec_hdr_size - sizeof(*hdr), SEEK_CUR);
+    }
+
+    len = hdr->size - r->hdr.rec_hdr_size;
+    if (len > r->payload_len) {
+        uint8_t *p = (uint8_t *) realloc(r->payload, len);
+        if (p == NULL) {
+            return -1;
+        }
+        r->payload = p;
+        r->payload_len = len;
+    }
+    if (fread(r->payload, 1, len, r->f) != len) {
+        return -1;
+    }
+
+    pos = 0;
+    for (int ch = 0; ch < REC_CHANNELS; ch++) {
+        size_t size = hdr->payload[ch];
+
+        if (!(hdr->channels & (1 << ch))) {
+            continue;
+        }
+        if (size > len - pos) {
+            return -1;
+        }
+        if (data[ch]) {
+            if (hdr->codec == REC_CODEC_RAW) {
+                if (size != hdr->samples * sizeof(int16_t)) {
+                    return -1;
+                }
+                memcpy(data[ch], r->payload + pos, size);
+            } else if (hdr->codec != REC_CODEC_RICE
+                       || rec_Decode(r->payload + pos, size, data[ch], hdr->samples) != (int) size) {
+                return -1;
+            }
+        }
+        pos += size;
+    }
+    return 1;
+}
+
+void rec_ReaderClose(rec_reader_t *r)
+{
+    if (r->f) {
+        fclose(r->f);
+    }
+    free(r->payload);
+    r->f = NULL;
+    r->payload = NULL;
+}
@@ -0,0 +1,175 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya waveform recorder file format, writer and reader.
+ *
+ * A recording is a file header followed by records, one per trigger. All
+ * fields are little endian. The file header gives its own size and the size
+ * of the record header, so readers skip fields added by later versions.
+ * Every record starts with a header holding its size, the trigger time,
+ * decimation and per channel gain and calibration, followed by the samples
+ * of each recorded channel, as raw int16 or compressed (REC_CODEC_RICE):
+ * differences of successive samples, zig-zag mapped and Rice coded in blocks
+ * of REC_BLOCK samples with a Rice parameter per block (blocks that do not
+ * compress are stored raw). The codec is lossless.
+ *
+ * The writer queues records from the acquisition and encodes and writes
+ * them on its own thread, in REC_IO_SIZE writes from an aligned buffer.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __REC_FILE_H
+#define __REC_FILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define REC_FILE_MAGIC      "RPREC\r\n\032"
+#define REC_RECORD_MAGIC    0x43455252  /* "RREC" */
+#define REC_VERSION         1
+
+#define REC_CHANNELS        2
+#define REC_MAX_SAMPLES     (16 * 1024)
+
+#define REC_CODEC_RAW       0
+#define REC_CODEC_RICE      1
+#define REC_BLOCK           256
+
+/* Writer flags */
+#define REC_COMPRESS        (1 << 0)
+#define REC_DIRECT          (1 << 1)    /* O_DIRECT, if the file system has it */
+
+#define REC_IO_SIZE         (1024 * 1024)
+#define REC_IO_ALIGN        4096
+
+typedef struct {
+    char     magic[8];        /* REC_FILE_MAGIC */
+    uint32_t version;
+    uint32_t hdr_size;        /* sizeof(rec_file_hdr_t) */
+    uint32_t rec_hdr_size;    /* sizeof(rec_hdr_t) */
+    uint32_t adc_bits;
+    double   base_rate;       /* undecimated sample rate [Hz] */
+    uint64_t start_ns;        /* recording start, CLOCK_REALTIME [ns] */
+    uint32_t pre;             /* samples before the trigger */
+    uint32_t post;            /* samples from the trigger on */
+    char     info[208];       /* settings as text */
+} rec_file_hdr_t;
+
+typedef struct {
+    uint32_t gain;            /* rp_pinState_t */
+    float    gain_v;          /* input range [V] */
+    uint32_t calib_fs;        /* front end full scale calibration */
+    int32_t  calib_offs;      /* front end DC offset [counts], already subtracted */
+    float    volts;           /* volts per count */
+} rec_chan_t;
+
+typedef struct {
+    uint32_t magic;           /* REC_RECORD_MAGIC */
+    uint32_t size;            /* bytes of the record, header included */
+    uint64_t seq;             /* record number */
+    uint64_t timestamp_ns;    /* trigger time, CLOCK_REALTIME [ns] */
+    uint32_t decimation;
+    uint32_t samples;         /* per channel */
+    uint32_t trig_sample;     /* index of the trigger sample */
+    uint32_t lost;            /* triggers dropped before this record */
+    uint16_t channels;        /* mask of recorded channels */
+    uint16_t codec;           /* REC_CODEC_* */
+    uint32_t payload[REC_CHANNELS];   /* bytes of the samples of each channel */
+    rec_chan_t ch[REC_CHANNELS];
+    uint32_t reserved;
+} rec_hdr_t;
+
+/* A record as queued to the writer */
+typedef struct {
+    rec_hdr_t hdr;
+    int16_t  *data[REC_CHANNELS];     /* REC_MAX_SAMPLES each */
+} rec_record_t;
+
+typedef struct {
+    uint64_t records;
+    uint64_t dropped;         /* records not queued, the queue was full */
+    uint64_t bytes_raw;       /* samples as int16 */
+    uint64_t bytes_written;
+} rec_stat_t;
+
+typedef struct {
+    int             fd;
+    int             flags;
+    int             error;
+    uint8_t        *buf;      /* REC_IO_SIZE, REC_IO_ALIGN aligned */
+    size_t          buf_len;
+    uint8_t        *enc[REC_CHANNELS];
+
+    rec_record_t   *slots;
+    int             slot_cnt;
+    int             head;
+    int             count;
+    bool            closing;
+    uint64_t        reported; /* dropped records already put in a header */
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  filled;
+    pthread_cond_t  freed;
+    rec_stat_t      stat;
+} rec_writer_t;
+
+typedef struct {
+    FILE           *f;
+    rec_file_hdr_t  hdr;
+    uint8_t        *payload;
+    size_t          payload_len;
+} rec_reader_t;
+
+/**
+ * Creates the file, writes the header and starts the writer thread.
+ * @param queue Number of records queued at most.
+ * @return 0 or -1.
+ */
+int rec_WriterOpen(rec_writer_t *w, const char *path, rec_file_hdr_t *hdr, int flags, int queue);
+
+/**
+ * Returns a free record to fill and pass to rec_WriterPut(), for one
+ * producer thread. If the queue is full, waits for the writer or returns
+ * NULL and counts the record dropped.
+ */
+rec_record_t *rec_WriterGet(rec_writer_t *w, bool wait);
+void rec_WriterPut(rec_writer_t *w, rec_record_t *rec);
+
+/**
+ * Writes the queued records, closes the file and frees the writer.
+ * @param stat Final statistic, may be NULL.
+ * @return 0 or -1 if a write failed.
+ */
+int rec_WriterClose(rec_writer_t *w, rec_stat_t *stat);
+void rec_WriterStat(rec_writer_t *w, rec_stat_t *stat);
+
+int rec_ReaderOpen(rec_reader_t *r, const char *path);
+
+/**
+ * Reads the next record, decoded to data (REC_MAX_SAMPLES per channel, a
+ * NULL channel is skipped).
+ * @return 1, 0 at the end of the file or -1 on a damaged or cut record.
+ */
+int rec_ReaderNext(rec_reader_t *r, rec_hdr_t *hdr, int16_t *data[REC_CHANNELS]);
+void rec_ReaderClose(rec_reader_t *r);
+
+/**
+ * Compresses samples, out has room for rec_EncodeBound(n) bytes.
+ * @return Bytes written.
+ */
+size_t rec_EncodeBound(uint32_t n);
+size_t rec_Encode(const int16_t *in, uint32_t n, uint8_t *out);
+
+/**
+ * @return Bytes of in used or -1 if it is damaged.
+ */
+int rec_Decode(const uint8_t *in, size_t len, int16_t *out, uint32_t n);
+
+#endif /* __REC_FILE_H */
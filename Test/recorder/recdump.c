@@ -0,0 +1,101 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya waveform recording dump.
+ *
+ * Lists the records of a recorder file, or prints the samples of one record
+ * in volts, a line per sample with the time from the trigger.
+ *
+ * Usage: recdump [-r RECORD] FILE
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "rec_file.h"
+
+static int16_t samples[REC_CHANNELS][REC_MAX_SAMPLES];
+
+static void printRecord(const rec_file_hdr_t *fhdr, const rec_hdr_t *hdr)
+{
+    double period = hdr->decimation / fhdr->base_rate;
+
+    for (uint32_t i = 0; i < hdr->samples; i++) {
+        printf("%.9f", ((int64_t) i - hdr->trig_sample) * period);
+        for (int ch = 0; ch < REC_CHANNELS; ch++) {
+            if (hdr->channels & (1 << ch)) {
+                printf(" %.6f", samples[ch][i] * hdr->ch[ch].volts);
+            }
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int16_t *data[REC_CHANNELS] = { samples[0], samples[1] };
+    rec_reader_t reader;
+    rec_hdr_t hdr;
+    int64_t select = -1;
+    uint64_t n = 0, lost = 0;
+    int opt, ret;
+
+    while ((opt = getopt(argc, argv, "r:")) != -1) {
+        if (opt != 'r') {
+            fprintf(stderr, "Usage: %s [-r RECORD] FILE\n", argv[0]);
+            return -1;
+        }
+        select = strtoll(optarg, NULL, 0);
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s [-r RECORD] FILE\n", argv[0]);
+        return -1;
+    }
+    if (rec_ReaderOpen(&reader, argv[optind]) < 0) {
+        return -1;
+    }
+    if (select < 0) {
+        printf("%s\npre %u, post %u, base rate %.0f Hz\n",
+               reader.hdr.info, reader.hdr.pre, reader.hdr.post, reader.hdr.base_rate);
+    }
+
+    while ((ret = rec_ReaderNext(&reader, &hdr, data)) > 0) {
+        if (select < 0) {
+            printf("%llu: %llu.%09llu dec %u, %u samples, trigger at %u, %u bytes%s",
+                   (unsigned long long) hdr.seq,
+                   (unsigned long long) (hdr.timestamp_ns / 1000000000ull),
+                   (unsigned long long) (hdr.timestamp_ns % 1000000000ull),
+                   hdr.decimation, hdr.samples, hdr.trig_sample, hdr.size,
+                   hdr.codec == REC_CODEC_RICE ? " compressed" : "");
+            if (hdr.lost) {
+                printf(", %u lost before", hdr.lost);
+            }
+            printf("\n");
+        } else if (n == (uint64_t) select) {
+            printRecord(&reader.hdr, &hdr);
+            break;
+        }
+        lost += hdr.lost;
+        n++;
+    }
+    rec_ReaderClose(&reader);
+    if (ret < 0) {
+        fprintf(stderr, "Damaged record after %llu records\n", (unsigned long long) n);
+        return -1;
+    }
+    if (select < 0) {
+        printf("%llu records, %llu lost\n", (unsigned long long) n, (unsigned long long) lost);
+    } else if (n != (uint64_t) select) {
+        fprintf(stderr, "No record %lld\n", (long long) select);
+        return -1;
+    }
+    return 0;
+}
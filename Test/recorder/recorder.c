@@ -0,0 +1,374 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya waveform recorder.
+ *
+ * Records trigger armed acquisitions to a file, back to back: every record
+ * holds the samples before (pre) and after (post) a trigger, with the
+ * trigger time, decimation, gain and calibration, see rec_file.h. The
+ * acquisition is armed again as soon as the samples are read, encoding and
+ * writing the records runs on the writer thread. If the writer falls behind
+ * records are dropped and counted in the next record's header.
+ *
+ * Usage: recorder [OPTION]... FILE
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "redpitaya/rp.h"
+#include "rec_file.h"
+
+#define ADC_BITS         14
+#define FULL_SCALE_NORM  20.0   /* V, as librp */
+#define BASE_RATE        125e6
+#define TRIG_POLL        256    /* samples between trigger state polls */
+
+/** Program name */
+const char *g_argv0 = NULL;
+
+static volatile sig_atomic_t running = 1;
+
+static void sigHandler(int sig)
+{
+    running = 0;
+}
+
+/** Print usage information */
+static void usage()
+{
+    const char *format =
+        "\n"
+        "Usage: %s [OPTION]... FILE\n"
+        "\n"
+        "OPTIONS:\n"
+        " -c CH     Channels to record: 1, 2 or 12 (default).\n"
+        " -d DEC    Decimation: 1 (default), 8, 64, 1024, 8192 or 65536.\n"
+        " -t TRIG   Trigger: now, ch1_pe (default), ch1_ne, ch2_pe, ch2_ne,\n"
+        "           ext_pe or ext_ne.\n"
+        " -l LEVEL  Trigger level [V] (default 0).\n"
+        " -g GAIN   Input gain as the jumpers: lv (default) or hv.\n"
+        " -p PRE    Samples before the trigger (default 1024).\n"
+        " -n POST   Samples from the trigger on (default 7168).\n"
+        " -r COUNT  Records to take, 0 (default) until interrupted.\n"
+        " -q QUEUE  Records queued to the writer (default 64).\n"
+        " -z        Compress the samples (lossless).\n"
+        " -D        Write with O_DIRECT.\n"
+        " -h        Print this info.\n"
+        "\n";
+
+    fprintf(stderr, format, g_argv0);
+}
+
+static const struct {
+    const char *name;
+    rp_acq_trig_src_t src;
+} triggers[] = {
+    { "now",    RP_TRIG_SRC_NOW },
+    { "ch1_pe", RP_TRIG_SRC_CHA_PE },
+    { "ch1_ne", RP_TRIG_SRC_CHA_NE },
+    { "ch2_pe", RP_TRIG_SRC_CHB_PE },
+    { "ch2_ne", RP_TRIG_SRC_CHB_NE },
+    { "ext_pe", RP_TRIG_SRC_EXT_PE },
+    { "ext_ne", RP_TRIG_SRC_EXT_NE },
+};
+
+static const struct {
+    uint32_t factor;
+    rp_acq_decimation_t dec;
+} decimations[] = {
+    { 1, RP_DEC_1 }, { 8, RP_DEC_8 }, { 64, RP_DEC_64 },
+    { 1024, RP_DEC_1024 }, { 8192, RP_DEC_8192 }, { 65536, RP_DEC_65536 },
+};
+
+static uint64_t timeNs(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void sleepNs(uint64_t ns)
+{
+    struct timespec ts = { ns / 1000000000ull, ns % 1000000000ull };
+    nanosleep(&ts, NULL);
+}
+
+/** Waits until samples are written after start_pos */
+static int waitSamples(uint32_t start_pos, uint32_t samples, uint64_t period_ns)
+{
+    uint32_t last = start_pos, pos;
+    uint64_t written = 0;
+
+    while (written < samples && running) {
+        uint64_t ns = (samples - written) * period_ns;
+        sleepNs(ns < 1000000 ? ns : 1000000);
+        if (rp_AcqGetWritePointer(&pos) != RP_OK) {
+            return -1;
+        }
+        written += (pos + ADC_BUFFER_SIZE - last) % ADC_BUFFER_SIZE;
+        last = pos;
+    }
+    return 0;
+}
+
+/** Waits for the trigger, polling every TRIG_POLL samples, 1 ms at most */
+static int waitTrigger(uint64_t period_ns)
+{
+    uint64_t ns = TRIG_POLL * period_ns;
+    rp_acq_trig_state_t state;
+
+    while (running) {
+        if (rp_AcqGetTriggerState(&state) != RP_OK) {
+            return -1;
+        }
+        if (state == RP_TRIG_STATE_TRIGGERED) {
+            break;
+        }
+        sleepNs(ns < 1000000 ? ns : 1000000);
+    }
+    return 0;
+}
+
+/** Volts per count as rp_AcqGetDataV() converts them */
+static void channelCalib(rp_channel_t ch, rp_pinState_t gain, rec_chan_t *calib)
+{
+    rp_calib_params_t params = rp_GetCalibrationSettings();
+    double fs_v;
+
+    calib->gain = gain;
+    calib->gain_v = gain == RP_HIGH ? 20.0 : 1.0;
+    if (ch == RP_CH_1) {
+        calib->calib_fs = gain == RP_HIGH ? params.fe_ch1_fs_g_hi : params.fe_ch1_fs_g_lo;
+        calib->calib_offs = gain == RP_HIGH ? params.fe_ch1_hi_offs : params.fe_ch1_lo_offs;
+    } else {
+        calib->calib_fs = gain == RP_HIGH ? params.fe_ch2_fs_g_hi : params.fe_ch2_fs_g_lo;
+        calib->calib_offs = gain == RP_HIGH ? params.fe_ch2_hi_offs : params.fe_ch2_lo_offs;
+    }
+    fs_v = calib->calib_fs ? calib->calib_fs * 100.0 / ((uint64_t) 1 << 32) : 1.0;
+    calib->volts = calib->gain_v / (1 << (ADC_BITS - 1)) * fs_v / (FULL_SCALE_NORM / calib->gain_v);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t channels = 3, dec = 1, pre = 1024, post = 7168;
+    rp_acq_trig_src_t trig = RP_TRIG_SRC_CHA_PE;
+    rp_pinState_t gain = RP_LOW;
+    float level = 0;
+    uint64_t count = 0, seq = 0;
+    int queue = 64, flags = 0;
+    rp_acq_decimation_t dec_sel = RP_DEC_1;
+    rec_file_hdr_t fhdr;
+    rec_chan_t calib[REC_CHANNELS];
+    rec_writer_t writer;
+    rec_stat_t stat;
+    uint64_t period_ns, start;
+    int opt, i, ret = 0;
+
+    g_argv0 = argv[0];
+    while ((opt = getopt(argc, argv, "c:d:t:l:g:p:n:r:q:zDh")) != -1) {
+        switch (opt) {
+        case 'c':
+            channels = !strcmp(optarg, "1") ? 1 : !strcmp(optarg, "2") ? 2 : !strcmp(optarg, "12") ? 3 : 0;
+            if (!channels) {
+                fprintf(stderr, "Unknown channels %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'd':
+            dec = strtoul(optarg, NULL, 0);
+            for (i = 0; i < (int) (sizeof(decimations) / sizeof(decimations[0])); i++) {
+                if (decimations[i].factor == dec) {
+                    dec_sel = decimations[i].dec;
+                    break;
+                }
+            }
+            if (i == sizeof(decimations) / sizeof(decimations[0])) {
+                fprintf(stderr, "Unknown decimation %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 't':
+            for (i = 0; i < (int) (sizeof(triggers) / sizeof(triggers[0])); i++) {
+                if (!strcasecmp(triggers[i].name, optarg)) {
+                    trig = triggers[i].src;
+                    break;
+                }
+            }
+            if (i == sizeof(triggers) / sizeof(triggers[0])) {
+                fprintf(stderr, "Unknown trigger %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'l':
+            level = strtof(optarg, NULL);
+            break;
+        case 'g':
+            if (!strcasecmp(optarg, "lv")) {
+                gain = RP_LOW;
+            } else if (!strcasecmp(optarg, "hv")) {
+                gain = RP_HIGH;
+            } else {
+                fprintf(stderr, "Unknown gain %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'p':
+            pre = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            post = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            count = strtoull(optarg, NULL, 0);
+            break;
+        case 'q':
+            queue = atoi(optarg);
+            break;
+        case 'z':
+            flags |= REC_COMPRESS;
+            break;
+        case 'D':
+            flags |= REC_DIRECT;
+            break;
+        case 'h':
+            usage();
+            return 0;
+        default:
+            usage();
+            return -1;
+        }
+    }
+    if (optind != argc - 1) {
+        usage();
+        return -1;
+    }
+    if (post < 1 || pre + post > ADC_BUFFER_SIZE) {
+        fprintf(stderr, "Pre and post trigger samples must be at most %d together\n", ADC_BUFFER_SIZE);
+        return -1;
+    }
+    period_ns = dec * 8;
+
+    if (rp_Init() != RP_OK) {
+        fprintf(stderr, "Red Pitaya API init failed!\n");
+        return -1;
+    }
+    if (rp_AcqReset() != RP_OK
+        || rp_AcqSetDecimation(dec_sel) != RP_OK
+        || rp_AcqSetGain(RP_CH_1, gain) != RP_OK
+        || rp_AcqSetGain(RP_CH_2, gain) != RP_OK
+        || rp_AcqSetTriggerLevel(level) != RP_OK
+        || rp_AcqSetTriggerDelay(post - ADC_BUFFER_SIZE / 2) != RP_OK) {
+        fprintf(stderr, "Acquisition setup failed!\n");
+        rp_Release();
+        return -1;
+    }
+    channelCalib(RP_CH_1, gain, &calib[0]);
+    channelCalib(RP_CH_2, gain, &calib[1]);
+
+    memset(&fhdr, 0, sizeof(fhdr));
+    fhdr.adc_bits = ADC_BITS;
+    fhdr.base_rate = BASE_RATE;
+    fhdr.start_ns = timeNs(CLOCK_REALTIME);
+    fhdr.pre = pre;
+    fhdr.post = post;
+    for (i = 0; triggers[i].src != trig; i++);
+    snprintf(fhdr.info, sizeof(fhdr.info), "channels=%s decimation=%u trigger=%s level=%g gain=%s",
+             channels == 3 ? "12" : channels == 1 ? "1" : "2", dec, triggers[i].name, level,
+             gain == RP_HIGH ? "hv" : "lv");
+    if (rec_WriterOpen(&writer, argv[optind], &fhdr, flags, queue) < 0) {
+        rp_Release();
+        return -1;
+    }
+
+    signal(SIGINT, sigHandler);
+    signal(SIGTERM, sigHandler);
+    start = timeNs(CLOCK_MONOTONIC);
+
+    while (running && (!count || seq < count)) {
+        uint32_t pos, trig_pos, now_pos;
+        uint64_t ts;
+        rec_record_t *rec;
+
+        // the samples before the trigger must be fresh before arming it
+        if (rp_AcqGetWritePointer(&pos) != RP_OK || rp_AcqStart() != RP_OK
+            || waitSamples(pos, pre, period_ns) < 0
+            || rp_AcqSetTriggerSrc(trig) != RP_OK
+            || waitTrigger(period_ns) < 0) {
+            ret = -1;
+            break;
+        }
+        if (!running) {
+            break;
+        }
+
+        // the trigger time, back from the samples written since
+        ts = timeNs(CLOCK_REALTIME);
+        if (rp_AcqGetWritePointerAtTrig(&trig_pos) != RP_OK || rp_AcqGetWritePointer(&now_pos) != RP_OK) {
+            ret = -1;
+            break;
+        }
+        ts -= ((now_pos + ADC_BUFFER_SIZE - trig_pos) % ADC_BUFFER_SIZE) * period_ns;
+        if (waitSamples(trig_pos, post, period_ns) < 0) {
+            ret = -1;
+            break;
+        }
+
+        // dropped if the writer is behind, counted in the next header
+        rec = rec_WriterGet(&writer, false);
+        if (rec) {
+            rec->hdr.seq = seq;
+            rec->hdr.timestamp_ns = ts;
+            rec->hdr.decimation = dec;
+            rec->hdr.samples = pre + post;
+            rec->hdr.trig_sample = pre;
+            rec->hdr.channels = channels;
+            for (int ch = 0; ch < REC_CHANNELS; ch++) {
+                uint32_t size = pre + post;
+
+                rec->hdr.ch[ch] = calib[ch];
+                if ((channels & (1 << ch))
+                    && rp_AcqGetDataRaw((rp_channel_t) ch, (trig_pos + ADC_BUFFER_SIZE - pre) % ADC_BUFFER_SIZE,
+                                        &size, rec->data[ch]) != RP_OK) {
+                    ret = -1;
+                }
+            }
+            rec_WriterPut(&writer, rec);
+        }
+        seq++;
+        if (ret) {
+            break;
+        }
+    }
+    rp_AcqStop();
+
+    if (rec_WriterClose(&writer, &stat) < 0) {
+        ret = -1;
+    }
+    double t = (timeNs(CLOCK_MONOTONIC) - start) * 1e-9;
+    fprintf(stderr, "%llu records (%llu dropped) in %.1f s, %.1f records/s, %.2f MB written",
+            (unsigned long long) stat.records, (unsigned long long) stat.dropped, t, stat.records / t,
+            stat.bytes_written / 1e6);
+    if (stat.bytes_written) {
+        fprintf(stderr, ", compression %.2f", (double) stat.bytes_raw / stat.bytes_written);
+    }
+    fprintf(stderr, "\n");
+
+    rp_Release();
+    return ret;
+}
@@ -0,0 +1,195 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya waveform recorder file writer benchmark.
+ *
+ * Queues synthetic two channel records (a noisy sine on channel 1, noise
+ * around a slow ramp on channel 2, as 14 bit ADC counts, made ahead so the
+ * time measured is the writer's) to the recorder writer as fast as it takes
+ * them, raw and compressed, and reports records/s, MB/s of samples and the
+ * compression ratio. Every file is read back with the
+ * reader and compared to the records written, the codec is also checked on
+ * full scale noise and extreme steps that it must store raw.
+ *
+ * Usage: recorder_bench [DIR] (default /dev/shm)
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rec_file.h"
+#include "bench.h"
+
+#define RECORDS   1000
+#define SAMPLES   (16 * 1024)
+#define PRE       2048
+#define VARIANTS  16
+
+static uint32_t lcg(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+/** About gaussian noise of sigma counts */
+static double noise(uint32_t *state, double sigma)
+{
+    double s = 0;
+    for (int i = 0; i < 4; i++) {
+        s += (lcg(state) & 0xffff) / 65536.0 - 0.5;
+    }
+    return s * sigma * 1.732;
+}
+
+static int16_t clip14(double v)
+{
+    long x = lround(v);
+    return x > 8191 ? 8191 : x < -8192 ? -8192 : (int16_t) x;
+}
+
+static int16_t variant[VARIANTS][REC_CHANNELS][SAMPLES];
+
+static void synth(uint64_t seq, int16_t *ch1, int16_t *ch2)
+{
+    uint32_t state = (uint32_t) seq * 2654435761u + 1;
+    double phase = (seq % 97) * 0.1;
+
+    for (int i = 0; i < SAMPLES; i++) {
+        ch1[i] = clip14(6000 * sin(2 * M_PI * i / 137.3 + phase) + noise(&state, 3));
+        ch2[i] = clip14(-2000 + i * 0.05 + noise(&state, 2));
+    }
+}
+
+static void fill(rec_record_t *rec, uint64_t seq)
+{
+    rec->hdr.seq = seq;
+    rec->hdr.timestamp_ns = 1700000000000000000ull + seq * 1000000ull;
+    rec->hdr.decimation = 8;
+    rec->hdr.samples = SAMPLES;
+    rec->hdr.trig_sample = PRE;
+    rec->hdr.channels = 3;
+    for (int ch = 0; ch < REC_CHANNELS; ch++) {
+        rec->hdr.ch[ch].gain = 0;
+        rec->hdr.ch[ch].gain_v = 1.0;
+        rec->hdr.ch[ch].calib_fs = 0;
+        rec->hdr.ch[ch].volts = 1.0 / 8192 / 20;
+    }
+    memcpy(rec->data[0], variant[seq % VARIANTS][0], SAMPLES * sizeof(int16_t));
+    memcpy(rec->data[1], variant[seq % VARIANTS][1], SAMPLES * sizeof(int16_t));
+}
+
+static void runCase(const char *dir, const char *name, int flags)
+{
+    static int16_t got[REC_CHANNELS][REC_MAX_SAMPLES];
+    int16_t *data[REC_CHANNELS] = { got[0], got[1] };
+    char path[256];
+    rec_file_hdr_t fhdr;
+    rec_writer_t writer;
+    rec_reader_t reader;
+    rec_stat_t stat;
+    rec_hdr_t hdr;
+    double t;
+    uint64_t n = 0;
+    int ret;
+
+    snprintf(path, sizeof(path), "%s/recorder_bench_%s.rec", dir, name);
+    memset(&fhdr, 0, sizeof(fhdr));
+    fhdr.adc_bits = 14;
+    fhdr.base_rate = 125e6;
+    fhdr.pre = PRE;
+    fhdr.post = SAMPLES - PRE;
+    snprintf(fhdr.info, sizeof(fhdr.info), "recorder_bench %s", name);
+
+    if (rec_WriterOpen(&writer, path, &fhdr, flags, 16) < 0) {
+        failures++;
+        return;
+    }
+    t = timeNow();
+    for (uint64_t seq = 0; seq < RECORDS; seq++) {
+        rec_record_t *rec = rec_WriterGet(&writer, true);
+        fill(rec, seq);
+        rec_WriterPut(&writer, rec);
+    }
+    CHECK(rec_WriterClose(&writer, &stat) == 0, "%s: write failed", name);
+    t = timeNow() - t;
+
+    printf("%-10s %6.0f records/s %8.1f MB/s  %6.2f MB  ratio %.2f\n",
+           name, stat.records / t, stat.bytes_raw / t / 1e6, stat.bytes_written / 1e6,
+           (double) stat.bytes_raw / stat.bytes_written);
+    CHECK(stat.records == RECORDS && stat.dropped == 0, "%s: %llu records, %llu dropped", name,
+          (unsigned long long) stat.records, (unsigned long long) stat.dropped);
+
+    if (rec_ReaderOpen(&reader, path) < 0) {
+        failures++;
+        return;
+    }
+    CHECK(reader.hdr.pre == PRE && !strcmp(reader.hdr.info, fhdr.info), "%s: file header", name);
+    t = timeNow();
+    while ((ret = rec_ReaderNext(&reader, &hdr, data)) > 0) {
+        CHECK(hdr.seq == n && hdr.samples == SAMPLES && hdr.trig_sample == PRE && hdr.lost == 0
+              && hdr.timestamp_ns == 1700000000000000000ull + n * 1000000ull,
+              "%s: record %llu header", name, (unsigned long long) n);
+        CHECK(!memcmp(variant[n % VARIANTS][0], got[0], SAMPLES * sizeof(int16_t))
+              && !memcmp(variant[n % VARIANTS][1], got[1], SAMPLES * sizeof(int16_t)),
+              "%s: record %llu samples differ", name, (unsigned long long) n);
+        n++;
+    }
+    t = timeNow() - t;
+    CHECK(ret == 0 && n == RECORDS, "%s: read %llu records, %d", name, (unsigned long long) n, ret);
+    printf("%-10s read back %6.0f records/s, bit exact\n", name, n / t);
+    rec_ReaderClose(&reader);
+    unlink(path);
+}
+
+/** Codec on worst cases: full scale noise, alternating extremes, short tails */
+static void codecCheck(void)
+{
+    static int16_t in[REC_MAX_SAMPLES], out[REC_MAX_SAMPLES];
+    static uint8_t enc[REC_MAX_SAMPLES * 4];
+    uint32_t state = 7;
+    const uint32_t lens[] = { REC_MAX_SAMPLES, 1, 255, 257, 1000 };
+
+    for (int c = 0; c < 3; c++) {
+        for (int l = 0; l < (int) (sizeof(lens) / sizeof(lens[0])); l++) {
+            uint32_t n = lens[l];
+            for (uint32_t i = 0; i < n; i++) {
+                in[i] = c == 0 ? (int16_t) lcg(&state)
+                      : c == 1 ? (i & 1 ? 32767 : -32768)
+                      : (int16_t) (i * 37 % 29 - 14);
+            }
+            size_t size = rec_Encode(in, n, enc);
+            CHECK(size <= rec_EncodeBound(n), "codec %d/%u: %zu bytes over the bound", c, n, size);
+            CHECK(rec_Decode(enc, size, out, n) == (int) size && !memcmp(in, out, n * sizeof(int16_t)),
+                  "codec %d/%u: round trip", c, n);
+            CHECK(rec_Decode(enc, size - 1, out, n) < 0 || size == 1, "codec %d/%u: cut input accepted", c, n);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = argc > 1 ? argv[1] : "/dev/shm";
+
+    for (int v = 0; v < VARIANTS; v++) {
+        synth(v, variant[v][0], variant[v][1]);
+    }
+    printf("%d records of 2 x %d samples to %s\n", RECORDS, SAMPLES, dir);
+    runCase(dir, "raw", 0);
+    runCase(dir, "rice", REC_COMPRESS);
+    runCase(dir, "raw-direct", REC_DIRECT);
+    codecCheck();
+
+    if (failures) {
+        printf("%d checks FAILED\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
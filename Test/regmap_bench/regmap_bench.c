@@ -0,0 +1,178 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya register map service benchmark.
+ *
+ * Maps a memfd standing in for the FPGA address space through the shared
+ * register map service, so no Red Pitaya is needed. Checks that:
+ *
+ *  - regions inside one FPGA block share a single mapping,
+ *  - writes through one handle are seen through the others,
+ *  - the handle accessors refuse registers outside the region,
+ *  - handles rebuilt from the register pointer (the librp way) release
+ *    their mapping, the last put unmaps it.
+ *
+ * Then the old per-access scheme (mmap() & munmap() of a page around every
+ * register access, as Test/monitor and the IST controller did) is timed
+ * against regmap_get() & regmap_put() with the block held by an application.
+ *
+ * Usage: regmap_bench [iterations]  (default 100000)
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "regmap.h"
+#include "bench.h"
+
+#define OSC_ADDR   0x40100000
+#define OSC_SIZE   0x30000
+#define AWG_ADDR   0x40200000
+#define AWG_SIZE   0x30000
+#define AMS_ADDR   0x40400000
+
+typedef struct {
+    uint32_t conf;
+    uint32_t trig_source;
+    uint32_t cha_thr;
+    uint32_t chb_thr;
+} osc_regs_t;
+
+static void check_cache(void)
+{
+    regmap_block_t osc, thr, awg, rebuilt;
+    regmap_stats_t st;
+    uint32_t val = 0;
+
+    /* two modules mapping the oscilloscope: one mapping */
+    CHECK(regmap_get(OSC_ADDR, OSC_SIZE, &osc) == 0, "osc get");
+    CHECK(regmap_get(OSC_ADDR + 0x8, 0x8, &thr) == 0, "osc thresholds get");
+    regmap_get_stats(&st);
+    CHECK(st.maps == 1 && st.mappings == 1, "%u maps, %u mappings for one block",
+          st.maps, st.mappings);
+
+    /* same registers through both handles */
+    REGMAP_REGS(&osc, osc_regs_t)->cha_thr = 0x1234;
+    CHECK(regmap_read(&thr, 0, &val) == 0 && val == 0x1234, "shared write 0x%x", val);
+    CHECK(regmap_write(&thr, 4, 0x5678) == 0 &&
+          REGMAP_REGS(&osc, osc_regs_t)->chb_thr == 0x5678, "shared read");
+
+    /* bounds & alignment */
+    CHECK(regmap_read(&thr, 8, &val) < 0, "read past the region");
+    CHECK(regmap_write(&thr, 2, 0) < 0, "unaligned write");
+    CHECK(REGMAP_REGS(&thr, osc_regs_t) == NULL, "typed access larger than the region");
+    CHECK(regmap_get(OSC_ADDR, 0, &rebuilt) < 0, "empty region");
+
+    /* another block: a second mapping */
+    CHECK(regmap_get(AWG_ADDR, AWG_SIZE, &awg) == 0, "awg get");
+    regmap_get_stats(&st);
+    CHECK(st.maps == 2 && st.mappings == 2, "%u maps, %u mappings for two blocks",
+          st.maps, st.mappings);
+    CHECK(regmap_open(NULL) == 0 && regmap_open_fd(-1, 0) < 0,
+          "device switched with blocks mapped");
+
+    /* a handle rebuilt from the pointer, like cmn_Unmap() does */
+    rebuilt.regs = awg.regs;
+    rebuilt.addr = 0;
+    rebuilt.size = AWG_SIZE;
+    regmap_put(&rebuilt);
+    regmap_put(&rebuilt);   /* cleared, ignored */
+    regmap_get_stats(&st);
+    CHECK(st.mappings == 1, "%u mappings after awg put", st.mappings);
+
+    regmap_put(&thr);
+    regmap_get_stats(&st);
+    CHECK(st.mappings == 1 && thr.regs == NULL, "osc unmapped with a handle left");
+    regmap_put(&osc);
+    regmap_get_stats(&st);
+    CHECK(st.mappings == 0, "%u mappings after the last put", st.mappings);
+}
+
+static double bench_mmap(int fd, long n)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    off_t off = AMS_ADDR - REGMAP_FPGA_BASE;
+    volatile uint32_t sum = 0;
+    double t0 = timeNow();
+    long i;
+
+    for (i = 0; i < n; i++) {
+        void *map = mmap(NULL, page, PROT_READ | PROT_WRITE, MAP_SHARED, fd, off);
+        if (map == MAP_FAILED) {
+            perror("mmap");
+            exit(1);
+        }
+        sum += *(volatile uint32_t *)map;
+        munmap(map, page);
+    }
+    return (timeNow() - t0) / n;
+}
+
+static double bench_regmap(long n)
+{
+    regmap_block_t app, blk;
+    volatile uint32_t sum = 0;
+    double t0, t;
+    long i;
+
+    /* the application keeps its block for its whole life */
+    if (regmap_get(AMS_ADDR, 0x1000, &app) < 0)
+        exit(1);
+    t0 = timeNow();
+    for (i = 0; i < n; i++) {
+        if (regmap_get(AMS_ADDR, 0x30, &blk) < 0)
+            exit(1);
+        sum += blk.regs[0];
+        regmap_put(&blk);
+    }
+    t = (timeNow() - t0) / n;
+    regmap_put(&app);
+    return t;
+}
+
+int main(int argc, char **argv)
+{
+    long n = argc > 1 ? atol(argv[1]) : 100000;
+    regmap_stats_t st, st2;
+    double t_mmap, t_regmap;
+    int fd;
+
+    fd = memfd_create("regmap_bench", 0);
+    if (fd < 0) {
+        perror("memfd_create");
+        return 1;
+    }
+    /* the raw mmap() timing needs the AMS block in the file already */
+    if (ftruncate(fd, AMS_ADDR - REGMAP_FPGA_BASE + REGMAP_BLOCK_SIZE) < 0 ||
+        regmap_open_fd(fd, REGMAP_FPGA_BASE) < 0) {
+        perror("regmap_bench");
+        return 1;
+    }
+
+    check_cache();
+
+    t_mmap = bench_mmap(fd, n);
+    regmap_get_stats(&st);
+    t_regmap = bench_regmap(n);
+    regmap_get_stats(&st2);
+    CHECK(st2.maps - st.maps == 1, "%u mmap() calls for %ld accesses",
+          st2.maps - st.maps, n);
+    printf("register access, %ld iterations:\n", n);
+    printf("  mmap() & munmap() per access %8.0f ns\n", t_mmap * 1e9);
+    printf("  regmap_get() & regmap_put()  %8.0f ns (%.0fx)\n",
+           t_regmap * 1e9, t_mmap / t_regmap);
+
+    CHECK(regmap_close() == 0, "close");
+    close(fd);
+
+    printf("\n%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,288 @@
+/**
+ * $Id: $
+ *
+ * @brief Oscilloscope UI parameter update benchmark on a simulated FPGA.
+ *
+ * Runs the oscilloscope application (main, worker, generator, PID modules)
+ * on the host against a simulated FPGA: the register map is a memfd given
+ * to regmap_open_fd(), as in regmap_bench, and a thread emulates the
+ * acquisition state machine - reset and arm bits, trigger on a 1 kHz edge,
+ * the post-trigger delay of the decimated clock.
+ *
+ * A client is emulated posting the full parameter list, as the web UI does,
+ * at 20 Hz with one parameter changed. For each kind of change the frame
+ * rate, the number of state machine resets & arms and the UI->register
+ * latency are reported.
+ *
+ * Usage: scope_shadow_bench [seconds per scenario]
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/mman.h>
+
+#include "regmap.h"
+#include "main.h"
+#include "worker.h"
+#include "fpga.h"
+#include "bench.h"
+
+#define SIM_TRIG_US   1000    /* trigger edge period */
+#define POST_US       50000   /* client post period */
+
+static regmap_block_t sim_blk;
+static volatile osc_fpga_reg_mem_t *sim_osc;
+static volatile int sim_quit;
+static pthread_mutex_t sim_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Counters of the simulated FPGA, under sim_mutex */
+static uint32_t sim_resets, sim_arms, sim_triggers;
+static uint32_t sim_thr, sim_dec;
+static double   sim_thr_t, sim_dec_t;
+
+static volatile uint32_t frames;
+
+/* Acquisition state machine: after arm and trigger source set, triggers on
+ * the next edge and is done trigger_delay decimated samples later */
+static void *fpgaSim(void *arg) {
+    volatile osc_fpga_reg_mem_t *r = sim_osc;
+    int armed = 0;
+    double t_trig = 0;
+
+    for (int n = 0; n < OSC_FPGA_SIG_LEN; n++) {
+        uint32_t v = (uint32_t) (4000 * sin(2 * M_PI * n / 1024)) & 0x3fff;
+        ((uint32_t *) r)[OSC_FPGA_CHA_OFFSET / 4 + n] = v;
+        ((uint32_t *) r)[OSC_FPGA_CHB_OFFSET / 4 + n] = v;
+    }
+
+    while (!sim_quit) {
+        double now = timeNow();
+        uint32_t conf = r->conf;
+
+        pthread_mutex_lock(&sim_mutex);
+        if (conf & OSC_FPGA_CONF_RST_BIT) {
+            sim_resets++;
+            armed = 0;
+            t_trig = 0;
+        }
+        if (conf & OSC_FPGA_CONF_ARM_BIT) {
+            sim_arms++;
+            armed = 1;
+            t_trig = 0;
+        }
+        if (conf & (OSC_FPGA_CONF_RST_BIT | OSC_FPGA_CONF_ARM_BIT))
+            r->conf = conf & ~(OSC_FPGA_CONF_RST_BIT | OSC_FPGA_CONF_ARM_BIT);
+        if (armed && (r->trig_source & OSC_FPGA_TRIG_SRC_MASK)) {
+            double dec = r->data_dec ? r->data_dec : 1;
+            if (t_trig == 0) {
+                /* immediate or next edge */
+                t_trig = (r->trig_source == 1) ? now :
+                    ceil(now * 1e6 / SIM_TRIG_US) * SIM_TRIG_US * 1e-6;
+            }
+            if (now >= t_trig + r->trigger_delay * dec * c_osc_fpga_smpl_period) {
+                r->wr_ptr_trigger = (uint32_t) (t_trig * 1e6) % OSC_FPGA_SIG_LEN;
+                r->trig_source = 0;
+                sim_triggers++;
+                armed = 0;
+            }
+        }
+        r->wr_ptr_cur = (uint32_t) (now * 1e6) % OSC_FPGA_SIG_LEN;
+        if (r->cha_thr != sim_thr) {
+            sim_thr = r->cha_thr;
+            sim_thr_t = now;
+        }
+        if (r->data_dec != sim_dec) {
+            sim_dec = r->data_dec;
+            sim_dec_t = now;
+        }
+        pthread_mutex_unlock(&sim_mutex);
+        usleep(20);
+    }
+    return NULL;
+}
+
+/* Web client reading the signals when the worker's eventfd says so, as
+ * the web server does */
+static void *client(void *arg) {
+    struct pollfd pfd = { .fd = rp_osc_get_signals_fd(), .events = POLLIN };
+    float **s = NULL;
+    uint64_t n;
+    int idx;
+
+    rp_create_signals(&s);
+    while (!sim_quit) {
+        if (poll(&pfd, 1, 100) <= 0 || read(pfd.fd, &n, sizeof(n)) < 0)
+            continue;
+        if (!rp_osc_get_signals(&s, &idx))
+            frames++;
+    }
+    rp_cleanup_signals(&s);
+    return NULL;
+}
+
+typedef struct {
+    const char *name;
+    int   param;
+    float val[2];
+    /* latency of register: 0 none, 1 cha_thr, 2 data_dec */
+    int   reg;
+} scenario_t;
+
+static rp_app_params_t *ui;
+static float ui_xmin, ui_xmax;
+
+/* Posts the client's parameters, xmin/xmax are the client's own (not the
+ * rounded ones of the server) unless the server forces them */
+static void post(void) {
+    rp_app_params_t *p;
+
+    ui[MIN_GUI_PARAM].value = ui_xmin;
+    ui[MAX_GUI_PARAM].value = ui_xmax;
+    ui[SINGLE_BUT_PARAM].value = 0;
+    rp_set_params(ui, PARAMS_NUM);
+
+    if (rp_get_params(&p) < 0)
+        return;
+    if (p[FORCEX_FLAG_PARAM].value == 1) {
+        ui_xmin = p[MIN_GUI_PARAM].value;
+        ui_xmax = p[MAX_GUI_PARAM].value;
+    }
+    rp_clean_params(p);
+}
+
+static void run(const scenario_t *sc, double secs) {
+    uint32_t r0, a0, f0, posts = 0, lat_n = 0;
+    double lat_sum = 0, lat_max = 0, start;
+
+    pthread_mutex_lock(&sim_mutex);
+    r0 = sim_resets;
+    a0 = sim_arms;
+    pthread_mutex_unlock(&sim_mutex);
+    f0 = frames;
+
+    start = timeNow();
+    while (timeNow() - start < secs) {
+        double t0 = timeNow(), t_reg = 0;
+
+        if (sc->param >= 0) {
+            if (sc->param == MAX_GUI_PARAM)
+                ui_xmax = sc->val[posts & 1];
+            else
+                ui[sc->param].value = sc->val[posts & 1];
+            post();
+            posts++;
+            /* wait for the register to change */
+            while (sc->reg && timeNow() - t0 < POST_US * 1e-6) {
+                pthread_mutex_lock(&sim_mutex);
+                t_reg = (sc->reg == 1) ? sim_thr_t : sim_dec_t;
+                pthread_mutex_unlock(&sim_mutex);
+                if (t_reg >= t0)
+                    break;
+                usleep(50);
+            }
+            if (sc->reg && t_reg >= t0) {
+                lat_sum += t_reg - t0;
+                lat_max = fmax(lat_max, t_reg - t0);
+                lat_n++;
+            }
+        }
+        while (timeNow() - t0 < POST_US * 1e-6)
+            usleep(1000);
+    }
+
+    pthread_mutex_lock(&sim_mutex);
+    printf("%-18s %6u %9.1f %8u %8u", sc->name, posts,
+           (frames - f0) / secs, sim_resets - r0, sim_arms - a0);
+    pthread_mutex_unlock(&sim_mutex);
+    if (lat_n)
+        printf(" %8.2f %8.2f\n", lat_sum / lat_n * 1e3, lat_max * 1e3);
+    else
+        printf(" %8s %8s\n", "-", "-");
+}
+
+int main(int argc, char **argv) {
+    const scenario_t sc[] = {
+        { "no changes",        -1,                { 0, 0 },          0 },
+        { "resend unchanged",  MIN_Y_PARAM,       { 0, 0 },          0 },
+        { "y range",           MIN_Y_PARAM,       { -0.5, -1 },      0 },
+        { "trigger level",     TRIG_LEVEL_PARAM,  { 0.1, 0.2 },      1 },
+        { "generator ampl.",   GEN_SIG_AMP_CH1,   { 0.5, 1 },        0 },
+        { "trigger source",    TRIG_SRC_PARAM,    { 1, 0 },          0 },
+        { "time base",         MAX_GUI_PARAM,     { 0, 0 },          2 },
+    };
+    double secs = argc > 1 ? atof(argv[1]) : 2;
+    pthread_t sim_thread, client_thread;
+    int fd;
+
+    /* the application maps the same osc block from the simulator */
+    fd = memfd_create("scope_shadow_bench", 0);
+    if (fd < 0 || regmap_open_fd(fd, REGMAP_FPGA_BASE) < 0 ||
+        regmap_get(OSC_FPGA_BASE_ADDR, OSC_FPGA_BASE_SIZE, &sim_blk) < 0) {
+        perror("scope_shadow_bench");
+        return EXIT_FAILURE;
+    }
+    sim_osc = REGMAP_REGS(&sim_blk, osc_fpga_reg_mem_t);
+    pthread_create(&sim_thread, NULL, fpgaSim, NULL);
+
+    if (rp_app_init() < 0) {
+        fprintf(stderr, "rp_app_init() failed\n");
+        return EXIT_FAILURE;
+    }
+    pthread_create(&client_thread, NULL, client, NULL);
+
+    /* Client state: normal trigger, 10 ms time base (the server forces the
+     * time units on the first post) */
+    if (rp_get_params(&ui) < 0)
+        return EXIT_FAILURE;
+    ui[TRIG_MODE_PARAM].value = 1;
+    ui[GEN_ENABLE_CH1].value = 1;
+    ui_xmin = 0;
+    ui_xmax = 10000;
+    for (int i = 0; i < 3; i++)
+        post();
+    usleep(500000);
+
+    printf("Client posts at %d Hz, time base %.0f..%.0f ms, %.0f s per scenario\n",
+           1000000 / POST_US, ui_xmin, ui_xmax, secs);
+    printf("%-18s %6s %9s %8s %8s %8s %8s\n", "change", "posts", "frames/s",
+           "resets", "arms", "lat [ms]", "max [ms]");
+    for (unsigned i = 0; i < sizeof(sc) / sizeof(sc[0]); i++) {
+        scenario_t s = sc[i];
+        float xmax = ui_xmax;
+
+        if (s.param == MAX_GUI_PARAM) {
+            /* zoom in & out by 2, changes decimation */
+            s.val[0] = xmax / 2;
+            s.val[1] = xmax;
+        }
+        run(&s, secs);
+
+        /* back to the initial state */
+        if (s.param == MAX_GUI_PARAM)
+            ui_xmax = xmax;
+        else if (s.param >= 0)
+            ui[s.param].value = s.val[1];
+        post();
+        usleep(300000);
+    }
+
+    sim_quit = 1;
+    pthread_join(client_thread, NULL);
+    rp_app_exit();
+    pthread_join(sim_thread, NULL);
+    rp_clean_params(ui);
+    regmap_put(&sim_blk);
+    regmap_close();
+    close(fd);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,246 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya SCPI acquisition streaming benchmark.
+ *
+ * Runs the ACQ:DATA:STREAM machinery of the SCPI server (acq_stream.c) with
+ * librp against a register simulator file (RP_REGMAP_DEV), so no Red
+ * Pitaya is needed; the calibration EEPROM is read from /dev/zero. A thread
+ * plays the FPGA: each time the acquisition is armed it sets new write
+ * pointers, marks the oldest sample of channel 1 with the trigger number and
+ * triggers. The client end of a socket pair parses the stream while the
+ * main thread plays the parser, replying to a command now and then under
+ * the output lock. Checks that:
+ *
+ *  - every frame is a well formed block with a valid header,
+ *  - a frame carries the window of its sequence number,
+ *  - the sequence gaps add up to the dropped counters of the frames,
+ *  - no reply splits a frame and every reply arrives,
+ *  - a slow client drops windows instead of queueing them.
+ *
+ * Sustained triggers per second are reported for a fast and a slow client.
+ *
+ * Usage: scpi_stream_bench [seconds]  (default 2 per client)
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "redpitaya/rp.h"
+#include "acq_stream.h"
+#include "bench.h"
+
+#define OSC_CHA      0x00010000   // channel A buffer from the block
+#define TRIG_STATUS  (1 << 2)     // configuration register, trigger status
+#define TRIG_IDX     8192         // trigger position in the simulated window
+#define REPLY        "ON\r\n"
+
+/* Oscilloscope registers */
+static volatile uint32_t *osc_conf;
+static volatile uint32_t *osc_trig_src;
+static volatile uint32_t *osc_wp;
+static volatile uint32_t *osc_tp;
+static volatile uint32_t *osc_cha;
+
+/* Arming resets the trigger status in the FPGA, registers of the simulator
+ * have no side effects */
+int rp_AcqStart() {
+    static int (*librp_AcqStart)();
+
+    if (librp_AcqStart == NULL) {
+        librp_AcqStart = dlsym(RTLD_NEXT, "rp_AcqStart");
+    }
+    *osc_conf &= ~TRIG_STATUS;
+    return librp_AcqStart();
+}
+
+static volatile int fpga_run;
+static volatile uint32_t triggers;
+
+/* Triggers once armed, a window takes 131 us to fill at decimation 1 */
+static void *fpga_thread(void *arg) {
+    while (fpga_run) {
+        if (*osc_trig_src == 0) {
+            usleep(20);
+            continue;
+        }
+        usleep(131);
+        uint32_t n = triggers++;
+        uint32_t wp = (n * 37) % ADC_BUFFER_SIZE;
+        *osc_wp = wp;
+        *osc_tp = (wp + 1 + TRIG_IDX) % ADC_BUFFER_SIZE;
+        osc_cha[(wp + 1) % ADC_BUFFER_SIZE] = n % TRIG_IDX;
+        *osc_trig_src = 0;
+        *osc_conf |= TRIG_STATUS;
+    }
+    return NULL;
+}
+
+typedef struct {
+    int      fd;
+    int      delay_us;    /* per frame, a slow client */
+    uint32_t frames;
+    uint32_t replies;
+    uint32_t gaps;        /* windows missing in the sequence */
+    uint32_t dropped;     /* dropped counter of the last frame */
+    uint32_t bad;
+} client_t;
+
+static int readAll(int fd, void *buf, size_t len) {
+    size_t total = 0;
+
+    while (total < len) {
+        ssize_t n = read(fd, (char *)buf + total, len - total);
+        if (n <= 0) {
+            return -1;
+        }
+        total += n;
+    }
+    return 0;
+}
+
+static void *client_thread(void *arg) {
+    client_t *c = arg;
+    static uint8_t payload[sizeof(acq_stream_hdr_t) + 2 * ADC_BUFFER_SIZE * sizeof(float)];
+    acq_stream_hdr_t *hdr = (acq_stream_hdr_t *)payload;
+    int64_t seq = -1;
+    char ch, len[16];
+
+    while (readAll(c->fd, &ch, 1) == 0) {
+        if (ch != '#') {
+            /* a reply, up to its delimiter */
+            char line[sizeof(REPLY)] = { ch };
+            if (readAll(c->fd, line + 1, sizeof(REPLY) - 2) < 0) {
+                break;
+            }
+            c->bad += strcmp(line, REPLY) != 0;
+            c->replies++;
+            continue;
+        }
+        if (readAll(c->fd, &ch, 1) < 0 || ch < '1' || ch > '9' ||
+            readAll(c->fd, len, ch - '0') < 0) {
+            c->bad++;
+            break;
+        }
+        len[ch - '0'] = 0;
+        size_t size = atoi(len);
+        if (size > sizeof(payload) || readAll(c->fd, payload, size) < 0) {
+            c->bad++;
+            break;
+        }
+        int16_t *cha = (int16_t *)(payload + hdr->header_len);
+        if (hdr->magic != ACQ_STREAM_MAGIC || hdr->version != ACQ_STREAM_VERSION ||
+            hdr->format != ACQ_STREAM_I16 || hdr->channels != 2 ||
+            size != hdr->header_len + 2 * hdr->samples * sizeof(int16_t) ||
+            hdr->trig_idx != TRIG_IDX || cha[0] != hdr->seq % TRIG_IDX) {
+            c->bad++;
+        }
+        if (hdr->seq - seq - 1 != hdr->dropped - c->dropped) {
+            c->bad++;
+        }
+        c->gaps += hdr->seq - seq - 1;
+        c->dropped = hdr->dropped;
+        seq = hdr->seq;
+        c->frames++;
+        if (c->delay_us) {
+            usleep(c->delay_us);
+        }
+    }
+    return NULL;
+}
+
+/* Streams for the given time, returns triggers per second */
+static double run(const char *name, int delay_us, double seconds) {
+    int sv[2];
+    client_t c = { 0 };
+    pthread_t client;
+    uint32_t frames, dropped, replies = 0;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        perror("socketpair");
+        exit(EXIT_FAILURE);
+    }
+    c.fd = sv[1];
+    c.delay_us = delay_us;
+    pthread_create(&client, NULL, client_thread, &c);
+
+    /* a window armed as the last run stopped is done by now, the trigger
+     * numbers restart with the sequence */
+    rp_AcqReset();
+    usleep(1000);
+    triggers = 0;
+    double start = timeNow();
+    CHECK(acq_stream_Start(sv[0], true, RP_TRIG_SRC_CHA_PE) == 0, "%s: start failed", name);
+    while (timeNow() - start < seconds) {
+        usleep(5000);
+        acq_stream_Lock();
+        CHECK(write(sv[0], REPLY, sizeof(REPLY) - 1) == sizeof(REPLY) - 1, "%s: reply", name);
+        acq_stream_Unlock();
+        replies++;
+    }
+    acq_stream_Stop();
+    double tps = triggers / (timeNow() - start);
+    acq_stream_GetStat(&frames, &dropped);
+    shutdown(sv[0], SHUT_WR);
+    pthread_join(client, NULL);
+    close(sv[0]);
+    close(sv[1]);
+
+    printf("%-6s %8.0f triggers/s, %6u frames (%6.0f/s), %6u dropped, %6u gaps, %5.1f MB/s\n",
+           name, tps, c.frames, c.frames / seconds, dropped, c.gaps,
+           c.frames * (sizeof(acq_stream_hdr_t) + 4 * ADC_BUFFER_SIZE) / seconds / 1e6);
+
+    CHECK(c.bad == 0, "%s: %u bad frames or replies", name, c.bad);
+    CHECK(c.frames == frames, "%s: %u frames received of %u sent", name, c.frames, frames);
+    CHECK(c.replies == replies, "%s: %u replies received of %u", name, c.replies, replies);
+    CHECK(c.gaps == c.dropped && c.dropped <= dropped,
+          "%s: %u gaps, %u dropped by the last frame, %u in total", name, c.gaps, c.dropped, dropped);
+    CHECK(delay_us == 0 || dropped > 0, "%s: nothing dropped", name);
+    CHECK(!acq_stream_IsRunning(), "%s: still running", name);
+    return tps;
+}
+
+int main(int argc, char **argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 2;
+    pthread_t fpga;
+
+    uint8_t *base = benchSimOpen();
+    osc_conf     = (volatile uint32_t *)(base + BENCH_OSC_OFFSET);
+    osc_trig_src = (volatile uint32_t *)(base + BENCH_OSC_OFFSET + 0x04);
+    osc_wp       = (volatile uint32_t *)(base + BENCH_OSC_OFFSET + 0x18);
+    osc_tp       = (volatile uint32_t *)(base + BENCH_OSC_OFFSET + 0x1C);
+    osc_cha      = (volatile uint32_t *)(base + BENCH_OSC_OFFSET + OSC_CHA);
+
+    int r = rp_Init();
+    if (r != RP_OK) {
+        printf("rp_Init() failed: %s\n", rp_GetError(r));
+        return EXIT_FAILURE;
+    }
+    fpga_run = 1;
+    pthread_create(&fpga, NULL, fpga_thread, NULL);
+
+    /* a fast client keeps up, a slow one reads a frame every 20 ms */
+    double fast = run("fast", 0, seconds);
+    run("slow", 20000, seconds);
+    CHECK(fast > 100, "%.0f triggers/s", fast);
+
+    fpga_run = 0;
+    pthread_join(fpga, NULL);
+    rp_Release();
+    benchSimClose();
+
+    return benchResult();
+}
@@ -0,0 +1,209 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya GPIanalyser sine fit benchmark.
+ *
+ * Fits synthetic two channel acquisitions (16384 samples of quantized
+ * sines with offset and noise, like the GPIanalyser inputs) with:
+ *
+ *  - legacy: the fit analyseSignal() used to do, cos() & sin() of every
+ *    sample and the 3x3 normal equations built and solved with rsolv() for
+ *    each channel,
+ *  - sineFit3(): the cached basis, both channels batched,
+ *  - sineFit4(): the 4-parameter (IEEE 1057) fit, on signals slightly off
+ *    the plan frequency.
+ *
+ * The cached fits must agree with the legacy one and with the synthetic
+ * signal; the time per fit and for building a plan are reported.
+ *
+ * Usage: sine_fit_bench [repetitions]  (default 200)
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "linAlg.h"
+#include "sineFit.h"
+#include "bench.h"
+
+#define SIZE    16384
+#define NOISE   2.0      // rms noise [ADC counts]
+
+static unsigned int seed = 1;
+
+static double noise(void)
+{
+    double s = 0;
+    int i;
+
+    /* sum of uniforms, near gaussian, unit rms */
+    for (i = 0; i < 12; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        s += seed / 4294967296.0;
+    }
+    return s - 6.0;
+}
+
+/* Quantized a*cos(w*i) + b*sin(w*i) + c + noise in ADC counts */
+static void synth(float *x, double w, double a, double b, double c)
+{
+    int i;
+
+    for (i = 0; i < SIZE; i++) {
+        x[i] = rint(a * cos(w * i) + b * sin(w * i) + c + NOISE * noise());
+    }
+}
+
+/* The fit as analyseSignal() did it, one channel */
+static void legacy_fit(const float *x, double w, double *a, double *b, double *c)
+{
+    rmatrix mat;
+    rvector rhs, f;
+    int i, j, k;
+
+    clearRmat(mat, 3);
+    clearRvec(rhs, 3);
+    for (i = 0; i < SIZE; i++) {
+        double t = i * w;
+        f[0] = cos(t);
+        f[1] = sin(t);
+        f[2] = 1;
+        for (j = 0; j < 3; j++) {
+            for (k = 0; k < 3; k++)
+                mat[j][k] += f[j] * f[k];
+            rhs[j] += f[j] * x[i];
+        }
+    }
+    rsolv(mat, rhs, 3);
+    *a = rhs[0];
+    *b = rhs[1];
+    *c = rhs[2];
+}
+
+static double phase_diff(double p1, double p2)
+{
+    double d = p1 - p2;
+
+    while (d > M_PI)
+        d -= 2 * M_PI;
+    while (d < -M_PI)
+        d += 2 * M_PI;
+    return fabs(d);
+}
+
+typedef struct {
+    const char *name;
+    double fs;           // sampling frequency [Hz]
+    double f;            // signal frequency [Hz]
+} point_t;
+
+static const point_t points[] = {
+    { "1 kHz, decimation 64",   125e6 / 64,  1e3   },
+    { "25 kHz, decimation 64",  125e6 / 64,  25e3  },
+    { "1 MHz",                  125e6,       1e6   },
+    { "10.7 MHz",               125e6,       10.7e6 },
+    { "49 MHz",                 125e6,       49e6  },
+};
+
+#define NPOINTS (sizeof(points) / sizeof(points[0]))
+
+int main(int argc, char **argv)
+{
+    int reps = argc > 1 ? atoi(argv[1]) : 200;
+    static float xs[2][SIZE];
+    const float *ch[2] = { xs[0], xs[1] };
+    double t_legacy = 0, t_fit3 = 0, t_fit4 = 0, t_plan = 0;
+    int iters = 0;
+    unsigned int p;
+    int r, k;
+
+    printf("%-24s %12s %12s %12s %12s %6s\n", "point", "legacy amp", "fit3 amp",
+           "fit3 dphi", "fit4 df/f", "iter");
+
+    for (p = 0; p < NPOINTS; p++) {
+        const point_t *pt = &points[p];
+        double w = 2 * M_PI * pt->f / pt->fs;
+        /* channel 0 the generator, channel 1 through the DUT */
+        const double a[2] = { 3000, -410 }, b[2] = { 1200, 975 }, c[2] = { 12.5, -7.25 };
+        sineFitResult_t fit3[2], fit4[2];
+        sineFitPlan_t plan;
+        double la[2], lb[2], lc[2], t0;
+
+        synth(xs[0], w, a[0], b[0], c[0]);
+        synth(xs[1], w, a[1], b[1], c[1]);
+
+        t0 = timeNow();
+        for (r = 0; r < reps; r++) {
+            for (k = 0; k < 2; k++)
+                legacy_fit(xs[k], w, &la[k], &lb[k], &lc[k]);
+        }
+        t_legacy += (timeNow() - t0) / reps;
+
+        t0 = timeNow();
+        for (r = 0; r < reps; r++) {
+            if (sineFitPlanInit(&plan, SIZE, w) < 0)
+                return 1;
+            if (r < reps - 1)
+                sineFitPlanFree(&plan);
+        }
+        t_plan += (timeNow() - t0) / reps;
+
+        t0 = timeNow();
+        for (r = 0; r < reps; r++)
+            sineFit3(&plan, ch, 2, fit3);
+        t_fit3 += (timeNow() - t0) / reps;
+
+        for (k = 0; k < 2; k++) {
+            double lamp = hypot(la[k], lb[k]);
+            double amp = hypot(a[k], b[k]);
+            CHECK(fabs(fit3[k].amp - lamp) < 1e-5 * lamp, "%s ch%d: amplitude %f, legacy %f",
+                  pt->name, k, fit3[k].amp, lamp);
+            CHECK(phase_diff(fit3[k].phi, atan2(la[k], lb[k])) < 1e-5,
+                  "%s ch%d: phase differs from legacy", pt->name, k);
+            CHECK(fabs(fit3[k].c - lc[k]) < 1e-3, "%s ch%d: offset %f, legacy %f",
+                  pt->name, k, fit3[k].c, lc[k]);
+            CHECK(fabs(fit3[k].amp - amp) < 0.1, "%s ch%d: amplitude %f, expected %f",
+                  pt->name, k, fit3[k].amp, amp);
+        }
+
+        /* 4-parameter: the signal 20 ppm off the plan frequency */
+        synth(xs[0], w * (1 + 20e-6), a[0], b[0], c[0]);
+        synth(xs[1], w * (1 + 20e-6), a[1], b[1], c[1]);
+        t0 = timeNow();
+        for (r = 0; r < reps; r++)
+            sineFit4(&plan, ch, 2, 10, 1e-12, fit4);
+        t_fit4 += (timeNow() - t0) / reps;
+        for (k = 0; k < 2; k++) {
+            double amp = hypot(a[k], b[k]);
+            /* within 5 sigma of the Cramer-Rao bound of the frequency */
+            double crlb = sqrt(12.0) * NOISE / (amp * pow(SIZE, 1.5));
+            double dw = fit4[k].w - w * (1 + 20e-6);
+            CHECK(fabs(dw) < 5 * crlb, "%s ch%d: 4-parameter frequency off by %g rad/sample",
+                  pt->name, k, dw);
+            CHECK(fabs(fit4[k].amp - amp) < 0.1, "%s ch%d: 4-parameter amplitude %f, expected %f",
+                  pt->name, k, fit4[k].amp, amp);
+            iters += fit4[k].iterations;
+        }
+
+        printf("%-24s %12.4f %12.4f %12.2e %12.2e %6d\n", pt->name, hypot(la[1], lb[1]),
+               fit3[1].amp, phase_diff(fit3[1].phi, atan2(la[1], lb[1])),
+               fit4[1].w / (w * (1 + 20e-6)) - 1, fit4[1].iterations);
+        sineFitPlanFree(&plan);
+    }
+
+    printf("\ntwo channel fit, %d samples, mean of %u points:\n", SIZE, (unsigned)NPOINTS);
+    printf("  legacy (cos/sin & rsolv)   %9.1f us\n", t_legacy / NPOINTS * 1e6);
+    printf("  sineFit3, cached plan      %9.1f us (%.0fx)\n", t_fit3 / NPOINTS * 1e6,
+           t_legacy / t_fit3);
+    printf("  plan for a new frequency   %9.1f us\n", t_plan / NPOINTS * 1e6);
+    printf("  sineFit4, 20 ppm off       %9.1f us (%.1f passes per channel)\n",
+           t_fit4 / NPOINTS * 1e6, iters / (2.0 * NPOINTS));
+
+    printf("\n%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
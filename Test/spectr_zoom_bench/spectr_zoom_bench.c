@@ -0,0 +1,255 @@
+/**
+ * $Id: $
+ *
+ * @brief Spectrum analyzer zoom FFT benchmark and test.
+ *
+ * Feeds synthetic tones sampled at 125 MS/s to the digital down-conversion
+ * of librp and checks the zoomed spectrum: level and frequency of a strong
+ * and a -60 dBc tone in the span, rejection of tones outside of it, the
+ * same result for any split of the input into blocks, after a reset and
+ * through the rp_Zoom* API of rp.h, and parameter checks, also of
+ * rp_ZoomFeedAcq() on a register simulator (RP_REGMAP_DEV). Then measures
+ * the throughput of the down-conversion for spans of 5 MHz down to 1 kHz
+ * around 10 MHz.
+ *
+ * Usage: spectr_zoom_bench
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "redpitaya/rp.h"
+#include "spec_zoom.h"
+#include "bench.h"
+
+#define FS      125e6
+#define FFT_LEN 1024
+#define T_MEAS  0.5
+
+typedef struct {
+    double f;
+    double amp;
+} tone_t;
+
+static int16_t *sig;
+static double dB(double a, double ref) {
+    return 20 * log10(a / ref);
+}
+
+/* Sum of the tones, rounded to ADC counts */
+static void synth(const tone_t *tones, int count, long len) {
+    for (long n = 0; n < len; n++) {
+        double x = 0;
+        for (int t = 0; t < count; t++) {
+            double cycles = tones[t].f / FS * n;
+            x += tones[t].amp * cos(2 * M_PI * (cycles - floor(cycles)));
+        }
+        sig[n] = lrint(x);
+    }
+}
+
+/* Samples giving count spectra */
+static long spectraLen(const rp_spectr_zoom_t *z, int count) {
+    return (long) ((count * z->fft_len + SPECTR_ZOOM_HB_TAPS + 2) * (FS / z->fs_out));
+}
+
+static void testTones(void) {
+    static float freq[FFT_LEN / 2], amp[FFT_LEN / 2];
+    static float freq2[FFT_LEN / 2], amp2[FFT_LEN / 2];
+    rp_spectr_zoom_t z, z2;
+    double fc = 10.0003e6, bin, spur = 0;
+    int i1 = FFT_LEN / 4 + 37, i2 = FFT_LEN / 4 - 100, peak = 0;
+
+    CHECK(rp_spectr_zoom_init(&z, FS, fc, 10e3, FFT_LEN) == 0, "init");
+    bin = z.fs_out / FFT_LEN;
+    printf("span %.1f Hz around %.1f Hz: CIC / %d, %d halfbands, %.3f Hz bins\n",
+           z.span, z.f_center, z.cic_dec, z.hb_stages, bin);
+
+    tone_t tones[] = {
+        { fc + 37 * bin,       4000 },   /* in span */
+        { fc - 100 * bin,      4 },      /* in span, -60 dBc */
+        { fc + 0.8 * z.fs_out, 4000 },   /* halfband stop band, would alias into the span */
+        { 12e6,                2000 },   /* CIC stop band */
+    };
+    long len = spectraLen(&z, 2);
+    synth(tones, 4, len);
+
+    CHECK(rp_spectr_zoom_process(&z, sig, len) == 2, "2 spectra averaged");
+    CHECK(rp_spectr_zoom_spectrum(&z, freq, amp) == 2, "spectrum");
+    CHECK(rp_spectr_zoom_spectrum(&z, freq, amp) == 0, "average restarted");
+
+    for (int i = 0; i < FFT_LEN / 2; i++) {
+        if (amp[i] > amp[peak])
+            peak = i;
+        if (abs(i - i1) > 5 && abs(i - i2) > 5 && amp[i] > spur)
+            spur = amp[i];
+    }
+    CHECK(peak == i1, "peak in bin %d, expected %d", peak, i1);
+    CHECK(fabs(freq[i1] - tones[0].f) < 1, "peak at %.1f Hz, expected %.1f Hz", freq[i1], tones[0].f);
+    CHECK(fabs(dB(amp[i1], 4000)) < 0.1, "tone %.3f dB off", dB(amp[i1], 4000));
+    CHECK(fabs(dB(amp[i2], 4)) < 0.5, "-60 dBc tone %.3f dB off", dB(amp[i2], 4));
+    CHECK(dB(spur, 4000) < -85, "largest other bin %.1f dBc", dB(spur, 4000));
+    printf("tone %.3f dB, -60 dBc tone %.3f dB off, largest other bin %.1f dBc\n",
+           dB(amp[i1], 4000), dB(amp[i2], 4), dB(spur, 4000));
+
+    /* the same for any block sizes, and again after a reset */
+    CHECK(rp_spectr_zoom_init(&z2, FS, fc, 10e3, FFT_LEN) == 0, "init");
+    for (long n = 0; n < len; n += 1001)
+        rp_spectr_zoom_process(&z2, sig + n, len - n < 1001 ? len - n : 1001);
+    CHECK(rp_spectr_zoom_spectrum(&z2, freq2, amp2) == 2, "spectrum in blocks");
+    CHECK(!memcmp(amp, amp2, sizeof(amp)), "spectrum in blocks differs");
+
+    rp_spectr_zoom_reset(&z2);
+    rp_spectr_zoom_process(&z2, sig, len);
+    CHECK(rp_spectr_zoom_spectrum(&z2, freq2, amp2) == 2, "spectrum after reset");
+    CHECK(!memcmp(amp, amp2, sizeof(amp)), "spectrum after reset differs");
+
+    rp_spectr_zoom_clean(&z);
+    rp_spectr_zoom_clean(&z2);
+}
+
+/* Wide span, the least decimation */
+static void testWide(void) {
+    static float freq[256 / 2], amp[256 / 2];
+    rp_spectr_zoom_t z;
+    double fc = 20e6;
+
+    CHECK(rp_spectr_zoom_init(&z, FS, fc, 2e6, 256) == 0, "init wide");
+    tone_t tone = { fc - 50 * z.fs_out / 256, 1000 };
+    long len = spectraLen(&z, 1);
+    synth(&tone, 1, len);
+    rp_spectr_zoom_process(&z, sig, len);
+    CHECK(rp_spectr_zoom_spectrum(&z, freq, amp) == 1, "spectrum wide");
+    CHECK(fabs(dB(amp[256 / 4 - 50], 1000)) < 0.1, "wide tone %.3f dB off", dB(amp[256 / 4 - 50], 1000));
+    printf("span %.1f Hz: CIC / %d, %d halfbands, tone %.3f dB off\n",
+           z.span, z.cic_dec, z.hb_stages, dB(amp[256 / 4 - 50], 1000));
+    rp_spectr_zoom_clean(&z);
+}
+
+/* The public API gives the same spectrum */
+static void testApi(void) {
+    static float freq[FFT_LEN / 2], amp[FFT_LEN / 2];
+    static float freq2[FFT_LEN / 2], amp2[FFT_LEN / 2];
+    rp_spectr_zoom_t z;
+    rp_zoom_t *zoom;
+    double fc = 7.5e6, span, bin;
+    uint32_t size = FFT_LEN / 2 - 1, averages;
+
+    CHECK(rp_spectr_zoom_init(&z, FS, fc, 50e3, FFT_LEN) == 0, "init");
+    CHECK(rp_ZoomCreate(FS, fc, 50e3, FFT_LEN, &zoom) == RP_OK, "rp_ZoomCreate");
+    CHECK(rp_ZoomGetSpan(zoom, &span, &bin) == RP_OK && span == z.span &&
+          bin == z.fs_out / FFT_LEN, "rp_ZoomGetSpan");
+
+    tone_t tone = { fc + 3 * z.fs_out / FFT_LEN, 3000 };
+    long len = spectraLen(&z, 1);
+    synth(&tone, 1, len);
+    rp_spectr_zoom_process(&z, sig, len);
+    rp_spectr_zoom_spectrum(&z, freq, amp);
+
+    CHECK(rp_ZoomGetSpectrum(zoom, freq2, amp2, &size, &averages) == RP_BTS &&
+          size == FFT_LEN / 2, "rp_ZoomGetSpectrum() buffer too small");
+    CHECK(rp_ZoomGetSpectrum(zoom, freq2, amp2, &size, &averages) == RP_OK &&
+          size == 0 && averages == 0, "rp_ZoomGetSpectrum() before a spectrum");
+    CHECK(rp_ZoomProcess(zoom, sig, len) == RP_OK, "rp_ZoomProcess");
+    size = FFT_LEN / 2;
+    CHECK(rp_ZoomGetSpectrum(zoom, freq2, amp2, &size, &averages) == RP_OK &&
+          size == FFT_LEN / 2 && averages == 1, "rp_ZoomGetSpectrum");
+    CHECK(!memcmp(freq, freq2, sizeof(freq)) && !memcmp(amp, amp2, sizeof(amp)),
+          "rp_ZoomGetSpectrum() differs");
+
+    CHECK(rp_ZoomReset(zoom) == RP_OK, "rp_ZoomReset");
+    CHECK(rp_ZoomDestroy(zoom) == RP_OK, "rp_ZoomDestroy");
+    rp_spectr_zoom_clean(&z);
+}
+
+static void testParams(void) {
+    rp_spectr_zoom_t z;
+    rp_zoom_t *zoom;
+
+    fprintf(stderr, "expected errors:\n");
+    CHECK(rp_spectr_zoom_init(&z, FS, 30e6, 20e6, FFT_LEN) < 0, "span too wide");
+    CHECK(rp_spectr_zoom_init(&z, FS, 62e6, 10e6, FFT_LEN) < 0, "span beyond nyquist");
+    CHECK(rp_spectr_zoom_init(&z, FS, 10e6, 1e3, 1000) < 0, "FFT length not a power of 2");
+    CHECK(rp_spectr_zoom_init(&z, FS, 10e6, 1e-3, FFT_LEN) < 0, "span too narrow");
+    CHECK(rp_spectr_zoom_process(&z, sig, 100) < 0, "process without init");
+    CHECK(rp_ZoomCreate(FS, 62e6, 10e6, FFT_LEN, &zoom) == RP_EOOR, "rp_ZoomCreate() beyond nyquist");
+}
+
+/* rp_ZoomFeedAcq() on the register simulator */
+static void testFeed(void) {
+    rp_zoom_t *zoom, *zoom8;
+
+    benchSimOpen();
+    int r = rp_Init();
+    if (r != RP_OK) {
+        printf("rp_Init() failed: %s\n", rp_GetError(r));
+        exit(EXIT_FAILURE);
+    }
+    rp_ZoomCreate(FS, 10e6, 50e3, FFT_LEN, &zoom);
+    rp_ZoomCreate(FS / 8, 1e6, 5e3, FFT_LEN, &zoom8);
+
+    rp_AcqSetDecimation(RP_DEC_1);
+    CHECK(rp_ZoomFeedAcq(zoom, RP_CH_1) == RP_EOOR, "rp_ZoomFeedAcq() at decimation 1");
+    rp_AcqSetDecimation(RP_DEC_8);
+    CHECK(rp_ZoomFeedAcq(zoom, RP_CH_1) == RP_EIPV, "rp_ZoomFeedAcq() at another sample rate");
+    CHECK(rp_ZoomFeedAcq(zoom8, RP_CH_1) == RP_OK, "rp_ZoomFeedAcq() at decimation 8");
+
+    rp_ZoomDestroy(zoom);
+    rp_ZoomDestroy(zoom8);
+    rp_Release();
+    benchSimClose();
+}
+
+static void bench(void) {
+    const double spans[] = { 5e6, 1e6, 1e5, 1e4, 1e3 };
+    const long len = 4 * 1024 * 1024;
+    tone_t tones[] = { { 10.001e6, 4000 }, { 3e6, 2000 } };
+
+    synth(tones, 2, len);
+    printf("\n%10s %6s %6s %12s %12s\n", "span[Hz]", "CIC", "HB", "MS/s", "x realtime");
+    for (unsigned i = 0; i < sizeof(spans) / sizeof(spans[0]); i++) {
+        rp_spectr_zoom_t z;
+        double t;
+        long n = 0;
+
+        if (rp_spectr_zoom_init(&z, FS, 10e6, spans[i], FFT_LEN) < 0)
+            continue;
+        t = timeNow();
+        do {
+            rp_spectr_zoom_process(&z, sig, len);
+            n += len;
+        } while (timeNow() - t < T_MEAS);
+        t = timeNow() - t;
+        printf("%10.0f %6d %6d %12.2f %12.3f\n", z.span, z.cic_dec, z.hb_stages,
+               n / t * 1e-6, n / t / FS);
+        rp_spectr_zoom_clean(&z);
+    }
+}
+
+int main(int argc, char **argv) {
+    sig = malloc(16 * 1024 * 1024 * sizeof(int16_t));
+    if (sig == NULL) {
+        fprintf(stderr, "can not allocate signal\n");
+        return EXIT_FAILURE;
+    }
+
+    testTones();
+    testWide();
+    testApi();
+    testParams();
+    testFeed();
+    bench();
+    free(sig);
+
+    if (failures) {
+        printf("%d checks FAILED\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("All checks passed\n");
+    return EXIT_SUCCESS;
+}
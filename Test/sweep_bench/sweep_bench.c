@@ -0,0 +1,389 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya LCR & Bode sweep benchmark.
+ *
+ * Runs the lcr and bode sweep libraries against a simulated front end
+ * (a series RC for the LCR meter, an RC low pass for the Bode analyzer,
+ * the acquisition takes the real capture time) the two ways the web
+ * applications have used them:
+ *
+ *  - spawned: the worker starts the command line utility with system(), it
+ *    writes every quantity to a text file and the worker reads them back
+ *    with fscanf() once the utility exits,
+ *  - in-process: the worker runs the sweep itself and gets every point from
+ *    the point callback.
+ *
+ * Both use the same simulated backend, so the difference is the process
+ * and file round trip. Wall time of the sweep and the time until the first
+ * point can be plotted are reported, the points of both ways and the
+ * simulated circuit are compared.
+ *
+ * Usage: sweep_bench [DIR] (default /tmp)
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <complex.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lcr_sweep.h"
+#include "bode_sweep.h"
+#include "bench.h"
+
+#define POINTS    50
+#define START     1000.0
+#define END       100000.0
+
+#define DUT_R     100.0     // LCR DUT: series R [Ohm] ...
+#define DUT_C     100e-9    // ... and C [F]
+#define SHUNT     1000.0    // LCR shunt resistor [Ohm]
+#define LP_FC     10000.0   // Bode DUT: RC low pass corner [Hz]
+
+/*
+ * Simulated front end: the generator frequency follows the AWG step, the
+ * inputs see the generator through the circuit, in ADC counts with a
+ * little noise. An acquisition takes its capture time.
+ */
+typedef struct {
+    double   freq;
+    double   ampl;
+    int      lcr;        // 1 - series RC & shunt, 0 - RC low pass
+    uint32_t noise;
+    int      acquisitions;
+} sim_t;
+
+static double sim_noise(sim_t *sim)
+{
+    sim->noise = sim->noise * 1664525u + 1013904223u;
+    return ((sim->noise >> 8) & 0xffff) / 65536.0 - 0.5;
+}
+
+static int sim_generate(sim_t *sim, const int32_t *data, uint32_t step)
+{
+    int32_t a = data[0] & 0x3fff;
+
+    sim->freq = step * 125e6 / (65536.0 * 16384);
+    sim->ampl = (a & 0x2000 ? a - 0x4000 : a) / 4000.0; // 1 V ==> 4000 DAC counts
+    return 0;
+}
+
+static int sim_acquire(sim_t *sim, int dec, uint32_t size, float *ch1, float *ch2)
+{
+    double w = 2 * M_PI * sim->freq, T = dec / 125e6;
+    double complex h;
+    uint32_t i;
+
+    if (sim->lcr) {
+        /* The shunt and cable as the analysis models and corrects them */
+        double complex z = DUT_R + 1 / (I * w * DUT_C);
+        double xc = 1 / (w * 160e-12);
+        double complex zs = SHUNT * xc / (SHUNT + xc) * cexp(I * atan(-w * 460e-12 * SHUNT));
+        h = zs / (z + zs);
+    } else {
+        h = 1 / (1 + I * sim->freq / LP_FC);
+    }
+    for (i = 0; i < size; i++) {
+        double ph = w * i * T;
+        /* 1 V ==> 8192 ADC counts */
+        ch1[i] = 8192 * sim->ampl * sin(ph) + sim_noise(sim);
+        ch2[i] = 8192 * sim->ampl * cabs(h) * sin(ph + carg(h)) + sim_noise(sim);
+    }
+    sim->acquisitions++;
+    usleep(size * T * 1e6);
+    return 0;
+}
+
+static int lcr_sim_generate(void *ctx, unsigned int ch, const int32_t *data,
+                            const lcr_awg_param_t *awg)
+{
+    return sim_generate(ctx, data, awg->step);
+}
+
+static int lcr_sim_acquire(void *ctx, int dec_idx, uint32_t size, float *ch1, float *ch2)
+{
+    return sim_acquire(ctx, lcr_dec[dec_idx], size, ch1, ch2);
+}
+
+static int bode_sim_generate(void *ctx, unsigned int ch, const int32_t *data,
+                             const bode_awg_param_t *awg)
+{
+    return sim_generate(ctx, data, awg->step);
+}
+
+static int bode_sim_acquire(void *ctx, int dec_idx, uint32_t size, float *ch1, float *ch2)
+{
+    return sim_acquire(ctx, bode_dec[dec_idx], size, ch1, ch2);
+}
+
+static const lcr_sweep_params_t lcr_params = {
+    .ch = 0, .ampl = 0.25, .dc_bias = 0, .r_shunt = SHUNT, .averaging = 1,
+    .calib = 0, .steps = POINTS, .freq_sweep = 1,
+    .start_freq = START, .end_freq = END, .log_scale = 1
+};
+
+static const bode_sweep_params_t bode_params = {
+    .ch = 0, .ampl = 0.5, .dc_bias = 0, .averaging = 1, .steps = POINTS,
+    .start_freq = START, .end_freq = END, .log_scale = 1
+};
+
+/*
+ * Sweep results, as the web applications keep them. The files and their
+ * formats are the ones of the lcr & bode utilities.
+ */
+#define LCR_FILES (LCR_QUANTITIES + 1)
+#define BODE_FILES 3
+
+static const char *lcr_file_name[LCR_FILES] = {
+    "data_frequency", "data_amplitude", "data_phase", "data_Y_abs", "data_phaseY",
+    "data_R_s", "data_R_p", "data_X_s", "data_G_p", "data_B_p",
+    "data_C_s", "data_C_p", "data_L_s", "data_L_p", "data_Q", "data_D"
+};
+static const char *bode_file_name[BODE_FILES] = {
+    "data_frequency", "data_amplitude", "data_phase"
+};
+
+typedef struct {
+    float  v[LCR_FILES][POINTS];   // [0] frequency, then the quantities
+    int    num;
+    double t_start, t_first, t_end;
+    FILE  *f[LCR_FILES];
+    char   progress[256];
+} result_t;
+
+static int lcr_to_files(void *ctx, int idx, int count, const lcr_point_t *pt)
+{
+    result_t *r = ctx;
+    int q;
+
+    fprintf(r->f[0], "%.1f\n", pt->freq);
+    for (q = 0; q < LCR_QUANTITIES; q++) {
+        fprintf(r->f[q + 1], q == LCR_Z_ABS ? "%.3f\n" : q == LCR_Z_PHASE ? "%.2f\n" : "%.15f\n",
+                pt->v[q]);
+    }
+    return 0;
+}
+
+static int lcr_to_memory(void *ctx, int idx, int count, const lcr_point_t *pt)
+{
+    result_t *r = ctx;
+    int q;
+
+    if (r->num == 0) {
+        r->t_first = timeNow();
+    }
+    r->v[0][idx] = pt->freq;
+    for (q = 0; q < LCR_QUANTITIES; q++) {
+        r->v[q + 1][idx] = pt->v[q];
+    }
+    r->num = idx + 1;
+    return 0;
+}
+
+static int bode_to_files(void *ctx, int idx, int count, const bode_point_t *pt)
+{
+    result_t *r = ctx;
+
+    fprintf(r->f[0], "%.5f\n", pt->freq);
+    fprintf(r->f[1], "%.5f\n", pt->amplitude);
+    fprintf(r->f[2], "%.5f\n", pt->phase);
+    return 0;
+}
+
+static int bode_to_memory(void *ctx, int idx, int count, const bode_point_t *pt)
+{
+    result_t *r = ctx;
+
+    if (r->num == 0) {
+        r->t_first = timeNow();
+    }
+    r->v[0][idx] = pt->freq;
+    r->v[1][idx] = pt->amplitude;
+    r->v[2][idx] = pt->phase;
+    r->num = idx + 1;
+    return 0;
+}
+
+static void progress_file(void *ctx, int percent)
+{
+    FILE *f = fopen(((result_t *)ctx)->progress, "w");
+
+    if (f) {
+        fprintf(f, "%d \n", percent);
+        fclose(f);
+    }
+}
+
+/** The command line utility: sweep to the data files in dir */
+static int child(const char *what, const char *dir)
+{
+    int lcr = !strcmp(what, "lcr");
+    int files = lcr ? LCR_FILES : BODE_FILES;
+    const char **names = lcr ? lcr_file_name : bode_file_name;
+    sim_t sim = { .lcr = lcr, .noise = 1 };
+    result_t r;
+    char path[256];
+    int i, ret;
+
+    snprintf(r.progress, sizeof(r.progress), "%s/progress", dir);
+    for (i = 0; i < files; i++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+        if (!(r.f[i] = fopen(path, "w"))) {
+            perror(path);
+            return 1;
+        }
+    }
+    if (lcr) {
+        lcr_backend_t be = { &sim, lcr_sim_generate, lcr_sim_acquire, NULL };
+        lcr_sweep_cb_t cb = { &r, lcr_to_files, progress_file };
+        ret = lcr_sweep_run(&lcr_params, &be, &cb);
+    } else {
+        bode_backend_t be = { &sim, bode_sim_generate, bode_sim_acquire };
+        bode_sweep_cb_t cb = { &r, bode_to_files, progress_file };
+        ret = bode_sweep_run(&bode_params, &be, &cb);
+    }
+    for (i = 0; i < files; i++) {
+        fclose(r.f[i]);
+    }
+    return ret == POINTS ? 0 : 1;
+}
+
+/** Spawned: run the utility, then read its files back */
+static void run_spawned(const char *self, const char *what, const char *dir, result_t *r)
+{
+    int files = !strcmp(what, "lcr") ? LCR_FILES : BODE_FILES;
+    const char **names = files == LCR_FILES ? lcr_file_name : bode_file_name;
+    char cmd[512], path[256];
+    int i, n;
+
+    memset(r, 0, sizeof(*r));
+    r->t_start = timeNow();
+    snprintf(cmd, sizeof(cmd), "%s child %s %s", self, what, dir);
+    CHECK(system(cmd) == 0, "%s: utility failed", what);
+
+    for (i = 0; i < files; i++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+        FILE *f = fopen(path, "r");
+        if (!f) {
+            failures++;
+            return;
+        }
+        for (n = 0; n < POINTS && fscanf(f, "%f", &r->v[i][n]) == 1; n++)
+            ;
+        fclose(f);
+        unlink(path);
+        r->num = n;
+    }
+    snprintf(path, sizeof(path), "%s/progress", dir);
+    unlink(path);
+    /* Nothing could be plotted before the utility finished */
+    r->t_first = r->t_end = timeNow();
+}
+
+static void run_in_process(const char *what, result_t *r, int *acquisitions)
+{
+    sim_t sim = { .lcr = !strcmp(what, "lcr"), .noise = 1 };
+    int ret;
+
+    memset(r, 0, sizeof(*r));
+    r->t_start = timeNow();
+    if (sim.lcr) {
+        lcr_backend_t be = { &sim, lcr_sim_generate, lcr_sim_acquire, NULL };
+        lcr_sweep_cb_t cb = { r, lcr_to_memory, NULL };
+        ret = lcr_sweep_run(&lcr_params, &be, &cb);
+    } else {
+        bode_backend_t be = { &sim, bode_sim_generate, bode_sim_acquire };
+        bode_sweep_cb_t cb = { r, bode_to_memory, NULL };
+        ret = bode_sweep_run(&bode_params, &be, &cb);
+    }
+    r->t_end = timeNow();
+    CHECK(ret == POINTS, "%s: sweep returned %d", what, ret);
+    *acquisitions = sim.acquisitions;
+}
+
+/** Points against the simulated circuit and the two ways against each other */
+static void compare(const char *what, const result_t *spawned, const result_t *inproc)
+{
+    int lcr = !strcmp(what, "lcr");
+    int files = lcr ? LCR_FILES : BODE_FILES;
+    double worst = 0;
+    int i, q;
+
+    CHECK(spawned->num == POINTS && inproc->num == POINTS, "%s: %d / %d points", what,
+          spawned->num, inproc->num);
+    for (i = 0; i < inproc->num; i++) {
+        double f = inproc->v[0][i], w = 2 * M_PI * f;
+
+        if (lcr) {
+            double complex z = DUT_R + 1 / (I * w * DUT_C);
+            CHECK(fabs(inproc->v[1 + LCR_Z_ABS][i] / cabs(z) - 1) < 0.02 &&
+                  fabs(inproc->v[1 + LCR_Z_PHASE][i] - carg(z) * 180 / M_PI) < 0.5,
+                  "lcr: %.0f Hz: |Z| %g, P %g, expected %g, %g", f,
+                  inproc->v[1 + LCR_Z_ABS][i], inproc->v[1 + LCR_Z_PHASE][i],
+                  cabs(z), carg(z) * 180 / M_PI);
+        } else {
+            double complex h = 1 / (1 + I * f / LP_FC);
+            CHECK(fabs(inproc->v[1][i] - 10 * log(cabs(h))) < 0.05 &&
+                  fabs(inproc->v[2][i] - carg(h) * 180 / M_PI) < 0.5,
+                  "bode: %.0f Hz: %g, %g deg, expected %g, %g", f,
+                  inproc->v[1][i], inproc->v[2][i], 10 * log(cabs(h)), carg(h) * 180 / M_PI);
+        }
+        /* The files hold the points as text */
+        for (q = 0; q < files; q++) {
+            double d = fabs(spawned->v[q][i] - inproc->v[q][i]) /
+                       (fabs(inproc->v[q][i]) + 1e-3);
+            if (d > worst) {
+                worst = d;
+            }
+        }
+    }
+    CHECK(worst < 1e-3, "%s: files differ by %g", what, worst);
+}
+
+static void bench(const char *self, const char *what, const char *dir)
+{
+    static result_t spawned, inproc;
+    int acquisitions;
+
+    run_spawned(self, what, dir, &spawned);
+    run_in_process(what, &inproc, &acquisitions);
+    compare(what, &spawned, &inproc);
+
+    printf("%-5s spawned     %7.1f ms sweep  %7.1f ms to first point\n", what,
+           (spawned.t_end - spawned.t_start) * 1e3, (spawned.t_first - spawned.t_start) * 1e3);
+    printf("%-5s in-process  %7.1f ms sweep  %7.1f ms to first point\n", what,
+           (inproc.t_end - inproc.t_start) * 1e3, (inproc.t_first - inproc.t_start) * 1e3);
+    /* The utilities also slept a fixed 80 ms around every acquisition */
+    printf("%-5s (%d acquisitions, the utility's fixed delays add %.1f s on hardware)\n",
+           what, acquisitions, acquisitions * 0.08);
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = "/tmp";
+
+    if (argc == 4 && !strcmp(argv[1], "child")) {
+        return child(argv[2], argv[3]);
+    }
+    if (argc > 1) {
+        dir = argv[1];
+    }
+
+    printf("%d point log sweeps %.0f Hz - %.0f Hz, simulated front end, data files in %s\n",
+           POINTS, START, END, dir);
+    bench(argv[0], "lcr", dir);
+    bench(argv[0], "bode", dir);
+
+    if (failures) {
+        printf("%d checks FAILED\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,265 @@
+/**
+ * $Id: $
+ *
+ * @brief Slow analog input stream test on a fake XADC IIO device.
+ *
+ * Builds a fake XADC sysfs directory (raw values, scan elements, buffer
+ * attributes and a sample rate trigger) and a FIFO standing in for the IIO
+ * character device, then checks librp's analog input functions against it:
+ * sysfs reads, scan element & buffer setup, decoding of the scans written
+ * to the FIFO in odd sized pieces, block reads, averages and timestamps.
+ * Also compares the read rate of single sysfs reads with streamed ones.
+ *
+ * Usage: xadc_stream_test
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "redpitaya/rp.h"
+#include "bench.h"
+
+#define SCANS    5000
+#define RATE     1000
+#define PIECE    1001
+
+/* Scan index of the channel of each pin, the scan is ordered by it */
+static const char *channel[4] = {
+    "in_voltage11_vaux8", "in_voltage9_vaux0", "in_voltage10_vaux1", "in_voltage12_vaux9"
+};
+static const int scan_pos[4] = { 2, 0, 1, 3 };
+
+static char root[64], dir[128];
+
+/* Stream timestamps are CLOCK_REALTIME */
+static double timeReal() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void writeFile(const char *d, const char *name, const char *value) {
+    char path[256];
+    FILE *fp;
+
+    snprintf(path, sizeof(path), "%s/%s", d, name);
+    fp = fopen(path, "w");
+    if (fp == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    fputs(value, fp);
+    fclose(fp);
+}
+
+static void readFile(const char *d, const char *name, char *value, int len) {
+    char path[256];
+    FILE *fp;
+
+    value[0] = '\0';
+    snprintf(path, sizeof(path), "%s/%s", d, name);
+    fp = fopen(path, "r");
+    if (fp == NULL)
+        return;
+    if (fgets(value, len, fp))
+        value[strcspn(value, "\n")] = '\0';
+    fclose(fp);
+}
+
+static uint32_t sample(int k, int pin) {
+    return (k * 4 + pin * 1000) & 0xfff;
+}
+
+static void makeDevice(void) {
+    char path[256];
+
+    strcpy(root, "/tmp/xadc_testXXXXXX");
+    if (mkdtemp(root) == NULL) {
+        perror("mkdtemp");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(dir, sizeof(dir), "%s/iio:device1", root);
+    mkdir(dir, 0755);
+    snprintf(path, sizeof(path), "%s/scan_elements", dir);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/buffer", dir);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/trigger", dir);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/trigger0", root);
+    mkdir(path, 0755);
+    writeFile(path, "name", "xadc-samplerate\n");
+    snprintf(path, sizeof(path), "%s/trigger1", root);
+    mkdir(path, 0755);
+    writeFile(path, "name", "xadc-convst\n");
+
+    for (int i = 0; i < 4; i++) {
+        char name[64], val[32];
+        snprintf(name, sizeof(name), "scan_elements/%s_en", channel[i]);
+        writeFile(dir, name, "0\n");
+        snprintf(name, sizeof(name), "scan_elements/%s_index", channel[i]);
+        snprintf(val, sizeof(val), "%d\n", 9 + scan_pos[i]);
+        writeFile(dir, name, val);
+        snprintf(name, sizeof(name), "scan_elements/%s_type", channel[i]);
+        writeFile(dir, name, "le:u12/16>>4\n");
+    }
+    /* enabled by someone else, must be disabled */
+    writeFile(dir, "scan_elements/in_temp0_en", "1\n");
+    writeFile(dir, "scan_elements/in_temp0_index", "0\n");
+    writeFile(dir, "scan_elements/in_temp0_type", "le:u12/16>>4\n");
+
+    writeFile(dir, "in_voltage11_vaux8_raw", "1234\n");
+    writeFile(dir, "in_voltage9_vaux0_raw", "17\n");
+    writeFile(dir, "in_voltage10_vaux1_raw", "garbage\n");
+    writeFile(dir, "sampling_frequency", "200000\n");
+    writeFile(dir, "buffer/length", "16\n");
+    writeFile(dir, "buffer/enable", "0\n");
+    writeFile(dir, "trigger/current_trigger", "\n");
+
+    snprintf(path, sizeof(path), "%s/dev", root);
+    if (mkfifo(path, 0600)) {
+        perror("mkfifo");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void removeDevice(void) {
+    char cmd[128];
+
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", root);
+    if (system(cmd))
+        fprintf(stderr, "failed to remove %s\n", root);
+}
+
+int main(int argc, char **argv) {
+    static uint8_t scans[SCANS * 8];
+    static uint32_t buf[SCANS];
+    char str[64], dev[128];
+    uint32_t value, size;
+    int64_t ts;
+    float avg, rate, volt;
+    double t;
+    int fd, n;
+
+    makeDevice();
+    snprintf(dev, sizeof(dev), "%s/dev", root);
+    CHECK(rp_AIstreamSetPaths(dir, dev) == RP_OK, "set paths");
+
+    /* single reads from sysfs */
+    CHECK(rp_AIpinGetValueRaw(0, &value) == RP_OK && value == 1234, "sysfs read AI0: %u", value);
+    CHECK(rp_AIpinGetValueRaw(1, &value) == RP_OK && value == 17, "sysfs read AI1: %u", value);
+    CHECK(rp_AIpinGetValueRaw(2, &value) == RP_EIIO, "unparsable sysfs value");
+    CHECK(rp_AIpinGetValueRaw(3, &value) == RP_EIIO, "missing sysfs file");
+    CHECK(rp_AIpinGetValueRaw(4, &value) == RP_EPN, "invalid pin");
+    volt = -1;
+    CHECK(rp_AIpinGetValue(3, &volt) == RP_EIIO && volt == -1, "missing sysfs file in volts: %f", volt);
+    CHECK(rp_ApinGetValue(RP_AIN3, &volt) == RP_EIIO, "missing sysfs file by analog pin");
+    CHECK(rp_ApinGetValueRaw(RP_AIN2, &value) == RP_EIIO, "unparsable sysfs value by analog pin");
+    CHECK(rp_AIstreamGetDataRaw(0, buf, &size, &ts) == RP_EUF, "data while stopped");
+
+    t = timeNow();
+    for (n = 0; n < 2000; n++)
+        rp_AIpinGetValueRaw(0, &value);
+    double sysfs_rate = n / (timeNow() - t);
+
+    /* buffer setup */
+    CHECK(rp_AIstreamStart(RATE) == RP_OK, "stream start");
+    CHECK(rp_AIstreamSetPaths(NULL, NULL) == RP_EIPV, "set paths while streaming");
+    readFile(dir, "buffer/enable", str, sizeof(str));
+    CHECK(!strcmp(str, "1"), "buffer enable: %s", str);
+    readFile(dir, "scan_elements/in_temp0_en", str, sizeof(str));
+    CHECK(!strcmp(str, "0"), "other channel enable: %s", str);
+    for (int i = 0; i < 4; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "scan_elements/%s_en", channel[i]);
+        readFile(dir, name, str, sizeof(str));
+        CHECK(!strcmp(str, "1"), "%s enable: %s", channel[i], str);
+    }
+    readFile(dir, "trigger/current_trigger", str, sizeof(str));
+    CHECK(!strcmp(str, "xadc-samplerate"), "trigger: %s", str);
+    CHECK(rp_AIstreamGetRate(&rate) == RP_OK && rate == RATE, "rate: %f", rate);
+
+    /* scans of four 16 bit little endian elements, values in bits 15:4 */
+    for (int k = 0; k < SCANS; k++) {
+        for (int i = 0; i < 4; i++) {
+            uint16_t v = sample(k, i) << 4;
+            scans[k * 8 + scan_pos[i] * 2] = v & 0xff;
+            scans[k * 8 + scan_pos[i] * 2 + 1] = v >> 8;
+        }
+    }
+    fd = open(dev, O_WRONLY);
+    CHECK(fd >= 0, "open FIFO");
+    for (int off = 0; fd >= 0 && off < (int)sizeof(scans); off += PIECE) {
+        int len = sizeof(scans) - off < PIECE ? sizeof(scans) - off : PIECE;
+        if (write(fd, scans + off, len) != len)
+            CHECK(0, "FIFO write");
+    }
+    double t_write = timeReal();
+
+    for (t = timeNow(); timeNow() - t < 2; usleep(1000)) {
+        uint32_t last = sample(SCANS - 1, 0);
+        if (rp_AIpinGetValueRaw(0, &value) == RP_OK && value == last)
+            break;
+    }
+    CHECK(value == sample(SCANS - 1, 0), "latest value: %u", value);
+
+    /* block reads */
+    for (int i = 0; i < 4; i++) {
+        size = 100;
+        CHECK(rp_AIstreamGetDataRaw(i, buf, &size, &ts) == RP_OK && size == 100, "block AI%d", i);
+        for (int k = 0; k < 100; k++) {
+            if (buf[k] != sample(SCANS - 100 + k, i)) {
+                CHECK(0, "AI%d sample %d: %u != %u", i, k, buf[k], sample(SCANS - 100 + k, i));
+                break;
+            }
+        }
+        /* timestamps of the read time back dated by the sample period */
+        CHECK(ts / 1e9 > t_write - 1 - 99.0 / RATE && ts / 1e9 < t_write + 1, "timestamp %f", ts / 1e9);
+    }
+    size = 2 * SCANS;
+    CHECK(rp_AIstreamGetDataRaw(1, buf, &size, NULL) == RP_OK && size == SCANS, "block larger than stream: %u", size);
+
+    /* averages */
+    {
+        float exp = 0, volts[4];
+        for (int k = SCANS - 4; k < SCANS; k++)
+            exp += sample(k, 3) / 4.0;
+        CHECK(rp_AIstreamGetAverage(3, 4, &avg) == RP_OK &&
+              avg > exp / 4095 * 7 - 1e-4 && avg < exp / 4095 * 7 + 1e-4, "average %f V, expected %f", avg, exp / 4095 * 7);
+        size = 4;
+        CHECK(rp_AIstreamGetData(3, volts, &size, NULL) == RP_OK && size == 4, "block in volts");
+        CHECK((volts[0] + volts[1] + volts[2] + volts[3]) / 4 - avg < 1e-4, "block in volts mean %f", volts[0]);
+        CHECK(rp_AIstreamGetAverage(3, 0, &avg) == RP_EOOR, "average of 0 samples");
+    }
+
+    t = timeNow();
+    for (n = 0; n < 200000; n++)
+        rp_AIpinGetValueRaw(0, &value);
+    double stream_rate = n / (timeNow() - t);
+
+    if (fd >= 0)
+        close(fd);
+    CHECK(rp_AIstreamStop() == RP_OK, "stream stop");
+    readFile(dir, "buffer/enable", str, sizeof(str));
+    CHECK(!strcmp(str, "0"), "buffer disable: %s", str);
+    CHECK(rp_AIpinGetValueRaw(0, &value) == RP_OK && value == 1234, "sysfs read after stop: %u", value);
+
+    removeDevice();
+
+    printf("rp_AIpinGetValueRaw(): %.0f reads/s from sysfs, %.0f reads/s streamed\n",
+           sysfs_rate, stream_rate);
+    if (failures) {
+        printf("%d checks FAILED\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("All checks passed\n");
+    return EXIT_SUCCESS;
+}
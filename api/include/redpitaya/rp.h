@@ -24,6 +24,9 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "rp_perf.h"
+#include "rp_history.h"
+
 #define ADC_BUFFER_SIZE             (16*1024)
 
 /** @name Error codes
@@ -79,6 +82,10 @@ extern "C" {
 #define RP_EFWB   22
 /** Extension module not connected */
 #define RP_EMNC   23
+/** Operation timed out */
+#define RP_ETMO   24
+/** Failed to access IIO device */
+#define RP_EIIO   25
 
 #define SPECTR_OUT_SIG_LEN (2*1024)
 
@@ -130,6 +137,34 @@ typedef enum {
     RP_OUT //!< Output direction
 } rp_pinDirection_t;
 
+/**
+ * Type representing a digital port, bit n of a port value is pin n.
+ */
+typedef enum {
+    RP_DPORT_LED,   //!< LED 0 - 7
+    RP_DPORT_DIO_P, //!< DIO0_P - DIO7_P
+    RP_DPORT_DIO_N  //!< DIO0_N - DIO7_N
+} rp_dport_t;
+
+/**
+ * Step of a digital pattern sequence.
+ */
+typedef struct {
+    uint32_t mask;  //!< Pins set by the step
+    uint32_t state; //!< States of the pins set
+    uint32_t delay; //!< Time to the next step in ns
+} rp_dseq_step_t;
+
+/**
+ * Digital pattern sequencer statistics.
+ */
+typedef struct {
+    uint64_t steps;    //!< Steps played
+    uint32_t late_avg; //!< Mean delay of a step after its time in ns
+    uint32_t late_max; //!< Max delay of a step after its time in ns
+    uint32_t breaks;   //!< Pauses of a sequence busy-waiting too long, each slips the schedule
+} rp_dseq_stat_t;
+
 /**
  * Type representing analog input output pins.
  */
@@ -248,6 +283,17 @@ typedef struct {
     int32_t  fe_ch2_hi_offs; //!< Front end DC offset, channel B
 } rp_calib_params_t;
 
+/**
+ * Statistic of the last calibration acquisition
+ */
+typedef struct {
+    double   mean;           //!< Mean over accepted captures
+    double   std_err;        //!< Standard error of the mean
+    uint32_t captures;       //!< Number of acquired captures
+    uint32_t accepted;       //!< Number of captures left after outlier rejection
+    uint64_t time_ns;        //!< Acquisition wall time [ns]
+} rp_calib_stat_t;
+
 typedef struct wf_func_table_t {
     int (*rp_spectr_wf_init)();
     int (*rp_spectr_wf_clean)();
@@ -412,6 +458,15 @@ int rp_CalibrationSetCachedParams();
 * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
 */
 int rp_CalibrationWriteParams(rp_calib_params_t calib_params);
+
+/**
+* Returns statistic of the last calibration acquisition.
+* Each calibration point averages several captures and rejects outliers, the statistic
+* holds the resulting mean, its standard error and acquisition wall time.
+* @param stat Statistic of the last calibration acquisition.
+* @return If the function is successful, the return value is RP_OK.
+*/
+int rp_CalibrationGetLastStat(rp_calib_stat_t *stat);
 ///@}
 
 
@@ -500,6 +555,87 @@ int rp_DpinSetDirection(rp_dpin_t pin, rp_pinDirection_t direction);
  */
 int rp_DpinGetDirection(rp_dpin_t pin, rp_pinDirection_t* direction);
 
+/**
+ * Sets the direction of the pins of a digital port in a single register write.
+ * LED pins cannot be set to the input direction.
+ * @param port       Digital port.
+ * @param mask       Pins to set.
+ * @param direction  Directions of the pins, bit set - output.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_DportSetDirection(rp_dport_t port, uint32_t mask, uint32_t direction);
+
+/**
+ * Gets the direction of the pins of a digital port.
+ * @param port       Digital port.
+ * @param direction  Directions of the pins, bit set - output.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_DportGetDirection(rp_dport_t port, uint32_t* direction);
+
+/**
+ * Sets the state of the pins of a digital port in a single register write.
+ * All pins in the mask must be outputs.
+ * @param port   Digital port.
+ * @param mask   Pins to set.
+ * @param state  States of the pins, bit set - high.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_DportSetState(rp_dport_t port, uint32_t mask, uint32_t state);
+
+/**
+ * Gets the state of the pins of a digital port.
+ * @param port   Digital port.
+ * @param state  States of the pins, bit set - high.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_DportGetState(rp_dport_t port, uint32_t* state);
+
+/**
+ * Starts playing a pattern sequence on a digital port from a real-time thread.
+ * Step times are kept to the sum of the previous delays from the start, the
+ * first step is set immediately. While the sequence plays, it owns the output
+ * states of the port: other state changes of the port are overwritten.
+ * Delays shorter than 50 us are busy-waited; after 100 ms of busy-waiting in
+ * a row the sequence pauses 1 ms so other threads get the CPU, the steps
+ * after the pause are played that much later.
+ * A running sequence is stopped first.
+ * @param port    Digital port.
+ * @param steps   Sequence steps, the pins of all steps must be outputs.
+ * @param count   Number of steps.
+ * @param repeat  Number of times the sequence is played, 0 - until stopped.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_DseqStart(rp_dport_t port, const rp_dseq_step_t* steps, uint32_t count, uint32_t repeat);
+
+/**
+ * Stops the pattern sequence, the pins keep the state of the last step played.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_DseqStop();
+
+/**
+ * Gets whether a pattern sequence is playing.
+ * @param running  True while the sequence plays.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_DseqIsRunning(bool* running);
+
+/**
+ * Gets the timing statistics of the last pattern sequence started.
+ * @param stat  Statistics.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_DseqGetStat(rp_dseq_stat_t* stat);
+
 ///@}
 
 
@@ -579,6 +715,67 @@ int rp_AIpinGetValue(int unsigned pin, float* value);
  */
 int rp_AIpinGetValueRaw(int unsigned pin, uint32_t* value);
 
+/**
+ * Sets the XADC IIO device sysfs directory and character device, used by the
+ * analog input functions. NULL restores the default; the character device
+ * defaults to /dev/ + sysfs directory name. Not allowed while streaming.
+ * @param sysfs_dir  IIO device sysfs directory
+ * @param dev_path   IIO device character device
+ * @return       RP_OK - successful, RP_E* - failure
+ */
+int rp_AIstreamSetPaths(const char* sysfs_dir, const char* dev_path);
+
+/**
+ * Starts continuous sampling of all analog input pins through the IIO
+ * buffer into a ring buffer of the last 16k samples per pin. While
+ * streaming, rp_AIpinGetValue() returns the latest sample.
+ * @param rate   sample rate in Hz, rounded by the device
+ * @return       RP_OK - successful, RP_E* - failure
+ */
+int rp_AIstreamStart(float rate);
+
+/**
+ * Stops continuous sampling of the analog input pins.
+ * @return       RP_OK - successful, RP_E* - failure
+ */
+int rp_AIstreamStop();
+
+/**
+ * Gets the sample rate of the analog input stream.
+ * @param rate   sample rate in Hz
+ * @return       RP_OK - successful, RP_E* - failure
+ */
+int rp_AIstreamGetRate(float* rate);
+
+/**
+ * Gets the newest streamed samples of an analog pin in volts, oldest first.
+ * @param pin        pin index
+ * @param buffer     samples
+ * @param size       samples requested, returns samples available
+ * @param timestamp  time of the first sample in ns since the epoch (may be NULL)
+ * @return       RP_OK - successful, RP_E* - failure
+ */
+int rp_AIstreamGetData(int unsigned pin, float* buffer, uint32_t* size, int64_t* timestamp);
+
+/**
+ * Gets the newest streamed raw samples of an analog pin, oldest first.
+ * @param pin        pin index
+ * @param buffer     raw 12 bit XADC values
+ * @param size       samples requested, returns samples available
+ * @param timestamp  time of the first sample in ns since the epoch (may be NULL)
+ * @return       RP_OK - successful, RP_E* - failure
+ */
+int rp_AIstreamGetDataRaw(int unsigned pin, uint32_t* buffer, uint32_t* size, int64_t* timestamp);
+
+/**
+ * Gets the mean of the newest streamed samples of an analog pin in volts.
+ * @param pin    pin index
+ * @param count  samples averaged, fewer if not received yet
+ * @param value  voltage
+ * @return       RP_OK - successful, RP_E* - failure
+ */
+int rp_AIstreamGetAverage(int unsigned pin, uint32_t count, float* value);
+
 
 /** @name Analog Outputs
  */
@@ -1019,6 +1216,99 @@ int rp_AcqGetLatestDataV(rp_channel_t channel, uint32_t* size, float* buffer);
 int rp_AcqGetBufSize(uint32_t* size);
 
 
+///@}
+/** @name Zoom FFT
+ * Narrow band spectrum of span around a centre frequency at a resolution
+ * the full band FFT can not reach: the samples are down-converted, decimated
+ * and fed to an FFT of fft_len points, of which the middle fft_len / 2 bins
+ * are shown. Spectra are averaged until read. The samples must be
+ * contiguous, e.g. of continuous acquisition (RP_TRIG_SRC_DISABLED) fed by
+ * rp_ZoomFeedAcq() often enough.
+ */
+///@{
+
+/**
+ * Zoom FFT, opaque.
+ */
+typedef struct rp_spectr_zoom_s rp_zoom_t;
+
+/**
+ * Creates a zoom FFT.
+ * @param fs        Sample rate of the input, Hz.
+ * @param f_center  Centre frequency, Hz.
+ * @param span      Span, Hz. Rounded up to one the decimation allows, see rp_ZoomGetSpan().
+ * @param fft_len   FFT points, a power of 2 from 64 to 65536.
+ * @param zoom      Returns the zoom FFT.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_ZoomCreate(double fs, double f_center, double span, uint32_t fft_len, rp_zoom_t** zoom);
+
+/**
+ * Frees a zoom FFT.
+ * @param zoom  Zoom FFT, may be NULL.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_ZoomDestroy(rp_zoom_t* zoom);
+
+/**
+ * Gets the span realized and the bin width.
+ * @param zoom  Zoom FFT.
+ * @param span  Returns the span, Hz.
+ * @param bin   Returns the bin width, Hz.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_ZoomGetSpan(rp_zoom_t* zoom, double* span, double* bin);
+
+/**
+ * Restarts the filters and drops the averaged spectra, for input that does
+ * not continue the previous samples, e.g. after the acquisition was restarted.
+ * @param zoom  Zoom FFT.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_ZoomReset(rp_zoom_t* zoom);
+
+/**
+ * Down-converts samples continuing the previous ones.
+ * @param zoom     Zoom FFT.
+ * @param samples  Samples in ADC counts.
+ * @param size     Number of samples.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_ZoomProcess(rp_zoom_t* zoom, const int16_t* samples, uint32_t size);
+
+/**
+ * Down-converts the samples the acquisition wrote to a channel since the last
+ * call. The first call only takes the write pointer. When the acquisition
+ * has lapped its buffer since the last call, the filters restart after the
+ * gap and the spectra averaged so far stay. A lap is assumed whenever the
+ * calls are further apart than the buffer lasts, so decimations below 8,
+ * whose 16384 samples last less than 1 ms, are refused with RP_EOOR.
+ * @param zoom     Zoom FFT, created for the sample rate of the acquisition.
+ * @param channel  Channel A or B.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_ZoomFeedAcq(rp_zoom_t* zoom, rp_channel_t channel);
+
+/**
+ * Gets the averaged spectrum and starts a new average.
+ * @param zoom      Zoom FFT.
+ * @param freq      Frequency of each bin, Hz.
+ * @param amp       Amplitude of a sine in each bin in ADC counts, a bin centred sine of amplitude A reads A.
+ * @param size      Size of freq and amp, at least fft_len / 2. Returns the number of bins, 0 when
+ *                  no spectrum is complete yet (outputs untouched). In case of too small buffers,
+ *                  required size is returned.
+ * @param averages  Returns the number of spectra averaged, may be NULL.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_ZoomGetSpectrum(rp_zoom_t* zoom, float* freq, float* amp, uint32_t* size, uint32_t* averages);
+
 ///@}
 /** @name Generate
 */
@@ -1165,6 +1455,41 @@ int rp_GenArbWaveform(rp_channel_t channel, float *waveform, uint32_t length);
 */
 int rp_GenGetArbWaveform(rp_channel_t channel, float *waveform, uint32_t *length);
 
+/**
+* Updates part of user defined waveform.
+* Only changed part of the generator buffer is rewritten. Waveform length is extended
+* to offset + length if needed, the rest of the waveform is kept.
+* @param channel Channel A or B for witch we want to set waveform.
+* @param waveform Use defined wave form samples, where min is -1V an max is 1V.
+* @param offset Index of the first updated sample.
+* @param length Number of updated samples.
+* @return If the function is successful, the return value is RP_OK.
+* If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+*/
+int rp_GenArbWaveformRange(rp_channel_t channel, const float *waveform, uint32_t offset, uint32_t length);
+
+/**
+* Updates part of user defined waveform with DAC codes.
+* Same as rp_GenArbWaveformRange, but samples are signed 14 bit DAC codes (-8192 to 8191).
+* @param channel Channel A or B for witch we want to set waveform.
+* @param waveform DAC codes.
+* @param offset Index of the first updated sample.
+* @param length Number of updated samples.
+* @return If the function is successful, the return value is RP_OK.
+* If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+*/
+int rp_GenArbWaveformRaw(rp_channel_t channel, const int16_t *waveform, uint32_t offset, uint32_t length);
+
+/**
+* Gets user defined waveform as signed 14 bit DAC codes.
+* @param channel Channel A or B for witch we want to get waveform.
+* @param waveform Pointer where waveform will be returned.
+* @param length Pointer where waveform length will be returned.
+* @return If the function is successful, the return value is RP_OK.
+* If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+*/
+int rp_GenGetArbWaveformRaw(rp_channel_t channel, int16_t *waveform, uint32_t *length);
+
 /**
 * Sets duty cycle of PWM signal.
 * @param channel Channel A or B for witch we want to set duty cycle.
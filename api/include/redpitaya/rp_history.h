@@ -0,0 +1,177 @@
+/**
+ * $Id: $
+ *
+ * @file rp_history.h
+ * @brief Red Pitaya library long memory history API interface
+ *
+ * Included by rp.h, on its own for code which has types of its own clashing
+ * with rp.h.
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __RP_HISTORY_H
+#define __RP_HISTORY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Fanout of the history levels, an entry of a level sums up this many of the level below */
+#define RP_HISTORY_FANOUT       4
+/** Max levels of a history */
+#define RP_HISTORY_LEVELS_MAX   24
+
+/**
+ * History of a stream of samples, opaque.
+ */
+typedef struct rp_history_s rp_history_t;
+
+/**
+ * Min, max & mean of a stretch of the history, in ADC counts.
+ */
+typedef struct {
+    int16_t min;  //!< Lowest sample
+    int16_t max;  //!< Highest sample
+    float   mean; //!< Mean of the samples
+} rp_history_point_t;
+
+/** @name Long memory history
+ * A history keeps a stream of samples, e.g. of continuous acquisition, far
+ * beyond the acquisition buffer: level 0 holds the latest capacity samples,
+ * each level above holds capacity entries, each the min, max & mean of
+ * RP_HISTORY_FANOUT entries of the level below. Older stretches are thus
+ * kept at lower resolution, a history of L levels spans
+ * capacity * RP_HISTORY_FANOUT^(L-1) samples.
+ *
+ * Samples are numbered since the reset. Any stretch still kept is queried
+ * at the best resolution kept for it, in O(log N) per point. Pushing and
+ * querying may be done from different threads.
+ */
+///@{
+
+/**
+ * Creates a history.
+ * @param capacity  Entries per level, rounded up to a power of 2, 64 at least.
+ * @param levels    Levels, 1 to RP_HISTORY_LEVELS_MAX.
+ * @param history   Returns the history.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_HistoryCreate(uint32_t capacity, uint32_t levels, rp_history_t** history);
+
+/**
+ * Frees a history.
+ * @param history  History, may be NULL.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_HistoryDestroy(rp_history_t* history);
+
+/**
+ * Forgets all samples, the next one pushed is sample 0.
+ * @param history  History.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_HistoryReset(rp_history_t* history);
+
+/**
+ * Appends samples to the history.
+ * @param history  History.
+ * @param samples  Samples in ADC counts.
+ * @param size     Number of samples.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_HistoryPush(rp_history_t* history, const int16_t* samples, uint32_t size);
+
+/**
+ * Appends the samples written to a ring buffer of 14 bit ADC words since the
+ * last call, e.g. of a mapped acquisition buffer. The first call, the first
+ * after rp_HistoryResync() or after the writer has lapped the ring, only
+ * takes the write pointer; a lap is taken as ring_size samples at rate Hz
+ * since the last call with the write pointer moved, so feed the history
+ * often enough while the acquisition runs.
+ * @param history    History.
+ * @param ring       Ring buffer.
+ * @param ring_size  Samples in the ring.
+ * @param wr_ptr     Current write pointer, the last sample written.
+ * @param rate       Sampling rate of the ring, Hz.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_HistoryFeedRing(rp_history_t* history, const volatile uint32_t* ring, uint32_t ring_size,
+                       uint32_t wr_ptr, double rate);
+
+/**
+ * Appends the calibrated samples the acquisition wrote since the last call,
+ * as rp_HistoryFeedRing() on the acquisition buffers.
+ * @param ch1  History of channel 1, may be NULL.
+ * @param ch2  History of channel 2, may be NULL.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_HistoryFeedAcq(rp_history_t* ch1, rp_history_t* ch2);
+
+/**
+ * Makes the next feed only take the write pointer, e.g. after the
+ * acquisition was reset. The samples kept stay.
+ * @param history  History.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_HistoryResync(rp_history_t* history);
+
+/**
+ * Gets the stretch of samples kept.
+ * @param history  History.
+ * @param first    Oldest sample kept.
+ * @param end      Samples pushed since the reset, one past the newest.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_HistoryGetRange(rp_history_t* history, uint64_t* first, uint64_t* end);
+
+/**
+ * Gets the laps of the ring lost by the feeds.
+ * @param history   History.
+ * @param overruns  Feeds which lost samples.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_HistoryGetOverruns(rp_history_t* history, uint32_t* overruns);
+
+/**
+ * Gets samples start to end split into size points of equal length, each
+ * from the finest level still keeping start that has its entries no longer
+ * than a point. The newest samples, not yet summed up on that level, come
+ * from the levels below.
+ * @param history  History.
+ * @param start    First sample, no older than the oldest kept.
+ * @param end      One past the last sample, newer ones than kept are cut off.
+ * @param points   Min, max & mean of each point.
+ * @param size     Size of points, returns the number of points, no more than samples.
+ * @param step     Returns the samples per entry of the level used, the resolution.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_HistoryQuery(rp_history_t* history, uint64_t start, uint64_t end,
+                    rp_history_point_t* points, uint32_t* size, uint64_t* step);
+
+///@}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__RP_HISTORY_H
@@ -0,0 +1,157 @@
+/**
+ * $Id: $
+ *
+ * @file rp_perf.h
+ * @brief Red Pitaya library latency tracing API interface
+ *
+ * Included by rp.h, on its own for code which has types of its own clashing
+ * with rp.h.
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __RP_PERF_H
+#define __RP_PERF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Stages timed by the latency tracing.
+ */
+typedef enum {
+    RP_PERF_ACQ_READ,    //!< Samples read from the FPGA buffer by rp_AcqGetData*()
+    RP_PERF_SCPI_DATA,   //!< SCPI ACQ:SOUR<n>:DATA queries, samples read & reply written
+    RP_PERF_SCPI_TRIG,   //!< Trigger seen to each SCPI ACQ:SOUR<n>:DATA reply written
+    RP_PERF_OSC_PROCESS, //!< Oscilloscope worker, decimation & measurements to signals published
+    RP_PERF_WS_SIGNALS,  //!< Web socket signals JSON serialization
+    RP_PERF_WS_GZIP,     //!< Web socket message compression
+    RP_PERF_STAGES       //!< Number of stages
+} rp_perf_stage_t;
+
+/**
+ * Latency statistics of a stage, times in ns.
+ */
+typedef struct {
+    uint64_t count; //!< Stamps
+    uint64_t mean;  //!< Mean latency
+    uint64_t p50;   //!< Median, top of its histogram bucket
+    uint64_t p99;   //!< 99th percentile, top of its histogram bucket
+    uint64_t max;   //!< Max latency
+} rp_perf_stat_t;
+
+/**
+ * Stamp of a stage kept in the trace ring of a thread.
+ */
+typedef struct {
+    uint64_t start;  //!< Start time, CLOCK_MONOTONIC in ns
+    uint64_t ns;     //!< Latency
+    uint32_t stage;  //!< Stage, rp_perf_stage_t
+    uint32_t thread; //!< Slot of the thread which stamped it, unique among the threads stamping at once
+} rp_perf_rec_t;
+
+#ifndef RP_PERF_DISABLE
+/** Declares t and takes the start of a stage in it, 0 while tracing is off */
+#define RP_PERF_BEGIN(t)        uint64_t t = rp_PerfNow()
+/** Stamps the end of a stage started at t */
+#define RP_PERF_END(stage, t)   rp_PerfStamp(stage, t)
+#else
+#define RP_PERF_BEGIN(t)
+#define RP_PERF_END(stage, t)
+#endif
+
+/** @name Latency tracing
+ * Stages are timed with RP_PERF_BEGIN() & RP_PERF_END(), they compile to
+ * nothing with RP_PERF_DISABLE defined. Tracing is off until enabled. The
+ * stamps of all processes go to one shared memory file, /dev/shm/rp_perf or
+ * the one named by the RP_PERF_SHM environment variable, so enabling, reset
+ * and the statistics cover e.g. the application controllers and the web
+ * socket server as well; RP_EOMD if it can not be mapped.
+ */
+///@{
+
+/**
+ * Enables or disables latency tracing, the statistics are kept.
+ * @param enable  True to enable.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_PerfEnable(bool enable);
+
+/**
+ * Gets whether latency tracing is enabled.
+ * @param enable  True while enabled.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_PerfIsEnabled(bool* enable);
+
+/**
+ * Clears the statistics and traces of all threads of all processes.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_PerfReset();
+
+/**
+ * Gets the start of a stage.
+ * @return CLOCK_MONOTONIC time in ns, 0 while tracing is disabled.
+ */
+uint64_t rp_PerfNow();
+
+/**
+ * Stamps the end of a stage into the trace ring & histogram of the calling
+ * thread, nothing if start is 0.
+ * @param stage  Stage.
+ * @param start  Start of the stage from rp_PerfNow().
+ */
+void rp_PerfStamp(rp_perf_stage_t stage, uint64_t start);
+
+/**
+ * Gets the time the acquisition was first seen triggered since its start.
+ * @return CLOCK_MONOTONIC time in ns, 0 if not seen or tracing is disabled.
+ */
+uint64_t rp_PerfGetTrigger();
+
+/**
+ * Gets the latency statistics of a stage summed over all threads.
+ * @param stage  Stage.
+ * @param stat   Statistics.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_PerfGetStat(rp_perf_stage_t stage, rp_perf_stat_t* stat);
+
+/**
+ * Gets the latest stamps of all threads ordered by their start.
+ * @param recs  Stamps.
+ * @param size  Size of recs, returns the number of stamps.
+ * @return If the function is successful, the return value is RP_OK.
+ * If the function is unsuccessful, the return value is any of RP_E* values that indicate an error.
+ */
+int rp_PerfGetTrace(rp_perf_rec_t* recs, uint32_t* size);
+
+/**
+ * Gets the name of a stage.
+ * @param stage  Stage.
+ * @return Name, "UNKNOWN" for an invalid stage.
+ */
+const char* rp_PerfStageName(rp_perf_stage_t stage);
+
+///@}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__RP_PERF_H
@@ -20,6 +20,7 @@
 #include "calib.h"
 #include "oscilloscope.h"
 #include "acq_handler.h"
+#include "perf.h"
 
 
 // Decimation constants
@@ -460,6 +461,7 @@ int acq_GetTriggerState(rp_acq_trig_state_t* state)
 
     if (stateB) {
         *state=RP_TRIG_STATE_TRIGGERED;
+        perf_TriggerSeen();
     }
     else{
         *state=RP_TRIG_STATE_WAITING;
@@ -655,6 +657,7 @@ int acq_GetChannelThresholdHyst(rp_channel_t channel, float* voltage)
 int acq_Start()
 {
     ECHECK(osc_WriteDataIntoMemory(true));
+    perf_TriggerClear();
     return RP_OK;
 }
 
@@ -699,6 +702,7 @@ uint32_t acq_GetNormalizedDataPos(uint32_t pos)
 
 int acq_GetDataRaw(rp_channel_t channel, uint32_t pos, uint32_t* size, int16_t* buffer)
 {
+    RP_PERF_BEGIN(t);
 
     *size = MIN(*size, ADC_BUFFER_SIZE);
 
@@ -718,6 +722,7 @@ int acq_GetDataRaw(rp_channel_t channel, uint32_t pos, uint32_t* size, int16_t*
         buffer[i] = cmn_CalibCnts(ADC_BITS, cnts, dc_offs);
     }
 
+    RP_PERF_END(RP_PERF_ACQ_READ, t);
     return RP_OK;
 }
 
@@ -781,6 +786,8 @@ int acq_GetLatestDataRaw(rp_channel_t channel, uint32_t* size, int16_t* buffer)
 
 int acq_GetDataV(rp_channel_t channel,  uint32_t pos, uint32_t* size, float* buffer)
 {
+    RP_PERF_BEGIN(t);
+
     *size = MIN(*size, ADC_BUFFER_SIZE);
 
     float gainV;
@@ -800,6 +807,7 @@ int acq_GetDataV(rp_channel_t channel,  uint32_t pos, uint32_t* size, float* buf
         buffer[i] = cmn_CnvCntToV(ADC_BITS, cnts, gainV, calibScale, dc_offs, 0.0);
     }
 
+    RP_PERF_END(RP_PERF_ACQ_READ, t);
     return RP_OK;
 }
 
@@ -13,6 +13,10 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
 #include <unistd.h>
 #include "redpitaya/rp.h"
 #include "common.h"
@@ -426,81 +430,268 @@ int calib_Reset() {
     return calib_Init();
 }
 
-int32_t calib_GetDataMedian(rp_channel_t channel, rp_pinState_t gain) {
-    /* Acquire data */
-    ECHECK(rp_AcqReset());
-    ECHECK(rp_AcqSetGain(channel, gain));
-    ECHECK(rp_AcqSetDecimation(RP_DEC_64));
-    ECHECK(rp_AcqStart());
-    ECHECK(rp_AcqSetTriggerSrc(RP_TRIG_SRC_NOW));
-    usleep(1000000);
-    ECHECK(rp_AcqStop());
+/*----------------------------------------------------------------------------*/
+/* Calibration acquisition */
 
-    int16_t data[BUFFER_LENGTH];
-    uint32_t bufferSize = (uint32_t) BUFFER_LENGTH;
-    ECHECK(rp_AcqGetDataRaw(channel, 0, &bufferSize, data));
+/* @brief Sampling period (non-decimated) - 8 [ns]. */
+#define CALIB_ADC_SAMPLE_PERIOD     8
 
-    long long avg = 0;
-    for(int i = 0; i < BUFFER_LENGTH; ++i)
-        avg += data[i];
+/* @brief Number of captures averaged per calibration point. */
+#define CALIB_CAPTURES              8
 
-    avg /= BUFFER_LENGTH;
-    fprintf(stderr, "\ncalib_GetDataMedian: avg = %d\n", (int32_t)avg);
-    return avg;
+/* @brief Captures further than this many robust sigmas from the median are rejected. */
+#define CALIB_OUTLIER_SIGMA         3.0
+
+/* @brief Buffer fill timeout, expressed in buffer fill times. */
+#define CALIB_TIMEOUT_FILLS         8
+
+/* @brief ADC counts per full scale of a gain, one way. */
+#define CALIB_ADC_FULL_SCALE_CNTS   (1 << 13)
+
+/* Statistic of the last calibration acquisition. */
+static rp_calib_stat_t calib_stat;
+
+static uint64_t calib_GetTimeNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }
 
-float calib_GetDataMedianFloat(rp_channel_t channel, rp_pinState_t gain) {
-    ECHECK(rp_AcqReset());
-    ECHECK(rp_AcqSetGain(channel, gain));
-    ECHECK(rp_AcqSetDecimation(RP_DEC_64));
+static void calib_SleepNs(uint64_t ns)
+{
+    struct timespec ts;
+    ts.tv_sec  = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR);
+}
+
+/**
+ * @brief Waits until FPGA writes the given number of samples after start_pos.
+ *
+ * Progress is tracked by the write pointer. Sleeps are limited to a half of the
+ * buffer fill time, so the pointer can not wrap unnoticed between two reads.
+ *
+ * @param[in] start_pos Write pointer position at which counting starts
+ * @param[in] samples   Number of samples to wait for
+ * @param[in] period_ns Sampling period including decimation [ns]
+ * @retval RP_OK when done, RP_ETMO when the write pointer stops progressing
+ */
+static int calib_WaitSamples(uint32_t start_pos, uint32_t samples, uint64_t period_ns)
+{
+    const uint64_t fill_ns = (uint64_t)ADC_BUFFER_SIZE * period_ns;
+    const uint64_t deadline = calib_GetTimeNs() + CALIB_TIMEOUT_FILLS * fill_ns + 10000000ULL;
+    uint32_t last = start_pos, pos;
+    uint64_t written = 0;
+
+    while (written < samples) {
+        calib_SleepNs(MIN((samples - written) * period_ns, fill_ns / 2));
+        ECHECK(rp_AcqGetWritePointer(&pos));
+        written += (pos + ADC_BUFFER_SIZE - last) % ADC_BUFFER_SIZE;
+        last = pos;
+        if (written < samples && calib_GetTimeNs() > deadline) {
+            return RP_ETMO;
+        }
+    }
+    return RP_OK;
+}
+
+/**
+ * @brief Acquires one full buffer of fresh data.
+ *
+ * Waits until the pre-trigger part of the buffer is overwritten since arming,
+ * triggers immediately and waits for the post-trigger samples, instead of
+ * sleeping a fixed time.
+ *
+ * @param[in] post      Number of samples written after trigger
+ * @param[in] period_ns Sampling period including decimation [ns]
+ */
+static int calib_Capture(uint32_t post, uint64_t period_ns)
+{
+    uint32_t pos;
+    rp_acq_trig_state_t state;
+
+    ECHECK(rp_AcqGetWritePointer(&pos));
     ECHECK(rp_AcqStart());
+    ECHECK(calib_WaitSamples(pos, ADC_BUFFER_SIZE - post, period_ns));
     ECHECK(rp_AcqSetTriggerSrc(RP_TRIG_SRC_NOW));
-    usleep(1000000);
-    int BUF_SIZE = BUFFER_LENGTH;
 
-    ECHECK(rp_AcqStop());
+    const uint64_t deadline = calib_GetTimeNs() + CALIB_TIMEOUT_FILLS * ADC_BUFFER_SIZE * period_ns;
+    do {
+        ECHECK(rp_AcqGetTriggerState(&state));
+        if (state != RP_TRIG_STATE_TRIGGERED && calib_GetTimeNs() > deadline) {
+            return RP_ETMO;
+        }
+    } while (state != RP_TRIG_STATE_TRIGGERED);
 
-    float data[BUF_SIZE];
-    uint32_t bufferSize = (uint32_t) BUF_SIZE;
-    ECHECK(rp_AcqGetDataV(channel, 0, &bufferSize, data));
+    ECHECK(rp_AcqGetWritePointerAtTrig(&pos));
+    ECHECK(calib_WaitSamples(pos, post, period_ns));
 
-    double avg = 0;
-    for(int i = 0; i < BUFFER_LENGTH; ++i)
-        avg += data[i];
+    return rp_AcqStop();
+}
 
-    avg /= BUFFER_LENGTH;
-    fprintf(stderr, "\ncalib_GetDataMedianFloat: avg = %f\n", (float)avg);
-    return avg;
+/**
+ * @brief Computes robust mean of per-capture values.
+ *
+ * Captures deviating from the median by more than CALIB_OUTLIER_SIGMA robust
+ * standard deviations (1.4826 * MAD) are rejected, the rest is averaged.
+ * The median itself is always accepted, so at least one capture remains.
+ * The limit is never below lsb, one ADC count in the units of the values:
+ * a quantized, noiseless input has a MAD of 0 and captures a count apart
+ * are no outliers.
+ */
+static void calib_CalcStat(float *values, uint32_t n, float lsb, rp_calib_stat_t *stat, bool *accepted)
+{
+    float sorted[CALIB_CAPTURES], dev[CALIB_CAPTURES];
+    uint32_t i, cnt = 0;
+    double sum = 0, sum2 = 0;
+
+    memcpy(sorted, values, n * sizeof(float));
+    qsort(sorted, n, sizeof(float), floatCmp);
+    float median = sorted[n / 2];
+
+    for (i = 0; i < n; ++i) {
+        dev[i] = fabsf(values[i] - median);
+    }
+    qsort(dev, n, sizeof(float), floatCmp);
+    double limit = MAX(CALIB_OUTLIER_SIGMA * 1.4826 * dev[n / 2], lsb);
+
+    for (i = 0; i < n; ++i) {
+        accepted[i] = fabs(values[i] - median) <= limit + FLOAT_EPS;
+        if (accepted[i]) {
+            sum  += values[i];
+            sum2 += (double)values[i] * values[i];
+            cnt++;
+        }
+    }
+
+    stat->captures = n;
+    stat->accepted = cnt;
+    stat->mean     = sum / cnt;
+    stat->std_err  = 0;
+    if (cnt > 1) {
+        double var = (sum2 - sum * sum / cnt) / (cnt - 1);
+        stat->std_err = var > 0 ? sqrt(var / cnt) : 0;
+    }
 }
 
-int calib_GetDataMinMaxFloat(rp_channel_t channel, rp_pinState_t gain, float* min, float* max) {
+/**
+ * @brief Acquires CALIB_CAPTURES buffers and stores the statistic to calib_stat.
+ *
+ * Without min/max the statistic is computed over per-capture means, otherwise
+ * over per-capture peak to peak values.
+ *
+ * @param[in] channel Channel to acquire
+ * @param[in] gain    Gain of the channel
+ * @param[in] raw     When true, calibrated ADC counts are used, otherwise voltage
+ * @param[out] min    Average of per-capture minimums (may be NULL)
+ * @param[out] max    Average of per-capture maximums (may be NULL)
+ */
+static int calib_Acquire(rp_channel_t channel, rp_pinState_t gain, bool raw, float *min, float *max)
+{
+    float means[CALIB_CAPTURES], mins[CALIB_CAPTURES], maxs[CALIB_CAPTURES];
+    bool accepted[CALIB_CAPTURES];
+    static float data[ADC_BUFFER_SIZE];
+    static int16_t data_raw[ADC_BUFFER_SIZE];
+    uint32_t decimation;
+    int32_t  delay;
+    uint64_t start = calib_GetTimeNs();
+
     ECHECK(rp_AcqReset());
     ECHECK(rp_AcqSetGain(channel, gain));
     ECHECK(rp_AcqSetDecimation(RP_DEC_64));
-    ECHECK(rp_AcqStart());
-    ECHECK(rp_AcqSetTriggerSrc(RP_TRIG_SRC_NOW));
-    usleep(1000000);
-    int BUF_SIZE = BUFFER_LENGTH;
-
-    ECHECK(rp_AcqStop());
+    ECHECK(rp_AcqGetDecimationFactor(&decimation));
+    const uint64_t period_ns = (uint64_t)CALIB_ADC_SAMPLE_PERIOD * decimation;
+
+    /* trigger delay is relative to the middle of the buffer */
+    ECHECK(rp_AcqGetTriggerDelay(&delay));
+    delay += ADC_BUFFER_SIZE / 2;
+    const uint32_t post = MIN(MAX(delay, 0), ADC_BUFFER_SIZE - 1);
+
+    /* one ADC count, in V unless raw */
+    float lsb = 1;
+    if (!raw) {
+        float gainV;
+        ECHECK(rp_AcqGetGainV(channel, &gainV));
+        lsb = gainV / CALIB_ADC_FULL_SCALE_CNTS;
+    }
 
-    float data[BUF_SIZE];
-    uint32_t bufferSize = (uint32_t) BUF_SIZE;
-    ECHECK(rp_AcqGetDataV(channel, 0, &bufferSize, data));
+    for (int k = 0; k < CALIB_CAPTURES; ++k) {
+        ECHECK(calib_Capture(post, period_ns));
+
+        uint32_t size = ADC_BUFFER_SIZE;
+        if (raw) {
+            ECHECK(rp_AcqGetDataRaw(channel, 0, &size, data_raw));
+            for (uint32_t i = 0; i < size; ++i) {
+                data[i] = data_raw[i];
+            }
+        } else {
+            ECHECK(rp_AcqGetDataV(channel, 0, &size, data));
+        }
+
+        double avg = 0;
+        float _min = data[0];
+        float _max = data[0];
+        for (uint32_t i = 0; i < size; ++i) {
+            avg += data[i];
+            _min = (_min > data[i]) ? data[i] : _min;
+            _max = (_max < data[i]) ? data[i] : _max;
+        }
+        means[k] = avg / size;
+        mins[k] = _min;
+        maxs[k] = _max;
+    }
 
-    float _min = data[0];
-    float _max = data[0];
-    for(int i = 1; i < BUFFER_LENGTH; ++i) {
-        _min = (_min > data[i]) ? data[i] : _min;
-        _max = (_max < data[i]) ? data[i] : _max;
+    if (min && max) {
+        /* reject on peak to peak value, report averaged extremes */
+        float pp[CALIB_CAPTURES];
+        double smin = 0, smax = 0;
+        for (int k = 0; k < CALIB_CAPTURES; ++k) {
+            pp[k] = maxs[k] - mins[k];
+        }
+        calib_CalcStat(pp, CALIB_CAPTURES, lsb, &calib_stat, accepted);
+        for (int k = 0; k < CALIB_CAPTURES; ++k) {
+            if (accepted[k]) {
+                smin += mins[k];
+                smax += maxs[k];
+            }
+        }
+        *min = smin / calib_stat.accepted;
+        *max = smax / calib_stat.accepted;
+    } else {
+        calib_CalcStat(means, CALIB_CAPTURES, lsb, &calib_stat, accepted);
     }
 
-    fprintf(stderr, "\ncalib_GetDataMinMaxFloat: min = %f, max = %f\n", _min, _max);
-    *min = _min;
-    *max = _max;
+    calib_stat.time_ns = calib_GetTimeNs() - start;
+    return RP_OK;
+}
+
+int32_t calib_GetDataMedian(rp_channel_t channel, rp_pinState_t gain) {
+    ECHECK(calib_Acquire(channel, gain, true, NULL, NULL));
+    int32_t avg = (int32_t)round(calib_stat.mean);
+    fprintf(stderr, "\ncalib_GetDataMedian: avg = %d, std err = %f, %d/%d captures\n",
+            avg, calib_stat.std_err, calib_stat.accepted, calib_stat.captures);
+    return avg;
+}
+
+float calib_GetDataMedianFloat(rp_channel_t channel, rp_pinState_t gain) {
+    ECHECK(calib_Acquire(channel, gain, false, NULL, NULL));
+    fprintf(stderr, "\ncalib_GetDataMedianFloat: avg = %f, std err = %f, %d/%d captures\n",
+            calib_stat.mean, calib_stat.std_err, calib_stat.accepted, calib_stat.captures);
+    return calib_stat.mean;
+}
+
+int calib_GetDataMinMaxFloat(rp_channel_t channel, rp_pinState_t gain, float* min, float* max) {
+    ECHECK(calib_Acquire(channel, gain, false, min, max));
+    fprintf(stderr, "\ncalib_GetDataMinMaxFloat: min = %f, max = %f, %d/%d captures\n",
+            *min, *max, calib_stat.accepted, calib_stat.captures);
     return RP_OK;
 }
 
+rp_calib_stat_t calib_GetLastStat() {
+    return calib_stat;
+}
+
 int calib_setCachedParams() {
 	fprintf(stderr, "write FAILSAFE PARAMS\n");
     ECHECK(calib_WriteParams(failsafa_params));
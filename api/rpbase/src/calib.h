@@ -42,6 +42,7 @@ int calib_Reset();
 int32_t calib_GetDataMedian(rp_channel_t channel, rp_pinState_t gain);
 float calib_GetDataMedianFloat(rp_channel_t channel, rp_pinState_t gain);
 int calib_GetDataMinMaxFloat(rp_channel_t channel, rp_pinState_t gain, float* min, float* max);
+rp_calib_stat_t calib_GetLastStat();
 
 int calib_setCachedParams();
 #endif //__CALIB_H
@@ -12,32 +12,34 @@
  * for more details on the language used herein.
  */
 
-#include <fcntl.h>
-#include <unistd.h>
-#include <sys/mman.h>
 #include <stdio.h>
 #include <math.h>
 
+#include "regmap.h"
 #include "common.h"
 
-static int fd = 0;
+/* The registers are mapped by the shared register map service, which
+ * caches the mappings, so modules mapping the same FPGA block share one */
+static bool opened = false;
 
 int cmn_Init()
 {
-    if (!fd) {
-        if((fd = open("/dev/mem", O_RDWR | O_SYNC)) == -1) {
+    if (!opened) {
+        if (regmap_open(NULL) < 0) {
             return RP_EOMD;
         }
+        opened = true;
     }
     return RP_OK;
 }
 
 int cmn_Release()
 {
-    if (fd) {
-        if(close(fd) < 0) {
+    if (opened) {
+        if (regmap_close() < 0) {
             return RP_ECMD;
         }
+        opened = false;
     }
 
     return RP_OK;
@@ -45,36 +47,24 @@ int cmn_Release()
 
 int cmn_Map(size_t size, size_t offset, void** mapped)
 {
-    if(fd == -1) {
-        return RP_EMMD;
-    }
-
-    *mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+    regmap_block_t blk;
 
-    if(mapped == (void *) -1) {
+    if (regmap_get(offset, size, &blk) < 0) {
         return RP_EMMD;
     }
+    *mapped = (void *) blk.regs;
 
     return RP_OK;
 }
 
 int cmn_Unmap(size_t size, void** mapped)
 {
-    if(fd == -1) {
-        return RP_EUMD;
-    }
-
-    if((mapped == (void *) -1) || (mapped == NULL)) {
+    if ((mapped == NULL) || (*mapped == NULL)) {
         return RP_EUMD;
     }
 
-    if((*mapped == (void *) -1) || (*mapped == NULL)) {
-        return RP_EUMD;
-    }
-
-    if(munmap(*mapped, size) < 0){
-        return RP_EUMD;
-    }
+    regmap_block_t blk = { .regs = *mapped, .size = size };
+    regmap_put(&blk);
     *mapped = NULL;
     return RP_OK;
 }
@@ -0,0 +1,208 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library digital pattern sequencer module implementation
+ *
+ * Plays a list of (mask, state, delay) steps on a digital output register
+ * from a dedicated thread. Step times are absolute, so errors do not add up:
+ * the thread sleeps until shortly before a step and busy-waits the rest.
+ * Busy-waiting goes on for at most DSEQ_SPIN_MAX_NS in a row, then the
+ * thread pauses DSEQ_BREAK_NS and the rest of the schedule slips by that.
+ * The register is written once per step from a copy of its value read at
+ * start, the sequencer owns the register while it runs.
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "dseq.h"
+
+static struct {
+    pthread_t        thread;
+    pthread_mutex_t  mutex;
+    volatile bool    run;
+    volatile bool    running;
+    bool             started;
+    volatile uint32_t *reg;
+    rp_dseq_step_t  *steps;
+    uint32_t         count;
+    uint32_t         repeat;
+    uint64_t         slept;      /* end of the last sleep */
+    /* statistics, under mutex */
+    rp_dseq_stat_t   stat;
+    uint64_t         late_sum;
+} dseq = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+
+static uint64_t dseq_GetTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Sleeps until DSEQ_SPIN_NS before t, busy-waits the rest; returns the time
+ * the wait ended */
+static uint64_t dseq_WaitUntil(uint64_t t) {
+    uint64_t now = dseq_GetTimeNs();
+
+    while (dseq.run && now + DSEQ_SPIN_NS < t) {
+        uint64_t wake = MIN(t - DSEQ_SPIN_NS, now + DSEQ_SLEEP_MAX_NS);
+        struct timespec ts = { .tv_sec = wake / 1000000000, .tv_nsec = wake % 1000000000 };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        now = dseq.slept = dseq_GetTimeNs();
+    }
+    while (now < t) {
+        now = dseq_GetTimeNs();
+    }
+    return now;
+}
+
+/* Pauses if busy-waiting too long, returns the slip of the schedule */
+static uint64_t dseq_Break(uint64_t now) {
+    if (now - dseq.slept < DSEQ_SPIN_MAX_NS) {
+        return 0;
+    }
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = DSEQ_BREAK_NS };
+    nanosleep(&ts, NULL);
+    dseq.slept = dseq_GetTimeNs();
+
+    pthread_mutex_lock(&dseq.mutex);
+    dseq.stat.breaks++;
+    pthread_mutex_unlock(&dseq.mutex);
+    return dseq.slept - now;
+}
+
+static void *dseq_Player(void *arg) {
+    uint32_t out = *dseq.reg;
+    uint64_t t = dseq_GetTimeNs();
+
+    dseq.slept = t;
+    for (uint32_t r = 0; dseq.run && (dseq.repeat == 0 || r < dseq.repeat); r++) {
+        for (uint32_t i = 0; i < dseq.count && dseq.run; i++) {
+            const rp_dseq_step_t *step = &dseq.steps[i];
+            uint64_t now = dseq_WaitUntil(t);
+
+            out = (out & ~step->mask) | (step->state & step->mask);
+            *dseq.reg = out;
+
+            uint32_t late = MIN(now - t, UINT32_MAX);
+            pthread_mutex_lock(&dseq.mutex);
+            dseq.stat.steps++;
+            dseq.late_sum += late;
+            dseq.stat.late_max = MAX(dseq.stat.late_max, late);
+            pthread_mutex_unlock(&dseq.mutex);
+            t += step->delay + dseq_Break(now);
+        }
+    }
+    dseq.running = false;
+    return NULL;
+}
+
+/* Starts the player with SCHED_FIFO priority pinned to the last CPU, so its
+ * busy-waits leave the others alone; normal scheduling if that is not
+ * permitted */
+static int dseq_CreateThread() {
+    pthread_attr_t attr;
+    struct sched_param sched = { .sched_priority = DSEQ_RT_PRIORITY };
+    long cpu_num = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t cpus;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    pthread_attr_setschedparam(&attr, &sched);
+    if (cpu_num > 1) {
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu_num - 1, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpus);
+    }
+    int r = pthread_create(&dseq.thread, &attr, dseq_Player, NULL);
+    pthread_attr_destroy(&attr);
+    if (r) {
+        r = pthread_create(&dseq.thread, NULL, dseq_Player, NULL);
+    }
+    return r;
+}
+
+/**
+ * Plays count steps repeat times (0 - until stopped) on the register.
+ */
+int dseq_Start(volatile uint32_t *reg, const rp_dseq_step_t *steps, uint32_t count, uint32_t repeat) {
+    uint64_t period = 0;
+
+    if (count == 0 || count > DSEQ_MAX_STEPS) {
+        return RP_EOOR;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        period += steps[i].delay;
+    }
+    /* an endless sequence must leave the CPU now and then */
+    if (repeat == 0 && period < count * (uint64_t)DSEQ_SPIN_NS) {
+        return RP_EIPV;
+    }
+    ECHECK(dseq_Stop());
+
+    rp_dseq_step_t *copy = malloc(count * sizeof(rp_dseq_step_t));
+    if (copy == NULL) {
+        return RP_EOOR;
+    }
+    memcpy(copy, steps, count * sizeof(rp_dseq_step_t));
+    free(dseq.steps);
+    dseq.steps = copy;
+    dseq.count = count;
+    dseq.repeat = repeat;
+    dseq.reg = reg;
+
+    pthread_mutex_lock(&dseq.mutex);
+    memset(&dseq.stat, 0, sizeof(dseq.stat));
+    dseq.late_sum = 0;
+    pthread_mutex_unlock(&dseq.mutex);
+
+    dseq.run = true;
+    dseq.running = true;
+    if (dseq_CreateThread()) {
+        dseq.run = false;
+        dseq.running = false;
+        return RP_EUF;
+    }
+    dseq.started = true;
+    return RP_OK;
+}
+
+int dseq_Stop() {
+    dseq.run = false;
+    if (dseq.started) {
+        pthread_join(dseq.thread, NULL);
+        dseq.started = false;
+    }
+    return RP_OK;
+}
+
+int dseq_IsRunning(bool *running) {
+    *running = dseq.running;
+    return RP_OK;
+}
+
+int dseq_GetStat(rp_dseq_stat_t *stat) {
+    pthread_mutex_lock(&dseq.mutex);
+    *stat = dseq.stat;
+    stat->late_avg = dseq.stat.steps ? dseq.late_sum / dseq.stat.steps : 0;
+    pthread_mutex_unlock(&dseq.mutex);
+    return RP_OK;
+}
@@ -0,0 +1,43 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library digital pattern sequencer module interface
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __DSEQ_H
+#define __DSEQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "redpitaya/rp.h"
+
+/* Steps of a sequence */
+#define DSEQ_MAX_STEPS      (64*1024)
+
+/* Waits shorter than this are busy-waited, longer ones sleep until this
+ * long before the step time */
+#define DSEQ_SPIN_NS        50000
+/* Longest single sleep, bounds the reaction to stop */
+#define DSEQ_SLEEP_MAX_NS   10000000
+/* Longest busy-wait in a row, then the player pauses so the real-time
+ * thread does not starve the others */
+#define DSEQ_SPIN_MAX_NS    100000000
+#define DSEQ_BREAK_NS       1000000
+
+#define DSEQ_RT_PRIORITY    60
+
+int dseq_Start(volatile uint32_t *reg, const rp_dseq_step_t *steps, uint32_t count, uint32_t repeat);
+int dseq_Stop();
+int dseq_IsRunning(bool *running);
+int dseq_GetStat(rp_dseq_stat_t *stat);
+
+#endif //__DSEQ_H
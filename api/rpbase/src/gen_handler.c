@@ -13,6 +13,7 @@
 */
 
 #include <float.h>
+#include <string.h>
 #include "math.h"
 #include "common.h"
 #include "generate.h"
@@ -35,9 +36,27 @@ uint32_t      chA_arb_size = BUFFER_LENGTH, chB_arb_size = BUFFER_LENGTH;
 float chA_arbitraryData[BUFFER_LENGTH];
 float chB_arbitraryData[BUFFER_LENGTH];
 
+/* Number of cached waveform tables */
+#define TABLE_CACHE_SIZE        4
+
+/* Canonical (zero phase) waveform table, already converted to DAC counts */
+typedef struct {
+    bool          valid;
+    rp_waveform_t waveform;
+    float         param;        // duty cycle, square transition or channel for arbitrary
+    uint32_t      used;         // LRU stamp
+    uint32_t      cnts[BUFFER_LENGTH];
+} gen_table_t;
+
+static gen_table_t table_cache[TABLE_CACHE_SIZE];
+static uint32_t    table_stamp = 0;
+
 int gen_SetDefaultValues() {
     ECHECK(gen_Disable(RP_CH_1));
     ECHECK(gen_Disable(RP_CH_2));
+    // the DAC buffers are written in full
+    ECHECK(generate_invalidateShadow(RP_CH_1));
+    ECHECK(generate_invalidateShadow(RP_CH_2));
     ECHECK(gen_setFrequency(RP_CH_1, 1000));
     ECHECK(gen_setFrequency(RP_CH_2, 1000));
     ECHECK(gen_setBurstRepetitions(RP_CH_1, 1));
@@ -70,6 +89,9 @@ int gen_Disable(rp_channel_t channel) {
 }
 
 int gen_Enable(rp_channel_t channel) {
+    // the DAC buffer may have been rewritten by another process meanwhile
+    ECHECK(generate_invalidateShadow(channel));
+    ECHECK(synthesize_signal(channel));
     return generate_setOutputDisable(channel, false);
 }
 
@@ -180,6 +202,7 @@ int gen_setWaveform(rp_channel_t channel, rp_waveform_t type) {
                 chA_size = BUFFER_LENGTH,
                 chB_size = BUFFER_LENGTH)
     }
+    ECHECK(generate_invalidateShadow(channel));
     return synthesize_signal(channel);
 }
 
@@ -190,7 +213,48 @@ int gen_getWaveform(rp_channel_t channel, rp_waveform_t *type) {
     return RP_OK;
 }
 
+/**
+ * Re-synthesizes arbitrary signal after its data was changed.
+ * @param full True if whole waveform was replaced and length is its new length.
+ */
+static int arb_update(rp_channel_t channel, uint32_t offset, uint32_t length, bool full) {
+    uint32_t *arb_size;
+    rp_waveform_t waveform;
+    CHANNEL_ACTION(channel,
+            arb_size = &chA_arb_size,
+            arb_size = &chB_arb_size)
+    CHANNEL_ACTION(channel,
+            waveform = chA_waveform,
+            waveform = chB_waveform)
+
+    *arb_size = full ? length : MAX(*arb_size, offset + length);
+    invalidate_table(RP_WAVEFORM_ARBITRARY, channel);
+    if (full) {
+        ECHECK(generate_invalidateShadow(channel));
+    }
+
+    if (waveform == RP_WAVEFORM_ARBITRARY) {
+        CHANNEL_ACTION(channel,
+                chA_size = chA_arb_size,
+                chB_size = chB_arb_size)
+        // only changed part of DAC buffer is uploaded
+        return synthesize_signal(channel);
+    }
+    return RP_OK;
+}
+
+static float *arb_data(rp_channel_t channel) {
+    return channel == RP_CH_1 ? chA_arbitraryData : chB_arbitraryData;
+}
+
 int gen_setArbWaveform(rp_channel_t channel, float *data, uint32_t length) {
+    if (channel != RP_CH_1 && channel != RP_CH_2) {
+        return RP_EPN;
+    }
+    if (length > BUFFER_LENGTH) {
+        return RP_EOOR;
+    }
+
     // Check if data is normalized
     float min = FLT_MAX, max = -FLT_MAX; // initial values
     int i;
@@ -205,33 +269,74 @@ int gen_setArbWaveform(rp_channel_t channel, float *data, uint32_t length) {
     }
 
     // Save data
-    float *pointer;
-    CHANNEL_ACTION(channel,
-            pointer = chA_arbitraryData,
-            pointer = chB_arbitraryData)
-    for(i = 0; i < length; i++) {
-        pointer[i] = data[i];
+    float *pointer = arb_data(channel);
+    memcpy(pointer, data, length * sizeof(float));
+    // clear the rest of the buffer
+    memset(pointer + length, 0, (BUFFER_LENGTH - length) * sizeof(float));
+
+    return arb_update(channel, 0, length, true);
+}
+
+int gen_setArbWaveformRange(rp_channel_t channel, const float *data, uint32_t offset, uint32_t length) {
+    if (channel != RP_CH_1 && channel != RP_CH_2) {
+        return RP_EPN;
     }
-    for(i = length; i < BUFFER_LENGTH; i++) { // clear the rest of the buffer
-        pointer[i] = 0;
+    if (offset > BUFFER_LENGTH || length > BUFFER_LENGTH - offset) {
+        return RP_EOOR;
     }
 
-    if (channel == RP_CH_1) {
-        chA_arb_size = length;
-        if(chA_waveform==RP_WAVEFORM_ARBITRARY){
-        	return synthesize_signal(channel);
+    for (uint32_t i = 0; i < length; i++) {
+        if (data[i] < ARBITRARY_MIN || data[i] > ARBITRARY_MAX) {
+            return RP_ENN;
         }
     }
-    else if (channel == RP_CH_2) {
-    	chA_arb_size = length;
-        if(chB_waveform==RP_WAVEFORM_ARBITRARY){
-        	return synthesize_signal(channel);
+
+    memcpy(arb_data(channel) + offset, data, length * sizeof(float));
+    return arb_update(channel, offset, length, false);
+}
+
+int gen_setArbWaveformRaw(rp_channel_t channel, const int16_t *data, uint32_t offset, uint32_t length) {
+    const int32_t cnt_max = (1 << (DATA_BIT_LENGTH - 1)) - 1;
+    const int32_t cnt_min = -(1 << (DATA_BIT_LENGTH - 1));
+    const float scale = ARBITRARY_MAX / (float) (1 << (DATA_BIT_LENGTH - 1));
+
+    if (channel != RP_CH_1 && channel != RP_CH_2) {
+        return RP_EPN;
+    }
+    if (offset > BUFFER_LENGTH || length > BUFFER_LENGTH - offset) {
+        return RP_EOOR;
+    }
+
+    for (uint32_t i = 0; i < length; i++) {
+        if (data[i] < cnt_min || data[i] > cnt_max) {
+            return RP_EOOR;
         }
     }
-    else {
+
+    // DAC codes are stored exactly, they are converted back to the same codes
+    float *pointer = arb_data(channel) + offset;
+    for (uint32_t i = 0; i < length; i++) {
+        pointer[i] = data[i] * scale;
+    }
+    return arb_update(channel, offset, length, false);
+}
+
+int gen_getArbWaveformRaw(rp_channel_t channel, int16_t *data, uint32_t *length) {
+    static uint32_t cnts[BUFFER_LENGTH];
+    const uint32_t sign = 1 << (DATA_BIT_LENGTH - 1);
+
+    if (channel != RP_CH_1 && channel != RP_CH_2) {
         return RP_EPN;
     }
+    CHANNEL_ACTION(channel,
+            *length = chA_arb_size,
+            *length = chB_arb_size)
 
+    generate_cnvVToCnt(arb_data(channel), cnts, *length);
+    for (uint32_t i = 0; i < *length; i++) {
+        // sign extend 14 bit DAC code
+        data[i] = (int16_t) ((cnts[i] ^ sign) - sign);
+    }
     return RP_OK;
 }
 
@@ -446,11 +551,81 @@ int gen_Synchronise() {
     return generate_Synchronise();
 }
 
+/**
+ * Square wave transition length depends on frequency, so only the
+ * transition length (not the frequency itself) is a part of table key.
+ */
+static int square_transition(float frequency) {
+    // Various locally used constants - HW specific parameters
+    const int trans0 = 30;
+    const int trans1 = 300;
+
+    int trans = (int) (frequency / 1e6 * trans1); // 300 samples at 1 MHz
+
+    if (trans <= 10)  trans = trans0;
+    return trans;
+}
+
+void invalidate_table(rp_waveform_t waveform, float param) {
+    for (int i = 0; i < TABLE_CACHE_SIZE; i++) {
+        if (table_cache[i].valid && table_cache[i].waveform == waveform && table_cache[i].param == param) {
+            table_cache[i].valid = false;
+        }
+    }
+}
+
+/**
+ * Returns cached canonical table for given waveform, synthesizing it
+ * into the least recently used slot when it is not cached yet.
+ */
+static int get_table(rp_channel_t channel, rp_waveform_t waveform, float param, gen_table_t **table) {
+    static float data[BUFFER_LENGTH];
+    gen_table_t *slot = &table_cache[0];
+
+    for (int i = 0; i < TABLE_CACHE_SIZE; i++) {
+        gen_table_t *t = &table_cache[i];
+        if (t->valid && t->waveform == waveform && t->param == param) {
+            t->used = ++table_stamp;
+            *table = t;
+            return RP_OK;
+        }
+        if (!t->valid || (slot->valid && t->used < slot->used)) {
+            slot = t;
+        }
+    }
+
+    const float *src = data;
+    switch (waveform) {
+        case RP_WAVEFORM_SINE     : synthesis_sin      (data);                   break;
+        case RP_WAVEFORM_TRIANGLE : synthesis_triangle (data);                   break;
+        case RP_WAVEFORM_SQUARE   : synthesis_square_trans((int) param, data);   break;
+        case RP_WAVEFORM_RAMP_UP  : synthesis_rampUp   (data);                   break;
+        case RP_WAVEFORM_RAMP_DOWN: synthesis_rampDown (data);                   break;
+        case RP_WAVEFORM_DC       : synthesis_DC       (data);                   break;
+        case RP_WAVEFORM_PWM      : synthesis_PWM      (param, data);            break;
+        case RP_WAVEFORM_ARBITRARY:
+            // arbitrary data is stored zero padded, no need for another copy
+            CHANNEL_ACTION(channel,
+                    src = chA_arbitraryData,
+                    src = chB_arbitraryData)
+            break;
+        default:                    return RP_EIPV;
+    }
+
+    generate_cnvVToCnt(src, slot->cnts, BUFFER_LENGTH);
+    slot->waveform = waveform;
+    slot->param = param;
+    slot->used = ++table_stamp;
+    slot->valid = true;
+    *table = slot;
+    return RP_OK;
+}
+
 int synthesize_signal(rp_channel_t channel) {
-    float data[BUFFER_LENGTH];
     rp_waveform_t waveform;
-    float dutyCycle, frequency;
+    float dutyCycle, frequency, param = 0;
     uint32_t size, phase;
+    gen_table_t *table;
 
     if (channel == RP_CH_1) {
         waveform = chA_waveform;
@@ -471,17 +646,20 @@ int synthesize_signal(rp_channel_t channel) {
     }
 
     switch (waveform) {
-        case RP_WAVEFORM_SINE     : synthesis_sin      (data);                 break;
-        case RP_WAVEFORM_TRIANGLE : synthesis_triangle (data);                 break;
-        case RP_WAVEFORM_SQUARE   : synthesis_square   (frequency, data);      break;
-        case RP_WAVEFORM_RAMP_UP  : synthesis_rampUp   (data);                 break;
-        case RP_WAVEFORM_RAMP_DOWN: synthesis_rampDown (data);                 break;
-        case RP_WAVEFORM_DC       : synthesis_DC       (data);                 break;
-        case RP_WAVEFORM_PWM      : synthesis_PWM      (dutyCycle, data);      break;
-        case RP_WAVEFORM_ARBITRARY: synthesis_arbitrary(channel, data, &size); break;
-        default:                    return RP_EIPV;
+        case RP_WAVEFORM_SQUARE   : param = square_transition(frequency);  break;
+        case RP_WAVEFORM_PWM      : param = dutyCycle;                     break;
+        case RP_WAVEFORM_ARBITRARY:
+            param = channel;
+            CHANNEL_ACTION(channel,
+                    size = chA_arb_size,
+                    size = chB_arb_size)
+            break;
+        default:                                                           break;
     }
-    return generate_writeData(channel, data, phase, size);
+
+    // phase is applied as a rotation of the canonical table
+    ECHECK(get_table(channel, waveform, param, &table));
+    return generate_writeCnts(channel, table->cnts, phase, size);
 }
 
 int synthesis_sin(float *data_out) {
@@ -550,14 +728,10 @@ int synthesis_arbitrary(rp_channel_t channel, float *data_out, uint32_t * size)
 }
 
 int synthesis_square(float frequency, float *data_out) {
-    // Various locally used constants - HW specific parameters
-    const int trans0 = 30;
-    const int trans1 = 300;
-
-    int trans = (int) (frequency / 1e6 * trans1); // 300 samples at 1 MHz
-
-    if (trans <= 10)  trans = trans0;
+    return synthesis_square_trans(square_transition(frequency), data_out);
+}
 
+int synthesis_square_trans(int trans, float *data_out) {
     for(int unsigned i = 0; i < BUFFER_LENGTH; i++) {
         if      ((0 <= i                      ) && (i <  BUFFER_LENGTH/2 - trans))  data_out[i] =  1.0f;
         else if ((i >= BUFFER_LENGTH/2 - trans) && (i <  BUFFER_LENGTH/2        ))  data_out[i] =  1.0f - (2.0f / trans) * (i - (BUFFER_LENGTH/2 - trans));
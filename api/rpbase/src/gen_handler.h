@@ -34,6 +34,9 @@ int gen_setWaveform(rp_channel_t channel, rp_waveform_t type);
 int gen_getWaveform(rp_channel_t channel, rp_waveform_t *type);
 int gen_setArbWaveform(rp_channel_t channel, float *data, uint32_t length);
 int gen_getArbWaveform(rp_channel_t channel, float *data, uint32_t *length);
+int gen_setArbWaveformRange(rp_channel_t channel, const float *data, uint32_t offset, uint32_t length);
+int gen_setArbWaveformRaw(rp_channel_t channel, const int16_t *data, uint32_t offset, uint32_t length);
+int gen_getArbWaveformRaw(rp_channel_t channel, int16_t *data, uint32_t *length);
 int gen_setDutyCycle(rp_channel_t channel, float ratio);
 int gen_getDutyCycle(rp_channel_t channel, float *ratio);
 int gen_setGenMode(rp_channel_t channel, rp_gen_mode_t mode);
@@ -51,10 +54,12 @@ int gen_Synchronise();
 int triggerIfInternal(rp_channel_t channel);
 
 int synthesize_signal(rp_channel_t channel);
+void invalidate_table(rp_waveform_t waveform, float param);
 int synthesis_sin(float *data_out);
 int synthesis_triangle(float *data_out);
 int synthesis_arbitrary(rp_channel_t channel, float *data_out, uint32_t * size);
 int synthesis_square(float frequency, float *data_out);
+int synthesis_square_trans(int trans, float *data_out);
 int synthesis_rampUp(float *data_out);
 int synthesis_rampDown(float *data_out);
 int synthesis_DC(float *data_out);
@@ -15,6 +15,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "redpitaya/rp.h"
 #include "common.h"
@@ -25,12 +26,21 @@ static volatile generate_control_t *generate = NULL;
 static volatile int32_t *data_chA = NULL;
 static volatile int32_t *data_chB = NULL;
 
+/* Copy of the DAC buffers content, only changed regions are uploaded */
+static uint32_t shadow_chA[BUFFER_LENGTH];
+static uint32_t shadow_chB[BUFFER_LENGTH];
+static bool shadow_valid_chA = false;
+static bool shadow_valid_chB = false;
+
 
 int generate_Init() {
 //  ECHECK(cmn_Init());
     ECHECK(cmn_Map(GENERATE_BASE_SIZE, GENERATE_BASE_ADDR, (void **) &generate));
     data_chA = (int32_t *) ((char *) generate + (CHA_DATA_OFFSET));
     data_chB = (int32_t *) ((char *) generate + (CHB_DATA_OFFSET));
+    /* buffer content is unknown until first complete upload */
+    shadow_valid_chA = false;
+    shadow_valid_chB = false;
     return RP_OK;
 }
 
@@ -222,22 +232,106 @@ int generate_Synchronise() {
     return RP_OK;
 }
 
-int generate_writeData(rp_channel_t channel, float *data, uint32_t start, uint32_t length) {
+/**
+ * @brief Converts normalized voltage [-1, 1] to DAC counts.
+ *
+ * Equivalent of cmn_CnvVToCnt(DATA_BIT_LENGTH, v, AMPLITUDE_MAX, false, 0, 0, 0.0)
+ * for a whole buffer, written without calls and branches so that the compiler
+ * can vectorize it. Amplitude and offset are applied by FPGA.
+ *
+ * @param[in]  data   Normalized samples
+ * @param[out] cnts   DAC counts
+ * @param[in]  length Number of samples
+ */
+void generate_cnvVToCnt(const float *data, uint32_t *cnts, uint32_t length) {
+    const float scale = (float) (1 << DATA_BIT_LENGTH) / (2 * AMPLITUDE_MAX);
+    const float cnt_max = (float) ((1 << (DATA_BIT_LENGTH - 1)) - 1);
+    const float cnt_min = (float) -(1 << (DATA_BIT_LENGTH - 1));
+    const uint32_t mask = (1 << DATA_BIT_LENGTH) - 1;
+
+    for (uint32_t i = 0; i < length; i++) {
+        float v = data[i];
+        v = v > AMPLITUDE_MAX ? AMPLITUDE_MAX : v;
+        v = v < -AMPLITUDE_MAX ? -AMPLITUDE_MAX : v;
+        v *= scale;
+        /* round half away from zero, as round() does */
+        v += v < 0 ? -0.5f : 0.5f;
+        v = v > cnt_max ? cnt_max : v;
+        v = v < cnt_min ? cnt_min : v;
+        cnts[i] = (uint32_t) (int32_t) v & mask;
+    }
+}
+
+/**
+ * @brief Uploads DAC counts rotated by start samples.
+ *
+ * Buffer content is compared with the shadow copy and only changed spans
+ * are written, each as a contiguous block.
+ *
+ * @param[in] channel Channel A or B
+ * @param[in] cnts    BUFFER_LENGTH DAC counts
+ * @param[in] start   Rotation (phase) offset in samples
+ * @param[in] length  Wrap counter length
+ */
+int generate_writeCnts(rp_channel_t channel, const uint32_t *cnts, uint32_t start, uint32_t length) {
     volatile int32_t *dataOut;
+    uint32_t *shadow;
+    bool *valid;
     CHANNEL_ACTION(channel,
             dataOut = data_chA,
             dataOut = data_chB)
+    CHANNEL_ACTION(channel,
+            shadow = shadow_chA,
+            shadow = shadow_chB)
+    CHANNEL_ACTION(channel,
+            valid = &shadow_valid_chA,
+            valid = &shadow_valid_chB)
 
-    volatile ch_properties_t *properties;
-    ECHECK(getChannelPropertiesAddress(&properties, channel));
     generate_setWrapCounter(channel, length);
 
-    //rp_calib_params_t calib = calib_GetParams();
-    int dc_offs = 0;//channel == RP_CH_1 ? calib.be_ch1_dc_offs: calib.be_ch2_dc_offs;
-    uint32_t amp_max = 0; //channel == RP_CH_1 ? calib.be_ch1_fs: calib.be_ch2_fs;
-
-    for(int i = start; i < start+BUFFER_LENGTH; i++) {
-        dataOut[i % BUFFER_LENGTH] = cmn_CnvVToCnt(DATA_BIT_LENGTH, data[i-start], AMPLITUDE_MAX, false, amp_max, dc_offs, 0.0);
+    start %= BUFFER_LENGTH;
+    uint32_t i = 0;
+    while (i < BUFFER_LENGTH) {
+        /* skip unchanged samples */
+        if (*valid && shadow[i] == cnts[(i + BUFFER_LENGTH - start) % BUFFER_LENGTH]) {
+            i++;
+            continue;
+        }
+        /* find the end of changed span, not crossing the rotation boundary */
+        uint32_t end = i < start ? start : BUFFER_LENGTH;
+        const uint32_t *src = &cnts[(i + BUFFER_LENGTH - start) % BUFFER_LENGTH];
+        uint32_t n = 0;
+        while (i + n < end && (!*valid || shadow[i + n] != src[n])) {
+            n++;
+        }
+        memcpy(&shadow[i], src, n * sizeof(uint32_t));
+        for (uint32_t j = 0; j < n; j++) {
+            dataOut[i + j] = src[j];
+        }
+        i += n;
     }
+    *valid = true;
     return RP_OK;
 }
+
+/**
+ * @brief Forgets the shadow copy of a DAC buffer.
+ *
+ * The next upload writes the whole buffer. The buffer may have been written
+ * by someone else (another process, the applications' AWG modules, an FPGA
+ * reload), which the shadow copy of this process does not see.
+ *
+ * @param[in] channel Channel A or B
+ */
+int generate_invalidateShadow(rp_channel_t channel) {
+    CHANNEL_ACTION(channel,
+            shadow_valid_chA = false,
+            shadow_valid_chB = false)
+    return RP_OK;
+}
+
+int generate_writeData(rp_channel_t channel, float *data, uint32_t start, uint32_t length) {
+    static uint32_t cnts[BUFFER_LENGTH];
+    generate_cnvVToCnt(data, cnts, BUFFER_LENGTH);
+    return generate_writeCnts(channel, cnts, start, length);
+}
@@ -108,6 +108,9 @@ int generate_getBurstDelay(rp_channel_t channel, uint32_t *delay);
 int generate_simultaneousTrigger();
 int generate_Synchronise();
 
+void generate_cnvVToCnt(const float *data, uint32_t *cnts, uint32_t length);
+int generate_writeCnts(rp_channel_t channel, const uint32_t *cnts, uint32_t start, uint32_t length);
+int generate_invalidateShadow(rp_channel_t channel);
 int generate_writeData(rp_channel_t channel, float *data, uint32_t start, uint32_t length);
 
 #endif //__GENERATE_H
@@ -0,0 +1,328 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library long memory history module implementation
+ *
+ * Each level is a ring of entries. A pushed sample is an entry of level 0;
+ * every completed entry of a level is folded into the pending entry of the
+ * level above, which is completed after HISTORY_FANOUT of them. An entry of
+ * level k thus sums up span[k] = HISTORY_FANOUT^k samples, entry e of it
+ * samples e * span[k] to (e + 1) * span[k] - 1.
+ *
+ * A query point takes the entries of its level overlapping it, fewer than
+ * HISTORY_FANOUT + 2 as their span is no longer than the point, with the
+ * mean weighted by the overlap. Only the newest samples, not yet completed
+ * on that level, come from the levels below, up to HISTORY_FANOUT entries
+ * of each.
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "common.h"
+#include "acq_handler.h"
+#include "history.h"
+
+#define HISTORY_FANOUT  RP_HISTORY_FANOUT
+
+static const int ADC_BITS = 14;
+static const int ADC_BITS_MAK = 0x3FFF;
+
+typedef struct {
+    rp_history_point_t *ent;      /* ring of capacity entries */
+    uint64_t            count;    /* entries completed */
+    /* pending entry, from the entries of the level below */
+    int16_t             acc_min;
+    int16_t             acc_max;
+    float               acc_sum;
+    uint32_t            acc_n;
+} history_level_t;
+
+struct rp_history_s {
+    pthread_mutex_t  mutex;
+    uint32_t         mask;        /* capacity - 1 */
+    uint32_t         levels;
+    uint64_t         span[RP_HISTORY_LEVELS_MAX];
+    history_level_t  level[RP_HISTORY_LEVELS_MAX];
+    /* feeds from a ring */
+    bool             synced;
+    uint32_t         wr_ptr;      /* last sample taken */
+    struct timespec  fed;
+    uint32_t         overruns;
+};
+
+typedef struct {
+    int16_t min;
+    int16_t max;
+    double  sum;
+    double  n;
+} history_agg_t;
+
+
+/* Appends an entry to level k, completing the levels above it may */
+static void history_Append(rp_history_t *h, uint32_t k, int16_t min, int16_t max, float mean) {
+    for (;;) {
+        history_level_t *l = &h->level[k];
+        rp_history_point_t *e = &l->ent[l->count++ & h->mask];
+        e->min = min;
+        e->max = max;
+        e->mean = mean;
+
+        if (++k == h->levels) {
+            return;
+        }
+        l = &h->level[k];
+        if (l->acc_n == 0) {
+            l->acc_min = min;
+            l->acc_max = max;
+            l->acc_sum = mean;
+        } else {
+            l->acc_min = MIN(l->acc_min, min);
+            l->acc_max = MAX(l->acc_max, max);
+            l->acc_sum += mean;
+        }
+        if (++l->acc_n < HISTORY_FANOUT) {
+            return;
+        }
+        min = l->acc_min;
+        max = l->acc_max;
+        mean = l->acc_sum / HISTORY_FANOUT;
+        l->acc_n = 0;
+    }
+}
+
+/* First entry of level k still in its ring */
+static uint64_t history_First(const rp_history_t *h, uint32_t k) {
+    uint64_t count = h->level[k].count;
+    return count > h->mask + 1 ? count - (h->mask + 1) : 0;
+}
+
+/* Folds samples a to b - 1 into agg from level k on */
+static void history_Fold(const rp_history_t *h, uint64_t a, uint64_t b, uint32_t k, history_agg_t *agg) {
+    for (;; k--) {
+        const history_level_t *l = &h->level[k];
+        uint64_t span = h->span[k];
+        uint64_t last = MIN((b + span - 1) / span, l->count);
+
+        for (uint64_t e = a / span; e < last; e++) {
+            const rp_history_point_t *p = &l->ent[e & h->mask];
+            uint64_t w = MIN(b, (e + 1) * span) - MAX(a, e * span);
+            if (agg->n == 0) {
+                agg->min = p->min;
+                agg->max = p->max;
+            } else {
+                agg->min = MIN(agg->min, p->min);
+                agg->max = MAX(agg->max, p->max);
+            }
+            agg->sum += (double) p->mean * w;
+            agg->n += w;
+        }
+        a = MAX(a, last * span);
+        if (a >= b || k == 0) {
+            return;
+        }
+    }
+}
+
+/* Takes the write pointer of a ring, returns the samples written since the
+ * last call and the first of them in pos; 0 on a resync */
+static uint32_t history_Pending(rp_history_t *h, uint32_t wr_ptr, uint32_t ring_size, double rate, uint32_t *pos) {
+    struct timespec now;
+    uint32_t size = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&h->mutex);
+    if (h->synced) {
+        double elapsed = (now.tv_sec - h->fed.tv_sec) + (now.tv_nsec - h->fed.tv_nsec) * 1e-9;
+        size = (wr_ptr + ring_size - h->wr_ptr) % ring_size;
+        *pos = (h->wr_ptr + 1) % ring_size;
+        if (size && elapsed * rate >= ring_size) {
+            h->overruns++;
+            size = 0;
+        }
+    }
+    h->synced = true;
+    h->wr_ptr = wr_ptr;
+    h->fed = now;
+    pthread_mutex_unlock(&h->mutex);
+    return size;
+}
+
+int history_Create(uint32_t capacity, uint32_t levels, rp_history_t **history) {
+    uint32_t cap = HISTORY_CAPACITY_MIN;
+
+    if (levels == 0 || levels > RP_HISTORY_LEVELS_MAX || capacity > (1u << 31)) {
+        return RP_EOOR;
+    }
+    while (cap < capacity) {
+        cap <<= 1;
+    }
+
+    rp_history_t *h = calloc(1, sizeof(rp_history_t));
+    if (h == NULL) {
+        return RP_EOOR;
+    }
+    pthread_mutex_init(&h->mutex, NULL);
+    h->mask = cap - 1;
+    h->levels = levels;
+    for (uint32_t k = 0; k < levels; k++) {
+        h->span[k] = k ? h->span[k - 1] * HISTORY_FANOUT : 1;
+        h->level[k].ent = malloc(cap * sizeof(rp_history_point_t));
+        if (h->level[k].ent == NULL) {
+            history_Destroy(h);
+            return RP_EOOR;
+        }
+    }
+    *history = h;
+    return RP_OK;
+}
+
+int history_Destroy(rp_history_t *history) {
+    if (history == NULL) {
+        return RP_OK;
+    }
+    for (uint32_t k = 0; k < history->levels; k++) {
+        free(history->level[k].ent);
+    }
+    pthread_mutex_destroy(&history->mutex);
+    free(history);
+    return RP_OK;
+}
+
+int history_Reset(rp_history_t *history) {
+    pthread_mutex_lock(&history->mutex);
+    for (uint32_t k = 0; k < history->levels; k++) {
+        history->level[k].count = 0;
+        history->level[k].acc_n = 0;
+    }
+    history->synced = false;
+    history->overruns = 0;
+    pthread_mutex_unlock(&history->mutex);
+    return RP_OK;
+}
+
+int history_Push(rp_history_t *history, const int16_t *samples, uint32_t size) {
+    pthread_mutex_lock(&history->mutex);
+    for (uint32_t i = 0; i < size; i++) {
+        history_Append(history, 0, samples[i], samples[i], samples[i]);
+    }
+    pthread_mutex_unlock(&history->mutex);
+    return RP_OK;
+}
+
+int history_FeedRing(rp_history_t *history, const volatile uint32_t *ring, uint32_t ring_size,
+                     uint32_t wr_ptr, double rate) {
+    int16_t buf[HISTORY_CHUNK];
+    uint32_t pos, n;
+
+    if (ring_size == 0 || wr_ptr >= ring_size) {
+        return RP_EOOR;
+    }
+    uint32_t size = history_Pending(history, wr_ptr, ring_size, rate, &pos);
+    for (; size; size -= n) {
+        n = MIN(size, HISTORY_CHUNK);
+        for (uint32_t i = 0; i < n; i++) {
+            buf[i] = cmn_CalibCnts(ADC_BITS, ring[(pos + i) % ring_size] & ADC_BITS_MAK, 0);
+        }
+        history_Push(history, buf, n);
+        pos = (pos + n) % ring_size;
+    }
+    return RP_OK;
+}
+
+int history_FeedAcq(rp_history_t *ch1, rp_history_t *ch2) {
+    rp_history_t *ch[] = { ch1, ch2 };
+    int16_t buf[HISTORY_CHUNK];
+    uint32_t wr_ptr, pos, n;
+    float rate;
+
+    ECHECK(acq_GetWritePointer(&wr_ptr));
+    ECHECK(acq_GetSamplingRateHz(&rate));
+    for (rp_channel_t c = RP_CH_1; c <= RP_CH_2; c++) {
+        if (ch[c] == NULL) {
+            continue;
+        }
+        uint32_t size = history_Pending(ch[c], wr_ptr, ADC_BUFFER_SIZE, rate, &pos);
+        for (; size; size -= n) {
+            n = MIN(size, HISTORY_CHUNK);
+            ECHECK(acq_GetDataRaw(c, pos, &n, buf));
+            history_Push(ch[c], buf, n);
+            pos = (pos + n) % ADC_BUFFER_SIZE;
+        }
+    }
+    return RP_OK;
+}
+
+int history_Resync(rp_history_t *history) {
+    pthread_mutex_lock(&history->mutex);
+    history->synced = false;
+    pthread_mutex_unlock(&history->mutex);
+    return RP_OK;
+}
+
+int history_GetRange(rp_history_t *history, uint64_t *first, uint64_t *end) {
+    pthread_mutex_lock(&history->mutex);
+    uint32_t top = history->levels - 1;
+    *first = history_First(history, top) * history->span[top];
+    *end = history->level[0].count;
+    pthread_mutex_unlock(&history->mutex);
+    return RP_OK;
+}
+
+int history_GetOverruns(rp_history_t *history, uint32_t *overruns) {
+    pthread_mutex_lock(&history->mutex);
+    *overruns = history->overruns;
+    pthread_mutex_unlock(&history->mutex);
+    return RP_OK;
+}
+
+int history_Query(rp_history_t *history, uint64_t start, uint64_t end,
+                  rp_history_point_t *points, uint32_t *size, uint64_t *step) {
+    rp_history_t *h = history;
+    uint32_t k = 0;
+
+    pthread_mutex_lock(&h->mutex);
+    end = MIN(end, h->level[0].count);
+    if (*size == 0 || start >= end) {
+        pthread_mutex_unlock(&h->mutex);
+        return RP_EOOR;
+    }
+
+    /* the finest level keeping start ... */
+    while (history_First(h, k) * h->span[k] > start) {
+        if (++k == h->levels) {
+            pthread_mutex_unlock(&h->mutex);
+            return RP_EOOR;
+        }
+    }
+    /* ... with its entries no longer than a point */
+    uint64_t len = end - start;
+    *size = MIN(*size, len);
+    while (k + 1 < h->levels && h->span[k + 1] <= len / *size) {
+        k++;
+    }
+
+    for (uint32_t j = 0; j < *size; j++) {
+        history_agg_t agg = { 0 };
+        uint64_t a = start + len / *size * j + len % *size * j / *size;
+        uint64_t b = start + len / *size * (j + 1) + len % *size * (j + 1) / *size;
+
+        history_Fold(h, a, b, k, &agg);
+        points[j].min = agg.min;
+        points[j].max = agg.max;
+        points[j].mean = agg.sum / agg.n;
+    }
+    *step = h->span[k];
+    pthread_mutex_unlock(&h->mutex);
+    return RP_OK;
+}
@@ -0,0 +1,42 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library long memory history module interface
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __HISTORY_H
+#define __HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "redpitaya/rp.h"
+
+/* Least entries per level */
+#define HISTORY_CAPACITY_MIN    64
+
+/* Samples converted at a time by the feeds */
+#define HISTORY_CHUNK           1024
+
+int history_Create(uint32_t capacity, uint32_t levels, rp_history_t **history);
+int history_Destroy(rp_history_t *history);
+int history_Reset(rp_history_t *history);
+int history_Push(rp_history_t *history, const int16_t *samples, uint32_t size);
+int history_FeedRing(rp_history_t *history, const volatile uint32_t *ring, uint32_t ring_size,
+                     uint32_t wr_ptr, double rate);
+int history_FeedAcq(rp_history_t *ch1, rp_history_t *ch2);
+int history_Resync(rp_history_t *history);
+int history_GetRange(rp_history_t *history, uint64_t *first, uint64_t *end);
+int history_GetOverruns(rp_history_t *history, uint32_t *overruns);
+int history_Query(rp_history_t *history, uint64_t start, uint64_t end,
+                  rp_history_point_t *points, uint32_t *size, uint64_t *step);
+
+#endif //__HISTORY_H
@@ -13,7 +13,9 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "version.h"
 #include "common.h"
@@ -24,6 +26,11 @@
 #include "calib.h"
 #include "generate.h"
 #include "gen_handler.h"
+#include "xadc.h"
+#include "dseq.h"
+#include "perf.h"
+#include "history.h"
+#include "spec_zoom.h"
 
 static char version[50];
 
@@ -57,6 +64,8 @@ int rp_CalibInit()
 
 int rp_Release()
 {
+    ECHECK(xadc_Release());
+    ECHECK(dseq_Stop());
     ECHECK(osc_Release())
     ECHECK(generate_Release());
     ECHECK(ams_Release());
@@ -131,6 +140,12 @@ const char* rp_GetError(int errorCode) {
             return "Failed to read from the bus";
         case RP_EFWB:
             return "Failed to write to the bus";
+        case RP_EMNC:
+            return "Extension module not connected";
+        case RP_ETMO:
+            return "Operation timed out";
+        case RP_EIIO:
+            return "Failed to access IIO device";
         default:
             return "Unknown error";
     }
@@ -181,6 +196,11 @@ int rp_CalibrationWriteParams(rp_calib_params_t calib_params) {
     return calib_WriteParams(calib_params);
 }
 
+int rp_CalibrationGetLastStat(rp_calib_stat_t *stat) {
+    *stat = calib_GetLastStat();
+    return RP_OK;
+}
+
 /**
  * Identification
  */
@@ -259,6 +279,7 @@ int rp_GPIOpGetState(uint32_t *state) {
  */
 
 int rp_DpinReset() {
+    ECHECK(dseq_Stop());
     iowrite32(0, &hk->ex_cd_p);
     iowrite32(0, &hk->ex_cd_n);
     iowrite32(0, &hk->ex_co_p);
@@ -346,6 +367,249 @@ int rp_DpinGetState(rp_dpin_t pin, rp_pinState_t* state) {
 }
 
 
+/**
+ * Digital port methods
+ */
+
+static int rp_DportGetRegs(rp_dport_t port, volatile uint32_t **dir, volatile uint32_t **out, volatile uint32_t **in) {
+    switch (port) {
+        case RP_DPORT_LED:
+            // LEDs are outputs only
+            *dir = NULL;
+            *out = &hk->led_control;
+            *in  = &hk->led_control;
+            break;
+        case RP_DPORT_DIO_P:
+            *dir = &hk->ex_cd_p;
+            *out = &hk->ex_co_p;
+            *in  = &hk->ex_ci_p;
+            break;
+        case RP_DPORT_DIO_N:
+            *dir = &hk->ex_cd_n;
+            *out = &hk->ex_co_n;
+            *in  = &hk->ex_ci_n;
+            break;
+        default:
+            return RP_EPN;
+    }
+    return RP_OK;
+}
+
+int rp_DportSetDirection(rp_dport_t port, uint32_t mask, uint32_t direction) {
+    volatile uint32_t *dir, *out, *in;
+    ECHECK(rp_DportGetRegs(port, &dir, &out, &in));
+    VALIDATE_BITS(mask, EX_CD_P_MASK);
+    if (dir == NULL) {
+        return (mask & ~direction) ? RP_ELID : RP_OK;
+    }
+    uint32_t tmp = ioread32(dir);
+    iowrite32((tmp & ~mask) | (direction & mask), dir);
+    return RP_OK;
+}
+
+int rp_DportGetDirection(rp_dport_t port, uint32_t* direction) {
+    volatile uint32_t *dir, *out, *in;
+    ECHECK(rp_DportGetRegs(port, &dir, &out, &in));
+    *direction = dir ? ioread32(dir) & EX_CD_P_MASK : LED_CONTROL_MASK;
+    return RP_OK;
+}
+
+int rp_DportSetState(rp_dport_t port, uint32_t mask, uint32_t state) {
+    volatile uint32_t *dir, *out, *in;
+    ECHECK(rp_DportGetRegs(port, &dir, &out, &in));
+    VALIDATE_BITS(mask, EX_CO_P_MASK);
+    if (dir && (mask & ~ioread32(dir))) {
+        return RP_EWIP;
+    }
+    uint32_t tmp = ioread32(out);
+    iowrite32((tmp & ~mask) | (state & mask), out);
+    return RP_OK;
+}
+
+int rp_DportGetState(rp_dport_t port, uint32_t* state) {
+    volatile uint32_t *dir, *out, *in;
+    ECHECK(rp_DportGetRegs(port, &dir, &out, &in));
+    *state = ioread32(in) & EX_CI_P_MASK;
+    return RP_OK;
+}
+
+int rp_DseqStart(rp_dport_t port, const rp_dseq_step_t* steps, uint32_t count, uint32_t repeat) {
+    volatile uint32_t *dir, *out, *in;
+    uint32_t mask = 0;
+    ECHECK(rp_DportGetRegs(port, &dir, &out, &in));
+    for (uint32_t i = 0; i < count; i++) {
+        mask |= steps[i].mask;
+    }
+    VALIDATE_BITS(mask, EX_CO_P_MASK);
+    if (dir && (mask & ~ioread32(dir))) {
+        return RP_EWIP;
+    }
+    return dseq_Start(out, steps, count, repeat);
+}
+
+int rp_DseqStop() {
+    return dseq_Stop();
+}
+
+int rp_DseqIsRunning(bool* running) {
+    return dseq_IsRunning(running);
+}
+
+int rp_DseqGetStat(rp_dseq_stat_t* stat) {
+    return dseq_GetStat(stat);
+}
+
+/**
+ * Latency tracing methods
+ */
+
+int rp_PerfEnable(bool enable) {
+    return perf_Enable(enable) ? RP_EOMD : RP_OK;
+}
+
+int rp_PerfIsEnabled(bool* enable) {
+    return perf_IsEnabled(enable) ? RP_EOMD : RP_OK;
+}
+
+int rp_PerfReset() {
+    return perf_Reset() ? RP_EOMD : RP_OK;
+}
+
+uint64_t rp_PerfNow() {
+    return perf_Now();
+}
+
+void rp_PerfStamp(rp_perf_stage_t stage, uint64_t start) {
+    perf_Stamp(stage, start);
+}
+
+uint64_t rp_PerfGetTrigger() {
+    return perf_GetTrigger();
+}
+
+int rp_PerfGetStat(rp_perf_stage_t stage, rp_perf_stat_t* stat) {
+    if (stage >= RP_PERF_STAGES) {
+        return RP_EOOR;
+    }
+    return perf_GetStat(stage, stat) ? RP_EOMD : RP_OK;
+}
+
+int rp_PerfGetTrace(rp_perf_rec_t* recs, uint32_t* size) {
+    return perf_GetTrace(recs, size) ? RP_EOMD : RP_OK;
+}
+
+const char* rp_PerfStageName(rp_perf_stage_t stage) {
+    return perf_StageName(stage);
+}
+
+/**
+ * Long memory history methods
+ */
+
+int rp_HistoryCreate(uint32_t capacity, uint32_t levels, rp_history_t** history) {
+    return history_Create(capacity, levels, history);
+}
+
+int rp_HistoryDestroy(rp_history_t* history) {
+    return history_Destroy(history);
+}
+
+int rp_HistoryReset(rp_history_t* history) {
+    return history_Reset(history);
+}
+
+int rp_HistoryPush(rp_history_t* history, const int16_t* samples, uint32_t size) {
+    return history_Push(history, samples, size);
+}
+
+int rp_HistoryFeedRing(rp_history_t* history, const volatile uint32_t* ring, uint32_t ring_size,
+                       uint32_t wr_ptr, double rate) {
+    return history_FeedRing(history, ring, ring_size, wr_ptr, rate);
+}
+
+int rp_HistoryFeedAcq(rp_history_t* ch1, rp_history_t* ch2) {
+    return history_FeedAcq(ch1, ch2);
+}
+
+int rp_HistoryResync(rp_history_t* history) {
+    return history_Resync(history);
+}
+
+int rp_HistoryGetRange(rp_history_t* history, uint64_t* first, uint64_t* end) {
+    return history_GetRange(history, first, end);
+}
+
+int rp_HistoryGetOverruns(rp_history_t* history, uint32_t* overruns) {
+    return history_GetOverruns(history, overruns);
+}
+
+int rp_HistoryQuery(rp_history_t* history, uint64_t start, uint64_t end,
+                    rp_history_point_t* points, uint32_t* size, uint64_t* step) {
+    return history_Query(history, start, end, points, size, step);
+}
+
+/**
+ * Zoom FFT methods
+ */
+
+int rp_ZoomCreate(double fs, double f_center, double span, uint32_t fft_len, rp_zoom_t** zoom) {
+    rp_zoom_t *z = malloc(sizeof(rp_zoom_t));
+    if (z == NULL) {
+        return RP_EOOR;
+    }
+    if (fft_len > INT32_MAX || rp_spectr_zoom_init(z, fs, f_center, span, fft_len) < 0) {
+        free(z);
+        return RP_EOOR;
+    }
+    *zoom = z;
+    return RP_OK;
+}
+
+int rp_ZoomDestroy(rp_zoom_t* zoom) {
+    if (zoom != NULL) {
+        rp_spectr_zoom_clean(zoom);
+        free(zoom);
+    }
+    return RP_OK;
+}
+
+int rp_ZoomGetSpan(rp_zoom_t* zoom, double* span, double* bin) {
+    *span = zoom->span;
+    *bin = zoom->fs_out / zoom->fft_len;
+    return RP_OK;
+}
+
+int rp_ZoomReset(rp_zoom_t* zoom) {
+    rp_spectr_zoom_reset(zoom);
+    return RP_OK;
+}
+
+int rp_ZoomProcess(rp_zoom_t* zoom, const int16_t* samples, uint32_t size) {
+    if (size > INT32_MAX || rp_spectr_zoom_process(zoom, samples, size) < 0) {
+        return RP_EOOR;
+    }
+    return RP_OK;
+}
+
+int rp_ZoomFeedAcq(rp_zoom_t* zoom, rp_channel_t channel) {
+    return rp_spectr_zoom_feed_acq(zoom, channel);
+}
+
+int rp_ZoomGetSpectrum(rp_zoom_t* zoom, float* freq, float* amp, uint32_t* size, uint32_t* averages) {
+    uint32_t bins = zoom->fft_len / 2;
+    if (*size < bins) {
+        *size = bins;
+        return RP_BTS;
+    }
+    int n = rp_spectr_zoom_spectrum(zoom, freq, amp);
+    *size = n ? bins : 0;
+    if (averages != NULL) {
+        *averages = n;
+    }
+    return RP_OK;
+}
+
+
 /**
  * Digital loop
  */
@@ -366,9 +630,9 @@ int rp_ApinReset() {
 
 int rp_ApinGetValue(rp_apin_t pin, float* value) {
     if (pin <= RP_AOUT3) {
-        rp_AOpinGetValue(pin-RP_AOUT0, value);
+        ECHECK(rp_AOpinGetValue(pin-RP_AOUT0, value));
     } else if (pin <= RP_AIN3) {
-        rp_AIpinGetValue(pin-RP_AIN0, value);
+        ECHECK(rp_AIpinGetValue(pin-RP_AIN0, value));
     } else {
         return RP_EPN;
     }
@@ -377,9 +641,9 @@ int rp_ApinGetValue(rp_apin_t pin, float* value) {
 
 int rp_ApinGetValueRaw(rp_apin_t pin, uint32_t* value) {
     if (pin <= RP_AOUT3) {
-        rp_AOpinGetValueRaw(pin-RP_AOUT0, value);
+        ECHECK(rp_AOpinGetValueRaw(pin-RP_AOUT0, value));
     } else if (pin <= RP_AIN3) {
-        rp_AIpinGetValueRaw(pin-RP_AIN0, value);
+        ECHECK(rp_AIpinGetValueRaw(pin-RP_AIN0, value));
     } else {
         return RP_EPN;
     }
@@ -427,25 +691,52 @@ int rp_ApinGetRange(rp_apin_t pin, float* min_val, float* max_val) {
  */
 
 int rp_AIpinGetValueRaw(int unsigned pin, uint32_t* value) {
-    FILE *fp;
-    switch (pin) {
-        case 0:  fp = fopen ("/sys/devices/soc0/amba_pl/83c00000.xadc_wiz/iio:device1/in_voltage11_vaux8_raw", "r");  break;
-        case 1:  fp = fopen ("/sys/devices/soc0/amba_pl/83c00000.xadc_wiz/iio:device1/in_voltage9_vaux0_raw" , "r");  break;
-        case 2:  fp = fopen ("/sys/devices/soc0/amba_pl/83c00000.xadc_wiz/iio:device1/in_voltage10_vaux1_raw", "r");  break;
-        case 3:  fp = fopen ("/sys/devices/soc0/amba_pl/83c00000.xadc_wiz/iio:device1/in_voltage12_vaux9_raw", "r");  break;
-        default:
-            return RP_EPN;
-    }
-    int r = !fscanf (fp, "%d", value);
-    fclose(fp);
-    return r;
+    return xadc_GetValueRaw(pin, value);
 }
 
 int rp_AIpinGetValue(int unsigned pin, float* value) {
     uint32_t value_raw;
-    int result = rp_AIpinGetValueRaw(pin, &value_raw);
+    ECHECK(rp_AIpinGetValueRaw(pin, &value_raw));
     *value = (((float)value_raw / ANALOG_IN_MAX_VAL_INTEGER) * (ANALOG_IN_MAX_VAL - ANALOG_IN_MIN_VAL)) + ANALOG_IN_MIN_VAL;
-    return result;
+    return RP_OK;
+}
+
+int rp_AIstreamSetPaths(const char* sysfs_dir, const char* dev_path) {
+    return xadc_SetPaths(sysfs_dir, dev_path);
+}
+
+int rp_AIstreamStart(float rate) {
+    return xadc_StreamStart(rate);
+}
+
+int rp_AIstreamStop() {
+    return xadc_StreamStop();
+}
+
+int rp_AIstreamGetRate(float* rate) {
+    return xadc_StreamGetRate(rate);
+}
+
+int rp_AIstreamGetDataRaw(int unsigned pin, uint32_t* buffer, uint32_t* size, int64_t* timestamp) {
+    return xadc_StreamGetDataRaw(pin, buffer, size, timestamp);
+}
+
+int rp_AIstreamGetData(int unsigned pin, float* buffer, uint32_t* size, int64_t* timestamp) {
+    // raw values are converted in place
+    ECHECK(xadc_StreamGetDataRaw(pin, (uint32_t *)buffer, size, timestamp));
+    for (uint32_t i = 0; i < *size; i++) {
+        uint32_t raw;
+        memcpy(&raw, &buffer[i], sizeof(raw));
+        buffer[i] = (((float)raw / ANALOG_IN_MAX_VAL_INTEGER) * (ANALOG_IN_MAX_VAL - ANALOG_IN_MIN_VAL)) + ANALOG_IN_MIN_VAL;
+    }
+    return RP_OK;
+}
+
+int rp_AIstreamGetAverage(int unsigned pin, uint32_t count, float* value) {
+    float value_raw;
+    ECHECK(xadc_StreamGetAverageRaw(pin, count, &value_raw));
+    *value = ((value_raw / ANALOG_IN_MAX_VAL_INTEGER) * (ANALOG_IN_MAX_VAL - ANALOG_IN_MIN_VAL)) + ANALOG_IN_MIN_VAL;
+    return RP_OK;
 }
 
 
@@ -772,6 +1063,18 @@ int rp_GenGetArbWaveform(rp_channel_t channel, float *waveform, uint32_t *length
     return gen_getArbWaveform(channel, waveform, length);
 }
 
+int rp_GenArbWaveformRange(rp_channel_t channel, const float *waveform, uint32_t offset, uint32_t length) {
+    return gen_setArbWaveformRange(channel, waveform, offset, length);
+}
+
+int rp_GenArbWaveformRaw(rp_channel_t channel, const int16_t *waveform, uint32_t offset, uint32_t length) {
+    return gen_setArbWaveformRaw(channel, waveform, offset, length);
+}
+
+int rp_GenGetArbWaveformRaw(rp_channel_t channel, int16_t *waveform, uint32_t *length) {
+    return gen_getArbWaveformRaw(channel, waveform, length);
+}
+
 int rp_GenDutyCycle(rp_channel_t channel, float ratio) {
     return gen_setDutyCycle(channel, ratio);
 }
@@ -24,6 +24,7 @@
 //#include "spectrometerApp.h"
 #include "spec_fpga.h"
 #include "kiss_fftr.h"
+#include "kiss_fft_plan.h"
 
 extern float g_spectr_fpga_adc_max_v;
 extern const int c_spectr_fpga_adc_bits;
@@ -141,7 +142,7 @@ int rp_spectr_fft_init()
     rp_kiss_fft_out2 =
         (kiss_fft_cpx *)malloc(SPECTR_FPGA_SIG_LEN * sizeof(kiss_fft_cpx));
 
-    rp_kiss_fft_cfg = kiss_fftr_alloc(SPECTR_FPGA_SIG_LEN, 0, NULL, NULL);
+    rp_kiss_fft_cfg = kiss_fftr_plan(SPECTR_FPGA_SIG_LEN, 0);
 
     return 0;
 }
@@ -157,10 +158,8 @@ int rp_spectr_fft_clean()
         free(rp_kiss_fft_out2);
         rp_kiss_fft_out2 = NULL;
     }
-    if(rp_kiss_fft_cfg) {
-        free(rp_kiss_fft_cfg);
-        rp_kiss_fft_cfg = NULL;
-    }
+    /* shared plan, not ours to free */
+    rp_kiss_fft_cfg = NULL;
     return 0;
 }
 
@@ -233,7 +233,6 @@ float spectr_fpga_cnv_cnt_to_v(int cnts);
 
 /* debugging - will be removed */
 extern spectr_fpga_reg_mem_t *g_spectr_fpga_reg_mem;
-extern                int  g_spectr_fpga_mem_fd;
 int __spectr_fpga_cleanup_mem(void);
 
 #endif /* __FPGA_H*/
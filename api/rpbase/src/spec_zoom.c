@@ -0,0 +1,412 @@
+/**
+ * $Id$
+ *
+ * @brief Red Pitaya Spectrum Analyzer zoom FFT (digital down-conversion).
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "common.h"
+#include "acq_handler.h"
+#include "spec_zoom.h"
+#include "kiss_fft.h"
+#include "kiss_fft_plan.h"
+
+/* Halfband Kaiser window, -93 dB stop band from 3/8 of the input rate */
+#define SPECTR_ZOOM_HB_BETA     9.5
+
+#if SPECTR_ZOOM_CIC_ORDER != 4
+#error "rp_spectr_zoom_process() integrates in 4 stages"
+#endif
+
+#define HB_CENTER ((SPECTR_ZOOM_HB_TAPS - 1) / 2)
+#define HB_COEFS  ((SPECTR_ZOOM_HB_TAPS + 1) / 4)
+
+/* Zeroth order modified Bessel function of the first kind */
+static double rp_spectr_zoom_i0(double x)
+{
+    double sum = 1, term = 1;
+    int k;
+
+    for(k = 1; k < 50 && term > sum * 1e-17; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/* Windowed sinc halfband, normalized to unit DC gain */
+static void rp_spectr_zoom_hb_design(double *coef)
+{
+    double sum = 0;
+    int j;
+
+    for(j = 0; j < HB_COEFS; j++) {
+        int m = 2 * j + 1;
+        double r = (double)m / HB_CENTER;
+        coef[j] = sin(M_PI * m / 2) / (M_PI * m) *
+            rp_spectr_zoom_i0(SPECTR_ZOOM_HB_BETA * sqrt(1 - r * r)) /
+            rp_spectr_zoom_i0(SPECTR_ZOOM_HB_BETA);
+        sum += 2 * coef[j];
+    }
+    for(j = 0; j < HB_COEFS; j++)
+        coef[j] *= 0.5 / sum;
+}
+
+/* Amplitude response of the halfband at f relative to its input rate */
+static double rp_spectr_zoom_hb_resp(const double *coef, double f)
+{
+    double h = 0.5;
+    int j;
+
+    for(j = 0; j < HB_COEFS; j++)
+        h += 2 * coef[j] * cos(2 * M_PI * (2 * j + 1) * f);
+    return fabs(h);
+}
+
+/* Amplitude response of the CIC at f relative to its input rate */
+static double rp_spectr_zoom_cic_resp(int dec, double f)
+{
+    double num = sin(M_PI * f * dec), den = dec * sin(M_PI * f);
+
+    if(fabs(den) < 1e-300)
+        return 1;
+    return pow(fabs(num / den), SPECTR_ZOOM_CIC_ORDER);
+}
+
+static void rp_spectr_zoom_set_fine(rp_spectr_zoom_t *zoom)
+{
+    zoom->fine_rot[0] = cos(2 * M_PI * zoom->fine_phase);
+    zoom->fine_rot[1] = -sin(2 * M_PI * zoom->fine_phase);
+}
+
+/* Restarts the filters, keeping the averaged spectra */
+static void rp_spectr_zoom_restart(rp_spectr_zoom_t *zoom)
+{
+    zoom->nco_phase = 0;
+    memset(zoom->integ, 0, sizeof(zoom->integ));
+    memset(zoom->comb, 0, sizeof(zoom->comb));
+    zoom->cic_cnt = 0;
+    zoom->fine_phase = 0;
+    zoom->fine_cnt = 0;
+    rp_spectr_zoom_set_fine(zoom);
+    memset(zoom->hb, 0, sizeof(zoom->hb));
+    /* the halfband chain delays by less than its taps at the output rate */
+    zoom->settle = SPECTR_ZOOM_HB_TAPS + 1;
+    zoom->buf_len = 0;
+}
+
+void rp_spectr_zoom_reset(rp_spectr_zoom_t *zoom)
+{
+    rp_spectr_zoom_restart(zoom);
+    zoom->averages = 0;
+    if(zoom->power)
+        memset(zoom->power, 0, zoom->fft_len / 2 * sizeof(double));
+}
+
+int rp_spectr_zoom_init(rp_spectr_zoom_t *zoom, double fs, double f_center,
+                        double span, int fft_len)
+{
+    double ratio, residual, wsum = 0;
+    int i, s;
+
+    memset(zoom, 0, sizeof(rp_spectr_zoom_t));
+    if(fs <= 0 || span <= 0 || fft_len < 64 || fft_len > 65536 ||
+       (fft_len & (fft_len - 1)) ||
+       f_center - span / 2 < 0 || f_center + span / 2 > fs / 2) {
+        fprintf(stderr, "rp_spectr_zoom_init() invalid parameters\n");
+        return -1;
+    }
+
+    /* Largest decimation with at least the requested span, the CIC takes
+     * as much of it as it can */
+    ratio = fs / (2 * span);
+    for(s = SPECTR_ZOOM_HB_MIN; s < SPECTR_ZOOM_HB_MAX; s++) {
+        if(ratio / (1 << s) <= SPECTR_ZOOM_CIC_MAX_DEC)
+            break;
+    }
+    zoom->cic_dec = (int)floor(ratio / (1 << s));
+    zoom->hb_stages = s;
+    if(zoom->cic_dec < 1 || ratio / (1 << s) > SPECTR_ZOOM_CIC_MAX_DEC) {
+        fprintf(stderr, "rp_spectr_zoom_init() span out of range\n");
+        return -1;
+    }
+    zoom->fs = fs;
+    zoom->f_center = f_center;
+    zoom->fs_out = fs / zoom->cic_dec / (1 << s);
+    zoom->span = zoom->fs_out / 2;
+    zoom->fft_len = fft_len;
+
+    for(i = 0; i < SPECTR_ZOOM_NCO_LEN; i++) {
+        zoom->nco[i] = (int32_t)lrint(cos(2 * M_PI * i / SPECTR_ZOOM_NCO_LEN) *
+                                      (1 << SPECTR_ZOOM_NCO_BITS));
+    }
+    zoom->nco_step = (uint32_t)lrint(f_center / fs * SPECTR_ZOOM_NCO_LEN) %
+        SPECTR_ZOOM_NCO_LEN;
+    residual = f_center - zoom->nco_step * fs / SPECTR_ZOOM_NCO_LEN;
+    zoom->cic_scale = 1.0 / (pow(zoom->cic_dec, SPECTR_ZOOM_CIC_ORDER) *
+                             (1 << SPECTR_ZOOM_NCO_BITS));
+    zoom->fine_inc = residual / (fs / zoom->cic_dec);
+    zoom->fine_step[0] = cos(2 * M_PI * zoom->fine_inc);
+    zoom->fine_step[1] = -sin(2 * M_PI * zoom->fine_inc);
+    rp_spectr_zoom_hb_design(zoom->hb_coef);
+
+    zoom->fft_cfg = kiss_fft_plan(fft_len, 0);
+    zoom->buf    = (double *)malloc(2 * fft_len * sizeof(double));
+    zoom->spec   = (double *)malloc(2 * fft_len * sizeof(double));
+    zoom->window = (double *)malloc(fft_len * sizeof(double));
+    zoom->corr   = (double *)malloc(fft_len / 2 * sizeof(double));
+    zoom->power  = (double *)malloc(fft_len / 2 * sizeof(double));
+    if(!zoom->fft_cfg || !zoom->buf || !zoom->spec || !zoom->window ||
+       !zoom->corr || !zoom->power) {
+        fprintf(stderr, "rp_spectr_zoom_init() can not allocate mem\n");
+        rp_spectr_zoom_clean(zoom);
+        return -1;
+    }
+
+    /* 4 term Blackman-Harris, -92 dB side lobes */
+    for(i = 0; i < fft_len; i++) {
+        double x = 2 * M_PI * i / fft_len;
+        zoom->window[i] = 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2 * x) -
+            0.01168 * cos(3 * x);
+        wsum += zoom->window[i];
+    }
+
+    /* Shown bins are the middle half of the FFT; their power is corrected
+     * for the filter responses and scaled to sine amplitude squared */
+    for(i = 0; i < fft_len / 2; i++) {
+        double f = (i - fft_len / 4) * zoom->fs_out / fft_len;
+        double h = rp_spectr_zoom_cic_resp(zoom->cic_dec, (f + residual) / fs);
+        double rate = fs / zoom->cic_dec;
+
+        for(s = 0; s < zoom->hb_stages; s++, rate /= 2)
+            h *= rp_spectr_zoom_hb_resp(zoom->hb_coef, f / rate);
+        zoom->corr[i] = 4 / (wsum * wsum) / (h * h);
+    }
+
+    rp_spectr_zoom_reset(zoom);
+    return 0;
+}
+
+void rp_spectr_zoom_clean(rp_spectr_zoom_t *zoom)
+{
+    /* fft_cfg is a shared plan */
+    free(zoom->buf);
+    free(zoom->spec);
+    free(zoom->window);
+    free(zoom->corr);
+    free(zoom->power);
+    memset(zoom, 0, sizeof(rp_spectr_zoom_t));
+}
+
+/* Windowed FFT of the buffer, power of the shown bins into the average */
+static void rp_spectr_zoom_fft(rp_spectr_zoom_t *zoom)
+{
+    int n = zoom->fft_len, i;
+
+    for(i = 0; i < n; i++) {
+        zoom->buf[2 * i]     *= zoom->window[i];
+        zoom->buf[2 * i + 1] *= zoom->window[i];
+    }
+    kiss_fft(zoom->fft_cfg, (kiss_fft_cpx *)zoom->buf, (kiss_fft_cpx *)zoom->spec);
+
+    for(i = 0; i < n / 2; i++) {
+        /* shown bin i is at offset i - n/4 from the centre */
+        int k = (i - n / 4 + n) & (n - 1);
+        double re = zoom->spec[2 * k], im = zoom->spec[2 * k + 1];
+        zoom->power[i] += (re * re + im * im) * zoom->corr[i];
+    }
+    zoom->averages++;
+    zoom->buf_len = 0;
+}
+
+/* One halfband input sample; returns 1 with the output in x on every
+ * second one */
+static inline int rp_spectr_zoom_hb_push(const double *coef,
+                                         rp_spectr_zoom_hb_t *hb, double *x)
+{
+    const double (*d)[2];
+    double re, im;
+    int j;
+
+    hb->pos = hb->pos ? hb->pos - 1 : SPECTR_ZOOM_HB_TAPS - 1;
+    hb->line[hb->pos][0] = hb->line[hb->pos + SPECTR_ZOOM_HB_TAPS][0] = x[0];
+    hb->line[hb->pos][1] = hb->line[hb->pos + SPECTR_ZOOM_HB_TAPS][1] = x[1];
+    hb->odd ^= 1;
+    if(!hb->odd)
+        return 0;
+
+    d = &hb->line[hb->pos];
+    re = 0.5 * d[HB_CENTER][0];
+    im = 0.5 * d[HB_CENTER][1];
+    for(j = 0; j < HB_COEFS; j++) {
+        int m = 2 * j + 1;
+        re += coef[j] * (d[HB_CENTER - m][0] + d[HB_CENTER + m][0]);
+        im += coef[j] * (d[HB_CENTER - m][1] + d[HB_CENTER + m][1]);
+    }
+    x[0] = re;
+    x[1] = im;
+    return 1;
+}
+
+/* One CIC output sample through the fine NCO and the halfbands */
+static void rp_spectr_zoom_push(rp_spectr_zoom_t *zoom, double re, double im)
+{
+    double x[2], *rot = zoom->fine_rot, *step = zoom->fine_step, r;
+    int s;
+
+    x[0] = re * rot[0] - im * rot[1];
+    x[1] = re * rot[1] + im * rot[0];
+    if(++zoom->fine_cnt == SPECTR_ZOOM_FINE_RENORM) {
+        zoom->fine_cnt = 0;
+        zoom->fine_phase += SPECTR_ZOOM_FINE_RENORM * zoom->fine_inc;
+        zoom->fine_phase -= floor(zoom->fine_phase);
+        rp_spectr_zoom_set_fine(zoom);
+    } else {
+        r      = rot[0] * step[0] - rot[1] * step[1];
+        rot[1] = rot[0] * step[1] + rot[1] * step[0];
+        rot[0] = r;
+    }
+
+    for(s = 0; s < zoom->hb_stages; s++) {
+        if(!rp_spectr_zoom_hb_push(zoom->hb_coef, &zoom->hb[s], x))
+            return;
+    }
+    if(zoom->settle > 0) {
+        zoom->settle--;
+        return;
+    }
+    zoom->buf[2 * zoom->buf_len]     = x[0];
+    zoom->buf[2 * zoom->buf_len + 1] = x[1];
+    if(++zoom->buf_len == zoom->fft_len)
+        rp_spectr_zoom_fft(zoom);
+}
+
+int rp_spectr_zoom_process(rp_spectr_zoom_t *zoom, const int16_t *in, int len)
+{
+    const int32_t *nco = zoom->nco;
+    const uint32_t mask = SPECTR_ZOOM_NCO_LEN - 1;
+    const uint32_t quarter = SPECTR_ZOOM_NCO_LEN / 4;
+    const uint32_t step = zoom->nco_step;
+    const int dec = zoom->cic_dec;
+    uint32_t ph = zoom->nco_phase;
+    int cnt = zoom->cic_cnt;
+    /* integrators in locals, the loop is the hot spot */
+    uint64_t i0 = zoom->integ[0][0], i1 = zoom->integ[0][1],
+             i2 = zoom->integ[0][2], i3 = zoom->integ[0][3];
+    uint64_t q0 = zoom->integ[1][0], q1 = zoom->integ[1][1],
+             q2 = zoom->integ[1][2], q3 = zoom->integ[1][3];
+    int n, c;
+
+    if(!zoom->buf) {
+        fprintf(stderr, "rp_spectr_zoom_process() not initialized\n");
+        return -1;
+    }
+
+    for(n = 0; n < len; n++) {
+        int64_t x = in[n];
+
+        /* x * exp(-j * phase) */
+        i0 += (uint64_t)(x * nco[ph]);
+        q0 += (uint64_t)(x * nco[(ph + quarter) & mask]);
+        ph = (ph + step) & mask;
+        i1 += i0; i2 += i1; i3 += i2;
+        q1 += q0; q2 += q1; q3 += q2;
+
+        if(++cnt == dec) {
+            uint64_t yi = i3, yq = q3, t;
+
+            cnt = 0;
+            for(c = 0; c < SPECTR_ZOOM_CIC_ORDER; c++) {
+                t = yi - zoom->comb[0][c];
+                zoom->comb[0][c] = yi;
+                yi = t;
+                t = yq - zoom->comb[1][c];
+                zoom->comb[1][c] = yq;
+                yq = t;
+            }
+            rp_spectr_zoom_push(zoom, (int64_t)yi * zoom->cic_scale,
+                                (int64_t)yq * zoom->cic_scale);
+        }
+    }
+
+    zoom->nco_phase = ph;
+    zoom->cic_cnt = cnt;
+    zoom->integ[0][0] = i0; zoom->integ[0][1] = i1;
+    zoom->integ[0][2] = i2; zoom->integ[0][3] = i3;
+    zoom->integ[1][0] = q0; zoom->integ[1][1] = q1;
+    zoom->integ[1][2] = q2; zoom->integ[1][3] = q3;
+    return zoom->averages;
+}
+
+int rp_spectr_zoom_spectrum(rp_spectr_zoom_t *zoom, float *freq, float *amp)
+{
+    int n = zoom->fft_len, i, averages = zoom->averages;
+
+    if(averages == 0)
+        return 0;
+    for(i = 0; i < n / 2; i++) {
+        freq[i] = zoom->f_center + (i - n / 4) * zoom->fs_out / n;
+        amp[i] = sqrt(zoom->power[i] / averages);
+    }
+    memset(zoom->power, 0, n / 2 * sizeof(double));
+    zoom->averages = 0;
+    return averages;
+}
+
+int rp_spectr_zoom_feed_acq(rp_spectr_zoom_t *zoom, rp_channel_t channel)
+{
+    int16_t buf[SPECTR_ZOOM_FEED_CHUNK];
+    struct timespec now;
+    uint32_t wr_ptr, pos, size = 0, n;
+    float rate;
+
+    if(!zoom->buf)
+        return RP_EOOR;
+    ECHECK(acq_GetWritePointer(&wr_ptr));
+    ECHECK(acq_GetSamplingRateHz(&rate));
+    if(fabs(rate - zoom->fs) > zoom->fs * 1e-6) {
+        fprintf(stderr, "rp_spectr_zoom_feed_acq() sampling at %.0f Hz, "
+                "zoom set up for %.0f Hz\n", rate, zoom->fs);
+        return RP_EIPV;
+    }
+    if(ADC_BUFFER_SIZE / rate < SPECTR_ZOOM_FEED_MIN_T) {
+        fprintf(stderr, "rp_spectr_zoom_feed_acq() buffer of %.0f us is "
+                "too short to be fed\n", ADC_BUFFER_SIZE / rate * 1e6);
+        return RP_EOOR;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pos = (zoom->wr_ptr + 1) % ADC_BUFFER_SIZE;
+    if(zoom->synced) {
+        double elapsed = (now.tv_sec - zoom->fed.tv_sec) +
+            (now.tv_nsec - zoom->fed.tv_nsec) * 1e-9;
+        size = (wr_ptr + ADC_BUFFER_SIZE - zoom->wr_ptr) % ADC_BUFFER_SIZE;
+        /* a lap is a gap in the input, start over after it */
+        if(size && elapsed * rate >= ADC_BUFFER_SIZE) {
+            zoom->overruns++;
+            rp_spectr_zoom_restart(zoom);
+            size = 0;
+        }
+    }
+    zoom->synced = 1;
+    zoom->wr_ptr = wr_ptr;
+    zoom->fed = now;
+
+    for(; size; size -= n) {
+        n = MIN(size, SPECTR_ZOOM_FEED_CHUNK);
+        ECHECK(acq_GetDataRaw(channel, pos, &n, buf));
+        rp_spectr_zoom_process(zoom, buf, n);
+        pos = (pos + n) % ADC_BUFFER_SIZE;
+    }
+    return RP_OK;
+}
@@ -0,0 +1,140 @@
+/**
+ * $Id$
+ *
+ * @brief Red Pitaya Spectrum Analyzer zoom FFT (digital down-conversion).
+ *
+ * Narrow band spectrum around a centre frequency of a contiguous stream of
+ * raw ADC samples (successive captures or DMA buffers):
+ *
+ *   x -> coarse NCO -> CIC (decimation R) -> fine NCO -> 2^K halfbands ->
+ *        Blackman-Harris window -> complex FFT -> averaged power
+ *
+ * The coarse NCO frequency is a multiple of fs/SPECTR_ZOOM_NCO_LEN, so its
+ * table lookups repeat exactly; the rest of the centre frequency is mixed by
+ * the fine NCO at the CIC output rate. The CIC runs in wrapping 64 bit
+ * integers and is exact. The CIC and halfband passband responses are taken
+ * out of the spectrum bin by bin.
+ *
+ * Exported by rp.h as rp_Zoom*, which can also feed it from the running
+ * acquisition.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __SPEC_ZOOM_H
+#define __SPEC_ZOOM_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "redpitaya/rp.h"
+
+/* Coarse NCO table length, Q17 cosine */
+#define SPECTR_ZOOM_NCO_LEN     4096
+#define SPECTR_ZOOM_NCO_BITS    17
+/* CIC order and decimation range; 16 bit input, Q17 NCO and R^4 gain fit
+ * in 63 bits up to R = 128 */
+#define SPECTR_ZOOM_CIC_ORDER   4
+#define SPECTR_ZOOM_CIC_MAX_DEC 128
+/* Halfband decimators, at least two keep the CIC aliases below -90 dB */
+#define SPECTR_ZOOM_HB_TAPS     31
+#define SPECTR_ZOOM_HB_MIN      2
+#define SPECTR_ZOOM_HB_MAX      24
+/* Samples of a halfband delay line, doubled to read it without wrapping */
+#define SPECTR_ZOOM_HB_LINE     (2 * SPECTR_ZOOM_HB_TAPS)
+/* Fine NCO is recomputed from its phase every so many samples */
+#define SPECTR_ZOOM_FINE_RENORM 1024
+/* Samples read from the acquisition buffer at a time */
+#define SPECTR_ZOOM_FEED_CHUNK  1024
+/* Shortest acquisition buffer fed, s: calls further apart than the buffer
+ * lasts count as a lap, at decimation 1 (131 us) nearly every call would */
+#define SPECTR_ZOOM_FEED_MIN_T  1e-3
+
+typedef struct rp_spectr_zoom_hb_s {
+    double   line[SPECTR_ZOOM_HB_LINE][2];
+    int      pos;
+    int      odd;
+} rp_spectr_zoom_hb_t;
+
+typedef struct rp_spectr_zoom_s {
+    /* Parameters as realized */
+    double   fs;           /* input sample rate [Hz] */
+    double   f_center;     /* centre frequency [Hz] */
+    double   fs_out;       /* FFT input sample rate, fs / (cic_dec * 2^hb_stages) */
+    double   span;         /* shown band fs_out / 2 [Hz] */
+    int      cic_dec;
+    int      hb_stages;
+    int      fft_len;
+
+    /* Coarse NCO */
+    int32_t  nco[SPECTR_ZOOM_NCO_LEN];
+    uint32_t nco_phase;
+    uint32_t nco_step;
+    /* CIC integrators and comb delays of I and Q */
+    uint64_t integ[2][SPECTR_ZOOM_CIC_ORDER];
+    uint64_t comb[2][SPECTR_ZOOM_CIC_ORDER];
+    int      cic_cnt;
+    double   cic_scale;
+    /* Fine NCO, rotator recomputed from the phase [cycles] */
+    double   fine_inc;
+    double   fine_phase;
+    double   fine_rot[2];
+    double   fine_step[2];
+    int      fine_cnt;
+    /* Halfbands, odd coefficients of one half; the centre one is 1/2 */
+    double   hb_coef[(SPECTR_ZOOM_HB_TAPS + 1) / 4];
+    rp_spectr_zoom_hb_t hb[SPECTR_ZOOM_HB_MAX];
+    /* Output samples to skip while the filters settle */
+    int      settle;
+
+    /* Spectrum */
+    struct kiss_fft_state *fft_cfg;
+    double  *buf;          /* fft_len complex samples, interleaved */
+    double  *spec;         /* fft_len complex bins, interleaved */
+    double  *window;
+    double  *corr;         /* power correction of the shown bins */
+    double  *power;        /* accumulated power of the shown bins */
+    int      buf_len;
+    int      averages;
+
+    /* Acquisition feed */
+    int      synced;
+    uint32_t wr_ptr;       /* last sample taken */
+    struct timespec fed;
+    uint32_t overruns;
+} rp_spectr_zoom_t;
+
+/* Sets up zoom on span [Hz] around f_center [Hz] of a signal sampled at fs
+ * [Hz], with fft_len (power of 2) point FFTs. The span is rounded up to the
+ * nearest one the decimation allows, zoom->span holds it.
+ * Returns 0 or -1 on invalid parameters or allocation failure. */
+int rp_spectr_zoom_init(rp_spectr_zoom_t *zoom, double fs, double f_center,
+                        double span, int fft_len);
+void rp_spectr_zoom_clean(rp_spectr_zoom_t *zoom);
+
+/* Restarts the filters and drops the averaged spectra, for input that does
+ * not continue the previous samples */
+void rp_spectr_zoom_reset(rp_spectr_zoom_t *zoom);
+
+/* Down-converts len raw samples; a spectrum is added to the average every
+ * fft_len decimated samples. Returns the number of averaged spectra. */
+int rp_spectr_zoom_process(rp_spectr_zoom_t *zoom, const int16_t *in, int len);
+
+/* Averaged spectrum of the span: fft_len/2 bins of frequency [Hz] and
+ * amplitude of a sine in the input units (a bin centred sine of amplitude A
+ * reads A). Starts a new average. Returns the number of spectra averaged,
+ * 0 if there is none yet (outputs untouched). */
+int rp_spectr_zoom_spectrum(rp_spectr_zoom_t *zoom, float *freq, float *amp);
+
+/* Down-converts the samples of channel the acquisition wrote since the last
+ * call. The first call only takes the write pointer; when the acquisition
+ * has lapped its buffer since the last call, the filters restart there.
+ * The acquisition sample rate must be fs, the buffer must last at least
+ * SPECTR_ZOOM_FEED_MIN_T. Returns RP_OK or an RP_E* code. */
+int rp_spectr_zoom_feed_acq(rp_spectr_zoom_t *zoom, rp_channel_t channel);
+
+#endif //__SPEC_ZOOM_H
@@ -0,0 +1,469 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library XADC slow analog inputs module implementation
+ *
+ * The four slow analog inputs are read either one value at a time from the
+ * IIO sysfs attributes, or continuously: the XADC IIO buffer is enabled for
+ * the four channels and a thread reads the scans from the IIO character
+ * device into a ring buffer, from which blocks, averages and the latest
+ * values are served.
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "common.h"
+#include "xadc.h"
+
+/* IIO channels of the analog input pins AI0..AI3 */
+static const char *xadc_channel[XADC_AIN_NUM] = {
+    "in_voltage11_vaux8",
+    "in_voltage9_vaux0",
+    "in_voltage10_vaux1",
+    "in_voltage12_vaux9"
+};
+
+/* Location and format of a channel in a buffer scan */
+typedef struct xadc_scan_el_s {
+    int  index;
+    int  offset;
+    int  bytes;
+    int  bits;
+    int  shift;
+    bool be;
+    bool sign;
+} xadc_scan_el_t;
+
+static char xadc_sysfs[XADC_PATH_LEN] = XADC_SYSFS_DIR;
+static char xadc_dev[XADC_PATH_LEN] = "";
+
+static struct {
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+    volatile bool   run;
+    bool            running;
+    int             fd;
+    float           rate;
+    xadc_scan_el_t  ch[XADC_AIN_NUM];
+    xadc_scan_el_t  ts;
+    bool            has_ts;
+    int             scan_bytes;
+    /* ring buffer of the received scans, under mutex */
+    uint16_t        data[XADC_AIN_NUM][XADC_RING_LEN];
+    int64_t         time[XADC_RING_LEN];
+    uint64_t        count;
+} xadc = { .mutex = PTHREAD_MUTEX_INITIALIZER, .fd = -1 };
+
+
+static int64_t xadc_GetTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int xadc_WriteAttr(const char *dir, const char *attr, const char *value) {
+    char path[2*XADC_PATH_LEN];
+    FILE *fp;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, attr);
+    fp = fopen(path, "w");
+    if (fp == NULL) {
+        return RP_EIIO;
+    }
+    int r = fputs(value, fp) < 0;
+    r |= fclose(fp) != 0;
+    return r ? RP_EIIO : RP_OK;
+}
+
+static int xadc_ReadAttr(const char *dir, const char *attr, char *value, int len) {
+    char path[2*XADC_PATH_LEN];
+    FILE *fp;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, attr);
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        return RP_EIIO;
+    }
+    char *r = fgets(value, len, fp);
+    fclose(fp);
+    if (r == NULL) {
+        return RP_EIIO;
+    }
+    value[strcspn(value, "\n")] = '\0';
+    return RP_OK;
+}
+
+int xadc_SetPaths(const char *sysfs_dir, const char *dev_path) {
+    if (xadc.running) {
+        return RP_EIPV;
+    }
+    if (sysfs_dir == NULL) {
+        sysfs_dir = XADC_SYSFS_DIR;
+    }
+    if (dev_path == NULL) {
+        dev_path = "";
+    }
+    if (strlen(sysfs_dir) >= XADC_PATH_LEN || strlen(dev_path) >= XADC_PATH_LEN) {
+        return RP_EIPV;
+    }
+    strcpy(xadc_sysfs, sysfs_dir);
+    strcpy(xadc_dev, dev_path);
+    return RP_OK;
+}
+
+/* Character device of the IIO device, /dev/ + sysfs directory name unless
+ * set explicitly */
+static void xadc_GetDevPath(char *path, int len) {
+    const char *name = strrchr(xadc_sysfs, '/');
+
+    if (xadc_dev[0]) {
+        strcpy(path, xadc_dev);
+    }
+    else {
+        snprintf(path, len, "/dev/%s", name ? name + 1 : xadc_sysfs);
+    }
+}
+
+int xadc_GetValueRaw(int unsigned pin, uint32_t *value) {
+    char attr[64], str[32];
+
+    if (pin >= XADC_AIN_NUM) {
+        return RP_EPN;
+    }
+
+    /* latest streamed value, the sysfs read would interleave a conversion */
+    pthread_mutex_lock(&xadc.mutex);
+    if (xadc.running && xadc.count) {
+        *value = xadc.data[pin][(xadc.count - 1) % XADC_RING_LEN];
+        pthread_mutex_unlock(&xadc.mutex);
+        return RP_OK;
+    }
+    pthread_mutex_unlock(&xadc.mutex);
+
+    snprintf(attr, sizeof(attr), "%s_raw", xadc_channel[pin]);
+    ECHECK(xadc_ReadAttr(xadc_sysfs, attr, str, sizeof(str)));
+    if (sscanf(str, "%u", value) != 1) {
+        return RP_EIIO;
+    }
+    return RP_OK;
+}
+
+/* Reads index & type of a scan element, e.g. "le:u12/16>>4" */
+static int xadc_GetScanEl(const char *name, xadc_scan_el_t *el) {
+    char attr[64], str[32];
+    char endian, sign;
+
+    snprintf(attr, sizeof(attr), "scan_elements/%s_index", name);
+    if (xadc_ReadAttr(xadc_sysfs, attr, str, sizeof(str)) != RP_OK ||
+        sscanf(str, "%d", &el->index) != 1) {
+        return RP_EIIO;
+    }
+
+    snprintf(attr, sizeof(attr), "scan_elements/%s_type", name);
+    if (xadc_ReadAttr(xadc_sysfs, attr, str, sizeof(str)) != RP_OK ||
+        sscanf(str, "%ce:%c%d/%d>>%d", &endian, &sign, &el->bits, &el->bytes, &el->shift) != 5) {
+        return RP_EIIO;
+    }
+    el->bytes /= 8;
+    el->be = endian == 'b';
+    el->sign = sign == 's';
+    if ((el->bytes != 1 && el->bytes != 2 && el->bytes != 4 && el->bytes != 8) ||
+        el->bits < 1 || el->bits + el->shift > el->bytes * 8) {
+        return RP_EIIO;
+    }
+    return RP_OK;
+}
+
+/* Disables all scan elements, enables the analog inputs & timestamp and
+ * lays out the scan: elements by index, each aligned to its size */
+static int xadc_SetupScan() {
+    char path[2*XADC_PATH_LEN];
+    xadc_scan_el_t *el[XADC_AIN_NUM + 1];
+    struct dirent *de;
+    int n = 0;
+
+    snprintf(path, sizeof(path), "%s/scan_elements", xadc_sysfs);
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return RP_EIIO;
+    }
+    while ((de = readdir(dir)) != NULL) {
+        int len = strlen(de->d_name);
+        if (len > 3 && !strcmp(de->d_name + len - 3, "_en")) {
+            xadc_WriteAttr(path, de->d_name, "0");
+        }
+    }
+    closedir(dir);
+
+    for (int i = 0; i < XADC_AIN_NUM; i++) {
+        char attr[64];
+        ECHECK(xadc_GetScanEl(xadc_channel[i], &xadc.ch[i]));
+        snprintf(attr, sizeof(attr), "%s_en", xadc_channel[i]);
+        ECHECK(xadc_WriteAttr(path, attr, "1"));
+        el[n++] = &xadc.ch[i];
+    }
+    /* the XADC driver has no timestamp channel, the read time is used then */
+    xadc.has_ts = xadc_GetScanEl("in_timestamp", &xadc.ts) == RP_OK &&
+                  xadc_WriteAttr(path, "in_timestamp_en", "1") == RP_OK;
+    if (xadc.has_ts) {
+        el[n++] = &xadc.ts;
+    }
+
+    for (int i = 1; i < n; i++) {
+        for (int j = i; j > 0 && el[j]->index < el[j-1]->index; j--) {
+            xadc_scan_el_t *t = el[j];
+            el[j] = el[j-1];
+            el[j-1] = t;
+        }
+    }
+    int offset = 0, align = 1;
+    for (int i = 0; i < n; i++) {
+        offset = (offset + el[i]->bytes - 1) / el[i]->bytes * el[i]->bytes;
+        el[i]->offset = offset;
+        offset += el[i]->bytes;
+        align = MAX(align, el[i]->bytes);
+    }
+    xadc.scan_bytes = (offset + align - 1) / align * align;
+    return RP_OK;
+}
+
+/* Selects the device's own sample rate trigger if there is one, the triggers
+ * are siblings of the device in sysfs */
+static void xadc_SetupTrigger() {
+    char parent[XADC_PATH_LEN], path[2*XADC_PATH_LEN], name[64];
+    struct dirent *de;
+
+    strcpy(parent, xadc_sysfs);
+    char *s = strrchr(parent, '/');
+    if (s == NULL) {
+        return;
+    }
+    *s = '\0';
+
+    DIR *dir = opendir(parent);
+    if (dir == NULL) {
+        return;
+    }
+    while ((de = readdir(dir)) != NULL) {
+        if (strncmp(de->d_name, "trigger", 7)) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", parent, de->d_name);
+        if (xadc_ReadAttr(path, "name", name, sizeof(name)) == RP_OK &&
+            strlen(name) >= 10 && !strcmp(name + strlen(name) - 10, "samplerate")) {
+            xadc_WriteAttr(xadc_sysfs, "trigger/current_trigger", name);
+            break;
+        }
+    }
+    closedir(dir);
+}
+
+static int64_t xadc_GetEl(const uint8_t *scan, const xadc_scan_el_t *el) {
+    uint64_t v = 0;
+
+    for (int b = 0; b < el->bytes; b++) {
+        int i = el->be ? b : el->bytes - 1 - b;
+        v = (v << 8) | scan[el->offset + i];
+    }
+    v >>= el->shift;
+    if (el->bits < 64) {
+        v &= ((uint64_t)1 << el->bits) - 1;
+        if (el->sign && (v >> (el->bits - 1))) {
+            v |= ~(((uint64_t)1 << el->bits) - 1);
+        }
+    }
+    return (int64_t)v;
+}
+
+static void xadc_Store(const uint8_t *buf, int scans, int64_t now) {
+    int64_t period = xadc.rate > 0 ? (int64_t)(1e9 / xadc.rate) : 0;
+
+    pthread_mutex_lock(&xadc.mutex);
+    for (int s = 0; s < scans; s++) {
+        const uint8_t *scan = buf + s * xadc.scan_bytes;
+        int idx = xadc.count % XADC_RING_LEN;
+
+        for (int i = 0; i < XADC_AIN_NUM; i++) {
+            xadc.data[i][idx] = xadc_GetEl(scan, &xadc.ch[i]);
+        }
+        xadc.time[idx] = xadc.has_ts ? xadc_GetEl(scan, &xadc.ts) : now - (scans - 1 - s) * period;
+        xadc.count++;
+    }
+    pthread_mutex_unlock(&xadc.mutex);
+}
+
+static void *xadc_Reader(void *arg) {
+    uint8_t buf[256 * 64];
+    int len = sizeof(buf) / xadc.scan_bytes * xadc.scan_bytes;
+    int fill = 0;
+    struct pollfd pfd = { .fd = xadc.fd, .events = POLLIN };
+
+    while (xadc.run) {
+        if (poll(&pfd, 1, XADC_POLL_MS) <= 0) {
+            continue;
+        }
+        ssize_t n = read(xadc.fd, buf + fill, len - fill);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "XADC stream read failed: %s\n", strerror(errno));
+            break;
+        }
+        if (n == 0) {
+            /* no writer on a FIFO standing in for the device */
+            usleep(XADC_POLL_MS * 1000);
+            continue;
+        }
+        fill += n;
+        int scans = fill / xadc.scan_bytes;
+        xadc_Store(buf, scans, xadc_GetTimeNs());
+        fill -= scans * xadc.scan_bytes;
+        memmove(buf, buf + scans * xadc.scan_bytes, fill);
+    }
+    return NULL;
+}
+
+int xadc_StreamStart(float rate) {
+    char dev[2*XADC_PATH_LEN], str[32];
+    float actual;
+
+    if (rate <= 0) {
+        return RP_EOOR;
+    }
+    ECHECK(xadc_StreamStop());
+
+    xadc_WriteAttr(xadc_sysfs, "buffer/enable", "0");
+    ECHECK(xadc_SetupScan());
+    xadc_SetupTrigger();
+
+    snprintf(str, sizeof(str), "%u", (uint32_t)rate);
+    ECHECK(xadc_WriteAttr(xadc_sysfs, "sampling_frequency", str));
+    /* the device rounds the rate */
+    xadc.rate = rate;
+    if (xadc_ReadAttr(xadc_sysfs, "sampling_frequency", str, sizeof(str)) == RP_OK &&
+        sscanf(str, "%f", &actual) == 1 && actual > 0) {
+        xadc.rate = actual;
+    }
+
+    snprintf(str, sizeof(str), "%d", XADC_KBUF_LEN);
+    ECHECK(xadc_WriteAttr(xadc_sysfs, "buffer/length", str));
+    ECHECK(xadc_WriteAttr(xadc_sysfs, "buffer/enable", "1"));
+
+    xadc_GetDevPath(dev, sizeof(dev));
+    xadc.fd = open(dev, O_RDONLY | O_NONBLOCK);
+    if (xadc.fd < 0) {
+        xadc_WriteAttr(xadc_sysfs, "buffer/enable", "0");
+        return RP_EIIO;
+    }
+
+    pthread_mutex_lock(&xadc.mutex);
+    xadc.count = 0;
+    pthread_mutex_unlock(&xadc.mutex);
+    xadc.run = true;
+    if (pthread_create(&xadc.thread, NULL, xadc_Reader, NULL)) {
+        close(xadc.fd);
+        xadc.fd = -1;
+        xadc_WriteAttr(xadc_sysfs, "buffer/enable", "0");
+        return RP_EIIO;
+    }
+    xadc.running = true;
+    return RP_OK;
+}
+
+int xadc_StreamStop() {
+    if (!xadc.running) {
+        return RP_OK;
+    }
+    xadc.run = false;
+    pthread_join(xadc.thread, NULL);
+    close(xadc.fd);
+    xadc.fd = -1;
+    xadc_WriteAttr(xadc_sysfs, "buffer/enable", "0");
+    pthread_mutex_lock(&xadc.mutex);
+    xadc.running = false;
+    pthread_mutex_unlock(&xadc.mutex);
+    return RP_OK;
+}
+
+int xadc_StreamGetRate(float *rate) {
+    if (!xadc.running) {
+        return RP_EUF;
+    }
+    *rate = xadc.rate;
+    return RP_OK;
+}
+
+/**
+ * Copies the newest *size scans of a pin, oldest first. *size is reduced to
+ * the scans available, timestamp is the time of the first one in ns.
+ */
+int xadc_StreamGetDataRaw(int unsigned pin, uint32_t *buffer, uint32_t *size, int64_t *timestamp) {
+    if (pin >= XADC_AIN_NUM) {
+        return RP_EPN;
+    }
+    pthread_mutex_lock(&xadc.mutex);
+    if (!xadc.running) {
+        pthread_mutex_unlock(&xadc.mutex);
+        return RP_EUF;
+    }
+    uint64_t n = MIN(MIN(*size, xadc.count), XADC_RING_LEN);
+    uint64_t first = xadc.count - n;
+    for (uint64_t i = 0; i < n; i++) {
+        buffer[i] = xadc.data[pin][(first + i) % XADC_RING_LEN];
+    }
+    if (timestamp) {
+        *timestamp = n ? xadc.time[first % XADC_RING_LEN] : 0;
+    }
+    pthread_mutex_unlock(&xadc.mutex);
+    *size = n;
+    return RP_OK;
+}
+
+/**
+ * Mean of the newest count scans of a pin, fewer if not yet received.
+ */
+int xadc_StreamGetAverageRaw(int unsigned pin, uint32_t count, float *value) {
+    uint64_t sum = 0;
+
+    if (pin >= XADC_AIN_NUM) {
+        return RP_EPN;
+    }
+    if (count == 0) {
+        return RP_EOOR;
+    }
+    pthread_mutex_lock(&xadc.mutex);
+    if (!xadc.running || xadc.count == 0) {
+        pthread_mutex_unlock(&xadc.mutex);
+        return xadc.running ? RP_ETMO : RP_EUF;
+    }
+    uint64_t n = MIN(MIN(count, xadc.count), XADC_RING_LEN);
+    for (uint64_t i = xadc.count - n; i < xadc.count; i++) {
+        sum += xadc.data[pin][i % XADC_RING_LEN];
+    }
+    pthread_mutex_unlock(&xadc.mutex);
+    *value = (float)sum / n;
+    return RP_OK;
+}
+
+int xadc_Release() {
+    ECHECK(xadc_StreamStop());
+    return RP_OK;
+}
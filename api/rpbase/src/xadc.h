@@ -0,0 +1,45 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library XADC slow analog inputs module interface
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __XADC_H
+#define __XADC_H
+
+#include <stdint.h>
+
+/* XADC IIO device sysfs directory & character device */
+#define XADC_SYSFS_DIR     "/sys/devices/soc0/amba_pl/83c00000.xadc_wiz/iio:device1"
+#define XADC_PATH_LEN      256
+
+/* Analog input pins */
+#define XADC_AIN_NUM       4
+
+/* Scans kept by the library, scans buffered by the kernel */
+#define XADC_RING_LEN      (16*1024)
+#define XADC_KBUF_LEN      2048
+
+/* Reader thread poll period */
+#define XADC_POLL_MS       100
+
+int xadc_SetPaths(const char *sysfs_dir, const char *dev_path);
+int xadc_GetValueRaw(int unsigned pin, uint32_t *value);
+
+int xadc_StreamStart(float rate);
+int xadc_StreamStop();
+int xadc_StreamGetRate(float *rate);
+int xadc_StreamGetDataRaw(int unsigned pin, uint32_t *buffer, uint32_t *size, int64_t *timestamp);
+int xadc_StreamGetAverageRaw(int unsigned pin, uint32_t count, float *value);
+
+int xadc_Release();
+
+#endif //__XADC_H
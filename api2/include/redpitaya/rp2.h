@@ -35,6 +35,9 @@ typedef struct {
   char          *dma_dev;
   size_t         dma_size;
   int            dma_fd;
+  uint32_t       dma_seq;     ///< seq of the next RX segment record expected
+  int            dma_seq_set; ///< dma_seq is known, a record was read
+  uint32_t       dma_missed;  ///< RX segment records lost by reading too slowly
   //volatile void *dma_mem;
 } rp_handle_uio_t;
 
@@ -0,0 +1,346 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library generator streaming module implementation
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "common.h"
+#include "rpdma.h"
+#include "rp_dma.h"
+#include "gen_stream.h"
+
+/** rpdma TX segment ring */
+static int rp_GenStreamDmaStart(void *ctx) {
+    return rp_DmaCtrl((rp_handle_uio_t *) ctx, RP_DMA_CYCLIC_TX);
+}
+
+static int rp_GenStreamDmaStop(void *ctx) {
+    return rp_DmaCtrl((rp_handle_uio_t *) ctx, RP_DMA_STOP_TX);
+}
+
+static int rp_GenStreamDmaWait(void *ctx, uint32_t *done) {
+    return rp_DmaTxWait((rp_handle_uio_t *) ctx, done);
+}
+
+static int rp_GenStreamInit(rp_gen_stream_t *stream, const rp_gen_stream_dev_t *dev) {
+    if (dev->mem == NULL || dev->start == NULL || dev->stop == NULL || dev->wait == NULL) {
+        return RP_UIA;
+    }
+    if (dev->sgmnt_cnt < 2 || dev->sgmnt_size < sizeof(int16_t) || dev->sgmnt_size % sizeof(int16_t)) {
+        return RP_EOOR;
+    }
+    stream->stage = (int16_t *) malloc(dev->sgmnt_size);
+    if (stream->stage == NULL) {
+        return RP_EOOR;
+    }
+    stream->dev = *dev;
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->cond, NULL);
+    return RP_OK;
+}
+
+int rp_GenStreamOpen(rp_gen_stream_t *stream, const char *dev) {
+    rp_gen_stream_dev_t ring;
+    void *mem;
+    int status;
+
+    memset(stream, 0, sizeof(*stream));
+    if (rp_DmaOpen(dev, &stream->dma) != RP_OK) {
+        free(stream->dma.dma_dev);
+        return RP_EOMD;
+    }
+    status = rp_DmaTxSetSgmnt(&stream->dma, TX_SGMNT_CNT, TX_SGMNT_SIZE);
+    if (status == RP_OK) {
+        status = rp_DmaTxMap(&stream->dma, &mem, TX_SGMNT_CNT * TX_SGMNT_SIZE);
+    }
+    if (status != RP_OK) {
+        rp_DmaClose(&stream->dma);
+        return status;
+    }
+
+    ring.mem = (int16_t *) mem;
+    ring.sgmnt_cnt = TX_SGMNT_CNT;
+    ring.sgmnt_size = TX_SGMNT_SIZE;
+    ring.ctx = &stream->dma;
+    ring.start = rp_GenStreamDmaStart;
+    ring.stop = rp_GenStreamDmaStop;
+    ring.wait = rp_GenStreamDmaWait;
+    return rp_GenStreamInit(stream, &ring);
+}
+
+int rp_GenStreamOpenDev(rp_gen_stream_t *stream, const rp_gen_stream_dev_t *dev) {
+    memset(stream, 0, sizeof(*stream));
+    return rp_GenStreamInit(stream, dev);
+}
+
+static void rp_GenStreamUnmapFile(rp_gen_stream_t *stream) {
+    if (stream->file) {
+        munmap(stream->file, stream->file_len * sizeof(int16_t));
+        stream->file = NULL;
+        stream->file_len = 0;
+    }
+}
+
+int rp_GenStreamClose(rp_gen_stream_t *stream) {
+    int status = rp_GenStreamStop(stream);
+
+    rp_GenStreamUnmapFile(stream);
+    if (stream->dma.dma_dev) {
+        rp_DmaTxUnmap(stream->dev.mem, (size_t) stream->dev.sgmnt_cnt * stream->dev.sgmnt_size);
+        rp_DmaClose(&stream->dma);
+        stream->dma.dma_dev = NULL;
+    }
+    free(stream->stage);
+    stream->stage = NULL;
+    pthread_cond_destroy(&stream->cond);
+    pthread_mutex_destroy(&stream->lock);
+    return status;
+}
+
+int rp_GenStreamSetSource(rp_gen_stream_t *stream, rp_gen_stream_fill_t fill, void *ctx) {
+    if (stream->started) {
+        return RP_EOOR;
+    }
+    rp_GenStreamUnmapFile(stream);
+    stream->fill = fill;
+    stream->fill_ctx = ctx;
+    return RP_OK;
+}
+
+static int rp_GenStreamFileFill(void *ctx, int16_t *buf, uint32_t samples) {
+    rp_gen_stream_t *stream = (rp_gen_stream_t *) ctx;
+    uint32_t n = 0;
+
+    while (n < samples) {
+        if (stream->file_pos == stream->file_len) {
+            if (!stream->file_loop) {
+                break;
+            }
+            stream->file_pos = 0;
+        }
+        size_t len = stream->file_len - stream->file_pos;
+        if (len > samples - n) {
+            len = samples - n;
+        }
+        memcpy(buf + n, stream->file + stream->file_pos, len * sizeof(int16_t));
+        stream->file_pos += len;
+        n += len;
+    }
+    return n;
+}
+
+int rp_GenStreamSetFile(rp_gen_stream_t *stream, const char *path, bool loop) {
+    struct stat st;
+    void *map;
+    int fd;
+
+    if (stream->started) {
+        return RP_EOOR;
+    }
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Unable to open %s\n", path);
+        return RP_EOMD;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(int16_t)) {
+        close(fd);
+        return RP_EOOR;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        printf("Failed to mmap %s\n", path);
+        return RP_EMMD;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    rp_GenStreamUnmapFile(stream);
+    stream->file = (int16_t *) map;
+    stream->file_len = st.st_size / sizeof(int16_t);
+    stream->file_loop = loop;
+    stream->fill = rp_GenStreamFileFill;
+    stream->fill_ctx = stream;
+    return RP_OK;
+}
+
+/** Takes the next segment of samples from the source, zeros once it ended */
+static int rp_GenStreamFillStage(rp_gen_stream_t *stream) {
+    uint32_t len = stream->dev.sgmnt_size / sizeof(int16_t);
+    int n = 0;
+
+    if (!stream->src_ended) {
+        n = stream->fill(stream->fill_ctx, stream->stage, len);
+        if (n < 0) {
+            return RP_EFRB;
+        }
+        if (n > (int) len) {
+            n = len;
+        }
+        stream->src_ended = n < (int) len;
+        pthread_mutex_lock(&stream->lock);
+        stream->status.samples += n;
+        pthread_mutex_unlock(&stream->lock);
+    }
+    memset(stream->stage + n, 0, (len - n) * sizeof(int16_t));
+    stream->stage_len = n;
+    stream->staged = true;
+    return RP_OK;
+}
+
+/** Copies the staged samples to segment idx of the ring */
+static void rp_GenStreamCommitStage(rp_gen_stream_t *stream, uint32_t idx) {
+    uint32_t len = stream->dev.sgmnt_size / sizeof(int16_t);
+
+    memcpy(stream->dev.mem + (size_t) (idx % stream->dev.sgmnt_cnt) * len, stream->stage, stream->dev.sgmnt_size);
+    stream->staged = false;
+    // the first segment after the source ended holds its last samples
+    if (stream->src_ended && !stream->ended) {
+        stream->ended = true;
+        stream->end = stream->stage_len ? idx + 1 : idx;
+    }
+}
+
+/** Refills the segments behind the one the DMA plays */
+static void *rp_GenStreamThread(void *arg) {
+    rp_gen_stream_t *stream = (rp_gen_stream_t *) arg;
+    uint32_t done = 0;
+    int status = RP_OK;
+
+    while (stream->run && status == RP_OK) {
+        status = stream->dev.wait(stream->dev.ctx, &done);
+        if (status != RP_OK || (stream->ended && (int32_t) (done - stream->end) >= 0)) {
+            break;
+        }
+
+        while (stream->run) {
+            if (!stream->staged) {
+                status = rp_GenStreamFillStage(stream);
+                if (status != RP_OK) {
+                    break;
+                }
+            }
+
+            // the source may have taken long, see where the DMA is now
+            uint32_t now = done - 1;
+            status = stream->dev.wait(stream->dev.ctx, &now);
+            if (status != RP_OK) {
+                break;
+            }
+            done = now;
+
+            pthread_mutex_lock(&stream->lock);
+            stream->status.played = done;
+            // the DMA plays segment done and may already fetch the next one,
+            // if it got there before they were refilled it replays them
+            if ((int32_t) (done + 1 - stream->filled) >= 0) {
+                stream->status.underruns += done + 2 - stream->filled;
+                stream->filled = done + 2;
+            }
+            pthread_mutex_unlock(&stream->lock);
+
+            // every segment but the one being played is filled
+            if (stream->filled - done >= stream->dev.sgmnt_cnt) {
+                break;
+            }
+            rp_GenStreamCommitStage(stream, stream->filled);
+            stream->filled++;
+        }
+    }
+    stream->dev.stop(stream->dev.ctx);
+
+    pthread_mutex_lock(&stream->lock);
+    stream->status.played = done;
+    stream->status.running = false;
+    stream->status.error = status;
+    pthread_cond_broadcast(&stream->cond);
+    pthread_mutex_unlock(&stream->lock);
+    return NULL;
+}
+
+int rp_GenStreamStart(rp_gen_stream_t *stream) {
+    int status;
+
+    if (stream->fill == NULL) {
+        return RP_UIA;
+    }
+    if (stream->started) {
+        return RP_EOOR;
+    }
+
+    stream->file_pos = 0;
+    stream->staged = false;
+    stream->src_ended = false;
+    stream->ended = false;
+    stream->end = 0;
+    memset(&stream->status, 0, sizeof(stream->status));
+    for (stream->filled = 0; stream->filled < stream->dev.sgmnt_cnt; stream->filled++) {
+        status = rp_GenStreamFillStage(stream);
+        if (status != RP_OK) {
+            return status;
+        }
+        rp_GenStreamCommitStage(stream, stream->filled);
+    }
+
+    stream->status.running = true;
+    stream->run = true;
+    status = stream->dev.start(stream->dev.ctx);
+    if (status != RP_OK) {
+        stream->status.running = false;
+        return status;
+    }
+    if (pthread_create(&stream->thread, NULL, rp_GenStreamThread, stream) != 0) {
+        stream->dev.stop(stream->dev.ctx);
+        stream->status.running = false;
+        return RP_EOOR;
+    }
+    stream->started = true;
+    return RP_OK;
+}
+
+int rp_GenStreamStop(rp_gen_stream_t *stream) {
+    if (!stream->started) {
+        return RP_OK;
+    }
+    stream->run = false;
+    stream->dev.stop(stream->dev.ctx);
+    pthread_join(stream->thread, NULL);
+    stream->started = false;
+    return RP_OK;
+}
+
+int rp_GenStreamGetStatus(rp_gen_stream_t *stream, rp_gen_stream_status_t *status) {
+    pthread_mutex_lock(&stream->lock);
+    *status = stream->status;
+    pthread_mutex_unlock(&stream->lock);
+    return RP_OK;
+}
+
+int rp_GenStreamWaitEnd(rp_gen_stream_t *stream) {
+    int status;
+
+    pthread_mutex_lock(&stream->lock);
+    while (stream->status.running) {
+        pthread_cond_wait(&stream->cond, &stream->lock);
+    }
+    status = stream->status.error;
+    pthread_mutex_unlock(&stream->lock);
+    return status;
+}
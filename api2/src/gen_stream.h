@@ -0,0 +1,125 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library generator streaming module interface
+ *
+ * Plays records longer than the generator table from host memory through
+ * the cyclic TX DMA. The TX buffer is a ring of segments the DMA plays over
+ * and over; a thread refills every segment with the next samples of a file
+ * or a callback as soon as the DMA has played it, so the DMA never gets back
+ * to a segment before it holds new data, unless the source is too slow.
+ * The samples are taken to a staging segment first and copied to the ring
+ * only if the DMA has not caught up meanwhile (it plays a segment and may be
+ * fetching the next one); on an underrun the DMA replays old segments and
+ * the stream continues after them without losing samples.
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+#ifndef __GEN_STREAM_H
+#define __GEN_STREAM_H
+
+#include <pthread.h>
+
+#include "common.h"
+
+/**
+ * Samples source, writes up to samples samples to buf.
+ * @return Number of samples written, less than samples ends the stream,
+ * negative aborts it.
+ */
+typedef int (*rp_gen_stream_fill_t)(void *ctx, int16_t *buf, uint32_t samples);
+
+/** Segment ring played cyclically, the rpdma TX buffer or a simulation */
+typedef struct {
+    int16_t  *mem;         ///< sgmnt_cnt * sgmnt_size bytes
+    uint32_t  sgmnt_cnt;
+    uint32_t  sgmnt_size;  ///< bytes, multiple of sizeof(int16_t)
+    void     *ctx;
+    int (*start)(void *ctx);  ///< starts playing from segment 0
+    int (*stop)(void *ctx);
+    /** Waits until more than *done segments are played since start, at most
+     *  about a second, returns at once if *done is not the played count;
+     *  returns the number of played segments in *done */
+    int (*wait)(void *ctx, uint32_t *done);
+} rp_gen_stream_dev_t;
+
+typedef struct {
+    uint64_t samples;    ///< samples taken from the source
+    uint32_t played;     ///< segments played by the DMA
+    uint32_t underruns;  ///< segments played before they were refilled
+    bool     running;
+    int      error;      ///< RP_OK or the error that stopped the stream
+} rp_gen_stream_status_t;
+
+typedef struct {
+    rp_gen_stream_dev_t dev;
+    rp_handle_uio_t     dma;       ///< rpdma device, if opened on it
+
+    rp_gen_stream_fill_t fill;
+    void                *fill_ctx;
+    /** mmap'd int16 file source */
+    int16_t             *file;
+    size_t               file_len;  ///< samples
+    size_t               file_pos;
+    bool                 file_loop;
+
+    int16_t             *stage;     ///< next segment of samples
+    uint32_t             stage_len; ///< samples of the source in it
+    bool                 staged;
+    bool                 src_ended;
+
+    pthread_t            thread;
+    pthread_mutex_t      lock;
+    pthread_cond_t       cond;
+    volatile bool        run;
+    bool                 started;
+    uint32_t             filled;    ///< segments filled, index of the next one
+    uint32_t             end;       ///< segments holding data, once they are filled
+    bool                 ended;
+    rp_gen_stream_status_t status;
+} rp_gen_stream_t;
+
+/**
+ * Opens a stream on the TX side of the rpdma device (/dev/rpdma).
+ */
+int rp_GenStreamOpen(rp_gen_stream_t *stream, const char *dev);
+
+/**
+ * Opens a stream on any segment ring, e.g. a simulated one for testing.
+ */
+int rp_GenStreamOpenDev(rp_gen_stream_t *stream, const rp_gen_stream_dev_t *dev);
+int rp_GenStreamClose(rp_gen_stream_t *stream);
+
+/**
+ * Sets the samples source to a callback, called from the refill thread.
+ */
+int rp_GenStreamSetSource(rp_gen_stream_t *stream, rp_gen_stream_fill_t fill, void *ctx);
+
+/**
+ * Sets the samples source to a file of native int16 samples, mmap'd.
+ * @param loop Restart at the beginning of the file at its end, otherwise
+ * the stream ends with the file.
+ */
+int rp_GenStreamSetFile(rp_gen_stream_t *stream, const char *path, bool loop);
+
+/**
+ * Fills the whole ring, starts the DMA and the refill thread.
+ */
+int rp_GenStreamStart(rp_gen_stream_t *stream);
+int rp_GenStreamStop(rp_gen_stream_t *stream);
+
+int rp_GenStreamGetStatus(rp_gen_stream_t *stream, rp_gen_stream_status_t *status);
+
+/**
+ * Blocks until the stream stops, after the last samples of the source are
+ * played, on an error or by rp_GenStreamStop().
+ */
+int rp_GenStreamWaitEnd(rp_gen_stream_t *stream);
+
+#endif //__GEN_STREAM_H
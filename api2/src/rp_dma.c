@@ -2,6 +2,8 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/ioctl.h>
+#include <poll.h>
+#include <errno.h>
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
@@ -32,6 +34,8 @@ int rp_DmaOpen(const char *dev, rp_handle_uio_t *handle)
         printf("Unable to open device file");
         return -1;
     }
+    handle->dma_seq_set = 0;
+    handle->dma_missed = 0;
 
     // TODO: check for max. memory size..
     handle->dma_size=RP_SGMNT_CNT*RP_SGMNT_SIZE;
@@ -50,6 +54,12 @@ int rp_DmaCtrl(rp_handle_uio_t *handle, RP_DMA_CTRL ctrl)
         case RP_DMA_STOP_RX:
             ioctl(handle->dma_fd, STOP_RX, 0);
         break;
+        case RP_DMA_CYCLIC_TX:
+            ioctl(handle->dma_fd, CYCLIC_TX, 0);
+        break;
+        case RP_DMA_STOP_TX:
+            ioctl(handle->dma_fd, STOP_TX, 0);
+        break;
         default:
             return RP_EOOR;
     }
@@ -68,6 +78,49 @@ int rp_SetSgmntS(rp_handle_uio_t *handle, unsigned long no)
     return RP_OK;
 }
 
+int rp_DmaTxSetSgmnt(rp_handle_uio_t *handle, unsigned long cnt, unsigned long size)
+{
+    if (cnt * size > TX_SGMNT_CNT * TX_SGMNT_SIZE) {
+        return RP_EOOR;
+    }
+    // the driver keeps cnt * size within its buffer after each call
+    if (ioctl(handle->dma_fd, SET_TX_SGMNT_CNT, 1) < 0 ||
+        ioctl(handle->dma_fd, SET_TX_SGMNT_SIZE, size) < 0 ||
+        ioctl(handle->dma_fd, SET_TX_SGMNT_CNT, cnt) < 0) {
+        return RP_EOOR;
+    }
+    return RP_OK;
+}
+
+int rp_DmaTxMap(rp_handle_uio_t *handle, void **mem, size_t size)
+{
+    *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, handle->dma_fd, TX_MMAP_OFFSET);
+    if (*mem == MAP_FAILED) {
+        printf("Failed to mmap TX buffer\n");
+        *mem = NULL;
+        return RP_EMMD;
+    }
+    return RP_OK;
+}
+
+int rp_DmaTxUnmap(void *mem, size_t size)
+{
+    if (munmap(mem, size) == -1) {
+        printf("Failed to munmap TX buffer\n");
+        return RP_EUMD;
+    }
+    return RP_OK;
+}
+
+int rp_DmaTxWait(rp_handle_uio_t *handle, uint32_t *done)
+{
+    if (ioctl(handle->dma_fd, WAIT_TX_SGMNT, done) < 0) {
+        printf("TX wait error\n");
+        return RP_EFRB;
+    }
+    return RP_OK;
+}
+
 int rp_DmaMemDump(rp_handle_uio_t *handle)
 {
     unsigned char* map=NULL;
@@ -97,14 +150,45 @@ int rp_DmaMemDump(rp_handle_uio_t *handle)
 
 int rp_DmaRead(rp_handle_uio_t *handle)
 {
-    int s = read(handle->dma_fd, NULL, 1);
-    if (s<0) {
+    struct rpdma_event ev;
+
+    if (rp_DmaReadEvents(handle, &ev, 1, -1) < 0) {
       printf("read error\n");
       return -1;
     }
     return RP_OK;
 }
 
+int rp_DmaReadEvents(rp_handle_uio_t *handle, struct rpdma_event *events, int count, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = handle->dma_fd, .events = POLLIN };
+    ssize_t len;
+    int n;
+
+    n = poll(&pfd, 1, timeout_ms);
+    if (n < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    // timeout, or stopped with every record read
+    if (n == 0 || !(pfd.revents & POLLIN)) {
+        return 0;
+    }
+    len = read(handle->dma_fd, events, count * sizeof(struct rpdma_event));
+    if (len < 0) {
+        return errno == EAGAIN || errno == EINTR ? 0 : -1;
+    }
+
+    n = len / sizeof(struct rpdma_event);
+    for (int i = 0; i < n; i++) {
+        if (handle->dma_seq_set && events[i].seq != handle->dma_seq) {
+            handle->dma_missed += events[i].seq - handle->dma_seq;
+        }
+        handle->dma_seq = events[i].seq + 1;
+        handle->dma_seq_set = 1;
+    }
+    return n;
+}
+
 int rp_DmaClose(rp_handle_uio_t *handle)
 {
     if(handle->dma_fd){
@@ -20,11 +20,16 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "redpitaya/rp2.h"
+#include "rpdma.h"
+
 typedef enum
 {
     RP_DMA_SINGLE,
     RP_DMA_CYCLIC,
-    RP_DMA_STOP_RX
+    RP_DMA_STOP_RX,
+    RP_DMA_CYCLIC_TX,
+    RP_DMA_STOP_TX
 } RP_DMA_CTRL;
 
 
@@ -33,7 +38,34 @@ int rp_DmaCtrl(rp_handle_uio_t *handle, RP_DMA_CTRL ctrl);
 int rp_SetSgmntC(rp_handle_uio_t *handle, unsigned long no);
 int rp_SetSgmntS(rp_handle_uio_t *handle, unsigned long no);
 int rp_DmaRead(rp_handle_uio_t *handle);
+
+/**
+ * Reads records of completed RX segments (index, sequence number, time).
+ * The device file can be polled together with others, POLLIN means records
+ * are pending.
+ * @param events Up to count records, oldest first.
+ * @param timeout_ms Wait for the first record at most so long, -1 forever.
+ * @return Number of records read, 0 on timeout or once RX is stopped, -1 on
+ * error. Records the driver dropped because they were not read in time are
+ * added to handle->dma_missed.
+ */
+int rp_DmaReadEvents(rp_handle_uio_t *handle, struct rpdma_event *events, int count, int timeout_ms);
 int rp_DmaMemDump(rp_handle_uio_t *handle);
 int rp_DmaClose(rp_handle_uio_t *handle);
 
+/*
+ *  Transmit (memory to FPGA) side, played cyclically by RP_DMA_CYCLIC_TX
+ */
+int rp_DmaTxSetSgmnt(rp_handle_uio_t *handle, unsigned long cnt, unsigned long size);
+int rp_DmaTxMap(rp_handle_uio_t *handle, void **mem, size_t size);
+int rp_DmaTxUnmap(void *mem, size_t size);
+
+/**
+ * Waits for TX segments to complete.
+ * @param done Number of segments completed since RP_DMA_CYCLIC_TX the caller
+ * has seen, on return the current number. Returns earlier, with the same
+ * number, if TX is stopped or after a second.
+ */
+int rp_DmaTxWait(rp_handle_uio_t *handle, uint32_t *done);
+
 #endif // _RP_DMA_H_
@@ -0,0 +1,273 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library software trigger module implementation
+ *
+ * Conditions only change state when a comparator flips, so the scan looks
+ * for the next sample that may flip one: at or above the lowest level of
+ * the comparators low, or at or below the lowest reset level of those high.
+ * That search is done 32 samples at a time with GCC vector extensions (SSE2
+ * or NEON), the flips are then evaluated sample by sample.
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "common.h"
+#include "soft_trig.h"
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+typedef int16_t soft_trig_v8_t __attribute__((vector_size(16)));
+
+typedef struct {
+    rp_soft_trig_event_t *events;
+    uint32_t              max;
+    uint32_t              num;
+} soft_trig_out_t;
+
+/* First sample from i on that may flip a comparator, size if none */
+static uint32_t rp_SoftTrigFind(const int16_t *x, uint32_t i, uint32_t size, int16_t up, int16_t dn) {
+    const soft_trig_v8_t vup = { up, up, up, up, up, up, up, up };
+    const soft_trig_v8_t vdn = { dn, dn, dn, dn, dn, dn, dn, dn };
+    soft_trig_v8_t a, b, c, d, m;
+    uint64_t any[2];
+
+    for (; i + 32 <= size; i += 32) {
+        memcpy(&a, x + i, sizeof(a));
+        memcpy(&b, x + i + 8, sizeof(b));
+        memcpy(&c, x + i + 16, sizeof(c));
+        memcpy(&d, x + i + 24, sizeof(d));
+        m = (a >= vup) | (a <= vdn) | (b >= vup) | (b <= vdn) |
+            (c >= vup) | (c <= vdn) | (d >= vup) | (d <= vdn);
+        memcpy(any, &m, sizeof(any));
+        if (any[0] | any[1]) {
+            break;
+        }
+    }
+    for (; i < size; i++) {
+        if (x[i] >= up || x[i] <= dn) {
+            break;
+        }
+    }
+    return i;
+}
+
+static void rp_SoftTrigEmit(rp_soft_trig_t *trig, soft_trig_out_t *out, double pos, double width) {
+    trig->events++;
+    if (out->num < out->max) {
+        out->events[out->num].pos = pos;
+        out->events[out->num].width = width;
+        out->num++;
+    } else {
+        trig->missed++;
+    }
+}
+
+static bool rp_SoftTrigInRange(const rp_soft_trig_cfg_t *cfg, double width) {
+    return width >= cfg->width_min && (cfg->width_max == 0 || width <= cfg->width_max);
+}
+
+/* Comparator c flipped at pos */
+static void rp_SoftTrigFlip(rp_soft_trig_t *trig, uint32_t c, double pos, soft_trig_out_t *out) {
+    const rp_soft_trig_cfg_t *cfg = &trig->cfg;
+    bool active = trig->cmp[c].state != cfg->negative;
+    /* runt & slope start on the near level and end on the far one */
+    uint32_t near = cfg->negative ? 1 : 0;
+
+    switch (cfg->mode) {
+    case RP_SOFT_TRIG_PULSE_WIDTH:
+        if (active) {
+            trig->start = pos;
+            trig->started = true;
+        } else if (trig->started) {
+            trig->started = false;
+            if (rp_SoftTrigInRange(cfg, pos - trig->start)) {
+                rp_SoftTrigEmit(trig, out, pos, pos - trig->start);
+            }
+        }
+        break;
+
+    case RP_SOFT_TRIG_TIMEOUT:
+        if (active) {
+            trig->start = pos;
+            trig->started = true;
+        } else if (trig->started) {
+            trig->started = false;
+            if (pos >= trig->start + cfg->width_min) {
+                rp_SoftTrigEmit(trig, out, trig->start + cfg->width_min, cfg->width_min);
+            }
+        }
+        break;
+
+    case RP_SOFT_TRIG_RUNT:
+    case RP_SOFT_TRIG_SLOPE:
+        if (c == near) {
+            if (active) {
+                trig->start = pos;
+                trig->started = true;
+                trig->far = false;
+            } else {
+                if (cfg->mode == RP_SOFT_TRIG_RUNT && trig->started && !trig->far &&
+                    rp_SoftTrigInRange(cfg, pos - trig->start)) {
+                    rp_SoftTrigEmit(trig, out, pos, pos - trig->start);
+                }
+                trig->started = false;
+            }
+        } else if (active && trig->started) {
+            if (cfg->mode == RP_SOFT_TRIG_SLOPE) {
+                if (rp_SoftTrigInRange(cfg, pos - trig->start)) {
+                    rp_SoftTrigEmit(trig, out, pos, pos - trig->start);
+                }
+                trig->started = false;
+            } else {
+                trig->far = true;
+            }
+        }
+        break;
+
+    case RP_SOFT_TRIG_WINDOW: {
+        bool inside = trig->cmp[0].state && !trig->cmp[1].state;
+        if (inside == trig->inside) {
+            break;
+        }
+        trig->inside = inside;
+        if (inside == cfg->negative) {
+            if (trig->started && rp_SoftTrigInRange(cfg, pos - trig->start)) {
+                rp_SoftTrigEmit(trig, out, pos, pos - trig->start);
+            } else if (!trig->started && cfg->width_min == 0 && cfg->width_max == 0) {
+                rp_SoftTrigEmit(trig, out, pos, 0);
+            }
+        }
+        trig->start = pos;
+        trig->started = true;
+        break;
+    }
+    }
+}
+
+/* Evaluates sample i of the block, a is the one before it */
+static void rp_SoftTrigStep(rp_soft_trig_t *trig, int16_t a, int16_t b, uint64_t i, soft_trig_out_t *out) {
+    /* in the order the signal crosses the levels */
+    uint32_t first = b > a ? 0 : trig->cmp_num - 1;
+
+    for (uint32_t n = 0; n < trig->cmp_num; n++) {
+        uint32_t c = first ? first - n : n;
+        rp_soft_trig_cmp_t *cmp = &trig->cmp[c];
+
+        if (!cmp->state && b >= cmp->up) {
+            cmp->state = true;
+            rp_SoftTrigFlip(trig, c, i - 1 + (double)(cmp->up - a) / (b - a), out);
+        } else if (cmp->state && b <= cmp->dn) {
+            cmp->state = false;
+            rp_SoftTrigFlip(trig, c, i - 1 + (double)(cmp->dn - a) / (b - a), out);
+        }
+    }
+
+    if (trig->cfg.mode == RP_SOFT_TRIG_TIMEOUT && trig->started &&
+        i >= trig->start + trig->cfg.width_min) {
+        trig->started = false;
+        rp_SoftTrigEmit(trig, out, trig->start + trig->cfg.width_min, trig->cfg.width_min);
+    }
+}
+
+int rp_SoftTrigInit(rp_soft_trig_t *trig, const rp_soft_trig_cfg_t *cfg) {
+    bool two = cfg->mode == RP_SOFT_TRIG_RUNT || cfg->mode == RP_SOFT_TRIG_WINDOW ||
+               cfg->mode == RP_SOFT_TRIG_SLOPE;
+
+    if (cfg->mode > RP_SOFT_TRIG_SLOPE) {
+        return RP_EOOR;
+    }
+    if ((two && cfg->level_hi <= cfg->level) ||
+        (cfg->mode == RP_SOFT_TRIG_TIMEOUT && cfg->width_min == 0) ||
+        (cfg->width_max && cfg->width_max < cfg->width_min)) {
+        return RP_EOOR;
+    }
+
+    memset(trig, 0, sizeof(*trig));
+    trig->cfg = *cfg;
+    trig->cmp_num = two ? 2 : 1;
+    trig->cmp[0].up = cfg->level;
+    trig->cmp[0].dn = MAX((int32_t) cfg->level - cfg->hysteresis, INT16_MIN);
+    trig->cmp[1].up = cfg->level_hi;
+    trig->cmp[1].dn = MAX((int32_t) cfg->level_hi - cfg->hysteresis, INT16_MIN);
+    return RP_OK;
+}
+
+int rp_SoftTrigReset(rp_soft_trig_t *trig) {
+    rp_soft_trig_cfg_t cfg = trig->cfg;
+    return rp_SoftTrigInit(trig, &cfg);
+}
+
+int rp_SoftTrigScan(rp_soft_trig_t *trig, const int16_t *samples, uint32_t size,
+                    rp_soft_trig_event_t *events, uint32_t max) {
+    soft_trig_out_t out = { events, max, 0 };
+    uint64_t base = trig->pos;
+    uint32_t i = 0;
+
+    if (size == 0) {
+        return 0;
+    }
+    /* the first sample only sets the comparators */
+    if (trig->pos == 0) {
+        for (uint32_t c = 0; c < trig->cmp_num; c++) {
+            trig->cmp[c].state = samples[0] >= trig->cmp[c].up;
+        }
+        trig->inside = trig->cmp[0].state && !trig->cmp[1].state;
+        i = 1;
+    }
+
+    while (i < size) {
+        int16_t up = INT16_MAX, dn = INT16_MIN;
+        for (uint32_t c = 0; c < trig->cmp_num; c++) {
+            if (trig->cmp[c].state) {
+                dn = MAX(dn, trig->cmp[c].dn);
+            } else {
+                up = MIN(up, trig->cmp[c].up);
+            }
+        }
+
+        /* a timeout expires at a sample of its own */
+        uint32_t end = size;
+        if (trig->cfg.mode == RP_SOFT_TRIG_TIMEOUT && trig->started) {
+            double expiry = ceil(trig->start + trig->cfg.width_min) - base;
+            end = expiry < size ? MAX(i, (uint32_t) expiry) : size;
+        }
+
+        i = rp_SoftTrigFind(samples, i, end, up, dn);
+        if (i == size) {
+            break;
+        }
+        rp_SoftTrigStep(trig, i ? samples[i - 1] : trig->prev, samples[i], base + i, &out);
+        i++;
+    }
+
+    trig->prev = samples[size - 1];
+    trig->pos += size;
+    return out.num;
+}
+
+int rp_SoftTrigScanRing(rp_soft_trig_t *trig, const int16_t *ring, uint32_t ring_size,
+                        uint32_t start, uint32_t size, rp_soft_trig_event_t *events, uint32_t max) {
+    if (start >= ring_size || size > ring_size) {
+        return -1;
+    }
+    uint32_t first = MIN(size, ring_size - start);
+    int num = rp_SoftTrigScan(trig, ring + start, first, events, max);
+    return num + rp_SoftTrigScan(trig, ring, size - first, events + num, max - num);
+}
@@ -0,0 +1,107 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya library software trigger module interface
+ *
+ * Advanced trigger conditions the FPGA does not have, evaluated on raw
+ * int16 samples: RX DMA segments, the acquisition ring or any other stream.
+ * Blocks are scanned in order and the state carries over, so a condition
+ * may span blocks. Trigger positions count samples since the last reset
+ * and are interpolated between the two samples around the crossing.
+ *
+ * A condition is built from one or two comparators, on level and on
+ * level_hi. A comparator goes high at its level and low again only below
+ * level - hysteresis, so noise around a level gives one crossing.
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+#ifndef __SOFT_TRIG_H
+#define __SOFT_TRIG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "common.h"
+
+typedef enum {
+    /** Pulse above level, below if negative, width_min to width_max long;
+     *  at its end */
+    RP_SOFT_TRIG_PULSE_WIDTH,
+    /** Pulse above level not reaching level_hi, below level_hi not reaching
+     *  level if negative; at its end */
+    RP_SOFT_TRIG_RUNT,
+    /** Leaving [level, level_hi], entering if negative; after width_min to
+     *  width_max samples in the other region, no qualifier if both are 0 */
+    RP_SOFT_TRIG_WINDOW,
+    /** Staying above level, below if negative, for width_min samples; then */
+    RP_SOFT_TRIG_TIMEOUT,
+    /** Rising from level to level_hi, falling if negative, in width_min to
+     *  width_max samples; at level_hi (level) */
+    RP_SOFT_TRIG_SLOPE
+} rp_soft_trig_mode_t;
+
+typedef struct {
+    rp_soft_trig_mode_t mode;
+    bool     negative;    ///< pulses below level, falling slopes, entering the window
+    int16_t  level;
+    int16_t  level_hi;    ///< runt, window & slope, above level
+    uint16_t hysteresis;
+    uint32_t width_min;   ///< samples
+    uint32_t width_max;   ///< samples, 0 - no limit
+} rp_soft_trig_cfg_t;
+
+typedef struct {
+    double   pos;         ///< samples since reset, interpolated
+    float    width;       ///< qualified interval: pulse width, slope, time in the region
+} rp_soft_trig_event_t;
+
+typedef struct {
+    int16_t  up;          ///< goes high at and above
+    int16_t  dn;          ///< goes low at and below
+    bool     state;
+} rp_soft_trig_cmp_t;
+
+typedef struct {
+    rp_soft_trig_cfg_t cfg;
+    rp_soft_trig_cmp_t cmp[2];   ///< on level, on level_hi
+    uint32_t cmp_num;
+    uint64_t pos;         ///< samples scanned since reset
+    int16_t  prev;        ///< last sample scanned
+    bool     started;     ///< start of the interval seen
+    bool     far;         ///< runt: the far level crossed
+    bool     inside;      ///< window: in it
+    double   start;       ///< interval start
+    uint64_t events;
+    uint64_t missed;      ///< events not returned, no room for them
+} rp_soft_trig_t;
+
+int rp_SoftTrigInit(rp_soft_trig_t *trig, const rp_soft_trig_cfg_t *cfg);
+
+/**
+ * Forgets the samples scanned, the next one is sample 0.
+ */
+int rp_SoftTrigReset(rp_soft_trig_t *trig);
+
+/**
+ * Scans the next samples of the stream.
+ * @param events Up to max triggers found, the rest counted in trig->missed.
+ * @return Number of events returned.
+ */
+int rp_SoftTrigScan(rp_soft_trig_t *trig, const int16_t *samples, uint32_t size,
+                    rp_soft_trig_event_t *events, uint32_t max);
+
+/**
+ * Scans the next samples of the stream out of a ring buffer, e.g. the
+ * acquisition buffer, size samples from start on, wrapping at ring_size.
+ * @return Number of events returned, -1 if start or size exceed the ring.
+ */
+int rp_SoftTrigScanRing(rp_soft_trig_t *trig, const int16_t *ring, uint32_t ring_size,
+                        uint32_t start, uint32_t size, rp_soft_trig_event_t *events, uint32_t max);
+
+#endif //__SOFT_TRIG_H
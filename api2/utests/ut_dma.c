@@ -0,0 +1,165 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+#include "CUnit/CUCurses.h"
+
+#include "ut_main.h"
+#include "rp_dma.h"
+
+/** Mock of the rpdma device: the driver side writes segment records to a
+ *  pipe, the handle reads them. Like the device, the pipe is readable while
+ *  records are pending and hangs up (read returns 0) once closed, as RX
+ *  stopped. */
+typedef struct {
+    rp_handle_uio_t handle;
+    int             drv_fd;
+    uint32_t        seq;
+} mock_dma_t;
+
+static mock_dma_t mock[2];
+
+static int mockOpen(mock_dma_t *m, uint32_t seq)
+{
+    int fds[2];
+
+    if (pipe(fds) < 0) {
+        return -1;
+    }
+    memset(m, 0, sizeof(*m));
+    m->handle.dma_fd = fds[0];
+    m->drv_fd = fds[1];
+    m->seq = seq;
+    return 0;
+}
+
+static void mockClose(mock_dma_t *m)
+{
+    if (m->drv_fd >= 0) {
+        close(m->drv_fd);
+    }
+    close(m->handle.dma_fd);
+}
+
+/** Segment completion, skip records are dropped as by a slow reader */
+static void mockComplete(mock_dma_t *m, int count, int skip)
+{
+    struct rpdma_event ev;
+    struct timespec ts;
+
+    m->seq += skip;
+    for (int i = 0; i < count; i++, m->seq++) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ev.segment = m->seq % 8;
+        ev.seq = m->seq;
+        ev.timestamp = ts.tv_sec * 1000000000ull + ts.tv_nsec;
+        CU_ASSERT_EQUAL(write(m->drv_fd, &ev, sizeof(ev)), sizeof(ev));
+    }
+}
+
+static void mockStop(mock_dma_t *m)
+{
+    close(m->drv_fd);
+    m->drv_fd = -1;
+}
+
+static double msNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+int suite_dma_init(void)
+{
+    if (mockOpen(&mock[0], 100) < 0 || mockOpen(&mock[1], 0) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int suite_dma_cleanup(void)
+{
+    mockClose(&mock[0]);
+    mockClose(&mock[1]);
+    return 0;
+}
+
+void dma_events_test(void)
+{
+    struct rpdma_event ev[8];
+
+    mockComplete(&mock[0], 5, 0);
+    CU_ASSERT_EQUAL(rp_DmaReadEvents(&mock[0].handle, ev, 3, 100), 3);
+    CU_ASSERT_EQUAL(rp_DmaReadEvents(&mock[0].handle, ev + 3, 5, 100), 2);
+    for (int i = 0; i < 5; i++) {
+        CU_ASSERT_EQUAL(ev[i].seq, 100 + i);
+        CU_ASSERT_EQUAL(ev[i].segment, (100 + i) % 8);
+        if (i) {
+            CU_ASSERT_TRUE(ev[i].timestamp >= ev[i - 1].timestamp);
+        }
+    }
+    CU_ASSERT_EQUAL(mock[0].handle.dma_missed, 0);
+}
+
+void dma_missed_test(void)
+{
+    struct rpdma_event ev[8];
+
+    mockComplete(&mock[0], 1, 0);
+    mockComplete(&mock[0], 2, 3);
+    CU_ASSERT_EQUAL(rp_DmaReadEvents(&mock[0].handle, ev, 8, 100), 3);
+    CU_ASSERT_EQUAL(ev[1].seq, ev[0].seq + 4);
+    CU_ASSERT_EQUAL(mock[0].handle.dma_missed, 3);
+}
+
+void dma_timeout_test(void)
+{
+    struct rpdma_event ev;
+    double t = msNow();
+
+    CU_ASSERT_EQUAL(rp_DmaReadEvents(&mock[0].handle, &ev, 1, 50), 0);
+    CU_ASSERT_TRUE(msNow() - t >= 45);
+}
+
+void dma_poll_many_test(void)
+{
+    struct pollfd pfd[2] = {
+        { .fd = mock[0].handle.dma_fd, .events = POLLIN },
+        { .fd = mock[1].handle.dma_fd, .events = POLLIN },
+    };
+    struct rpdma_event ev[4];
+
+    mockComplete(&mock[1], 2, 0);
+    CU_ASSERT_EQUAL(poll(pfd, 2, 100), 1);
+    CU_ASSERT_FALSE(pfd[0].revents & POLLIN);
+    CU_ASSERT_TRUE(pfd[1].revents & POLLIN);
+    CU_ASSERT_EQUAL(rp_DmaReadEvents(&mock[1].handle, ev, 4, 0), 2);
+    CU_ASSERT_EQUAL(ev[0].seq, 0);
+    CU_ASSERT_EQUAL(ev[1].segment, 1);
+}
+
+void dma_stop_test(void)
+{
+    struct rpdma_event ev[4];
+    double t;
+
+    // records still pending when stopped are read first
+    mockComplete(&mock[1], 1, 0);
+    mockStop(&mock[1]);
+    CU_ASSERT_EQUAL(rp_DmaReadEvents(&mock[1].handle, ev, 4, 1000), 1);
+    t = msNow();
+    CU_ASSERT_EQUAL(rp_DmaReadEvents(&mock[1].handle, ev, 4, 1000), 0);
+    // blocking read returns once stopped
+    CU_ASSERT_EQUAL(rp_DmaRead(&mock[1].handle), RP_OK);
+    CU_ASSERT_TRUE(msNow() - t < 100);
+    CU_ASSERT_EQUAL(mock[1].handle.dma_missed, 0);
+}
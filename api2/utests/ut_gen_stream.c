@@ -0,0 +1,298 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+#include "CUnit/CUCurses.h"
+
+#include "ut_main.h"
+#include "gen_stream.h"
+
+/** Simulated TX DMA: plays a segment every SIM_PERIOD_US and checks that
+ *  every segment continues the samples of the previous new one */
+#define SIM_SGMNT_CNT  8
+#define SIM_SGMNT_LEN  1024
+#define SIM_PERIOD_US  500
+#define SIM_FILE       "/tmp/ut_gen_stream.bin"
+
+typedef struct {
+    int16_t         mem[SIM_SGMNT_CNT * SIM_SGMNT_LEN];
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    bool            run;
+    bool            started;
+    uint32_t        done;
+    uint16_t        next;    ///< next sample of the stream
+    uint64_t        fresh;   ///< samples continuing the stream
+    uint32_t        stale;   ///< segments played again
+    uint32_t        silent;  ///< zero segments after the end
+    uint32_t        gaps;    ///< segments not continuing the stream
+    uint32_t        errors;  ///< segments not continuous inside
+} sim_tx_t;
+
+static sim_tx_t sim;
+
+static bool simZero(const int16_t *seg, int len) {
+    for (int i = 0; i < len; i++) {
+        if (seg[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void simCheck(const int16_t *seg) {
+    int16_t diff = (uint16_t) seg[0] - sim.next;
+
+    if (diff && simZero(seg, SIM_SGMNT_LEN)) {
+        sim.silent++;
+        return;
+    }
+    if (diff < 0) {
+        sim.stale++;
+        return;
+    }
+    if (diff > 0) {
+        sim.gaps++;
+        sim.next = seg[0];
+    }
+    for (int i = 0; i < SIM_SGMNT_LEN; i++, sim.next++, sim.fresh++) {
+        if ((uint16_t) seg[i] != sim.next) {
+            // the end of the stream is padded with zeros
+            if (!simZero(seg + i, SIM_SGMNT_LEN - i)) {
+                sim.errors++;
+            }
+            break;
+        }
+    }
+}
+
+static void *simThread(void *arg) {
+    uint32_t idx;
+
+    for (;;) {
+        pthread_mutex_lock(&sim.lock);
+        if (!sim.run) {
+            pthread_mutex_unlock(&sim.lock);
+            break;
+        }
+        idx = sim.done % SIM_SGMNT_CNT;
+        pthread_mutex_unlock(&sim.lock);
+
+        simCheck(sim.mem + idx * SIM_SGMNT_LEN);
+        usleep(SIM_PERIOD_US);
+
+        pthread_mutex_lock(&sim.lock);
+        sim.done++;
+        pthread_cond_broadcast(&sim.cond);
+        pthread_mutex_unlock(&sim.lock);
+    }
+    return NULL;
+}
+
+static int simStart(void *ctx) {
+    sim.run = true;
+    sim.started = true;
+    sim.done = 0;
+    if (pthread_create(&sim.thread, NULL, simThread, NULL) != 0) {
+        return RP_EOOR;
+    }
+    return RP_OK;
+}
+
+static int simStop(void *ctx) {
+    bool join;
+
+    pthread_mutex_lock(&sim.lock);
+    sim.run = false;
+    join = sim.started;
+    sim.started = false;
+    pthread_cond_broadcast(&sim.cond);
+    pthread_mutex_unlock(&sim.lock);
+    if (join) {
+        pthread_join(sim.thread, NULL);
+    }
+    return RP_OK;
+}
+
+static int simWait(void *ctx, uint32_t *done) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec++;
+    pthread_mutex_lock(&sim.lock);
+    while (sim.run && sim.done == *done) {
+        if (pthread_cond_timedwait(&sim.cond, &sim.lock, &ts)) {
+            break;
+        }
+    }
+    *done = sim.done;
+    pthread_mutex_unlock(&sim.lock);
+    return RP_OK;
+}
+
+static rp_gen_stream_t stream;
+
+/** Counting samples source, stalls once for longer than the ring */
+typedef struct {
+    uint64_t pos;
+    uint64_t len;
+    uint64_t stall_at;
+} seq_src_t;
+
+static int seqFill(void *ctx, int16_t *buf, uint32_t samples) {
+    seq_src_t *src = (seq_src_t *) ctx;
+    uint32_t n;
+
+    if (src->stall_at && src->pos >= src->stall_at) {
+        src->stall_at = 0;
+        usleep(2 * SIM_SGMNT_CNT * SIM_PERIOD_US);
+    }
+    for (n = 0; n < samples && src->pos < src->len; n++, src->pos++) {
+        buf[n] = (int16_t) src->pos;
+    }
+    return n;
+}
+
+static void simReset(void) {
+    memset(sim.mem, 0, sizeof(sim.mem));
+    sim.next = 0;
+    sim.fresh = 0;
+    sim.stale = 0;
+    sim.silent = 0;
+    sim.gaps = 0;
+    sim.errors = 0;
+}
+
+int suite_gen_stream_init(void)
+{
+    rp_gen_stream_dev_t dev = {
+        .mem = sim.mem,
+        .sgmnt_cnt = SIM_SGMNT_CNT,
+        .sgmnt_size = SIM_SGMNT_LEN * sizeof(int16_t),
+        .ctx = &sim,
+        .start = simStart,
+        .stop = simStop,
+        .wait = simWait,
+    };
+
+    pthread_mutex_init(&sim.lock, NULL);
+    pthread_cond_init(&sim.cond, NULL);
+    if(rp_GenStreamOpenDev(&stream, &dev)!=RP_OK){
+        return -1;
+    }
+    return 0;
+}
+
+int suite_gen_stream_cleanup(void)
+{
+    unlink(SIM_FILE);
+    if(rp_GenStreamClose(&stream)!=RP_OK){
+        return -1;
+    }
+    return 0;
+}
+
+static void playSeq(uint64_t len, uint64_t stall_at, rp_gen_stream_status_t *status)
+{
+    seq_src_t src = { 0, len, stall_at };
+
+    simReset();
+    CU_ASSERT_EQUAL(rp_GenStreamSetSource(&stream, seqFill, &src), RP_OK);
+    CU_ASSERT_EQUAL(rp_GenStreamStart(&stream), RP_OK);
+    CU_ASSERT_EQUAL(rp_GenStreamWaitEnd(&stream), RP_OK);
+    CU_ASSERT_EQUAL(rp_GenStreamStop(&stream), RP_OK);
+    rp_GenStreamGetStatus(&stream, status);
+}
+
+void gen_stream_continuity_test(void)
+{
+    rp_gen_stream_status_t status;
+    uint64_t len = 300 * SIM_SGMNT_LEN + 517;
+
+    playSeq(len, 0, &status);
+    CU_ASSERT_EQUAL(status.samples, len);
+    CU_ASSERT_EQUAL(status.underruns, 0);
+    CU_ASSERT_FALSE(status.running);
+    CU_ASSERT_EQUAL(sim.fresh, len);
+    CU_ASSERT_EQUAL(sim.stale, 0);
+    CU_ASSERT_EQUAL(sim.gaps, 0);
+    CU_ASSERT_EQUAL(sim.errors, 0);
+}
+
+void gen_stream_underrun_test(void)
+{
+    rp_gen_stream_status_t status;
+    uint64_t len = 100 * SIM_SGMNT_LEN;
+
+    playSeq(len, 50 * SIM_SGMNT_LEN, &status);
+    printf("\r\nunderruns %u, stale segments %u", status.underruns, sim.stale);
+    CU_ASSERT_TRUE(status.underruns > 0);
+    CU_ASSERT_EQUAL(sim.stale, status.underruns);
+    // no samples lost, the stream continues after the replayed segments
+    CU_ASSERT_EQUAL(sim.fresh, len);
+    CU_ASSERT_EQUAL(sim.gaps, 0);
+    CU_ASSERT_EQUAL(sim.errors, 0);
+}
+
+static int writeSeqFile(uint64_t len)
+{
+    FILE *f = fopen(SIM_FILE, "wb");
+    if (f == NULL) {
+        return -1;
+    }
+    for (uint64_t i = 0; i < len; i++) {
+        int16_t x = (int16_t) i;
+        fwrite(&x, sizeof(x), 1, f);
+    }
+    fclose(f);
+    return 0;
+}
+
+void gen_stream_file_test(void)
+{
+    rp_gen_stream_status_t status;
+    uint64_t len = 100 * SIM_SGMNT_LEN + 3;
+
+    simReset();
+    CU_ASSERT_EQUAL(writeSeqFile(len), 0);
+    CU_ASSERT_EQUAL(rp_GenStreamSetFile(&stream, SIM_FILE, false), RP_OK);
+    CU_ASSERT_EQUAL(rp_GenStreamStart(&stream), RP_OK);
+    CU_ASSERT_EQUAL(rp_GenStreamWaitEnd(&stream), RP_OK);
+    rp_GenStreamGetStatus(&stream, &status);
+    CU_ASSERT_EQUAL(status.samples, len);
+    CU_ASSERT_EQUAL(status.underruns, 0);
+    CU_ASSERT_EQUAL(sim.fresh, len);
+    CU_ASSERT_EQUAL(sim.gaps + sim.stale + sim.errors, 0);
+    CU_ASSERT_EQUAL(rp_GenStreamStop(&stream), RP_OK);
+}
+
+void gen_stream_file_loop_test(void)
+{
+    rp_gen_stream_status_t status;
+
+    // one period of the 16 bit counter continues itself when looped
+    simReset();
+    CU_ASSERT_EQUAL(writeSeqFile(1 << 16), 0);
+    CU_ASSERT_EQUAL(rp_GenStreamSetFile(&stream, SIM_FILE, true), RP_OK);
+    CU_ASSERT_EQUAL(rp_GenStreamStart(&stream), RP_OK);
+    do {
+        usleep(10000);
+        rp_GenStreamGetStatus(&stream, &status);
+    } while (status.running && status.played < 200);
+    CU_ASSERT_EQUAL(rp_GenStreamStop(&stream), RP_OK);
+    rp_GenStreamGetStatus(&stream, &status);
+    CU_ASSERT_TRUE(status.samples > (1 << 16));
+    CU_ASSERT_EQUAL(status.underruns, 0);
+    CU_ASSERT_TRUE(sim.fresh >= 200 * SIM_SGMNT_LEN);
+    CU_ASSERT_EQUAL(sim.gaps + sim.stale + sim.silent + sim.errors, 0);
+}
@@ -32,6 +32,38 @@ CU_TestInfo sig_gen_test_array[] = {
   CU_TEST_INFO_NULL,
 };
 
+/** gen stream test */
+CU_TestInfo gen_stream_test_array[] = {
+  { "gen_stream_continuity_test", gen_stream_continuity_test},
+  { "gen_stream_underrun_test", gen_stream_underrun_test},
+  { "gen_stream_file_test", gen_stream_file_test},
+  { "gen_stream_file_loop_test", gen_stream_file_loop_test},
+  CU_TEST_INFO_NULL,
+};
+
+/** dma test */
+CU_TestInfo dma_test_array[] = {
+  { "dma_events_test", dma_events_test},
+  { "dma_missed_test", dma_missed_test},
+  { "dma_timeout_test", dma_timeout_test},
+  { "dma_poll_many_test", dma_poll_many_test},
+  { "dma_stop_test", dma_stop_test},
+  CU_TEST_INFO_NULL,
+};
+
+/** soft trigger test */
+CU_TestInfo soft_trig_test_array[] = {
+  { "soft_trig_pulse_width_test", soft_trig_pulse_width_test},
+  { "soft_trig_runt_test", soft_trig_runt_test},
+  { "soft_trig_window_test", soft_trig_window_test},
+  { "soft_trig_timeout_test", soft_trig_timeout_test},
+  { "soft_trig_slope_test", soft_trig_slope_test},
+  { "soft_trig_hysteresis_test", soft_trig_hysteresis_test},
+  { "soft_trig_ring_test", soft_trig_ring_test},
+  { "soft_trig_rate_test", soft_trig_rate_test},
+  CU_TEST_INFO_NULL,
+};
+
 // add new tests here
 
 /** suite table */
@@ -39,6 +71,9 @@ CU_SuiteInfo suites[] = {
 //  { "SuiteExampleTest", init_example_suite, clean_example_suite, example_test_array},
   { "suite_la_acq_test", suite_la_acq_init, suite_la_acq_cleanup, la_acq_test_array},
 //  { "suite_sig_gen_test", suite_sig_gen_init, suite_sig_gen_cleanup, sig_gen_test_array},
+  { "suite_gen_stream_test", suite_gen_stream_init, suite_gen_stream_cleanup, gen_stream_test_array},
+  { "suite_dma_test", suite_dma_init, suite_dma_cleanup, dma_test_array},
+  { "suite_soft_trig_test", suite_soft_trig_init, suite_soft_trig_cleanup, soft_trig_test_array},
   // add new suite here
   CU_SUITE_INFO_NULL,
 };
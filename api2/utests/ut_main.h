@@ -24,6 +24,32 @@ int suite_sig_gen_init(void);
 int suite_sig_gen_cleanup(void);
 void sig_gen_test(void);
 
+int suite_gen_stream_init(void);
+int suite_gen_stream_cleanup(void);
+void gen_stream_continuity_test(void);
+void gen_stream_underrun_test(void);
+void gen_stream_file_test(void);
+void gen_stream_file_loop_test(void);
+
+int suite_dma_init(void);
+int suite_dma_cleanup(void);
+void dma_events_test(void);
+void dma_missed_test(void);
+void dma_timeout_test(void);
+void dma_poll_many_test(void);
+void dma_stop_test(void);
+
+int suite_soft_trig_init(void);
+int suite_soft_trig_cleanup(void);
+void soft_trig_pulse_width_test(void);
+void soft_trig_runt_test(void);
+void soft_trig_window_test(void);
+void soft_trig_timeout_test(void);
+void soft_trig_slope_test(void);
+void soft_trig_hysteresis_test(void);
+void soft_trig_ring_test(void);
+void soft_trig_rate_test(void);
+
 
 #endif // __UT_MAIN_H
 
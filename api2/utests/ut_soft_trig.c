@@ -0,0 +1,313 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+#include "CUnit/CUCurses.h"
+
+#include "ut_main.h"
+#include "soft_trig.h"
+
+/** Synthetic streams are piecewise linear between knots at whole samples,
+ *  with slopes of whole counts, so crossings interpolate exactly */
+#define SIG_LEN     8192
+#define SIG_LOW    -1000
+#define SIG_HIGH    1000
+#define EDGE        8          ///< samples of an edge, 250 counts each
+#define BLOCK       777        ///< scanned in blocks of odd size
+#define EVENTS_MAX  64
+#define RATE_LEN    (1 << 24)
+#define EPS         1e-6
+
+typedef struct {
+    uint32_t t;
+    int16_t  v;
+} knot_t;
+
+static int16_t sig[SIG_LEN];
+static rp_soft_trig_event_t ev[EVENTS_MAX];
+
+static void sigLinear(const knot_t *k, int n)
+{
+    uint32_t t = 0;
+
+    for (int i = 1; i < n; i++) {
+        for (; t < k[i].t && t < SIG_LEN; t++) {
+            sig[t] = k[i - 1].v + (int32_t)(k[i].v - k[i - 1].v) * (int32_t)(t - k[i - 1].t) /
+                     (int32_t)(k[i].t - k[i - 1].t);
+        }
+    }
+    for (; t < SIG_LEN; t++) {
+        sig[t] = k[n - 1].v;
+    }
+}
+
+/** Knots of pulses to height, t1 - t0 apart edge to edge */
+static int sigPulse(knot_t *k, int n, uint32_t t0, uint32_t t1, int16_t height)
+{
+    k[n++] = (knot_t) { t0, SIG_LOW };
+    k[n++] = (knot_t) { t0 + EDGE, height };
+    k[n++] = (knot_t) { t1, height };
+    k[n++] = (knot_t) { t1 + EDGE, SIG_LOW };
+    return n;
+}
+
+/** Scans sig in blocks */
+static int scan(const rp_soft_trig_cfg_t *cfg, rp_soft_trig_t *trig)
+{
+    int num = 0;
+
+    CU_ASSERT_EQUAL(rp_SoftTrigInit(trig, cfg), RP_OK);
+    for (uint32_t i = 0; i < SIG_LEN; i += BLOCK) {
+        uint32_t len = SIG_LEN - i < BLOCK ? SIG_LEN - i : BLOCK;
+        num += rp_SoftTrigScan(trig, sig + i, len, ev + num, EVENTS_MAX - num);
+    }
+    CU_ASSERT_EQUAL(trig->pos, SIG_LEN);
+    return num;
+}
+
+int suite_soft_trig_init(void)
+{
+    return 0;
+}
+
+int suite_soft_trig_cleanup(void)
+{
+    return 0;
+}
+
+void soft_trig_pulse_width_test(void)
+{
+    rp_soft_trig_cfg_t cfg = { .mode = RP_SOFT_TRIG_PULSE_WIDTH, .level = 0,
+                               .hysteresis = 100, .width_min = 50, .width_max = 150 };
+    rp_soft_trig_t trig;
+    knot_t k[32];
+    int n = 0;
+
+    k[n++] = (knot_t) { 0, SIG_LOW };
+    n = sigPulse(k, n, 100, 120, SIG_HIGH);
+    n = sigPulse(k, n, 1000, 1060, SIG_HIGH);   // across a block boundary
+    n = sigPulse(k, n, 3000, 3100, SIG_HIGH);
+    n = sigPulse(k, n, 5000, 5300, SIG_HIGH);
+    sigLinear(k, n);
+
+    // up at level, t0 + 4; down at level - hysteresis, t1 + 4.4
+    CU_ASSERT_EQUAL(scan(&cfg, &trig), 2);
+    CU_ASSERT_DOUBLE_EQUAL(ev[0].pos, 1064.4, EPS);
+    CU_ASSERT_DOUBLE_EQUAL(ev[0].width, 60.4, 1e-4);
+    CU_ASSERT_DOUBLE_EQUAL(ev[1].pos, 3104.4, EPS);
+    CU_ASSERT_DOUBLE_EQUAL(ev[1].width, 100.4, 1e-4);
+    CU_ASSERT_EQUAL(trig.events, 2);
+
+    // negative pulses: down at level - hysteresis, up at level
+    for (int i = 0; i < SIG_LEN; i++) {
+        sig[i] = -sig[i];
+    }
+    cfg.negative = true;
+    CU_ASSERT_EQUAL(scan(&cfg, &trig), 2);
+    CU_ASSERT_DOUBLE_EQUAL(ev[0].pos, 1064, EPS);
+    CU_ASSERT_DOUBLE_EQUAL(ev[0].width, 59.6, 1e-4);
+    CU_ASSERT_DOUBLE_EQUAL(ev[1].pos, 3104, EPS);
+}
+
+void soft_trig_runt_test(void)
+{
+    rp_soft_trig_cfg_t cfg = { .mode = RP_SOFT_TRIG_RUNT, .level = 0, .level_hi = 800 };
+    rp_soft_trig_t trig;
+    knot_t k[32];
+    int n = 0;
+
+    k[n++] = (knot_t) { 0, SIG_LOW };
+    n = sigPulse(k, n, 100, 200, SIG_HIGH);
+    n = sigPulse(k, n, 1000, 1100, 500);                // runt
+    n = sigPulse(k, n, 2000, 2100, SIG_HIGH);
+    n = sigPulse(k, n, 4000, 4100, 600);                // runt
+    sigLinear(k, n);
+
+    CU_ASSERT_EQUAL(scan(&cfg, &trig), 2);
+    CU_ASSERT_TRUE(ev[0].pos > 1100 && ev[0].pos < 1100 + EDGE);
+    // up at 4005, down at 4103, 200 counts per sample
+    CU_ASSERT_DOUBLE_EQUAL(ev[1].pos, 4103, EPS);
+    CU_ASSERT_DOUBLE_EQUAL(ev[1].width, 98, EPS);
+
+    // negative runts do not reach level from level_hi
+    for (int i = 0; i < SIG_LEN; i++) {
+        sig[i] = 900 - sig[i];
+    }
+    cfg.negative = true;
+    CU_ASSERT_EQUAL(scan(&cfg, &trig), 2);
+    CU_ASSERT_TRUE(ev[0].pos > 1100 && ev[0].pos < 1100 + EDGE);
+    CU_ASSERT_TRUE(ev[1].pos > 4100 && ev[1].pos < 4100 + EDGE);
+}
+
+void soft_trig_window_test(void)
+{
+    rp_soft_trig_cfg_t cfg = { .mode = RP_SOFT_TRIG_WINDOW, .level = -500, .level_hi = 500 };
+    rp_soft_trig_t trig;
+    // low, into the window, out above, back in, out below, through it
+    knot_t k[] = {
+        { 0, SIG_LOW }, { 100, SIG_LOW }, { 108, 0 }, { 300, 0 }, { 308, SIG_HIGH },
+        { 500, SIG_HIGH }, { 508, 0 }, { 2000, 0 }, { 2008, SIG_LOW }, { 3000, SIG_LOW },
+        { 3008, SIG_HIGH }
+    };
+    sigLinear(k, sizeof(k) / sizeof(k[0]));
+
+    // leaving: at 500 (304), at -500 (2004), at 500 on the way through (3006)
+    CU_ASSERT_EQUAL(scan(&cfg, &trig), 3);
+    CU_ASSERT_DOUBLE_EQUAL(ev[0].pos, 304, EPS);
+    CU_ASSERT_DOUBLE_EQUAL(ev[1].pos, 2004, EPS);
+    CU_ASSERT_DOUBLE_EQUAL(ev[2].pos, 3006, EPS);
+    CU_ASSERT_DOUBLE_EQUAL(ev[2].width, 4, EPS);
+
+    // entering, after at least 100 samples outside
+    cfg.negative = true;
+    cfg.width_min = 100;
+    CU_ASSERT_EQUAL(scan(&cfg, &trig), 2);
+    CU_ASSERT_DOUBLE_EQUAL(ev[0].pos, 504, EPS);
+    CU_ASSERT_DOUBLE_EQUAL(ev[0].width, 200, EPS);
+    CU_ASSERT_DOUBLE_EQUAL(ev[1].pos, 3002, EPS);
+}
+
+void soft_trig_timeout_test(void)
+{
+    rp_soft_trig_cfg_t cfg = { .mode = RP_SOFT_TRIG_TIMEOUT, .level = 0, .hysteresis = 100,
+                               .width_min = 500 };
+    rp_soft_trig_t trig;
+    knot_t k[32];
+    int n = 0;
+
+    k[n++] = (knot_t) { 0, SIG_LOW };
+    n = sigPulse(k, n, 100, 400, SIG_HIGH);
+    n = sigPulse(k, n, 1200, 1900, SIG_HIGH);   // expires in the next block
+    n = sigPulse(k, n, 3000, 8000, SIG_HIGH);   // once only
+    sigLinear(k, n);
+
+    CU_ASSERT_EQUAL(scan(&cfg, &trig), 2);
+    CU_ASSERT_DOUBLE_EQUAL(ev[0].pos, 1704, EPS);
+    CU_ASSERT_DOUBLE_EQUAL(ev[1].pos, 3504, EPS);
+    CU_ASSERT_EQUAL(trig.events, 2);
+
+    cfg.width_min = 0;
+    CU_ASSERT_EQUAL(rp_SoftTrigInit(&trig, &cfg), RP_EOOR);
+}
+
+void soft_trig_slope_test(void)
+{
+    rp_soft_trig_cfg_t cfg = { .mode = RP_SOFT_TRIG_SLOPE, .level = -500, .level_hi = 500,
+                               .width_max = 10 };
+    rp_soft_trig_t trig;
+    // fast & slow rising and falling edges, 2000 counts in 8 & 40 samples
+    knot_t k[] = {
+        { 0, SIG_LOW }, { 100, SIG_LOW }, { 108, SIG_HIGH }, { 1000, SIG_HIGH }, { 1008, SIG_LOW },
+        { 2000, SIG_LOW }, { 2040, SIG_HIGH }, { 3000, SIG_HIGH }, { 3040, SIG_LOW }
+    };
+    sigLinear(k, sizeof(k) / sizeof(k[0]));
+
+    CU_ASSERT_EQUAL(scan(&cfg, &trig), 1);
+    CU_ASSERT_DOUBLE_EQUAL(ev[0].pos, 106, EPS);
+    CU_ASSERT_DOUBLE_EQUAL(ev[0].width, 4, EPS);
+
+    cfg.negative = true;
+    cfg.width_min = 15;
+    cfg.width_max = 0;
+    CU_ASSERT_EQUAL(scan(&cfg, &trig), 1);
+    CU_ASSERT_DOUBLE_EQUAL(ev[0].pos, 3030, EPS);
+    CU_ASSERT_DOUBLE_EQUAL(ev[0].width, 20, EPS);
+}
+
+void soft_trig_hysteresis_test(void)
+{
+    rp_soft_trig_cfg_t cfg = { .mode = RP_SOFT_TRIG_PULSE_WIDTH, .level = 0, .hysteresis = 200 };
+    rp_soft_trig_t trig;
+
+    // slow sine, period 1024, with +-90 of noise at every sample
+    for (int i = 0; i < SIG_LEN; i++) {
+        sig[i] = 1000 * sin(2 * M_PI * i / 1024) + (i % 2 ? 90 : -90);
+    }
+    CU_ASSERT_EQUAL(scan(&cfg, &trig), SIG_LEN / 1024);
+
+    cfg.hysteresis = 0;
+    CU_ASSERT_TRUE(scan(&cfg, &trig) > SIG_LEN / 1024);
+}
+
+void soft_trig_ring_test(void)
+{
+    rp_soft_trig_cfg_t cfg = { .mode = RP_SOFT_TRIG_PULSE_WIDTH, .level = 0 };
+    rp_soft_trig_event_t ring_ev[EVENTS_MAX];
+    rp_soft_trig_t trig;
+    knot_t k[32];
+    int n = 0, num = 0;
+
+    k[n++] = (knot_t) { 0, SIG_LOW };
+    n = sigPulse(k, n, 100, 200, SIG_HIGH);
+    sigLinear(k, n);
+    int ref = scan(&cfg, &trig);
+
+    // the same stream out of the ring from 8000 on, the pulse across the wrap
+    static int16_t ring[SIG_LEN];
+    for (int i = 0; i < SIG_LEN; i++) {
+        ring[(8000 + i) % SIG_LEN] = sig[i];
+    }
+    CU_ASSERT_EQUAL(rp_SoftTrigInit(&trig, &cfg), RP_OK);
+    for (uint32_t i = 0; i < SIG_LEN; i += 1000) {
+        uint32_t len = SIG_LEN - i < 1000 ? SIG_LEN - i : 1000;
+        num += rp_SoftTrigScanRing(&trig, ring, SIG_LEN, (8000 + i) % SIG_LEN, len,
+                                   ring_ev + num, EVENTS_MAX - num);
+    }
+    CU_ASSERT_EQUAL(num, ref);
+    CU_ASSERT_EQUAL(num, 1);
+    CU_ASSERT_DOUBLE_EQUAL(ring_ev[0].pos, ev[0].pos, EPS);
+    CU_ASSERT_EQUAL(rp_SoftTrigScanRing(&trig, ring, SIG_LEN, SIG_LEN, 1, ring_ev, 1), -1);
+}
+
+static double rate(const int16_t *x, const rp_soft_trig_cfg_t *cfg, uint64_t *events)
+{
+    static rp_soft_trig_event_t many[4096];
+    rp_soft_trig_t trig;
+    struct timespec t0, t1;
+
+    rp_SoftTrigInit(&trig, cfg);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t i = 0; i < RATE_LEN; i += 1 << 16) {
+        rp_SoftTrigScan(&trig, x + i, 1 << 16, many, 4096);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    *events = trig.events;
+    return RATE_LEN / (t1.tv_sec - t0.tv_sec + (t1.tv_nsec - t0.tv_nsec) * 1e-9);
+}
+
+void soft_trig_rate_test(void)
+{
+    rp_soft_trig_cfg_t cfg = { .mode = RP_SOFT_TRIG_PULSE_WIDTH, .level = 2000, .hysteresis = 200,
+                               .width_min = 20, .width_max = 40 };
+    int16_t *x = malloc(RATE_LEN * sizeof(int16_t));
+    uint64_t events;
+
+    CU_ASSERT_PTR_NOT_NULL(x);
+    if (x == NULL) {
+        return;
+    }
+    // noise of +-500 counts, a 30 samples pulse every 10000
+    srand(1);
+    for (uint32_t i = 0; i < RATE_LEN; i++) {
+        x[i] = rand() % 1001 - 500 + (i % 10000 < 30 ? 4000 : 0);
+    }
+    double pulses = rate(x, &cfg, &events);
+    // the first pulse has no start
+    CU_ASSERT_EQUAL(events, (RATE_LEN - 30) / 10000);
+
+    // noise around the level, a crossing every few samples
+    cfg.level = 0;
+    double noise = rate(x, &cfg, &events);
+    printf("\r\nsamples/s per core: %.0f M sparse events, %.0f M noise around the level",
+           pulses / 1e6, noise / 1e6);
+    CU_ASSERT_TRUE(pulses > noise);
+    free(x);
+}
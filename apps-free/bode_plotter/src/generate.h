@@ -45,4 +45,7 @@ int generate_exit(void);
 
 int generate_update(rp_app_params_t *params);
 
+void write_data_fpga(uint32_t ch, int mode, int trigger, const int32_t *data,
+                     const awg_param_t *awg, int wrap);
+
 #endif // __GENERATE_H
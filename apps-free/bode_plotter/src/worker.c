@@ -23,6 +23,8 @@
 
 #include "worker.h"
 #include "fpga.h"
+#include "generate.h"
+#include "bode_sweep.h"
 
 pthread_t *rp_osc_thread_handler = NULL;
 void *rp_osc_worker_thread(void *args);
@@ -46,8 +48,6 @@ int                  *rp_fpga_cha_signal, *rp_fpga_chb_signal;
 /* Calibration parameters read from EEPROM */
 rp_calib_params_t *rp_calib_params = NULL;
 
-int counter = 0;
-
 
 /*----------------------------------------------------------------------------------*/
 int rp_osc_worker_init(rp_app_params_t *params, int params_len,
@@ -259,6 +259,138 @@ int rp_osc_set_meas_data(rp_osc_meas_res_t ch1_meas, rp_osc_meas_res_t ch2_meas)
 }
 
 
+/*----------------------------------------------------------------------------------*/
+
+/* Bode sweep, run by the worker thread. Points are published as they are
+ * measured and kept for plotting until the next sweep. */
+#define BODE_POINTS_MAX 1024 /* Max. bode_counts */
+
+static bode_point_t bode_points[BODE_POINTS_MAX];
+static int          bode_points_num = 0;
+
+/* Plot signals of the first num points, amplitude or phase as selected */
+static void bode_plot_points(int num, float *t, float *cha_s, float *chb_s)
+{
+    int out_idx;
+
+    for(out_idx = 0; out_idx < num; out_idx++) {
+        t[out_idx] = bode_points[out_idx].freq;
+        if(rp_get_params_bode(8) == 0)
+            cha_s[out_idx] = bode_points[out_idx].amplitude;
+        else
+            cha_s[out_idx] = bode_points[out_idx].phase;
+        chb_s[out_idx] = -1;
+    }
+}
+
+/* Sweep backend: generator through the AWG */
+static int bode_generate(void *ctx, unsigned int ch, const int32_t *data,
+                         const bode_awg_param_t *awg)
+{
+    awg_param_t param = { awg->offsgain, awg->wrap, awg->step };
+
+    write_data_fpga(ch, 0, 0, data, &param, 0);
+    usleep(1000);
+    return 0;
+}
+
+/* Sweep backend: immediately triggered acquisition of both inputs */
+static int bode_acquire(void *ctx, int dec_idx, uint32_t size,
+                        float *ch1, float *ch2)
+{
+    const int sign = 1 << (c_osc_fpga_adc_bits - 1);
+    int retries = 150000;
+    int wr_ptr_trig, in_idx, cnt;
+    uint32_t i;
+
+    osc_fpga_reset();
+    if(osc_fpga_update_params(1, 0, 0, 0, 0, dec_idx, 1, 1,
+                              0, 0, 0, 0, 0, 0, 0, 0, 1) < 0) {
+        fprintf(stderr, "Setting of FPGA registers failed\n");
+        return -1;
+    }
+    osc_fpga_arm_trigger();
+    osc_fpga_set_trigger(osc_fpga_cnv_trig_source(1, 0, 0));
+
+    /* The buffer after the trigger is written when the trigger clears */
+    while(!osc_fpga_triggered()) {
+        if(retries-- == 0) {
+            fprintf(stderr, "Signal acquisition was not triggered!\n");
+            return -1;
+        }
+        usleep(1000);
+    }
+
+    osc_fpga_get_wr_ptr(NULL, &wr_ptr_trig);
+    /* Additional FPGA delay when decimation is enabled */
+    if(bode_dec[dec_idx] == 1)
+        in_idx = wr_ptr_trig + 3;
+    else if(bode_dec[dec_idx] > 8192)
+        in_idx = wr_ptr_trig;
+    else
+        in_idx = wr_ptr_trig + 1;
+
+    for(i = 0; i < size; i++, in_idx++) {
+        in_idx %= OSC_FPGA_SIG_LEN;
+        cnt = rp_fpga_cha_signal[in_idx] & ((sign << 1) - 1);
+        ch1[i] = (cnt & sign) ? cnt - (sign << 1) : cnt;
+        cnt = rp_fpga_chb_signal[in_idx] & ((sign << 1) - 1);
+        ch2[i] = (cnt & sign) ? cnt - (sign << 1) : cnt;
+    }
+    return 0;
+}
+
+/* Stores a point and publishes the partial sweep */
+static int bode_sweep_point(void *ctx, int idx, int count, const bode_point_t *pt)
+{
+    rp_osc_worker_state_t state;
+    int out_idx;
+
+    if(idx >= BODE_POINTS_MAX)
+        return -1;
+
+    bode_points[idx] = *pt;
+    bode_points_num = idx + 1;
+
+    bode_plot_points(bode_points_num, rp_tmp_signals[0], rp_tmp_signals[1],
+                     rp_tmp_signals[2]);
+    /* Points still to be measured repeat the last one */
+    for(out_idx = bode_points_num; out_idx < count; out_idx++) {
+        rp_tmp_signals[0][out_idx] = rp_tmp_signals[0][idx];
+        rp_tmp_signals[1][out_idx] = rp_tmp_signals[1][idx];
+        rp_tmp_signals[2][out_idx] = rp_tmp_signals[2][idx];
+    }
+    rp_osc_set_signals(rp_tmp_signals, idx);
+
+    /* Abort on shut down */
+    rp_osc_worker_get_state(&state);
+    return (state == rp_osc_quit_state) ? -1 : 0;
+}
+
+/* Runs a sweep with the GUI parameters */
+static int bode_run_sweep(void)
+{
+    bode_sweep_params_t p = {
+        .ch         = 0,
+        .ampl       = rp_get_params_bode(1),
+        .dc_bias    = rp_get_params_bode(3),
+        .averaging  = rp_get_params_bode(2),
+        .steps      = rp_get_params_bode(5),
+        .start_freq = rp_get_params_bode(4),
+        .end_freq   = rp_get_params_bode(9),
+        .log_scale  = rp_get_params_bode(7)
+    };
+    bode_backend_t be = { NULL, bode_generate, bode_acquire };
+    bode_sweep_cb_t cb = { NULL, bode_sweep_point, NULL };
+
+    if(p.steps > BODE_POINTS_MAX)
+        p.steps = BODE_POINTS_MAX;
+    bode_points_num = 0;
+
+    return bode_sweep_run(&p, &be, &cb);
+}
+
+
 /*----------------------------------------------------------------------------------*/
 
 /* Main worker thread */
@@ -297,54 +429,11 @@ void *rp_osc_worker_thread(void *args)
         int start_measure = rp_get_params_bode(0);
         if(start_measure == 1){
 
-            char command[100];
-            float read_amp = rp_get_params_bode(1);
-            float read_avg = rp_get_params_bode(2);
-            float read_dc_bias = rp_get_params_bode(3);
-            float read_start_freq = rp_get_params_bode(4);
-            float read_counts = rp_get_params_bode(5);
-            float read_scale = rp_get_params_bode(6);
-            float read_end_freq = rp_get_params_bode(9);
-
-            char amp[5];
-            char avg[5];
-            char dc_bias[5];
-            char s_freq[20];
-            char e_freq[20];
-            char scale[5];
-            char counts[5];
-
-            snprintf(amp, 5, "%f", read_amp);
-            snprintf(avg, 5, "%f", read_avg);
-            snprintf(dc_bias, 5, "%f", read_dc_bias);
-            snprintf(s_freq, 20, "%f", read_start_freq);
-            snprintf(e_freq,20, "%f", read_end_freq);
-            snprintf(scale, 5, "%f", read_scale);
-            snprintf(counts, 5, "%f", read_counts);
-
-            strcpy(command, "/opt/redpitaya/www/apps/bode_plotter/bode 1 ");
-            
-            strcat(command, amp);
-            strcat(command, " ");
-
-            strcat(command, dc_bias);
-            strcat(command, " ");
-
-            strcat(command, avg);
-            strcat(command, " ");
-            strcat(command, counts);
-            strcat(command, " ");
-
-            strcat(command, s_freq);
-            strcat(command, " ");
-            strcat(command, e_freq);
-            strcat(command, " ");
-            strcat(command, scale);
-            
-            system(command);
-
+            bode_run_sweep();
             rp_set_params_bode(0, 0);
 
+            /* The sweep has used the acquisition, restore its settings */
+            fpga_update = (curr_params != NULL);
         }
 
         old_state = state;
@@ -715,17 +804,9 @@ int bode_start_measure(float **cha_signal, int *in_cha_signal,
     float *cha_s = *cha_signal;
     float *chb_s = *chb_signal;
     float *t = *time_signal;
-    float *frequency = *time_signal;
-
-    
-    //FILE *file_phase = fopen("/tmp/bode_data/data_phase", "r");
-
-    
 
-   
-    
     /* We have data aquisition */
-    if(rp_get_params_bode(0) != 0){
+    if(rp_get_params_bode(0) != 0 || bode_points_num == 0){
 
         for(out_idx = 0; out_idx < ((int)rp_get_params_bode(5)); out_idx++){
             t[out_idx] = out_idx;
@@ -734,58 +815,11 @@ int bode_start_measure(float **cha_signal, int *in_cha_signal,
         }
 
     }
-     
     else{
-        
-        counter = 0;
-        /* Opening files */
-        FILE *file_frequency = fopen("/tmp/bode_data/data_frequency", "r");
-        FILE *file_amplitude = fopen("/tmp/bode_data/data_amplitude", "r");
-        FILE *file_phase = fopen("/tmp/bode_data/data_phase", "r");
-
-        while(!feof(file_frequency)){
-            fscanf(file_frequency, "%f", &frequency[counter]);
-            counter++;
-        }
-
-        /* Allocation memory */
-        float *amplitude = malloc(counter * sizeof(float));
-        float *phase = malloc(counter * sizeof(float));
-
-        int amp_counter = 0;
-        while(!feof(file_amplitude)){
-            fscanf(file_amplitude, "%f", &amplitude[amp_counter]);
-            amp_counter++;
-        }
-
-        int p_counter = 0;
-        while(!feof(file_phase)){
-            fscanf(file_phase, "%f", &phase[p_counter]);
-            p_counter++;
-        }
-
-        for(out_idx = 0; out_idx < counter; out_idx++){
-
-            t[out_idx] = frequency[out_idx];
-            
-            if(rp_get_params_bode(8) == 0){
-                cha_s[out_idx] = amplitude[out_idx];
-            }else{
-                cha_s[out_idx] = phase[out_idx];
-            }
-            
-            chb_s[out_idx] = -1;
-        }
-
-        /* Closing files */
-        fclose(file_frequency);
-        fclose(file_amplitude);
-        fclose(file_phase);
+        /* Points of the last sweep */
+        bode_plot_points(bode_points_num, t, cha_s, chb_s);
     }
-    
 
-    
-    
     return 0;
 }
 
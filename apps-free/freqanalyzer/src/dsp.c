@@ -23,6 +23,7 @@
 #include "fpga.h"
 #include "dsp.h"
 #include "kiss_fftr.h"
+#include "kiss_fft_plan.h"
 
 
 /* length of output signals: floor(SPECTR_FPGA_SIG_LEN/2) */
@@ -134,7 +135,7 @@ int rp_spectr_fft_init()
     rp_kiss_fft_out2 =
         (kiss_fft_cpx *)malloc(SPECTR_FPGA_SIG_LEN * sizeof(kiss_fft_cpx));
 
-    rp_kiss_fft_cfg = kiss_fftr_alloc(SPECTR_FPGA_SIG_LEN, 0, NULL, NULL);
+    rp_kiss_fft_cfg = kiss_fftr_plan(SPECTR_FPGA_SIG_LEN, 0);
 
     return 0;
 }
@@ -151,10 +152,8 @@ int rp_spectr_fft_clean()
         free(rp_kiss_fft_out2);
         rp_kiss_fft_out2 = NULL;
     }
-    if(rp_kiss_fft_cfg) {
-        free(rp_kiss_fft_cfg);
-        rp_kiss_fft_cfg = NULL;
-    }
+    /* shared plan, not ours to free */
+    rp_kiss_fft_cfg = NULL;
     return 0;
 }
 
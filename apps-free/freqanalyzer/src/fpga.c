@@ -15,12 +15,11 @@
 #include <string.h>
 #include <math.h>
 #include <errno.h>
-#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#include <fcntl.h>
 
+#include "regmap.h"
 #include "fpga.h"
 
 /* internals */
@@ -30,6 +29,9 @@ uint32_t              *g_spectr_fpga_cha_mem = NULL;
 uint32_t              *g_spectr_fpga_chb_mem = NULL;
 uint32_t              *g_sgen_fpga_regmem    = NULL;
 
+/* The mapped FPGA block */
+static regmap_block_t g_spectr_fpga_blk;
+
 /* constants */
 /* ADC format = s.13 */
 const int c_spectr_fpga_adc_bits = 14;
@@ -52,10 +54,7 @@ double __rp_rand()
 int __spectr_fpga_cleanup_mem(void)
 {
     if(g_spectr_fpga_reg_mem) {
-        if(munmap(g_spectr_fpga_reg_mem, SPECTR_FPGA_BASE_SIZE) < 0) {
-            fprintf(stderr, "munmap() failed: %s\n", strerror(errno));
-            return -1;
-        }
+        regmap_put(&g_spectr_fpga_blk);
         g_spectr_fpga_reg_mem = NULL;
         if(g_spectr_fpga_cha_mem)
             g_spectr_fpga_cha_mem = NULL;
@@ -75,41 +74,31 @@ int set_gen(uint32_t loc, uint32_t val)
     return 0;
 }
 
-static int get_hw_rev(hw_rev_t * hw_rev)
+int set_gen_buf(uint32_t loc, const uint32_t *data, int len)
 {
-    void *page_ptr;
-    long page_addr, page_size = sysconf(_SC_PAGESIZE);
-    const long c_hk_fpga_base_addr = 0x40000000;
-    const long c_hk_fpga_base_size = 0x20;
-    int fd;
-
-    fd = open("/dev/mem", O_RDONLY | O_SYNC);
-    if(fd < 0) {
-        fprintf(stderr, "open(/dev/mem) failed: %s\n", strerror(errno));
-        return -1;
-    }
+    /* Plain 32-bit stores - memcpy() may use access widths the AXI
+     * register bus does not support */
+    volatile uint32_t *dst = g_sgen_fpga_regmem + loc;
+    int i;
 
-    page_addr = c_hk_fpga_base_addr & (~(page_size-1));
+    for(i = 0; i < len; i++)
+        dst[i] = data[i];
+    return 0;
+}
 
-    page_ptr = mmap(NULL, c_hk_fpga_base_size, PROT_READ,
-                          MAP_SHARED, fd, page_addr);
+static int get_hw_rev(hw_rev_t * hw_rev)
+{
+    const long c_hk_fpga_base_addr = 0x40000000;
+    regmap_block_t blk;
 
-    if((void *)page_ptr == MAP_FAILED) {
-        fprintf(stderr, "mmap() failed: %s\n", strerror(errno));
-        close(fd);
+    if(REGMAP_GET(c_hk_fpga_base_addr, hk_fpga_reg_mem_t, &blk) < 0) {
         return -1;
     }
 
-    hk_fpga_reg_mem_t *hk = page_ptr;
+    volatile hk_fpga_reg_mem_t *hk = REGMAP_REGS(&blk, hk_fpga_reg_mem_t);
     *hw_rev = hk->rev & HK_FPGA_HW_REV_MASK;
 
-    if(munmap(page_ptr, c_hk_fpga_base_size) < 0) {
-        fprintf(stderr, "munmap() failed: %s\n", strerror(errno));
-        close(fd);
-        return -1;
-    }
-
-    close (fd);
+    regmap_put(&blk);
 
     return 0;
 }
@@ -136,37 +125,19 @@ static int update_hw_spec_par(void)
 
 int spectr_fpga_init(void)
 {
-    void *page_ptr;
-    long page_addr, page_off, page_size = sysconf(_SC_PAGESIZE);
-    int fd;
-
     /* update hw specific parameters */
     if(update_hw_spec_par() < 0){
     	return -1;
     }
 
-    /* If maybe needed, cleanup the FD & memory pointer */
+    /* If maybe needed, cleanup the memory pointer */
     if(__spectr_fpga_cleanup_mem() < 0)
         return -1;
 
-    fd = open("/dev/mem", O_RDWR | O_SYNC);
-    if(fd < 0) {
-        fprintf(stderr, "open(/dev/mem) failed: %s\n", strerror(errno));
+    if(regmap_get(SPECTR_FPGA_BASE_ADDR, SPECTR_FPGA_BASE_SIZE, &g_spectr_fpga_blk) < 0) {
         return -1;
     }
-
-    page_addr = SPECTR_FPGA_BASE_ADDR & (~(page_size-1));
-    page_off  = SPECTR_FPGA_BASE_ADDR - page_addr;
-
-    page_ptr = mmap(NULL, SPECTR_FPGA_BASE_SIZE, PROT_READ | PROT_WRITE,
-                          MAP_SHARED, fd, page_addr);
-    if((void *)page_ptr == MAP_FAILED) {
-        fprintf(stderr, "mmap() failed: %s\n", strerror(errno));
-        __spectr_fpga_cleanup_mem();
-        close (fd);
-        return -1;
-    }
-    g_spectr_fpga_reg_mem = page_ptr + page_off;
+    g_spectr_fpga_reg_mem = (spectr_fpga_reg_mem_t *)g_spectr_fpga_blk.regs;
     g_spectr_fpga_cha_mem = (uint32_t *)g_spectr_fpga_reg_mem + 
         (SPECTR_FPGA_CHA_OFFSET / sizeof(uint32_t));
     g_spectr_fpga_chb_mem = (uint32_t *)g_spectr_fpga_reg_mem + 
@@ -174,8 +145,6 @@ int spectr_fpga_init(void)
     g_sgen_fpga_regmem = (uint32_t *)g_spectr_fpga_reg_mem +
         (SPECTR_FPGA_SG_OFFSET / sizeof(uint32_t));
 
-    close (fd);
-
     return 0;
 }
 
@@ -190,6 +190,8 @@ int spectr_fpga_init(void);
 int spectr_fpga_exit(void);
 
 int set_gen(uint32_t loc, uint32_t val);
+/* Writes len consecutive generator words starting at loc */
+int set_gen_buf(uint32_t loc, const uint32_t *data, int len);
 
 int spectr_fpga_update_params(int trig_imm, int trig_source, int trig_edge, 
                               float trig_delay, float trig_level, int time_range,
@@ -20,12 +20,11 @@
 #include <string.h>
 #include <math.h>
 #include <errno.h>
-#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#include <fcntl.h>
 
+#include "regmap.h"
 #include "fpga_awg.h"
 
 /** 
@@ -39,8 +38,8 @@
  *
  * This module maps physical address of the AWG core to the logical address, 
  * which can be used in the GNU/Linux user-space. To achieve this AWG_BASE_ADDR
- * from CPU memory space is translated automatically to logical address with the
- * function mmap(). After all the initialization is done, other modules can use
+ * from CPU memory space is translated to logical address by the shared
+ * register map service. After all the initialization is done, other modules can use
  * fpga_awg to control signal outputs (as an example please see generate.c).
  * Before this module is used external SW module must call fpga_awg_init().
  * When this module is no longer needed fpga_awg_exit() should be called.
@@ -67,6 +66,9 @@ uint32_t  *g_awg_cha_mem = NULL;
   */
 uint32_t  *g_awg_chb_mem = NULL;
 
+/** The mapped FPGA block */
+static regmap_block_t g_awg_blk;
+
 /* Constants */
 /** DAC frequency (125 Mspmpls (non-decimated)) */
 const double c_awg_smpl_freq = 125e6;
@@ -75,8 +77,8 @@ const int c_awg_fpga_dac_bits = 14;
 /**
  * @brief Internal function used to clean up memory.
  *
- * This function un-maps FPGA register and signal buffers, closes memory file
- * descriptor and cleans all memory allocated by this module.
+ * This function releases the FPGA register and signal buffers mapping and
+ * cleans all memory allocated by this module.
  *
  * @retval 0 Success
  * @retval -1 Error happened during cleanup.
@@ -85,10 +87,7 @@ int __awg_cleanup_mem(void)
 {
     /* If registry structure is NULL we do not need to un-map and clean up */
     if(g_awg_reg) {
-        if(munmap(g_awg_reg, AWG_BASE_SIZE) < 0) {
-            fprintf(stderr, "munmap() failed: %s\n", strerror(errno));
-            return -1;
-        }
+        regmap_put(&g_awg_blk);
         g_awg_reg = NULL;
         if(g_awg_cha_mem)
             g_awg_cha_mem = NULL;
@@ -102,8 +101,8 @@ int __awg_cleanup_mem(void)
 /**
  * @brief Maps FPGA memory space and prepares register and buffer variables.
  * 
- * This function opens memory device (/dev/mem) and maps physical memory address
- * AWG_BASE_ADDR (of length AWG_BASE_SIZE) to logical addresses. It initializes
+ * This function maps physical memory address AWG_BASE_ADDR (of length
+ * AWG_BASE_SIZE) to logical addresses. It initializes
  * the pointers g_awg_reg, g_awg_cha_mem, g_awg_chb_mem to point to FPGA AWG.
  * If function failes FPGA variables must not be used.
  *
@@ -112,54 +111,29 @@ int __awg_cleanup_mem(void)
  */
 int fpga_awg_init(void)
 {
-    /* Page variables used to calculate correct mapping addresses */
-    void *page_ptr;
-    long page_addr, page_off, page_size = sysconf(_SC_PAGESIZE);
-    int fd;
-
     /* If module was already initialized, clean all internals */
     if(__awg_cleanup_mem() < 0)
         return -1;
 
-    /* Open /dev/mem to access directly system memory */
-    fd = open("/dev/mem", O_RDWR | O_SYNC);
-    if(fd < 0) {
-        fprintf(stderr, "open(/dev/mem) failed: %s\n", strerror(errno));
-        return -1;
-    }
-
-    /* Calculate correct page address and offset from AWG_BASE_ADDR and
-     * AWG_BASE_SIZE 
-     */
-    page_addr = AWG_BASE_ADDR & (~(page_size-1));
-    page_off  = AWG_BASE_ADDR - page_addr;
-
-    /* Map FPGA memory space to page_ptr. */
-    page_ptr = mmap(NULL, AWG_BASE_SIZE, PROT_READ | PROT_WRITE,
-                          MAP_SHARED, fd, page_addr);
-    if((void *)page_ptr == MAP_FAILED) {
-        fprintf(stderr, "mmap() failed: %s\n", strerror(errno));
-         __awg_cleanup_mem();
-         close (fd);
+    if(regmap_get(AWG_BASE_ADDR, AWG_BASE_SIZE, &g_awg_blk) < 0) {
+        __awg_cleanup_mem();
         return -1;
     }
 
     /* Set FPGA AWG module pointers to correct values. */
-    g_awg_reg = page_ptr + page_off;
+    g_awg_reg = (void *)g_awg_blk.regs;
     g_awg_cha_mem = (uint32_t *)g_awg_reg + 
         (AWG_CHA_OFFSET / sizeof(uint32_t));
     g_awg_chb_mem = (uint32_t *)g_awg_reg + 
         (AWG_CHB_OFFSET / sizeof(uint32_t));
 
-    close (fd);
-
     return 0;
 }
 
 /**
  * @brief Cleans up FPGA AWG module internals.
  * 
- * This function closes the memory file descriptor, unmap the FPGA memory space
+ * This function releases the FPGA memory space mapping
  * and cleans also all other internal things from FPGA AWG module.
  * @retval 0 Sucess
  * @retval -1 Failure
@@ -47,6 +47,11 @@ static rp_app_params_t rp_main_params[PARAMS_NUM+1] = {
 		   *    0 - disable
 		   *    1 - enable */
 		"en_cal2", 0, 1, 0,      0,         1 },
+    { /* tone_phase: Multitone stimulus phases
+       *    0 - zero phase
+       *    1 - Schroeder phases
+       *    2 - crest factor optimized */
+        "tone_phase", 2, 1, 0,   0,         2 },
     { /* Must be last! */
         NULL, 0.0, -1, -1, 0.0, 0.0 }
 };
@@ -31,11 +31,12 @@ typedef struct rp_app_params_s {
 
 /* Parameters indexes - these defines should be in the same order as
  * rp_app_params_t structure defined in main.c */
-#define PARAMS_NUM             4
+#define PARAMS_NUM             5
 #define FREQ_RANGE_PARAM       0
 #define FREQ_UNIT_PARAM        1
 #define EN_CAL_1               2
 #define EN_CAL_2               3
+#define TONE_PHASE_PARAM       4
 
 /* Output signals */
 #define SPECTR_OUT_SIG_LEN 2048
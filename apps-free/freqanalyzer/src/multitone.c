@@ -0,0 +1,132 @@
+/**
+ * @brief Red Pitaya Frequency Response Analyzer multitone stimulus synthesis.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "multitone.h"
+#include "kiss_fft_plan.h"
+
+/* Clipping level of the crest factor optimization, relative to the peak */
+#define FRA_MT_CLIP 0.85
+
+int fra_mt_init(fra_mt_t *mt, int len)
+{
+    memset(mt, 0, sizeof(fra_mt_t));
+    mt->len     = len;
+    mt->fwd_cfg = kiss_fftr_plan(len, 0);
+    mt->inv_cfg = kiss_fftr_plan(len, 1);
+    mt->spec    = (kiss_fft_cpx *)malloc((len/2+1) * sizeof(kiss_fft_cpx));
+    mt->sig     = (kiss_fft_scalar *)malloc(len * sizeof(kiss_fft_scalar));
+
+    if(!mt->fwd_cfg || !mt->inv_cfg || !mt->spec || !mt->sig) {
+        fra_mt_clean(mt);
+        return -1;
+    }
+    return 0;
+}
+
+void fra_mt_clean(fra_mt_t *mt)
+{
+    /* fwd_cfg, inv_cfg are shared plans */
+    if(mt->spec)
+        free(mt->spec);
+    if(mt->sig)
+        free(mt->sig);
+    memset(mt, 0, sizeof(fra_mt_t));
+}
+
+/* Unit amplitude tones with given phases into the spectrum, inverse FFT into
+ * mt->sig, returns the peak value */
+static double fra_mt_ifft(fra_mt_t *mt, int kstart, int kstep, int tones,
+                          const double *phi)
+{
+    double peak = 0;
+    int j, n;
+
+    memset(mt->spec, 0, (mt->len/2+1) * sizeof(kiss_fft_cpx));
+    /* kiss_fftri() is not normalized; bin pair (k, len-k) with 0.5
+     * gives a unit cosine */
+    for(j = 0; j < tones; j++) {
+        int k = kstart + j * kstep;
+        double a = (k == 0 || 2*k == mt->len) ? 1.0 : 0.5;
+        mt->spec[k].r = a * cos(phi[j]);
+        mt->spec[k].i = a * sin(phi[j]);
+    }
+    kiss_fftri(mt->inv_cfg, mt->spec, mt->sig);
+
+    for(n = 0; n < mt->len; n++) {
+        if(fabs(mt->sig[n]) > peak)
+            peak = fabs(mt->sig[n]);
+    }
+    return peak;
+}
+
+double fra_mt_synth(fra_mt_t *mt, int kstart, int kstep, int tones,
+                    fra_mt_phase_t phase, double *out)
+{
+    double *phi, *best_phi, peak, best_peak;
+    int j, n, it;
+
+    if(!mt->sig || tones < 1 || kstart < 0 || kstep < 1 ||
+       kstart + (tones-1) * kstep > mt->len/2)
+        return -1;
+
+    phi      = (double *)malloc(tones * sizeof(double));
+    best_phi = (double *)malloc(tones * sizeof(double));
+    if(!phi || !best_phi) {
+        free(phi);
+        free(best_phi);
+        return -1;
+    }
+
+    for(j = 0; j < tones; j++) {
+        if(phase == fra_mt_phase_zero)
+            phi[j] = 0;
+        else
+            phi[j] = -M_PI * j * (j - 1) / tones;
+    }
+    best_peak = fra_mt_ifft(mt, kstart, kstep, tones, phi);
+    memcpy(best_phi, phi, tones * sizeof(double));
+
+    /* Clip the time signal, keep only the phases of the tone bins of its
+     * spectrum and restore unit amplitudes - each round lowers the peak */
+    for(it = 0; phase == fra_mt_phase_optimized && it < FRA_MT_OPT_ITER; it++) {
+        double clip = FRA_MT_CLIP * best_peak;
+
+        for(n = 0; n < mt->len; n++) {
+            if(mt->sig[n] > clip)
+                mt->sig[n] = clip;
+            else if(mt->sig[n] < -clip)
+                mt->sig[n] = -clip;
+        }
+        kiss_fftr(mt->fwd_cfg, mt->sig, mt->spec);
+        for(j = 0; j < tones; j++) {
+            kiss_fft_cpx c = mt->spec[kstart + j * kstep];
+            phi[j] = atan2(c.i, c.r);
+        }
+
+        peak = fra_mt_ifft(mt, kstart, kstep, tones, phi);
+        if(peak < best_peak) {
+            best_peak = peak;
+            memcpy(best_phi, phi, tones * sizeof(double));
+        }
+    }
+
+    fra_mt_ifft(mt, kstart, kstep, tones, best_phi);
+    for(n = 0; n < mt->len; n++)
+        out[n] = mt->sig[n];
+
+    free(phi);
+    free(best_phi);
+    return best_peak;
+}
@@ -0,0 +1,49 @@
+/**
+ * @brief Red Pitaya Frequency Response Analyzer multitone stimulus synthesis.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __MULTITONE_H
+#define __MULTITONE_H
+
+#include "kiss_fftr.h"
+
+/* Iterations of the crest factor optimization */
+#define FRA_MT_OPT_ITER  40
+
+/* Tone phases */
+typedef enum fra_mt_phase_e {
+    fra_mt_phase_zero = 0,   /* all cosines in phase, crest factor sqrt(2*N) */
+    fra_mt_phase_schroeder,  /* phi_j = -pi*j*(j-1)/N */
+    fra_mt_phase_optimized   /* Schroeder refined by iterative clipping */
+} fra_mt_phase_t;
+
+typedef struct fra_mt_s {
+    int              len;
+    kiss_fftr_cfg    fwd_cfg;
+    kiss_fftr_cfg    inv_cfg;
+    kiss_fft_cpx    *spec;   /* len/2+1 bins */
+    kiss_fft_scalar *sig;    /* len samples */
+} fra_mt_t;
+
+int fra_mt_init(fra_mt_t *mt, int len);
+void fra_mt_clean(fra_mt_t *mt);
+
+/** Synthesizes a multitone signal by inverse FFT.
+ *
+ *   out[n] = sum_j cos(2*pi*(kstart + j*kstep)*n/len + phi_j),  j < tones
+ *
+ * The signal is periodic in len samples (tones on FFT bins).
+ *
+ * @param out    output of mt->len samples
+ * @retval peak value max|out[n]|, < 0 on error
+ */
+double fra_mt_synth(fra_mt_t *mt, int kstart, int kstep, int tones,
+                    fra_mt_phase_t phase, double *out);
+
+#endif /* __MULTITONE_H */
@@ -17,11 +17,14 @@
 #include <unistd.h>
 #include <math.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "worker.h"
+#include "kiss_fft_plan.h"
 #include "fpga.h"
 #include "dsp.h"
 #include "fpga_awg.h"
+#include "multitone.h"
 
 
 /** AWG buffer length [samples]*/
@@ -34,6 +37,21 @@ int32_t ch1_data[NN*BUFFS] ;
 
 double scale[BUFFS];
 
+/** Parameters each AWG buffer segment was synthesized with */
+typedef struct {
+    int valid;
+    int kstart;
+    int kstep;
+    int tones;
+    int ampl;
+    fra_mt_phase_t phase;
+} synth_key_t;
+
+synth_key_t synth_key[BUFFS];
+
+/** Multitone synthesis FFT plans & buffers */
+fra_mt_t rp_fra_mt;
+
 /** AWG FPGA parameters */
 typedef struct {
     int32_t  offsgain;   ///< AWG offset & gain.
@@ -43,8 +61,8 @@ typedef struct {
 
 /* Forward declarations */
 void synthesize_fra_sig(int ampl,  int kstart, int kstep, int II,
-                        int32_t *data, int buffoffs, double *scale,
-                        awg_param_t *params);
+                        fra_mt_phase_t phase, int32_t *data, int buffoffs,
+                        double *scale, awg_param_t *params);
 
 void write_data_fpga(uint32_t ch, int enable, int trigger,
                     const int32_t *data, int buffoffs, const awg_param_t *awg, int step);
@@ -60,9 +78,6 @@ int                  *rp_fpga_cha_signal, *rp_fpga_chb_signal;
 
 int cal_ready1 = 1;
 int cal_ready2 = 1;
-int synth_ready = 0;
-
-double tmpdouble;
 
 const int dacamp = 8000;
 const int k1 = 0;
@@ -138,6 +153,12 @@ int rp_spectr_worker_init(void)
         rp_spectr_worker_clean();
         return -1;
     }
+
+    memset(synth_key, 0, sizeof(synth_key));
+    if(fra_mt_init(&rp_fra_mt, NN) < 0) {
+        rp_spectr_worker_clean();
+        return -1;
+    }
     spectr_fpga_get_sig_ptr(&rp_fpga_cha_signal, &rp_fpga_chb_signal);
 
     rp_spectr_thread_handler = (pthread_t *)malloc(sizeof(pthread_t));
@@ -171,6 +192,8 @@ int rp_spectr_worker_clean(void)
     rp_cleanup_signals(&rp_tmp_signals);
 
     rp_spectr_fft_clean();
+    fra_mt_clean(&rp_fra_mt);
+    kiss_fft_plan_cleanup();
 
     if(rp_cha_in) {
         free(rp_cha_in);
@@ -295,7 +318,10 @@ void *rp_spectr_worker_thread(void *args)
     int iix, iix2;
     int cal_butt1_old, cal_butt2_old;
     int start_state = 1;
+    int synth_num;
     awg_param_t awg_par;
+    fra_mt_phase_t phase;
+    struct timespec t0, t1;
 
     pthread_mutex_lock(&rp_spectr_ctrl_mutex);
     old_state = state = rp_spectr_ctrl;
@@ -341,17 +367,31 @@ void *rp_spectr_worker_thread(void *args)
         }
 
         /* Prepare AWG data buffer  */
-        // Buffer prepared only once in order to save CPU resources
-        if (synth_ready == 0) {
-            // Before preparing buffer visualize some constant signal
-            rp_resp_init_sigs(&rp_tmp_signals[0], (float **)&rp_tmp_signals[1], (float **)&rp_tmp_signals[2]);
-            rp_spectr_set_signals(rp_tmp_signals);
-
-            for (iix2 = 0; iix2 < JJ; iix2++) {
-                synthesize_fra_sig(dacamp,  iix2*II*kstp, kstp, II, ch1_data, iix2*NN, &tmpdouble, &awg_par);
-                scale[iix2] = tmpdouble;
+        // Segments are cached and synthesized again only when their
+        // parameters change in order to save CPU resources
+        phase = (fra_mt_phase_t)round(curr_params[TONE_PHASE_PARAM].value);
+        synth_num = 0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (iix2 = 0; iix2 < JJ; iix2++) {
+            synth_key_t key = { 1, iix2*II*kstp, kstp, II, dacamp, phase };
+
+            if (!memcmp(&key, &synth_key[iix2], sizeof(synth_key_t)))
+                continue;
+
+            if (synth_num++ == 0) {
+                // Before preparing buffer visualize some constant signal
+                rp_resp_init_sigs(&rp_tmp_signals[0], (float **)&rp_tmp_signals[1], (float **)&rp_tmp_signals[2]);
+                rp_spectr_set_signals(rp_tmp_signals);
             }
-            synth_ready = 1;
+            synthesize_fra_sig(dacamp,  iix2*II*kstp, kstp, II, phase, ch1_data, iix2*NN, &scale[iix2], &awg_par);
+            synth_key[iix2] = key;
+        }
+        if (synth_num) {
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            fprintf(stderr, "Synthesized %d multitone segments (phase mode %d) in %.1f ms, "
+                    "tone amplitude %.1f\n", synth_num, phase,
+                    (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) * 1e-6,
+                    dacamp / scale[0]);
         }
 
         if (start_state == 0) {
@@ -431,7 +471,7 @@ void *rp_spectr_worker_thread(void *args)
         rp_resp_calc(&rp_cha_in[0], &rp_chb_in[0], jj_state*II, scale[jj_state], kstp, II, (double **)&rp_cha_resp, (double **)&rp_chb_resp);
 
         // Continue acquiring and processing until all the pattern sequence completed
-        if (jj_state < JJ) {
+        if (jj_state < JJ - 1) {
             jj_state++;
         } else {
             // Response characterization completed
@@ -484,12 +524,12 @@ void *rp_spectr_worker_thread(void *args)
 
 
 void synthesize_fra_sig(int ampl,  int kstart, int kstep, int II,
-                       int32_t *data, int buffoffs, double *scale,
-                       awg_param_t *awg)
+                       fra_mt_phase_t phase, int32_t *data, int buffoffs,
+                       double *scale, awg_param_t *awg)
 {
-    uint32_t ix, jx;
+    uint32_t ix;
     double ddata[NN];
-    double maxabs = 0;
+    double maxabs;
 
     // Various locally used constants - HW specific parameters
     const int dcoffs = -155;
@@ -498,25 +538,15 @@ void synthesize_fra_sig(int ampl,  int kstart, int kstep, int II,
     awg->step = round(65536 * 1);
     awg->wrap = round(65536 * NN-1);
 
-    // Fill data[] with appropriate buffer samples
-    for (jx = 0; jx < II; jx++) {
-        for (ix = 0; ix < NN; ix++) {
-            if (jx == 0) {
-                ddata[ix] = cos(2 * M_PI * (double)ix / (double)NN *
-                        (double)(kstart + kstep * jx));
-            } else {
-                ddata[ix] = ddata[ix] + cos(2 * M_PI * (double)ix / (double)NN *
-                        (double)(kstart + kstep * jx));
-            }
-        }
+    // Sum of II unit cosines at bins kstart + kstep*jx, by inverse FFT
+    maxabs = fra_mt_synth(&rp_fra_mt, kstart, kstep, II, phase, ddata);
+    if (maxabs <= 0) {
+        fprintf(stderr, "fra_mt_synth() failed\n");
+        memset(&data[buffoffs], 0, NN * sizeof(int32_t));
+        *scale = 0;
+        return;
     }
 
-	// Checking maximum
-	for (ix = 0; ix < NN; ix++) {
-		if (abs(ddata[ix]) > maxabs)
-			maxabs = abs(ddata[ix]);
-	}
-
 	*scale = maxabs;
 
 	// Normalization
@@ -541,8 +571,6 @@ void synthesize_fra_sig(int ampl,  int kstart, int kstep, int II,
 void write_data_fpga(uint32_t ch, int enable, int trigger, const int32_t *data, int buffoffs,
                      const awg_param_t *awg, int step)
 {
-   int ixx;
-
    if (ch == 0) {
 
        set_gen(0, 0x000041);
@@ -550,8 +578,7 @@ void write_data_fpga(uint32_t ch, int enable, int trigger, const int32_t *data,
        set_gen(2, awg->wrap);
        set_gen(4, step);
 
-       for(ixx = 0; ixx < NN; ixx++)
-           set_gen(ixx + 0x4000, data[ixx + buffoffs]);
+       set_gen_buf(0x4000, (const uint32_t *)&data[buffoffs], NN);
 
        set_gen(0, 0x110011);
 
@@ -562,8 +589,7 @@ void write_data_fpga(uint32_t ch, int enable, int trigger, const int32_t *data,
        set_gen(10, awg->wrap);
        set_gen(12, step);
 
-       for(ixx = 0; ixx < NN; ixx++)
-           set_gen(ixx + 0x8000, data[ixx + buffoffs]);
+       set_gen_buf(0x8000, (const uint32_t *)&data[buffoffs], NN);
 
        set_gen(0, 0x110011);
    }
@@ -19,6 +19,8 @@
 
 #include "worker.h"
 #include "fpga.h"
+#include "generate.h"
+#include "lcr_sweep.h"
 
 pthread_t *rp_osc_thread_handler = NULL;
 void *rp_osc_worker_thread(void *args);
@@ -40,7 +42,6 @@ int                  *rp_fpga_cha_signal, *rp_fpga_chb_signal;
 
 /* Calibration parameters read from EEPROM */
 rp_calib_params_t *rp_calib_params = NULL;
-int counter = 0;
 int measure_counter = 0;
 int steps_counter = 0;
 int measure_method = 0;
@@ -212,6 +213,162 @@ int rp_osc_set_signals(float **source, int index)
 }
 
 
+/*----------------------------------------------------------------------------------*/
+
+/* LCR sweep, run by the worker thread. Points are published as they are
+ * measured and kept for plotting until the next sweep. */
+#define LCR_POINTS_MAX 1000 /* Max. lcr_steps */
+
+static lcr_point_t lcr_points[LCR_POINTS_MAX];
+static int         lcr_points_num = 0;
+
+/* Plot signals of the first num points, quantity selected in the GUI */
+static void lcr_plot_points(int num, float *t, float *cha_s, float *chb_s)
+{
+    int quantity = rp_get_params_lcr(15);
+    int out_idx;
+
+    if((quantity < 0) || (quantity >= LCR_QUANTITIES))
+        quantity = LCR_Z_ABS;
+
+    for(out_idx = 0; out_idx < num; out_idx++) {
+        cha_s[out_idx] = lcr_points[out_idx].v[quantity];
+        chb_s[out_idx] = 0;
+
+        /* Measurment sweep: point index, frequency sweep: frequency */
+        if(measure_method == 1)
+            t[out_idx] = out_idx;
+        else
+            t[out_idx] = lcr_points[out_idx].freq;
+    }
+}
+
+/* Sweep backend: generator through the AWG */
+static int lcr_generate(void *ctx, unsigned int ch, const int32_t *data,
+                        const lcr_awg_param_t *awg)
+{
+    awg_param_t param = { awg->offsgain, awg->wrap, awg->step };
+
+    usleep(100000);
+    write_data_fpga(ch, 0, 0, data, &param, 0);
+    return 0;
+}
+
+/* Sweep backend: immediately triggered acquisition of both inputs */
+static int lcr_acquire(void *ctx, int dec_idx, uint32_t size,
+                       float *ch1, float *ch2)
+{
+    const int sign = 1 << (c_osc_fpga_adc_bits - 1);
+    int retries = 150000;
+    int wr_ptr_trig, in_idx, cnt;
+    uint32_t i;
+
+    osc_fpga_reset();
+    if(osc_fpga_update_params(1, 0, 0, 0, 0, dec_idx, 1, 1,
+                              0, 0, 0, 0, 0, 0, 0, 0, 1) < 0) {
+        fprintf(stderr, "Setting of FPGA registers failed\n");
+        return -1;
+    }
+    osc_fpga_arm_trigger();
+    osc_fpga_set_trigger(osc_fpga_cnv_trig_source(1, 0, 0));
+
+    /* The buffer after the trigger is written when the trigger clears */
+    while(!osc_fpga_triggered()) {
+        if(retries-- == 0) {
+            fprintf(stderr, "Signal acquisition was not triggered!\n");
+            return -1;
+        }
+        usleep(1000);
+    }
+
+    osc_fpga_get_wr_ptr(NULL, &wr_ptr_trig);
+    /* Additional FPGA delay when decimation is enabled */
+    if(lcr_dec[dec_idx] == 1)
+        in_idx = wr_ptr_trig + 3;
+    else if(lcr_dec[dec_idx] > 8192)
+        in_idx = wr_ptr_trig;
+    else
+        in_idx = wr_ptr_trig + 1;
+
+    for(i = 0; i < size; i++, in_idx++) {
+        in_idx %= OSC_FPGA_SIG_LEN;
+        cnt = rp_fpga_cha_signal[in_idx] & ((sign << 1) - 1);
+        ch1[i] = (cnt & sign) ? cnt - (sign << 1) : cnt;
+        cnt = rp_fpga_chb_signal[in_idx] & ((sign << 1) - 1);
+        ch2[i] = (cnt & sign) ? cnt - (sign << 1) : cnt;
+    }
+    return 0;
+}
+
+/* Sweep backend: shunt switching on the LCR extension module */
+static int lcr_set_shunt(void *ctx, int k)
+{
+    /* Failures are reported, the sweep goes on with the old shunt */
+    lcr_sweep_i2c_shunt(k);
+    return 0;
+}
+
+/* Stores a point and publishes the partial sweep */
+static int lcr_sweep_point(void *ctx, int idx, int count, const lcr_point_t *pt)
+{
+    rp_osc_worker_state_t state;
+    int out_idx;
+
+    if(idx >= LCR_POINTS_MAX)
+        return -1;
+
+    lcr_points[idx] = *pt;
+    lcr_points_num = idx + 1;
+
+    lcr_plot_points(lcr_points_num, rp_tmp_signals[0], rp_tmp_signals[1],
+                    rp_tmp_signals[2]);
+    /* Points still to be measured repeat the last one */
+    for(out_idx = lcr_points_num; out_idx < count; out_idx++) {
+        rp_tmp_signals[0][out_idx] = rp_tmp_signals[0][idx];
+        rp_tmp_signals[1][out_idx] = rp_tmp_signals[1][idx];
+        rp_tmp_signals[2][out_idx] = rp_tmp_signals[2][idx];
+    }
+    rp_osc_set_signals(rp_tmp_signals, idx);
+
+    /* Abort on shut down */
+    rp_osc_worker_get_state(&state);
+    return (state == rp_osc_quit_state) ? -1 : 0;
+}
+
+static void lcr_sweep_progress(void *ctx, int percent)
+{
+    rp_set_params_lcr(1, percent);
+}
+
+/* Runs a frequency (freq_sweep = 1) or measurement sweep with the GUI
+ * parameters */
+static int lcr_run_sweep(int freq_sweep)
+{
+    lcr_sweep_params_t p = {
+        .ch         = 0,
+        .ampl       = rp_get_params_lcr(2),
+        .dc_bias    = rp_get_params_lcr(4),
+        .r_shunt    = rp_get_params_lcr(5),
+        .averaging  = rp_get_params_lcr(3),
+        .calib      = 0,
+        .z_ref      = rp_get_params_lcr(9) + rp_get_params_lcr(10) * I,
+        .steps      = rp_get_params_lcr(1),
+        .freq_sweep = freq_sweep,
+        .start_freq = rp_get_params_lcr(6),
+        .end_freq   = freq_sweep ? rp_get_params_lcr(7) : 1000,
+        .log_scale  = rp_get_params_lcr(8)
+    };
+    lcr_backend_t be = { NULL, lcr_generate, lcr_acquire, lcr_set_shunt };
+    lcr_sweep_cb_t cb = { NULL, lcr_sweep_point, lcr_sweep_progress };
+
+    if(p.steps > LCR_POINTS_MAX)
+        p.steps = LCR_POINTS_MAX;
+    lcr_points_num = 0;
+
+    return lcr_sweep_run(&p, &be, &cb);
+}
+
+
 /*----------------------------------------------------------------------------------*/
 void *rp_osc_worker_thread(void *args)
 {
@@ -319,159 +476,18 @@ void *rp_osc_worker_thread(void *args)
             printf("Loading parameters failed!\n");
         }
 
-        /* Start lcr measurment */
+        /* Start lcr measurment:
+         * 1 --> Frequency sweep
+         * 2 --> Measurment sweep */
         float measure_option = rp_get_params_lcr(0);
-        /* Set max command lenght */
-        char command[100];
-        /* Frequency sweep */
-        if(measure_option == 1){
-
-
-            float lcr_steps = rp_get_params_lcr(1);
-            float lcr_amp = rp_get_params_lcr(2);
-            float lcr_avg = rp_get_params_lcr(3);
-            float lcr_dc_bias = rp_get_params_lcr(4);
-            float lcr_r_shunt = rp_get_params_lcr(5);
-            float start_freq = rp_get_params_lcr(6);
-            float end_freq = rp_get_params_lcr(7);
-            float lcr_Scale = rp_get_params_lcr(8);
-            float lcr_load_re = rp_get_params_lcr(9);
-            float lcr_load_im = rp_get_params_lcr(10);
-            float lcr_calibration = rp_get_params_lcr(11);
-
-            char steps[10];
-            char sF[20];
-            char eF[20];
-            char amp[20];
-            char avg[20];
-            char dc_bias[20];
-            char r_shunt[20];
-            char scale[20];
-            char re[10];
-            char im[10];
-            char calib[1];
-
-            snprintf(steps, 10, "%f", lcr_steps);
-            printf("STEPS: %s\n", steps);
-            snprintf(sF, 20, "%f", start_freq);
-            snprintf(eF, 20, "%f", end_freq);
-            snprintf(amp, 20, "%f", lcr_amp);
-            snprintf(avg, 20, "%f", lcr_avg);
-            snprintf(dc_bias, 20, "%f", lcr_dc_bias);
-            snprintf(r_shunt, 20, "%f", lcr_r_shunt);
-            snprintf(scale, 20, "%f", lcr_Scale);
-            snprintf(re, 10, "%f", lcr_load_re);
-            snprintf(im, 10, "%f", lcr_load_im);
-            snprintf(calib, 1, "%f", lcr_calibration);
-            
-            strcpy(command, "/opt/redpitaya/www/apps/impedance_analyzer/lcr 1 ");
-            strcat(command, amp);
-            strcat(command, " ");
-
-            strcat(command, dc_bias);
-            strcat(command, " ");
-
-            strcat(command, r_shunt);
-            strcat(command, " ");
-
-            strcat(command, avg);
-
-            strcat(command, " 0 ");
+        if(measure_option == 1 || measure_option == 2){
 
-            strcat(command, re);
-            strcat(command, " ");
-            strcat(command, im);
-            strcat(command, " ");
-            strcat(command, steps);
-            strcat(command, " 1 ");
-
-            strcat(command, sF);
-            strcat(command, " ");
-            strcat(command, eF);
-            strcat(command, " ");
-            strcat(command, scale);
-            strcat(command, " 0");
-
-            system(command);
-            measure_method = 2;
+            measure_method = (measure_option == 1) ? 2 : 1;
+            lcr_run_sweep(measure_option == 1);
             rp_set_params_lcr(0, 0);
 
-
-        /* Measurment sweep */
-        }else if(measure_option == 2){
-
-            float lcr_counts = rp_get_params_lcr(1);
-            float lcr_amp = rp_get_params_lcr(2);
-            float lcr_avg = rp_get_params_lcr(3);
-            float lcr_dc_bias = rp_get_params_lcr(4);
-            float lcr_r_shunt = rp_get_params_lcr(5);
-            float start_freq = rp_get_params_lcr(6);
-            float end_freq = rp_get_params_lcr(7);
-            float lcr_Scale = rp_get_params_lcr(8);
-            float lcr_load_re = rp_get_params_lcr(9);
-            float lcr_load_im = rp_get_params_lcr(10);
-            float lcr_calibration = rp_get_params_lcr(11);
-
-
-            char ms_counts[20];
-            char sF[20];
-            char eF[20];
-            char amp[20];
-            char avg[20];
-            char dc_bias[20];
-            char r_shunt[20];
-            char scale[20];
-            char re[10];
-            char im[10];
-            char calib[1];
-
-
-            snprintf(ms_counts, 20, "%f", lcr_counts);
-            snprintf(sF, 20, "%f", start_freq);
-            snprintf(eF, 20, "%f", end_freq);
-            snprintf(amp, 20, "%f", lcr_amp);
-            snprintf(avg, 20, "%f", lcr_avg);
-            snprintf(dc_bias, 20, "%f", lcr_dc_bias);
-            snprintf(r_shunt, 20, "%f", lcr_r_shunt);
-            snprintf(scale, 20, "%f", lcr_Scale);
-            snprintf(re, 10, "%f", lcr_load_re);
-            snprintf(im, 10, "%f", lcr_load_im);
-            snprintf(calib, 1, "%f", lcr_calibration);
-
-            char command[100];
-            
-            strcpy(command, "/opt/redpitaya/www/apps/impedance_analyzer/lcr 1 "); 
-            
-            strcat(command, amp);
-            strcat(command, " ");
-
-            strcat(command, dc_bias);
-            strcat(command, " ");
-
-            strcat(command, r_shunt);
-            strcat(command, " ");
-            
-            strcat(command, avg);
-            strcat(command, " 0 ");
-
-            strcat(command, re);
-            strcat(command, " ");
-            strcat(command, im);
-            strcat(command, " ");
-
-            strcat(command, ms_counts);
-            strcat(command, " 0 ");
-
-            strcat(command, sF);
-            strcat(command, " ");
-            strcat(command, " 1000 ");
-            strcat(command, scale);
-            strcat(command, " 0");
-            
-            system(command);
-            measure_method = 1; // MS
-            rp_set_params_lcr(0, 0);
-            
+            /* The sweep has used the acquisition, restore its settings */
+            fpga_update = (curr_params != NULL);
         }
         
         /* request to stop worker thread, we will shut down */
@@ -795,7 +811,6 @@ int lcr_start_Measure(float **cha_signal, int *in_cha_signal,
 
     /* rp_tmp_signal[0] for X-coordinate set to frequency */
     float *t = *time_signal;
-    float *frequency = *time_signal;
 
     /* If we are in first boot, start_measure will always be set to -1 
      * rp_get_params_lcr(0):
@@ -806,205 +821,19 @@ int lcr_start_Measure(float **cha_signal, int *in_cha_signal,
 
     if(rp_get_params_lcr(0) == -1){
 
-
-        for(out_idx=0; out_idx < counter; out_idx++) {
+        for(out_idx=0; out_idx < lcr_points_num; out_idx++) {
             cha_s[out_idx] = 0;
             chb_s[out_idx] = 0;
             t[out_idx] = out_idx;
         }
     }else{
 
-
-        /* Opening files */
-        FILE *file_frequency = fopen("/tmp/lcr_data/data_frequency", "r");
-        FILE *file_phase = fopen("/tmp/lcr_data/data_phase", "r");
-        FILE *file_amplitude = fopen("/tmp/lcr_data/data_amplitude", "r");
-        FILE *file_Y_abs = fopen("/tmp/lcr_data/data_Y_abs", "r");
-        FILE *file_PhaseY = fopen("/tmp/lcr_data/data_phaseY", "r");
-        FILE *file_R_s = fopen("/tmp/lcr_data/data_R_s", "r");
-        FILE *file_X_s = fopen("/tmp/lcr_data/data_X_s", "r");
-        FILE *file_G_p = fopen("/tmp/lcr_data/data_G_p", "r");
-        FILE *file_B_p = fopen("/tmp/lcr_data/data_B_p", "r");
-        FILE *file_C_s = fopen("/tmp/lcr_data/data_C_s", "r");
-        FILE *file_C_p = fopen("/tmp/lcr_data/data_C_p", "r");
-        FILE *file_L_s = fopen("/tmp/lcr_data/data_L_s", "r");
-        FILE *file_L_p = fopen("/tmp/lcr_data/data_L_p", "r");
-        FILE *file_R_p = fopen("/tmp/lcr_data/data_R_p", "r");
-        FILE *file_Q = fopen("/tmp/lcr_data/data_Q", "r");
-        FILE *file_D = fopen("/tmp/lcr_data/data_D", "r");
-        
-
-        while(!feof(file_frequency)){
-            fscanf(file_frequency, "%f", &frequency[counter]);
-            counter++;
-        }
-
-        
-
-        /* Allocationg memory. TODO: Free up memory after use */
-        float *phase = malloc(counter * sizeof(float));
-        float *amplitude = malloc(counter * sizeof(float));
-        float *Y_abs = malloc(counter * sizeof(float));
-        float *R_s = malloc(counter * sizeof(float));
-        float *phaseY = malloc(counter * sizeof(float));
-        float *X_s = malloc(counter * sizeof(float));
-        float *G_p = malloc(counter * sizeof(float));
-        float *B_p = malloc(counter * sizeof(float));
-        float *C_s = malloc(counter * sizeof(float));
-        float *C_p = malloc(counter * sizeof(float));
-        float *L_s = malloc(counter * sizeof(float));
-        float *L_p = malloc(counter * sizeof(float));
-        float *R_p = malloc(counter * sizeof(float));
-        float *Q = malloc(counter * sizeof(float));
-        float *D = malloc(counter * sizeof(float));
-
-        /* Reading data from files into mem-allocated variables */
-        int B_p_counter = 0;
-        while(!feof(file_B_p)){
-            fscanf(file_B_p, "%f", &B_p[B_p_counter]);
-            B_p_counter++;
-        }
-
-        int C_s_counter = 0;
-        while(!feof(file_C_s)){
-            fscanf(file_C_s, "%f", &C_s[C_s_counter]);
-            C_s_counter++;
-        }
-
-        int C_p_counter = 0;
-        while(!feof(file_C_p)){
-            fscanf(file_C_p, "%f", &C_p[C_p_counter]);
-            C_p_counter++;
-        }
-
-        int L_s_counter = 0;
-        while(!feof(file_L_s)){
-            fscanf(file_L_s, "%f", &L_s[L_s_counter]);
-            L_s_counter++;
-        }
-
-        int L_p_counter = 0;
-        while(!feof(file_L_p)){
-            fscanf(file_L_p, "%f", &L_p[L_p_counter]);
-            L_p_counter++;
-        }
-
-        int R_p_counter = 0;
-        while(!feof(file_R_p)){
-            fscanf(file_R_p, "%f", &R_p[R_p_counter]);
-            R_p_counter++;
-        }
-
-        int q_counter = 0;
-        while(!feof(file_Q)){
-            fscanf(file_Q, "%f", &Q[q_counter]);
-            q_counter++;
-        }
-
-        int d_counter = 0;
-        while(!feof(file_D)){
-            fscanf(file_D, "%f", &D[d_counter]);
-            d_counter++;
-        }
-        
-        int p_counter = 0;
-        while(!feof(file_phase)){
-            fscanf(file_phase, "%f", &phase[p_counter]);
-            p_counter++;
-        }
-
-        int a_counter = 0;
-        while(!feof(file_amplitude)){
-            fscanf(file_amplitude, "%f", &amplitude[a_counter]);
-            a_counter++;
-        }
-        
-        int y_abs_counter = 0;
-        while(!feof(file_Y_abs)){
-            fscanf(file_Y_abs, "%f", &Y_abs[y_abs_counter]);
-            y_abs_counter++;
-        }
-
-        
-        int phaseY_counter = 0;
-        while(!feof(file_PhaseY)){
-            fscanf(file_PhaseY, "%f", &phaseY[phaseY_counter]);
-            phaseY_counter++;
-        }
-        
-        int R_s_counter = 0;
-        while(!feof(file_R_s)){
-            fscanf(file_R_s, "%f", &R_s[R_s_counter]);
-            R_s_counter++;
-        }
-        
-        int X_s_counter = 0;
-        while(!feof(file_X_s)){
-            fscanf(file_X_s, "%f", &X_s[X_s_counter]);
-            X_s_counter++;
-        }
-
-        int G_p_counter = 0;
-        while(!feof(file_G_p)){
-            fscanf(file_G_p, "%f", &G_p[G_p_counter]);
-            G_p_counter++;
-        }
-        
-        /* Closing all the files */
-        fclose(file_frequency);
-        fclose(file_amplitude);
-        fclose(file_phase);
-        fclose(file_Y_abs);
-        fclose(file_PhaseY);
-        fclose(file_R_s);
-        fclose(file_X_s);
-        fclose(file_G_p);
-        fclose(file_B_p);
-        fclose(file_C_s);
-        fclose(file_C_p);
-        fclose(file_L_s);
-        fclose(file_L_p);
-        fclose(file_R_p);
-        fclose(file_Q);
-        fclose(file_D);
-        
-        for(out_idx=0; out_idx < counter; out_idx++) {
-
-            /* Data check: TODO add switch statment for a niftier code */
-
-            float scale = rp_get_params_lcr(15);
-            if      (scale ==  0) cha_s[out_idx] = amplitude[out_idx];
-            else if (scale ==  1) cha_s[out_idx] = phase[out_idx]; 
-            else if (scale ==  2) cha_s[out_idx] = Y_abs[out_idx];
-            else if (scale ==  3) cha_s[out_idx] = phaseY[out_idx];
-            else if (scale ==  4) cha_s[out_idx] = R_s[out_idx];
-            else if (scale ==  5) cha_s[out_idx] = R_p[out_idx];
-            else if (scale ==  6) cha_s[out_idx] = X_s[out_idx];
-            else if (scale ==  7) cha_s[out_idx] = G_p[out_idx];
-            else if (scale ==  8) cha_s[out_idx] = B_p[out_idx];
-            else if (scale ==  9) cha_s[out_idx] = C_s[out_idx];
-            else if (scale == 10) cha_s[out_idx] = C_p[out_idx];
-            else if (scale == 11) cha_s[out_idx] = L_s[out_idx];
-            else if (scale == 12) cha_s[out_idx] = L_p[out_idx];
-            else if (scale == 13) cha_s[out_idx] = Q[out_idx];
-            else if (scale == 14) cha_s[out_idx] = D[out_idx];
-   
-            chb_s[out_idx] = 0;
-
-            /* Measurment sweep */
-            if(measure_method == 1){
-                t[out_idx] = out_idx;
-        
-            /* Frequency sweep */
-            }else if(measure_method == 2){
-                t[out_idx] = frequency[out_idx];
-            }
-        }     
-        
+        /* Points of the last sweep */
+        lcr_plot_points(lcr_points_num, t, cha_s, chb_s);
+        out_idx = lcr_points_num;
     }
     
     steps_counter = out_idx;
-    counter = 0;
 
     return 0;
 }
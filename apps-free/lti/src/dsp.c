@@ -25,6 +25,7 @@
 #include "fpga_lti.h"
 #include "dsp.h"
 #include "kiss_fftr.h"
+#include "kiss_fft_plan.h"
 #include "complex.h"
 
 
@@ -146,7 +147,7 @@ int rp_lti_fft_init()
     rp_kiss_fft_out2 =
         (kiss_fft_cpx *)malloc(LTI_FPGA_SIG_LEN * sizeof(kiss_fft_cpx));
 
-    rp_kiss_fft_cfg = kiss_fftr_alloc(LTI_FPGA_SIG_LEN, 0, NULL, NULL);
+    rp_kiss_fft_cfg = kiss_fftr_plan(LTI_FPGA_SIG_LEN, 0);
 
     return 0;
 }
@@ -162,10 +163,8 @@ int rp_lti_fft_clean()
         free(rp_kiss_fft_out2);
         rp_kiss_fft_out2 = NULL;
     }
-    if(rp_kiss_fft_cfg) {
-        free(rp_kiss_fft_cfg);
-        rp_kiss_fft_cfg = NULL;
-    }
+    /* shared plan, not ours to free */
+    rp_kiss_fft_cfg = NULL;
     return 0;
 }
 
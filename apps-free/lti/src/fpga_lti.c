@@ -18,12 +18,12 @@
 #include <string.h>
 #include <math.h>
 #include <errno.h>
-#include <sys/mman.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#include <fcntl.h>
 
+#include "regmap.h"
 #include "fpga_lti.h"
 
 
@@ -36,8 +36,8 @@ uint32_t           *g_lti_fpga_chb_mem = NULL;
 
 
 
-/* The memory file descriptor used to mmap() the FPGA space */
-int             g_lti_fpga_mem_fd = -1;
+/* The mapped FPGA block */
+static regmap_block_t g_lti_fpga_blk;
 
 /* constants */
 /* ADC format = s.13 */
@@ -60,10 +60,7 @@ double __rp_rand()
 int __lti_fpga_cleanup_mem(void)
 {
     if(g_lti_fpga_reg_mem) {
-        if(munmap(g_lti_fpga_reg_mem, LTI_FPGA_BASE_SIZE) < 0) {
-            fprintf(stderr, "munmap() failed: %s\n", strerror(errno));
-            return -1;
-        }
+        regmap_put(&g_lti_fpga_blk);
         g_lti_fpga_reg_mem = NULL;
         if(g_lti_fpga_cha_mem)
             g_lti_fpga_cha_mem = NULL;
@@ -71,49 +68,23 @@ int __lti_fpga_cleanup_mem(void)
             g_lti_fpga_chb_mem = NULL;
 
     }
-    if(g_lti_fpga_mem_fd >= 0) {
-        close(g_lti_fpga_mem_fd);
-        g_lti_fpga_mem_fd = -1;
-    }
 
     return 0;
 }
 
 static int get_hw_rev(hw_rev_t *hw_rev)
 {
-    void *page_ptr;
-    long page_addr, page_size = sysconf(_SC_PAGESIZE);
     const long c_hk_fpga_base_addr = 0x40000000;
-    const long c_hk_fpga_base_size = 0x20;
-    int fd = -1;
-
-    fd = open("/dev/mem", O_RDONLY | O_SYNC);
-    if(fd < 0) {
-        fprintf(stderr, "open(/dev/mem) failed: %s\n", strerror(errno));
-        return -1;
-    }
+    regmap_block_t blk;
 
-    page_addr = c_hk_fpga_base_addr & (~(page_size-1));
-
-    page_ptr = mmap(NULL, c_hk_fpga_base_size, PROT_READ,
-                          MAP_SHARED, fd, page_addr);
-
-    if((void *)page_ptr == MAP_FAILED) {
-        fprintf(stderr, "mmap() failed: %s\n", strerror(errno));
-        close(fd);
+    if(REGMAP_GET(c_hk_fpga_base_addr, hk_fpga_reg_mem_t, &blk) < 0) {
         return -1;
     }
 
-    hk_fpga_reg_mem_t *hk = page_ptr;
+    volatile hk_fpga_reg_mem_t *hk = REGMAP_REGS(&blk, hk_fpga_reg_mem_t);
     *hw_rev = hk->rev & HK_FPGA_HW_REV_MASK;
 
-    if(munmap(page_ptr, c_hk_fpga_base_size) < 0) {
-        fprintf(stderr, "munmap() failed: %s\n", strerror(errno));
-        close(fd);
-        return -1;
-    }
-
-    close (fd);
+    regmap_put(&blk);
 
     return 0;
 }
@@ -140,35 +111,19 @@ static int update_hw_spec_par(void)
 
 int lti_fpga_init(void)
 {
-    void *page_ptr;
-    long page_addr, page_off, page_size = sysconf(_SC_PAGESIZE);
-
     /* update hw specific parmateres */
     if(update_hw_spec_par()<0){
     	return -1;
     }
 
-    /* If maybe needed, cleanup the FD & memory pointer */
+    /* If maybe needed, cleanup the memory pointer */
     if(__lti_fpga_cleanup_mem() < 0)
         return -1;
 
-    g_lti_fpga_mem_fd = open("/dev/mem", O_RDWR | O_SYNC);
-    if(g_lti_fpga_mem_fd < 0) {
-        fprintf(stderr, "open(/dev/mem) failed: %s\n", strerror(errno));
-        return -1;
-    }
-
-    page_addr = LTI_FPGA_BASE_ADDR & (~(page_size-1));
-    page_off  = LTI_FPGA_BASE_ADDR - page_addr;
-
-    page_ptr = mmap(NULL, LTI_FPGA_BASE_SIZE, PROT_READ | PROT_WRITE,
-                          MAP_SHARED, g_lti_fpga_mem_fd, page_addr);
-    if((void *)page_ptr == MAP_FAILED) {
-        fprintf(stderr, "mmap() failed: %s\n", strerror(errno));
-        __lti_fpga_cleanup_mem();
+    if(regmap_get(LTI_FPGA_BASE_ADDR, LTI_FPGA_BASE_SIZE, &g_lti_fpga_blk) < 0) {
         return -1;
     }
-    g_lti_fpga_reg_mem = page_ptr + page_off;
+    g_lti_fpga_reg_mem = (lti_fpga_reg_mem_t *)g_lti_fpga_blk.regs;
     g_lti_fpga_cha_mem = (uint32_t *)g_lti_fpga_reg_mem + 
         (LTI_FPGA_CHA_OFFSET / sizeof(uint32_t));
     g_lti_fpga_chb_mem = (uint32_t *)g_lti_fpga_reg_mem + 
@@ -307,160 +262,59 @@ int lti_fpga_get_signal(double **cha_signal, double **chb_signal)
     return 0;
 }
 
-int lti_fpga_online_dsp(double **ch1_data, double **ch2_data, int gen_delay,  
-			   double **state_a, double **state_b, double **dsp_par_a, 
-			   double **dsp_par_b, int dsp_loc_ptr, int **awg_a_ptr, 
-			   int **awg_b_ptr)
+int lti_fpga_online_dsp(lti_sos_t *sos, lti_sos_stats_t *stats,
+                        double *cha_in, double *chb_in, int gen_delay,
+                        int dsp_loc_ptr, int *cha_awg)
 {
-    int curr_ptr, dsp_ptr;
-    int in_idx, out_idx, in_loc, out_loc;
-    double *cha_in = *ch1_data;  // Use this variables to pass DSP signals to GUI
-    double *chb_in = *ch2_data;
-    
-    double *cha_state = *state_a;    //Array used to register DSP states between calls
-    //double *chb_state = *state_b;  DSP enabled on channel 1 only
+    struct timespec t0, t1;
+    int curr_ptr, backlog, overrun = 0;
+    int in_idx, in_loc, out_idx;
+    uint32_t time_us;
 
-    double *cha_dsp_par = *dsp_par_a; // DSP parameters array
-    
-    double fir,iir,curr_in; // DSP variables    
-    int order;   
-    int dsp_ix;
-     
-    int *cha_awg=*awg_a_ptr;       
-    //int *chb_awg=*awg_b_ptr;     DSP enabled on channel 1 only
-
-    order= (int) (cha_dsp_par[64]); //IIR filter specific
-    
-    if(!cha_in || !chb_in) {
-        fprintf(stderr, "lti_fpga_get_signal() not initialized\n");
+    if(!sos || !cha_in || !chb_in || !cha_awg) {
+        fprintf(stderr, "lti_fpga_online_dsp() not initialized\n");
         return -1;
-    }  
-     
-     // Check current input write pointer (the buffer is running ("live" mode) ) 
-      lti_fpga_get_wr_ptr(&curr_ptr, NULL);
-    
-    
-   // Process the samples behind write pointer   
-     
-      
-      // Resolve buffer wrapping  
-      if ((curr_ptr)<dsp_loc_ptr)
-      {
-	curr_ptr=curr_ptr+LTI_FPGA_SIG_LEN;
-      }
-      //Now dsp_loc_ptr <= curr_ptr 
-      
-   
-      
-      //(loc. to be processed from dsp_loc_ptr to curr_ptr-1)  
-      for(in_idx= dsp_loc_ptr, out_idx=0; in_idx<(curr_ptr-1); in_idx++, out_idx++) {
-	
-	// Resolve buffer wrapping
-	in_loc = in_idx % LTI_FPGA_SIG_LEN;
-	
-	// Calculates output buffer location corresponting to current DSP input buffer location	
-	// The buffers are started simultaneously 
-	out_loc= (in_idx+gen_delay) % LTI_FPGA_SIG_LEN;
-	
-	
-	
-	// ADD DSP CODE HERE	
-	
-	// IIR FILTER implementation
-	
-	
-/**	
-**                      +--------------+      FIR             IIR                                                  
-**  INPUT               |              |                                                            OUTPUT             
-**+----------+---------->   x b0 (p0)  +----->(+)------------>(+)---------------------------------+--------->
-**           |          |              |       ^               ^                                  |          
-**           |          +--------------+       |               |                                  |          
-**           |                                 |               |                                  |          
-**           |                                 |               |                                  |    
-**    +------v------+                          |               |                           +------v------+   
-**    |             |                          |               |                           |             |   
-**    |     s0      |                          |               |                           |     s64     |   
-**    |             |                          |               |                           |             |   
-**    +------+------+                          |               |                           +------+------+                 
-**           |          +--------------+       |               |        +----------------+        |          
-**           |          |              |       |               |        |                |        |          
-**           +---------->   x b1 (p1)  +----->(+)             (+)<------+  x -a1 (-p65)  <--------+          
-**           |          |              |       ^               ^        |                |        |          
-**           |          +--------------+       |               |        +----------------+        |          
-**    +------v------+                          |               |                           +------v------+   
-**    |             |                          |               |                           |             |   
-**    |     s1      |                          |               |                           |     s65     |   
-**    |             |                          |               |                           |             |   
-**    +------+------+                          |               |                           +------+------+   
-**           |                                 |               |                                  |          
-**           |          +--------------+       |               |        +----------------+        |          
-**           |          |              |       |               |        |                |        |          
-**           +---------->   x b2 (p2)  +----->(+)             (+)<------+  x -a2 (-p66)  <--------+          
-**           |          |              |       ^               ^        |                |        |          
-**           |          +--------------+       |               |        +----------------+        |          
-**           v                                 +               +                                  v          
-**                                                                                                           */
-
-// MAC (MultiplyAndAccumulate) 
-	
-	// Retrieve input signal
-	curr_in=conv_s14_to_double(g_lti_fpga_cha_mem[in_loc]);
-	
-	//First FIR coefficient (b0)
-	fir=curr_in*cha_dsp_par[0];
-	//Initialize IIR
-	iir=0;
-	
-	// For every FIR and IIR coeff.
-	for (dsp_ix=0; dsp_ix<(order-1); dsp_ix++)
-	{
-	  // Accumulate delayed FIR input times FIR coeffs. (starting from s0*b1 (at loc 1))
-	  fir+=cha_state[dsp_ix]*cha_dsp_par[dsp_ix+1];
-	  // Accumulate delayes IIR output state times IIR coeffs. (starting from s64*(-a1) (at loc p65), a0 is by definition =1, (at loc. p64 is stored filter order))
-	  iir+=cha_state[64+dsp_ix]*(-cha_dsp_par[64+dsp_ix+1]);
-	   
-	  //fprintf(fp3, "  dsp_ix: %d (in_idx: %d) fir: %4.4f iir: %4.4f ParFIR: %4.4f ParIIR: %4.4f  stat_fir: %4.4f  stat_iir: %4.4f\n", dsp_ix, in_idx, fir, iir, cha_dsp_par[dsp_ix+1], (-cha_dsp_par[64+dsp_ix+1]), cha_state[dsp_ix], cha_state[64+dsp_ix] );   
-	 
-	}
-	//add also FIR term
-	iir+=fir;
-	
-	// Propagating states for next iteration: from last register in the chain to the first
-	
-	for (dsp_ix=(order-1); dsp_ix>0 ;dsp_ix--)
-	{
-	  // FIR states
-	  cha_state[dsp_ix]=cha_state[dsp_ix-1];
-	  // IIR states
-	  cha_state[64+dsp_ix]=cha_state[64+dsp_ix-1];
-	}
-	//Updating first registers
-	cha_state[0]=curr_in;
-	cha_state[64]=iir;
-	
-	// First IIR register corresponds to output to be applied to DAC
-	cha_awg[out_loc] = conv_double_to_s14(cha_state[64]);
-	
-	
-	//IIR implementation ends
-	
-	
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    /* One snapshot of the write pointer per call, everything behind it
+     * (except the sample being written) is processed as one block */
+    lti_fpga_get_wr_ptr(&curr_ptr, NULL);
+    if(curr_ptr < dsp_loc_ptr)
+        curr_ptr += LTI_FPGA_SIG_LEN;
+    backlog = curr_ptr - dsp_loc_ptr;
+
+    /* Outputs for the oldest samples are already late (generator read
+     * pointer passed them) - drop them and continue with fresh ones */
+    if(backlog >= gen_delay) {
+        overrun = 1;
+        dsp_loc_ptr = curr_ptr - gen_delay / 2;
+    }
 
-	// Signal acquisition: pass processed samples for GUI visualization purposes
-	cha_in[out_idx] = g_lti_fpga_cha_mem[in_loc];
+    /* DSP enabled on channel 1 only */
+    lti_sos_run(sos, g_lti_fpga_cha_mem, cha_awg, LTI_FPGA_SIG_LEN,
+                dsp_loc_ptr, curr_ptr - 1, gen_delay);
+
+    /* Signal acquisition: pass processed samples for GUI visualization */
+    in_loc = dsp_loc_ptr % LTI_FPGA_SIG_LEN;
+    for(in_idx = dsp_loc_ptr, out_idx = 0; in_idx < (curr_ptr - 1);
+        in_idx++, out_idx++) {
+        cha_in[out_idx] = g_lti_fpga_cha_mem[in_loc];
         chb_in[out_idx] = g_lti_fpga_chb_mem[in_loc];
-	
-      }
-      // return next DSP cycle pointer
-      dsp_ptr=(curr_ptr-1) % LTI_FPGA_SIG_LEN;;
-      
-      //Thid pointer can be used to calculate elapsed DSP time
-      //lti_fpga_get_wr_ptr(&curr_ptr, NULL);
- 
-      
-      
-      
-  return dsp_ptr;
+        if(++in_loc == LTI_FPGA_SIG_LEN)
+            in_loc = 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    time_us = (t1.tv_sec - t0.tv_sec) * 1000000 +
+        (t1.tv_nsec - t0.tv_nsec) / 1000;
+    if(stats)
+        lti_sos_stats_add(stats, (curr_ptr - 1) - dsp_loc_ptr, backlog,
+                          time_us, overrun);
+
+    /* return next DSP cycle pointer */
+    return (curr_ptr - 1) % LTI_FPGA_SIG_LEN;
 }
 
 double conv_s14_to_double(int sigs14)
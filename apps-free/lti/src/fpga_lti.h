@@ -18,6 +18,8 @@
 
 #include <stdint.h>
 
+#include "lti_sos.h"
+
 /* Housekeeping base address 0x40000000 */
 #define HK_FPGA_BASE_ADDR 0x40000000
 #define HK_FPGA_HW_REV_MASK 0x0000000f
@@ -45,7 +47,6 @@ typedef struct hk_fpga_reg_mem_s {
 #define LTI_FPGA_BASE_SIZE 0x30000
 
 #define LTI_FPGA_SIG_LEN   (16*1024)
-#define LTI_DSP_STATES     128
 #define LTI_DSP_PARAMS     128
 
 
@@ -210,8 +211,12 @@ int lti_fpga_get_sig_ptr(int **cha_signal, int **chb_signal);
 /* Copies the last acquisition (trig wr. ptr -> curr. wr. ptr) */
 int lti_fpga_get_signal(double **cha_signal, double **chb_signal);
 
-/* Acquisition embedded DSP module */
-int lti_fpga_online_dsp(double **ch1_data, double **ch2_data, int gen_delay, double **state_a, double **state_b, double **dsp_par_a, double **dsp_par_b, int dsp_loc_ptr, int **awg_a_ptr, int **awg_b_ptr);
+/* Acquisition embedded DSP module: filters channel A samples acquired since
+ * dsp_loc_ptr into generator buffer (gen_delay locations ahead), copies the
+ * raw input to cha_in/chb_in and returns the next DSP cycle pointer */
+int lti_fpga_online_dsp(lti_sos_t *sos, lti_sos_stats_t *stats,
+                        double *cha_in, double *chb_in, int gen_delay,
+                        int dsp_loc_ptr, int *cha_awg);
 
 /* Helper function: complement two's conversion*/
 double conv_s14_to_double(int sigs14);
@@ -248,7 +253,6 @@ float lti_fpga_cnv_cnt_to_v(int cnts);
 
 /* debugging - will be removed */
 extern lti_fpga_reg_mem_t *g_lti_fpga_reg_mem;
-extern                int  g_lti_fpga_mem_fd;
 int __lti_fpga_cleanup_mem(void);
 
 #endif /* __FPGA_H*/
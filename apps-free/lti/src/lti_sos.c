@@ -0,0 +1,561 @@
+/**
+ * $Id:
+ *
+ * @brief Red Pitaya LTI workbench second-order-section filter engine.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+
+#include "lti_sos.h"
+
+/* Aberth iteration limits: converged below TOL, or below STALL once
+ * rounding noise stops the steps from getting smaller */
+#define LTI_SOS_ROOT_ITER  2000
+#define LTI_SOS_ROOT_TOL   1e-13
+#define LTI_SOS_ROOT_STALL 1e-7
+
+/* Signal limit between sections (Q.8), keeps 64-bit states from overflow */
+#define LTI_SOS_Q_SIG_MAX  ((1 << 28) - 1)
+
+/* Largest Q4.28 coefficient and numerator scaling limit */
+#define LTI_SOS_Q_COEF_MAX 7.99
+#define LTI_SOS_Q_SHIFT_MAX 16
+
+/* Frequency points for scaling of the sections */
+#define LTI_SOS_SCALE_GRID 512
+
+/* First or second order polynomial factor in z^-1 */
+typedef struct lti_sos_fac_s {
+    double         c[3];
+    /* representative root (in z) used for pole/zero pairing */
+    double complex root;
+    int            used;
+} lti_sos_fac_t;
+
+
+/* Roots of c[0]*z^n + c[1]*z^(n-1) + ... + c[n], c[0] != 0 */
+static int lti_sos_roots(const double *c, int n, double complex *r)
+{
+    double complex p[LTI_SOS_MAX_ORDER+1];
+    double radius, best_step = INFINITY;
+    int i, j, it, stall = 0;
+
+    for(i = 0; i <= n; i++)
+        p[i] = c[i] / c[0];
+
+    /* Start on a circle with the mean root magnitude (p[n] != 0) */
+    radius = pow(cabs(p[n]), 1.0 / n);
+    for(i = 0; i < n; i++)
+        r[i] = radius * cexp(I * (2*M_PI*i/n + 0.4));
+
+    for(it = 0; it < LTI_SOS_ROOT_ITER; it++) {
+        double max_step = 0;
+
+        for(i = 0; i < n; i++) {
+            double complex val = p[0], der = 0, sum = 0, ratio, step;
+
+            /* Horner for the polynomial and its derivative */
+            for(j = 1; j <= n; j++) {
+                der = der * r[i] + val;
+                val = val * r[i] + p[j];
+            }
+            if(val == 0)
+                continue;
+            for(j = 0; j < n; j++) {
+                if(j != i && r[i] != r[j])
+                    sum += 1.0 / (r[i] - r[j]);
+            }
+
+            ratio = (der == 0) ? LTI_SOS_ROOT_TOL : val / der;
+            step = ratio / (1.0 - ratio * sum);
+            r[i] -= step;
+            if(cabs(step) / (1 + cabs(r[i])) > max_step)
+                max_step = cabs(step) / (1 + cabs(r[i]));
+        }
+        if(isnan(max_step))
+            return -1;
+        if(max_step < best_step) {
+            best_step = max_step;
+            stall = 0;
+        } else if(best_step < LTI_SOS_ROOT_STALL && ++stall > 20) {
+            break;
+        }
+        if(best_step < LTI_SOS_ROOT_TOL)
+            break;
+    }
+    if(best_step >= LTI_SOS_ROOT_STALL)
+        return -1;
+
+    /* Snap almost real roots to the real axis */
+    for(i = 0; i < n; i++) {
+        if(fabs(cimag(r[i])) < 1e-9 * (1 + cabs(r[i])))
+            r[i] = creal(r[i]);
+    }
+    return 0;
+}
+
+static int lti_sos_cmp_real(const void *a, const void *b)
+{
+    double d = *(const double *)a - *(const double *)b;
+    return (d > 0) - (d < 0);
+}
+
+/* Splits polynomial in z^-1 into gain and first/second order factors, each
+ * normalized so that its first non-zero coefficient is 1.
+ * Returns number of factors or -1.
+ */
+static int lti_sos_factors(const double *coef, int len, lti_sos_fac_t *fac,
+                           double *gain, int *delay)
+{
+    double complex roots[LTI_SOS_MAX_ORDER];
+    double real[LTI_SOS_MAX_ORDER];
+    int lz = 0, m, i, n_real = 0, n_fac = 0;
+
+    /* Trailing zeros are roots at the origin, they cancel out */
+    while(len > 0 && coef[len-1] == 0)
+        len--;
+    if(len == 0) {
+        *gain = 0;
+        *delay = 0;
+        return 0;
+    }
+    /* Leading zeros are pure delays */
+    while(coef[lz] == 0)
+        lz++;
+    m = len - lz - 1;
+    if(len - 1 > LTI_SOS_MAX_ORDER)
+        return -1;
+
+    *gain = coef[lz];
+    *delay = lz;
+
+    if(m > 0 && lti_sos_roots(&coef[lz], m, roots) < 0)
+        return -1;
+
+    for(i = 0; i < m; i++) {
+        if(cimag(roots[i]) > 0) {
+            fac[n_fac].c[0] = 1;
+            fac[n_fac].c[1] = -2 * creal(roots[i]);
+            fac[n_fac].c[2] = creal(roots[i] * conj(roots[i]));
+            fac[n_fac].root = roots[i];
+            fac[n_fac].used = 0;
+            n_fac++;
+        } else if(cimag(roots[i]) == 0) {
+            real[n_real++] = creal(roots[i]);
+        }
+    }
+
+    /* Neighbouring real roots share a section */
+    qsort(real, n_real, sizeof(double), lti_sos_cmp_real);
+    for(i = 0; i + 1 < n_real; i += 2) {
+        fac[n_fac].c[0] = 1;
+        fac[n_fac].c[1] = -(real[i] + real[i+1]);
+        fac[n_fac].c[2] = real[i] * real[i+1];
+        fac[n_fac].root = fabs(real[i]) > fabs(real[i+1]) ? real[i] : real[i+1];
+        fac[n_fac].used = 0;
+        n_fac++;
+    }
+    if(i < n_real) {
+        fac[n_fac].c[0] = 1;
+        fac[n_fac].c[1] = -real[i];
+        fac[n_fac].c[2] = 0;
+        if(lz & 1) {
+            /* merge the odd delay with the single real root */
+            fac[n_fac].c[2] = fac[n_fac].c[1];
+            fac[n_fac].c[1] = fac[n_fac].c[0];
+            fac[n_fac].c[0] = 0;
+            lz--;
+        }
+        fac[n_fac].root = real[i];
+        fac[n_fac].used = 0;
+        n_fac++;
+    }
+    for(; lz > 0; lz -= 2) {
+        fac[n_fac].c[0] = 0;
+        fac[n_fac].c[1] = (lz == 1) ? 1 : 0;
+        fac[n_fac].c[2] = (lz == 1) ? 0 : 1;
+        fac[n_fac].root = INFINITY;
+        fac[n_fac].used = 0;
+        n_fac++;
+    }
+    return n_fac;
+}
+
+static int lti_sos_cmp_radius(const void *a, const void *b)
+{
+    double d = cabs(((const lti_sos_fac_t *)a)->root) -
+               cabs(((const lti_sos_fac_t *)b)->root);
+    return (d > 0) - (d < 0);
+}
+
+static int32_t lti_sos_to_q(double c, int *saturated)
+{
+    double q = rint(c * (double)(1 << LTI_SOS_COEF_Q));
+
+    if(q > INT32_MAX) {
+        *saturated = 1;
+        return INT32_MAX;
+    }
+    if(q < INT32_MIN) {
+        *saturated = 1;
+        return INT32_MIN;
+    }
+    return (int32_t)q;
+}
+
+int lti_sos_design(lti_sos_t *sos, const double *b, int nb,
+                   const double *a, int na, lti_sos_fmt_t fmt)
+{
+    lti_sos_fac_t num[LTI_SOS_MAX_ORDER], den[LTI_SOS_MAX_ORDER];
+    int num_map[LTI_SOS_MAX_ORDER];
+    double coef[LTI_SOS_MAX_SECT*5];
+    double b_gain, a_gain, g;
+    int n_num, n_den, b_delay, a_delay, sect_num, s, i;
+
+    if(!sos || !b || !a || nb < 1 || na < 1 || a[0] == 0 ||
+       nb > LTI_SOS_MAX_ORDER+1 || na > LTI_SOS_MAX_ORDER+1)
+        return -1;
+
+    n_num = lti_sos_factors(b, nb, num, &b_gain, &b_delay);
+    n_den = lti_sos_factors(a, na, den, &a_gain, &a_delay);
+    if(n_num < 0 || n_den < 0 || a_delay)
+        return -1;
+
+    sect_num = (n_num > n_den) ? n_num : n_den;
+    if(sect_num < 1)
+        sect_num = 1;
+    if(sect_num > LTI_SOS_MAX_SECT)
+        return -1;
+
+    /* Poles by increasing radius; from the outermost pole inwards each
+     * pole factor takes the closest free zero factor */
+    qsort(den, n_den, sizeof(lti_sos_fac_t), lti_sos_cmp_radius);
+    for(s = n_den - 1; s >= 0; s--) {
+        double best = INFINITY;
+        num_map[s] = -1;
+        for(i = 0; i < n_num; i++) {
+            double d = isinf(creal(num[i].root)) ? HUGE_VAL :
+                                                   cabs(num[i].root - den[s].root);
+            if(!num[i].used && (num_map[s] < 0 || d < best)) {
+                best = d;
+                num_map[s] = i;
+            }
+        }
+        if(num_map[s] >= 0)
+            num[num_map[s]].used = 1;
+    }
+
+    g = b_gain / a_gain;
+    for(s = 0; s < sect_num; s++) {
+        const double one[3] = { 1, 0, 0 };
+        const double *nc = one, *dc = one;
+        /* zero-only sections first, then poles by increasing radius */
+        int d = s - (sect_num - n_den);
+
+        if(d >= 0) {
+            dc = den[d].c;
+            if(num_map[d] >= 0)
+                nc = num[num_map[d]].c;
+        } else {
+            for(i = 0; i < n_num; i++) {
+                if(!num[i].used) {
+                    num[i].used = 1;
+                    nc = num[i].c;
+                    break;
+                }
+            }
+        }
+
+        /* whole gain in the first section, lti_sos_set() rescales */
+        for(i = 0; i < 3; i++)
+            coef[s*5+i] = nc[i] * (s ? 1 : g);
+        coef[s*5+3] = dc[1];
+        coef[s*5+4] = dc[2];
+    }
+    return lti_sos_set(sos, coef, sect_num, fmt);
+}
+
+/* Max. magnitude of the cascade (with its gains) over the frequency grid */
+static void lti_sos_cascade_peak(const double *coef, int sect_num,
+                                 double complex *resp, double *peak)
+{
+    int k;
+
+    *peak = 0;
+    for(k = 0; k < LTI_SOS_SCALE_GRID; k++) {
+        double complex w = cexp(-I * M_PI * k / (LTI_SOS_SCALE_GRID - 1));
+        double complex num = coef[0] + w * (coef[1] + w * coef[2]);
+        double complex den = 1 + w * (coef[3] + w * coef[4]);
+
+        resp[k] *= num / den;
+        if(cabs(resp[k]) > *peak)
+            *peak = cabs(resp[k]);
+    }
+}
+
+int lti_sos_set(lti_sos_t *sos, const double *coef, int sect_num,
+                lti_sos_fmt_t fmt)
+{
+    double complex resp[LTI_SOS_SCALE_GRID];
+    double scaled[5], peak, gain = 1;
+    int s, i;
+
+    if(!sos || !coef || sect_num < 1 || sect_num > LTI_SOS_MAX_SECT)
+        return -1;
+
+    memset(sos, 0, sizeof(lti_sos_t));
+    sos->fmt = fmt;
+    sos->sect_num = sect_num;
+
+    for(i = 0; i < LTI_SOS_SCALE_GRID; i++)
+        resp[i] = 1;
+
+    for(s = 0; s < sect_num; s++) {
+        for(i = 0; i < 5; i++)
+            scaled[i] = coef[s*5+i];
+        for(i = 0; i < 3; i++)
+            scaled[i] *= gain;
+
+        /* Peak gain from the input to this section's output is one, the
+         * last section restores the overall gain. Keeps fixed point
+         * signals between sections in range. */
+        if(s < sect_num - 1) {
+            lti_sos_cascade_peak(scaled, 1, resp, &peak);
+            if(peak > 0) {
+                for(i = 0; i < LTI_SOS_SCALE_GRID; i++)
+                    resp[i] /= peak;
+                for(i = 0; i < 3; i++)
+                    scaled[i] /= peak;
+                gain = peak;
+            }
+        }
+
+        for(i = 0; i < 5; i++)
+            sos->coef[s][i] = scaled[i];
+
+        /* Fixed point: numerator larger than the Q4.28 range is scaled
+         * down and the section output shifted back up */
+        for(i = 0; i < 3; i++) {
+            while(fabs(scaled[i]) >= LTI_SOS_Q_COEF_MAX) {
+                if(sos->qshift[s] == LTI_SOS_Q_SHIFT_MAX) {
+                    sos->q_saturated = 1;
+                    break;
+                }
+                scaled[0] /= 2;
+                scaled[1] /= 2;
+                scaled[2] /= 2;
+                sos->qshift[s]++;
+            }
+        }
+        for(i = 0; i < 5; i++)
+            sos->qcoef[s][i] = lti_sos_to_q(scaled[i], &sos->q_saturated);
+    }
+    return 0;
+}
+
+void lti_sos_reset(lti_sos_t *sos)
+{
+    memset(sos->state, 0, sizeof(sos->state));
+    memset(sos->qstate, 0, sizeof(sos->qstate));
+}
+
+static void lti_sos_block_float(lti_sos_t *sos, float *buf, int len)
+{
+    int s, n;
+
+    for(s = 0; s < sos->sect_num; s++) {
+        const float b0 = sos->coef[s][0], b1 = sos->coef[s][1],
+                    b2 = sos->coef[s][2], a1 = sos->coef[s][3],
+                    a2 = sos->coef[s][4];
+        float s1 = sos->state[s][0], s2 = sos->state[s][1];
+
+        for(n = 0; n < len; n++) {
+            float x = buf[n];
+            float y = b0 * x + s1;
+            s1 = b1 * x - a1 * y + s2;
+            s2 = b2 * x - a2 * y;
+            buf[n] = y;
+        }
+        sos->state[s][0] = s1;
+        sos->state[s][1] = s2;
+    }
+}
+
+static void lti_sos_block_fixed(lti_sos_t *sos, int32_t *buf, int len)
+{
+    int s, n;
+
+    for(s = 0; s < sos->sect_num; s++) {
+        const int64_t b0 = sos->qcoef[s][0], b1 = sos->qcoef[s][1],
+                      b2 = sos->qcoef[s][2], a1 = sos->qcoef[s][3],
+                      a2 = sos->qcoef[s][4];
+        const int     shift = sos->qshift[s];
+        int64_t s1 = sos->qstate[s][0], s2 = sos->qstate[s][1];
+
+        for(n = 0; n < len; n++) {
+            int64_t x = buf[n];
+            int64_t y = (b0 * x + s1 + (1 << (LTI_SOS_COEF_Q-1))) >> LTI_SOS_COEF_Q;
+            if(y > LTI_SOS_Q_SIG_MAX)
+                y = LTI_SOS_Q_SIG_MAX;
+            else if(y < -LTI_SOS_Q_SIG_MAX)
+                y = -LTI_SOS_Q_SIG_MAX;
+            s1 = b1 * x - a1 * y + s2;
+            s2 = b2 * x - a2 * y;
+            y <<= shift;
+            if(y > LTI_SOS_Q_SIG_MAX)
+                y = LTI_SOS_Q_SIG_MAX;
+            else if(y < -LTI_SOS_Q_SIG_MAX)
+                y = -LTI_SOS_Q_SIG_MAX;
+            buf[n] = (int32_t)y;
+        }
+        sos->qstate[s][0] = s1;
+        sos->qstate[s][1] = s2;
+    }
+}
+
+void lti_sos_filter(lti_sos_t *sos, const float *in, float *out, int len)
+{
+    int32_t q[LTI_SOS_BLOCK];
+    int n;
+
+    if(len > LTI_SOS_BLOCK)
+        len = LTI_SOS_BLOCK;
+
+    if(sos->fmt == lti_sos_float) {
+        if(out != in)
+            memcpy(out, in, len * sizeof(float));
+        lti_sos_block_float(sos, out, len);
+        return;
+    }
+
+    for(n = 0; n < len; n++)
+        q[n] = (int32_t)lrintf(in[n] * (1 << LTI_SOS_SIG_Q));
+    lti_sos_block_fixed(sos, q, len);
+    for(n = 0; n < len; n++)
+        out[n] = (float)q[n] / (1 << LTI_SOS_SIG_Q);
+}
+
+/* 14-bit two's complement sample to int */
+static inline int32_t lti_sos_s14(uint32_t v)
+{
+    return ((int32_t)(v << 18)) >> 18;
+}
+
+/* Saturated int to 14-bit two's complement */
+static inline int lti_sos_to_s14(int32_t v)
+{
+    if(v > (1 << 13) - 1)
+        v = (1 << 13) - 1;
+    else if(v < -(1 << 13))
+        v = -(1 << 13);
+    return v & 0x3fff;
+}
+
+int lti_sos_run(lti_sos_t *sos, const uint32_t *adc, int *dac, int buf_len,
+                int from, int to, int delay)
+{
+    union {
+        float   f[LTI_SOS_BLOCK];
+        int32_t q[LTI_SOS_BLOCK];
+    } buf;
+    int in_loc, out_loc, left, len, n;
+
+    if(to <= from)
+        return 0;
+
+    in_loc  = from % buf_len;
+    out_loc = (from + delay) % buf_len;
+
+    for(left = to - from; left > 0; left -= len) {
+        len = (left > LTI_SOS_BLOCK) ? LTI_SOS_BLOCK : left;
+
+        if(sos->fmt == lti_sos_float) {
+            for(n = 0; n < len; n++) {
+                buf.f[n] = (float)lti_sos_s14(adc[in_loc]);
+                if(++in_loc == buf_len)
+                    in_loc = 0;
+            }
+            lti_sos_block_float(sos, buf.f, len);
+            for(n = 0; n < len; n++) {
+                float y = buf.f[n];
+                /* clamp before conversion, lrintf() of a huge value is UB */
+                if(y > (1 << 13))
+                    y = (1 << 13);
+                else if(y < -(1 << 13) - 1)
+                    y = -(1 << 13) - 1;
+                dac[out_loc] = lti_sos_to_s14((int32_t)lrintf(y));
+                if(++out_loc == buf_len)
+                    out_loc = 0;
+            }
+        } else {
+            for(n = 0; n < len; n++) {
+                buf.q[n] = lti_sos_s14(adc[in_loc]) << LTI_SOS_SIG_Q;
+                if(++in_loc == buf_len)
+                    in_loc = 0;
+            }
+            lti_sos_block_fixed(sos, buf.q, len);
+            for(n = 0; n < len; n++) {
+                dac[out_loc] = lti_sos_to_s14(
+                    (buf.q[n] + (1 << (LTI_SOS_SIG_Q-1))) >> LTI_SOS_SIG_Q);
+                if(++out_loc == buf_len)
+                    out_loc = 0;
+            }
+        }
+    }
+    return to - from;
+}
+
+void lti_sos_stats_reset(lti_sos_stats_t *st)
+{
+    memset(st, 0, sizeof(lti_sos_stats_t));
+}
+
+static int lti_sos_hist_bin(uint32_t v)
+{
+    int bin = 0;
+
+    for(v++; v > 1 && bin < LTI_SOS_HIST_BINS - 1; v >>= 1)
+        bin++;
+    return bin;
+}
+
+void lti_sos_stats_add(lti_sos_stats_t *st, int samples, uint32_t lat,
+                       uint32_t time_us, int overrun)
+{
+    st->calls++;
+    st->samples += samples;
+    if(overrun)
+        st->overruns++;
+    if(lat > st->lat_max)
+        st->lat_max = lat;
+    if(time_us > st->time_max)
+        st->time_max = time_us;
+    st->lat_hist[lti_sos_hist_bin(lat)]++;
+    st->time_hist[lti_sos_hist_bin(time_us)]++;
+}
+
+void lti_sos_stats_print(FILE *f, const lti_sos_stats_t *st)
+{
+    int i;
+
+    fprintf(f, "calls %u, samples %llu, overruns %u, max backlog %u smp, "
+            "max time %u us\n", st->calls, (unsigned long long)st->samples,
+            st->overruns, st->lat_max, st->time_max);
+    fprintf(f, "  %-15s %10s %10s\n", "range", "backlog", "time");
+    for(i = 0; i < LTI_SOS_HIST_BINS; i++) {
+        if(!st->lat_hist[i] && !st->time_hist[i])
+            continue;
+        fprintf(f, "  [%5u, %5u) %10u %10u\n", (1u << i) - 1,
+                (1u << (i + 1)) - 1, st->lat_hist[i], st->time_hist[i]);
+    }
+}
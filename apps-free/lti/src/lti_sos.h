@@ -0,0 +1,124 @@
+/**
+ * $Id:
+ *
+ * @brief Red Pitaya LTI workbench second-order-section filter engine.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __LTI_SOS_H
+#define __LTI_SOS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Maximal filter order (number of poles or zeros) */
+#define LTI_SOS_MAX_ORDER     64
+#define LTI_SOS_MAX_SECT      (LTI_SOS_MAX_ORDER/2)
+/* Samples processed through all sections at once */
+#define LTI_SOS_BLOCK         256
+/* Fixed point: coefficient and signal fraction bits */
+#define LTI_SOS_COEF_Q        28
+#define LTI_SOS_SIG_Q         8
+/* Histogram bin i counts values in [2^i-1, 2^(i+1)-1) */
+#define LTI_SOS_HIST_BINS     16
+
+typedef enum lti_sos_fmt_e {
+    lti_sos_float = 0, /* single precision */
+    lti_sos_fixed      /* Q4.28 coefficients, Q.8 signals, 64-bit states */
+} lti_sos_fmt_t;
+
+/* Cascade of biquads in transposed direct form II:
+ *   y  = b0*x + s1
+ *   s1 = b1*x - a1*y + s2
+ *   s2 = b2*x - a2*y
+ */
+typedef struct lti_sos_s {
+    lti_sos_fmt_t fmt;
+    int           sect_num;
+    /* b0, b1, b2, a1, a2 per section */
+    float         coef[LTI_SOS_MAX_SECT][5];
+    float         state[LTI_SOS_MAX_SECT][2];
+    int32_t       qcoef[LTI_SOS_MAX_SECT][5];
+    /* section output is shifted left to undo numerator down-scaling */
+    int           qshift[LTI_SOS_MAX_SECT];
+    int64_t       qstate[LTI_SOS_MAX_SECT][2];
+    /* Some fixed point coefficient did not fit and was saturated */
+    int           q_saturated;
+} lti_sos_t;
+
+typedef struct lti_sos_stats_s {
+    uint32_t calls;
+    uint64_t samples;
+    /* Calls where the backlog reached the generator delay */
+    uint32_t overruns;
+    /* Backlog (samples behind ADC write pointer) at the start of a call */
+    uint32_t lat_max;
+    uint32_t lat_hist[LTI_SOS_HIST_BINS];
+    /* Processing time of a call [us] */
+    uint32_t time_max;
+    uint32_t time_hist[LTI_SOS_HIST_BINS];
+} lti_sos_stats_t;
+
+/** Factors the transfer function into second order sections.
+ *
+ *          b[0] + b[1] z^-1 + ... + b[nb-1] z^-(nb-1)
+ *  H(z) = --------------------------------------------
+ *          a[0] + a[1] z^-1 + ... + a[na-1] z^-(na-1)
+ *
+ * Complex poles and zeros are paired into sections, each pole pair with its
+ * closest zero pair, and the sections are scaled as by lti_sos_set().
+ * Filter states are cleared.
+ *
+ * @param sos  filter to set up
+ * @param b    numerator coefficients
+ * @param nb   number of numerator coefficients (<= LTI_SOS_MAX_ORDER+1)
+ * @param a    denominator coefficients, a[0] must not be zero
+ * @param na   number of denominator coefficients (<= LTI_SOS_MAX_ORDER+1)
+ * @param fmt  arithmetic used by lti_sos_run()
+ * @retval 0 on success, -1 on invalid input or if root finding failed
+ */
+int lti_sos_design(lti_sos_t *sos, const double *b, int nb,
+                   const double *a, int na, lti_sos_fmt_t fmt);
+
+/** Sets up the filter from second order sections.
+ *
+ * Section gains are rebalanced so that the peak gain from the input to every
+ * section output but the last is one; the overall response is kept. High
+ * order filters should be given this way, the polynomial form used by
+ * lti_sos_design() gets ill-conditioned with clustered poles.
+ *
+ * @param coef      b0, b1, b2, a1, a2 of each section (a0 = 1)
+ * @param sect_num  number of sections (<= LTI_SOS_MAX_SECT)
+ * @retval 0 on success, -1 on invalid input
+ */
+int lti_sos_set(lti_sos_t *sos, const double *coef, int sect_num,
+                lti_sos_fmt_t fmt);
+
+/* Clears filter states */
+void lti_sos_reset(lti_sos_t *sos);
+
+/* Filters len samples (len <= LTI_SOS_BLOCK), in and out may be the same */
+void lti_sos_filter(lti_sos_t *sos, const float *in, float *out, int len);
+
+/** Filters circular s14 ADC buffer into circular s14 DAC buffer.
+ *
+ * Input samples [from, to) are processed (to may be larger than buf_len,
+ * indexes wrap) and every output is written delay samples ahead of its
+ * input location.
+ *
+ * @retval number of processed samples
+ */
+int lti_sos_run(lti_sos_t *sos, const uint32_t *adc, int *dac, int buf_len,
+                int from, int to, int delay);
+
+void lti_sos_stats_reset(lti_sos_stats_t *st);
+void lti_sos_stats_add(lti_sos_stats_t *st, int samples, uint32_t lat,
+                       uint32_t time_us, int overrun);
+void lti_sos_stats_print(FILE *f, const lti_sos_stats_t *st);
+
+#endif /* __LTI_SOS_H */
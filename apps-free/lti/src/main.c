@@ -74,6 +74,14 @@ static rp_app_params_t rp_main_params[PARAMS_NUM+1] = {
         "lti_a4", 0, 1, 0, -1e9, 1e9 },
     { /* LTI coeff */
         "lti_a5", 0, 1, 0, -1e9, 1e9 },	
+    { /* dsp_fixed - online DSP arithmetic:
+       *    0 - floating point
+       *    1 - fixed point (Q4.28 coefficients) */
+        "dsp_fixed", 0, 0, 0, 0, 1 },
+    { /* dsp_overruns - read only: DSP cycles which fell behind generator */
+        "dsp_overruns", 0, 0, 1, 0, 1e9 },
+    { /* dsp_lat_max - read only: max. samples waiting for DSP */
+        "dsp_lat_max", 0, 0, 1, 0, 1e9 },
 	
     { /* Must be last! */
         NULL, 0.0, -1, -1, 0.0, 0.0 }
@@ -203,6 +211,7 @@ int rp_set_params(rp_app_params_t *p, int len)
 int rp_get_params(rp_app_params_t **p)
 {
     rp_app_params_t *p_copy = NULL;
+    lti_sos_stats_t  dsp_stats;
     
     int i;
 
@@ -210,6 +219,10 @@ int rp_get_params(rp_app_params_t **p)
     if(p_copy == NULL)
         return -1;
 
+    rp_lti_worker_get_dsp_stats(&dsp_stats);
+    rp_main_params[LTI_DSP_OVERRUNS].value = dsp_stats.overruns;
+    rp_main_params[LTI_DSP_LAT_MAX].value  = dsp_stats.lat_max;
+
     for(i = 0; i < PARAMS_NUM; i++) {
         int p_strlen = strlen(rp_main_params[i].name);
         p_copy[i].name = (char *)malloc(p_strlen+1);
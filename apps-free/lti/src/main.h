@@ -28,7 +28,7 @@ typedef struct rp_app_params_s {
 
 /* Parameters indexes - these defines should be in the same order as
  * rp_app_params_t structure defined in main.c */
-#define PARAMS_NUM             16
+#define PARAMS_NUM             19
 #define MIN_GUI_PARAM          0
 #define MAX_GUI_PARAM          1
 #define FREQ_RANGE_PARAM       2
@@ -45,6 +45,9 @@ typedef struct rp_app_params_s {
 #define LTI_A3     		13
 #define LTI_A4     		14
 #define LTI_A5     		15
+#define LTI_DSP_FIXED   	16
+#define LTI_DSP_OVERRUNS	17
+#define LTI_DSP_LAT_MAX 	18
 
 
 
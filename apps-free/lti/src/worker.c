@@ -13,8 +13,10 @@
  * for more details on the language used herein.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <pthread.h>
+#include <sched.h>
 #include <errno.h>
 #include <string.h>
 #include <unistd.h>
@@ -25,6 +27,7 @@
 #include <dirent.h>
 
 #include "worker.h"
+#include "kiss_fft_plan.h"
 #include "fpga_lti.h"
 #include "generate_basic.h"
 #include "dsp.h"
@@ -43,12 +46,18 @@ int                  *rp_fpga_cha_gen, *rp_fpga_chb_gen;
 double *rp_cha_in = NULL;
 double *rp_chb_in = NULL;
 
-double *rp_dsp_state_a = NULL;
-double *rp_dsp_state_b = NULL;
-
 double *rp_dsp_par_a = NULL;
 double *rp_dsp_par_b = NULL;
 
+/* Online filter (channel A) & its statistics, the latter kept by the DSP
+ * thread and published to readers with a sequence counter which is odd
+ * while a copy is being written, so a reader never blocks the real-time
+ * loop */
+lti_sos_t              rp_dsp_sos;
+lti_sos_stats_t        rp_dsp_stats;
+lti_sos_stats_t        rp_dsp_stats_pub;
+unsigned int           rp_dsp_stats_seq = 0;
+
 
 /* DSP structures */
 /* size = c_dsp_sig_len */
@@ -70,6 +79,40 @@ float                **rp_lti_signals = NULL;
 
 int                    rp_lti_signals_dirty = 0;
 
+/* Starts the worker with SCHED_FIFO priority, pinned to the last CPU (the
+ * web server runs on the others). Without the privileges for real-time
+ * scheduling the worker falls back to a normal thread. */
+static int rp_lti_create_rt_thread(pthread_t *thread)
+{
+    pthread_attr_t     attr;
+    struct sched_param sched;
+    cpu_set_t          cpus;
+    long               cpu_num = sysconf(_SC_NPROCESSORS_ONLN);
+    int                ret_val;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    memset(&sched, 0, sizeof(sched));
+    sched.sched_priority = LTI_DSP_RT_PRIORITY;
+    pthread_attr_setschedparam(&attr, &sched);
+    if(cpu_num > 1) {
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu_num - 1, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpus);
+    }
+
+    ret_val = pthread_create(thread, &attr, rp_lti_worker_thread, NULL);
+    pthread_attr_destroy(&attr);
+    if(ret_val == EPERM || ret_val == EINVAL) {
+        fprintf(stderr, "Real-time LTI worker not permitted (%s), using "
+                "default scheduling\n", strerror(ret_val));
+        ret_val = pthread_create(thread, NULL, rp_lti_worker_thread, NULL);
+    }
+    errno = ret_val;
+    return ret_val;
+}
+
 int rp_lti_worker_init(void)
 {
     int ret_val;
@@ -95,10 +138,6 @@ int rp_lti_worker_init(void)
     rp_cha_in = (double *)malloc(sizeof(double) * LTI_FPGA_SIG_LEN);
     rp_chb_in = (double *)malloc(sizeof(double) * LTI_FPGA_SIG_LEN);
     
-    //DSP states
-    rp_dsp_state_a = (double *)malloc(sizeof(double) * LTI_DSP_STATES);
-    rp_dsp_state_b = (double *)malloc(sizeof(double) * LTI_DSP_STATES);
-
     //DSP parameters
     rp_dsp_par_a = (double *)malloc(sizeof(double) * LTI_DSP_PARAMS);
     rp_dsp_par_b = (double *)malloc(sizeof(double) * LTI_DSP_PARAMS);    
@@ -110,7 +149,7 @@ int rp_lti_worker_init(void)
     
     
     
-    if(!rp_cha_in || !rp_chb_in || !rp_dsp_state_a || !rp_dsp_state_b || !rp_dsp_par_a || !rp_dsp_par_b || !rp_cha_fft || !rp_chb_fft) {
+    if(!rp_cha_in || !rp_chb_in || !rp_dsp_par_a || !rp_dsp_par_b || !rp_cha_fft || !rp_chb_fft) {
         rp_lti_worker_clean();
         return -1;
     }
@@ -140,9 +179,7 @@ int rp_lti_worker_init(void)
         return -1;
     }
 
-    ret_val = 
-        pthread_create(rp_lti_thread_handler, NULL, 
-                       rp_lti_worker_thread, NULL);
+    ret_val = rp_lti_create_rt_thread(rp_lti_thread_handler);
     if(ret_val != 0) {
         lti_fpga_exit();
 
@@ -162,6 +199,7 @@ int rp_lti_worker_clean(void)
     rp_cleanup_signals(&rp_lti_signals);
     rp_cleanup_signals(&rp_tmp_signals);
     rp_lti_fft_clean();
+    kiss_fft_plan_cleanup();
 
 
     
@@ -173,14 +211,6 @@ int rp_lti_worker_clean(void)
         free(rp_chb_in);
         rp_chb_in = NULL;
     }
-    if(rp_dsp_state_a) {
-        free(rp_dsp_state_a);
-        rp_dsp_state_a = NULL;
-    }
-    if(rp_dsp_state_b) {
-        free(rp_dsp_state_b);
-        rp_dsp_state_b = NULL;
-    }
     if(rp_dsp_par_a) {
         free(rp_dsp_par_a);
         rp_dsp_par_a = NULL;
@@ -220,6 +250,27 @@ int rp_lti_worker_exit(void)
     return 0;
 }
 
+/* Publishes the DSP statistics, DSP thread only */
+static void rp_lti_publish_dsp_stats(void)
+{
+    __atomic_store_n(&rp_dsp_stats_seq, rp_dsp_stats_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&rp_dsp_stats_pub, &rp_dsp_stats, sizeof(lti_sos_stats_t));
+    __atomic_store_n(&rp_dsp_stats_seq, rp_dsp_stats_seq + 1, __ATOMIC_RELEASE);
+}
+
+int rp_lti_worker_get_dsp_stats(lti_sos_stats_t *stats)
+{
+    unsigned int seq;
+
+    do {
+        seq = __atomic_load_n(&rp_dsp_stats_seq, __ATOMIC_ACQUIRE);
+        memcpy(stats, &rp_dsp_stats_pub, sizeof(lti_sos_stats_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while((seq & 1) || seq != __atomic_load_n(&rp_dsp_stats_seq, __ATOMIC_RELAXED));
+    return 0;
+}
+
 int rp_lti_worker_change_state(rp_lti_worker_state_t new_state)
 {
     if(new_state >= rp_lti_nonexisting_state)
@@ -299,6 +350,7 @@ void *rp_lti_worker_thread(void *args)
     int                      armed=0;
     int                      gen_start_ptr,rp_dsp_loc_ptr;
     int                      indx;
+    double                   b[6], a[6];
     
     float                    curr_dec;
     
@@ -392,18 +444,7 @@ void *rp_lti_worker_thread(void *args)
 	lti_fpga_get_gen_ptr(&rp_fpga_cha_gen, &rp_fpga_chb_gen);
 	
 	
-	// Clear states
-	
-	for (indx=0; indx<128; indx++) {
-	
-	rp_dsp_state_a[indx]=0;
-	rp_dsp_state_b[indx]=0;	
-	
-	}
-	
-	
-	
-	  // Read LTI coeffs. (6th order IIR, DSP function (lti_fpga_online_dsp) supports up tu 64th order)
+	  // Read LTI coeffs. (5th order IIR, the SOS engine supports up to LTI_SOS_MAX_ORDER)
 	  //  			Possible upgrade: LTI parameters passeed through file upload
 	
 	rp_dsp_par_a[0]=curr_params[LTI_B0].value; 
@@ -419,6 +460,25 @@ void *rp_lti_worker_thread(void *args)
 	rp_dsp_par_a[67]=curr_params[LTI_A3].value; 
 	rp_dsp_par_a[68]=curr_params[LTI_A4].value; 
 	rp_dsp_par_a[69]=curr_params[LTI_A5].value; 	  
+
+	// Factor into second order sections (also clears the filter states)
+	b[0]=rp_dsp_par_a[0];
+	a[0]=1;
+	for (indx=1; indx<6; indx++) {
+	  b[indx]=rp_dsp_par_a[indx];
+	  a[indx]=rp_dsp_par_a[64+indx];
+	}
+	if(lti_sos_design(&rp_dsp_sos, b, 6, a, 6,
+	     curr_params[LTI_DSP_FIXED].value ? lti_sos_fixed : lti_sos_float) < 0) {
+	  fprintf(stderr, "lti_sos_design() failed, output disabled\n");
+	  b[0]=0;
+	  lti_sos_design(&rp_dsp_sos, b, 1, a, 1, lti_sos_float);
+	}
+	if(rp_dsp_sos.q_saturated)
+	  fprintf(stderr, "LTI coefficients out of fixed point range\n");
+
+	lti_sos_stats_reset(&rp_dsp_stats);
+	rp_lti_publish_dsp_stats();
 	
 	
 	rp_lti_prepare_freq_vector(&rp_tmp_signals[0], 
@@ -435,17 +495,16 @@ void *rp_lti_worker_thread(void *args)
 	
 	// CALL DSP ALGORITHM:
 	//  - retrieve input ADC samples buffered after last algorithm call (rp_dsp_loc_ptr)
-	//  - apply DSP according to previous DSP state and parameters (rp_dsp_state_a, rp_dsp_par_a)
+	//  - apply DSP according to previous DSP state and parameters (rp_dsp_sos)
 	//  - applies results as output DAC samples (rp_fpga_cha_gen) 
 	
 	// returns ADC input samples (rp_cha_in) 
 	     
-	   
-	rp_dsp_loc_ptr=lti_fpga_online_dsp(&rp_cha_in, &rp_chb_in, round(3000.0*1024.0/curr_dec), 
-					    &rp_dsp_state_a, &rp_dsp_state_b, 
-				            &rp_dsp_par_a, &rp_dsp_par_b, 
-				           rp_dsp_loc_ptr, 
-				           &rp_fpga_cha_gen, &rp_fpga_chb_gen);
+	rp_dsp_loc_ptr=lti_fpga_online_dsp(&rp_dsp_sos, &rp_dsp_stats,
+					    rp_cha_in, rp_chb_in,
+					    round(3000.0*1024.0/curr_dec),
+					    rp_dsp_loc_ptr, rp_fpga_cha_gen);
+	rp_lti_publish_dsp_stats();
 		
 	
 	// Experimentally a safe generator delay is 3000 locs at 122 kHz
@@ -466,7 +525,7 @@ void *rp_lti_worker_thread(void *args)
 	
 	
          rp_lti_set_signals(rp_tmp_signals);
-	 usleep(100);
+	 usleep(LTI_DSP_PERIOD_US);
 	
 	
 
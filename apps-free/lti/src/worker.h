@@ -17,6 +17,11 @@
 #define __WORKER_H
 
 #include "main.h"
+#include "lti_sos.h"
+
+/* Online DSP thread: SCHED_FIFO priority and sleep between DSP cycles */
+#define LTI_DSP_RT_PRIORITY  50
+#define LTI_DSP_PERIOD_US    100
 
 typedef enum rp_lti_worker_state_e {
     rp_lti_idle_state = 0, /* do nothing */
@@ -33,6 +38,8 @@ int rp_lti_worker_clean(void);
 int rp_lti_worker_exit(void);
 int rp_lti_worker_change_state(rp_lti_worker_state_t new_state);
 int rp_lti_worker_update_params(rp_app_params_t *params, int fpga_update);
+/* Online DSP latency & overrun statistics since the last arming */
+int rp_lti_worker_get_dsp_stats(lti_sos_stats_t *stats);
 
 /* removes 'dirty' flags */
 int rp_lti_clean_signals(void);
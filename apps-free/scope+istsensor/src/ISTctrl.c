@@ -15,10 +15,41 @@
  * for more details on the language used herein.
  */
  
+#include <sys/timerfd.h>
+#include <time.h>
+
+#include "regmap.h"
 #include "ISTctrl.h"
 
-void* map_base_ = (void*)(-1);
-const uint32_t c_addrAms = 0x40400000;
+/* XADC & slow DAC registers, mapped once by ISTctrl_Init() */
+static regmap_block_t ist_ams_blk;
+static amsReg_t      *ams = NULL;
+
+/* Control loop thread, paced by a periodic timerfd */
+static pthread_t ist_thread;
+static pthread_t ist_log_thread;
+static int       ist_running = 0;
+static int       ist_timer_fd = -1;
+
+/* Loop statistics, published with a sequence counter which is odd while
+ * the loop updates them */
+static ist_stats_t  ist_stats;
+static unsigned int ist_stats_seq = 0;
+
+/* Log ring: the loop writes at head and never blocks, the writer thread
+ * reads at tail and does the file I/O */
+typedef struct {
+	float ist;
+	float lm35;
+	float out;
+} ist_log_rec_t;
+
+static ist_log_rec_t   ist_log[IST_LOG_LEN];
+static unsigned int    ist_log_head = 0, ist_log_tail = 0;
+static uint64_t        ist_log_dropped = 0;
+static pthread_mutex_t ist_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define IST_LOG_WRITE_US 10000	//writer thread wakes up every 10ms
 
 float AmsConversion(ams_t a_ch, unsigned int a_raw)
 {
@@ -84,7 +115,30 @@ void DacWrite(amsReg_t * a_amsReg, double * a_val, ssize_t a_cnt)
 	}
 }
 
-void ISTctrl_Init(void)
+static int IST_map(uint32_t addr)
+{
+	if(REGMAP_GET(addr, amsReg_t, &ist_ams_blk) < 0)
+	{
+		return -1;
+	}
+	ams = (amsReg_t *)ist_ams_blk.regs;
+	return 0;
+}
+
+static void IST_unmap(void)
+{
+	regmap_put(&ist_ams_blk);
+	ams = NULL;
+}
+
+/**
+ * Maps the XADC & slow DAC registers and calibrates the IST sensor.
+ *
+ * The registers stay mapped until Stop_ISTctrl(). addr is IST_AMS_ADDR on
+ * Red Pitaya, the device (or a register simulator file) is the one of the
+ * register map service, see regmap.h.
+ */
+int ISTctrl_Init(uint32_t addr)
 {
 	fileopen = 0;
 	HeatStp = 1;
@@ -98,7 +152,16 @@ void ISTctrl_Init(void)
 	ISTlm35 = 0;
 	ISTfreq = 0;
 	ISTper = 0;
+	memset(&ist_stats, 0, sizeof(ist_stats));
+	ist_log_head = ist_log_tail = 0;
+	ist_log_dropped = 0;
+
+	if(IST_map(addr) < 0)
+	{
+		return -1;
+	}
 	IST_tempCalib();
+	return 0;
 }
 
 
@@ -106,16 +169,9 @@ void IST_tempCalib(void)
 {
 	//read ADC 0 ans 1 to make differential mesure
 	int i;
-	double val[2];
+	double val[2] = { 0, 0 };
 	unsigned int raw;
-			
-	uint32_t addr = c_addrAms;
-	amsReg_t* ams=NULL;
-	// Map one page
-	map_base_ = mmap(0, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, addr & ~MAP_MASK);	    
-	if(map_base_ == (void *) -1) FATAL;	
-	
-	ams = map_base_ + (addr & MAP_MASK);
+
 	for(i=0;i<2000;i++)
 	{
 		raw = ams->aif[0];
@@ -130,7 +186,6 @@ void IST_tempCalib(void)
 	{
 		ISTsnsAdj = 0;
 	}
-	munmap(0, MAP_SIZE);
 }
 
 void swap(double* a, double* b)
@@ -157,6 +212,24 @@ double getMin(double a, double b, double c)
 	return a;
 }
 
+/* Queues a sample for the log file, dropped if the writer fell behind */
+static void IST_log_push(float ist, float lm35, float out)
+{
+	unsigned int head = ist_log_head;
+	ist_log_rec_t *rec;
+
+	if(head - __atomic_load_n(&ist_log_tail, __ATOMIC_ACQUIRE) >= IST_LOG_LEN)
+	{
+		ist_log_dropped++;
+		return;
+	}
+	rec = &ist_log[head & (IST_LOG_LEN - 1)];
+	rec->ist = ist;
+	rec->lm35 = lm35;
+	rec->out = out;
+	__atomic_store_n(&ist_log_head, head + 1, __ATOMIC_RELEASE);
+}
+
 float ISTctrl()
 {
 	//read ADC 0 ans 1 to make differential mesure
@@ -164,14 +237,8 @@ float ISTctrl()
 	double val[4];
 	static double bufVal_0[3],bufVal_1[3];
 	unsigned int raw;
-	float CtrlMaxTemp = DeltaTemp,toDAC;
-			
-	uint32_t addr = c_addrAms;
-	amsReg_t* ams=NULL;
-	// Map one page
-	map_base_ = mmap(0, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, addr & ~MAP_MASK);	    
-	if(map_base_ == (void *) -1) FATAL;	
-	ams = map_base_ + (addr & MAP_MASK);
+	float CtrlMaxTemp = DeltaTemp,toDAC = 0;
+
 	raw = ams->aif[0];
 	val[0]=AmsConversion(1, raw)*1000*ISTsnsAdj; //0.01749 is the conv. value from Volt to °C for the PT1000
 	raw = ams->aif[1];
@@ -208,9 +275,9 @@ float ISTctrl()
 		{
 			filecnt=0;
 			ISTlm35 = (float)(val[1]);
-			if(IST2file==1 && fileopen==1)// write to the file 
+			if(IST2file==1 && fileopen==1)// queue for the log file writer
 			{
-				fprintf(file_ptr, "%f,%f,%f\n", val[0],val[1],toDAC); //IST temp, LM35 temp, Out ctrl
+				IST_log_push(val[0],val[1],toDAC); //IST temp, LM35 temp, Out ctrl
 			}
 		}
 		
@@ -220,20 +287,28 @@ float ISTctrl()
 		val[3] = 0;//AmsConversion(eAmsAO0+3, ams->dac[3]);
 
 		DacWrite(ams, &val[0], 4);
-		
-		if (map_base_ != (void*)(-1)) {
-			if(munmap(map_base_, MAP_SIZE) == -1) FATAL;
-			map_base_ = (void*)(-1);
-		}
-		munmap(0, MAP_SIZE);
 	}	
 	return (float)toDAC;
 }
 
+/* Turns the heater off */
+static void IST_heat_off(void)
+{
+	double val[4] = { 0, 0, 0, 0 };
+
+	if(ams != NULL)
+	{
+		DacWrite(ams, val, 4);
+	}
+}
+
 void Stop_ISTctrl(rp_app_params_t *params)
 {	
+	ISTctrl_stop();
 	if(fileopen==1){ IST_Closefile(); }
 	StopHeat();
+	IST_heat_off();
+	IST_unmap();
 	params[PID_IST_ENABLE].value = IST_EN;	
 }
 
@@ -243,76 +318,268 @@ void StopHeat()
 	{ 
 		ISTcnt = 0;
 		HeatStp = 1;
-		double* val;
-		amsReg_t* ams=NULL;
-		val = calloc(4*1024, sizeof(double));
-					
-		map_base_ = mmap(0, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, c_addrAms & ~MAP_MASK);
+		IST_heat_off();
+	}
+}
+
+/* One control period: PID step & IST power signal for the scope */
+static void IST_step(int64_t now_ns)
+{
+	static float ISTminTmp = 3.3, ISTmaxTmp = 0;
+	static int j = 0;
+	static int64_t win_start_ns = 0;
+	float dataTemp;
+	int dupSample;
+
+	if(IST_EN!=1)
+	{
+		StopHeat();
+		return;
+	}
+	HeatStp = 0;
+	dataTemp = ISTctrl();
+	dupSample = (int)((TimeWin/(Dt*1000000))/1024);
+
+	if(j<dupSample)
+	{
+		j++;
+		return;
+	}
+	j=0;
+	IST_PWR_out[ISTcnt] = dataTemp;
+	if(ISTcnt == 0)
+	{
+		win_start_ns = now_ns;
+	}
+	if(ISTcnt<(SIGNAL_LENGTH-1)) 
+	{ 
+		ISTcnt++; 
 		
-		ams = map_base_ + (c_addrAms & MAP_MASK);
-		val[0] = 0;
-		val[1] = 0;
-		val[2] = 0;
-		val[3] = 0;
+		if(IST_PWR_out[ISTcnt] < ISTminTmp) { ISTminTmp = IST_PWR_out[ISTcnt]; }
+		if(IST_PWR_out[ISTcnt] > ISTmaxTmp) { ISTmaxTmp = IST_PWR_out[ISTcnt]; }
+	}
+	else 
+	{ 						
+		ISTmin = ISTminTmp;
+		ISTmax = ISTmaxTmp;
+		ISTminTmp = 3.3;
+		ISTmaxTmp = 0;
+		ISTadj = ISTsnsAdj;
+		/* achieved loop period over the window */
+		if(now_ns > win_start_ns)
+		{
+			ISTper = (now_ns - win_start_ns) * 1e-9 / ((SIGNAL_LENGTH-1) * (dupSample+1));
+			ISTfreq = 1 / ISTper;
+		}
+		ISTcnt = 0; 					
+	}
+}
 
-		DacWrite(ams, val, 4);
+static void IST_stats_update(int64_t jit_ns, uint64_t missed)
+{
+	int bin = jit_ns < 0 ? 0 : jit_ns / 1000;
+
+	if(bin >= IST_JIT_BINS)
+	{
+		bin = IST_JIT_BINS - 1;
 	}
+	__atomic_store_n(&ist_stats_seq, ist_stats_seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	if(ist_stats.iterations == 0 || jit_ns < ist_stats.jit_min_ns) { ist_stats.jit_min_ns = jit_ns; }
+	if(ist_stats.iterations == 0 || jit_ns > ist_stats.jit_max_ns) { ist_stats.jit_max_ns = jit_ns; }
+	ist_stats.iterations++;
+	ist_stats.overruns += missed;
+	ist_stats.log_dropped = ist_log_dropped;
+	ist_stats.jit_sum_ns += jit_ns;
+	ist_stats.jit_sum2_ns += (double)jit_ns * jit_ns;
+	ist_stats.jit_hist[bin]++;
+
+	__atomic_store_n(&ist_stats_seq, ist_stats_seq + 1, __ATOMIC_RELEASE);
 }
 
-void ISTctrl_time(int delay)
+static int64_t IST_ns(const struct timespec *ts)
 {
-	if(IST_EN==1) 
-	{ 		
-		
-		float ISTminTmp = 3.3,ISTmaxTmp;
-		float dataTemp;
-		HeatStp = 0;
-		float ISTctrl_delay = Dt*1000000;	//us
-		int iterations = (int)(delay/ISTctrl_delay);
-		int dupSample =(int)((TimeWin/ISTctrl_delay)/1024);
-		int i;
-		static int j = 0;
-				
-		for(i=0;i<iterations;i++)
-		{		
-				dataTemp = ISTctrl();
-				
-				if(j<dupSample)
-				{
-					j++;
-				}
-				else
-				{		
-					j=0;		
-					IST_PWR_out[ISTcnt] = dataTemp;
-					if(ISTcnt<(SIGNAL_LENGTH-1)) 
-					{ 
-						ISTcnt++; 
-						
-						if(IST_PWR_out[ISTcnt] < ISTminTmp) { ISTminTmp = IST_PWR_out[ISTcnt]; }
-						if(IST_PWR_out[ISTcnt] > ISTmaxTmp) { ISTmaxTmp = IST_PWR_out[ISTcnt]; }
-					}
-					else 
-					{ 						
-						ISTmin = ISTminTmp;
-						ISTminTmp = ISTmaxTmp;
-						ISTmax = ISTmaxTmp;
-						ISTadj = ISTsnsAdj;
-						ISTfreq = 10000;
-						ISTper = 0.0001;
-												
-						ISTcnt = 0; 					
-					}
-				}
-				usleep(10);
-				
-		}	
-	}	//enable IST realprobe Controller abt 190uS
-	else
+	return (int64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+static struct timespec IST_ts(int64_t ns)
+{
+	struct timespec ts = { ns / 1000000000, ns % 1000000000 };
+	return ts;
+}
+
+/* Control loop: runs one step every Dt on the expiry of an absolute
+ * periodic timer, the jitter is measured against the timer deadline */
+static void *IST_loop(void *arg)
+{
+	int64_t period_ns = round(Dt * 1e9);
+	int64_t deadline_ns, now_ns;
+	struct itimerspec its;
+	struct timespec now;
+	uint64_t expired;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	deadline_ns = IST_ns(&now) + period_ns;
+	its.it_value = IST_ts(deadline_ns);
+	its.it_interval = IST_ts(period_ns);
+	if(timerfd_settime(ist_timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0)
 	{
-		StopHeat();
-		usleep(190);
+		fprintf(stderr, "IST_loop: timerfd_settime() failed: %s\n", strerror(errno));
+		return NULL;
+	}
+
+	while(__atomic_load_n(&ist_running, __ATOMIC_ACQUIRE))
+	{
+		if(read(ist_timer_fd, &expired, sizeof(expired)) != sizeof(expired))
+		{
+			if(errno == EINTR) { continue; }
+			fprintf(stderr, "IST_loop: timerfd read failed: %s\n", strerror(errno));
+			break;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		now_ns = IST_ns(&now);
+		/* woken by the last of the expired periods */
+		deadline_ns += (expired - 1) * period_ns;
+
+		IST_step(now_ns);
+		IST_stats_update(now_ns - deadline_ns, expired - 1);
+		deadline_ns += period_ns;
+	}
+	return NULL;
+}
+
+/* Writes the queued samples to the log file */
+static void IST_log_drain(void)
+{
+	unsigned int tail = ist_log_tail;
+	unsigned int head = __atomic_load_n(&ist_log_head, __ATOMIC_ACQUIRE);
+
+	pthread_mutex_lock(&ist_file_mutex);
+	for(; tail != head; tail++)
+	{
+		ist_log_rec_t *rec = &ist_log[tail & (IST_LOG_LEN - 1)];
+		if(fileopen==1)
+		{
+			fprintf(file_ptr, "%f,%f,%f\n", rec->ist, rec->lm35, rec->out); //IST temp, LM35 temp, Out ctrl
+		}
+	}
+	pthread_mutex_unlock(&ist_file_mutex);
+	__atomic_store_n(&ist_log_tail, tail, __ATOMIC_RELEASE);
+}
+
+static void *IST_log_writer(void *arg)
+{
+	int run = 1;
+
+	while(run)
+	{
+		run = __atomic_load_n(&ist_running, __ATOMIC_ACQUIRE);
+		IST_log_drain();
+		if(run) { usleep(IST_LOG_WRITE_US); }
+	}
+	return NULL;
+}
+
+/* Starts the control loop with SCHED_FIFO priority rt_prio, with default
+ * scheduling if rt_prio is 0 or real-time scheduling is not permitted */
+static int IST_create_thread(pthread_t *thread, int rt_prio)
+{
+	pthread_attr_t     attr;
+	struct sched_param sched;
+	int                ret_val;
+
+	if(rt_prio > 0)
+	{
+		pthread_attr_init(&attr);
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		memset(&sched, 0, sizeof(sched));
+		sched.sched_priority = rt_prio;
+		pthread_attr_setschedparam(&attr, &sched);
+		ret_val = pthread_create(thread, &attr, IST_loop, NULL);
+		pthread_attr_destroy(&attr);
+		if(ret_val != EPERM && ret_val != EINVAL)
+		{
+			return ret_val;
+		}
+		fprintf(stderr, "Real-time IST control loop not permitted (%s), using "
+		        "default scheduling\n", strerror(ret_val));
+	}
+	return pthread_create(thread, NULL, IST_loop, NULL);
+}
+
+/**
+ * Starts the control loop and the log file writer.
+ *
+ * The loop runs every Dt seconds until ISTctrl_stop(), whether the IST
+ * controller is enabled or not.
+ *
+ * @param rt_prio  SCHED_FIFO priority of the loop, 0 for default scheduling.
+ * @return         0 on success, -1 on failure.
+ */
+int ISTctrl_start(int rt_prio)
+{
+	int ret_val;
+
+	if(ist_running || ams == NULL)
+	{
+		return ist_running ? 0 : -1;
 	}
+	ist_timer_fd = timerfd_create(CLOCK_MONOTONIC, 0);
+	if(ist_timer_fd < 0)
+	{
+		fprintf(stderr, "ISTctrl_start: timerfd_create() failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	__atomic_store_n(&ist_running, 1, __ATOMIC_RELEASE);
+	ret_val = IST_create_thread(&ist_thread, rt_prio);
+	if(ret_val != 0)
+	{
+		fprintf(stderr, "ISTctrl_start: pthread_create() failed: %s\n", strerror(ret_val));
+		__atomic_store_n(&ist_running, 0, __ATOMIC_RELEASE);
+		close(ist_timer_fd);
+		ist_timer_fd = -1;
+		return -1;
+	}
+	ret_val = pthread_create(&ist_log_thread, NULL, IST_log_writer, NULL);
+	if(ret_val != 0)
+	{
+		fprintf(stderr, "ISTctrl_start: pthread_create() failed: %s\n", strerror(ret_val));
+		__atomic_store_n(&ist_running, 0, __ATOMIC_RELEASE);
+		pthread_join(ist_thread, NULL);
+		close(ist_timer_fd);
+		ist_timer_fd = -1;
+		return -1;
+	}
+	return 0;
+}
+
+/** Stops the control loop, the queued log samples are written out. */
+void ISTctrl_stop(void)
+{
+	if(!ist_running)
+	{
+		return;
+	}
+	__atomic_store_n(&ist_running, 0, __ATOMIC_RELEASE);
+	pthread_join(ist_thread, NULL);
+	pthread_join(ist_log_thread, NULL);
+	close(ist_timer_fd);
+	ist_timer_fd = -1;
+}
+
+/** Copies a consistent snapshot of the control loop statistics. */
+void ISTctrl_get_stats(ist_stats_t *stats)
+{
+	unsigned int seq;
+
+	do {
+		seq = __atomic_load_n(&ist_stats_seq, __ATOMIC_ACQUIRE);
+		memcpy(stats, &ist_stats, sizeof(*stats));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while((seq & 1) || seq != __atomic_load_n(&ist_stats_seq, __ATOMIC_RELAXED));
 }
 
 void IST_Initfile(void)
@@ -329,7 +596,8 @@ void IST_Initfile(void)
 			sprintf (filename, "/tmp/ISTctrl_%d.dat", nameCnt);
 		}
 		
-		/* open the file */
+		/* open the file, the log writer thread must not see it half set up */
+		pthread_mutex_lock(&ist_file_mutex);
 		file_ptr = fopen(filename, "w");
 		if (file_ptr == NULL) 
 		{
@@ -342,6 +610,7 @@ void IST_Initfile(void)
 		fprintf(file_ptr, "The IST PT100 V/°C conversion value is %f. The following data are:",ISTsnsAdj);
 		fprintf(file_ptr, "\nIST realprobe temp (°C), LM35 temp (°C), IST power control (Volt)\n\n");
 		fileopen = 1;			
+		pthread_mutex_unlock(&ist_file_mutex);
 	}
 }
 
@@ -349,8 +618,10 @@ void IST_Closefile(void)
 {
 	if(fileopen==1)
 	{
+		pthread_mutex_lock(&ist_file_mutex);
 		fileopen = 0;
 		/* close the file */
 		fclose(file_ptr); 
+		pthread_mutex_unlock(&ist_file_mutex);
 	}	
 }
@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "pid.h"
 
@@ -45,12 +46,20 @@
 #define SLOW_DAC_RANGE_CNT 0x9c
 #define ADC_POS_RANGE_CNT  0x7ff
 
+/* XADC & slow DAC registers, mapped once for the life of the application */
+#define IST_AMS_ADDR       0x40400000
+/* Control loop thread: SCHED_FIFO priority (0 - default scheduling) */
+#define IST_RT_PRIORITY    50
+/* Samples buffered for the log file writer thread, must be 2^n */
+#define IST_LOG_LEN        4096
+/* Jitter histogram: 1 us bins, the last one collects everything later */
+#define IST_JIT_BINS       128
+
 int parse_from_argv_par(int a_argc, char **a_argv, double** a_values, ssize_t* a_len);
 int parse_from_argv(int a_argc, char **a_argv, unsigned long* a_addr, int* a_type, unsigned long** a_values, ssize_t* a_len);
 int parse_from_stdin(unsigned long* a_addr, int* a_type, unsigned long** a_values, ssize_t* a_len);
 uint32_t read_value(uint32_t a_addr);
 void write_values(unsigned long a_addr, int a_type, unsigned long* a_values, ssize_t a_len);
-int fd;
 
 typedef struct {
 	uint32_t aif[5];
@@ -85,6 +94,19 @@ typedef enum {
 	eSendNum
 } ams_t;
 
+/* Control loop statistics. Jitter is the wake-up delay after the timer
+ * deadline, overruns count the periods the loop missed completely. */
+typedef struct {
+	uint64_t iterations;
+	uint64_t overruns;
+	uint64_t log_dropped;	//samples lost because the log ring was full
+	int64_t  jit_min_ns;
+	int64_t  jit_max_ns;
+	double   jit_sum_ns;
+	double   jit_sum2_ns;	//sum of squares, for the RMS
+	uint32_t jit_hist[IST_JIT_BINS];
+} ist_stats_t;
+
 float IST_PWR_out[SIGNAL_LENGTH];
 int HeatStp,ISTcnt;
 float TimeWin;	//in us
@@ -96,11 +118,13 @@ float ISTmin,ISTmax,ISTadj,ISTfreq,ISTper,ISTlm35;
 float AmsConversion(ams_t , unsigned int );
 void DacWrite(amsReg_t * , double * , ssize_t );
 float ISTctrl(void);
-void ISTctrl_time(int);
 double PID(double delta);
 void StopHeat();
 void Stop_ISTctrl(rp_app_params_t *);
-void ISTctrl_Init(void);
+int ISTctrl_Init(uint32_t addr);
+int ISTctrl_start(int rt_prio);
+void ISTctrl_stop(void);
+void ISTctrl_get_stats(ist_stats_t *stats);
 void IST_Initfile(void);
 void IST_Closefile(void);
 void IST_tempCalib(void);
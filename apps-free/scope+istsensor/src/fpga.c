@@ -17,12 +17,11 @@
 #include <string.h>
 #include <math.h>
 #include <errno.h>
-#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#include <fcntl.h>
 
+#include "regmap.h"
 #include "fpga.h"
 
 
@@ -35,8 +34,8 @@ static uint32_t           *g_osc_fpga_cha_mem = NULL;
 /* @brief Pointer to data buffer where signal on channel B is captured.  */
 static uint32_t           *g_osc_fpga_chb_mem = NULL;
 
-/* @brief The memory file descriptor used to mmap() the FPGA space. */
-static int                 g_osc_fpga_mem_fd = -1;
+/** The mapped FPGA block */
+static regmap_block_t g_osc_fpga_blk;
 
 /* @brief Number of ADC acquisition bits.  */
 const int                  c_osc_fpga_adc_bits = 14;
@@ -53,8 +52,7 @@ const float                c_osc_fpga_smpl_period = (1. / 125e6);
  * @brief Cleanup access to FPGA memory buffers
  *
  * Function optionally cleanups access to FPGA memory buffers, i.e. if access
- * has already been established it unmaps logical memory regions and close apparent
- * file descriptor.
+ * has already been established it releases the mapped memory regions.
  *
  * @retval  0 Success
  * @retval -1 Failure, error message is printed on standard error device
@@ -63,22 +61,13 @@ static int __osc_fpga_cleanup_mem(void)
 {
     /* optionally unmap memory regions  */
     if (g_osc_fpga_reg_mem) {
-        if (munmap(g_osc_fpga_reg_mem, OSC_FPGA_BASE_SIZE) < 0) {
-            fprintf(stderr, "munmap() failed: %s\n", strerror(errno));
-            return -1;
-        }
+        regmap_put(&g_osc_fpga_blk);
         /* ...and update memory pointers */
         g_osc_fpga_reg_mem = NULL;
         g_osc_fpga_cha_mem = NULL;
         g_osc_fpga_chb_mem = NULL;
     }
 
-    /* optionally close file descriptor */
-    if(g_osc_fpga_mem_fd >= 0) {
-        close(g_osc_fpga_mem_fd);
-        g_osc_fpga_mem_fd = -1;
-    }
-
     return 0;
 }
 
@@ -88,9 +77,8 @@ static int __osc_fpga_cleanup_mem(void)
  * @brief Initialize interface to Oscilloscope FPGA module
  *
  * Function first optionally cleanups previously established access to Oscilloscope
- * FPGA module. Afterwards a new connection to the Memory handler is instantiated
- * by opening file descriptor over /dev/mem device. Access to Oscilloscope FPGA module
- * is further provided by mapping memory regions through resulting file descriptor.
+ * FPGA module. Afterwards access to Oscilloscope FPGA module is provided by
+ * mapping its memory regions through the shared register map service.
  *
  * @retval  0 Success
  * @retval -1 Failure, error message is printed on standard error device
@@ -98,30 +86,15 @@ static int __osc_fpga_cleanup_mem(void)
  */
 int osc_fpga_init(void)
 {
-    void *page_ptr;
-    long page_addr, page_off, page_size = sysconf(_SC_PAGESIZE);
-
-    /* If maybe needed, cleanup the FD & memory pointer */
+    /* If maybe needed, cleanup the memory pointer */
     if(__osc_fpga_cleanup_mem() < 0)
         return -1;
 
-    g_osc_fpga_mem_fd = open("/dev/mem", O_RDWR | O_SYNC);
-    if(g_osc_fpga_mem_fd < 0) {
-        fprintf(stderr, "open(/dev/mem) failed: %s\n", strerror(errno));
-        return -1;
-    }
-
-    page_addr = OSC_FPGA_BASE_ADDR & (~(page_size-1));
-    page_off  = OSC_FPGA_BASE_ADDR - page_addr;
-
-    page_ptr = mmap(NULL, OSC_FPGA_BASE_SIZE, PROT_READ | PROT_WRITE,
-                          MAP_SHARED, g_osc_fpga_mem_fd, page_addr);
-    if((void *)page_ptr == MAP_FAILED) {
-        fprintf(stderr, "mmap() failed: %s\n", strerror(errno));
+    if(regmap_get(OSC_FPGA_BASE_ADDR, OSC_FPGA_BASE_SIZE, &g_osc_fpga_blk) < 0) {
         __osc_fpga_cleanup_mem();
         return -1;
     }
-    g_osc_fpga_reg_mem = page_ptr + page_off;
+    g_osc_fpga_reg_mem = (void *)g_osc_fpga_blk.regs;
     g_osc_fpga_cha_mem = (uint32_t *)g_osc_fpga_reg_mem + 
         (OSC_FPGA_CHA_OFFSET / sizeof(uint32_t));
     g_osc_fpga_chb_mem = (uint32_t *)g_osc_fpga_reg_mem + 
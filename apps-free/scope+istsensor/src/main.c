@@ -287,8 +287,13 @@ int rp_app_init(void)
 
 
     pid_init();
-    ISTctrl_Init();
+    if(ISTctrl_Init(IST_AMS_ADDR) < 0) {
+        return -1;
+    }
     pid_constUpdate(&rp_main_params[0]);	//update PID parameters
+    if(ISTctrl_start(IST_RT_PRIORITY) < 0) {
+        return -1;
+    }
 
     return 0;
 }
@@ -345,8 +345,7 @@ void *rp_osc_worker_thread(void *args)
         }
 
         if(state == rp_osc_idle_state) {
-            //usleep(10000);
-            ISTctrl_time(10000);
+            usleep(10000);
             continue;
         }
 
@@ -397,12 +396,10 @@ void *rp_osc_worker_thread(void *args)
                 /* time delay is always in seconds - convert to [us] and
                 * sleep 
                 */
-                //usleep(round(-1 * time_delay * 1e6));
-                ISTctrl_time(round(-1 * time_delay * 1e6));
+                usleep(round(-1 * time_delay * 1e6));
             } else {
                 if(curr_params[TIME_RANGE_PARAM].value > 4)
-                    //usleep(5000);
-                    ISTctrl_time(5000);
+                    usleep(5000);
                 else
                     usleep(1);
             }
@@ -447,8 +444,7 @@ void *rp_osc_worker_thread(void *args)
                     }
                 }
                 
-                ISTctrl_time(1000);
-                //usleep(1000);
+                usleep(1000);
             }
         }
 
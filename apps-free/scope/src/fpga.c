@@ -17,13 +17,13 @@
 #include <string.h>
 #include <math.h>
 #include <errno.h>
-#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#include <fcntl.h>
 
+#include "regmap.h"
 #include "fpga.h"
+#include "fpga_shadow.h"
 
 
 /* @brief Pointer to FPGA control registers. */
@@ -35,8 +35,16 @@ static uint32_t           *g_osc_fpga_cha_mem = NULL;
 /* @brief Pointer to data buffer where signal on channel B is captured.  */
 static uint32_t           *g_osc_fpga_chb_mem = NULL;
 
-/* @brief The memory file descriptor used to mmap() the FPGA space. */
-static int                 g_osc_fpga_mem_fd = -1;
+/* @brief Shadow register index of a field of osc_fpga_reg_mem_t. */
+#define OSC_SHADOW_IDX(field) FPGA_SHADOW_IDX(osc_fpga_reg_mem_t, field)
+#define OSC_SHADOW_SET(field, value) \
+    fpga_shadow_set(&g_osc_shadow, OSC_SHADOW_IDX(field), (value))
+
+/* @brief Shadow of the configuration registers up to the equalization filters. */
+static fpga_shadow_t       g_osc_shadow;
+
+/** The mapped FPGA block */
+static regmap_block_t g_osc_fpga_blk;
 
 /* @brief Number of ADC acquisition bits.  */
 const int                  c_osc_fpga_adc_bits = 14;
@@ -53,8 +61,7 @@ const float                c_osc_fpga_smpl_period = (1. / 125e6);
  * @brief Cleanup access to FPGA memory buffers
  *
  * Function optionally cleanups access to FPGA memory buffers, i.e. if access
- * has already been established it unmaps logical memory regions and close apparent
- * file descriptor.
+ * has already been established it releases the mapped memory regions.
  *
  * @retval  0 Success
  * @retval -1 Failure, error message is printed on standard error device
@@ -63,22 +70,13 @@ static int __osc_fpga_cleanup_mem(void)
 {
     /* optionally unmap memory regions  */
     if (g_osc_fpga_reg_mem) {
-        if (munmap(g_osc_fpga_reg_mem, OSC_FPGA_BASE_SIZE) < 0) {
-            fprintf(stderr, "munmap() failed: %s\n", strerror(errno));
-            return -1;
-        }
+        regmap_put(&g_osc_fpga_blk);
         /* ...and update memory pointers */
         g_osc_fpga_reg_mem = NULL;
         g_osc_fpga_cha_mem = NULL;
         g_osc_fpga_chb_mem = NULL;
     }
 
-    /* optionally close file descriptor */
-    if(g_osc_fpga_mem_fd >= 0) {
-        close(g_osc_fpga_mem_fd);
-        g_osc_fpga_mem_fd = -1;
-    }
-
     return 0;
 }
 
@@ -88,9 +86,8 @@ static int __osc_fpga_cleanup_mem(void)
  * @brief Initialize interface to Oscilloscope FPGA module
  *
  * Function first optionally cleanups previously established access to Oscilloscope
- * FPGA module. Afterwards a new connection to the Memory handler is instantiated
- * by opening file descriptor over /dev/mem device. Access to Oscilloscope FPGA module
- * is further provided by mapping memory regions through resulting file descriptor.
+ * FPGA module. Afterwards access to Oscilloscope FPGA module is provided by
+ * mapping its memory regions through the shared register map service.
  *
  * @retval  0 Success
  * @retval -1 Failure, error message is printed on standard error device
@@ -98,35 +95,33 @@ static int __osc_fpga_cleanup_mem(void)
  */
 int osc_fpga_init(void)
 {
-    void *page_ptr;
-    long page_addr, page_off, page_size = sysconf(_SC_PAGESIZE);
-
-    /* If maybe needed, cleanup the FD & memory pointer */
+    /* If maybe needed, cleanup the memory pointer */
     if(__osc_fpga_cleanup_mem() < 0)
         return -1;
 
-    g_osc_fpga_mem_fd = open("/dev/mem", O_RDWR | O_SYNC);
-    if(g_osc_fpga_mem_fd < 0) {
-        fprintf(stderr, "open(/dev/mem) failed: %s\n", strerror(errno));
-        return -1;
-    }
-
-    page_addr = OSC_FPGA_BASE_ADDR & (~(page_size-1));
-    page_off  = OSC_FPGA_BASE_ADDR - page_addr;
-
-    page_ptr = mmap(NULL, OSC_FPGA_BASE_SIZE, PROT_READ | PROT_WRITE,
-                          MAP_SHARED, g_osc_fpga_mem_fd, page_addr);
-    if((void *)page_ptr == MAP_FAILED) {
-        fprintf(stderr, "mmap() failed: %s\n", strerror(errno));
+    if(regmap_get(OSC_FPGA_BASE_ADDR, OSC_FPGA_BASE_SIZE, &g_osc_fpga_blk) < 0) {
         __osc_fpga_cleanup_mem();
         return -1;
     }
-    g_osc_fpga_reg_mem = page_ptr + page_off;
+    g_osc_fpga_reg_mem = (void *)g_osc_fpga_blk.regs;
     g_osc_fpga_cha_mem = (uint32_t *)g_osc_fpga_reg_mem + 
         (OSC_FPGA_CHA_OFFSET / sizeof(uint32_t));
     g_osc_fpga_chb_mem = (uint32_t *)g_osc_fpga_reg_mem + 
         (OSC_FPGA_CHB_OFFSET / sizeof(uint32_t));
 
+    /* Thresholds and hysteresis act on the running acquisition, decimation,
+     * delay, averaging and the filters change the data already captured */
+    fpga_shadow_init(&g_osc_shadow, g_osc_fpga_reg_mem,
+                     OSC_SHADOW_IDX(chb_filt_pp) + 1);
+    fpga_shadow_set_class(&g_osc_shadow, OSC_SHADOW_IDX(cha_thr),
+                          FPGA_SHADOW_LIVE);
+    fpga_shadow_set_class(&g_osc_shadow, OSC_SHADOW_IDX(chb_thr),
+                          FPGA_SHADOW_LIVE);
+    fpga_shadow_set_class(&g_osc_shadow, OSC_SHADOW_IDX(cha_hystersis),
+                          FPGA_SHADOW_LIVE);
+    fpga_shadow_set_class(&g_osc_shadow, OSC_SHADOW_IDX(chb_hystersis),
+                          FPGA_SHADOW_LIVE);
+
     return 0;
 }
 
@@ -143,6 +138,7 @@ int osc_fpga_init(void)
 int osc_fpga_exit(void)
 {
     __osc_fpga_cleanup_mem();
+    memset(&g_osc_shadow, 0, sizeof(g_osc_shadow));
 
     return 0;
 }
@@ -169,7 +165,13 @@ int osc_fpga_exit(void)
  * @param[in] ch2_probe_att      Channel B Attenuation
  * @param[in] enable_avg_at_dec  Apply average calculation during decimation
  *
- * @retval  0 Success
+ * Registers are set through the shadow register file and only the changed
+ * ones are written. If any of them invalidates the captured data, the write
+ * state machine is reset first.
+ *
+ * @retval  0 Success, the running acquisition is not affected
+ * @retval >0 Success, OSC_FPGA_UPD_REARM is set if the acquisition must be
+ *            re-armed
  * @retval -1 Failure, error message is output on standard error device
  */
 
@@ -189,6 +191,7 @@ int osc_fpga_update_params(int trig_imm, int trig_source, int trig_edge,
     int fpga_delay;
     float after_trigger; /* how much after trigger FPGA should write */
     int fpga_trig_thr;
+    int upd;
     
     uint32_t gain_hi_cha_filt_aa=0x7D93;
     uint32_t gain_hi_cha_filt_bb=0x437C7;
@@ -240,56 +243,60 @@ int osc_fpga_update_params(int trig_imm, int trig_source, int trig_edge,
     /* Trig source is written after ARM */
     /*    g_osc_fpga_reg_mem->trig_source   = fpga_trig_source;*/
     if(trig_source == 0) 
-        g_osc_fpga_reg_mem->cha_thr   = fpga_trig_thr;
+        OSC_SHADOW_SET(cha_thr, fpga_trig_thr);
     else
-        g_osc_fpga_reg_mem->chb_thr   = fpga_trig_thr;
-    g_osc_fpga_reg_mem->data_dec      = fpga_dec_factor;
-    g_osc_fpga_reg_mem->trigger_delay = (uint32_t)fpga_delay;
+        OSC_SHADOW_SET(chb_thr, fpga_trig_thr);
+    OSC_SHADOW_SET(data_dec,      fpga_dec_factor);
+    OSC_SHADOW_SET(trigger_delay, (uint32_t)fpga_delay);
 
-    g_osc_fpga_reg_mem->other = enable_avg_at_dec;
+    OSC_SHADOW_SET(other, enable_avg_at_dec);
     
     
     // Updating hysteresys registers
     
     
-    g_osc_fpga_reg_mem->cha_hystersis=OSC_HYSTERESIS;
-    g_osc_fpga_reg_mem->chb_hystersis=OSC_HYSTERESIS;
+    OSC_SHADOW_SET(cha_hystersis, OSC_HYSTERESIS);
+    OSC_SHADOW_SET(chb_hystersis, OSC_HYSTERESIS);
     
     
     // Updating equalization filter with default coefficients
     if (ch1_gain==0)
     {
-     g_osc_fpga_reg_mem->cha_filt_aa =gain_hi_cha_filt_aa;
-     g_osc_fpga_reg_mem->cha_filt_bb =gain_hi_cha_filt_bb;
-     g_osc_fpga_reg_mem->cha_filt_pp =gain_hi_cha_filt_pp;
-     g_osc_fpga_reg_mem->cha_filt_kk =gain_hi_cha_filt_kk;
+     OSC_SHADOW_SET(cha_filt_aa, gain_hi_cha_filt_aa);
+     OSC_SHADOW_SET(cha_filt_bb, gain_hi_cha_filt_bb);
+     OSC_SHADOW_SET(cha_filt_pp, gain_hi_cha_filt_pp);
+     OSC_SHADOW_SET(cha_filt_kk, gain_hi_cha_filt_kk);
     }
     else
     {
-     g_osc_fpga_reg_mem->cha_filt_aa =gain_lo_cha_filt_aa;
-     g_osc_fpga_reg_mem->cha_filt_bb =gain_lo_cha_filt_bb;
-     g_osc_fpga_reg_mem->cha_filt_pp =gain_lo_cha_filt_pp;
-     g_osc_fpga_reg_mem->cha_filt_kk =gain_lo_cha_filt_kk;      
+     OSC_SHADOW_SET(cha_filt_aa, gain_lo_cha_filt_aa);
+     OSC_SHADOW_SET(cha_filt_bb, gain_lo_cha_filt_bb);
+     OSC_SHADOW_SET(cha_filt_pp, gain_lo_cha_filt_pp);
+     OSC_SHADOW_SET(cha_filt_kk, gain_lo_cha_filt_kk);
     }
     
        if (ch2_gain==0)
     {
-     g_osc_fpga_reg_mem->chb_filt_aa =gain_hi_chb_filt_aa;
-     g_osc_fpga_reg_mem->chb_filt_bb =gain_hi_chb_filt_bb;
-     g_osc_fpga_reg_mem->chb_filt_pp =gain_hi_chb_filt_pp;
-     g_osc_fpga_reg_mem->chb_filt_kk =gain_hi_chb_filt_kk;
+     OSC_SHADOW_SET(chb_filt_aa, gain_hi_chb_filt_aa);
+     OSC_SHADOW_SET(chb_filt_bb, gain_hi_chb_filt_bb);
+     OSC_SHADOW_SET(chb_filt_pp, gain_hi_chb_filt_pp);
+     OSC_SHADOW_SET(chb_filt_kk, gain_hi_chb_filt_kk);
     }
     else
     {
-     g_osc_fpga_reg_mem->chb_filt_aa =gain_lo_chb_filt_aa;
-     g_osc_fpga_reg_mem->chb_filt_bb =gain_lo_chb_filt_bb;
-     g_osc_fpga_reg_mem->chb_filt_pp =gain_lo_chb_filt_pp;
-     g_osc_fpga_reg_mem->chb_filt_kk =gain_lo_chb_filt_kk;      
+     OSC_SHADOW_SET(chb_filt_aa, gain_lo_chb_filt_aa);
+     OSC_SHADOW_SET(chb_filt_bb, gain_lo_chb_filt_bb);
+     OSC_SHADOW_SET(chb_filt_pp, gain_lo_chb_filt_pp);
+     OSC_SHADOW_SET(chb_filt_kk, gain_lo_chb_filt_kk);
     }
     
-    
+    /* Reset before the new settings reach the write state machine */
+    upd = fpga_shadow_pending(&g_osc_shadow);
+    if(upd & FPGA_SHADOW_REARM)
+        osc_fpga_reset();
+    fpga_shadow_flush(&g_osc_shadow);
 
-    return 0;
+    return (upd & FPGA_SHADOW_REARM) ? OSC_FPGA_UPD_REARM : 0;
 }
 
 
@@ -343,7 +350,8 @@ int osc_fpga_set_trigger(uint32_t trig_source)
  */
 int osc_fpga_set_trigger_delay(uint32_t trig_delay)
 {
-    g_osc_fpga_reg_mem->trigger_delay = trig_delay;
+    OSC_SHADOW_SET(trigger_delay, trig_delay);
+    fpga_shadow_flush(&g_osc_shadow);
     return 0;
 }
 
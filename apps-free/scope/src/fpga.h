@@ -48,6 +48,9 @@
 /** Offset to the memory buffer where signal on channel B is captured. */
 #define OSC_FPGA_CHB_OFFSET    0x20000
 
+/** osc_fpga_update_params() return flag: acquisition must be re-armed. */
+#define OSC_FPGA_UPD_REARM     1
+
 /** Hysteresis register default setting */
 
 #define OSC_HYSTERESIS 0x3F
@@ -0,0 +1,190 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya shadow register file for FPGA register maps.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "fpga_shadow.h"
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Attach shadow register file to a register map
+ *
+ * All registers are of class FPGA_SHADOW_REARM and none is known to the
+ * shadow, so the first flush writes every register that was set.
+ *
+ * @param[out] sh    Shadow register file
+ * @param[in]  regs  Register map, may be NULL until it is mapped
+ * @param[in]  num   Number of shadowed registers from the start of the map
+ *
+ * @retval  0 Success
+ * @retval -1 Failure, error message is printed on standard error device
+ */
+int fpga_shadow_init(fpga_shadow_t *sh, volatile void *regs, int num)
+{
+    if((num < 1) || (num > FPGA_SHADOW_MAX_REGS)) {
+        fprintf(stderr, "fpga_shadow_init(): %d registers, max=%d\n",
+                num, FPGA_SHADOW_MAX_REGS);
+        return -1;
+    }
+
+    memset(sh, 0, sizeof(fpga_shadow_t));
+    sh->regs = (volatile uint32_t *)regs;
+    sh->num  = num;
+    memset(sh->cls, FPGA_SHADOW_REARM, sizeof(sh->cls));
+
+    return 0;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Set update class (FPGA_SHADOW_LIVE or FPGA_SHADOW_REARM) of a register
+ */
+void fpga_shadow_set_class(fpga_shadow_t *sh, int idx, int cls)
+{
+    if((idx >= 0) && (idx < sh->num))
+        sh->cls[idx] = cls;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Set shadow register value, written to the FPGA by next flush
+ */
+void fpga_shadow_set(fpga_shadow_t *sh, int idx, uint32_t value)
+{
+    if((idx < 0) || (idx >= sh->num))
+        return;
+
+    sh->val[idx] = value;
+    sh->dirty |= (uint64_t)1 << idx;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Set bit field of a shadow register
+ *
+ * Unlike a read-modify-write of the FPGA register the other fields are
+ * taken from the shadow, several fields of one register are written with a
+ * single access by next flush.
+ *
+ * @param[in] value  Field value, masked with mask
+ * @param[in] mask   Field mask (not shifted)
+ * @param[in] shift  Position of the field least significant bit
+ */
+void fpga_shadow_set_field(fpga_shadow_t *sh, int idx, uint32_t value,
+                           uint32_t mask, int shift)
+{
+    if((idx < 0) || (idx >= sh->num))
+        return;
+
+    fpga_shadow_set(sh, idx,
+                    (sh->val[idx] & ~(mask << shift)) | ((value & mask) << shift));
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Read shadow register value (the FPGA is not accessed)
+ */
+uint32_t fpga_shadow_get(const fpga_shadow_t *sh, int idx)
+{
+    if((idx < 0) || (idx >= sh->num))
+        return 0;
+    return sh->val[idx];
+}
+
+
+/* Registers a flush would write */
+static uint64_t fpga_shadow_changed(const fpga_shadow_t *sh)
+{
+    uint64_t changed = 0;
+    int i;
+
+    for(i = 0; i < sh->num; i++) {
+        uint64_t bit = (uint64_t)1 << i;
+        if((sh->dirty & bit) &&
+           (!(sh->valid & bit) || (sh->val[i] != sh->hw[i])))
+            changed |= bit;
+    }
+    return changed;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Classify pending changes without writing them
+ *
+ * @retval OR of the classes of registers next flush will write, 0 if none
+ */
+int fpga_shadow_pending(const fpga_shadow_t *sh)
+{
+    uint64_t changed = fpga_shadow_changed(sh);
+    int cls = 0;
+    int i;
+
+    for(i = 0; changed; i++, changed >>= 1) {
+        if(changed & 1)
+            cls |= sh->cls[i];
+    }
+    return cls;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Write changed registers to the FPGA
+ *
+ * Registers which were set to the value they already hold are not written.
+ *
+ * @retval OR of the classes of written registers, 0 if nothing was written
+ * @retval -1 Register map not attached
+ */
+int fpga_shadow_flush(fpga_shadow_t *sh)
+{
+    uint64_t changed = fpga_shadow_changed(sh);
+    int cls = 0;
+    int i;
+
+    if(sh->regs == NULL)
+        return -1;
+
+    for(i = 0; i < sh->num; i++) {
+        uint64_t bit = (uint64_t)1 << i;
+        if(changed & bit) {
+            sh->regs[i] = sh->val[i];
+            sh->hw[i]   = sh->val[i];
+            sh->valid  |= bit;
+            cls        |= sh->cls[i];
+            sh->writes++;
+        } else if(sh->dirty & bit) {
+            sh->skipped++;
+        }
+    }
+    sh->dirty = 0;
+
+    return cls;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief Forget FPGA register contents, e.g. after the map was re-mapped or
+ * the FPGA reloaded - every register set afterwards is written again
+ */
+void fpga_shadow_invalidate(fpga_shadow_t *sh)
+{
+    sh->valid = 0;
+}
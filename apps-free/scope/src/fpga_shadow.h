@@ -0,0 +1,68 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya shadow register file for FPGA register maps.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __FPGA_SHADOW_H
+#define __FPGA_SHADOW_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** @defgroup fpga_shadow_h Shadow registers
+ * @{
+ */
+
+/** Maximal number of shadowed 32-bit registers of one register map. */
+#define FPGA_SHADOW_MAX_REGS  64
+
+/** Register update classes. A change of a live register takes effect on the
+ * running acquisition/generation, a change of a re-arm register invalidates
+ * data already captured and requires the state machine to be restarted. */
+#define FPGA_SHADOW_LIVE      0x1
+#define FPGA_SHADOW_REARM     0x2
+
+/** Shadow register index of a field of a register map structure. */
+#define FPGA_SHADOW_IDX(type, field) (offsetof(type, field) / sizeof(uint32_t))
+
+/** @brief Shadow copy of the first num registers of a register map.
+ *
+ * Values and fields are set in the shadow only, fpga_shadow_flush() then
+ * writes the registers whose value differs from the one last written. Only
+ * registers that are not modified by the FPGA itself may be shadowed.
+ */
+typedef struct fpga_shadow_s {
+    volatile uint32_t *regs;
+    int       num;
+    uint32_t  val[FPGA_SHADOW_MAX_REGS];
+    /* value last written to the FPGA */
+    uint32_t  hw[FPGA_SHADOW_MAX_REGS];
+    uint8_t   cls[FPGA_SHADOW_MAX_REGS];
+    /* registers set since last flush, registers whose hw[] is valid */
+    uint64_t  dirty;
+    uint64_t  valid;
+    /* statistics: register writes done & avoided by flush */
+    uint32_t  writes;
+    uint32_t  skipped;
+} fpga_shadow_t;
+
+/** @} */
+
+int      fpga_shadow_init(fpga_shadow_t *sh, volatile void *regs, int num);
+void     fpga_shadow_set_class(fpga_shadow_t *sh, int idx, int cls);
+void     fpga_shadow_set(fpga_shadow_t *sh, int idx, uint32_t value);
+void     fpga_shadow_set_field(fpga_shadow_t *sh, int idx, uint32_t value,
+                               uint32_t mask, int shift);
+uint32_t fpga_shadow_get(const fpga_shadow_t *sh, int idx);
+int      fpga_shadow_pending(const fpga_shadow_t *sh);
+int      fpga_shadow_flush(fpga_shadow_t *sh);
+void     fpga_shadow_invalidate(fpga_shadow_t *sh);
+
+#endif /* __FPGA_SHADOW_H */
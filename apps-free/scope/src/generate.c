@@ -21,6 +21,7 @@
 
 #include "generate.h"
 #include "fpga_awg.h"
+#include "fpga_shadow.h"
 
 /**
  * GENERAL DESCRIPTION:
@@ -74,6 +75,16 @@ float ch1_max_dac_v;
  */
 float ch2_max_dac_v;
 
+/** Shadow of the AWG channel registers (up to channel B step) and the last
+ * buffer & mode written per channel. When only offset or frequency change
+ * the registers are updated without restarting the output.
+ */
+static fpga_shadow_t awg_shadow;
+static int32_t       awg_last_data[2][AWG_SIG_LEN];
+static int           awg_last_mode[2] = { -1, -1 };
+
+#define AWG_SHADOW_IDX(field) FPGA_SHADOW_IDX(awg_reg_t, field)
+
 /** Predefined File name, used for definition of arbitrary Signal Shape. */
 const char *gen_waveform_file1="/tmp/gen_ch1.csv";
 const char *gen_waveform_file2="/tmp/gen_ch2.csv";
@@ -376,6 +387,10 @@ void write_data_fpga(uint32_t ch, int mode, int trigger, const int32_t *data,
     uint32_t i;
     int mode_mask = 0;
     uint32_t state_machine = g_awg_reg->state_machine_conf;
+    const int scale_off = ch ? AWG_SHADOW_IDX(chb_scale_off) : AWG_SHADOW_IDX(cha_scale_off);
+    const int wrap_reg  = ch ? AWG_SHADOW_IDX(chb_count_wrap) : AWG_SHADOW_IDX(cha_count_wrap);
+    const int step      = ch ? AWG_SHADOW_IDX(chb_count_step) : AWG_SHADOW_IDX(cha_count_step);
+    const int start_off = ch ? AWG_SHADOW_IDX(chb_start_off) : AWG_SHADOW_IDX(cha_start_off);
 
     switch(mode) {
     case 0: /* continuous */
@@ -399,15 +414,25 @@ void write_data_fpga(uint32_t ch, int mode, int trigger, const int32_t *data,
         break;
     }
 
+    fpga_shadow_set(&awg_shadow, scale_off, awg->offsgain);
+    fpga_shadow_set(&awg_shadow, wrap_reg,  awg->wrap);
+    fpga_shadow_set(&awg_shadow, step,      awg->step);
+    fpga_shadow_set(&awg_shadow, start_off, 0);
+
+    /* Same buffer & mode (no single trigger): the output keeps running */
+    if((mode != 1) && (awg_last_mode[ch] == mode_mask) &&
+       !(fpga_shadow_pending(&awg_shadow) & FPGA_SHADOW_REARM) &&
+       !memcmp(awg_last_data[ch], data, sizeof(awg_last_data[ch]))) {
+        fpga_shadow_flush(&awg_shadow);
+        return;
+    }
+
     if(ch == 0) {
         /* Channel A */
         state_machine &= ~0xff;
 
         g_awg_reg->state_machine_conf = state_machine | 0xC0;
-        g_awg_reg->cha_scale_off      = awg->offsgain;
-        g_awg_reg->cha_count_wrap     = awg->wrap;
-        g_awg_reg->cha_count_step     = awg->step;
-        g_awg_reg->cha_start_off      = 0;
+        fpga_shadow_flush(&awg_shadow);
 
         for(i = 0; i < AWG_SIG_LEN; i++) {
             g_awg_cha_mem[i] = data[i];
@@ -420,10 +445,7 @@ void write_data_fpga(uint32_t ch, int mode, int trigger, const int32_t *data,
         state_machine &= ~0xff0000;
 
         g_awg_reg->state_machine_conf = state_machine | 0xC00000;
-        g_awg_reg->chb_scale_off      = awg->offsgain;
-        g_awg_reg->chb_count_wrap     = awg->wrap;
-        g_awg_reg->chb_count_step     = awg->step;
-        g_awg_reg->chb_start_off      = 0;
+        fpga_shadow_flush(&awg_shadow);
 
         for(i = 0; i < AWG_SIG_LEN; i++) {
             g_awg_chb_mem[i] = data[i];
@@ -431,6 +453,8 @@ void write_data_fpga(uint32_t ch, int mode, int trigger, const int32_t *data,
 
         g_awg_reg->state_machine_conf = state_machine | (mode_mask<<16);
     }
+    memcpy(awg_last_data[ch], data, sizeof(awg_last_data[ch]));
+    awg_last_mode[ch] = mode_mask;
 }
 
 
@@ -475,6 +499,15 @@ int generate_init(rp_calib_params_t *calib_params)
         return -1;
     }
 
+    /* Offset and step take effect on the running output, wrap and start
+     * offset select another part of the buffer */
+    fpga_shadow_init(&awg_shadow, g_awg_reg, AWG_SHADOW_IDX(chb_count_step) + 1);
+    fpga_shadow_set_class(&awg_shadow, AWG_SHADOW_IDX(cha_scale_off), FPGA_SHADOW_LIVE);
+    fpga_shadow_set_class(&awg_shadow, AWG_SHADOW_IDX(cha_count_step), FPGA_SHADOW_LIVE);
+    fpga_shadow_set_class(&awg_shadow, AWG_SHADOW_IDX(chb_scale_off), FPGA_SHADOW_LIVE);
+    fpga_shadow_set_class(&awg_shadow, AWG_SHADOW_IDX(chb_count_step), FPGA_SHADOW_LIVE);
+    awg_last_mode[0] = awg_last_mode[1] = -1;
+
     ch1_max_dac_v = fpga_awg_calc_dac_max_v(gen_calib_params->be_ch1_fs);
     ch2_max_dac_v = fpga_awg_calc_dac_max_v(gen_calib_params->be_ch2_fs);
     return 0;
@@ -293,12 +293,25 @@ static rp_app_params_t rp_main_params[PARAMS_NUM+1] = {
     { /* pid_NN_kd - PID NN derivative gain   Kd in [ADC] counts. */
         "pid_22_kd",  0, 1, 0, -8192, 8191 },
 
+    { /* hist_start - Start of the long memory history window, in [s] before
+       *  the newest sample:
+       *    0 - live signals, no history window
+       *   >0 - signals from hist_start to hist_stop back, see rp_get_signals() */
+        "hist_start", 0, 0, 0, 0, 1e6 },
+    { /* hist_stop - End of the history window, in [s] before the newest
+       *  sample, below hist_start */
+        "hist_stop", 0, 0, 0, 0, 1e6 },
+
     { /* Must be last! */
         NULL, 0.0, -1, -1, 0.0, 0.0 }     
 };
 /* params initialized */
 static int params_init = 0;
 
+/* Parameter indexes sorted by name for rp_find_param(), built on first use */
+static int rp_params_sorted[PARAMS_NUM];
+static int rp_params_sorted_init = 0;
+
 /* AUTO set algorithm in progress flag */
 int auto_in_progress = 0;
 
@@ -608,10 +621,54 @@ void transform_from_iface_units(rp_app_params_t *p)
     p[GEN_DC_NORM_2].value = p[GEN_DC_OFFS_2].value / scale2;
 }
 
+static int rp_params_name_cmp(const void *a, const void *b)
+{
+    return strcmp(rp_main_params[*(const int *)a].name,
+                  rp_main_params[*(const int *)b].name);
+}
+
+/* Returns index of parameter name or -1, hint is the expected index */
+static int rp_find_param(const char *name, int hint)
+{
+    int lo = 0, hi = PARAMS_NUM - 1;
+
+    if(!rp_params_sorted_init) {
+        int i;
+        for(i = 0; i < PARAMS_NUM; i++)
+            rp_params_sorted[i] = i;
+        qsort(rp_params_sorted, PARAMS_NUM, sizeof(int), rp_params_name_cmp);
+        rp_params_sorted_init = 1;
+    }
+
+    /* Clients send the whole table, mostly in its own order */
+    if((hint >= 0) && (hint < PARAMS_NUM) &&
+       !strcmp(name, rp_main_params[hint].name))
+        return hint;
+
+    while(lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = strcmp(name, rp_main_params[rp_params_sorted[mid]].name);
+        if(cmp == 0)
+            return rp_params_sorted[mid];
+        if(cmp < 0)
+            hi = mid - 1;
+        else
+            lo = mid + 1;
+    }
+    return -1;
+}
+
+/* Y range parameters are only used by the client for display */
+static int rp_param_display_only(int p_idx)
+{
+    return (p_idx == MIN_Y_PARAM) || (p_idx == MAX_Y_PARAM) ||
+           (p_idx == MIN_Y_NORM)  || (p_idx == MAX_Y_NORM);
+}
+
 int rp_set_params(rp_app_params_t *p, int len)
 {
     int i;
-    int fpga_update = 1;
+    int fpga_update = 0;
     int params_change = 0;
     int awg_params_change = 0;
     int pid_params_change = 0;
@@ -625,22 +682,8 @@ int rp_set_params(rp_app_params_t *p, int len)
 
     pthread_mutex_lock(&rp_main_params_mutex);
     for(i = 0; i < len || p[i].name != NULL; i++) {
-        int p_idx = -1;
-        int j = 0;
-        /* Search for correct parameter name in defined parameters */
-        while(rp_main_params[j].name != NULL) {
-            int p_strlen = strlen(p[i].name);
-
-            if(p_strlen != strlen(rp_main_params[j].name)) {
-                j++;
-                continue;
-            }
-            if(!strncmp(p[i].name, rp_main_params[j].name, p_strlen)) {
-                p_idx = j;
-                break;
-            }
-            j++;
-        }
+        int p_idx = rp_find_param(p[i].name, i);
+        int changed;
 
         if(p_idx == -1) {
             fprintf(stderr, "Parameter %s not found, ignoring it\n", p[i].name);
@@ -650,12 +693,22 @@ int rp_set_params(rp_app_params_t *p, int len)
         if(rp_main_params[p_idx].read_only)
             continue;
 
-        if(rp_main_params[p_idx].value != p[i].value) {
-            if(p_idx < PARAMS_AWG_PARAMS) 
+        changed = (rp_main_params[p_idx].value != p[i].value);
+        /* xmin/xmax are converted to seconds and rounded to the sampling
+         * quanta while the client keeps sending its own values - compare
+         * those with the client's last ones (gui_xmin/gui_xmax) */
+        if(((p_idx == MIN_GUI_PARAM) || (p_idx == MAX_GUI_PARAM)) &&
+           params_init && !forcex_state) {
+            int gui_idx = (p_idx == MIN_GUI_PARAM) ? GUI_XMIN : GUI_XMAX;
+            changed = (rp_main_params[gui_idx].value != p[i].value);
+        }
+
+        if(changed) {
+            if((p_idx < PARAMS_AWG_PARAMS) && !rp_param_display_only(p_idx))
                 params_change = 1;
             if ( (p_idx >= PARAMS_AWG_PARAMS) && (p_idx < PARAMS_PID_PARAMS) )
                 awg_params_change = 1;
-            if(p_idx >= PARAMS_PID_PARAMS)
+            if((p_idx >= PARAMS_PID_PARAMS) && (p_idx < PARAMS_HIST_PARAMS))
                 pid_params_change = 1;
             if(rp_main_params[p_idx].fpga_update)
                 fpga_update = 1;
@@ -677,6 +730,8 @@ int rp_set_params(rp_app_params_t *p, int len)
 
     /* Set parameters in HW/FPGA only if they have changed */
     if(params_change || (params_init == 0)) {
+        if(params_init == 0)
+            fpga_update = 1;
 
         pthread_mutex_lock(&rp_main_params_mutex);
         /* Xmin & Xmax public copy to be served to clients */
@@ -917,10 +972,87 @@ int rp_get_params(rp_app_params_t **p)
     return PARAMS_NUM;
 }
 
+/* History window last served, with the history stamp it was served at */
+static int      hist_served = 0;
+static float    hist_served_start, hist_served_stop;
+static int      hist_served_unit;
+static uint64_t hist_served_stamp;
+
+/* Fills the signals with the long memory history from t_start to t_stop [s]
+ * back: each point is a min, max pair of samples so the trace draws the
+ * envelope of the stretch, the time axis is in the client's time unit.
+ * Returns -1 if the history does not keep the stretch, or if neither the
+ * window nor the history changed since the signals were last filled.
+ */
+static int rp_get_history_signals(float **s, float t_start, float t_stop,
+                                  int time_unit)
+{
+    uint64_t stamp = rp_osc_get_history_stamp();
+    float *min, *max, *mean;
+    int   t_unit_factor = rp_osc_get_time_unit_factor(time_unit);
+    int   ret_val = -1;
+    int   ch, i, size = 0;
+    float t_step;
+
+    /* nothing new, the client keeps what it has */
+    if(hist_served && (stamp == hist_served_stamp) &&
+       (t_start == hist_served_start) && (t_stop == hist_served_stop) &&
+       (time_unit == hist_served_unit))
+        return -1;
+
+    min  = (float *)malloc(SIGNAL_LENGTH / 2 * sizeof(float));
+    max  = (float *)malloc(SIGNAL_LENGTH / 2 * sizeof(float));
+    mean = (float *)malloc(SIGNAL_LENGTH / 2 * sizeof(float));
+    if((min == NULL) || (max == NULL) || (mean == NULL))
+        goto out;
+
+    for(ch = 0; ch < 2; ch++) {
+        int ch_size = SIGNAL_LENGTH / 2;
+
+        if(rp_osc_get_history(ch, t_start, t_stop, min, max, mean, &ch_size,
+                              &t_step) < 0)
+            goto out;
+        /* both channels come from the same samples, a restart in between
+         * leaves them short of each other */
+        size = (ch == 0) ? ch_size : ((ch_size < size) ? ch_size : size);
+        for(i = 0; i < ch_size; i++) {
+            s[ch+1][2*i]   = min[i];
+            s[ch+1][2*i+1] = max[i];
+        }
+    }
+    if(size <= 0)
+        goto out;
+
+    t_step = (t_start - t_stop) / size;
+    for(i = 0; i < SIGNAL_LENGTH; i++) {
+        int pt = (i / 2 < size) ? i / 2 : size - 1;
+        int j  = (i / 2 < size) ? i : 2 * size - 1;
+
+        s[0][i] = (-t_start + (pt + 0.5 * (i & 1)) * t_step) * t_unit_factor;
+        s[1][i] = s[1][j];
+        s[2][i] = s[2][j];
+    }
+    ret_val = 0;
+
+    hist_served       = 1;
+    hist_served_start = t_start;
+    hist_served_stop  = t_stop;
+    hist_served_unit  = time_unit;
+    hist_served_stamp = stamp;
+
+out:
+    free(min);
+    free(max);
+    free(mean);
+    return ret_val;
+}
+
 int rp_get_signals(float ***s, int *sig_num, int *sig_len)
 {
     int ret_val;
     int sig_idx;
+    float hist_start, hist_stop;
+    int time_unit;
 
     if(*s == NULL)
         return -1;
@@ -928,6 +1060,18 @@ int rp_get_signals(float ***s, int *sig_num, int *sig_len)
     *sig_num = SIGNALS_NUM;
     *sig_len = SIGNAL_LENGTH;
 
+    pthread_mutex_lock(&rp_main_params_mutex);
+    hist_start = rp_main_params[HIST_START_PARAM].value;
+    hist_stop  = rp_main_params[HIST_STOP_PARAM].value;
+    time_unit  = rp_main_params[TIME_UNIT_PARAM].value;
+    pthread_mutex_unlock(&rp_main_params_mutex);
+
+    /* History window instead of the live signals */
+    if(hist_start > 0)
+        return rp_get_history_signals(*s, hist_start, hist_stop, time_unit);
+    /* the live signals replace the window */
+    hist_served = 0;
+
     ret_val = rp_osc_get_signals(s, &sig_idx);
 
     /* Not finished signal */
@@ -942,6 +1086,11 @@ int rp_get_signals(float ***s, int *sig_num, int *sig_len)
     return 0;
 }
 
+int rp_get_signals_fd(void)
+{
+    return rp_osc_get_signals_fd();
+}
+
 int rp_create_signals(float ***a_signals)
 {
     int i;
@@ -45,7 +45,7 @@ typedef struct rp_osc_meas_res_s {
 
 /* Parameters indexes - these defines should be in the same order as 
  * rp_app_params_t structure defined in main.c */
-#define PARAMS_NUM        81
+#define PARAMS_NUM        83
 #define MIN_GUI_PARAM     0
 #define MAX_GUI_PARAM     1
 #define TRIG_MODE_PARAM   2
@@ -129,6 +129,8 @@ typedef struct rp_osc_meas_res_s {
 #define PID_22_KP         78
 #define PID_22_KI         79
 #define PID_22_KD         80
+#define HIST_START_PARAM  81
+#define HIST_STOP_PARAM   82
 
 /* Defines from which parameters on are AWG parameters (used in set_param() to
  * trigger update only on needed part - either Oscilloscope, AWG or PID */
@@ -139,6 +141,10 @@ typedef struct rp_osc_meas_res_s {
 #define PARAMS_PID_PARAMS 57
 #define PARAMS_PER_PID     6
 
+/* Defines from which parameters on are history window parameters, these
+ * change only what rp_get_signals() serves */
+#define PARAMS_HIST_PARAMS 81
+
 /* Output signals */
 #define SIGNAL_LENGTH (1024) /* Must be 2^n! */
 #define SIGNALS_NUM   3
@@ -150,6 +156,7 @@ int rp_app_exit(void);
 int rp_set_params(rp_app_params_t *p, int len);
 int rp_get_params(rp_app_params_t **p);
 int rp_get_signals(float ***s, int *sig_num, int *sig_len);
+int rp_get_signals_fd(void);
 
 /* Internal helper functions */
 int  rp_create_signals(float ***a_signals);
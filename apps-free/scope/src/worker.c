@@ -20,6 +20,10 @@
 #include <math.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <sys/eventfd.h>
+
+#include "redpitaya/rp_history.h"
+#include "perf.h"
 
 #include "worker.h"
 #include "fpga.h"
@@ -34,6 +38,7 @@ int                   rp_osc_params_dirty;
 int                   rp_osc_params_fpga_update;
 
 pthread_mutex_t       rp_osc_sig_mutex = PTHREAD_MUTEX_INITIALIZER;
+int                   rp_osc_sig_fd = -1; /* eventfd, signalled on new signals */
 float               **rp_osc_signals;
 int                   rp_osc_signals_dirty = 0;
 int                   rp_osc_sig_last_idx = 0;
@@ -45,6 +50,16 @@ int                  *rp_fpga_cha_signal, *rp_fpga_chb_signal;
 /* Calibration parameters read from EEPROM */
 rp_calib_params_t *rp_calib_params = NULL;
 
+/* Long memory history of the inputs in ADC counts, fed by the worker */
+rp_history_t         *rp_osc_history[2] = { NULL, NULL };
+pthread_mutex_t       rp_osc_hist_mutex = PTHREAD_MUTEX_INITIALIZER;
+int                   rp_osc_hist_dec = 0; /* decimation of the samples kept, 0 - none */
+int                   rp_osc_hist_gain[2];
+float                 rp_osc_hist_max_adc_v[2];
+float                 rp_osc_hist_user_dc_off[2];
+uint64_t              rp_osc_hist_end = 0; /* end of the samples kept, as last fed */
+uint64_t              rp_osc_hist_stamp = 0; /* see rp_osc_get_history_stamp() */
+
 
 /*----------------------------------------------------------------------------------*/
 int rp_osc_worker_init(rp_app_params_t *params, int params_len,
@@ -78,6 +93,26 @@ int rp_osc_worker_init(rp_app_params_t *params, int params_len,
 
     osc_fpga_get_sig_ptr(&rp_fpga_cha_signal, &rp_fpga_chb_signal);
 
+    /* Without it the scope just keeps no history */
+    if(rp_osc_history[0] == NULL) {
+        if((rp_HistoryCreate(RP_OSC_HIST_CAPACITY, RP_OSC_HIST_LEVELS,
+                             &rp_osc_history[0]) != 0) ||
+           (rp_HistoryCreate(RP_OSC_HIST_CAPACITY, RP_OSC_HIST_LEVELS,
+                             &rp_osc_history[1]) != 0)) {
+            fprintf(stderr, "rp_HistoryCreate() failed\n");
+            rp_HistoryDestroy(rp_osc_history[0]);
+            rp_osc_history[0] = NULL;
+        }
+    }
+
+    /* Without it the web server polls rp_get_signals() */
+    if(rp_osc_sig_fd < 0) {
+        rp_osc_sig_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(rp_osc_sig_fd < 0) {
+            fprintf(stderr, "eventfd() failed: %s\n", strerror(errno));
+        }
+    }
+
     rp_osc_thread_handler = (pthread_t *)malloc(sizeof(pthread_t));
     if(rp_osc_thread_handler == NULL) {
         rp_cleanup_signals(&rp_osc_signals);
@@ -117,6 +152,18 @@ int rp_osc_worker_exit(void)
     }
     osc_fpga_exit();
 
+    if(rp_osc_sig_fd >= 0) {
+        close(rp_osc_sig_fd);
+        rp_osc_sig_fd = -1;
+    }
+
+    pthread_mutex_lock(&rp_osc_hist_mutex);
+    rp_HistoryDestroy(rp_osc_history[0]);
+    rp_HistoryDestroy(rp_osc_history[1]);
+    rp_osc_history[0] = rp_osc_history[1] = NULL;
+    rp_osc_hist_dec = 0;
+    pthread_mutex_unlock(&rp_osc_hist_mutex);
+
     rp_cleanup_signals(&rp_osc_signals);
     rp_cleanup_signals(&rp_tmp_signals);
 
@@ -154,7 +201,8 @@ int rp_osc_worker_update_params(rp_app_params_t *params, int fpga_update)
     pthread_mutex_lock(&rp_osc_ctrl_mutex);
     rp_copy_params(params, (rp_app_params_t **)&rp_osc_params);
     rp_osc_params_dirty       = 1;
-    rp_osc_params_fpga_update = fpga_update;
+    /* kept until the worker picks up the parameters */
+    rp_osc_params_fpga_update |= fpga_update;
     rp_osc_params[PARAMS_NUM].name = NULL;
     rp_osc_params[PARAMS_NUM].value = -1;
 
@@ -199,6 +247,8 @@ int rp_osc_get_signals(float ***signals, int *sig_idx)
 /*----------------------------------------------------------------------------------*/
 int rp_osc_set_signals(float **source, int index)
 {
+    uint64_t one = 1;
+
     pthread_mutex_lock(&rp_osc_sig_mutex);
 
     memcpy(&rp_osc_signals[0][0], &source[0][0], sizeof(float)*SIGNAL_LENGTH);
@@ -209,10 +259,25 @@ int rp_osc_set_signals(float **source, int index)
     rp_osc_signals_dirty = 1;
     pthread_mutex_unlock(&rp_osc_sig_mutex);
 
+    /* Wakes up the web server. Fails only when the counter would overflow,
+     * the eventfd is readable then anyway.
+     */
+    if(rp_osc_sig_fd >= 0) {
+        ssize_t ret = write(rp_osc_sig_fd, &one, sizeof(one));
+        (void)ret;
+    }
+
     return 0;
 }
 
 
+/*----------------------------------------------------------------------------------*/
+int rp_osc_get_signals_fd(void)
+{
+    return rp_osc_sig_fd;
+}
+
+
 /*----------------------------------------------------------------------------------*/
 int rp_osc_set_meas_data(rp_osc_meas_res_t ch1_meas, rp_osc_meas_res_t ch2_meas)
 {
@@ -221,6 +286,163 @@ int rp_osc_set_meas_data(rp_osc_meas_res_t ch1_meas, rp_osc_meas_res_t ch2_meas)
 }
 
 
+/*----------------------------------------------------------------------------------*/
+/* Takes new settings for the history, it starts over if the samples to come
+ * do not go together with the ones kept */
+static void rp_osc_history_update(int dec_factor, int ch1_gain, int ch2_gain,
+                                  float ch1_max_adc_v, float ch2_max_adc_v,
+                                  float ch1_user_dc_off, float ch2_user_dc_off)
+{
+    int restart;
+
+    if(rp_osc_history[0] == NULL)
+        return;
+    if(dec_factor < RP_OSC_HIST_MIN_DEC)
+        dec_factor = 0;
+
+    pthread_mutex_lock(&rp_osc_hist_mutex);
+    restart = (dec_factor != rp_osc_hist_dec) ||
+              (ch1_gain != rp_osc_hist_gain[0]) ||
+              (ch2_gain != rp_osc_hist_gain[1]);
+    if(restart) {
+        rp_HistoryReset(rp_osc_history[0]);
+        rp_HistoryReset(rp_osc_history[1]);
+    }
+    /* the volts change with the gain & offsets */
+    if(restart || (ch1_max_adc_v != rp_osc_hist_max_adc_v[0]) ||
+       (ch2_max_adc_v != rp_osc_hist_max_adc_v[1]) ||
+       (ch1_user_dc_off != rp_osc_hist_user_dc_off[0]) ||
+       (ch2_user_dc_off != rp_osc_hist_user_dc_off[1]))
+        rp_osc_hist_stamp++;
+    rp_osc_hist_dec            = dec_factor;
+    rp_osc_hist_gain[0]        = ch1_gain;
+    rp_osc_hist_gain[1]        = ch2_gain;
+    rp_osc_hist_max_adc_v[0]   = ch1_max_adc_v;
+    rp_osc_hist_max_adc_v[1]   = ch2_max_adc_v;
+    rp_osc_hist_user_dc_off[0] = ch1_user_dc_off;
+    rp_osc_hist_user_dc_off[1] = ch2_user_dc_off;
+    pthread_mutex_unlock(&rp_osc_hist_mutex);
+}
+
+
+/*----------------------------------------------------------------------------------*/
+/* Feeds the history with the samples written since the last call. Called
+ * every 1 to 10 ms, the FPGA buffer lasts 134 ms at RP_OSC_HIST_MIN_DEC;
+ * only long acquisitions wait 200 ms, their buffer lasts over 1 s. */
+static void rp_osc_history_feed(int dec_factor)
+{
+    int wr_ptr;
+    uint64_t first, end;
+    double rate = 1.0 / (c_osc_fpga_smpl_period * dec_factor);
+
+    if((rp_osc_history[0] == NULL) || (dec_factor < RP_OSC_HIST_MIN_DEC))
+        return;
+
+    osc_fpga_get_wr_ptr(&wr_ptr, NULL);
+    rp_HistoryFeedRing(rp_osc_history[0], (const volatile uint32_t *)rp_fpga_cha_signal,
+                       OSC_FPGA_SIG_LEN, wr_ptr, rate);
+    rp_HistoryFeedRing(rp_osc_history[1], (const volatile uint32_t *)rp_fpga_chb_signal,
+                       OSC_FPGA_SIG_LEN, wr_ptr, rate);
+
+    pthread_mutex_lock(&rp_osc_hist_mutex);
+    rp_HistoryGetRange(rp_osc_history[0], &first, &end);
+    if(end != rp_osc_hist_end) {
+        rp_osc_hist_end = end;
+        rp_osc_hist_stamp++;
+    }
+    pthread_mutex_unlock(&rp_osc_hist_mutex);
+}
+
+
+/*----------------------------------------------------------------------------------*/
+uint64_t rp_osc_get_history_stamp(void)
+{
+    uint64_t stamp;
+
+    pthread_mutex_lock(&rp_osc_hist_mutex);
+    stamp = rp_osc_hist_stamp;
+    pthread_mutex_unlock(&rp_osc_hist_mutex);
+    return stamp;
+}
+
+
+/*----------------------------------------------------------------------------------*/
+/* Converts history ADC counts to V, as osc_fpga_cnv_cnt_to_v() */
+static float rp_osc_history_cnv(float m, float adc_max_v, int calib_dc_off,
+                                float user_dc_off)
+{
+    float full = (float)(1<<(c_osc_fpga_adc_bits-1));
+
+    m += calib_dc_off;
+    if(m < -full)
+        m = -full;
+    else if(m > full)
+        m = full;
+    return m * adc_max_v / full + user_dc_off;
+}
+
+
+/*----------------------------------------------------------------------------------*/
+int rp_osc_get_history(int channel, float t_start, float t_stop,
+                       float *min, float *max, float *mean, int *size,
+                       float *t_step)
+{
+    rp_history_point_t *points;
+    uint64_t first, end, step, back_start, back_stop;
+    uint32_t n = *size;
+    float smpl_period, adc_max_v, user_dc_off;
+    int calib_dc_off, i;
+
+    if((channel < 0) || (channel > 1) || (*size <= 0) || (t_stop < 0) ||
+       (t_start <= t_stop))
+        return -1;
+
+    pthread_mutex_lock(&rp_osc_hist_mutex);
+    if(rp_osc_hist_dec == 0) {
+        pthread_mutex_unlock(&rp_osc_hist_mutex);
+        return -1;
+    }
+    smpl_period  = c_osc_fpga_smpl_period * rp_osc_hist_dec;
+    adc_max_v    = rp_osc_hist_max_adc_v[channel];
+    user_dc_off  = rp_osc_hist_user_dc_off[channel];
+    calib_dc_off = channel ? rp_calib_params->fe_ch2_dc_offs :
+                             rp_calib_params->fe_ch1_dc_offs;
+
+    /* query under the lock, a restart in between would mix the settings */
+    rp_HistoryGetRange(rp_osc_history[channel], &first, &end);
+    back_start = round(t_start / smpl_period);
+    back_stop  = round(t_stop / smpl_period);
+    if((back_start > end - first) || (back_stop >= back_start)) {
+        pthread_mutex_unlock(&rp_osc_hist_mutex);
+        return -1;
+    }
+
+    points = (rp_history_point_t *)malloc(n * sizeof(rp_history_point_t));
+    if((points == NULL) ||
+       (rp_HistoryQuery(rp_osc_history[channel], end - back_start,
+                        end - back_stop, points, &n, &step) != 0)) {
+        pthread_mutex_unlock(&rp_osc_hist_mutex);
+        free(points);
+        return -1;
+    }
+    pthread_mutex_unlock(&rp_osc_hist_mutex);
+
+    for(i = 0; i < n; i++) {
+        min[i]  = rp_osc_history_cnv(points[i].min, adc_max_v, calib_dc_off,
+                                     user_dc_off);
+        max[i]  = rp_osc_history_cnv(points[i].max, adc_max_v, calib_dc_off,
+                                     user_dc_off);
+        mean[i] = rp_osc_history_cnv(points[i].mean, adc_max_v, calib_dc_off,
+                                     user_dc_off);
+    }
+    *size   = n;
+    *t_step = step * smpl_period;
+
+    free(points);
+    return 0;
+}
+
+
 /*----------------------------------------------------------------------------------*/
 void *rp_osc_worker_thread(void *args)
 {
@@ -231,6 +453,8 @@ void *rp_osc_worker_thread(void *args)
     int                   time_vect_update = 0;
     uint32_t              trig_source = 0;
     int                   params_dirty = 0;
+    /* start a new acquisition, otherwise keep waiting for the armed one */
+    int                   rearm = 1;
 
     /* Long acquisition special function */
     int long_acq = 0; /* long_acq if acq_time > 1 [s] */
@@ -259,6 +483,7 @@ void *rp_osc_worker_thread(void *args)
         if(rp_osc_params_dirty) {
             rp_copy_params(rp_osc_params, (rp_app_params_t **)&curr_params);
             fpga_update = rp_osc_params_fpga_update;
+            rp_osc_params_fpga_update = 0;
 
             rp_osc_params_dirty = 0;
             dec_factor = 
@@ -276,6 +501,12 @@ void *rp_osc_worker_thread(void *args)
                     rp_calib_params->fe_ch2_fs_g_lo;
             ch2_max_adc_v =
                     osc_fpga_calc_adc_max_v(fe_fsg2, (int)curr_params[PRB_ATT_CH2].value);
+
+            rp_osc_history_update(dec_factor, curr_params[GAIN_CH1].value,
+                                  curr_params[GAIN_CH2].value,
+                                  ch1_max_adc_v, ch2_max_adc_v,
+                                  curr_params[GEN_DC_OFFS_1].value,
+                                  curr_params[GEN_DC_OFFS_2].value);
         }
         pthread_mutex_unlock(&rp_osc_ctrl_mutex);
 
@@ -297,11 +528,12 @@ void *rp_osc_worker_thread(void *args)
                             curr_params[EN_AVG_AT_DEC].value);
             /* Return calculated parameters to main module */
             rp_update_main_params(curr_params);
+            rearm = 1;
             continue;
         }
         if(fpga_update) {
-            osc_fpga_reset();
-            if(osc_fpga_update_params((curr_params[TRIG_MODE_PARAM].value == 0),
+            uint32_t new_trig_source;
+            int upd = osc_fpga_update_params((curr_params[TRIG_MODE_PARAM].value == 0),
                                       curr_params[TRIG_SRC_PARAM].value, 
                                       curr_params[TRIG_EDGE_PARAM].value,
                                       /* Here we could use trigger, but it is safer
@@ -324,19 +556,32 @@ void *rp_osc_worker_thread(void *args)
                                       curr_params[PRB_ATT_CH2].value,
                                       curr_params[GAIN_CH1].value,
                                       curr_params[GAIN_CH2].value,				      
-                                      curr_params[EN_AVG_AT_DEC].value) < 0) {
+                                      curr_params[EN_AVG_AT_DEC].value);
+            if(upd < 0) {
                 fprintf(stderr, "Setting of FPGA registers failed\n");
                 rp_osc_worker_change_state(rp_osc_idle_state);
             }
-            trig_source = osc_fpga_cnv_trig_source(
+            new_trig_source = osc_fpga_cnv_trig_source(
                                      (curr_params[TRIG_MODE_PARAM].value == 0),
                                      curr_params[TRIG_SRC_PARAM].value,
                                      curr_params[TRIG_EDGE_PARAM].value);
 
+            /* Trigger level & hysteresis apply to the armed acquisition */
+            if((upd != 0) || (new_trig_source != trig_source))
+                rearm = 1;
+            /* The write pointer starts over after a reset */
+            if((upd > 0) && rp_osc_history[0]) {
+                rp_HistoryResync(rp_osc_history[0]);
+                rp_HistoryResync(rp_osc_history[1]);
+            }
+            trig_source = new_trig_source;
             fpga_update = 0;
         }
 
+        rp_osc_history_feed(dec_factor);
+
         if(state == rp_osc_idle_state) {
+            rearm = 1;
             usleep(10000);
             continue;
         }
@@ -367,6 +612,7 @@ void *rp_osc_worker_thread(void *args)
                 rp_osc_meas_clear(&ch1_meas);
                 rp_osc_meas_clear(&ch2_meas);
                 osc_fpga_get_wr_ptr(NULL, &long_acq_init_trig_ptr);
+                rearm = 1;
             } else {
                 long_acq_first_wr_ptr  = 0;
                 long_acq_last_wr_ptr   = 0;
@@ -376,7 +622,7 @@ void *rp_osc_worker_thread(void *args)
         }
 
         /* Start new acquisition only if it is the index 0 (new acquisition) */
-        if(long_acq_idx == 0) {
+        if((long_acq_idx == 0) && rearm) {
             float time_delay = curr_params[TRIG_DLY_PARAM].value;
             /* Start the writting machine */
             osc_fpga_arm_trigger();
@@ -396,6 +642,7 @@ void *rp_osc_worker_thread(void *args)
 
             /* Start the trigger */
             osc_fpga_set_trigger(trig_source);
+            rearm = 0;
         }
 
         /* start working */
@@ -433,11 +680,14 @@ void *rp_osc_worker_thread(void *args)
                         break;
                     }
                 }
+                rp_osc_history_feed(dec_factor);
                 usleep(1000);
             }
         }
 
         if((state != old_state) || params_dirty) {
+            if(state != old_state)
+                rearm = 1;
             params_dirty = 0;
             continue;
         }
@@ -492,9 +742,15 @@ void *rp_osc_worker_thread(void *args)
         params_dirty = rp_osc_params_dirty;
         pthread_mutex_unlock(&rp_osc_ctrl_mutex);
 
-        if((state != old_state) || params_dirty)
+        if((state != old_state) || params_dirty) {
+            if(state != old_state)
+                rearm = 1;
             continue;
+        }
 
+        /* Triggered, next round starts a new acquisition */
+        rearm = 1;
+        PERF_BEGIN(t);
         if(!long_acq) {
             /* Triggered, decimate & convert the values */
             rp_osc_meas_clear(&ch1_meas);
@@ -568,6 +824,8 @@ void *rp_osc_worker_thread(void *args)
         } else {
             rp_osc_set_signals(rp_tmp_signals, long_acq_idx);
         }
+        PERF_END(RP_PERF_OSC_PROCESS, t);
+
         /* do not loop too fast */
         usleep(10000);
     }
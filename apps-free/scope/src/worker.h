@@ -47,6 +47,10 @@ int rp_osc_get_signals(float ***signals, int *sig_idx);
  * and marks it dirty 
  */
 int rp_osc_set_signals(float **source, int index);
+/* Returns eventfd which becomes readable when rp_osc_set_signals() marks
+ * new signals dirty (-1 if not available). The reader drains it.
+ */
+int rp_osc_get_signals_fd(void);
 /* Fills the output measuremenet data with last measurements
  */
 int rp_osc_set_meas_data(rp_osc_meas_res_t ch1_meas, rp_osc_meas_res_t ch2_meas);
@@ -105,4 +109,33 @@ int meas_period(rp_osc_meas_res_t *meas, int *in_signal, int wr_ptr_trig, int de
 /* helper function - convert CNT to V for meas. data (min, max, amp, avg) */
 int rp_osc_meas_convert(rp_osc_meas_res_t *ch_meas, float adc_max_v, int32_t cal_dc_offs);
 
+/* Long memory history of the inputs, kept at decimation RP_OSC_HIST_MIN_DEC
+ * and above where the worker keeps up with the FPGA buffer. It spans
+ * RP_OSC_HIST_CAPACITY samples at full resolution, older ones at a quarter
+ * of it for each level further back, and starts over on a change of
+ * decimation or gain. Clients get it through the hist_start & hist_stop
+ * parameters, see rp_get_signals().
+ */
+#define RP_OSC_HIST_MIN_DEC   1024
+#define RP_OSC_HIST_CAPACITY  65536
+#define RP_OSC_HIST_LEVELS    10
+
+/* Returns min, max & mean [V] of channel (0 - Ch1, 1 - Ch2) from t_start
+ * to t_stop [s] before the newest sample (t_start > t_stop >= 0) in *size
+ * points, fewer if there are fewer samples, and the resolution of the
+ * values in t_step [s].
+ * Returns:
+ *  0 - points filled
+ * -1 - no history or the stretch is not kept
+ */
+int rp_osc_get_history(int channel, float t_start, float t_stop,
+                       float *min, float *max, float *mean, int *size,
+                       float *t_step);
+
+/* Returns a stamp of the history that changes whenever the points of
+ * rp_osc_get_history() may: samples were added, the history started over
+ * or the volts changed with the settings.
+ */
+uint64_t rp_osc_get_history_stamp(void);
+
 #endif /* __WORKER_H*/
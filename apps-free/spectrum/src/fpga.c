@@ -17,12 +17,11 @@
 #include <string.h>
 #include <math.h>
 #include <errno.h>
-#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#include <fcntl.h>
 
+#include "regmap.h"
 #include "fpga.h"
 
 /* internals */
@@ -31,8 +30,8 @@ spectr_fpga_reg_mem_t *g_spectr_fpga_reg_mem = NULL;
 uint32_t           *g_spectr_fpga_cha_mem = NULL;
 uint32_t           *g_spectr_fpga_chb_mem = NULL;
 
-/* The memory file descriptor used to mmap() the FPGA space */
-int             g_spectr_fpga_mem_fd = -1;
+/* The mapped FPGA block */
+static regmap_block_t g_spectr_fpga_blk;
 
 /* constants */
 /* ADC format = s.13 */
@@ -55,59 +54,30 @@ double __rp_rand()
 int __spectr_fpga_cleanup_mem(void)
 {
     if(g_spectr_fpga_reg_mem) {
-        if(munmap(g_spectr_fpga_reg_mem, SPECTR_FPGA_BASE_SIZE) < 0) {
-            fprintf(stderr, "munmap() failed: %s\n", strerror(errno));
-            return -1;
-        }
+        regmap_put(&g_spectr_fpga_blk);
         g_spectr_fpga_reg_mem = NULL;
         if(g_spectr_fpga_cha_mem)
             g_spectr_fpga_cha_mem = NULL;
         if(g_spectr_fpga_chb_mem)
             g_spectr_fpga_chb_mem = NULL;
     }
-    if(g_spectr_fpga_mem_fd >= 0) {
-        close(g_spectr_fpga_mem_fd);
-        g_spectr_fpga_mem_fd = -1;
-    }
 
     return 0;
 }
 
 static int get_hw_rev(hw_rev_t *hw_rev)
 {
-    void *page_ptr;
-    long page_addr, page_size = sysconf(_SC_PAGESIZE);
     const long c_hk_fpga_base_addr = 0x40000000;
-    const long c_hk_fpga_base_size = 0x20;
-    int fd = -1;
+    regmap_block_t blk;
 
-    fd = open("/dev/mem", O_RDONLY | O_SYNC);
-    if(fd < 0) {
-        fprintf(stderr, "open(/dev/mem) failed: %s\n", strerror(errno));
+    if(REGMAP_GET(c_hk_fpga_base_addr, hk_fpga_reg_mem_t, &blk) < 0) {
         return -1;
     }
 
-    page_addr = c_hk_fpga_base_addr & (~(page_size-1));
-
-    page_ptr = mmap(NULL, c_hk_fpga_base_size, PROT_READ,
-                          MAP_SHARED, fd, page_addr);
-
-    if((void *)page_ptr == MAP_FAILED) {
-        fprintf(stderr, "mmap() failed: %s\n", strerror(errno));
-        close(fd);
-        return -1;
-    }
-
-    hk_fpga_reg_mem_t *hk = page_ptr;
+    volatile hk_fpga_reg_mem_t *hk = REGMAP_REGS(&blk, hk_fpga_reg_mem_t);
     *hw_rev = hk->rev & HK_FPGA_HW_REV_MASK;
 
-    if(munmap(page_ptr, c_hk_fpga_base_size) < 0) {
-        fprintf(stderr, "munmap() failed: %s\n", strerror(errno));
-        close(fd);
-        return -1;
-    }
-
-    close (fd);
+    regmap_put(&blk);
 
     return 0;
 }
@@ -134,35 +104,19 @@ static int update_hw_spec_par(void)
 
 int spectr_fpga_init(void)
 {
-    void *page_ptr;
-    long page_addr, page_off, page_size = sysconf(_SC_PAGESIZE);
-
     /* update hw specific parmateres */
     if(update_hw_spec_par()<0){
     	return -1;
     }
 
-    /* If maybe needed, cleanup the FD & memory pointer */
+    /* If maybe needed, cleanup the memory pointer */
     if(__spectr_fpga_cleanup_mem() < 0)
         return -1;
 
-    g_spectr_fpga_mem_fd = open("/dev/mem", O_RDWR | O_SYNC);
-    if(g_spectr_fpga_mem_fd < 0) {
-        fprintf(stderr, "open(/dev/mem) failed: %s\n", strerror(errno));
-        return -1;
-    }
-
-    page_addr = SPECTR_FPGA_BASE_ADDR & (~(page_size-1));
-    page_off  = SPECTR_FPGA_BASE_ADDR - page_addr;
-
-    page_ptr = mmap(NULL, SPECTR_FPGA_BASE_SIZE, PROT_READ | PROT_WRITE,
-                          MAP_SHARED, g_spectr_fpga_mem_fd, page_addr);
-    if((void *)page_ptr == MAP_FAILED) {
-        fprintf(stderr, "mmap() failed: %s\n", strerror(errno));
-        __spectr_fpga_cleanup_mem();
+    if(regmap_get(SPECTR_FPGA_BASE_ADDR, SPECTR_FPGA_BASE_SIZE, &g_spectr_fpga_blk) < 0) {
         return -1;
     }
-    g_spectr_fpga_reg_mem = page_ptr + page_off;
+    g_spectr_fpga_reg_mem = (spectr_fpga_reg_mem_t *)g_spectr_fpga_blk.regs;
     g_spectr_fpga_cha_mem = (uint32_t *)g_spectr_fpga_reg_mem + 
         (SPECTR_FPGA_CHA_OFFSET / sizeof(uint32_t));
     g_spectr_fpga_chb_mem = (uint32_t *)g_spectr_fpga_reg_mem + 
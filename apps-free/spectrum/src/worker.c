@@ -24,6 +24,7 @@
 #include <dirent.h>
 
 #include "worker.h"
+#include "kiss_fft_plan.h"
 #include "fpga.h"
 #include "dsp.h"
 #include "waterfall.h"
@@ -160,6 +161,7 @@ int rp_spectr_worker_clean(void)
     rp_cleanup_signals(&rp_tmp_signals);
     rp_spectr_hann_clean();
     rp_spectr_fft_clean();
+    kiss_fft_plan_cleanup();
     rp_spectr_wf_clean();
 
     if(jpg_fname_cha) {
@@ -20,11 +20,10 @@
 #include <math.h>
 #include <stdlib.h>
 #include <limits.h>
-#include <fcntl.h>
  #include <math.h>
 #include "worker.h"
 #include "fpga.h"
-#include <sys/mman.h>
+#include "regmap.h"
 
 
  /** Base Housekeeping address */
@@ -62,54 +61,31 @@ led_control_t *led_struct;
 
 
 void power_led(int l, int fd){
-    led_struct->led_control = pow(2, l);
+    if(led_struct)
+        led_struct->led_control = pow(2, l);
 }
 
 
-int hw_monitor(){
-
-    int fd_control = -1;
-    /* Page variables used to calculate correct mapping addresses for temperature control */
-    char *page_ptr_led, *page_ptr_temp;
-    long page_addr_led, page_addr_temp, page_off_led, page_off_temp, page_size = sysconf(_SC_PAGESIZE);
+/* The mapped housekeeping block holding the LED register */
+static regmap_block_t led_blk;
 
-    /* Open file descriptor */
-    fd_control = open("/dev/mem", O_RDWR | O_SYNC);
+int hw_monitor(){
 
-    /* Error check */
-    if(fd_control < 0) {
-       // cout << " Error opening (/dev/mem)";
+    /* The temperature (AMS) block is not used by the monitor, only the LEDs */
+    if(regmap_get(LED_BASE_ADDR, sizeof(led_control_t), &led_blk) < 0) {
+        led_struct = NULL;
+        return -1;
     }
+    led_struct = (led_control_t *)led_blk.regs;
 
-    /* Led mmap */
-    page_addr_led = LED_BASE_ADDR & (~(page_size-1));
-    page_off_led  = LED_BASE_ADDR - page_addr_led;
-
-    page_ptr_led = (char*)mmap(NULL, LED_BASE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd_control, page_addr_led);
-    page_ptr_led = page_ptr_led + page_off_led;
-
-    char *c_led = (char *)&led_struct;
-    c_led = page_ptr_led;
-
-    led_struct = (led_control_t*)c_led;
-
-    /* Temp mmap */
-    page_addr_temp = TEMP_BASE_ADDR & (~(page_size-1));
-    page_off_temp = TEMP_BASE_ADDR - page_addr_temp;
-
-    page_ptr_temp = (char*)mmap(NULL, TEMP_BASE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd_control, page_addr_temp);
-    page_ptr_temp = page_ptr_temp + page_off_temp;
-
-    return fd_control;
+    return 0;
 }
 
 void destruct_hw_monitor(int tesla_fd){
     if(led_struct){
-        if(munmap(led_struct, LED_BASE_SIZE) < 0){
-            // cout << "munmap failed." << endl;
-         }
-         led_struct = NULL;
-     }
+        regmap_put(&led_blk);
+        led_struct = NULL;
+    }
 }
 
 
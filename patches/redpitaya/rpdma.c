@@ -31,8 +31,13 @@
 #include <linux/sched.h>
 #include <linux/semaphore.h>
 #include <linux/dma-direction.h>
+#include <linux/poll.h>
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
 #include "rpdma.h"
 
+#define TX_BUF_SIZE (TX_SGMNT_CNT*TX_SGMNT_SIZE)
+#define RX_BUF_SIZE (RX_SGMNT_CNT*RX_SGMNT_SIZE)
 
 struct platform_device *rpdev;
 static dev_t dev_num;
@@ -65,14 +70,25 @@ struct rpdma_channel{
     enum dma_data_direction direction;
     wait_queue_head_t wq;
     unsigned long tmo;
+    u32 done; //cyclic segments completed since start
 }rx, tx;
 
+//records of completed rx segments, rx_seq is the number ever completed
+static struct rpdma_event rx_events[RPDMA_EVENT_CNT];
+static u32 rx_seq;
+static DEFINE_SPINLOCK(rx_lock);
+
+//per open file, sequence number of the next record to read
+struct rpdma_reader{
+    u32 seq;
+};
+
 
 // write shall wrte users buffer to dma memory, so that loopback fpga code can write that data to dma buffer 
 static ssize_t rpdma_write(struct file *f, const char __user * buf,size_t len, loff_t * off){
     int j;
     //unsigned char c=0;
-    printk("rpdma: write()\n");
+    pr_debug("rpdma: write()\n");
     for (j=0; j <  tx.segment_size*tx.segment_cnt; j++) {
              tx.addrv[j]=(unsigned char)j%256;
     }
@@ -80,35 +96,110 @@ static ssize_t rpdma_write(struct file *f, const char __user * buf,size_t len, l
 }
 
 //callback
+//called for every completed segment in cyclic mode
 static void rpdma_slave_tx_callback(void *completion)
 {   
-    printk("rpdma:tx complete\n");
+    pr_debug("rpdma:tx complete\n");
     complete(completion);
+    tx.done++;
+    wake_up_interruptible(&tx.wq);
 }
 
-//callback
+//callback, records every completed segment (every period in cyclic mode)
 static void rpdma_slave_rx_callback(void *completion)
 {    
-    printk("rpdma:rx complete\n");
+    struct rpdma_event *ev;
+    unsigned long flags;
+
+    pr_debug("rpdma:rx complete\n");
     complete(completion);
-    rx.flag=1;
+    spin_lock_irqsave(&rx_lock, flags);
+    ev = &rx_events[rx_seq % RPDMA_EVENT_CNT];
+    ev->segment = rx.done % rx.segment_cnt;
+    ev->seq = rx_seq;
+    ev->timestamp = ktime_get_ns();
+    rx_seq++;
+    rx.done++;
+    spin_unlock_irqrestore(&rx_lock, flags);
     wake_up_interruptible(&rx.wq);
 }
 
+//rx (re)started, segments are counted from 0
+static void rpdma_rx_start(void)
+{
+    unsigned long flags;
+
+    spin_lock_irqsave(&rx_lock, flags);
+    rx.done = 0;
+    rx.flag = 0;
+    spin_unlock_irqrestore(&rx_lock, flags);
+}
 
 int rpdma_open(struct inode * i, struct file * f) { 
-    printk("rpdma:open\n");
+    struct rpdma_reader *r;
+    unsigned long flags;
+
+    pr_debug("rpdma:open\n");
+    r = kmalloc(sizeof(*r), GFP_KERNEL);
+    if(!r)
+        return -ENOMEM;
+    spin_lock_irqsave(&rx_lock, flags);
+    r->seq = rx_seq;
+    spin_unlock_irqrestore(&rx_lock, flags);
+    f->private_data = r;
     return 0;
 }
 
-//function blocks its user until rpdma_slave_rx_callback is called by dma engine
-int rpdma_read(struct file *filep, char *buff, size_t len, loff_t *off){
-    
-    printk("rpdma:read wait flag:%d\n",rx.flag);
-    wait_event_interruptible(rx.wq, rx.flag != 0); 
-    rx.flag = 0;
-    printk("rpdma: read go\n");
-    return len;
+static bool rpdma_pending(struct rpdma_reader *r){
+    return READ_ONCE(rx_seq) != r->seq;
+}
+
+//returns as many records of completed rx segments as fit in the buffer,
+//blocks until there is one unless O_NONBLOCK, 0 once rx is stopped
+static ssize_t rpdma_read(struct file *f, char __user *buf, size_t len, loff_t *off){
+    struct rpdma_reader *r = f->private_data;
+    struct rpdma_event ev;
+    unsigned long flags;
+    size_t n = 0;
+
+    if(len < sizeof(ev))
+        return -EINVAL;
+    if(!(f->f_flags & O_NONBLOCK)){
+        if(wait_event_interruptible(rx.wq, rpdma_pending(r) || rx.flag))
+            return -ERESTARTSYS;
+    }
+    while(n + sizeof(ev) <= len){
+        spin_lock_irqsave(&rx_lock, flags);
+        if(r->seq == rx_seq){
+            spin_unlock_irqrestore(&rx_lock, flags);
+            break;
+        }
+        //the oldest records are overwritten, the reader sees a gap in seq
+        if(rx_seq - r->seq > RPDMA_EVENT_CNT)
+            r->seq = rx_seq - RPDMA_EVENT_CNT;
+        ev = rx_events[r->seq % RPDMA_EVENT_CNT];
+        r->seq++;
+        spin_unlock_irqrestore(&rx_lock, flags);
+        if(copy_to_user(buf + n, &ev, sizeof(ev)))
+            return -EFAULT;
+        n += sizeof(ev);
+    }
+    if(n == 0 && !rx.flag)
+        return -EAGAIN;
+    pr_debug("rpdma:read %d records\n", (int)(n / sizeof(ev)));
+    return n;
+}
+
+static unsigned int rpdma_poll(struct file *f, poll_table *wait){
+    struct rpdma_reader *r = f->private_data;
+    unsigned int mask = 0;
+
+    poll_wait(f, &rx.wq, wait);
+    if(rpdma_pending(r))
+        mask |= POLLIN | POLLRDNORM;
+    if(rx.flag)
+        mask |= POLLHUP;
+    return mask;
 }
 
 //function to start and stop dma transfers
@@ -117,70 +208,76 @@ static long rpdma_ioctl(struct file *file, unsigned int cmd , unsigned long arg)
         rx.tmo = msecs_to_jiffies(3000000); 
         tx.tmo = msecs_to_jiffies(2000000);
         smp_rmb();
-        printk("rpdma:ioctl cmd:%d arg%d\n",cmd,(int)arg);
+        if(cmd!=WAIT_TX_SGMNT)
+            pr_debug("rpdma:ioctl cmd:%d arg%d\n",cmd,(int)arg);
     switch(cmd){
     case STOP_TX:{
-        printk("rpdma:ioctl terminate all tx\n");
+        pr_debug("rpdma:ioctl terminate all tx\n");
         dmaengine_terminate_all(tx.chan); 
+        tx.flag = 1;
+        wake_up_interruptible(&tx.wq);
       }break;  
     case STOP_RX:{
-        printk("rpdma:ioctl terminate all rx\n");
+        pr_debug("rpdma:ioctl terminate all rx\n");
         dmaengine_terminate_all(rx.chan); 
         rx.flag = 1;
         wake_up_interruptible(&rx.wq);
    } break;
     case CYCLIC_TX:{    
-        printk("rpdma:ioctl cyclic tx s:%d c:%d\n", tx.segment_size,tx.segment_cnt );smp_rmb();
+        pr_debug("rpdma:ioctl cyclic tx s:%d c:%d\n", tx.segment_size,tx.segment_cnt );smp_rmb();
         tx.d = tx.chan->device->device_prep_dma_cyclic(tx.chan, tx.addrp, tx.segment_size*tx.segment_cnt, tx.segment_size, DMA_MEM_TO_DEV, DMA_CTRL_ACK | DMA_PREP_INTERRUPT);
-        if(!tx.d){printk("rpdma: txd not set properly\n");}
+        if(!tx.d){pr_err("rpdma: txd not set properly\n");}
         else{
             init_completion(&tx.cmp);
             tx.d->callback = rpdma_slave_tx_callback; //set up completition callback
             tx.d->callback_param = &tx.cmp;
             tx.cookie = tx.d->tx_submit(tx.d);    
-            printk("rpdma: tx submit\n"); 
+            pr_debug("rpdma: tx submit\n"); 
             if (dma_submit_error(tx.cookie)) {
-                printk("rpdma tx submit error %d \n", tx.cookie);
+                pr_err("rpdma tx submit error %d \n", tx.cookie);
             }
+            tx.done = 0;
+            tx.flag = 0;
             dma_async_issue_pending(tx.chan);
         }
       } break;
  
     case CYCLIC_RX://rx prepair
     {   
-            printk("rpdma:ioctl cyclic rx s:%d c:%d\n",rx.segment_size,rx.segment_cnt);
+            pr_debug("rpdma:ioctl cyclic rx s:%d c:%d\n",rx.segment_size,rx.segment_cnt);
 smp_rmb();
         rx.d = rx.dev->device_prep_dma_cyclic(rx.chan,rx.addrp, rx.segment_size*rx.segment_cnt, rx.segment_size,DMA_DEV_TO_MEM, DMA_CTRL_ACK | DMA_PREP_INTERRUPT);
-        if(!rx.d){printk("rpdma:rxd not set properly\n");}
+        if(!rx.d){pr_err("rpdma:rxd not set properly\n");}
         else{
         init_completion(&rx.cmp);
         rx.d->callback = rpdma_slave_rx_callback; //set completion callback
         rx.d->callback_param = &rx.cmp;
         rx.cookie = rx.d->tx_submit(rx.d);    
-        printk("rpdma:rx_submit\n");
+        pr_debug("rpdma:rx_submit\n");
             
         if(dma_submit_error(rx.cookie)){
-            printk("rpdma rx submit error %d \n", rx.cookie);
+            pr_err("rpdma rx submit error %d \n", rx.cookie);
         }
-        rx.flag=0;
+        rpdma_rx_start();
         dma_async_issue_pending(rx.chan);
 
     }
     }break;
    case SINGLE_RX:{
-        printk("rpdma:rx single dma s:%d c:%d\n",rx.segment_size,rx.segment_cnt);smp_rmb();
+        pr_debug("rpdma:rx single dma s:%d c:%d\n",rx.segment_size,rx.segment_cnt);smp_rmb();
         
         rx.d = dmaengine_prep_slave_single(rx.chan,rx.addrp, rx.segment_size*rx.segment_cnt, DMA_DEV_TO_MEM, DMA_CTRL_ACK | DMA_PREP_INTERRUPT);
-        if(!rx.d){printk("rpdma:rxd not set properly\n");}
+        if(!rx.d){pr_err("rpdma:rxd not set properly\n");}
         else{
             init_completion(&rx.cmp);
             rx.d->callback = rpdma_slave_rx_callback;
             rx.d->callback_param = &rx.cmp;
             rx.cookie = rx.d->tx_submit(rx.d);
-            printk("rpdma:rx submit \n");
+            pr_debug("rpdma:rx submit \n");
         }
 
-        printk("rpdma:rx dma_async_issue_pending \n");
+        pr_debug("rpdma:rx dma_async_issue_pending \n");
+        rpdma_rx_start();
         dma_async_issue_pending(rx.chan);    
 
         
@@ -188,20 +285,20 @@ smp_rmb();
     break;
     }
     case SINGLE_TX:{
-        printk("rpdma:tx single dma s:%d c:%d\n", tx.segment_size,tx.segment_cnt );
+        pr_debug("rpdma:tx single dma s:%d c:%d\n", tx.segment_size,tx.segment_cnt );
         smp_rmb();
         
         tx.d = dmaengine_prep_slave_single(tx.chan, tx.addrp, tx.segment_size*tx.segment_cnt, DMA_MEM_TO_DEV, DMA_CTRL_ACK | DMA_PREP_INTERRUPT);
-        if(!tx.d){printk("rpdma: txd not set properly\n");}
+        if(!tx.d){pr_err("rpdma: txd not set properly\n");}
         else{
             init_completion(&tx.cmp);
             tx.d->callback = rpdma_slave_tx_callback;
             tx.d->callback_param = &tx.cmp;
             tx.cookie = tx.d->tx_submit(tx.d);
-            printk("rpdma:tx submit \n");
+            pr_debug("rpdma:tx submit \n");
         }
         
-        printk("rpdma:tx dma_async_issue_pending \n");
+        pr_debug("rpdma:tx dma_async_issue_pending \n");
         dma_async_issue_pending(tx.chan);
 
         
@@ -209,38 +306,39 @@ smp_rmb();
     }
     
         case SIMPLE_RX:{
-        printk("rpdma:rx single dma s:%d c:%d\n",rx.segment_size,rx.segment_cnt);smp_rmb();
+        pr_debug("rpdma:rx single dma s:%d c:%d\n",rx.segment_size,rx.segment_cnt);smp_rmb();
         
         rx.d = dmaengine_prep_slave_single(rx.chan,rx.addrp, rx.segment_size*rx.segment_cnt, DMA_DEV_TO_MEM, DMA_CTRL_ACK | DMA_PREP_INTERRUPT);
-        if(!rx.d){printk("rpdma:rxd not set properly\n");}
+        if(!rx.d){pr_err("rpdma:rxd not set properly\n");}
         else{
             init_completion(&rx.cmp);
             rx.d->callback = rpdma_slave_rx_callback;
             rx.d->callback_param = &rx.cmp;
             rx.cookie = rx.d->tx_submit(rx.d);
-            printk("rpdma:rx submit \n");
+            pr_debug("rpdma:rx submit \n");
         }
         
 
-        printk("rpdma:rx dma_async_issue_pending \n");
+        pr_debug("rpdma:rx dma_async_issue_pending \n");
+        rpdma_rx_start();
         dma_async_issue_pending(rx.chan);    
         rx.tmo = wait_for_completion_timeout(&rx.cmp, rx.tmo);
             
     break;
     }
     case SIMPLE_TX:{
-        printk("rpdma:tx single dma s:%d c:%d\n", tx.segment_size,tx.segment_cnt );smp_rmb();
+        pr_debug("rpdma:tx single dma s:%d c:%d\n", tx.segment_size,tx.segment_cnt );smp_rmb();
         tx.d = dmaengine_prep_slave_single(tx.chan, tx.addrp, tx.segment_size*tx.segment_cnt, DMA_MEM_TO_DEV, DMA_CTRL_ACK | DMA_PREP_INTERRUPT);
-        if(!tx.d){printk("rpdma: txd not set properly\n");}
+        if(!tx.d){pr_err("rpdma: txd not set properly\n");}
         else{
             init_completion(&tx.cmp);
             tx.d->callback = rpdma_slave_tx_callback;
             tx.d->callback_param = &tx.cmp;
             tx.cookie = tx.d->tx_submit(tx.d);
-            printk("rpdma:tx submit \n");
+            pr_debug("rpdma:tx submit \n");
         }
         
-        printk("rpdma:tx dma_async_issue_pending \n");
+        pr_debug("rpdma:tx dma_async_issue_pending \n");
         dma_async_issue_pending(tx.chan);
         
         tx.tmo = wait_for_completion_timeout(&tx.cmp, tx.tmo);
@@ -249,33 +347,34 @@ smp_rmb();
     break;
     }
     case SIMPLE:{
-        printk("rpdma:tx single dma \n");
+        pr_debug("rpdma:tx single dma \n");
         smp_rmb();
         tx.d = dmaengine_prep_slave_single(tx.chan, tx.addrp, tx.segment_size*tx.segment_cnt, DMA_MEM_TO_DEV, DMA_CTRL_ACK | DMA_PREP_INTERRUPT);
-        if(!tx.d){printk("rpdma: txd not set properly\n");}
+        if(!tx.d){pr_err("rpdma: txd not set properly\n");}
         else{
             init_completion(&tx.cmp);
             tx.d->callback = rpdma_slave_tx_callback;
             tx.d->callback_param = &tx.cmp;
             tx.cookie = tx.d->tx_submit(tx.d);
-            printk("rpdma:tx submit \n");
+            pr_debug("rpdma:tx submit \n");
         }
         
-        printk("rpdma:rx single dma \n");
+        pr_debug("rpdma:rx single dma \n");
         
         rx.d = dmaengine_prep_slave_single(rx.chan,rx.addrp, rx.segment_size*rx.segment_cnt, DMA_DEV_TO_MEM, DMA_CTRL_ACK | DMA_PREP_INTERRUPT);
-        if(!rx.d){printk("rpdma:rxd not set properly\n");}
+        if(!rx.d){pr_err("rpdma:rxd not set properly\n");}
         else{
             init_completion(&rx.cmp);
             rx.d->callback = rpdma_slave_rx_callback;
             rx.d->callback_param = &rx.cmp;
             rx.cookie = rx.d->tx_submit(rx.d);
-            printk("rpdma:rx submit \n");
+            pr_debug("rpdma:rx submit \n");
         }
         
-        printk("rpdma:rx dma_async_issue_pending \n");
+        pr_debug("rpdma:rx dma_async_issue_pending \n");
+        rpdma_rx_start();
         dma_async_issue_pending(rx.chan);  
-        printk("rpdma:tx dma_async_issue_pending \n");
+        pr_debug("rpdma:tx dma_async_issue_pending \n");
         dma_async_issue_pending(tx.chan);
   
         tx.tmo = wait_for_completion_timeout(&tx.cmp, tx.tmo);
@@ -288,21 +387,34 @@ smp_rmb();
     }
     
     case SET_TX_SGMNT_CNT:{
-        printk("rpdma:ioctl tx segment cnt set to %lx \n",arg);
+        pr_debug("rpdma:ioctl tx segment cnt set to %lx \n",arg);
+        //segments must fit in the buffer with the current size
+        if(arg == 0 || arg > TX_BUF_SIZE / tx.segment_size)
+            return -EINVAL;
         tx.segment_cnt=arg;
     }break;  
     case SET_TX_SGMNT_SIZE :{
-        printk("rpdma:ioctl tx segment size set to %lx \n",arg);
+        pr_debug("rpdma:ioctl tx segment size set to %lx \n",arg);
+        if(arg == 0 || arg > TX_BUF_SIZE / tx.segment_cnt)
+            return -EINVAL;
         tx.segment_size=arg;
    }break;
     case SET_RX_SGMNT_CNT:{
-        printk("rpdma:ioctl rx segment cnt set to %lx \n",arg);
+        pr_debug("rpdma:ioctl rx segment cnt set to %lx \n",arg);
         rx.segment_cnt=arg;
    }break;
     case SET_RX_SGMNT_SIZE:{
-        printk("rpdma:ioctl rx segment size set to %lx \n",arg);
+        pr_debug("rpdma:ioctl rx segment size set to %lx \n",arg);
         rx.segment_size=arg;
     }break;  
+    case WAIT_TX_SGMNT:{
+        u32 seen;
+        if(get_user(seen, (u32 __user *)arg))
+            return -EFAULT;
+        wait_event_interruptible_timeout(tx.wq, tx.done != seen || tx.flag, HZ);
+        if(put_user(tx.done, (u32 __user *)arg))
+            return -EFAULT;
+    }break;
               
     }
     return 0;
@@ -319,20 +431,27 @@ static int rpdma_release(struct inode *ino, struct file *file)
 //        dma_unmap_single(rx.dev->dev, rx.segment, rx.segment_size*rx.segment_cnt, DMA_FROM_DEVICE);
     //rx.flag=1;
     //wake_up_interruptible(&rx.wq);
-    printk("rpdma:release\n");
+    pr_debug("rpdma:release\n");
+    kfree(file->private_data);
     return 0;
 }
 
 
-//mmaps receiver buffer to userspace
+//mmaps receiver buffer to userspace, or the transmitter one at TX_MMAP_OFFSET;
+//mappings beyond the buffer are refused
 static int rpdma_mmap(struct file * f, struct vm_area_struct * v){
-    printk("rpdma:mmap\n");
-    return dma_common_mmap(&rpdev->dev, v, rx.addrv, rx.addrp,v->vm_end - v->vm_start);    
+    pr_debug("rpdma:mmap\n");
+    if(v->vm_pgoff == (TX_MMAP_OFFSET >> PAGE_SHIFT)){
+        v->vm_pgoff = 0;
+        return dma_common_mmap(&rpdev->dev, v, tx.addrv, tx.addrp, TX_BUF_SIZE);
+    }
+    return dma_common_mmap(&rpdev->dev, v, rx.addrv, rx.addrp, RX_BUF_SIZE);
 }
 
 static struct file_operations fops = {
     .owner    = THIS_MODULE,
-    .read = rpdma_read, //it shall inform user of data availibility using blocking read
+    .read = rpdma_read, //records of completed segments, blocking unless O_NONBLOCK
+    .poll = rpdma_poll, //POLLIN while records are pending, POLLHUP once rx is stopped
     .open     = rpdma_open, 
     .release  = rpdma_release, //dealocation of dma buffers
     .unlocked_ioctl = rpdma_ioctl, //start stop functionality per channel
@@ -399,8 +518,10 @@ static int rpdma_probe(struct platform_device *pdev)
     tx.segment_size=TX_SGMNT_SIZE;
     rx.segment_cnt=RX_SGMNT_CNT;
     rx.segment_size=RX_SGMNT_SIZE;
-    rx.flag=0;
+    rx.flag=1;
     init_waitqueue_head(&rx.wq);
+    tx.flag=1;
+    init_waitqueue_head(&tx.wq);
     return 0;
     
 rmdev:
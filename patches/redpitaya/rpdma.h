@@ -15,6 +15,8 @@
 #ifndef __RPDMA_H
 #define __RPDMA_H
 
+#include <linux/types.h>
+
 
 /*
 ioctl macro definitions
@@ -29,6 +31,10 @@ ioctl macro definitions
 #define SIMPLE_TX 17  //blocking until complete
 #define SIMPLE 12 //blocking until complete
 #define STATUS 20
+/* arg points to a uint32_t holding the number of TX segments the caller has
+ * seen completed; blocks until the count differs, TX is stopped or 1 s
+ * passed, and returns the current count there */
+#define WAIT_TX_SGMNT 21
 
 #define STATUS_STOPPED 0
 #define STATUS_READY 1
@@ -40,6 +46,22 @@ ioctl macro definitions
 #define SET_RX_SGMNT_CNT 16
 #define SET_RX_SGMNT_SIZE 15
 
+/*
+ * read() returns a record per completed RX segment, as many whole records as
+ * fit in the buffer. It blocks for the first one unless the file is
+ * O_NONBLOCK (-EAGAIN then) and returns 0 once RX is stopped and every record
+ * is read. poll() reports POLLIN while records are pending and POLLHUP while
+ * RX is stopped. The driver keeps the last RPDMA_EVENT_CNT records, a slower
+ * reader sees the lost ones as a gap in seq.
+ */
+struct rpdma_event {
+    __u32 segment;    // index of the segment in the buffer
+    __u32 seq;        // completed segments since the driver was loaded
+    __u64 timestamp;  // completion time, CLOCK_MONOTONIC [ns]
+};
+
+#define RPDMA_EVENT_CNT 64
+
 /*
  * SGMNT_CNT*SGMNT_SIZE should never be larger than second reg argument
  * in DT
@@ -52,7 +74,10 @@ ioctl macro definitions
 #define SGMNT_SIZE 4*1024*1024
 #define RX_SGMNT_CNT SGMNT_CNT
 #define RX_SGMNT_SIZE SGMNT_SIZE
-#define TX_SGMNT_CNT 0
-#define TX_SGMNT_SIZE SGMNT_SIZE
+#define TX_SGMNT_CNT 8
+#define TX_SGMNT_SIZE (256*1024)
+
+/* mmap offset of the TX buffer, offset 0 maps the RX buffer */
+#define TX_MMAP_OFFSET (RX_SGMNT_CNT*RX_SGMNT_SIZE)
 
 #endif // __RPDMA_H
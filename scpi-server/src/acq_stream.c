@@ -0,0 +1,254 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya Scpi server acquisition streaming implementation
+ *
+ * While streaming, a thread of the connection rearms the acquisition,
+ * waits for the trigger and pushes the trigger window to the client as a
+ * frame (acq_stream_hdr_t). The frames and the command replies share the
+ * socket, the parser holds the output lock while executing a command, so a
+ * frame never splits a reply.
+ *
+ * A window is dropped, not queued, while the previous frame is still in
+ * the socket send queue; the sequence numbers of the frames show the gap
+ * and their dropped counter its length.
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <syslog.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/sockios.h>
+
+#include "acq_stream.h"
+
+#define ACQ_STREAM_CHANNELS 2
+
+static struct {
+    pthread_mutex_t   mutex;     /* output of the connection */
+    pthread_t         thread;
+    volatile bool     run;
+    bool              started;
+    int               fd;
+    bool              raw;
+    rp_acq_trig_src_t source;
+    uint8_t          *frame;     /* block prefix, header and samples */
+    size_t            frame_len;
+    acq_stream_hdr_t *hdr;
+    uint32_t          seq;
+    volatile uint32_t frames;
+    volatile uint32_t dropped;
+} stream = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+
+static uint64_t acq_stream_Now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Output lock for the stream thread. Gives up once the stream is stopped,
+ * the stop may come from a command holding the lock. */
+static bool acq_stream_LockRunning() {
+    struct timespec ts;
+
+    while (stream.run) {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += 10000000;
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        if (pthread_mutex_timedlock(&stream.mutex, &ts) == 0) {
+            if (stream.run) {
+                return true;
+            }
+            pthread_mutex_unlock(&stream.mutex);
+        }
+    }
+    return false;
+}
+
+/* True if the previous frame has left the send queue */
+static bool acq_stream_Room() {
+    int queued;
+
+    if (ioctl(stream.fd, SIOCOUTQ, &queued) < 0) {
+        return true;
+    }
+    return (size_t)queued < stream.frame_len;
+}
+
+static int acq_stream_Send() {
+    size_t total = 0;
+
+    while (total < stream.frame_len) {
+        ssize_t n = send(stream.fd, stream.frame + total, stream.frame_len - total, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        total += n;
+    }
+    return 0;
+}
+
+/* Reads out the window of the last trigger and sends it, the output lock
+ * is held */
+static void acq_stream_Window(uint64_t timestamp) {
+    acq_stream_hdr_t *hdr = stream.hdr;
+    uint32_t wp, tp, size;
+
+    RP_PERF_BEGIN(t);
+    hdr->seq = stream.seq++;
+    hdr->timestamp = timestamp;
+    if (!acq_stream_Room()) {
+        stream.dropped++;
+        return;
+    }
+
+    rp_AcqGetWritePointer(&wp);
+    rp_AcqGetWritePointerAtTrig(&tp);
+    rp_AcqGetDecimationFactor(&hdr->decimation);
+    hdr->trig_idx = (tp + ADC_BUFFER_SIZE - (wp + 1) % ADC_BUFFER_SIZE) % ADC_BUFFER_SIZE;
+    hdr->dropped = stream.dropped;
+
+    uint8_t *data = (uint8_t *)(hdr + 1);
+    for (rp_channel_t ch = RP_CH_1; ch < ACQ_STREAM_CHANNELS; ch++) {
+        size = ADC_BUFFER_SIZE;
+        if (stream.raw) {
+            rp_AcqGetOldestDataRaw(ch, &size, (int16_t *)data);
+            data += ADC_BUFFER_SIZE * sizeof(int16_t);
+        } else {
+            rp_AcqGetOldestDataV(ch, &size, (float *)data);
+            data += ADC_BUFFER_SIZE * sizeof(float);
+        }
+    }
+
+    if (acq_stream_Send() < 0) {
+        syslog(LOG_ERR, "*ACQ:DATA:STREAM Failed to send frame: %s, stopping.\n", strerror(errno));
+        stream.run = false;
+        return;
+    }
+    stream.frames++;
+    RP_PERF_END(RP_PERF_SCPI_DATA, t);
+    RP_PERF_END(RP_PERF_SCPI_TRIG, rp_PerfGetTrigger());
+}
+
+static void *acq_stream_Thread(void *arg) {
+    rp_acq_trig_state_t state;
+
+    while (acq_stream_LockRunning()) {
+        rp_AcqStart();
+        rp_AcqSetTriggerSrc(stream.source);
+        pthread_mutex_unlock(&stream.mutex);
+
+        state = RP_TRIG_STATE_WAITING;
+        while (stream.run && state != RP_TRIG_STATE_TRIGGERED) {
+            if (rp_AcqGetTriggerState(&state) != RP_OK) {
+                syslog(LOG_ERR, "*ACQ:DATA:STREAM Failed to get trigger state, stopping.\n");
+                stream.run = false;
+                break;
+            }
+            if (state != RP_TRIG_STATE_TRIGGERED) {
+                usleep(ACQ_STREAM_POLL_US);
+            }
+        }
+        uint64_t timestamp = acq_stream_Now();
+
+        if (!acq_stream_LockRunning()) {
+            break;
+        }
+        acq_stream_Window(timestamp);
+        pthread_mutex_unlock(&stream.mutex);
+    }
+    return NULL;
+}
+
+int acq_stream_Start(int fd, bool raw, rp_acq_trig_src_t source) {
+    acq_stream_Stop();
+
+    size_t sample = raw ? sizeof(int16_t) : sizeof(float);
+    size_t payload = sizeof(acq_stream_hdr_t) + ACQ_STREAM_CHANNELS * ADC_BUFFER_SIZE * sample;
+    char prefix[32];
+    int digits = snprintf(prefix, sizeof(prefix), "%zu", payload);
+    int prefix_len = snprintf(prefix, sizeof(prefix), "#%d%zu", digits, payload);
+
+    stream.frame = malloc(prefix_len + payload);
+    if (stream.frame == NULL) {
+        return -1;
+    }
+    memcpy(stream.frame, prefix, prefix_len);
+    stream.frame_len = prefix_len + payload;
+
+    stream.hdr = (acq_stream_hdr_t *)(stream.frame + prefix_len);
+    memset(stream.hdr, 0, sizeof(acq_stream_hdr_t));
+    stream.hdr->magic      = ACQ_STREAM_MAGIC;
+    stream.hdr->version    = ACQ_STREAM_VERSION;
+    stream.hdr->header_len = sizeof(acq_stream_hdr_t);
+    stream.hdr->channels   = ACQ_STREAM_CHANNELS;
+    stream.hdr->format     = raw ? ACQ_STREAM_I16 : ACQ_STREAM_F32;
+    stream.hdr->samples    = ADC_BUFFER_SIZE;
+
+    stream.fd      = fd;
+    stream.raw     = raw;
+    stream.source  = source == RP_TRIG_SRC_DISABLED ? RP_TRIG_SRC_NOW : source;
+    stream.seq     = 0;
+    stream.frames  = 0;
+    stream.dropped = 0;
+    stream.run     = true;
+
+    if (pthread_create(&stream.thread, NULL, acq_stream_Thread, NULL) != 0) {
+        stream.run = false;
+        free(stream.frame);
+        stream.frame = NULL;
+        return -1;
+    }
+    stream.started = true;
+    return 0;
+}
+
+int acq_stream_Stop() {
+    if (!stream.started) {
+        return 0;
+    }
+    stream.run = false;
+    pthread_join(stream.thread, NULL);
+    stream.started = false;
+    free(stream.frame);
+    stream.frame = NULL;
+    return 0;
+}
+
+bool acq_stream_IsRunning() {
+    return stream.run;
+}
+
+void acq_stream_GetStat(uint32_t *frames, uint32_t *dropped) {
+    *frames = stream.frames;
+    *dropped = stream.dropped;
+}
+
+void acq_stream_Lock() {
+    pthread_mutex_lock(&stream.mutex);
+}
+
+void acq_stream_Unlock() {
+    pthread_mutex_unlock(&stream.mutex);
+}
@@ -0,0 +1,60 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya Scpi server acquisition streaming interface
+ *
+ * @Author Red Pitaya
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef ACQ_STREAM_H_
+#define ACQ_STREAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "redpitaya/rp.h"
+
+#define ACQ_STREAM_MAGIC    0x53415052  // "RPAS"
+#define ACQ_STREAM_VERSION  1
+
+#define ACQ_STREAM_F32      0           // samples in volts, float
+#define ACQ_STREAM_I16      1           // samples in raw counts, int16_t
+
+/* Trigger status poll period */
+#define ACQ_STREAM_POLL_US  100
+
+/**
+ * Frame of one trigger window, little endian. It is sent as a SCPI definite
+ * length block #<n><length><header><samples>, the samples of channel 1
+ * followed by the ones of channel 2, the oldest first.
+ */
+typedef struct {
+    uint32_t magic;      // ACQ_STREAM_MAGIC
+    uint16_t version;    // ACQ_STREAM_VERSION
+    uint16_t header_len; // bytes of this header, the samples follow
+    uint32_t seq;        // window number since the stream start, a gap
+                         // are windows dropped
+    uint32_t dropped;    // windows dropped since the stream start
+    uint64_t timestamp;  // trigger seen, CLOCK_MONOTONIC in ns
+    uint32_t decimation; // decimation factor
+    uint32_t trig_idx;   // trigger sample in the window
+    uint16_t channels;   // channels in the frame
+    uint16_t format;     // ACQ_STREAM_F32 or ACQ_STREAM_I16
+    uint32_t samples;    // samples per channel
+} acq_stream_hdr_t;
+
+int  acq_stream_Start(int fd, bool raw, rp_acq_trig_src_t source);
+int  acq_stream_Stop();
+bool acq_stream_IsRunning();
+void acq_stream_GetStat(uint32_t *frames, uint32_t *dropped);
+
+void acq_stream_Lock();
+void acq_stream_Unlock();
+
+#endif /* ACQ_STREAM_H_ */
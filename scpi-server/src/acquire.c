@@ -17,6 +17,7 @@
 #include <string.h>
 
 #include "acquire.h"
+#include "acq_stream.h"
 #include "common.h"
 
 #include "scpi/parser.h"
@@ -610,7 +611,8 @@ scpi_result_t RP_AcqScpiDataUnitsQ(scpi_t *context){
 }
 
 scpi_result_t RP_AcqDataPosQ(scpi_t *context) {
-    
+    RP_PERF_BEGIN(t);
+
     uint32_t start, end;
     int result;
 
@@ -655,11 +657,15 @@ scpi_result_t RP_AcqDataPosQ(scpi_t *context) {
         SCPI_ResultBufferInt16(context, buffer, size);
     }
 
+    RP_PERF_END(RP_PERF_SCPI_DATA, t);
+    RP_PERF_END(RP_PERF_SCPI_TRIG, rp_PerfGetTrigger());
+
     RP_LOG(LOG_INFO, "*ACQ:SOUR#:DATA:STA:END? Successfully returned data to client.\n");
     return SCPI_RES_OK;
 }
 
 scpi_result_t RP_AcqDataQ(scpi_t *context) {
+    RP_PERF_BEGIN(t);
 
     uint32_t start, size;
     int result;
@@ -707,12 +713,16 @@ scpi_result_t RP_AcqDataQ(scpi_t *context) {
         SCPI_ResultBufferInt16(context, buffer, size);
     }
 
+    RP_PERF_END(RP_PERF_SCPI_DATA, t);
+    RP_PERF_END(RP_PERF_SCPI_TRIG, rp_PerfGetTrigger());
+
     RP_LOG(LOG_INFO, "*ACQ:SOUR<n>:DATA:STA:N? Successfully returned data.\n");
     return SCPI_RES_OK;
 }
 
 scpi_result_t RP_AcqDataOldestAllQ(scpi_t *context) {
-    
+    RP_PERF_BEGIN(t);
+
     uint32_t size;
     int result;
 
@@ -745,12 +755,16 @@ scpi_result_t RP_AcqDataOldestAllQ(scpi_t *context) {
         SCPI_ResultBufferInt16(context, buffer, size);
     }
 
+    RP_PERF_END(RP_PERF_SCPI_DATA, t);
+    RP_PERF_END(RP_PERF_SCPI_TRIG, rp_PerfGetTrigger());
+
     RP_LOG(LOG_INFO, "*ACQ:SOUR#:DATA? Successfully returned data.\n");
     return SCPI_RES_OK;
 }
 
 scpi_result_t RP_AcqOldestDataQ(scpi_t *context) {
-    
+    RP_PERF_BEGIN(t);
+
     uint32_t size;
     int result;
 
@@ -789,12 +803,16 @@ scpi_result_t RP_AcqOldestDataQ(scpi_t *context) {
         SCPI_ResultBufferInt16(context, buffer, size);
     }
 
+    RP_PERF_END(RP_PERF_SCPI_DATA, t);
+    RP_PERF_END(RP_PERF_SCPI_TRIG, rp_PerfGetTrigger());
+
     RP_LOG(LOG_INFO, "*ACQ:SOUR#:DATA:OLD:N? Successfully returned data to client.");
     return SCPI_RES_OK;
 }
 
 scpi_result_t RP_AcqLatestDataQ(scpi_t *context) {
-    
+    RP_PERF_BEGIN(t);
+
     uint32_t size;
     int result;
 
@@ -832,6 +850,9 @@ scpi_result_t RP_AcqLatestDataQ(scpi_t *context) {
         SCPI_ResultBufferInt16(context, buffer, size);
     }
 
+    RP_PERF_END(RP_PERF_SCPI_DATA, t);
+    RP_PERF_END(RP_PERF_SCPI_TRIG, rp_PerfGetTrigger());
+
     RP_LOG(LOG_INFO, "*ACQ:SOUR<n>:DATA:LAT:N? Successfully returned data to client.\n");
     return SCPI_RES_OK;
 }
@@ -850,3 +871,57 @@ scpi_result_t RP_AcqBufferSizeQ(scpi_t *context) {
     RP_LOG(LOG_INFO, "*ACQ:BUF:SIZE?? Successfully returned buffer size.\n");
     return SCPI_RES_OK;
 }
+
+scpi_result_t RP_AcqDataStream(scpi_t *context) {
+    scpi_bool_t value;
+    rp_acq_trig_src_t source;
+
+    if (!SCPI_ParamBool(context, &value, true)) {
+        RP_LOG(LOG_ERR, "*ACQ:DATA:STREAM is missing first parameter.\n");
+        return SCPI_RES_ERR;
+    }
+
+    if (!value) {
+        acq_stream_Stop();
+        RP_LOG(LOG_INFO, "*ACQ:DATA:STREAM Successfully stopped streaming.\n");
+        return SCPI_RES_OK;
+    }
+
+    if (context->user_context == NULL) {
+        RP_LOG(LOG_ERR, "*ACQ:DATA:STREAM No client connection.\n");
+        return SCPI_RES_ERR;
+    }
+
+    // Stream with the trigger source set by ACQ:TRIG, free running if none
+    int result = rp_AcqGetTriggerSrc(&source);
+    if (RP_OK != result) {
+        RP_LOG(LOG_ERR, "*ACQ:DATA:STREAM Failed to get trigger source: %s\n", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    if (acq_stream_Start(*(int *)context->user_context, unit == RP_SCPI_RAW, source) != 0) {
+        RP_LOG(LOG_ERR, "*ACQ:DATA:STREAM Failed to start streaming.\n");
+        return SCPI_RES_ERR;
+    }
+
+    RP_LOG(LOG_INFO, "*ACQ:DATA:STREAM Successfully started streaming.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqDataStreamQ(scpi_t *context) {
+    SCPI_ResultMnemonic(context, acq_stream_IsRunning() ? "ON" : "OFF");
+
+    RP_LOG(LOG_INFO, "*ACQ:DATA:STREAM? Successfully returned streaming state.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AcqDataStreamStatQ(scpi_t *context) {
+    uint32_t frames, dropped;
+
+    acq_stream_GetStat(&frames, &dropped);
+    SCPI_ResultUInt32Base(context, frames, 10);
+    SCPI_ResultUInt32Base(context, dropped, 10);
+
+    RP_LOG(LOG_INFO, "*ACQ:DATA:STREAM:STAT? Successfully returned streaming statistics.\n");
+    return SCPI_RES_OK;
+}
@@ -57,6 +57,9 @@ scpi_result_t RP_AcqDataOldestAllQ(scpi_t * context);
 scpi_result_t RP_AcqOldestDataQ(scpi_t *context);
 scpi_result_t RP_AcqLatestDataQ(scpi_t *context);
 scpi_result_t RP_AcqBufferSizeQ(scpi_t * context);
+scpi_result_t RP_AcqDataStream(scpi_t * context);
+scpi_result_t RP_AcqDataStreamQ(scpi_t * context);
+scpi_result_t RP_AcqDataStreamStatQ(scpi_t * context);
 
 scpi_result_t RP_AcqGetLatestData(rp_channel_t channel, scpi_t * context);
 
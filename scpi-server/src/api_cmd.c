@@ -92,6 +92,9 @@ scpi_result_t RP_FpgaBitStream(scpi_t *context){
     fpga_file[fpga_dir_s - 1] = '\0';
     
 
+    /* Web server tracks the loaded image, it has to reload it next time */
+    unlink("/tmp/rp_fpga_loaded");
+
     /* Load new fpga image into /dev/xdevcfg */
     fo = open("/dev/xdevcfg", O_WRONLY);
     if(fo < 0){
@@ -146,3 +149,65 @@ scpi_result_t RP_EnableDigLoop(scpi_t *context){
 
     return SCPI_RES_OK;
 }
+
+scpi_result_t RP_SystemPerf(scpi_t *context){
+
+    scpi_bool_t enable;
+
+    if(!SCPI_ParamBool(context, &enable, true)){
+        RP_LOG(LOG_ERR, "*SYST:PERF is missing first parameter.\n");
+        return SCPI_RES_ERR;
+    }
+
+    int result = rp_PerfEnable(enable);
+
+    if(result != RP_OK){
+        RP_LOG(LOG_ERR, "*SYST:PERF Failed to set latency tracing: %s\n",
+            rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    RP_LOG(LOG_INFO, "*SYST:PERF Successfully set latency tracing.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_SystemPerfReset(scpi_t *context){
+
+    int result = rp_PerfReset();
+
+    if(result != RP_OK){
+        RP_LOG(LOG_ERR, "*SYST:PERF:RST Failed to reset latency "
+            "statistics: %s\n", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    RP_LOG(LOG_INFO, "*SYST:PERF:RST Successfully reset latency statistics.\n");
+    return SCPI_RES_OK;
+}
+
+/* Name, count, mean, median, 99th percentile & max latency in us of each
+ * stage */
+scpi_result_t RP_SystemPerfQ(scpi_t *context){
+
+    rp_perf_stat_t stat;
+
+    for(rp_perf_stage_t stage = 0; stage < RP_PERF_STAGES; stage++){
+        int result = rp_PerfGetStat(stage, &stat);
+
+        if(result != RP_OK){
+            RP_LOG(LOG_ERR, "*SYST:PERF? Failed to get latency "
+                "statistics: %s\n", rp_GetError(result));
+            return SCPI_RES_ERR;
+        }
+
+        SCPI_ResultMnemonic(context, rp_PerfStageName(stage));
+        SCPI_ResultUInt32Base(context, stat.count < UINT32_MAX ? (uint32_t) stat.count : UINT32_MAX, 10);
+        SCPI_ResultDouble(context, stat.mean / 1e3);
+        SCPI_ResultDouble(context, stat.p50 / 1e3);
+        SCPI_ResultDouble(context, stat.p99 / 1e3);
+        SCPI_ResultDouble(context, stat.max / 1e3);
+    }
+
+    RP_LOG(LOG_INFO, "*SYST:PERF? Successfully returned latency statistics.\n");
+    return SCPI_RES_OK;
+}
@@ -22,5 +22,8 @@ scpi_result_t RP_ResetAll(scpi_t *context);
 scpi_result_t RP_ReleaseAll(scpi_t *context);
 scpi_result_t RP_FpgaBitStream(scpi_t *context);
 scpi_result_t RP_EnableDigLoop(scpi_t *context);
+scpi_result_t RP_SystemPerf(scpi_t *context);
+scpi_result_t RP_SystemPerfReset(scpi_t *context);
+scpi_result_t RP_SystemPerfQ(scpi_t *context);
 
 #endif /* API_CMD_H_ */
@@ -19,6 +19,7 @@
 #include "apin.h"
 #include "scpi/parser.h"
 #include "../../api/rpbase/src/common.h"
+#include "../../api/rpbase/src/xadc.h"
 
 /* Apin choice def */
 const scpi_choice_def_t scpi_RpApin[] = {
@@ -115,3 +116,160 @@ scpi_result_t RP_AnalogPinValue(scpi_t * context) {
     RP_LOG(LOG_INFO, "*ANALOG:PIN Successfully set port value.\n");
     return SCPI_RES_OK;
 }
+
+/* Time of the first sample of the last ANALOG:STREAM:DATA? block */
+static int64_t stream_timestamp = 0;
+
+/**
+ * Parses an analog input pin parameter into the analog input index
+ * @param context SCPI context
+ * @param cmd command name for the log
+ * @param pin analog input index
+ * @return true on success
+ */
+static bool RP_ParseAnalogInput(scpi_t *context, const char *cmd, int unsigned *pin) {
+    int32_t choice;
+
+    if (!SCPI_ParamChoice(context, scpi_RpApin, &choice, true)) {
+        RP_LOG(LOG_ERR, "*%s is missing first parameter.\n", cmd);
+        return false;
+    }
+    if (choice < RP_AIN0) {
+        RP_LOG(LOG_ERR, "*%s Only analog inputs can be streamed.\n", cmd);
+        return false;
+    }
+    *pin = choice - RP_AIN0;
+    return true;
+}
+
+/**
+ * Starts streaming of the analog inputs at the given rate in Hz
+ * @param context SCPI context
+ * @return success or failure
+ */
+scpi_result_t RP_AnalogStreamStart(scpi_t * context) {
+
+    double rate;
+
+    if (!SCPI_ParamDouble(context, &rate, true)) {
+        RP_LOG(LOG_ERR, "*ANALOG:STREAM:START is missing first parameter.\n");
+        return SCPI_RES_ERR;
+    }
+
+    int result = rp_AIstreamStart((float) rate);
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*ANALOG:STREAM:START Failed to start stream: %s\n", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    RP_LOG(LOG_INFO, "*ANALOG:STREAM:START Successfully started analog input stream.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AnalogStreamStop(scpi_t * context) {
+    int result = rp_AIstreamStop();
+
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*ANALOG:STREAM:STOP Failed to stop stream: %s\n", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    RP_LOG(LOG_INFO, "*ANALOG:STREAM:STOP Successfully stopped analog input stream.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_AnalogStreamRateQ(scpi_t * context) {
+    float rate;
+    int result = rp_AIstreamGetRate(&rate);
+
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*ANALOG:STREAM:RATE? Failed to get rate: %s\n", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultDouble(context, rate);
+
+    RP_LOG(LOG_INFO, "*ANALOG:STREAM:RATE? Successfully returned rate.\n");
+    return SCPI_RES_OK;
+}
+
+/**
+ * Returns the newest streamed samples of an analog input in volts
+ * @param context SCPI context
+ * @return success or failure
+ */
+scpi_result_t RP_AnalogStreamDataQ(scpi_t * context) {
+
+    int unsigned pin;
+    uint32_t size;
+
+    if (!RP_ParseAnalogInput(context, "ANALOG:STREAM:DATA?", &pin)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (!SCPI_ParamUInt32(context, &size, true)) {
+        RP_LOG(LOG_ERR, "*ANALOG:STREAM:DATA? is missing second parameter.\n");
+        return SCPI_RES_ERR;
+    }
+    if (size == 0 || size > XADC_RING_LEN) {
+        RP_LOG(LOG_ERR, "*ANALOG:STREAM:DATA? Size out of range.\n");
+        return SCPI_RES_ERR;
+    }
+
+    float buffer[size];
+    int result = rp_AIstreamGetData(pin, buffer, &size, &stream_timestamp);
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*ANALOG:STREAM:DATA? Failed to get data: %s\n", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultBufferFloat(context, buffer, size);
+
+    RP_LOG(LOG_INFO, "*ANALOG:STREAM:DATA? Successfully returned data.\n");
+    return SCPI_RES_OK;
+}
+
+/**
+ * Returns the time of the first sample of the last data block in seconds
+ * since the epoch
+ * @param context SCPI context
+ * @return success or failure
+ */
+scpi_result_t RP_AnalogStreamTimeQ(scpi_t * context) {
+    SCPI_ResultDouble(context, stream_timestamp * 1e-9);
+
+    RP_LOG(LOG_INFO, "*ANALOG:STREAM:TIME? Successfully returned timestamp.\n");
+    return SCPI_RES_OK;
+}
+
+/**
+ * Returns the mean of the newest streamed samples of an analog input in volts
+ * @param context SCPI context
+ * @return success or failure
+ */
+scpi_result_t RP_AnalogStreamAverageQ(scpi_t * context) {
+
+    int unsigned pin;
+    uint32_t count;
+    float value;
+
+    if (!RP_ParseAnalogInput(context, "ANALOG:STREAM:AVG?", &pin)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (!SCPI_ParamUInt32(context, &count, true)) {
+        RP_LOG(LOG_ERR, "*ANALOG:STREAM:AVG? is missing second parameter.\n");
+        return SCPI_RES_ERR;
+    }
+
+    int result = rp_AIstreamGetAverage(pin, count, &value);
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*ANALOG:STREAM:AVG? Failed to get average: %s\n", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultDouble(context, value);
+
+    RP_LOG(LOG_INFO, "*ANALOG:STREAM:AVG? Successfully returned average.\n");
+    return SCPI_RES_OK;
+}
@@ -19,5 +19,11 @@
 scpi_result_t RP_AnalogPinReset(scpi_t * context);
 scpi_result_t RP_AnalogPinValueQ(scpi_t * context);
 scpi_result_t RP_AnalogPinValue(scpi_t * context);
+scpi_result_t RP_AnalogStreamStart(scpi_t * context);
+scpi_result_t RP_AnalogStreamStop(scpi_t * context);
+scpi_result_t RP_AnalogStreamRateQ(scpi_t * context);
+scpi_result_t RP_AnalogStreamDataQ(scpi_t * context);
+scpi_result_t RP_AnalogStreamTimeQ(scpi_t * context);
+scpi_result_t RP_AnalogStreamAverageQ(scpi_t * context);
 
 #endif /* APIN_H_ */
@@ -210,3 +210,202 @@ scpi_result_t RP_DigitalPinDirectionQ(scpi_t *context){
     RP_LOG(LOG_INFO, "*DIG:PIN:DIR? Successfully returned direction value to the client.");
     return SCPI_RES_OK;
 }
+
+const scpi_choice_def_t scpi_RpDport[] = {
+    {"LED",    0},
+    {"DIO_P",  1},
+    {"DIO_N",  2},
+    SCPI_CHOICE_LIST_END
+};
+
+/* Steps of the last DIG:SEQ command */
+static rp_dseq_step_t seq_steps[DPIN_SEQ_MAX_STEPS];
+
+/**
+ * Sets direction of the pins of a port: DIG:PORT:DIR <port>,<mask>,<direction>
+ * @param context SCPI context
+ * @return success or failure
+ */
+scpi_result_t RP_DigitalPortDirection(scpi_t * context) {
+
+    int32_t port_choice;
+    uint32_t mask, direction;
+
+    if(!SCPI_ParamChoice(context, scpi_RpDport, &port_choice, true)){
+        RP_LOG(LOG_ERR, "*DIG:PORT:DIR is missing first parameter.");
+        return SCPI_RES_ERR;
+    }
+    if(!SCPI_ParamUInt32(context, &mask, true)){
+        RP_LOG(LOG_ERR, "*DIG:PORT:DIR is missing second parameter.");
+        return SCPI_RES_ERR;
+    }
+    if(!SCPI_ParamUInt32(context, &direction, true)){
+        RP_LOG(LOG_ERR, "*DIG:PORT:DIR is missing third parameter.");
+        return SCPI_RES_ERR;
+    }
+
+    int result = rp_DportSetDirection(port_choice, mask, direction);
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*DIG:PORT:DIR Failed to set port direction: %s", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    RP_LOG(LOG_INFO, "*DIG:PORT:DIR Successfully set port direction.");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_DigitalPortDirectionQ(scpi_t * context) {
+
+    int32_t port_choice;
+    uint32_t direction;
+
+    if(!SCPI_ParamChoice(context, scpi_RpDport, &port_choice, true)){
+        RP_LOG(LOG_ERR, "*DIG:PORT:DIR? is missing first parameter.");
+        return SCPI_RES_ERR;
+    }
+
+    int result = rp_DportGetDirection(port_choice, &direction);
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*DIG:PORT:DIR? Failed to get port direction: %s", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultUInt32Base(context, direction, 10);
+
+    RP_LOG(LOG_INFO, "*DIG:PORT:DIR? Successfully returned port direction.");
+    return SCPI_RES_OK;
+}
+
+/**
+ * Sets states of the pins of a port: DIG:PORT <port>,<mask>,<state>
+ * @param context SCPI context
+ * @return success or failure
+ */
+scpi_result_t RP_DigitalPortState(scpi_t * context) {
+
+    int32_t port_choice;
+    uint32_t mask, state;
+
+    if(!SCPI_ParamChoice(context, scpi_RpDport, &port_choice, true)){
+        RP_LOG(LOG_ERR, "*DIG:PORT is missing first parameter.");
+        return SCPI_RES_ERR;
+    }
+    if(!SCPI_ParamUInt32(context, &mask, true)){
+        RP_LOG(LOG_ERR, "*DIG:PORT is missing second parameter.");
+        return SCPI_RES_ERR;
+    }
+    if(!SCPI_ParamUInt32(context, &state, true)){
+        RP_LOG(LOG_ERR, "*DIG:PORT is missing third parameter.");
+        return SCPI_RES_ERR;
+    }
+
+    int result = rp_DportSetState(port_choice, mask, state);
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*DIG:PORT Failed to set port state: %s", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    RP_LOG(LOG_INFO, "*DIG:PORT Successfully set port state.");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_DigitalPortStateQ(scpi_t * context) {
+
+    int32_t port_choice;
+    uint32_t state;
+
+    if(!SCPI_ParamChoice(context, scpi_RpDport, &port_choice, true)){
+        RP_LOG(LOG_ERR, "*DIG:PORT? is missing first parameter.");
+        return SCPI_RES_ERR;
+    }
+
+    int result = rp_DportGetState(port_choice, &state);
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*DIG:PORT? Failed to get port state: %s", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultUInt32Base(context, state, 10);
+
+    RP_LOG(LOG_INFO, "*DIG:PORT? Successfully returned port state.");
+    return SCPI_RES_OK;
+}
+
+/**
+ * Plays a pattern sequence on a port:
+ * DIG:SEQ <port>,<repeat>,<mask>,<state>,<delay ns>[,<mask>,<state>,<delay ns>...]
+ * @param context SCPI context
+ * @return success or failure
+ */
+scpi_result_t RP_DigitalSequence(scpi_t * context) {
+
+    int32_t port_choice;
+    uint32_t repeat, count = 0;
+
+    if(!SCPI_ParamChoice(context, scpi_RpDport, &port_choice, true)){
+        RP_LOG(LOG_ERR, "*DIG:SEQ is missing first parameter.");
+        return SCPI_RES_ERR;
+    }
+    if(!SCPI_ParamUInt32(context, &repeat, true)){
+        RP_LOG(LOG_ERR, "*DIG:SEQ is missing second parameter.");
+        return SCPI_RES_ERR;
+    }
+
+    while (count < DPIN_SEQ_MAX_STEPS && SCPI_ParamUInt32(context, &seq_steps[count].mask, false)) {
+        if(!SCPI_ParamUInt32(context, &seq_steps[count].state, true) ||
+           !SCPI_ParamUInt32(context, &seq_steps[count].delay, true)){
+            RP_LOG(LOG_ERR, "*DIG:SEQ Incomplete step %u.", count);
+            return SCPI_RES_ERR;
+        }
+        count++;
+    }
+
+    int result = rp_DseqStart(port_choice, seq_steps, count, repeat);
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*DIG:SEQ Failed to start sequence: %s", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    RP_LOG(LOG_INFO, "*DIG:SEQ Successfully started sequence of %u steps.", count);
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_DigitalSequenceStop(scpi_t * context) {
+    int result = rp_DseqStop();
+
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*DIG:SEQ:STOP Failed to stop sequence: %s", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    RP_LOG(LOG_INFO, "*DIG:SEQ:STOP Successfully stopped sequence.");
+    return SCPI_RES_OK;
+}
+
+/**
+ * Returns running,steps played,mean lateness ns,max lateness ns
+ * @param context SCPI context
+ * @return success or failure
+ */
+scpi_result_t RP_DigitalSequenceStatQ(scpi_t * context) {
+
+    bool running;
+    rp_dseq_stat_t stat;
+
+    int result = rp_DseqIsRunning(&running);
+    if (RP_OK == result) {
+        result = rp_DseqGetStat(&stat);
+    }
+    if (RP_OK != result){
+        RP_LOG(LOG_ERR, "*DIG:SEQ:STAT? Failed to get sequence statistics: %s", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultInt32(context, running);
+    SCPI_ResultUInt32Base(context, stat.steps < UINT32_MAX ? (uint32_t) stat.steps : UINT32_MAX, 10);
+    SCPI_ResultUInt32Base(context, stat.late_avg, 10);
+    SCPI_ResultUInt32Base(context, stat.late_max, 10);
+
+    RP_LOG(LOG_INFO, "*DIG:SEQ:STAT? Successfully returned sequence statistics.");
+    return SCPI_RES_OK;
+}
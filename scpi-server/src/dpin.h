@@ -22,4 +22,15 @@ scpi_result_t RP_DigitalPinState(scpi_t * context);
 scpi_result_t RP_DigitalPinDirection(scpi_t * context);
 scpi_result_t RP_DigitalPinDirectionQ(scpi_t *context);
 
+/* Steps of a DIG:SEQ command */
+#define DPIN_SEQ_MAX_STEPS 1024
+
+scpi_result_t RP_DigitalPortDirection(scpi_t * context);
+scpi_result_t RP_DigitalPortDirectionQ(scpi_t * context);
+scpi_result_t RP_DigitalPortState(scpi_t * context);
+scpi_result_t RP_DigitalPortStateQ(scpi_t * context);
+scpi_result_t RP_DigitalSequence(scpi_t * context);
+scpi_result_t RP_DigitalSequenceStop(scpi_t * context);
+scpi_result_t RP_DigitalSequenceStatQ(scpi_t * context);
+
 #endif /* DPIN_H_ */
@@ -14,6 +14,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <math.h>
 
@@ -469,6 +470,154 @@ scpi_result_t RP_GenArbitraryWaveFormQ(scpi_t *context) {
     return SCPI_RES_OK;
 }
 
+/**
+ * Reads definite length block and optional offset of binary arbitrary waveform upload.
+ * Block data points directly into the received message, no copy is made.
+ */
+static int parseArbBlock(scpi_t *context, const char *cmd, size_t sample_size,
+                         const char **data, uint32_t *offset, uint32_t *length) {
+    size_t len;
+
+    if (!SCPI_ParamArbitraryBlock(context, data, &len, true)) {
+        RP_LOG(LOG_ERR, "*%s Failed to parse binary block.\n", cmd);
+        return RP_EIPV;
+    }
+    if (len % sample_size != 0) {
+        RP_LOG(LOG_ERR, "*%s Block length is not a multiple of sample size.\n", cmd);
+        return RP_EIPV;
+    }
+    *offset = 0;
+    SCPI_ParamUInt32(context, offset, false);
+    *length = len / sample_size;
+    return RP_OK;
+}
+
+scpi_result_t RP_GenArbitraryWaveFormFloat(scpi_t *context) {
+
+    static float buffer[BUFFER_LENGTH];
+    rp_channel_t channel;
+    const char *data;
+    uint32_t offset, length;
+    int result;
+
+    if (RP_ParseChArgv(context, &channel) != RP_OK){
+        return SCPI_RES_ERR;
+    }
+
+    if (parseArbBlock(context, "SOUR#:TRAC:DATA:FLOAT", sizeof(float), &data, &offset, &length) != RP_OK) {
+        return SCPI_RES_ERR;
+    }
+    if (length > BUFFER_LENGTH) {
+        RP_LOG(LOG_ERR, "*SOUR#:TRAC:DATA:FLOAT Too many samples.\n");
+        return SCPI_RES_ERR;
+    }
+
+    // block is not necessarily aligned within received message
+    const float *samples = (const float *) data;
+    if ((uintptr_t) data % sizeof(float)) {
+        memcpy(buffer, data, length * sizeof(float));
+        samples = buffer;
+    }
+
+    result = rp_GenArbWaveformRange(channel, samples, offset, length);
+    if(result != RP_OK){
+        RP_LOG(LOG_ERR, "*SOUR#:TRAC:DATA:FLOAT Failed to "
+            "set arbitrary waveform data: %s\n", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    RP_LOG(LOG_INFO, "*SOUR#:TRAC:DATA:FLOAT Successfully set arbitrary waveform data.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_GenArbitraryWaveFormFloatQ(scpi_t *context) {
+
+    static float buffer[BUFFER_LENGTH];
+    rp_channel_t channel;
+    uint32_t size;
+    int result;
+
+    if (RP_ParseChArgv(context, &channel) != RP_OK){
+        return SCPI_RES_ERR;
+    }
+
+    result = rp_GenGetArbWaveform(channel, buffer, &size);
+    if(result != RP_OK){
+        RP_LOG(LOG_ERR, "*SOUR#:TRAC:DATA:FLOAT? Failed to "
+            "get arbitrary waveform data: %s\n", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultArbitraryBlock(context, (const char *) buffer, size * sizeof(float));
+
+    RP_LOG(LOG_INFO, "*SOUR#:TRAC:DATA:FLOAT? Successfully "
+        "returned arbitrary waveform data to client.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_GenArbitraryWaveFormRaw(scpi_t *context) {
+
+    static int16_t buffer[BUFFER_LENGTH];
+    rp_channel_t channel;
+    const char *data;
+    uint32_t offset, length;
+    int result;
+
+    if (RP_ParseChArgv(context, &channel) != RP_OK){
+        return SCPI_RES_ERR;
+    }
+
+    if (parseArbBlock(context, "SOUR#:TRAC:DATA:RAW", sizeof(int16_t), &data, &offset, &length) != RP_OK) {
+        return SCPI_RES_ERR;
+    }
+    if (length > BUFFER_LENGTH) {
+        RP_LOG(LOG_ERR, "*SOUR#:TRAC:DATA:RAW Too many samples.\n");
+        return SCPI_RES_ERR;
+    }
+
+    // block is not necessarily aligned within received message
+    const int16_t *samples = (const int16_t *) data;
+    if ((uintptr_t) data % sizeof(int16_t)) {
+        memcpy(buffer, data, length * sizeof(int16_t));
+        samples = buffer;
+    }
+
+    result = rp_GenArbWaveformRaw(channel, samples, offset, length);
+    if(result != RP_OK){
+        RP_LOG(LOG_ERR, "*SOUR#:TRAC:DATA:RAW Failed to "
+            "set arbitrary waveform data: %s\n", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    RP_LOG(LOG_INFO, "*SOUR#:TRAC:DATA:RAW Successfully set arbitrary waveform data.\n");
+    return SCPI_RES_OK;
+}
+
+scpi_result_t RP_GenArbitraryWaveFormRawQ(scpi_t *context) {
+
+    static int16_t buffer[BUFFER_LENGTH];
+    rp_channel_t channel;
+    uint32_t size;
+    int result;
+
+    if (RP_ParseChArgv(context, &channel) != RP_OK){
+        return SCPI_RES_ERR;
+    }
+
+    result = rp_GenGetArbWaveformRaw(channel, buffer, &size);
+    if(result != RP_OK){
+        RP_LOG(LOG_ERR, "*SOUR#:TRAC:DATA:RAW? Failed to "
+            "get arbitrary waveform data: %s\n", rp_GetError(result));
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultArbitraryBlock(context, (const char *) buffer, size * sizeof(int16_t));
+
+    RP_LOG(LOG_INFO, "*SOUR#:TRAC:DATA:RAW? Successfully "
+        "returned arbitrary waveform data to client.\n");
+    return SCPI_RES_OK;
+}
+
 scpi_result_t RP_GenGenerateMode(scpi_t *context) {
     
     rp_channel_t channel;
@@ -145,16 +145,32 @@ static const scpi_command_t scpi_commands[] = {
     {.pattern = "RP:RELease", .callback                 = RP_ReleaseAll,},
     {.pattern = "RP:FPGABITREAM", .callback             = RP_FpgaBitStream,},
     {.pattern = "RP:DIg[:loop]", .callback              = RP_EnableDigLoop,},
+    {.pattern = "SYSTem:PERF", .callback                = RP_SystemPerf,},
+    {.pattern = "SYSTem:PERF:RST", .callback            = RP_SystemPerfReset,},
+    {.pattern = "SYSTem:PERF?", .callback               = RP_SystemPerfQ,},
 
     {.pattern = "DIG:RST", .callback                    = RP_DigitalPinReset,},
     {.pattern = "DIG:PIN", .callback                    = RP_DigitalPinState,},
     {.pattern = "DIG:PIN?", .callback                   = RP_DigitalPinStateQ,},
     {.pattern = "DIG:PIN:DIR", .callback                = RP_DigitalPinDirection,},
     {.pattern = "DIG:PIN:DIR?", .callback               = RP_DigitalPinDirectionQ,},
+    {.pattern = "DIG:PORT", .callback                   = RP_DigitalPortState,},
+    {.pattern = "DIG:PORT?", .callback                  = RP_DigitalPortStateQ,},
+    {.pattern = "DIG:PORT:DIR", .callback               = RP_DigitalPortDirection,},
+    {.pattern = "DIG:PORT:DIR?", .callback              = RP_DigitalPortDirectionQ,},
+    {.pattern = "DIG:SEQ", .callback                    = RP_DigitalSequence,},
+    {.pattern = "DIG:SEQ:STOP", .callback               = RP_DigitalSequenceStop,},
+    {.pattern = "DIG:SEQ:STAT?", .callback              = RP_DigitalSequenceStatQ,},
 
     {.pattern = "ANALOG:RST", .callback                 = RP_AnalogPinReset,},
     {.pattern = "ANALOG:PIN", .callback                 = RP_AnalogPinValue,},
     {.pattern = "ANALOG:PIN?", .callback                = RP_AnalogPinValueQ,},
+    {.pattern = "ANALOG:STREAM:START", .callback        = RP_AnalogStreamStart,},
+    {.pattern = "ANALOG:STREAM:STOP", .callback         = RP_AnalogStreamStop,},
+    {.pattern = "ANALOG:STREAM:RATE?", .callback        = RP_AnalogStreamRateQ,},
+    {.pattern = "ANALOG:STREAM:DATA?", .callback        = RP_AnalogStreamDataQ,},
+    {.pattern = "ANALOG:STREAM:TIME?", .callback        = RP_AnalogStreamTimeQ,},
+    {.pattern = "ANALOG:STREAM:AVG?", .callback         = RP_AnalogStreamAverageQ,},
 
     /* Acquire */
     {.pattern = "ACQ:START", .callback                  = RP_AcqStart,},
@@ -188,6 +204,9 @@ static const scpi_command_t scpi_commands[] = {
     {.pattern = "ACQ:SOUR#:DATA?", .callback            = RP_AcqDataOldestAllQ,},
     {.pattern = "ACQ:SOUR#:DATA:LAT:N?", .callback      = RP_AcqLatestDataQ,},
     {.pattern = "ACQ:BUF:SIZE?", .callback              = RP_AcqBufferSizeQ,},
+    {.pattern = "ACQ:DATA:STREAM", .callback            = RP_AcqDataStream,},
+    {.pattern = "ACQ:DATA:STREAM?", .callback           = RP_AcqDataStreamQ,},
+    {.pattern = "ACQ:DATA:STREAM:STAT?", .callback      = RP_AcqDataStreamStatQ,},
 
     /* Generate */
     {.pattern = "GEN:RST", .callback                    = RP_GenReset,},
@@ -207,6 +226,10 @@ static const scpi_command_t scpi_commands[] = {
     {.pattern = "SOUR#:DCYC?", .callback                = RP_GenDutyCycleQ,},
     {.pattern = "SOUR#:TRAC:DATA:DATA", .callback       = RP_GenArbitraryWaveForm,},
     {.pattern = "SOUR#:TRAC:DATA:DATA?", .callback      = RP_GenArbitraryWaveFormQ,},
+    {.pattern = "SOUR#:TRAC:DATA:FLOAT", .callback      = RP_GenArbitraryWaveFormFloat,},
+    {.pattern = "SOUR#:TRAC:DATA:FLOAT?", .callback     = RP_GenArbitraryWaveFormFloatQ,},
+    {.pattern = "SOUR#:TRAC:DATA:RAW", .callback        = RP_GenArbitraryWaveFormRaw,},
+    {.pattern = "SOUR#:TRAC:DATA:RAW?", .callback       = RP_GenArbitraryWaveFormRawQ,},
     {.pattern = "SOUR#:BURS:STAT", .callback            = RP_GenGenerateMode,},
     {.pattern = "SOUR#:BURS:STAT?", .callback           = RP_GenGenerateModeQ,},
     {.pattern = "SOUR#:BURS:NCYC", .callback            = RP_GenBurstCount,},
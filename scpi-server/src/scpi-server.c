@@ -27,6 +27,7 @@
 
 #include "scpi-commands.h"
 #include "common.h"
+#include "acq_stream.h"
 
 #include "scpi/parser.h"
 #include "redpitaya/rp.h"
@@ -37,6 +38,13 @@
 #define LISTEN_BACKLOG 50
 #define LISTEN_PORT 5000
 #define MAX_BUFF_SIZE 1024
+/* Largest definite length block, a buffer of float samples */
+#define MAX_BLOCK_SIZE (ADC_BUFFER_SIZE * sizeof(float))
+/* Largest message buffer, a buffer of samples as an ASCII list with its
+ * command, 32 bytes per sample */
+#define MAX_MESSAGE_SIZE (ADC_BUFFER_SIZE * 32)
+/* getBlockLength() & getNextCommand() result for a block over MAX_BLOCK_SIZE */
+#define BLOCK_TOO_LONG ((size_t) -2)
 
 static bool app_exit = false;
 static char delimiter[] = "\r\n";
@@ -68,11 +76,54 @@ static void installTermSignalHandler()
     sigaction(SIGINT, &action, NULL);
 }
 
+/**
+ * Helper method which returns length of definite length block header and data.
+ * Block has the form #<n><length><data>, where n is number of length digits.
+ * @param buffer     Buffer starting with '#'
+ * @param bufferLen  Buffer length
+ * @return Length of the whole block, 0 if it is not a definite length block,
+ *         BLOCK_TOO_LONG if it is longer than MAX_BLOCK_SIZE, or -1 if the
+ *         block is not received completely yet.
+ */
+static size_t getBlockLength(const char* buffer, size_t bufferLen)
+{
+    if (bufferLen < 2) {
+        return -1;
+    }
+    if (buffer[1] < '1' || buffer[1] > '9') {
+        return 0;
+    }
+
+    size_t digits = buffer[1] - '0';
+    if (bufferLen < 2 + digits) {
+        return -1;
+    }
+
+    size_t len = 0;
+    for (size_t i = 0; i < digits; i++) {
+        char c = buffer[2 + i];
+        if (c < '0' || c > '9') {
+            return 0;
+        }
+        len = len * 10 + (c - '0');
+        if (len > MAX_BLOCK_SIZE) {
+            return BLOCK_TOO_LONG;
+        }
+    }
+
+    if (bufferLen < 2 + digits + len) {
+        return -1;
+    }
+    return 2 + digits + len;
+}
+
 /**
  * Helper method which returns next command position from the buffer.
+ * Binary data of definite length blocks is skipped, since it can contain delimiter.
  * @param buffer     Input buffer
  * @param bufferLen  Input buffer length
- * @return Position of next command within buffer, or -1 if not found.
+ * @return Position of next command within buffer, -1 if not found, or
+ *         BLOCK_TOO_LONG if a block too long to be received comes first.
  */
 static size_t getNextCommand(const char* buffer, size_t bufferLen)
 {
@@ -80,6 +131,18 @@ static size_t getNextCommand(const char* buffer, size_t bufferLen)
     size_t i = 0;
     for (i = 0; i < bufferLen; i++) {
 
+        // Skip binary block
+        if (buffer[i] == '#') {
+            size_t blockLen = getBlockLength(buffer + i, bufferLen - i);
+            if (blockLen == -1 || blockLen == BLOCK_TOO_LONG) {
+                return blockLen;
+            }
+            if (blockLen > 0) {
+                i += blockLen - 1;
+                continue;
+            }
+        }
+
         // Find match for end of delimiter
         if (buffer[i] == delimiter[delimiterLen - 1]) {
 
@@ -123,46 +186,70 @@ static int handleConnection(int connfd) {
 
     size_t message_len = MAX_BUFF_SIZE;
     char *message_buff = malloc(message_len);
-    char buffer[MAX_BUFF_SIZE];
     size_t msg_end = 0;
 
+    if (message_buff == NULL) {
+        RP_LOG(LOG_ERR, "Failed to allocate message buffer.\n");
+        return 1;
+    }
+
     installTermSignalHandler();
 
     prctl( 1, SIGTERM );
 
     RP_LOG(LOG_INFO, "Waiting for first client request.");
 
-    //Receive a message from client
-    while( (read_size = recv(connfd , buffer , MAX_BUFF_SIZE , 0)) > 0 )
+    //Receive a message from client directly into message buffer,
+    //large binary uploads are parsed in place without extra copies
+    while(1)
     {
-        if (app_exit) {
-            break;
-        }
-
-        // First make sure that message buffer is large enough
-        while (msg_end + read_size >= message_len) {
+        // First make sure that message buffer has free space
+        if (message_len - msg_end < MAX_BUFF_SIZE) {
+            char *buff = NULL;
+            if (message_len < MAX_MESSAGE_SIZE) {
+                buff = realloc(message_buff, message_len * 2);
+            }
+            if (buff == NULL) {
+                RP_LOG(LOG_ERR, "No command within %zu bytes, closing connection.\n", message_len);
+                errno = ENOMEM;
+                read_size = -1;
+                break;
+            }
+            message_buff = buff;
             message_len *= 2;
-            message_buff = realloc(message_buff, message_len);
         }
 
-        // Copy read buffer into message buffer
-        memcpy(message_buff + msg_end, buffer, read_size);
+        read_size = recv(connfd, message_buff + msg_end, message_len - msg_end, 0);
+        if (read_size <= 0 || app_exit) {
+            break;
+        }
         msg_end += read_size;
 
         // Now try to parse each command out
         char *m = message_buff;
         size_t pos = -1;
-        while ((pos = getNextCommand(m, msg_end)) != -1) {
+        while ((pos = getNextCommand(m, msg_end)) != -1 && pos != BLOCK_TOO_LONG) {
 
             // Log out message
             LogMessage(m, pos);
 
-            //Parse the message and return response
-            SCPI_Input(&scpi_context, m, pos);
+            //Parse the complete message in place and return response,
+            //streamed acquisition frames wait until the reply is out
+            acq_stream_Lock();
+            SCPI_Parse(&scpi_context, m, pos);
+            acq_stream_Unlock();
             m += pos;
             msg_end -= pos;
         }
 
+        // Block is not buffered, its data would be parsed as commands
+        if (pos == BLOCK_TOO_LONG) {
+            RP_LOG(LOG_ERR, "Block of over %zu bytes, closing connection.\n", (size_t)MAX_BLOCK_SIZE);
+            errno = EMSGSIZE;
+            read_size = -1;
+            break;
+        }
+
         // Move the rest of the message to the beginning of the buffer
         if (message_buff != m && msg_end > 0) {
             memmove(message_buff, m, msg_end);
@@ -171,6 +258,7 @@ static int handleConnection(int connfd) {
         RP_LOG(LOG_INFO, "Waiting for next client request.\n");
     }
 
+    acq_stream_Stop();
     free(message_buff);
 
     RP_LOG(LOG_INFO, "Closing client connection...");
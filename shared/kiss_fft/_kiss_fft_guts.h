@@ -18,6 +18,8 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
    typedef struct { kiss_fft_scalar r; kiss_fft_scalar i; }kiss_fft_cpx; */
 #include "kiss_fft.h"
 #include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
 
 #define MAXFACTORS 32
 /* e.g. an fft of length 128 has 4 factors 
@@ -32,6 +34,17 @@ struct kiss_fft_state{
     kiss_fft_cpx twiddles[1];
 };
 
+struct kiss_fftr_state{
+    kiss_fft_cfg substate;
+    kiss_fft_cpx * tmpbuf;
+    kiss_fft_cpx * super_twiddles;
+    /* set on plans shared from the plan cache, tmpbuf is scratch space */
+    pthread_mutex_t * lock;
+#ifdef USE_SIMD
+    void * pad;
+#endif
+};
+
 /*
   Explanation of macros dealing with complex math:
 
@@ -138,6 +151,47 @@ struct kiss_fft_state{
 #  define HALF_OF(x) ((x)*.5)
 #endif
 
+/*
+  Floating point complex values as two element GCC vectors, one SSE2
+  register for double on x86, one NEON D register for float on ARM. Define
+  KISS_FFT_NO_VEC to build the plain C butterflies instead.
+
+   kf_vload(c), kf_vstore(c,v) : unaligned load/store of a kiss_fft_cpx
+   kf_vswap(v)                 : (r,i) -> (i,r)
+   kf_vmul(a,b)                : a*b, same operations as C_MUL
+ * */
+#if !defined(FIXED_POINT) && !defined(USE_SIMD) && !defined(KISS_FFT_NO_VEC) && defined(__GNUC__)
+#define KISS_FFT_VEC
+
+#ifdef KISS_FFT_FLOAT
+typedef int32_t kf_vmask __attribute__ ((vector_size (8)));
+#else
+typedef int64_t kf_vmask __attribute__ ((vector_size (16)));
+#endif
+typedef kiss_fft_scalar kf_vec __attribute__ ((vector_size (sizeof(kf_vmask))));
+
+static inline kf_vec kf_vload(const kiss_fft_cpx * c)
+{
+    kf_vec v;
+    memcpy(&v, c, sizeof(v));
+    return v;
+}
+
+static inline void kf_vstore(kiss_fft_cpx * c, kf_vec v)
+{
+    memcpy(c, &v, sizeof(v));
+}
+
+#define kf_vswap(v) __builtin_shuffle((v), (kf_vmask){1, 0})
+
+static inline kf_vec kf_vmul(kf_vec a, kf_vec b)
+{
+    kf_vec br = __builtin_shuffle(b, (kf_vmask){0, 0});
+    kf_vec bi = __builtin_shuffle(b, (kf_vmask){1, 1});
+    return a * br + kf_vswap(a) * bi * (kf_vec){-1, 1};
+}
+#endif
+
 #define  kf_cexp(x,phase) \
 	do{ \
 		(x)->r = KISS_FFT_COS(phase);\
@@ -27,8 +27,19 @@ static void kf_bfly2(
 {
     kiss_fft_cpx * Fout2;
     kiss_fft_cpx * tw1 = st->twiddles;
-    kiss_fft_cpx t;
     Fout2 = Fout + m;
+#ifdef KISS_FFT_VEC
+    do{
+        kf_vec f = kf_vload(Fout);
+        kf_vec t = kf_vmul(kf_vload(Fout2), kf_vload(tw1));
+        tw1 += fstride;
+        kf_vstore(Fout2, f - t);
+        kf_vstore(Fout, f + t);
+        ++Fout2;
+        ++Fout;
+    }while (--m);
+#else
+    kiss_fft_cpx t;
     do{
         C_FIXDIV(*Fout,2); C_FIXDIV(*Fout2,2);
 
@@ -39,6 +50,7 @@ static void kf_bfly2(
         ++Fout2;
         ++Fout;
     }while (--m);
+#endif
 }
 
 static void kf_bfly4(
@@ -49,7 +61,6 @@ static void kf_bfly4(
         )
 {
     kiss_fft_cpx *tw1,*tw2,*tw3;
-    kiss_fft_cpx scratch[6];
     size_t k=m;
     const size_t m2=2*m;
     const size_t m3=3*m;
@@ -57,6 +68,33 @@ static void kf_bfly4(
 
     tw3 = tw2 = tw1 = st->twiddles;
 
+#ifdef KISS_FFT_VEC
+    {
+        /* s4 times -i (forward) or i (inverse) */
+        const kf_vec rot = st->inverse ? (kf_vec){-1, 1} : (kf_vec){1, -1};
+        do {
+            kf_vec f0 = kf_vload(Fout);
+            kf_vec s0 = kf_vmul(kf_vload(Fout + m), kf_vload(tw1));
+            kf_vec s1 = kf_vmul(kf_vload(Fout + m2), kf_vload(tw2));
+            kf_vec s2 = kf_vmul(kf_vload(Fout + m3), kf_vload(tw3));
+            kf_vec s5 = f0 - s1;
+            kf_vec s3 = s0 + s2;
+            kf_vec s4 = kf_vswap(s0 - s2) * rot;
+
+            f0 += s1;
+            tw1 += fstride;
+            tw2 += fstride*2;
+            tw3 += fstride*3;
+            kf_vstore(Fout + m2, f0 - s3);
+            kf_vstore(Fout, f0 + s3);
+            kf_vstore(Fout + m, s5 + s4);
+            kf_vstore(Fout + m3, s5 - s4);
+            ++Fout;
+        } while(--k);
+    }
+#else
+    kiss_fft_cpx scratch[6];
+
     do {
         C_FIXDIV(*Fout,4); C_FIXDIV(Fout[m],4); C_FIXDIV(Fout[m2],4); C_FIXDIV(Fout[m3],4);
 
@@ -87,6 +125,7 @@ static void kf_bfly4(
         }
         ++Fout;
     }while(--k);
+#endif
 }
 
 static void kf_bfly3(
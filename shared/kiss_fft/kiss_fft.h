@@ -43,8 +43,12 @@ extern "C" {
 # endif
 #else
 # ifndef kiss_fft_scalar
-/*  default is float */
+/*  default is double, KISS_FFT_FLOAT selects float */
+#  ifdef KISS_FFT_FLOAT
+#   define kiss_fft_scalar float
+#  else
 #   define kiss_fft_scalar double
+#  endif
 # endif
 #endif
 
@@ -0,0 +1,31 @@
+##
+# $Id: $
+#
+# (c) Red Pitaya  http://www.redpitaya.com
+#
+# Make fragment for users of the shared kiss_fft library. Set KISS_FFT_DIR
+# to this directory (and optionally KISS_FFT_TYPE) before including it, then
+# add $(KISS_FFT_CFLAGS) to the compiler flags, link $(KISS_FFT_LIB) and
+# build it with:
+#
+#   $(KISS_FFT_LIB):
+#   	$(MAKE) -C $(KISS_FFT_DIR) KISS_FFT_TYPE=$(KISS_FFT_TYPE)
+#
+# KISS_FFT_TYPE selects kiss_fft_scalar:
+#   double - double (default)
+#   float  - float
+#   int16  - 16 bit fixed point, Q15 with scaling by 1/N in every transform
+#
+
+KISS_FFT_TYPE ?= double
+
+KISS_FFT_DEFS_double =
+KISS_FFT_DEFS_float  = -DKISS_FFT_FLOAT
+KISS_FFT_DEFS_int16  = -DFIXED_POINT=16
+
+ifeq ($(filter $(KISS_FFT_TYPE),double float int16),)
+$(error KISS_FFT_TYPE must be one of double, float, int16)
+endif
+
+KISS_FFT_LIB    = $(KISS_FFT_DIR)/lib/libkiss_fft_$(KISS_FFT_TYPE).a
+KISS_FFT_CFLAGS = -I$(KISS_FFT_DIR) $(KISS_FFT_DEFS_$(KISS_FFT_TYPE))
@@ -0,0 +1,84 @@
+/*
+ Process wide cache of kiss_fft and kiss_fftr states.
+
+ (c) Red Pitaya  http://www.redpitaya.com
+ */
+
+#include "kiss_fft_plan.h"
+#include "_kiss_fft_guts.h"
+
+struct kiss_fft_plan{
+    struct kiss_fft_plan * next;
+    int nfft;
+    int inverse;
+    int real;
+    void * cfg;
+    pthread_mutex_t lock;
+};
+
+static struct kiss_fft_plan * plans = NULL;
+static pthread_mutex_t plans_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void * kf_plan_get(int nfft,int inverse_fft,int real)
+{
+    struct kiss_fft_plan * p;
+    void * cfg = NULL;
+
+    if (nfft <= 0)
+        return NULL;
+    inverse_fft = inverse_fft != 0;
+
+    pthread_mutex_lock(&plans_lock);
+    for (p = plans; p; p = p->next) {
+        if (p->nfft == nfft && p->inverse == inverse_fft && p->real == real) {
+            cfg = p->cfg;
+            break;
+        }
+    }
+    if (cfg == NULL && (p = (struct kiss_fft_plan *)malloc(sizeof(*p))) != NULL) {
+        if (real)
+            cfg = kiss_fftr_alloc(nfft, inverse_fft, NULL, NULL);
+        else
+            cfg = kiss_fft_alloc(nfft, inverse_fft, NULL, NULL);
+        if (cfg) {
+            p->nfft = nfft;
+            p->inverse = inverse_fft;
+            p->real = real;
+            p->cfg = cfg;
+            if (real) {
+                pthread_mutex_init(&p->lock, NULL);
+                ((kiss_fftr_cfg)cfg)->lock = &p->lock;
+            }
+            p->next = plans;
+            plans = p;
+        } else {
+            free(p);
+        }
+    }
+    pthread_mutex_unlock(&plans_lock);
+    return cfg;
+}
+
+kiss_fft_cfg kiss_fft_plan(int nfft,int inverse_fft)
+{
+    return (kiss_fft_cfg)kf_plan_get(nfft, inverse_fft, 0);
+}
+
+kiss_fftr_cfg kiss_fftr_plan(int nfft,int inverse_fft)
+{
+    return (kiss_fftr_cfg)kf_plan_get(nfft, inverse_fft, 1);
+}
+
+void kiss_fft_plan_cleanup(void)
+{
+    pthread_mutex_lock(&plans_lock);
+    while (plans) {
+        struct kiss_fft_plan * p = plans;
+        plans = p->next;
+        if (p->real)
+            pthread_mutex_destroy(&p->lock);
+        KISS_FFT_FREE(p->cfg);
+        free(p);
+    }
+    pthread_mutex_unlock(&plans_lock);
+}
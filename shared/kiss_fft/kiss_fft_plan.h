@@ -0,0 +1,47 @@
+#ifndef KISS_FFT_PLAN_H
+#define KISS_FFT_PLAN_H
+
+#include "kiss_fft.h"
+#include "kiss_fftr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ Process wide cache of fft states, for users that would otherwise each
+ allocate (and compute the twiddles of) the same transforms.
+
+ A plan is created on first use of a (nfft, inverse) pair and shared from
+ then on; the precision is the one the library is built for. Plans must not
+ be freed by the caller. Complex plans can be used from several threads at
+ once, real plans serialize the transforms of the same plan (they need the
+ state's scratch buffer).
+ */
+
+/*
+ * kiss_fft_plan
+ *
+ * Returns the shared complex fft state for nfft points or NULL if it can not
+ * be allocated.
+ * */
+kiss_fft_cfg kiss_fft_plan(int nfft,int inverse_fft);
+
+/*
+ * kiss_fftr_plan
+ *
+ * Returns the shared real fft state for nfft (even) points or NULL.
+ * */
+kiss_fftr_cfg kiss_fftr_plan(int nfft,int inverse_fft);
+
+/*
+ Frees all plans. Only to be called when no plan is in use any more, e.g.
+ when the application using them is unloaded.
+ */
+void kiss_fft_plan_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,384 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya latency tracer.
+ *
+ * A stage is timed by two monotonic clock stamps, the start is taken by the
+ * caller with perf_Now() and the end in perf_Stamp(). Each thread owns a
+ * slot of the shared memory file, claimed by its thread id on its first
+ * stamp, and writes its stamps to the ring and histograms of the slot, so
+ * stamping takes no lock and shares no cache line with other threads.
+ * Readers sum the histograms of all slots; a reader racing a stamp may miss
+ * it, which is fine for statistics.
+ *
+ * A slot is given up on thread exit. Slots of threads gone without that,
+ * e.g. of a process which exited or crashed, are taken over once the free
+ * ones run out. The statistics of a slot stay counted when it changes hands.
+ *
+ * Histogram buckets split each octave of ns in 4, percentiles are the top of
+ * their bucket, i.e. at most 25 % above the exact value.
+ *
+ * Reset only bumps the epoch: a thread clears its own slot on the next stamp
+ * and readers skip slots of older epochs, so nobody writes another thread's
+ * counters.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "perf.h"
+
+/* Layout of the shared memory file, in its first word */
+#define PERF_MAGIC  (0x52505000 | RP_PERF_STAGES)
+
+#define PERF_MIN(a, b)  ((a) < (b) ? (a) : (b))
+#define PERF_MAX(a, b)  ((a) > (b) ? (a) : (b))
+
+typedef struct {
+    uint32_t          owner;     /* thread id stamping into it, 0 - free */
+    uint32_t          epoch;
+    uint32_t          head;      /* records written, ring index is modulo */
+    rp_perf_rec_t     ring[PERF_RING_LEN];
+    uint64_t          sum[RP_PERF_STAGES];
+    uint64_t          max[RP_PERF_STAGES];
+    uint32_t          hist[RP_PERF_STAGES][PERF_BUCKETS];
+} __attribute__((aligned(64))) perf_slot_t;
+
+typedef struct {
+    uint32_t          magic;
+    uint32_t          enabled;
+    uint32_t          epoch;
+    uint64_t          trigger;   /* trigger seen, 0 - none */
+    perf_slot_t       slot[PERF_SLOTS];
+} perf_shm_t;
+
+static pthread_once_t perf_once = PTHREAD_ONCE_INIT;
+static pthread_key_t  perf_key;
+static perf_shm_t    *perf_shm;
+
+static __thread perf_slot_t *perf_self;
+
+static const char *perf_names[RP_PERF_STAGES] = {
+    "ACQ_READ", "SCPI_DATA", "SCPI_TRIG", "OSC_PROCESS", "WS_SIGNALS", "WS_GZIP"
+};
+
+
+static inline uint32_t perf_Bucket(uint64_t ns) {
+    if (ns < 4) {
+        return ns;
+    }
+    ns = PERF_MIN(ns, ((uint64_t)1 << PERF_OCTAVES) - 1);
+    uint32_t msb = 63 - __builtin_clzll(ns);
+    return 4 * (msb - 1) + ((ns >> (msb - 2)) & 3);
+}
+
+/* Largest value of a bucket */
+static uint64_t perf_BucketTop(uint32_t bucket) {
+    if (bucket < 4) {
+        return bucket;
+    }
+    uint32_t msb = bucket / 4 + 1;
+    return ((uint64_t)(5 + bucket % 4) << (msb - 2)) - 1;
+}
+
+static void perf_ThreadExit(void *arg) {
+    perf_slot_t *t = arg;
+    uint32_t tid = syscall(SYS_gettid);
+
+    __atomic_compare_exchange_n(&t->owner, &tid, 0, false,
+                                __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+
+/* A forked child is another thread, it claims a slot of its own */
+static void perf_AtFork(void) {
+    perf_self = NULL;
+}
+
+/* Maps the shared memory file, once per process */
+static void perf_Map(void) {
+    const char *path = getenv(PERF_SHM_ENV);
+    uint32_t none = 0;
+    struct stat st;
+    void *p;
+    int fd;
+
+    pthread_key_create(&perf_key, perf_ThreadExit);
+    pthread_atfork(NULL, NULL, perf_AtFork);
+    if (path == NULL || *path == '\0') {
+        path = PERF_SHM;
+    }
+    fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        fprintf(stderr, "perf: open(%s) failed: %s\n", path, strerror(errno));
+        return;
+    }
+    /* every process traces into it, whatever its umask */
+    fchmod(fd, 0666);
+    if (fstat(fd, &st) < 0 ||
+        (st.st_size < (off_t)sizeof(perf_shm_t) && ftruncate(fd, sizeof(perf_shm_t)) < 0)) {
+        fprintf(stderr, "perf: sizing %s failed: %s\n", path, strerror(errno));
+        close(fd);
+        return;
+    }
+    p = mmap(NULL, sizeof(perf_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "perf: mmap(%s) failed: %s\n", path, strerror(errno));
+        return;
+    }
+
+    perf_shm_t *shm = p;
+    __atomic_compare_exchange_n(&shm->magic, &none, PERF_MAGIC, false,
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    if (shm->magic != PERF_MAGIC) {
+        fprintf(stderr, "perf: %s has another layout\n", path);
+        munmap(p, sizeof(perf_shm_t));
+        return;
+    }
+    __atomic_store_n(&perf_shm, shm, __ATOMIC_RELEASE);
+}
+
+/* Shared memory, NULL if it can not be mapped */
+static inline perf_shm_t *perf_Shm(void) {
+    pthread_once(&perf_once, perf_Map);
+    return __atomic_load_n(&perf_shm, __ATOMIC_ACQUIRE);
+}
+
+static bool perf_Claim(perf_slot_t *t, uint32_t owner, uint32_t tid) {
+    return __atomic_compare_exchange_n(&t->owner, &owner, tid, false,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+/* Slot of the calling thread, a free one or one of a thread gone on its
+ * first stamp; NULL if all are taken */
+static perf_slot_t *perf_Self(perf_shm_t *shm) {
+    perf_slot_t *t = perf_self;
+    uint32_t tid, i, owner;
+
+    if (t) {
+        return t;
+    }
+    tid = syscall(SYS_gettid);
+    /* already claimed by another copy of the tracer in this thread */
+    for (i = 0; i < PERF_SLOTS && !t; i++) {
+        if (__atomic_load_n(&shm->slot[i].owner, __ATOMIC_RELAXED) == tid) {
+            t = &shm->slot[i];
+        }
+    }
+    for (i = 0; i < PERF_SLOTS && !t; i++) {
+        if (perf_Claim(&shm->slot[i], 0, tid)) {
+            t = &shm->slot[i];
+        }
+    }
+    for (i = 0; i < PERF_SLOTS && !t; i++) {
+        owner = __atomic_load_n(&shm->slot[i].owner, __ATOMIC_RELAXED);
+        if (kill(owner, 0) < 0 && errno == ESRCH && perf_Claim(&shm->slot[i], owner, tid)) {
+            t = &shm->slot[i];
+        }
+    }
+    if (t) {
+        pthread_setspecific(perf_key, t);
+        perf_self = t;
+    }
+    return t;
+}
+
+int perf_Enable(bool enable) {
+    perf_shm_t *shm = perf_Shm();
+
+    if (shm == NULL) {
+        return -1;
+    }
+    __atomic_store_n(&shm->enabled, enable, __ATOMIC_RELAXED);
+    return 0;
+}
+
+int perf_IsEnabled(bool *enable) {
+    perf_shm_t *shm = perf_Shm();
+
+    *enable = shm && __atomic_load_n(&shm->enabled, __ATOMIC_RELAXED);
+    return shm ? 0 : -1;
+}
+
+int perf_Reset(void) {
+    perf_shm_t *shm = perf_Shm();
+
+    if (shm == NULL) {
+        return -1;
+    }
+    __atomic_add_fetch(&shm->epoch, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&shm->trigger, 0, __ATOMIC_RELAXED);
+    return 0;
+}
+
+uint64_t perf_Now(void) {
+    perf_shm_t *shm = perf_Shm();
+    struct timespec ts;
+
+    if (shm == NULL || !__atomic_load_n(&shm->enabled, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void perf_Stamp(rp_perf_stage_t stage, uint64_t start) {
+    if (start == 0 || stage >= RP_PERF_STAGES) {
+        return;
+    }
+    uint64_t now = perf_Now();
+    /* disabled since the start */
+    if (now < start) {
+        return;
+    }
+    perf_shm_t *shm = perf_shm;
+    perf_slot_t *t = perf_Self(shm);
+    if (t == NULL) {
+        return;
+    }
+    uint32_t epoch = __atomic_load_n(&shm->epoch, __ATOMIC_RELAXED);
+    if (t->epoch != epoch) {
+        t->head = 0;
+        memset(t->ring, 0, sizeof(t->ring));
+        memset(t->sum, 0, sizeof(t->sum));
+        memset(t->max, 0, sizeof(t->max));
+        memset(t->hist, 0, sizeof(t->hist));
+        __atomic_store_n(&t->epoch, epoch, __ATOMIC_RELEASE);
+    }
+
+    uint64_t ns = now - start;
+    rp_perf_rec_t *rec = &t->ring[t->head % PERF_RING_LEN];
+    rec->start  = start;
+    rec->ns     = ns;
+    rec->stage  = stage;
+    rec->thread = t - shm->slot;
+    __atomic_store_n(&t->head, t->head + 1, __ATOMIC_RELEASE);
+
+    t->sum[stage] += ns;
+    t->max[stage] = PERF_MAX(t->max[stage], ns);
+    t->hist[stage][perf_Bucket(ns)]++;
+}
+
+void perf_TriggerClear(void) {
+    perf_shm_t *shm = perf_Shm();
+
+    if (shm) {
+        __atomic_store_n(&shm->trigger, 0, __ATOMIC_RELAXED);
+    }
+}
+
+/* Keeps the first time the trigger was seen since the last clear */
+void perf_TriggerSeen(void) {
+    uint64_t none = 0;
+    uint64_t now = perf_Now();
+
+    if (now) {
+        __atomic_compare_exchange_n(&perf_shm->trigger, &none, now, false,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    }
+}
+
+uint64_t perf_GetTrigger(void) {
+    perf_shm_t *shm = perf_Shm();
+
+    return shm ? __atomic_load_n(&shm->trigger, __ATOMIC_RELAXED) : 0;
+}
+
+int perf_GetStat(rp_perf_stage_t stage, rp_perf_stat_t *stat) {
+    perf_shm_t *shm = perf_Shm();
+    uint64_t hist[PERF_BUCKETS] = { 0 };
+    uint64_t sum = 0;
+
+    if (shm == NULL || stage >= RP_PERF_STAGES) {
+        return -1;
+    }
+    memset(stat, 0, sizeof(rp_perf_stat_t));
+
+    uint32_t epoch = __atomic_load_n(&shm->epoch, __ATOMIC_RELAXED);
+    for (uint32_t s = 0; s < PERF_SLOTS; s++) {
+        perf_slot_t *t = &shm->slot[s];
+        if (__atomic_load_n(&t->epoch, __ATOMIC_ACQUIRE) != epoch) {
+            continue;
+        }
+        for (uint32_t i = 0; i < PERF_BUCKETS; i++) {
+            hist[i] += t->hist[stage][i];
+            stat->count += t->hist[stage][i];
+        }
+        sum += t->sum[stage];
+        stat->max = PERF_MAX(stat->max, t->max[stage]);
+    }
+
+    if (stat->count == 0) {
+        return 0;
+    }
+    stat->mean = sum / stat->count;
+
+    uint64_t n = 0, n50 = (stat->count + 1) / 2, n99 = stat->count - stat->count / 100;
+    for (uint32_t i = 0; i < PERF_BUCKETS; i++) {
+        n += hist[i];
+        if (stat->p50 == 0 && n >= n50) {
+            stat->p50 = PERF_MIN(perf_BucketTop(i), stat->max);
+        }
+        if (n >= n99) {
+            stat->p99 = PERF_MIN(perf_BucketTop(i), stat->max);
+            break;
+        }
+    }
+    return 0;
+}
+
+static int perf_CmpStart(const void *a, const void *b) {
+    uint64_t sa = ((const rp_perf_rec_t *)a)->start;
+    uint64_t sb = ((const rp_perf_rec_t *)b)->start;
+    return (sa > sb) - (sa < sb);
+}
+
+int perf_GetTrace(rp_perf_rec_t *recs, uint32_t *size) {
+    perf_shm_t *shm = perf_Shm();
+    uint32_t n = 0;
+
+    if (shm == NULL) {
+        return -1;
+    }
+    rp_perf_rec_t *all = malloc(PERF_SLOTS * PERF_RING_LEN * sizeof(rp_perf_rec_t));
+    if (all == NULL) {
+        return -1;
+    }
+    uint32_t epoch = __atomic_load_n(&shm->epoch, __ATOMIC_RELAXED);
+    for (uint32_t s = 0; s < PERF_SLOTS; s++) {
+        perf_slot_t *t = &shm->slot[s];
+        if (__atomic_load_n(&t->epoch, __ATOMIC_ACQUIRE) != epoch) {
+            continue;
+        }
+        uint32_t head = __atomic_load_n(&t->head, __ATOMIC_ACQUIRE);
+        for (uint32_t i = head - PERF_MIN(head, PERF_RING_LEN); i != head; i++) {
+            all[n++] = t->ring[i % PERF_RING_LEN];
+        }
+    }
+
+    qsort(all, n, sizeof(rp_perf_rec_t), perf_CmpStart);
+    *size = PERF_MIN(*size, n);
+    memcpy(recs, all + n - *size, *size * sizeof(rp_perf_rec_t));
+    free(all);
+    return 0;
+}
+
+const char *perf_StageName(rp_perf_stage_t stage) {
+    return stage < RP_PERF_STAGES ? perf_names[stage] : "UNKNOWN";
+}
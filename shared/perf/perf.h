@@ -0,0 +1,74 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya latency tracer.
+ *
+ * Stage stamps of every process on the board go to one shared memory file,
+ * so librp (SYST:PERF?), the application controllers and the web socket
+ * server trace into and read the same statistics without linking each
+ * other. Enabling and reset apply to all processes. The file is
+ * /dev/shm/rp_perf, or the one named by RP_PERF_SHM; it is created and
+ * extended by the first process using it.
+ *
+ * The stages and the statistics are those of librp, see rp_perf.h.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __PERF_H
+#define __PERF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "redpitaya/rp_perf.h"
+
+/** Shared memory file used when RP_PERF_SHM does not say otherwise */
+#define PERF_SHM            "/dev/shm/rp_perf"
+/** Environment variable naming the shared memory file */
+#define PERF_SHM_ENV        "RP_PERF_SHM"
+
+/** Threads stamping at the same time, over all processes */
+#define PERF_SLOTS          64
+/** Records kept in the ring of each thread */
+#define PERF_RING_LEN       64
+
+/** Histogram buckets: 4 per octave of ns up to 2^40 ns (~18 min) */
+#define PERF_OCTAVES        40
+#define PERF_BUCKETS        (4 * (PERF_OCTAVES - 1))
+
+#ifndef RP_PERF_DISABLE
+/** Declares t and takes the start of a stage in it, 0 while tracing is off */
+#define PERF_BEGIN(t)       uint64_t t = perf_Now()
+/** Stamps the end of a stage started at t */
+#define PERF_END(stage, t)  perf_Stamp(stage, t)
+#else
+#define PERF_BEGIN(t)
+#define PERF_END(stage, t)
+#endif
+
+int perf_Enable(bool enable);
+int perf_IsEnabled(bool *enable);
+int perf_Reset(void);
+uint64_t perf_Now(void);
+void perf_Stamp(rp_perf_stage_t stage, uint64_t start);
+void perf_TriggerClear(void);
+void perf_TriggerSeen(void);
+uint64_t perf_GetTrigger(void);
+int perf_GetStat(rp_perf_stage_t stage, rp_perf_stat_t *stat);
+int perf_GetTrace(rp_perf_rec_t *recs, uint32_t *size);
+const char *perf_StageName(rp_perf_stage_t stage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PERF_H */
@@ -0,0 +1,15 @@
+##
+# $Id: $
+#
+# (c) Red Pitaya  http://www.redpitaya.com
+#
+# Make fragment for users of the shared latency tracer library. Set
+# PERF_DIR to this directory before including it, then add $(PERF_CFLAGS)
+# to the compiler flags, link $(PERF_LIB) and -lpthread and build it with:
+#
+#   $(PERF_LIB):
+#   	$(MAKE) -C $(PERF_DIR)
+#
+
+PERF_LIB    = $(PERF_DIR)/lib/libperf.a
+PERF_CFLAGS = -I$(PERF_DIR) -I$(PERF_DIR)/../../api/include
@@ -0,0 +1,330 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya register map service.
+ *
+ * FPGA addresses are mapped in whole blocks of REGMAP_BLOCK_SIZE, which
+ * is the address range of one FPGA module, anything else in pages. Every
+ * mapping is shared by all handles inside it and unmapped with the last
+ * of them.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "regmap.h"
+
+/* Max. number of mappings alive at the same time */
+#define REGMAP_MAX 32
+
+typedef struct {
+    void     *ptr;    // mmap() result, NULL if the entry is free
+    uint32_t  addr;   // physical address at ptr
+    uint64_t  len;    // mapped length
+    int       refs;   // handles inside the mapping
+} regmap_entry_t;
+
+static pthread_mutex_t regmap_mutex = PTHREAD_MUTEX_INITIALIZER;
+static regmap_entry_t  regmap_cache[REGMAP_MAX];
+static regmap_stats_t  regmap_stats;
+
+static int      regmap_fd = -1;
+static int      regmap_lazy = 0;   // fd opened by regmap_get(), closed with the last mapping
+static int      regmap_owned = 0;  // fd opened here, not by the caller
+static int      regmap_sim = 0;    // fd is a simulator file, grown to the mapped blocks
+static uint32_t regmap_base = 0;   // physical address at fd offset 0
+
+
+static int regmap_open_locked(const char *dev)
+{
+    struct stat st;
+    int fd;
+
+    if (dev == NULL) {
+        dev = getenv(REGMAP_DEV_ENV);
+    }
+    if (dev == NULL || *dev == '\0') {
+        dev = REGMAP_DEV;
+    }
+
+    fd = open(dev, O_RDWR | O_SYNC);
+    if (fd < 0) {
+        fprintf(stderr, "regmap: open(%s) failed: %s\n", dev, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) < 0) {
+        fprintf(stderr, "regmap: fstat(%s) failed: %s\n", dev, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    regmap_fd = fd;
+    regmap_owned = 1;
+    regmap_sim = S_ISREG(st.st_mode);
+    regmap_base = regmap_sim ? REGMAP_FPGA_BASE : 0;
+    return 0;
+}
+
+static void regmap_close_locked(void)
+{
+    if (regmap_fd >= 0 && regmap_owned) {
+        close(regmap_fd);
+    }
+    regmap_fd = -1;
+    regmap_lazy = 0;
+    regmap_owned = 0;
+    regmap_sim = 0;
+    regmap_base = 0;
+}
+
+/**
+ * Selects the register device.
+ *
+ * Must be called before the first regmap_get(), or after every block has
+ * been put back. Without it regmap_get() opens the device named by
+ * RP_REGMAP_DEV, /dev/mem if that is not set. The device stays open until
+ * regmap_close().
+ *
+ * @param dev  /dev/mem, a simulator file or NULL for the default (or the
+ *             device already in use).
+ * @return     0 on success, -1 on failure.
+ */
+int regmap_open(const char *dev)
+{
+    int ret = -1;
+
+    pthread_mutex_lock(&regmap_mutex);
+    if (regmap_stats.mappings && dev == NULL) {
+        /* keep the device in use, open until regmap_close() */
+        regmap_lazy = 0;
+        ret = 0;
+    } else if (regmap_stats.mappings) {
+        fprintf(stderr, "regmap: device already in use\n");
+    } else {
+        regmap_close_locked();
+        ret = regmap_open_locked(dev);
+    }
+    pthread_mutex_unlock(&regmap_mutex);
+    return ret;
+}
+
+/**
+ * Selects an open register device, e.g. a memfd simulating the FPGA.
+ *
+ * The descriptor stays owned by the caller. Regular files and memfds are
+ * extended as blocks are mapped.
+ *
+ * @param fd    Open descriptor.
+ * @param base  Physical address at offset 0 of fd.
+ * @return      0 on success, -1 on failure.
+ */
+int regmap_open_fd(int fd, uint32_t base)
+{
+    struct stat st;
+    int ret = -1;
+
+    pthread_mutex_lock(&regmap_mutex);
+    if (regmap_stats.mappings) {
+        fprintf(stderr, "regmap: device already in use\n");
+    } else if (fstat(fd, &st) < 0) {
+        fprintf(stderr, "regmap: fstat() failed: %s\n", strerror(errno));
+    } else {
+        regmap_close_locked();
+        regmap_fd = fd;
+        regmap_sim = S_ISREG(st.st_mode);
+        regmap_base = base;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&regmap_mutex);
+    return ret;
+}
+
+/**
+ * Closes the device selected with regmap_open() or regmap_open_fd().
+ *
+ * @return  0 on success, -1 if blocks are still mapped.
+ */
+int regmap_close(void)
+{
+    int ret = -1;
+
+    pthread_mutex_lock(&regmap_mutex);
+    if (regmap_stats.mappings == 0) {
+        regmap_close_locked();
+        ret = 0;
+    }
+    pthread_mutex_unlock(&regmap_mutex);
+    return ret;
+}
+
+/* Mapping holding [addr, end) */
+static regmap_entry_t *regmap_find(uint32_t addr, uint64_t end)
+{
+    int i;
+
+    for (i = 0; i < REGMAP_MAX; i++) {
+        regmap_entry_t *e = &regmap_cache[i];
+        if (e->ptr && e->addr <= addr && end <= e->addr + e->len) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static regmap_entry_t *regmap_new(uint32_t addr, uint64_t end)
+{
+    uint64_t align = REGMAP_BLOCK_SIZE, start, off;
+    regmap_entry_t *e = NULL;
+    struct stat st;
+    void *ptr;
+    int i;
+
+    for (i = 0; i < REGMAP_MAX && e == NULL; i++) {
+        if (regmap_cache[i].ptr == NULL) {
+            e = &regmap_cache[i];
+        }
+    }
+    if (e == NULL) {
+        fprintf(stderr, "regmap: more than %d mappings\n", REGMAP_MAX);
+        return NULL;
+    }
+
+    if (addr < REGMAP_FPGA_BASE || end > (uint64_t)REGMAP_FPGA_BASE + REGMAP_FPGA_SIZE) {
+        align = sysconf(_SC_PAGESIZE);
+    }
+    start = addr / align * align;
+    end = (end + align - 1) / align * align;
+    if (start < regmap_base) {
+        fprintf(stderr, "regmap: 0x%08x is not on the device\n", addr);
+        return NULL;
+    }
+    off = start - regmap_base;
+
+    if (regmap_sim && fstat(regmap_fd, &st) == 0 && (uint64_t)st.st_size < off + (end - start)) {
+        if (ftruncate(regmap_fd, off + (end - start)) < 0) {
+            fprintf(stderr, "regmap: ftruncate() failed: %s\n", strerror(errno));
+            return NULL;
+        }
+    }
+
+    ptr = mmap(NULL, end - start, PROT_READ | PROT_WRITE, MAP_SHARED, regmap_fd, off);
+    if (ptr == MAP_FAILED) {
+        fprintf(stderr, "regmap: mmap(0x%08x) failed: %s\n", addr, strerror(errno));
+        return NULL;
+    }
+    e->ptr = ptr;
+    e->addr = start;
+    e->len = end - start;
+    e->refs = 0;
+    regmap_stats.maps++;
+    regmap_stats.mappings++;
+    return e;
+}
+
+/**
+ * Maps a register region.
+ *
+ * The handle points at addr and is bounded to size bytes. The region is
+ * taken from a cached mapping when one already holds it.
+ *
+ * @param addr  Physical address of the region.
+ * @param size  Size of the region [bytes].
+ * @param blk   Returned handle, release it with regmap_put().
+ * @return      0 on success, -1 on failure.
+ */
+int regmap_get(uint32_t addr, uint32_t size, regmap_block_t *blk)
+{
+    uint64_t end = (uint64_t)addr + size;
+    regmap_entry_t *e;
+
+    memset(blk, 0, sizeof(*blk));
+    if (size == 0 || end > 0x100000000ULL) {
+        fprintf(stderr, "regmap: invalid region 0x%08x + 0x%x\n", addr, size);
+        return -1;
+    }
+
+    pthread_mutex_lock(&regmap_mutex);
+    regmap_stats.gets++;
+    if (regmap_fd < 0) {
+        if (regmap_open_locked(NULL) < 0) {
+            pthread_mutex_unlock(&regmap_mutex);
+            return -1;
+        }
+        regmap_lazy = 1;
+    }
+
+    e = regmap_find(addr, end);
+    if (e == NULL) {
+        e = regmap_new(addr, end);
+    }
+    if (e == NULL) {
+        if (regmap_lazy && regmap_stats.mappings == 0) {
+            regmap_close_locked();
+        }
+        pthread_mutex_unlock(&regmap_mutex);
+        return -1;
+    }
+    e->refs++;
+    blk->regs = (volatile uint32_t *)((char *)e->ptr + (addr - e->addr));
+    blk->addr = addr;
+    blk->size = size;
+    pthread_mutex_unlock(&regmap_mutex);
+    return 0;
+}
+
+/**
+ * Releases a handle of regmap_get(), it is cleared.
+ *
+ * The mapping is found by the regs and size of the handle, so code keeping
+ * only the register pointer can release it with a handle made of those.
+ *
+ * The mapping is removed with its last handle, the device is closed with
+ * the last mapping unless it was selected with regmap_open() or
+ * regmap_open_fd(). Handles which are already cleared are ignored.
+ */
+void regmap_put(regmap_block_t *blk)
+{
+    char *regs = (char *)blk->regs;
+    int i;
+
+    if (regs == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&regmap_mutex);
+    for (i = 0; i < REGMAP_MAX; i++) {
+        regmap_entry_t *e = &regmap_cache[i];
+        if (e->ptr && (char *)e->ptr <= regs && regs + blk->size <= (char *)e->ptr + e->len) {
+            if (--e->refs == 0) {
+                munmap(e->ptr, e->len);
+                e->ptr = NULL;
+                regmap_stats.mappings--;
+            }
+            break;
+        }
+    }
+    if (regmap_lazy && regmap_stats.mappings == 0) {
+        regmap_close_locked();
+    }
+    pthread_mutex_unlock(&regmap_mutex);
+    memset(blk, 0, sizeof(*blk));
+}
+
+/** Copies the mapping cache counters */
+void regmap_get_stats(regmap_stats_t *stats)
+{
+    pthread_mutex_lock(&regmap_mutex);
+    *stats = regmap_stats;
+    pthread_mutex_unlock(&regmap_mutex);
+}
@@ -0,0 +1,105 @@
+/**
+ * $Id: $
+ *
+ * @brief Red Pitaya register map service.
+ *
+ * One place for librp, the applications and the tools to map FPGA register
+ * blocks. Mappings are cached per physical block and shared by everyone
+ * asking for an address inside it, so modules mapping overlapping regions
+ * and code mapping in a loop cost no extra mmap() calls. Callers get block
+ * handles with the bounds of the region they asked for.
+ *
+ * The registers come from /dev/mem, or from a file or memfd standing in
+ * for the FPGA (a register simulator): set RP_REGMAP_DEV to the file or
+ * call regmap_open() / regmap_open_fd() before the first regmap_get(). A
+ * simulator file holds the FPGA address space from REGMAP_FPGA_BASE at
+ * offset 0 and is extended as blocks are mapped.
+ *
+ * (c) Red Pitaya  http://www.redpitaya.com
+ *
+ * This part of code is written in C programming language.
+ * Please visit http://en.wikipedia.org/wiki/C_(programming_language)
+ * for more details on the language used herein.
+ */
+
+#ifndef __REGMAP_H
+#define __REGMAP_H
+
+#include <stdint.h>
+
+/** Device used when neither RP_REGMAP_DEV nor regmap_open() say otherwise */
+#define REGMAP_DEV          "/dev/mem"
+/** Environment variable naming the device or simulator file */
+#define REGMAP_DEV_ENV      "RP_REGMAP_DEV"
+
+/** FPGA address space: blocks of REGMAP_BLOCK_SIZE from REGMAP_FPGA_BASE */
+#define REGMAP_FPGA_BASE    0x40000000
+#define REGMAP_FPGA_SIZE    0x40000000
+#define REGMAP_BLOCK_SIZE   0x00100000
+
+/** Handle of a mapped register region */
+typedef struct {
+    volatile uint32_t *regs;   // first register of the region
+    uint32_t           addr;   // physical address of the region
+    uint32_t           size;   // size of the region [bytes]
+} regmap_block_t;
+
+/** Mapping cache counters */
+typedef struct {
+    uint32_t gets;       // regmap_get() calls
+    uint32_t maps;       // of those which needed an mmap()
+    uint32_t mappings;   // mappings alive
+} regmap_stats_t;
+
+int  regmap_open(const char *dev);
+int  regmap_open_fd(int fd, uint32_t base);
+int  regmap_close(void);
+int  regmap_get(uint32_t addr, uint32_t size, regmap_block_t *blk);
+void regmap_put(regmap_block_t *blk);
+void regmap_get_stats(regmap_stats_t *stats);
+
+/** Maps the region of a register structure */
+#define REGMAP_GET(addr, type, blk)  regmap_get((addr), sizeof(type), (blk))
+
+/** Typed access to a block, NULL if the block is smaller than the type */
+#define REGMAP_REGS(blk, type) \
+    ((blk)->regs != NULL && sizeof(type) <= (blk)->size ? \
+     (volatile type *)(blk)->regs : (volatile type *)NULL)
+
+/** Address of the register at byte offset off, NULL if outside the block */
+static inline volatile uint32_t *regmap_reg(const regmap_block_t *blk,
+                                            uint32_t off)
+{
+    if (blk->regs == NULL || (off & 3) || off >= blk->size) {
+        return NULL;
+    }
+    return blk->regs + off / 4;
+}
+
+/** Reads the register at byte offset off, -1 if outside the block */
+static inline int regmap_read(const regmap_block_t *blk, uint32_t off,
+                              uint32_t *val)
+{
+    volatile uint32_t *reg = regmap_reg(blk, off);
+
+    if (reg == NULL) {
+        return -1;
+    }
+    *val = *reg;
+    return 0;
+}
+
+/** Writes the register at byte offset off, -1 if outside the block */
+static inline int regmap_write(const regmap_block_t *blk, uint32_t off,
+                               uint32_t val)
+{
+    volatile uint32_t *reg = regmap_reg(blk, off);
+
+    if (reg == NULL) {
+        return -1;
+    }
+    *reg = val;
+    return 0;
+}
+
+#endif /* __REGMAP_H */
@@ -0,0 +1,16 @@
+##
+# $Id: $
+#
+# (c) Red Pitaya  http://www.redpitaya.com
+#
+# Make fragment for users of the shared register map library. Set
+# REGMAP_DIR to this directory before including it, then add
+# $(REGMAP_CFLAGS) to the compiler flags, link $(REGMAP_LIB) and -lpthread
+# and build it with:
+#
+#   $(REGMAP_LIB):
+#   	$(MAKE) -C $(REGMAP_DIR)
+#
+
+REGMAP_LIB    = $(REGMAP_DIR)/lib/libregmap.a
+REGMAP_CFLAGS = -I$(REGMAP_DIR)
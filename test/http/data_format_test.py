@@ -0,0 +1,76 @@
+#!/usr/bin/env python
+
+"""/data endpoint test, compares latency and response size of JSON and binary formats.
+
+Start the oscilloscope application in the browser (or load it through
+/bazaar?start=scope) before running: python data_format_test.py <board ip>
+"""
+
+import sys
+import time
+import json
+import gzip
+import struct
+import urllib2
+import StringIO
+
+REPEAT = 50
+
+url = 'http://' + sys.argv[1] + '/data'
+
+HDR = '<IHHIIIII'
+HDR_LEN = struct.calcsize(HDR)
+MAGIC = 0x42445052
+
+def get(args, gz):
+    """GET /data with given query arguments, returns (body, bytes on wire)."""
+    req = urllib2.Request(url + args)
+    if gz:
+        req.add_header('Accept-Encoding', 'gzip')
+    body = urllib2.urlopen(req).read()
+    size = len(body)
+    if gz and body[:2] == '\x1f\x8b':
+        body = gzip.GzipFile(fileobj=StringIO.StringIO(body)).read()
+    return body, size
+
+def decode_bin(body):
+    """Decode binary response to (status, params, list of columns)."""
+    magic, version, fmt, status, num, length, json_len, offset = struct.unpack(HDR, body[:HDR_LEN])
+    assert magic == MAGIC and version == 1
+    scale = struct.unpack('<%df' % num, body[HDR_LEN:HDR_LEN+4*num])
+    shift = struct.unpack('<%df' % num, body[HDR_LEN+4*num:HDR_LEN+8*num])
+    params = json.loads(body[HDR_LEN+8*num:HDR_LEN+8*num+json_len])
+    code = 'h' if fmt == 2 else 'f'
+    size = struct.calcsize(code)
+    cols = []
+    for i in range(num):
+        raw = struct.unpack('<%d%s' % (length, code), body[offset+i*length*size:offset+(i+1)*length*size])
+        cols.append([v * scale[i] + shift[i] for v in raw])
+    return status, params, cols
+
+def timed(name, args, gz):
+    size = 0
+    start = time.time()
+    for i in range(REPEAT):
+        body, n = get(args, gz)
+        size += n
+    t = (time.time() - start) / REPEAT
+    print '%-12s %8.1f ms/request %9d bytes/response' % (name, t * 1000, size / REPEAT)
+
+timed('json', '', False)
+timed('json gzip', '?gzip=1', True)
+timed('f32', '?format=f32', False)
+timed('f32 gzip', '?format=f32&gzip=1', True)
+timed('i16', '?format=i16', False)
+timed('i16 gzip', '?format=i16&gzip=1', True)
+
+# compare decoded binary signals against the text ones (same capture is not
+# guaranteed, so only shape and parameters are compared)
+text = json.loads(get('', False)[0])
+status, params, cols = decode_bin(get('?format=f32', False)[0])
+assert len(cols) == 3
+assert len(cols[0]) == len(text['datasets']['g1'][0]['data'])
+assert sorted(params['datasets']['params'].keys()) == sorted(text['datasets']['params'].keys())
+status, params, q = decode_bin(get('?format=i16', False)[0])
+assert [len(c) for c in q] == [len(c) for c in cols]
+print 'OK'
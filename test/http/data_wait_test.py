@@ -0,0 +1,111 @@
+#!/usr/bin/env python
+
+"""/data wait test, measures request latency and concurrent client throughput.
+
+Uses the dummy application of Test/data_dummy_app, which publishes signals at
+a rate set through its 'rate' parameter. Install it on the board
+(make install INSTALL_DIR=/opt/redpitaya/www/apps) and run:
+python data_wait_test.py <board ip>
+
+GET /data waits on the nginx event loop for new signals, so one publication
+answers every waiting client and the worker keeps serving other requests
+while they wait. Both are checked, once with the application's signals fd and
+once with the server polling (notify=0).
+"""
+
+import sys
+import time
+import json
+import threading
+import urllib2
+
+DURATION = 3.0
+
+base = 'http://' + sys.argv[1]
+
+def get(path):
+    start = time.time()
+    body = urllib2.urlopen(base + path).read()
+    return body, time.time() - start
+
+def start_app(notify, rate):
+    """(Re)starts the dummy app, notify is read on the first wait only."""
+    reply = json.loads(get('/bazaar?start=data_dummy')[0])
+    assert reply['status'] == 'OK', reply
+    body = json.dumps({'datasets': {'params': {'rate': rate, 'notify': notify}}})
+    reply = json.loads(urllib2.urlopen(base + '/data', body).read())
+    assert reply['status'] == 'OK', reply
+
+def set_rate(rate):
+    body = json.dumps({'datasets': {'params': {'rate': rate}}})
+    urllib2.urlopen(base + '/data', body).read()
+
+def get_signals():
+    """GET /data, returns (status, sequence number, latency)."""
+    body, t = get('/data')
+    reply = json.loads(body)
+    seq = int(reply['datasets']['g1'][1]['data'][0][1])
+    return reply['status'], seq, t
+
+def latency(rate, count):
+    set_rate(rate)
+    get_signals()
+    times = []
+    ok = 0
+    last = -1
+    for i in range(count):
+        status, seq, t = get_signals()
+        times.append(t)
+        if status == 'OK':
+            assert seq > last, 'signals sent twice (%d after %d)' % (seq, last)
+            ok += 1
+        last = seq
+    times.sort()
+    print '  %6g Hz  %7.1f ms avg %7.1f ms median %7.1f ms max  %3d%% OK' % (
+        rate, 1000 * sum(times) / count, 1000 * times[count / 2],
+        1000 * times[-1], 100 * ok / count)
+
+def throughput(rate, clients):
+    set_rate(rate)
+    stop = time.time() + DURATION
+    counts = [[0, 0] for i in range(clients)]
+
+    def client(c):
+        while time.time() < stop:
+            status, seq, t = get_signals()
+            c[0] += 1
+            c[1] += status == 'OK'
+
+    threads = [threading.Thread(target=client, args=(counts[i],)) for i in range(clients)]
+    for t in threads:
+        t.start()
+    # the worker must answer other requests while the clients wait
+    probe = []
+    while time.time() < stop - 0.5:
+        probe.append(get('/bazaar?help=')[1])
+        time.sleep(0.1)
+    for t in threads:
+        t.join()
+
+    total = sum(c[0] for c in counts)
+    ok = sum(c[1] for c in counts)
+    print '  %6g Hz %3d clients  %7.1f req/s  %7.1f OK/s (%.1f per publication)' \
+          '  other requests %5.1f ms max' % (
+        rate, clients, total / DURATION, ok / DURATION, ok / DURATION / rate,
+        1000 * max(probe))
+    return ok / DURATION / rate
+
+for notify in (1, 0):
+    print 'signals fd' if notify else 'polling'
+    start_app(notify, 10)
+    for rate in (1, 10, 100, 1000):
+        latency(rate, 20 if rate < 10 else 50)
+    for clients in (1, 4, 16):
+        served = throughput(10, clients)
+        # every waiting client gets each publication (allow for a late start)
+        assert served > 0.7 * clients, 'clients serialized on the worker'
+    throughput(1000, 16)
+
+set_rate(0)
+get('/bazaar?stop=')
+print 'OK'
@@ -0,0 +1,68 @@
+#!/usr/bin/env python
+
+"""Arbitrary waveform upload test, compares ASCII and binary block upload times
+and checks that a block over the size limit closes the connection."""
+
+import sys
+import math
+import time
+import struct
+import redpitaya_scpi as scpi
+
+N = 16*1024
+REPEAT = 10
+
+rp_s = scpi.scpi(sys.argv[1])
+
+def block(data):
+    """Format definite length block #<n><length><data>."""
+    length = str(len(data))
+    return '#' + str(len(length)) + length + data
+
+def rx_block():
+    """Receive definite length block and return its data."""
+    msg = ''
+    while len(msg) < 2:
+        msg += rp_s._socket.recv(4096)
+    digits = int(msg[1])
+    while len(msg) < 2 + digits:
+        msg += rp_s._socket.recv(4096)
+    length = int(msg[2:2+digits])
+    while len(msg) < 2 + digits + length + len(rp_s.delimiter):
+        msg += rp_s._socket.recv(65536)
+    return msg[2+digits:2+digits+length]
+
+def timed(name, cmd):
+    start = time.time()
+    for i in range(REPEAT):
+        rp_s.tx_txt(cmd)
+        # make sure command was executed before next one is sent
+        rp_s.tx_txt('SOUR1:FUNC?')
+        rp_s.rx_txt()
+    elapsed = (time.time() - start) / REPEAT
+    print '{:8s} {:8d} bytes {:8.2f} ms/upload'.format(name, len(cmd), elapsed * 1e3)
+
+wave = [0.9 * math.sin(2 * math.pi * i / N) for i in range(N)]
+codes = [int(round(x * 8192)) for x in wave]
+
+rp_s.tx_txt('GEN:RST')
+rp_s.tx_txt('SOUR1:FUNC ARBITRARY')
+
+timed('ASCII', 'SOUR1:TRAC:DATA:DATA ' + ','.join('{:.6f}'.format(x) for x in wave))
+timed('ASCII 17', 'SOUR1:TRAC:DATA:DATA ' + ','.join(repr(x) for x in wave))
+timed('FLOAT', 'SOUR1:TRAC:DATA:FLOAT ' + block(struct.pack('<%df' % N, *wave)))
+timed('RAW', 'SOUR1:TRAC:DATA:RAW ' + block(struct.pack('<%dh' % N, *codes)))
+
+# partial update of 1k samples in the middle of the waveform
+part = [0] * 1024
+timed('RAW 1k', 'SOUR1:TRAC:DATA:RAW ' + block(struct.pack('<%dh' % len(part), *part)) + ',8192')
+
+rp_s.tx_txt('SOUR1:TRAC:DATA:RAW?')
+back = struct.unpack('<%dh' % N, rx_block())
+expected = codes[:8192] + part + codes[8192+len(part):]
+errors = sum(1 for a, b in zip(back, expected) if a != b)
+print 'read back {:d} samples, {:d} mismatches'.format(len(back), errors)
+
+# a block over the 64 kB limit closes the connection, its data is not parsed
+rp_s.tx_txt('SOUR1:TRAC:DATA:RAW #6100000')
+print 'block over the limit: connection {:s}'.format('closed' if rp_s._socket.recv(1) == '' else 'open')
@@ -38,6 +38,22 @@ class scpi (object):
                 break
         return msg[:-2]
 
+    def rx_arb(self):
+        """Receive a definite length block #<n><length><data> and return the data."""
+        if self._recv(1) != '#':
+            return False
+        digits = int(self._recv(1))
+        return self._recv(int(self._recv(digits)))
+
+    def _recv(self, size):
+        data = ''
+        while len(data) < size:
+            chunk = self._socket.recv(size - len(data))
+            if not chunk:
+                raise socket.error('connection closed')
+            data += chunk
+        return data
+
     def tx_txt(self, msg):
         """Send text string ending and append delimiter."""
         return self._socket.send(msg + self.delimiter)
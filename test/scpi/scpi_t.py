@@ -4,6 +4,9 @@ __author__ = "Luka Golinar <luka.golinar@gmail.com>"
 #Imports
 import redpitaya_scpi as scpi
 import unittest
+import time
+import socket
+import struct
 
 #Scpi declaration
 rp_scpi = scpi.scpi('192.168.1.241')
@@ -54,6 +57,11 @@ class Base(object):
         rp_scpi.tx_txt('ANALOG:PIN? ' + pin)
         return rp_scpi.rx_txt()
 
+    def rp_analog_stream(self, pin, size):
+        rp_scpi.tx_txt('ANALOG:STREAM:DATA? ' + pin + ',' + str(size))
+        buff = rp_scpi.rx_txt().strip('{}\n\r').split(',')
+        return [float(v) for v in buff]
+
     def rp_freq(self, channel, freq):
         rp_scpi.tx_txt('SOUR' + str(channel) + ':FREQ:FIX ' + str(freq))
         rp_scpi.tx_txt('SOUR' + str(channel) + ':FREQ:FIX?')
@@ -247,6 +255,42 @@ class MainTest(unittest.TestCase):
             self.assertTrue(1.2 <= float(Base().rp_analog_pin(rp_a_pin_o[a_pin], '1.34', True)) <= 1.4)
             self.assertTrue(0 <= float(Base().rp_analog_pin(rp_a_pin_i[a_pin], None, False)) <= 0.1)
 
+    def test0203_analog_stream(self):
+        rp_scpi.tx_txt('ANALOG:STREAM:START 1000')
+        rp_scpi.tx_txt('ANALOG:STREAM:RATE?')
+        self.assertTrue(900 <= float(rp_scpi.rx_txt()) <= 1100)
+        time.sleep(0.5)
+        for a_pin in rp_a_pin_i:
+            data = Base().rp_analog_stream(rp_a_pin_i[a_pin], 100)
+            self.assertEquals(len(data), 100)
+            self.assertTrue(all(0 <= v <= 7 for v in data))
+            rp_scpi.tx_txt('ANALOG:STREAM:TIME?')
+            self.assertTrue(float(rp_scpi.rx_txt()) > 0)
+            rp_scpi.tx_txt('ANALOG:STREAM:AVG? ' + rp_a_pin_i[a_pin] + ',100')
+            self.assertTrue(min(data) - 0.01 <= float(rp_scpi.rx_txt()) <= max(data) + 0.01)
+        rp_scpi.tx_txt('ANALOG:STREAM:STOP')
+
+    def test0204_dport(self):
+        rp_scpi.tx_txt('DIG:PORT:DIR DIO_N,255,255')
+        rp_scpi.tx_txt('DIG:PORT:DIR? DIO_N')
+        self.assertEquals(int(rp_scpi.rx_txt()), 255)
+        for state in [0x55, 0xaa, 0x00]:
+            rp_scpi.tx_txt('DIG:PORT LED,255,' + str(state))
+            rp_scpi.tx_txt('DIG:PORT? LED')
+            self.assertEquals(int(rp_scpi.rx_txt()), state)
+
+    def test0205_dseq(self):
+        rp_scpi.tx_txt('DIG:SEQ LED,1000,1,1,500000,1,0,500000')
+        time.sleep(0.1)
+        rp_scpi.tx_txt('DIG:SEQ:STAT?')
+        stat = rp_scpi.rx_txt().split(',')
+        self.assertEquals(int(stat[0]), 1)
+        rp_scpi.tx_txt('DIG:SEQ:STOP')
+        rp_scpi.tx_txt('DIG:SEQ:STAT?')
+        stat = rp_scpi.rx_txt().split(',')
+        self.assertEquals(int(stat[0]), 0)
+        self.assertTrue(int(stat[1]) > 100)
+
     ############### SIGNAL GENERATOR ###############
     def test0300_freq(self):
         for freq in rp_freq_range:
@@ -344,6 +388,55 @@ class MainTest(unittest.TestCase):
     def test04070_buffer_size(self):
         self.assertEquals(Base().rp_buffer_size(), '16384')
 
+    def test04080_perf(self):
+        rp_scpi.tx_txt('SYST:PERF:RST')
+        rp_scpi.tx_txt('SYST:PERF ON')
+        rp_scpi.tx_txt('ACQ:START')
+        rp_scpi.tx_txt('ACQ:TRIG NOW')
+        time.sleep(0.1)
+        rp_scpi.tx_txt('ACQ:TRIG:STAT?')
+        self.assertEquals(rp_scpi.rx_txt(), 'TD')
+        rp_scpi.tx_txt('ACQ:SOUR1:DATA?')
+        rp_scpi.rx_txt()
+        rp_scpi.tx_txt('SYST:PERF OFF')
+        rp_scpi.tx_txt('SYST:PERF?')
+        perf = rp_scpi.rx_txt().split(',')
+        stages = {perf[i]: perf[i + 1:i + 6] for i in range(0, len(perf), 6)}
+        # name, count, mean, p50, p99, max
+        for stage in ['ACQ_READ', 'SCPI_DATA', 'SCPI_TRIG']:
+            self.assertEquals(int(stages[stage][0]), 1)
+            self.assertTrue(float(stages[stage][4]) > 0)
+        self.assertTrue(float(stages['SCPI_DATA'][4]) >= float(stages['ACQ_READ'][4]))
+
+    def test04090_stream(self):
+        rp_scpi.tx_txt('ACQ:RST')
+        rp_scpi.tx_txt('ACQ:DATA:UNITS RAW')
+        rp_scpi.tx_txt('ACQ:TRIG NOW')
+        rp_scpi.tx_txt('ACQ:DATA:STREAM ON')
+        seq, dropped = -1, 0
+        for i in range(50):
+            frame = rp_scpi.rx_arb()
+            # magic, version, header_len, seq, dropped, timestamp, decimation,
+            # trig_idx, channels, format, samples
+            hdr = struct.unpack_from('<IHHIIQIIHHI', frame)
+            self.assertEquals(hdr[0], 0x53415052)
+            self.assertEquals(hdr[9], 1)
+            self.assertEquals(len(frame), hdr[2] + hdr[8] * hdr[10] * 2)
+            # a gap in the sequence are the windows dropped meanwhile
+            self.assertEquals(hdr[3] - seq - 1, hdr[4] - dropped)
+            seq, dropped = hdr[3], hdr[4]
+        rp_scpi.tx_txt('ACQ:DATA:STREAM OFF')
+        rp_scpi.tx_txt('ACQ:DATA:STREAM:STAT?')
+        # frames sent before the stream stopped come ahead of the reply
+        while rp_scpi._socket.recv(1, socket.MSG_PEEK) == '#':
+            rp_scpi.rx_arb()
+        frames, dropped = map(int, rp_scpi.rx_txt().split(','))
+        self.assertTrue(frames >= 50)
+        self.assertTrue(frames + dropped > seq)
+        rp_scpi.tx_txt('ACQ:DATA:STREAM?')
+        self.assertEquals(rp_scpi.rx_txt(), 'OFF')
+        rp_scpi.tx_txt('ACQ:DATA:UNITS VOLTS')
+
     #TODO: ACQ:WPOS?  ACQ:TPOS?
     #TODO: Arbitrary-waveform. TRAC-DATA
 